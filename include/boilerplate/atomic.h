@@ -78,6 +78,14 @@ static inline void atomic_set(atomic_t *ptr, long v)
 #define smp_wmb()	do { } while (0)
 #endif /* !CONFIG_SMP */
 
+#ifndef smp_load_acquire
+#define smp_load_acquire(__p)		__atomic_load_n(__p, __ATOMIC_ACQUIRE)
+#endif
+
+#ifndef smp_store_release
+#define smp_store_release(__p, __v)	__atomic_store_n(__p, __v, __ATOMIC_RELEASE)
+#endif
+
 #define ACCESS_ONCE(x) (*(volatile typeof(x) *)&(x))
 
 #define compiler_barrier()	__asm__ __volatile__("": : :"memory")
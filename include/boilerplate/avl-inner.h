@@ -100,30 +100,44 @@ struct __AVL_T(avl) {
 
 #ifdef AVL_PSHARED
 
+/*
+ * Links are stored as offsets from the tree descriptor, so that
+ * the tree can live in memory mapped at different addresses by
+ * different processes. A null link is encoded as (ptrdiff_t)-1,
+ * since a zero offset would refer to the descriptor itself.
+ */
+#define SHAVL_NULL_LINK  ((ptrdiff_t)-1)
+
 static inline struct shavlh *
 shavlh_link(const struct shavl *const avl,
 	    const struct shavlh *const holder, unsigned int dir)
 {
-	return (void *)avl + holder->link[avl_type2index(dir)].offset;
+	ptrdiff_t offset = holder->link[avl_type2index(dir)].offset;
+
+	return offset == SHAVL_NULL_LINK ? NULL : (void *)avl + offset;
 }
 
 static inline void
 shavlh_set_link(struct shavl *const avl, struct shavlh *lhs,
 		int dir, struct shavlh *rhs)
 {
-	lhs->link[avl_type2index(dir)].offset = (void *)rhs - (void *)avl;
+	lhs->link[avl_type2index(dir)].offset =
+		rhs ? (void *)rhs - (void *)avl : SHAVL_NULL_LINK;
 }
 
 static inline
 struct shavlh *shavl_end(const struct shavl *const avl, int dir)
 {
-	return (void *)avl + avl->end[avl_type2index(dir)].offset;
+	ptrdiff_t offset = avl->end[avl_type2index(dir)].offset;
+
+	return offset == SHAVL_NULL_LINK ? NULL : (void *)avl + offset;
 }
 
 static inline void
 shavl_set_end(struct shavl *const avl, int dir, struct shavlh *holder)
 {
-	avl->end[avl_type2index(dir)].offset = (void *)holder - (void *)avl;
+	avl->end[avl_type2index(dir)].offset =
+		holder ? (void *)holder - (void *)avl : SHAVL_NULL_LINK;
 }
 
 #define shavl_count(avl)	((avl)->count)
@@ -23,6 +23,7 @@
 #include <boilerplate/list.h>
 
 #define HASHSLOTS  (1<<8)
+#define HASHSLOTS_MAX  (1<<20)
 
 struct hashobj {
 	dref_type(const void *) key;
@@ -40,6 +41,11 @@ struct hash_bucket {
 struct hash_table {
 	struct hash_bucket table[HASHSLOTS];
 	pthread_mutex_t lock;
+	dref_type(struct hash_bucket *) buckets;
+	unsigned int mask;
+	unsigned int count;
+	unsigned int seq;
+	int walkers;
 };
 
 struct hash_operations {
@@ -48,9 +54,10 @@ struct hash_operations {
 		       size_t len);
 #ifdef CONFIG_XENO_PSHARED
 	int (*probe)(struct hashobj *oldobj);
+#endif
+	/* Optional, the bucket array cannot grow without them. */
 	void *(*alloc)(size_t len);
 	void (*free)(void *key);
-#endif
 };
 
 typedef int (*hash_walk_op)(struct hash_table *t,
@@ -74,12 +81,19 @@ struct pvhash_bucket {
 struct pvhash_table {
 	struct pvhash_bucket table[HASHSLOTS];
 	pthread_mutex_t lock;
+	struct pvhash_bucket *buckets;
+	unsigned int mask;
+	unsigned int count;
+	unsigned int seq;
+	int walkers;
 };
 
 struct pvhash_operations {
 	int (*compare)(const void *l,
 		       const void *r,
 		       size_t len);
+	void *(*alloc)(size_t len);
+	void (*free)(void *key);
 };
 
 typedef int (*pvhash_walk_op)(struct pvhash_table *t,
@@ -24,6 +24,7 @@
 #include <boilerplate/list.h>
 #include <boilerplate/lock.h>
 #include <boilerplate/avl.h>
+#include <pthread.h>
 
 #define HEAPMEM_PAGE_SHIFT	9 /* 2^9 => 512 bytes */
 #define HEAPMEM_PAGE_SIZE	(1UL << HEAPMEM_PAGE_SHIFT)
@@ -40,6 +41,14 @@
 /* Bits we need for encoding a page # */
 #define HEAPMEM_PGENT_BITS      (32 - HEAPMEM_PAGE_SHIFT)
 
+/*
+ * Blocks from 2^HEAPMEM_MIN_LOG2 up to 2^HEAPMEM_CACHE_MAX_LOG2 bytes
+ * may be served from per-thread magazines, see heapmem_enable_cache().
+ */
+#define HEAPMEM_CACHE_MAX_LOG2	8 /* 256 bytes */
+#define HEAPMEM_CACHE_BUCKETS	(HEAPMEM_CACHE_MAX_LOG2 - HEAPMEM_MIN_LOG2 + 1)
+#define HEAPMEM_CACHE_MAX_DEPTH	64
+
 /* Each page is represented by a page map entry. */
 #define HEAPMEM_PGMAP_BYTES	sizeof(struct heapmem_pgentry)
 
@@ -82,6 +91,20 @@ struct heapmem_extent {
 	struct heapmem_pgentry pagemap[0]; /* Start of page entries[] */
 };
 
+struct heapmem_cache_stats {
+	/* Allocations served from/missed by the magazines. */
+	unsigned long alloc_hits;
+	unsigned long alloc_misses;
+	/* Releases absorbed by/missed by the magazines. */
+	unsigned long free_hits;
+	unsigned long free_misses;
+	/* Batch transfers from/to the central bucket lists. */
+	unsigned long refills;
+	unsigned long flushes;
+	/* Number of times heap->lock was grabbed. */
+	unsigned long lock_acquisitions;
+};
+
 struct heap_memory {
 	pthread_mutex_t lock;
 	struct pvlistobj extents;
@@ -90,6 +113,10 @@ struct heap_memory {
 	size_t used_size;
 	/* Heads of page lists for log2-sized blocks. */
 	uint32_t buckets[HEAPMEM_MAX];
+	/* Per-thread magazine layer, disabled if cache_depth is zero. */
+	int cache_depth;
+	pthread_key_t cache_key;
+	struct heapmem_cache_stats cache_stats;
 };
 
 #define __HEAPMEM_MAP_SIZE(__nrpages)					\
@@ -148,6 +175,14 @@ size_t heapmem_used_size(const struct heap_memory *heap)
 ssize_t heapmem_check(struct heap_memory *heap,
 		      void *block);
 
+int heapmem_enable_cache(struct heap_memory *heap,
+			 int depth);
+
+void heapmem_flush_cache(struct heap_memory *heap);
+
+void heapmem_get_cache_stats(struct heap_memory *heap,
+			     struct heapmem_cache_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
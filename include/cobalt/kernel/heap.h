@@ -21,6 +21,7 @@
 
 #include <linux/string.h>
 #include <linux/rbtree.h>
+#include <linux/percpu.h>
 #include <cobalt/kernel/lock.h>
 #include <cobalt/kernel/list.h>
 #include <cobalt/uapi/kernel/types.h>
@@ -91,6 +92,40 @@ struct xnheap {
 	struct list_head next;
 };
 
+/*
+ * Number of objects moved at once between the per-CPU free lists of
+ * an object cache and its shared depot. A CPU keeps at most twice
+ * that number of free objects.
+ */
+#define XNOBJCACHE_BATCH	16
+/* Free objects kept in the depot before memory returns to the heap. */
+#define XNOBJCACHE_DEPOT_MAX	(8 * XNOBJCACHE_BATCH)
+
+struct xnobjcache_cpu {
+	/* Free objects, linked through their trailing word. */
+	void *objs;
+	int nr;
+	unsigned long allocs;
+	/* Allocations the local list could not serve. */
+	unsigned long misses;
+};
+
+struct xnobjcache {
+	struct xnheap *heap;
+	size_t objsize;
+	/* Offset of the free list link, past the object. */
+	size_t linkoff;
+	void (*ctor)(void *obj);
+	struct xnobjcache_cpu __percpu *cpus;
+	void *depot;
+	int depot_nr;
+	/* Objects carved from the heap, busy or free. */
+	unsigned long nr_objs;
+	char name[XNOBJECT_NAME_LEN];
+	DECLARE_XNLOCK(lock);
+	struct list_head next;
+};
+
 extern struct xnheap cobalt_heap;
 
 #define xnmalloc(size)     xnheap_alloc(&cobalt_heap, size)
@@ -137,6 +172,24 @@ void *xnheap_vmalloc(size_t size);
 
 void xnheap_vfree(void *p);
 
+int xnobjcache_init(struct xnobjcache *cache, struct xnheap *heap,
+		    size_t objsize, void (*ctor)(void *obj));
+
+void xnobjcache_destroy(struct xnobjcache *cache);
+
+void *xnobjcache_alloc(struct xnobjcache *cache);
+
+void xnobjcache_free(struct xnobjcache *cache, void *obj);
+
+void xnobjcache_set_name(struct xnobjcache *cache,
+			 const char *name, ...);
+
+static inline
+size_t xnobjcache_get_objsize(const struct xnobjcache *cache)
+{
+	return cache->objsize;
+}
+
 static inline void *xnheap_zalloc(struct xnheap *heap, size_t size)
 {
 	void *p;
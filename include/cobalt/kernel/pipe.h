@@ -21,6 +21,7 @@
 
 #include <linux/types.h>
 #include <linux/poll.h>
+#include <linux/llist.h>
 #include <cobalt/kernel/synch.h>
 #include <cobalt/kernel/thread.h>
 #include <cobalt/uapi/kernel/pipe.h>
@@ -47,7 +48,10 @@
 struct xnpipe_mh {
 	size_t size;
 	size_t rdoff;
-	struct list_head link;
+	union {
+		struct list_head link;	/* Link on inq/outq */
+		struct llist_node next;	/* Link on pendq */
+	};
 };
 
 struct xnpipe_state;
@@ -69,6 +73,7 @@ struct xnpipe_state {
 	int nrinq;
 	struct list_head outq;		/* From kernel to user-space */
 	int nroutq;
+	struct llist_head pendq;	/* Lockless outq feed, LIFO */
 	struct xnsynch synchbase;
 	struct xnpipe_operations ops;
 	void *xstate;		/* Extra state managed by caller */
@@ -30,12 +30,15 @@ struct cobalt_umm {
 	void (*release)(struct cobalt_umm *umm);
 };
 
+struct rtdm_fd;
+
 struct cobalt_ppd {
 	struct cobalt_umm umm;
 	unsigned long mayday_tramp;
 	atomic_t refcnt;
 	char *exe_path;
 	struct rb_root fds;
+	struct rtdm_fd **fd_table;
 };
 
 extern struct cobalt_ppd cobalt_kernel_ppd;
@@ -32,6 +32,7 @@ struct xnpnode;
 struct xnobject {
 	void *objaddr;
 	const char *key;	  /* !< Hash key. May be NULL if anonynous. */
+	unsigned int hash;	  /* !< Hash value of the key. */
 	unsigned long cstamp;		  /* !< Creation stamp. */
 #ifdef CONFIG_XENO_OPT_VFILE
 	struct xnpnode *pnode;	/* !< v-file information class. */
@@ -79,6 +79,15 @@ enum rtdm_selecttype;
  */
 #define RTDM_FIXED_MINOR		0x0002
 
+/**
+ * If set, sendmmsg() passes MSG_BATCH to the sendmsg handler for all
+ * but the last message of a vector, so that the driver may defer the
+ * actual transmission until that last message. Should the vector be
+ * cut short, the handler is called once more with a NULL message
+ * header, asking for any deferred data to be sent.
+ */
+#define RTDM_BATCHED_SENDMSG		0x0004
+
 /** If set, the device is addressed via a clear-text name. */
 #define RTDM_NAMED_DEVICE		0x0010
 
@@ -1025,6 +1034,10 @@ typedef void (*rtdm_task_proc_t)(void *arg);
 int rtdm_task_init(rtdm_task_t *task, const char *name,
 		   rtdm_task_proc_t task_proc, void *arg,
 		   int priority, nanosecs_rel_t period);
+int rtdm_task_init_on(rtdm_task_t *task, const char *name,
+		      rtdm_task_proc_t task_proc, void *arg,
+		      int priority, nanosecs_rel_t period,
+		      const cpumask_t *affinity);
 int __rtdm_task_sleep(xnticks_t timeout, xntmode_t mode);
 void rtdm_task_busy_sleep(nanosecs_rel_t delay);
 
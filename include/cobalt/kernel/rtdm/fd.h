@@ -21,6 +21,7 @@
 #define _COBALT_KERNEL_FD_H
 
 #include <linux/types.h>
+#include <linux/atomic.h>
 #include <linux/socket.h>
 #include <linux/file.h>
 #include <cobalt/kernel/tree.h>
@@ -297,7 +298,7 @@ struct rtdm_fd {
 	unsigned int magic;
 	struct rtdm_fd_ops *ops;
 	struct cobalt_ppd *owner;
-	unsigned int refs;
+	atomic_t refs;
 	int minor;
 	int oflags;
 #ifdef CONFIG_XENO_ARCH_SYS3264
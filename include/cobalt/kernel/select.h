@@ -32,6 +32,9 @@
 #define XNSELECT_EXCEPT    2
 #define XNSELECT_MAX_TYPES 3
 
+/* Selector keeping a list of ready bindings instead of fd bitmaps. */
+#define XNSELECTOR_READYLIST  0x1
+
 struct xnselector {
 	struct xnsynch synchbase;
 	struct fds {
@@ -39,7 +42,14 @@ struct xnselector {
 		fd_set pending;
 	} fds [XNSELECT_MAX_TYPES];
 	struct list_head destroy_link;
-	struct list_head bindings; /* only used by xnselector_destroy */
+	struct list_head bindings; /* xnselector_destroy, xnselect_unbind */
+	struct list_head ready; /* pending bindings, XNSELECTOR_READYLIST */
+	unsigned int flags;
+};
+
+struct xnselect_event {
+	unsigned int index;
+	unsigned int events; /* (1 << XNSELECT_READ|WRITE|EXCEPT) */
 };
 
 #define __NFDBITS__	(8 * sizeof(unsigned long))
@@ -94,6 +104,7 @@ struct xnselect_binding {
 	unsigned int bit_index;
 	struct list_head link;  /* link in selected fds list. */
 	struct list_head slink; /* link in selector list */
+	struct list_head rlink; /* link in selector ready list */
 };
 
 void xnselect_init(struct xnselect *select_block);
@@ -130,12 +141,23 @@ void xnselect_destroy(struct xnselect *select_block);
 
 int xnselector_init(struct xnselector *selector);
 
+int xnselector_init_readylist(struct xnselector *selector);
+
 int xnselect(struct xnselector *selector,
 	     fd_set *out_fds[XNSELECT_MAX_TYPES],
 	     fd_set *in_fds[XNSELECT_MAX_TYPES],
 	     int nfds,
 	     xnticks_t timeout, xntmode_t timeout_mode);
 
+int xnselect_wait_ready(struct xnselector *selector,
+			struct xnselect_event *events, int nr,
+			xnticks_t timeout, xntmode_t timeout_mode);
+
+unsigned int xnselect_get_bound(struct xnselector *selector,
+				unsigned int index);
+
+int xnselect_unbind(struct xnselector *selector, unsigned int index);
+
 void xnselector_destroy(struct xnselector *selector);
 
 int xnselect_mount(void);
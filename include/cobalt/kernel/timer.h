@@ -26,6 +26,7 @@
 #include <cobalt/kernel/assert.h>
 #include <cobalt/kernel/ancillaries.h>
 #include <asm/xenomai/wrappers.h>
+#include <linux/rbtree.h>
 
 /**
  * @addtogroup cobalt_core_timer
@@ -133,60 +134,187 @@ static inline void xntlist_insert(struct list_head *q, struct xntlholder *holder
 		list_del(&(h)->link);		\
 	} while (0)
 
-#if defined(CONFIG_XENO_OPT_TIMER_RBTREE)
-
-#include <linux/rbtree.h>
-
-typedef struct {
+struct xntrbholder {
 	unsigned long long date;
 	unsigned prio;
 	struct rb_node link;
-} xntimerh_t;
-
-#define xntimerh_date(h) ((h)->date)
-#define xntimerh_prio(h) ((h)->prio)
-#define xntimerh_init(h) do { } while (0)
+};
 
-typedef struct {
+struct xntrbq {
 	struct rb_root root;
-	xntimerh_t *head;
-} xntimerq_t;
-
-#define xntimerq_init(q)			\
-	({					\
-		xntimerq_t *_q = (q);		\
-		_q->root = RB_ROOT;		\
-		_q->head = NULL;		\
-	})
+	struct xntrbholder *head;
+};
 
-#define xntimerq_destroy(q) do { } while (0)
-#define xntimerq_empty(q) ((q)->head == NULL)
+static inline void xntrbq_init(struct xntrbq *q)
+{
+	q->root = RB_ROOT;
+	q->head = NULL;
+}
 
-#define xntimerq_head(q) ((q)->head)
+#define xntrbq_empty(q)		((q)->head == NULL)
+#define xntrbq_head(q)		((q)->head)
 
-#define xntimerq_next(q, h)						\
-	({								\
-		struct rb_node *_node = rb_next(&(h)->link);		\
-		_node ? (container_of(_node, xntimerh_t, link)) : NULL; \
-	})
+static inline struct xntrbholder *xntrbq_next(struct xntrbq *q,
+					      struct xntrbholder *h)
+{
+	struct rb_node *node = rb_next(&h->link);
 
-#define xntimerq_second(q, h) xntimerq_next(q, h)
+	return node ? container_of(node, struct xntrbholder, link) : NULL;
+}
 
-void xntimerq_insert(xntimerq_t *q, xntimerh_t *holder);
+#define xntrbq_second(q, h)	xntrbq_next(q, h)
 
-static inline void xntimerq_remove(xntimerq_t *q, xntimerh_t *holder)
+void xntrbq_insert(struct xntrbq *q, struct xntrbholder *holder);
+
+static inline void xntrbq_remove(struct xntrbq *q, struct xntrbholder *holder)
 {
 	if (holder == q->head)
-		q->head = xntimerq_second(q, holder);
+		q->head = xntrbq_second(q, holder);
 
 	rb_erase(&holder->link, &q->root);
 }
 
+/*
+ * 4-ary implicit min-heap. Nodes live in an array, so that insertion
+ * and removal are O(log4 n) with no pointer chasing. The array is
+ * doubled from the system heap when full. Timers which still do not
+ * fit because the system heap is exhausted go to an overflow list
+ * ordered by date, which costs O(n).
+ */
+#define XNTBHEAP_ARITY		4
+#define XNTBHEAP_OVERFLOW	-1
+
+struct xntbhholder {
+	xnticks_t date;
+	int prio;
+	int pos;	/* Index in heap, or XNTBHEAP_OVERFLOW */
+	struct list_head link;
+};
+
+struct xntbheap {
+	struct xntbhholder **nodes;
+	struct xntbhholder **base;	/* Initial array, from kmalloc(). */
+	int count;
+	int capacity;
+	struct list_head overflow;
+};
+
+int xntbheap_init(struct xntbheap *q, int capacity);
+
+void xntbheap_destroy(struct xntbheap *q);
+
+void xntbheap_insert(struct xntbheap *q, struct xntbhholder *holder);
+
+void xntbheap_remove(struct xntbheap *q, struct xntbhholder *holder);
+
+static inline bool xntbheap_lt(const struct xntbhholder *left,
+			       const struct xntbhholder *right)
+{
+	return (xnsticks_t)(left->date - right->date) < 0 ||
+		(left->date == right->date && left->prio > right->prio);
+}
+
+static inline struct xntbhholder *
+xntbheap_minof(struct xntbhholder *h1, struct xntbhholder *h2)
+{
+	if (h1 == NULL)
+		return h2;
+
+	if (h2 == NULL || xntbheap_lt(h1, h2))
+		return h1;
+
+	return h2;
+}
+
+static inline struct xntbhholder *
+xntbheap_overflow_first(struct xntbheap *q)
+{
+	if (list_empty(&q->overflow))
+		return NULL;
+
+	return list_first_entry(&q->overflow, struct xntbhholder, link);
+}
+
+#define xntbheap_empty(q)	((q)->count == 0 && list_empty(&(q)->overflow))
+
+static inline struct xntbhholder *xntbheap_head(struct xntbheap *q)
+{
+	return xntbheap_minof(q->count ? q->nodes[0] : NULL,
+			      xntbheap_overflow_first(q));
+}
+
+/* @h must be the current head of @q. */
+struct xntbhholder *xntbheap_second(struct xntbheap *q,
+				    struct xntbhholder *h);
+
+/* Unordered walk, for enumeration purpose only. */
+static inline struct xntbhholder *xntbheap_it_begin(struct xntbheap *q)
+{
+	return q->count ? q->nodes[0] : xntbheap_overflow_first(q);
+}
+
+static inline struct xntbhholder *xntbheap_it_next(struct xntbheap *q,
+						   struct xntbhholder *h)
+{
+	if (h->pos != XNTBHEAP_OVERFLOW) {
+		if (h->pos + 1 < q->count)
+			return q->nodes[h->pos + 1];
+		return xntbheap_overflow_first(q);
+	}
+
+	if (list_is_last(&h->link, &q->overflow))
+		return NULL;
+
+	return list_next_entry(h, link);
+}
+
+#if defined(CONFIG_XENO_OPT_TIMER_RBTREE)
+
+typedef struct xntrbholder xntimerh_t;
+
+#define xntimerh_date(h) ((h)->date)
+#define xntimerh_prio(h) ((h)->prio)
+#define xntimerh_init(h) do { } while (0)
+
+typedef struct xntrbq xntimerq_t;
+
+#define xntimerq_init(q)	({ xntrbq_init(q); 0; })
+#define xntimerq_destroy(q)	do { } while (0)
+#define xntimerq_empty(q)	xntrbq_empty(q)
+#define xntimerq_head(q)	xntrbq_head(q)
+#define xntimerq_next(q, h)	xntrbq_next((q),(h))
+#define xntimerq_second(q, h)	xntrbq_second((q),(h))
+#define xntimerq_insert(q, h)	xntrbq_insert((q),(h))
+#define xntimerq_remove(q, h)	xntrbq_remove((q),(h))
+
 typedef struct { } xntimerq_it_t;
 
 #define xntimerq_it_begin(q,i)	((void) (i), xntimerq_head(q))
 #define xntimerq_it_next(q,i,h) ((void) (i), xntimerq_next((q),(h)))
 
+#elif defined(CONFIG_XENO_OPT_TIMER_HEAP)
+
+typedef struct xntbhholder xntimerh_t;
+
+#define xntimerh_date(h)	((h)->date)
+#define xntimerh_prio(h)	((h)->prio)
+#define xntimerh_init(h)	do { } while (0)
+
+typedef struct xntbheap xntimerq_t;
+
+#define xntimerq_init(q)	xntbheap_init((q), CONFIG_XENO_OPT_TIMER_HEAP_CAPACITY)
+#define xntimerq_destroy(q)	xntbheap_destroy(q)
+#define xntimerq_empty(q)	xntbheap_empty(q)
+#define xntimerq_head(q)	xntbheap_head(q)
+#define xntimerq_second(q, h)	xntbheap_second((q),(h))
+#define xntimerq_insert(q, h)	xntbheap_insert((q),(h))
+#define xntimerq_remove(q, h)	xntbheap_remove((q),(h))
+
+typedef struct { } xntimerq_it_t;
+
+#define xntimerq_it_begin(q,i)	((void) (i), xntbheap_it_begin(q))
+#define xntimerq_it_next(q,i,h) ((void) (i), xntbheap_it_next((q),(h)))
+
 #else /* CONFIG_XENO_OPT_TIMER_LIST */
 
 typedef struct xntlholder xntimerh_t;
@@ -197,7 +325,7 @@ typedef struct xntlholder xntimerh_t;
 
 typedef struct list_head xntimerq_t;
 
-#define xntimerq_init(q)        xntlist_init(q)
+#define xntimerq_init(q)        ({ xntlist_init(q); 0; })
 #define xntimerq_destroy(q)     do { } while (0)
 #define xntimerq_empty(q)       xntlist_empty(q)
 #define xntimerq_head(q)        xntlist_head(q)
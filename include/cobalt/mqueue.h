@@ -21,6 +21,8 @@
 #ifndef _COBALT_MQUEUE_H
 #define _COBALT_MQUEUE_H
 
+#include <boilerplate/atomic.h>
+#include <cobalt/uapi/mqueue.h>
 #include <cobalt/wrappers.h>
 
 #ifdef __cplusplus
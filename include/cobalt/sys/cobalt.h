@@ -37,6 +37,8 @@
 #include <cobalt/uapi/thread.h>
 #include <cobalt/uapi/cond.h>
 #include <cobalt/uapi/sem.h>
+#include <cobalt/uapi/poll.h>
+#include <cobalt/uapi/mqueue.h>
 #include <cobalt/ticks.h>
 
 #define cobalt_commit_memory(p) __cobalt_commit_memory(p, sizeof(*p))
@@ -127,6 +129,13 @@ int cobalt_event_destroy(cobalt_event_t *event);
 int cobalt_sem_inquire(sem_t *sem, struct cobalt_sem_info *info,
 		       pid_t *waitlist, size_t waitsz);
 
+int cobalt_poll_create(int flags);
+
+int cobalt_poll_ctl(int pfd, int op, int fd, unsigned int events);
+
+int cobalt_poll_wait(int pfd, struct cobalt_poll_event *events,
+		     int maxevents, const struct timespec *timeout);
+
 int cobalt_sched_weighted_prio(int policy,
 			       const struct sched_param_ex *param_ex);
 
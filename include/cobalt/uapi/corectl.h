@@ -61,6 +61,7 @@
 #   define _CC_COBALT_NET_CFG		0x00000400
 #   define _CC_COBALT_NET_CAP		0x00000800
 #   define _CC_COBALT_NET_PROXY		0x00001000
+#   define _CC_COBALT_NET_TCP		0x00002000
 
 
 enum cobalt_run_states {
@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_MQUEUE_H
+#define _COBALT_UAPI_MQUEUE_H
+
+#include <cobalt/uapi/kernel/types.h>
+
+/*
+ * Creation flag (mq_attr.mq_flags) selecting the shared memory
+ * mode: the message ring and the waiter counts live in the Cobalt
+ * shared heap.
+ */
+#define MQ_SHMEM		0x40000000
+
+/* Upper bound (excluded) of message priorities. */
+#define COBALT_MSGPRIOMAX	32768
+
+/* Wait/wake directions. */
+#define COBALT_MQ_SHM_SEND	0
+#define COBALT_MQ_SHM_RECV	1
+
+/* Kernel-side watchers, forcing wake calls from the fast path. */
+#define COBALT_MQ_SHM_SELECT	0x1
+#define COBALT_MQ_SHM_NOTIFY	0x2
+
+/* Slot claimed by a sender which failed to fill it. */
+#define COBALT_MQ_SLOT_VOID	0x1
+
+struct cobalt_mq_slot {
+	atomic_t seq;
+	__u32 len;
+	__u32 prio;
+	__u32 flags;
+	/* Message data follows. */
+};
+
+/*
+ * Bounded MPMC ring: a sender owns slot (pos % nrslots) when its
+ * sequence equals pos, a receiver when it equals pos + 1.
+ */
+struct cobalt_mq_state {
+	__u32 nrslots;		/* Power of two. */
+	__u32 msgsize;
+	__u32 slotsize;
+	__u32 watch;
+	__u32 swaiters;
+	__u32 rwaiters;
+	__u32 __pad0[10];
+	atomic_t enqueue;
+	__u32 __pad1[15];
+	atomic_t dequeue;
+	__u32 __pad2[15];
+	/* nrslots slots follow. */
+};
+
+static inline struct cobalt_mq_slot *
+cobalt_mq_get_slot(struct cobalt_mq_state *state, __u32 pos)
+{
+	return (struct cobalt_mq_slot *)((char *)(state + 1) +
+		(pos & (state->nrslots - 1)) * state->slotsize);
+}
+
+#endif /* !_COBALT_UAPI_MQUEUE_H */
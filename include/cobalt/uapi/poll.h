@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+#ifndef _COBALT_UAPI_POLL_H
+#define _COBALT_UAPI_POLL_H
+
+#include <cobalt/uapi/kernel/types.h>
+
+/* Event bits, matching (1 << XNSELECT_READ|WRITE|EXCEPT). */
+#define COBALT_POLLIN		0x1
+#define COBALT_POLLOUT		0x2
+#define COBALT_POLLPRI		0x4
+
+/* Interest set control operations. */
+#define COBALT_POLL_CTL_ADD	1
+#define COBALT_POLL_CTL_DEL	2
+#define COBALT_POLL_CTL_MOD	3
+
+/* Max. number of events returned by a single wait call. */
+#define COBALT_POLL_BATCH	32
+
+struct cobalt_poll_event {
+	__s32 fd;
+	__u32 events;
+};
+
+#endif /* !_COBALT_UAPI_POLL_H */
@@ -121,6 +121,12 @@
 #define sc_cobalt_recvmmsg			98
 #define sc_cobalt_sendmmsg			99
 #define sc_cobalt_clock_adjtime			100
+#define sc_cobalt_poll_create			101
+#define sc_cobalt_poll_ctl			102
+#define sc_cobalt_poll_wait			103
+#define sc_cobalt_mq_shm_map			104
+#define sc_cobalt_mq_shm_wait			105
+#define sc_cobalt_mq_shm_wake			106
 
 #define __NR_COBALT_SYSCALLS			128 /* Power of 2 */
 
@@ -145,11 +145,7 @@ static inline char *pvstrdup(const char *ptr)
 
 extern struct heap_memory heapmem_main;
 
-static inline
-void pvheapobj_destroy(struct heapobj *hobj)
-{
-	heapmem_destroy((struct heap_memory *)hobj->pool);
-}
+void pvheapobj_destroy(struct heapobj *hobj);
 
 static inline
 int pvheapobj_extend(struct heapobj *hobj, size_t size, void *mem)
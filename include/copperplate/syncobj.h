@@ -54,7 +54,15 @@ struct syncobj_corespec {
 
 #else  /* CONFIG_XENO_MERCURY */
 
+#include <boilerplate/atomic.h>
+
 struct syncobj_corespec {
+	/* Futex-based monitor, unless condvar_monitor was set. */
+	int futex;
+	atomic_t gate;
+	clockid_t clock_id;
+	struct listobj wake_list;
+	/* Condvar-based monitor. */
 	pthread_mutex_t lock;
 	pthread_cond_t drain_sync;
 };
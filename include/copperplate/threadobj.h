@@ -100,9 +100,16 @@ threadobj_get_window(struct threadobj_corespec *corespec)
 #else  /* CONFIG_XENO_MERCURY */
 
 #include <sys/time.h>
+#include <boilerplate/atomic.h>
+
+struct syncobj;
 
 struct threadobj_corespec {
 	pthread_cond_t grant_sync;
+	/** Futex wait word and TID, object of a pending monitor wait. */
+	atomic_t monitor_word;
+	struct syncobj *monitor_sobj;
+	int monitor_tid;
 	int policy_unlocked;
 	struct sched_param_ex schedparam_unlocked;
 	timer_t rr_timer;
@@ -24,12 +24,16 @@
 #include <boilerplate/list.h>
 #include <boilerplate/lock.h>
 
+struct timerobj_server;
+
 struct timerobj {
 	struct itimerspec itspec;
 	void (*handler)(struct timerobj *tmobj);
 	timer_t timer;
 	pthread_mutex_t lock;
 	int cancel_state;
+	struct timerobj_server *server;
+	int wheel_pos;
 	struct pvholder next;
 };
 
@@ -27,7 +27,12 @@ struct copperplate_setup_data {
 	int no_registry;
 	int shared_registry;
 	size_t mem_pool;
+	size_t mem_pool_limit;
+	const char *mem_pool_hugepages;
+	int mem_pool_cache;
 	gid_t session_gid;
+	int timer_servers;
+	int condvar_monitor;
 };
 
 #ifdef __cplusplus
@@ -83,6 +88,36 @@ static inline read_config_tunable(mem_pool_size, size_t)
 	return __copperplate_setup_data.mem_pool;
 }
 
+static inline define_config_tunable(mem_pool_limit, size_t, size)
+{
+	__copperplate_setup_data.mem_pool_limit = size;
+}
+
+static inline read_config_tunable(mem_pool_limit, size_t)
+{
+	return __copperplate_setup_data.mem_pool_limit;
+}
+
+static inline define_config_tunable(mem_pool_hugepages, const char *, root)
+{
+	__copperplate_setup_data.mem_pool_hugepages = root;
+}
+
+static inline read_config_tunable(mem_pool_hugepages, const char *)
+{
+	return __copperplate_setup_data.mem_pool_hugepages;
+}
+
+static inline define_config_tunable(mem_pool_cache, int, depth)
+{
+	__copperplate_setup_data.mem_pool_cache = depth;
+}
+
+static inline read_config_tunable(mem_pool_cache, int)
+{
+	return __copperplate_setup_data.mem_pool_cache;
+}
+
 static inline define_config_tunable(session_gid, gid_t, gid)
 {
 	__copperplate_setup_data.session_gid = gid;
@@ -93,6 +128,26 @@ static inline read_config_tunable(session_gid, gid_t)
 	return __copperplate_setup_data.session_gid;
 }
 
+static inline define_config_tunable(timer_servers, int, nr)
+{
+	__copperplate_setup_data.timer_servers = nr;
+}
+
+static inline read_config_tunable(timer_servers, int)
+{
+	return __copperplate_setup_data.timer_servers;
+}
+
+static inline define_runtime_tunable(condvar_monitor, int, on)
+{
+	__copperplate_setup_data.condvar_monitor = on;
+}
+
+static inline read_runtime_tunable(condvar_monitor, int)
+{
+	return __copperplate_setup_data.condvar_monitor;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -23,4 +23,135 @@
 #include <rtdm/rtdm.h>
 #include <rtdm/uapi/ipc.h>
 
+/*
+ * Helpers for accessing a mapped BUFP ring (see BUFP_SHMEM). The
+ * producer reserves room for a record in the peer ring mapped at
+ * BUFP_RING_TX_PGOFF, fills it in place then commits it. The consumer
+ * peeks at the next record in its own ring mapped at
+ * BUFP_RING_RX_PGOFF, then releases it once done. None of these
+ * calls enters the kernel unless a thread waits on the other side.
+ */
+
+static inline char *bufp_ring_data(struct bufp_ring *ring)
+{
+	return (char *)ring + ring->data_offset;
+}
+
+static inline __u32 bufp_ring_read_index(const __u32 *p)
+{
+	return *(volatile const __u32 *)p;
+}
+
+static inline int bufp_ring_publish(int fd, struct bufp_ring *ring,
+				    __u32 *index, __u32 value, __u32 waitbit)
+{
+	/* Complete our accesses to the record before moving on. */
+	__sync_synchronize();
+	*(volatile __u32 *)index = value;
+	/* Pairs with the barrier the kernel issues before sleeping. */
+	__sync_synchronize();
+	if (bufp_ring_read_index(&ring->flags) & waitbit)
+		return __RT(ioctl(fd, BUFP_RTIOC_NOTIFY));
+
+	return 0;
+}
+
+/*
+ * Return a pointer to @len bytes of payload space at the head of the
+ * ring, or NULL with errno set to EAGAIN if the ring is too full
+ * (BUFP_RTIOC_WAITOUT may be used to wait for room), or EINVAL if
+ * such a record could never fit.
+ */
+static inline void *bufp_ring_reserve(struct bufp_ring *ring, size_t len)
+{
+	__u32 head = ring->head, mask = ring->size - 1, recsz, room, used;
+	struct bufp_ring_rec *rec;
+
+	if (len > ring->size / 2 - sizeof(*rec)) {
+		errno = EINVAL;
+		return NULL;
+	}
+
+	recsz = BUFP_RING_RECSZ(len);
+	room = ring->size - (head & mask);
+	used = head - bufp_ring_read_index(&ring->tail);
+	if (ring->size - used < (room < recsz ? room + recsz : recsz)) {
+		errno = EAGAIN;
+		return NULL;
+	}
+
+	/* Records may not wrap, pad the end of the data area if need be. */
+	if (room < recsz) {
+		rec = (struct bufp_ring_rec *)(bufp_ring_data(ring) + (head & mask));
+		rec->len = room - sizeof(*rec);
+		rec->flags = BUFP_RING_PAD;
+		head += room;
+	}
+
+	rec = (struct bufp_ring_rec *)(bufp_ring_data(ring) + (head & mask));
+	rec->flags = 0;
+
+	return rec + 1;
+}
+
+/*
+ * Make the record reserved at @buf visible to the consumer, with a
+ * payload of @len bytes, no more than what was reserved.
+ */
+static inline int bufp_ring_commit(int fd, struct bufp_ring *ring,
+				   void *buf, size_t len)
+{
+	struct bufp_ring_rec *rec = (struct bufp_ring_rec *)buf - 1;
+	__u32 head = ring->head, mask = ring->size - 1, off;
+
+	/* Account for the padding bufp_ring_reserve() may have added. */
+	off = (char *)rec - bufp_ring_data(ring);
+	head += (off - head) & mask;
+	rec->len = len;
+
+	return bufp_ring_publish(fd, ring, &ring->head,
+				 head + BUFP_RING_RECSZ(len),
+				 BUFP_RING_RXWAIT);
+}
+
+/*
+ * Return a pointer to the payload of the next record in the ring,
+ * storing its length at @lenp, or NULL with errno set to EAGAIN if
+ * the ring is empty (BUFP_RTIOC_WAITIN may be used to wait for data).
+ */
+static inline void *bufp_ring_peek(struct bufp_ring *ring, size_t *lenp)
+{
+	__u32 tail = ring->tail, mask = ring->size - 1;
+	struct bufp_ring_rec *rec;
+
+	while (bufp_ring_read_index(&ring->head) != tail) {
+		/* Read the producer index before the record. */
+		__sync_synchronize();
+		rec = (struct bufp_ring_rec *)(bufp_ring_data(ring) + (tail & mask));
+		if ((rec->flags & BUFP_RING_PAD) == 0) {
+			*lenp = rec->len;
+			return rec + 1;
+		}
+		tail += ring->size - (tail & mask);
+		*(volatile __u32 *)&ring->tail = tail;
+	}
+
+	errno = EAGAIN;
+
+	return NULL;
+}
+
+/*
+ * Give the space of the record peeked at @buf back to the producer.
+ */
+static inline int bufp_ring_release(int fd, struct bufp_ring *ring,
+				    const void *buf)
+{
+	const struct bufp_ring_rec *rec = (const struct bufp_ring_rec *)buf - 1;
+
+	return bufp_ring_publish(fd, ring, &ring->tail,
+				 ring->tail + BUFP_RING_RECSZ(rec->len),
+				 BUFP_RING_TXWAIT);
+}
+
 #endif /* !_RTDM_IPC_H */
@@ -484,6 +484,98 @@ struct sockaddr_ipc {
 	rtipc_port_t sipc_port;
 };
 
+/**
+ * Shared ring header of a BUFP socket.
+ *
+ * A BUFP socket configured with @ref BUFP_SHMEM buffers incoming data
+ * into a ring which both the owner and its peers may map into their
+ * address space (see @ref bufp_ring_mapping "BUFP ring mapping"). The
+ * mapping starts with this header, followed by the data area at @a
+ * data_offset bytes.
+ *
+ * The data area holds a sequence of records in strict FIFO order,
+ * each starting with a struct bufp_ring_rec header aligned on
+ * BUFP_RING_ALIGN bytes. Records never wrap around the end of the
+ * data area: a producer which cannot fit a record in the remaining
+ * space first fills it with a padding record (BUFP_RING_PAD), then
+ * stores the record at the beginning of the data area.
+ *
+ * The producer owns @a head, the consumer owns @a tail. Both indices
+ * are free-running byte counts, the offset of a record in the data
+ * area is (index & (size - 1)). There may be at most one producer and
+ * one consumer at any point in time on a given ring, either accessing
+ * the mapping directly, or going through the regular socket calls.
+ *
+ * The @a flags word is maintained by the kernel only. After moving
+ * its index, a thread accessing the ring directly must issue a full
+ * memory barrier, then call @ref BUFP_RTIOC_NOTIFY if BUFP_RING_RXWAIT
+ * (producer) or BUFP_RING_TXWAIT (consumer) is set, so that waiters
+ * get to know about the update.
+ */
+struct bufp_ring {
+	/** Size of the data area in bytes, a power of two. */
+	__u32 size;
+	/** Offset of the data area from the start of the mapping. */
+	__u32 data_offset;
+	/** Kernel-maintained wait flags. */
+	__u32 flags;
+	__u32 __pad0[13];
+	/** Producer index. */
+	__u32 head;
+	__u32 __pad1[15];
+	/** Consumer index. */
+	__u32 tail;
+	__u32 __pad2[15];
+};
+
+/**
+ * Record header in a BUFP ring.
+ */
+struct bufp_ring_rec {
+	/** Length of the payload following this header. */
+	__u32 len;
+	/** Record flags, BUFP_RING_PAD denotes a padding record. */
+	__u32 flags;
+};
+
+/** Alignment of records in the data area of a BUFP ring. */
+#define BUFP_RING_ALIGN		8
+/** Space occupied by a record conveying @a __len bytes. */
+#define BUFP_RING_RECSZ(__len)						\
+	(((__len) + sizeof(struct bufp_ring_rec) + BUFP_RING_ALIGN - 1)	\
+	 & ~(BUFP_RING_ALIGN - 1))
+
+/** Record flag: padding up to the end of the data area. */
+#define BUFP_RING_PAD		0x1
+
+/** Ring flag: the consumer is waiting for data. */
+#define BUFP_RING_RXWAIT	0x1
+/** Ring flag: a producer is waiting for space. */
+#define BUFP_RING_TXWAIT	0x2
+
+/**
+ * @anchor bufp_ring_mapping @name BUFP ring mapping
+ *
+ * The mmap() offset selects which ring is mapped, in units of the
+ * page size. BUFP_RING_RX_PGOFF maps the ring of the socket itself
+ * (consumer side), BUFP_RING_TX_PGOFF maps the ring of the socket it
+ * is connected to (producer side). The length of the mapping must
+ * not exceed the value reported by @ref BUFP_RINGSZ.
+ * @{ */
+#define BUFP_RING_RX_PGOFF	0
+#define BUFP_RING_TX_PGOFF	1
+/** @} */
+
+/**
+ * Mapping sizes of BUFP rings.
+ */
+struct bufp_ringsz {
+	/** Length of the receive ring mapping, zero if none. */
+	__u32 rx;
+	/** Length of the peer ring mapping, zero if none. */
+	__u32 tx;
+};
+
 #define SOL_XDDP		311
 /**
  * @anchor sockopts_xddp @name XDDP socket options
@@ -834,6 +926,120 @@ struct sockaddr_ipc {
  * RT/non-RT
  */
 #define BUFP_BUFSZ		2
+/**
+ * BUFP shared memory mode
+ *
+ * When enabled, the buffer of the socket is laid out as a ring of
+ * records which userland may map (see struct bufp_ring), so that
+ * data can be produced and consumed in place, without any system
+ * call as long as no thread has to wait on the ring.
+ *
+ * In this mode, each message sent is stored as a separate record,
+ * and each read operation returns at most one record, truncated to
+ * the length of the receive buffer. A record, header included, may
+ * not exceed half the size of the ring, which is the buffer size
+ * rounded up to the next power of two.
+ *
+ * This option must be set prior to binding the socket.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_SHMEM
+ * @param [in] optval Pointer to a variable of type int, non-zero to
+ * enable the shared memory mode
+ * @param [in] optlen sizeof(int)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EALREADY (socket already bound)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_SHMEM		3
+/**
+ * BUFP ring sizes
+ *
+ * Retrieve the length of the mappings available from a BUFP socket,
+ * for its own ring and for the ring of the peer it is connected
+ * to. This option can only be read.
+ *
+ * @param [in] level @ref sockopts_bufp "SOL_BUFP"
+ * @param [in] optname @b BUFP_RINGSZ
+ * @param [out] optval Pointer to struct bufp_ringsz
+ * @param [in] optlen sizeof(struct bufp_ringsz)
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (@a optlen is invalid)
+ * .
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_RINGSZ		4
+/** @} */
+
+#define RTIOC_TYPE_IPC		RTDM_CLASS_RTIPC
+
+/**
+ * @anchor bufp_ioctls @name BUFP ring requests
+ * Synchronizing on BUFP rings accessed in shared memory mode.
+ * @{ */
+/**
+ * Wait for the ring of the socket to hold at least one record.
+ *
+ * The SO_RCVTIMEO setting applies.
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -ENODEV (not in shared memory mode)
+ * - -ETIMEDOUT, -EINTR, -EIDRM
+ * .
+ *
+ * @par Calling context:
+ * RT
+ */
+#define BUFP_RTIOC_WAITIN	_IO(RTIOC_TYPE_IPC, 0x00)
+/**
+ * Wait for the ring of the connected peer to have room for a
+ * message of the given length.
+ *
+ * The SO_SNDTIMEO setting applies.
+ *
+ * @param [in] arg Pointer to a variable of type __u32, containing
+ * the length of the message to send
+ *
+ * @return 0 is returned upon success. Otherwise:
+ *
+ * - -EFAULT (Invalid data address given)
+ * - -EINVAL (message too large for the ring)
+ * - -EDESTADDRREQ (socket not connected)
+ * - -ECONNRESET, -ECONNREFUSED (no peer bound to the destination)
+ * - -ENODEV (peer not in shared memory mode)
+ * - -ETIMEDOUT, -EINTR, -EIDRM
+ * .
+ *
+ * @par Calling context:
+ * RT
+ */
+#define BUFP_RTIOC_WAITOUT	_IOW(RTIOC_TYPE_IPC, 0x01, __u32)
+/**
+ * Notify waiters about an update of the ring indices.
+ *
+ * Wake up the producers waiting on the ring of the socket if some
+ * space is available, and the consumer waiting on the ring of the
+ * connected peer if some data is available.
+ *
+ * @return 0 is returned upon success.
+ *
+ * @par Calling context:
+ * RT/non-RT
+ */
+#define BUFP_RTIOC_NOTIFY	_IO(RTIOC_TYPE_IPC, 0x02)
 /** @} */
 
 /**
@@ -57,6 +57,20 @@
 #define RTNET_RTIOC_EXTPOOL     _IOW(RTIOC_TYPE_NETWORK, 0x14, unsigned int)
 #define RTNET_RTIOC_SHRPOOL     _IOW(RTIOC_TYPE_NETWORK, 0x15, unsigned int)
 
+/* Memory-mapped frame rings of packet sockets, see below. */
+#define RTNET_RTIOC_PACKET_RING _IOW(RTIOC_TYPE_NETWORK, 0x16, \
+				     struct rtnet_packet_ring_req)
+#define RTNET_RTIOC_PACKET_KICK _IO(RTIOC_TYPE_NETWORK, 0x17)
+#define RTNET_RTIOC_PACKET_WAIT _IOW(RTIOC_TYPE_NETWORK, 0x18, unsigned int)
+
+/* TCP connection tuning and statistics, see below. */
+#define RTNET_RTIOC_TCP_SETPARAMS _IOW(RTIOC_TYPE_NETWORK, 0x19, \
+				       struct rtnet_tcp_params)
+#define RTNET_RTIOC_TCP_GETPARAMS _IOR(RTIOC_TYPE_NETWORK, 0x1a, \
+				       struct rtnet_tcp_params)
+#define RTNET_RTIOC_TCP_INFO    _IOR(RTIOC_TYPE_NETWORK, 0x1b, \
+				     struct rtnet_tcp_info)
+
 /* socket transmission priorities */
 #define SOCK_MAX_PRIO           0
 #define SOCK_DEF_PRIO           SOCK_MAX_PRIO + \
@@ -72,4 +86,127 @@
 /* argument construction for RTNET_RTIOC_XMITPARAMS */
 #define SOCK_XMIT_PARAMS(priority, channel) ((priority) | ((channel) << 16))
 
+/*
+ * Packet socket frame rings
+ *
+ * RTNET_RTIOC_PACKET_RING attaches rx_frames receive slots followed by
+ * tx_frames transmit slots of frame_size bytes each to a packet socket.
+ * The slots are mapped by calling mmap() on the socket at offset 0, slot
+ * n of the receive ring is found at n * frame_size from the start of the
+ * mapping, slot n of the transmit ring at (rx_frames + n) * frame_size.
+ * Each slot starts with a struct rtnet_packet_hdr, the frame data follow
+ * at RTPACKET_HDRLEN. Raw sockets see and provide the link-layer header
+ * as part of the frame data, datagram sockets do not.
+ *
+ * Slots are handed over between the kernel and userland through their
+ * status word, each side walking its ring in order:
+ *
+ * - receive slots belong to the kernel while RTPACKET_STATUS_KERNEL. The
+ *   kernel fills the next slot with an incoming frame, then sets
+ *   RTPACKET_STATUS_USER. Userland hands the slot back by resetting the
+ *   status to RTPACKET_STATUS_KERNEL once done. Frames arriving while the
+ *   next slot is still owned by userland are dropped, which is reported
+ *   by RTPACKET_STATUS_LOSING on the next frame received.
+ *   RTNET_RTIOC_PACKET_WAIT blocks until the given slot is handed to
+ *   userland, honoring the timeout set by RTNET_RTIOC_TIMEOUT.
+ *
+ * - transmit slots belong to userland while RTPACKET_TX_AVAILABLE.
+ *   Userland fills in the frame data and len, then sets
+ *   RTPACKET_TX_SEND_REQUEST. RTNET_RTIOC_PACKET_KICK sends all
+ *   requested slots in order over the interface the socket is bound to,
+ *   returning each of them to RTPACKET_TX_AVAILABLE, or marking it
+ *   RTPACKET_TX_WRONG_FORMAT if it could not be sent as is. It returns
+ *   the number of frames sent. Datagram sockets take the destination
+ *   from addr and halen, and the protocol from protocol if non-zero.
+ *
+ * Memory barriers are required on the userland side between writing the
+ * contents of a slot and its status word, and conversely.
+ */
+struct rtnet_packet_ring_req {
+    unsigned int        frame_size;     /* multiple of RTPACKET_ALIGN */
+    unsigned int        rx_frames;
+    unsigned int        tx_frames;
+};
+
+struct rtnet_packet_hdr {
+    unsigned int        status;
+    unsigned int        len;            /* original length of the frame */
+    unsigned int        snaplen;        /* bytes stored in the slot */
+    unsigned short      protocol;       /* network byte order */
+    unsigned short      __pad0;
+    uint64_t            tstamp;         /* arrival time (ns) */
+    int                 ifindex;
+    unsigned char       pkttype;
+    unsigned char       halen;
+    unsigned char       addr[8];        /* source (rx), destination (tx) */
+    unsigned char       __pad1[2];
+};
+
+#define RTPACKET_ALIGN          16
+#define RTPACKET_HDRLEN         ((sizeof(struct rtnet_packet_hdr) + \
+				  RTPACKET_ALIGN - 1) & ~(RTPACKET_ALIGN - 1))
+#define RTPACKET_FRAME_MAX      16384
+#define RTPACKET_RING_MAX       4096    /* slots per direction */
+
+/* receive slot status */
+#define RTPACKET_STATUS_KERNEL  0x0
+#define RTPACKET_STATUS_USER    0x1
+#define RTPACKET_STATUS_TRUNC   0x2
+#define RTPACKET_STATUS_LOSING  0x4
+
+/* transmit slot status */
+#define RTPACKET_TX_AVAILABLE   0x0
+#define RTPACKET_TX_SEND_REQUEST 0x1
+#define RTPACKET_TX_SENDING     0x2
+#define RTPACKET_TX_WRONG_FORMAT 0x4
+
+/*
+ * TCP socket parameters
+ *
+ * The options and the receive window are negotiated during the
+ * three-way handshake, so changing them only affects connections
+ * established afterwards. All other parameters apply immediately.
+ *
+ * With RTNET_TCP_RTT_RTO set, the retransmission timeout is computed from
+ * the measured round-trip time as defined by RFC 6298, starting from
+ * rto_initial and staying within [rto_min, rto_max]. Otherwise, it is
+ * fixed to rto_initial. It doubles after each timeout in both cases, up
+ * to rto_max, the connection being dropped after max_retransmits of them.
+ * A dupack_thresh of zero disables fast retransmission.
+ */
+struct rtnet_tcp_params {
+    unsigned int        flags;
+    unsigned int        rcv_window;     /* bytes */
+    unsigned int        dupack_thresh;
+    unsigned int        max_retransmits;
+    uint64_t            rto_initial;    /* ns */
+    uint64_t            rto_min;        /* ns */
+    uint64_t            rto_max;        /* ns */
+};
+
+#define RTNET_TCP_SACK          0x1     /* selective acknowledgments */
+#define RTNET_TCP_WSCALE        0x2     /* window scaling */
+#define RTNET_TCP_RTT_RTO       0x4     /* adaptive retransmission timeout */
+
+struct rtnet_tcp_info {
+    unsigned int        state;
+    unsigned int        options;        /* RTNET_TCP_SACK|WSCALE if agreed */
+    unsigned int        mss;
+    unsigned char       snd_wscale;
+    unsigned char       rcv_wscale;
+    unsigned short      __pad0;
+    unsigned int        snd_window;     /* bytes the peer accepts */
+    unsigned int        rcv_window;     /* bytes we accept */
+    unsigned int        unacked;        /* segments in flight */
+    unsigned int        __pad1;
+    uint64_t            srtt;           /* ns */
+    uint64_t            rttvar;         /* ns */
+    uint64_t            rto;            /* ns */
+    uint64_t            retransmits;    /* segments sent again */
+    uint64_t            fast_retransmits; /* of which before a timeout */
+    uint64_t            timeouts;
+    uint64_t            dup_acks;       /* received */
+    uint64_t            ooo_segments;   /* received out of order */
+};
+
 #endif  /* !_RTDM_UAPI_NET_H */
@@ -118,6 +118,35 @@ struct rttst_heap_stathdr {
 	struct rttst_heap_stats *buf;
 };
 
+struct rttst_heap_cache_bench {
+	__u64 heap_size;
+	__u32 obj_size;
+	int nrobjs;
+	int loops;
+	/* Go through an object cache instead of the bare heap. */
+	int use_cache;
+	__s64 alloc_avg_ns;
+	__s64 alloc_max_ns;
+	__s64 free_avg_ns;
+	__s64 free_max_ns;
+};
+
+#define RTTST_TIMERQ_LIST	0
+#define RTTST_TIMERQ_RBTREE	1
+#define RTTST_TIMERQ_HEAP	2
+
+struct rttst_timerq_bench {
+	int backend;
+	int nrtimers;
+	int loops;
+	__s64 insert_avg_ns;
+	__s64 insert_max_ns;
+	__s64 remove_avg_ns;
+	__s64 remove_max_ns;
+	__s64 expire_avg_ns;
+	__s64 expire_max_ns;
+};
+
 #define RTIOC_TYPE_TESTING		RTDM_CLASS_TESTING
 
 /*!
@@ -133,6 +162,8 @@ struct rttst_heap_stathdr {
 #define RTDM_SUBCLASS_RTDMTEST		3
 /** subclase name: "heapcheck" */
 #define RTDM_SUBCLASS_HEAPCHECK		4
+/** subclase name: "timerqbench" */
+#define RTDM_SUBCLASS_TIMERQBENCH	5
 /** @} */
 
 /*!
@@ -148,6 +179,9 @@ struct rttst_heap_stathdr {
 #define RTTST_RTIOC_TMBENCH_STOP \
 	_IOWR(RTIOC_TYPE_TESTING, 0x11, struct rttst_overall_bench_res)
 
+#define RTTST_RTIOC_TMBENCH_SET_CPU \
+	_IOW(RTIOC_TYPE_TESTING, 0x12, __u32)
+
 #define RTTST_RTIOC_SWTEST_SET_TASKS_COUNT \
 	_IOW(RTIOC_TYPE_TESTING, 0x30, __u32)
 
@@ -193,6 +227,12 @@ struct rttst_heap_stathdr {
 #define RTTST_RTIOC_HEAP_STAT_COLLECT \
 	_IOR(RTIOC_TYPE_TESTING, 0x45, int)
 
+#define RTTST_RTIOC_TIMERQ_BENCH \
+	_IOWR(RTIOC_TYPE_TESTING, 0x46, struct rttst_timerq_bench)
+
+#define RTTST_RTIOC_HEAP_CACHE_BENCH \
+	_IOWR(RTIOC_TYPE_TESTING, 0x47, struct rttst_heap_cache_bench)
+
 /** @} */
 
 #endif /* !_RTDM_UAPI_TESTING_H */
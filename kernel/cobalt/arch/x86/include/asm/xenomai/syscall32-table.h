@@ -44,6 +44,7 @@ __COBALT_CALL32emu_THUNK(mq_timedsend)
 __COBALT_CALL32emu_THUNK(mq_timedreceive)
 __COBALT_CALL32x_pure_THUNK(mq_timedreceive)
 __COBALT_CALL32emu_THUNK(mq_notify)
+__COBALT_CALL32emu_THUNK(mq_shm_wait)
 __COBALT_CALL32x_THUNK(mq_notify)
 __COBALT_CALL32emu_THUNK(sched_weightprio)
 __COBALT_CALL32emu_THUNK(sched_setconfig_np)
@@ -70,6 +71,7 @@ __COBALT_CALL32emu_THUNK(monitor_wait)
 __COBALT_CALL32emu_THUNK(event_wait)
 __COBALT_CALL32emu_THUNK(select)
 __COBALT_CALL32x_THUNK(select)
+__COBALT_CALL32emu_THUNK(poll_wait)
 __COBALT_CALL32emu_THUNK(recvmsg)
 __COBALT_CALL32x_THUNK(recvmsg)
 __COBALT_CALL32emu_THUNK(sendmsg)
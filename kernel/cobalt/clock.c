@@ -646,7 +646,7 @@ static inline void cleanup_clock_proc(struct xnclock *clock) { }
 int xnclock_register(struct xnclock *clock, const cpumask_t *affinity)
 {
 	struct xntimerdata *tmd;
-	int cpu;
+	int cpu, n, ret;
 
 	secondary_mode_only();
 
@@ -679,7 +679,9 @@ int xnclock_register(struct xnclock *clock, const cpumask_t *affinity)
 	 */
 	for_each_online_cpu(cpu) {
 		tmd = xnclock_percpu_timerdata(clock, cpu);
-		xntimerq_init(&tmd->q);
+		ret = xntimerq_init(&tmd->q);
+		if (ret)
+			goto fail;
 	}
 
 #ifdef CONFIG_XENO_OPT_STATS
@@ -689,6 +691,18 @@ int xnclock_register(struct xnclock *clock, const cpumask_t *affinity)
 	init_clock_proc(clock);
 
 	return 0;
+fail:
+	for_each_online_cpu(n) {
+		if (n == cpu)
+			break;
+		tmd = xnclock_percpu_timerdata(clock, n);
+		xntimerq_destroy(&tmd->q);
+	}
+
+	free_percpu(clock->timerdata);
+	clock->timerdata = NULL;
+
+	return ret;
 }
 EXPORT_SYMBOL_GPL(xnclock_register);
 
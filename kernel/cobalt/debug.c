@@ -551,6 +551,303 @@ static inline void init_thread_relax_trace(struct xnthread *thread)
 
 #ifdef CONFIG_XENO_OPT_DEBUG_LOCKING
 
+#ifdef CONFIG_XENO_OPT_DEBUG_LOCKSTAT
+
+#define LOCKSTAT_HSLOTS		(1 << 8)
+#define LOCKSTAT_PROBES		8
+
+/*
+ * Statistics about a lock acquisition site on a given CPU. Only the
+ * CPU owning the site table updates it, readers use the sequence
+ * counter to fetch consistent copies.
+ */
+struct lockstat_site {
+	struct xnlock *lock;
+	const char *file;
+	const char *function;
+	int line;
+	unsigned int seq;
+	unsigned long count;
+	unsigned long long spin_time;
+	unsigned long long spin_max;
+	unsigned long long lock_time;
+	unsigned long long lock_max;
+};
+
+struct lockstat_table {
+	unsigned long gen;
+	/* The extra slot collects the sites we could not index. */
+	struct lockstat_site sites[LOCKSTAT_HSLOTS + 1];
+};
+
+static struct lockstat_table __percpu *lockstat_tables;
+
+/* Bumping the generation count resets all tables lazily. */
+static unsigned long lockstat_gen;
+
+static void lockstat_reset(struct lockstat_table *t, unsigned long gen)
+{
+	struct lockstat_site *untracked = t->sites + LOCKSTAT_HSLOTS;
+
+	memset(t->sites, 0, sizeof(t->sites));
+	untracked->function = "-";
+	untracked->file = "(untracked)";
+	t->gen = gen;
+}
+
+static struct lockstat_site *
+lockstat_lookup(struct lockstat_table *t, struct xnlock *lock,
+		const char *file, int line, const char *function)
+{
+	struct lockstat_site *site;
+	unsigned int h, n;
+
+	h = jhash_3words((u32)(unsigned long)lock,
+			 (u32)(unsigned long)file, line, 0);
+
+	for (n = 0; n < LOCKSTAT_PROBES; n++, h++) {
+		site = t->sites + (h & (LOCKSTAT_HSLOTS - 1));
+		if (site->file == NULL) {
+			site->lock = lock;
+			site->function = function;
+			site->line = line;
+			smp_wmb();
+			site->file = file;
+			return site;
+		}
+		if (site->file == file && site->line == line &&
+		    site->lock == lock)
+			return site;
+	}
+
+	return t->sites + LOCKSTAT_HSLOTS;
+}
+
+/*
+ * Account for a locked section ending on @cpu. @lock still refers to
+ * the acquisition site at this point. Hard irqs are off.
+ */
+static void lockstat_account(struct xnlock *lock, int cpu,
+			     unsigned long long lock_time)
+{
+	struct lockstat_site *site;
+	struct lockstat_table *t;
+	unsigned long gen;
+
+	if (lockstat_tables == NULL)
+		return;
+
+	t = per_cpu_ptr(lockstat_tables, cpu);
+	gen = lockstat_gen;
+	if (unlikely(t->gen != gen))
+		lockstat_reset(t, gen);
+
+	site = lockstat_lookup(t, lock, lock->file, lock->line,
+			       lock->function);
+	site->seq++;
+	smp_wmb();
+	site->count++;
+	site->spin_time += lock->spin_time;
+	if (lock->spin_time > site->spin_max)
+		site->spin_max = lock->spin_time;
+	site->lock_time += lock_time;
+	if (lock_time > site->lock_max)
+		site->lock_max = lock_time;
+	smp_wmb();
+	site->seq++;
+}
+
+static DEFINE_VFILE_HOSTLOCK(lockstat_mutex);
+
+static struct xnvfile_rev_tag lockstat_tag;
+
+struct lockstat_vfile_priv {
+	int cpu;
+	int slot;
+};
+
+struct lockstat_vfile_data {
+	int cpu;
+	struct lockstat_site site;
+};
+
+static int lockstat_next_cpu(int cpu)
+{
+	do
+		cpu = cpumask_next(cpu, cpu_online_mask);
+	while (cpu < nr_cpu_ids && !xnsched_supported_cpu(cpu));
+
+	return cpu;
+}
+
+static int lockstat_vfile_rewind(struct xnvfile_snapshot_iterator *it)
+{
+	struct lockstat_vfile_priv *priv = xnvfile_iterator_priv(it);
+
+	priv->cpu = lockstat_next_cpu(-1);
+	priv->slot = 0;
+
+	return (LOCKSTAT_HSLOTS + 1) * num_online_cpus();
+}
+
+static int lockstat_vfile_next(struct xnvfile_snapshot_iterator *it,
+			       void *data)
+{
+	struct lockstat_vfile_priv *priv = xnvfile_iterator_priv(it);
+	struct lockstat_vfile_data *p = data;
+	struct lockstat_site *site;
+	struct lockstat_table *t;
+	unsigned int seq;
+	int cpu;
+
+	cpu = priv->cpu;
+	if (cpu >= nr_cpu_ids)
+		return 0;
+
+	t = per_cpu_ptr(lockstat_tables, cpu);
+	site = t->sites + priv->slot;
+
+	if (++priv->slot > LOCKSTAT_HSLOTS) {
+		priv->slot = 0;
+		priv->cpu = lockstat_next_cpu(cpu);
+	}
+
+	if (t->gen != lockstat_gen)
+		return VFILE_SEQ_SKIP;
+
+	do {
+		seq = site->seq;
+		smp_rmb();
+		p->site = *site;
+		smp_rmb();
+	} while ((seq & 1) || seq != site->seq);
+
+	if (p->site.file == NULL || p->site.count == 0)
+		return VFILE_SEQ_SKIP;
+
+	p->cpu = cpu;
+
+	return 1;
+}
+
+static int lockstat_vfile_show(struct xnvfile_snapshot_iterator *it,
+			       void *data)
+{
+	struct lockstat_vfile_data *p = data;
+	char lockname[24];
+
+	if (p == NULL) {
+		xnvfile_printf(it, "%3s  %-18s %10s %10s %14s %10s %14s  %s\n",
+			       "CPU", "LOCK", "COUNT", "HOLD-MAX", "HOLD-TOTAL",
+			       "SPIN-MAX", "SPIN-TOTAL", "SITE");
+		return 0;
+	}
+
+	if (p->site.lock == &nklock)
+		strcpy(lockname, "nklock");
+	else if (p->site.lock == NULL)
+		strcpy(lockname, "-");
+	else
+		snprintf(lockname, sizeof(lockname), "%p", p->site.lock);
+
+	xnvfile_printf(it, "%3d  %-18s %10lu %10Lu %14Lu %10Lu %14Lu  %s:%d %s\n",
+		       p->cpu, lockname, p->site.count,
+		       xnclock_ticks_to_ns(&nkclock, p->site.lock_max),
+		       xnclock_ticks_to_ns(&nkclock, p->site.lock_time),
+		       xnclock_ticks_to_ns(&nkclock, p->site.spin_max),
+		       xnclock_ticks_to_ns(&nkclock, p->site.spin_time),
+		       p->site.file, p->site.line, p->site.function);
+
+	return 0;
+}
+
+static ssize_t lockstat_vfile_store(struct xnvfile_input *input)
+{
+	ssize_t ret;
+	long val;
+
+	ret = xnvfile_get_integer(input, &val);
+	if (ret < 0)
+		return ret;
+
+	if (val != 0)
+		return -EINVAL;
+
+	/* Each CPU clears its own table on its next release. */
+	lockstat_gen++;
+	smp_wmb();
+
+	return ret;
+}
+
+static struct xnvfile_snapshot_ops lockstat_vfile_ops = {
+	.rewind = lockstat_vfile_rewind,
+	.next = lockstat_vfile_next,
+	.show = lockstat_vfile_show,
+	.store = lockstat_vfile_store,
+};
+
+static struct xnvfile_snapshot lockstat_vfile = {
+	.privsz = sizeof(struct lockstat_vfile_priv),
+	.datasz = sizeof(struct lockstat_vfile_data),
+	.tag = &lockstat_tag,
+	.ops = &lockstat_vfile_ops,
+	.entry = { .lockops = &lockstat_mutex.ops },
+};
+
+static inline int init_lockstat(void)
+{
+	struct lockstat_table __percpu *tables;
+	int cpu, ret;
+
+	tables = alloc_percpu(struct lockstat_table);
+	if (tables == NULL)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu)
+		lockstat_reset(per_cpu_ptr(tables, cpu), 0);
+
+	ret = xnvfile_init_snapshot("lockstat", &lockstat_vfile,
+				    &cobalt_debug_vfroot);
+	if (ret) {
+		free_percpu(tables);
+		return ret;
+	}
+
+	smp_wmb();
+	lockstat_tables = tables;
+
+	return 0;
+}
+
+static inline void cleanup_lockstat(void)
+{
+	struct lockstat_table __percpu *tables = lockstat_tables;
+
+	xnvfile_destroy_snapshot(&lockstat_vfile);
+	lockstat_tables = NULL;
+	smp_mb();
+	free_percpu(tables);
+}
+
+#else /* !CONFIG_XENO_OPT_DEBUG_LOCKSTAT */
+
+static inline void lockstat_account(struct xnlock *lock, int cpu,
+				    unsigned long long lock_time)
+{
+}
+
+static inline int init_lockstat(void)
+{
+	return 0;
+}
+
+static inline void cleanup_lockstat(void)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_DEBUG_LOCKSTAT */
+
 void xnlock_dbg_prepare_acquire(unsigned long long *start)
 {
 	*start = xnclock_read_raw(&nkclock);
@@ -596,6 +893,8 @@ int xnlock_dbg_release(struct xnlock *lock,
 		return 1;
 	}
 
+	lockstat_account(lock, cpu, lock_time);
+
 	/* File that we released it. */
 	lock->cpu = -lock->cpu;
 	lock->file = file;
@@ -614,7 +913,18 @@ int xnlock_dbg_release(struct xnlock *lock,
 }
 EXPORT_SYMBOL_GPL(xnlock_dbg_release);
 
-#endif /* CONFIG_XENO_OPT_DEBUG_LOCKING */
+#else /* !CONFIG_XENO_OPT_DEBUG_LOCKING */
+
+static inline int init_lockstat(void)
+{
+	return 0;
+}
+
+static inline void cleanup_lockstat(void)
+{
+}
+
+#endif /* !CONFIG_XENO_OPT_DEBUG_LOCKING */
 
 void xndebug_shadow_init(struct xnthread *thread)
 {
@@ -648,11 +958,18 @@ int xndebug_init(void)
 	if (ret)
 		return ret;
 
+	ret = init_lockstat();
+	if (ret) {
+		cleanup_trace_relax();
+		return ret;
+	}
+
 	return 0;
 }
 
 void xndebug_cleanup(void)
 {
+	cleanup_lockstat();
 	cleanup_trace_relax();
 }
 
@@ -39,6 +39,11 @@
  * The free page list is maintained in rbtrees for fast lookups of
  * multi-page memory ranges, and pages holding bucketed memory have a
  * fast allocation bitmap to manage their blocks internally.
+ *
+ * Object caches sit on top of a heap for the fixed-size objects the
+ * core allocates most often. Freed objects stay in their constructed
+ * state on per-CPU free lists, so that most allocations and releases
+ * do not contend on the heap lock.
  *@{
  */
 struct xnheap cobalt_heap;		/* System heap */
@@ -48,6 +53,10 @@ static LIST_HEAD(heapq);	/* Heap list for v-file dump */
 
 static int nrheaps;
 
+static LIST_HEAD(cacheq);	/* Object cache list for v-file dump */
+
+static int nrcaches;
+
 #ifdef CONFIG_XENO_OPT_VFILE
 
 static struct xnvfile_rev_tag vfile_tag;
@@ -56,11 +65,19 @@ static struct xnvfile_snapshot_ops vfile_ops;
 
 struct vfile_priv {
 	struct xnheap *curr;
+	struct xnobjcache *curr_cache;
 };
 
 struct vfile_data {
+	int is_cache;
+	int first_cache;
 	size_t all_mem;
 	size_t free_mem;
+	size_t objsize;
+	unsigned long nr_objs;
+	unsigned long nr_active;
+	unsigned long allocs;
+	unsigned long misses;
 	char name[XNOBJECT_NAME_LEN];
 };
 
@@ -75,14 +92,51 @@ static int vfile_rewind(struct xnvfile_snapshot_iterator *it)
 {
 	struct vfile_priv *priv = xnvfile_iterator_priv(it);
 
-	if (list_empty(&heapq)) {
-		priv->curr = NULL;
-		return 0;
-	}
+	priv->curr = NULL;
+	priv->curr_cache = NULL;
+
+	if (!list_empty(&heapq))
+		priv->curr = list_first_entry(&heapq, struct xnheap, next);
+
+	if (!list_empty(&cacheq))
+		priv->curr_cache = list_first_entry(&cacheq,
+						    struct xnobjcache, next);
+
+	return nrheaps + nrcaches;
+}
 
-	priv->curr = list_first_entry(&heapq, struct xnheap, next);
+static void vfile_next_cache(struct vfile_priv *priv, struct vfile_data *p)
+{
+	struct xnobjcache *cache = priv->curr_cache;
+	struct xnobjcache_cpu *pc;
+	unsigned long nr_free;
+	int cpu;
 
-	return nrheaps;
+	if (list_is_last(&cache->next, &cacheq))
+		priv->curr_cache = NULL;
+	else
+		priv->curr_cache = list_entry(cache->next.next,
+					      struct xnobjcache, next);
+
+	p->is_cache = 1;
+	p->first_cache = cache == list_first_entry(&cacheq,
+						   struct xnobjcache, next);
+	p->objsize = cache->objsize;
+	p->nr_objs = cache->nr_objs;
+	p->allocs = 0;
+	p->misses = 0;
+	nr_free = cache->depot_nr;
+
+	/* Per-CPU figures are sampled racily, this is fine for stats. */
+	for_each_possible_cpu(cpu) {
+		pc = per_cpu_ptr(cache->cpus, cpu);
+		p->allocs += pc->allocs;
+		p->misses += pc->misses;
+		nr_free += pc->nr;
+	}
+
+	p->nr_active = p->nr_objs > nr_free ? p->nr_objs - nr_free : 0;
+	knamecpy(p->name, cache->name);
 }
 
 static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
@@ -91,8 +145,12 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 	struct vfile_data *p = data;
 	struct xnheap *heap;
 
-	if (priv->curr == NULL)
-		return 0;	/* We are done. */
+	if (priv->curr == NULL) {
+		if (priv->curr_cache == NULL)
+			return 0;	/* We are done. */
+		vfile_next_cache(priv, p);
+		return 1;
+	}
 
 	heap = priv->curr;
 	if (list_is_last(&heap->next, &heapq))
@@ -101,6 +159,7 @@ static int vfile_next(struct xnvfile_snapshot_iterator *it, void *data)
 		priv->curr = list_entry(heap->next.next,
 					struct xnheap, next);
 
+	p->is_cache = 0;
 	p->all_mem = xnheap_get_size(heap);
 	p->free_mem = xnheap_get_free(heap);
 	knamecpy(p->name, heap->name);
@@ -115,11 +174,26 @@ static int vfile_show(struct xnvfile_snapshot_iterator *it, void *data)
 	if (p == NULL)
 		xnvfile_printf(it, "%9s %9s  %s\n",
 			       "TOTAL", "FREE", "NAME");
-	else
+	else if (!p->is_cache)
 		xnvfile_printf(it, "%9zu %9zu  %s\n",
 			       p->all_mem,
 			       p->free_mem,
 			       p->name);
+	else {
+		if (p->first_cache)
+			xnvfile_printf(it, "\n%9s %9s %9s %9s %5s  %s\n",
+				       "OBJSIZE", "OBJS", "ACTIVE",
+				       "ALLOCS", "HIT%", "CACHE");
+		xnvfile_printf(it, "%9zu %9lu %9lu %9lu %5lu  %s\n",
+			       p->objsize,
+			       p->nr_objs,
+			       p->nr_active,
+			       p->allocs,
+			       p->allocs ? (p->allocs - p->misses) * 100 /
+			       p->allocs : 100,
+			       p->name);
+	}
+
 	return 0;
 }
 
@@ -831,6 +905,278 @@ void xnheap_set_name(struct xnheap *heap, const char *name, ...)
 }
 EXPORT_SYMBOL_GPL(xnheap_set_name);
 
+static inline void **objcache_link(struct xnobjcache *cache, void *obj)
+{
+	return obj + cache->linkoff;
+}
+
+/* Give a chain of free objects back to the heap. */
+static void objcache_release(struct xnobjcache *cache, void *obj)
+{
+	void *next;
+
+	while (obj) {
+		next = *objcache_link(cache, obj);
+		xnheap_free(cache->heap, obj);
+		cache->nr_objs--;
+		obj = next;
+	}
+}
+
+/*
+ * Called with hard irqs off when the local free list is empty, pull
+ * a batch of objects from the depot, or carve a fresh one from the
+ * heap if the depot is empty too.
+ */
+static void *objcache_refill(struct xnobjcache *cache,
+			     struct xnobjcache_cpu *pc)
+{
+	void *obj, *last;
+	int n;
+
+	xnlock_get(&cache->lock);
+
+	obj = cache->depot;
+	if (obj) {
+		for (n = 1, last = obj; n < XNOBJCACHE_BATCH &&
+			     *objcache_link(cache, last); n++)
+			last = *objcache_link(cache, last);
+		cache->depot = *objcache_link(cache, last);
+		cache->depot_nr -= n;
+		xnlock_put(&cache->lock);
+		*objcache_link(cache, last) = NULL;
+		pc->objs = *objcache_link(cache, obj);
+		pc->nr = n - 1;
+		return obj;
+	}
+
+	xnlock_put(&cache->lock);
+
+	obj = xnheap_alloc(cache->heap, cache->linkoff + sizeof(void *));
+	if (obj == NULL)
+		return NULL;
+
+	if (cache->ctor)
+		cache->ctor(obj);
+
+	xnlock_get(&cache->lock);
+	cache->nr_objs++;
+	xnlock_put(&cache->lock);
+
+	return obj;
+}
+
+/*
+ * Called with hard irqs off when the local free list is full, move a
+ * batch of objects to the depot, or back to the heap if the depot is
+ * full too.
+ */
+static void objcache_drain(struct xnobjcache *cache,
+			   struct xnobjcache_cpu *pc)
+{
+	void *first = pc->objs, *last = first;
+	int n;
+
+	for (n = 1; n < XNOBJCACHE_BATCH; n++)
+		last = *objcache_link(cache, last);
+	pc->objs = *objcache_link(cache, last);
+	pc->nr -= XNOBJCACHE_BATCH;
+
+	xnlock_get(&cache->lock);
+
+	if (cache->depot_nr < XNOBJCACHE_DEPOT_MAX) {
+		*objcache_link(cache, last) = cache->depot;
+		cache->depot = first;
+		cache->depot_nr += XNOBJCACHE_BATCH;
+		xnlock_put(&cache->lock);
+		return;
+	}
+
+	*objcache_link(cache, last) = NULL;
+	objcache_release(cache, first);
+
+	xnlock_put(&cache->lock);
+}
+
+/**
+ * @fn int xnobjcache_init(struct xnobjcache *cache, struct xnheap *heap, size_t objsize, void (*ctor)(void *obj))
+ * @brief Initialize an object cache.
+ *
+ * Initializes a cache of fixed-size objects drawn from a memory
+ * heap. Objects released to the cache are kept for later
+ * allocations, so the constructor only runs once per object carved
+ * from the heap. Callers must therefore release objects in their
+ * constructed state.
+ *
+ * @param cache The address of a cache descriptor to initialize.
+ *
+ * @param heap The heap to draw memory from.
+ *
+ * @param objsize The size in bytes of the cached objects.
+ *
+ * @param ctor The constructor to apply on objects carved from the
+ * heap, or NULL.
+ *
+ * @return 0 is returned upon success, or -ENOMEM if the per-CPU
+ * free lists cannot be allocated.
+ *
+ * @coretags{secondary-only}
+ */
+int xnobjcache_init(struct xnobjcache *cache, struct xnheap *heap,
+		    size_t objsize, void (*ctor)(void *obj))
+{
+	spl_t s;
+
+	secondary_mode_only();
+
+	cache->cpus = alloc_percpu(struct xnobjcache_cpu);
+	if (cache->cpus == NULL)
+		return -ENOMEM;
+
+	cache->heap = heap;
+	cache->objsize = objsize;
+	cache->linkoff = ALIGN(objsize, sizeof(void *));
+	cache->ctor = ctor;
+	cache->depot = NULL;
+	cache->depot_nr = 0;
+	cache->nr_objs = 0;
+	xnlock_init(&cache->lock);
+
+	/* Default name, override with xnobjcache_set_name() */
+	ksformat(cache->name, sizeof(cache->name), "(%p)", cache);
+
+	xnlock_get_irqsave(&nklock, s);
+	list_add_tail(&cache->next, &cacheq);
+	nrcaches++;
+	xnvfile_touch_tag(&vfile_tag);
+	xnlock_put_irqrestore(&nklock, s);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnobjcache_init);
+
+/**
+ * @fn void xnobjcache_destroy(struct xnobjcache *cache)
+ * @brief Destroy an object cache.
+ *
+ * Returns all free objects to the underlying heap. All objects
+ * allocated from the cache must have been released beforehand.
+ *
+ * @param cache The cache descriptor.
+ *
+ * @coretags{secondary-only}
+ */
+void xnobjcache_destroy(struct xnobjcache *cache)
+{
+	int cpu;
+	spl_t s;
+
+	secondary_mode_only();
+
+	xnlock_get_irqsave(&nklock, s);
+	list_del(&cache->next);
+	nrcaches--;
+	xnvfile_touch_tag(&vfile_tag);
+	xnlock_put_irqrestore(&nklock, s);
+
+	for_each_possible_cpu(cpu)
+		objcache_release(cache, per_cpu_ptr(cache->cpus, cpu)->objs);
+
+	objcache_release(cache, cache->depot);
+	XENO_WARN_ON(MEMORY, cache->nr_objs != 0);
+	free_percpu(cache->cpus);
+}
+EXPORT_SYMBOL_GPL(xnobjcache_destroy);
+
+/**
+ * @fn void *xnobjcache_alloc(struct xnobjcache *cache)
+ * @brief Allocate an object from a cache.
+ *
+ * The object comes from the free list of the current CPU whenever
+ * possible, which requires no locking.
+ *
+ * @param cache The cache descriptor.
+ *
+ * @return The address of the object upon success, or NULL if the
+ * underlying heap is exhausted.
+ *
+ * @coretags{unrestricted}
+ */
+void *xnobjcache_alloc(struct xnobjcache *cache)
+{
+	struct xnobjcache_cpu *pc;
+	void *obj;
+	spl_t s;
+
+	splhigh(s);
+
+	pc = per_cpu_ptr(cache->cpus, ipipe_processor_id());
+	pc->allocs++;
+	obj = pc->objs;
+	if (likely(obj)) {
+		pc->objs = *objcache_link(cache, obj);
+		pc->nr--;
+	} else {
+		pc->misses++;
+		obj = objcache_refill(cache, pc);
+	}
+
+	splexit(s);
+
+	return obj;
+}
+EXPORT_SYMBOL_GPL(xnobjcache_alloc);
+
+/**
+ * @fn void xnobjcache_free(struct xnobjcache *cache, void *obj)
+ * @brief Release an object to a cache.
+ *
+ * @param cache The cache descriptor.
+ *
+ * @param obj The object to release, in constructed state.
+ *
+ * @coretags{unrestricted}
+ */
+void xnobjcache_free(struct xnobjcache *cache, void *obj)
+{
+	struct xnobjcache_cpu *pc;
+	spl_t s;
+
+	splhigh(s);
+
+	pc = per_cpu_ptr(cache->cpus, ipipe_processor_id());
+	*objcache_link(cache, obj) = pc->objs;
+	pc->objs = obj;
+	if (++pc->nr >= 2 * XNOBJCACHE_BATCH)
+		objcache_drain(cache, pc);
+
+	splexit(s);
+}
+EXPORT_SYMBOL_GPL(xnobjcache_free);
+
+/**
+ * @fn xnobjcache_set_name(struct xnobjcache *cache,const char *name,...)
+ * @brief Set the cache's name string.
+ *
+ * Set the cache name that will be used in statistic outputs.
+ *
+ * @param cache The address of a cache descriptor.
+ *
+ * @param name Name displayed in statistic outputs. This parameter can
+ * be a printk()-like format argument list.
+ *
+ * @coretags{task-unrestricted}
+ */
+void xnobjcache_set_name(struct xnobjcache *cache, const char *name, ...)
+{
+	va_list args;
+
+	va_start(args, name);
+	kvsformat(cache->name, sizeof(cache->name), name, args);
+	va_end(args);
+}
+EXPORT_SYMBOL_GPL(xnobjcache_set_name);
+
 void *xnheap_vmalloc(size_t size)
 {
 	/*
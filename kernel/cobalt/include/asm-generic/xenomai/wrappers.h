@@ -47,6 +47,7 @@
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,6,0)
 #define in_ia32_syscall() (current_thread_info()->status & TS_COMPAT)
+#define MSG_BATCH	0x40000
 #endif
 
 #if LINUX_VERSION_CODE < KERNEL_VERSION(4,5,0)
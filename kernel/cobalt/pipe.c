@@ -226,6 +226,68 @@ static inline void xnpipe_schedule_request(void) /* hw IRQs off */
 	__xnapc_schedule(xnpipe_wakeup_apc);
 }
 
+/* Must be entered with nklock held, interrupts off. */
+static inline void xnpipe_kick_reader(struct xnpipe_state *state)
+{
+	int need_sched = 0;
+
+	if ((state->status & XNPIPE_USER_CONN) == 0)
+		return;
+
+	if (state->status & XNPIPE_USER_WREAD) {
+		/*
+		 * Wake up the regular Linux task waiting for input
+		 * from the Xenomai side.
+		 */
+		state->status |= XNPIPE_USER_WREAD_READY;
+		need_sched = 1;
+	}
+
+	if (state->asyncq) {	/* Schedule asynch sig. */
+		state->status |= XNPIPE_USER_SIGIO;
+		need_sched = 1;
+	}
+
+	if (need_sched)
+		xnpipe_schedule_request();
+}
+
+/*
+ * Move the messages posted locklessly by xnpipe_send() to the output
+ * queue. Senders push to the pending list in LIFO order, so we
+ * reverse the chain before appending it. Must be entered with nklock
+ * held, interrupts off.
+ */
+static void xnpipe_collect_outq(struct xnpipe_state *state)
+{
+	struct llist_node *node, *next, *head = NULL;
+	struct xnpipe_mh *mh;
+
+	if (llist_empty(&state->pendq))
+		return;
+
+	node = llist_del_all(&state->pendq);
+	while (node) {
+		next = node->next;
+		node->next = head;
+		head = node;
+		node = next;
+	}
+
+	while (head) {
+		mh = llist_entry(head, struct xnpipe_mh, next);
+		head = head->next;
+		list_add_tail(&mh->link, &state->outq);
+		state->nroutq++;
+		state->ionrd += xnpipe_m_size(mh);
+	}
+}
+
+static inline bool xnpipe_outq_empty(struct xnpipe_state *state)
+{
+	return list_empty(&state->outq) && llist_empty(&state->pendq);
+}
+
 static inline ssize_t xnpipe_flush_bufq(void (*fn)(void *buf, void *xstate),
 					struct list_head *q,
 					void *xstate)
@@ -384,6 +446,7 @@ int xnpipe_disconnect(int minor)
 
 	state->status &= ~XNPIPE_KERN_CONN;
 
+	xnpipe_collect_outq(state);
 	state->ionrd -= xnpipe_flushq(state, outq, free_obuf, s);
 
 	if ((state->status & XNPIPE_USER_CONN) == 0)
@@ -436,7 +499,6 @@ EXPORT_SYMBOL_GPL(xnpipe_disconnect);
 ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 {
 	struct xnpipe_state *state;
-	int need_sched = 0;
 	spl_t s;
 
 	if (minor < 0 || minor >= XNPIPE_NDEVS)
@@ -447,47 +509,55 @@ ssize_t xnpipe_send(int minor, struct xnpipe_mh *mh, size_t size, int flags)
 
 	state = &xnpipe_states[minor];
 
-	xnlock_get_irqsave(&nklock, s);
-
-	if ((state->status & XNPIPE_KERN_CONN) == 0) {
-		xnlock_put_irqrestore(&nklock, s);
-		return -EBADF;
-	}
-
 	xnpipe_m_size(mh) = size - sizeof(*mh);
 	xnpipe_m_rdoff(mh) = 0;
-	state->ionrd += xnpipe_m_size(mh);
 
-	if (flags & XNPIPE_URGENT)
-		list_add(&mh->link, &state->outq);
-	else
-		list_add_tail(&mh->link, &state->outq);
+	if (flags & XNPIPE_URGENT) {
+		xnlock_get_irqsave(&nklock, s);
 
-	state->nroutq++;
+		if ((state->status & XNPIPE_KERN_CONN) == 0) {
+			xnlock_put_irqrestore(&nklock, s);
+			return -EBADF;
+		}
+
+		state->ionrd += xnpipe_m_size(mh);
+		list_add(&mh->link, &state->outq);
+		state->nroutq++;
+		xnpipe_kick_reader(state);
 
-	if ((state->status & XNPIPE_USER_CONN) == 0) {
 		xnlock_put_irqrestore(&nklock, s);
-		return (ssize_t) size;
-	}
 
-	if (state->status & XNPIPE_USER_WREAD) {
-		/*
-		 * Wake up the regular Linux task waiting for input
-		 * from the Xenomai side.
-		 */
-		state->status |= XNPIPE_USER_WREAD_READY;
-		need_sched = 1;
+		return (ssize_t) size;
 	}
 
-	if (state->asyncq) {	/* Schedule asynch sig. */
-		state->status |= XNPIPE_USER_SIGIO;
-		need_sched = 1;
-	}
+	/*
+	 * Regular messages go to the lockless pending list, which
+	 * the Linux side collects under nklock. The caller owns the
+	 * kernel end of the pipe, so the connection state cannot
+	 * change under our feet.
+	 */
+	if ((state->status & XNPIPE_KERN_CONN) == 0)
+		return -EBADF;
 
-	if (need_sched)
-		xnpipe_schedule_request();
+	/*
+	 * If the list was not empty, the Linux side has yet to
+	 * collect the previous message, and was kicked already if
+	 * waiting for it.
+	 */
+	if (!llist_add(&mh->next, &state->pendq))
+		return (ssize_t) size;
 
-	xnlock_put_irqrestore(&nklock, s);
+	/*
+	 * llist_add() implies a full barrier, pairing with the one
+	 * readers issue between raising XNPIPE_USER_WREAD and
+	 * probing the pending list. Only grab the nklock if someone
+	 * might have to be woken up.
+	 */
+	if ((state->status & XNPIPE_USER_WREAD) || state->asyncq) {
+		xnlock_get_irqsave(&nklock, s);
+		xnpipe_kick_reader(state);
+		xnlock_put_irqrestore(&nklock, s);
+	}
 
 	return (ssize_t) size;
 }
@@ -513,6 +583,8 @@ ssize_t xnpipe_mfixup(int minor, struct xnpipe_mh *mh, ssize_t size)
 		return -EBADF;
 	}
 
+	/* Make sure the size of @mh was accounted for already. */
+	xnpipe_collect_outq(state);
 	xnpipe_m_size(mh) += size;
 	state->ionrd += size;
 
@@ -616,6 +688,7 @@ int xnpipe_flush(int minor, int mode)
 		return -EBADF;
 	}
 
+	xnpipe_collect_outq(state);
 	msgcount = state->nroutq + state->nrinq;
 
 	if (mode & XNPIPE_OFLUSH)
@@ -665,6 +738,7 @@ EXPORT_SYMBOL_GPL(xnpipe_pollstate);
 /* Must be entered with nklock held, interrupts off. */
 #define xnpipe_cleanup_user_conn(__state, __s)				\
 	do {								\
+		xnpipe_collect_outq(__state);				\
 		xnpipe_flushq((__state), outq, free_obuf, (__s));	\
 		xnpipe_flushq((__state), inq, free_ibuf, (__s));	\
 		(__state)->status &= ~XNPIPE_USER_CONN;			\
@@ -806,8 +880,12 @@ static ssize_t xnpipe_read(struct file *file,
 	}
 	/*
 	 * Queue probe and proc enqueuing must be seen atomically,
-	 * including from the Xenomai side.
+	 * including from the Xenomai side. Senders posting to the
+	 * pending list are synchronized by the barrier
+	 * prepare_to_wait_exclusive() issues before xnpipe_wait()
+	 * probes the queues.
 	 */
+	xnpipe_collect_outq(state);
 	if (list_empty(&state->outq)) {
 		if (file->f_flags & O_NONBLOCK) {
 			xnlock_put_irqrestore(&nklock, s);
@@ -815,8 +893,9 @@ static ssize_t xnpipe_read(struct file *file,
 		}
 
 		sigpending = xnpipe_wait(state, XNPIPE_USER_WREAD, s,
-					 !list_empty(&state->outq));
+					 !xnpipe_outq_empty(state));
 
+		xnpipe_collect_outq(state);
 		if (list_empty(&state->outq)) {
 			xnlock_put_irqrestore(&nklock, s);
 			return sigpending ? -ERESTARTSYS : 0;
@@ -914,6 +993,7 @@ retry:
 		return -EPIPE;
 	}
 
+	xnpipe_collect_outq(state);
 	pollnum = state->nrinq + state->nroutq;
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -994,6 +1074,7 @@ static long xnpipe_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			return -EPIPE;
 		}
 
+		xnpipe_collect_outq(state);
 		n = xnpipe_flushq(state, outq, free_obuf, s);
 		state->ionrd -= n;
 		goto kick_wsync;
@@ -1030,7 +1111,10 @@ static long xnpipe_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 
 	case FIONREAD:
 
+		xnlock_get_irqsave(&nklock, s);
+		xnpipe_collect_outq(state);
 		n = (state->status & XNPIPE_KERN_CONN) ? state->ionrd : 0;
+		xnlock_put_irqrestore(&nklock, s);
 
 		if (put_user(n, (int *)arg))
 			return -EFAULT;
@@ -1088,9 +1172,8 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 	else
 		r_mask |= POLLHUP;
 
-	if (!list_empty(&state->outq))
-		r_mask |= (POLLIN | POLLRDNORM);
-	else
+	xnpipe_collect_outq(state);
+	if (list_empty(&state->outq)) {
 		/*
 		 * Procs which have issued a timed out poll req will
 		 * remain linked to the sleepers queue, and will be
@@ -1098,6 +1181,17 @@ static unsigned xnpipe_poll(struct file *file, poll_table *pt)
 		 * kicks xnpipe_wakeup_proc().
 		 */
 		xnpipe_enqueue_wait(state, XNPIPE_USER_WREAD);
+		/*
+		 * Pairs with the barrier implied by llist_add() in
+		 * xnpipe_send(): either the sender sees us waiting,
+		 * or we see its message.
+		 */
+		smp_mb();
+		xnpipe_collect_outq(state);
+	}
+
+	if (!list_empty(&state->outq))
+		r_mask |= (POLLIN | POLLRDNORM);
 
 	xnlock_put_irqrestore(&nklock, s);
 
@@ -1128,6 +1222,7 @@ int xnpipe_mount(void)
 		state->nrinq = 0;
 		INIT_LIST_HEAD(&state->outq);
 		state->nroutq = 0;
+		init_llist_head(&state->pendq);
 	}
 
 	xnpipe_class = class_create(THIS_MODULE, "rtpipe");
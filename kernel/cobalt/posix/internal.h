@@ -41,6 +41,7 @@
 #define COBALT_EVENT_MAGIC	COBALT_MAGIC(0F)
 #define COBALT_MONITOR_MAGIC	COBALT_MAGIC(10)
 #define COBALT_TIMERFD_MAGIC	COBALT_MAGIC(11)
+#define COBALT_POLL_MAGIC	COBALT_MAGIC(12)
 
 #define cobalt_obj_active(h,m,t)	\
 	((h) && ((t *)(h))->magic == (m))
@@ -55,6 +56,15 @@ static inline xnhandle_t cobalt_get_handle_from_user(xnhandle_t *u_h)
 
 int cobalt_init(void);
 
+int cobalt_sem_init_cache(void);
+void cobalt_sem_cleanup_cache(void);
+int cobalt_mutex_init_cache(void);
+void cobalt_mutex_cleanup_cache(void);
+int cobalt_timer_init_cache(void);
+void cobalt_timer_cleanup_cache(void);
+int cobalt_mq_init_cache(void);
+void cobalt_mq_cleanup_cache(void);
+
 long cobalt_restart_syscall_placeholder(struct restart_block *param);
 
 #endif /* !_COBALT_POSIX_INTERNAL_H */
@@ -305,6 +305,12 @@ fail_vdso:
 
 void cobalt_memdev_cleanup(void)
 {
+	/*
+	 * Kernel-side RTDM users index their descriptors in the
+	 * kernel ppd, which no process exit ever cleans up. Drop
+	 * what is left of it, including the fd table.
+	 */
+	rtdm_fd_cleanup(&cobalt_kernel_ppd);
 	rtdm_dev_unregister(&sysmem_device);
 	rtdm_dev_unregister(umm_devices + UMM_SHARED);
 	rtdm_dev_unregister(umm_devices + UMM_PRIVATE);
@@ -20,7 +20,9 @@
 #include <linux/slab.h>
 #include <linux/mm.h>
 #include <linux/sched.h>
+#include <linux/log2.h>
 #include <cobalt/kernel/select.h>
+#include <cobalt/uapi/mqueue.h>
 #include <rtdm/fd.h>
 #include "internal.h"
 #include "thread.h"
@@ -32,7 +34,6 @@
 
 #define COBALT_MSGMAX		65536
 #define COBALT_MSGSIZEMAX	(16*1024*1024)
-#define COBALT_MSGPRIOMAX	32768
 
 struct cobalt_mq {
 	unsigned magic;
@@ -60,6 +61,10 @@ struct cobalt_mq {
 
 	DECLARE_XNSELECT(read_select);
 	DECLARE_XNSELECT(write_select);
+
+	/* MQ_SHMEM mode, the shared state is not trusted. */
+	struct cobalt_mq_state *shm;
+	__u32 shm_slotsize;
 };
 
 struct cobalt_mqd {
@@ -86,6 +91,8 @@ static struct mq_attr default_attr = {
 
 static LIST_HEAD(cobalt_mqq);
 
+static struct xnobjcache mq_cache, mqd_cache;
+
 static inline struct cobalt_msg *mq_msg_alloc(struct cobalt_mq *mq)
 {
 	if (list_empty(&mq->avail))
@@ -99,10 +106,40 @@ static inline void mq_msg_free(struct cobalt_mq *mq, struct cobalt_msg * msg)
 	list_add(&msg->link, &mq->avail); /* For earliest re-use of the block. */
 }
 
+static int mq_shm_init(struct cobalt_mq *mq, const struct mq_attr *attr)
+{
+	struct cobalt_mq_state *state;
+	__u32 nrslots, slotsize, n;
+	u64 memsize;
+
+	nrslots = roundup_pow_of_two(attr->mq_maxmsg);
+	slotsize = ALIGN(sizeof(struct cobalt_mq_slot) + attr->mq_msgsize,
+			 sizeof(u64));
+	memsize = sizeof(*state) + (u64)nrslots * slotsize;
+	if (memsize > U32_MAX)
+		return -ENOSPC;
+
+	state = cobalt_umm_zalloc(&cobalt_kernel_ppd.umm, memsize);
+	if (state == NULL)
+		return -ENOSPC;
+
+	state->nrslots = nrslots;
+	state->msgsize = attr->mq_msgsize;
+	state->slotsize = slotsize;
+	for (n = 0; n < nrslots; n++)
+		atomic_set(&cobalt_mq_get_slot(state, n)->seq, n);
+
+	mq->shm = state;
+	mq->shm_slotsize = slotsize;
+
+	return 0;
+}
+
 static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 {
 	unsigned i, msgsize, memsize;
-	char *mem;
+	char *mem = NULL;
+	int ret;
 
 	if (attr == NULL)
 		attr = &default_attr;
@@ -122,14 +159,23 @@ static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 		msgsize +=
 		    sizeof(unsigned long) - (msgsize % sizeof(unsigned long));
 
-	memsize = msgsize * attr->mq_maxmsg;
-	memsize = PAGE_ALIGN(memsize);
-	if (get_order(memsize) > MAX_ORDER)
-		return -ENOSPC;
+	mq->shm = NULL;
+	if (attr->mq_flags & MQ_SHMEM) {
+		/* The message ring lives in the shared heap instead. */
+		ret = mq_shm_init(mq, attr);
+		if (ret)
+			return ret;
+		memsize = 0;
+	} else {
+		memsize = msgsize * attr->mq_maxmsg;
+		memsize = PAGE_ALIGN(memsize);
+		if (get_order(memsize) > MAX_ORDER)
+			return -ENOSPC;
 
-	mem = xnheap_vmalloc(memsize);
-	if (mem == NULL)
-		return -ENOSPC;
+		mem = xnheap_vmalloc(memsize);
+		if (mem == NULL)
+			return -ENOSPC;
+	}
 
 	mq->memsize = memsize;
 	INIT_LIST_HEAD(&mq->queued);
@@ -140,12 +186,14 @@ static inline int mq_init(struct cobalt_mq *mq, const struct mq_attr *attr)
 
 	/* Fill the pool. */
 	INIT_LIST_HEAD(&mq->avail);
-	for (i = 0; i < attr->mq_maxmsg; i++) {
+	for (i = 0; mem && i < attr->mq_maxmsg; i++) {
 		struct cobalt_msg *msg = (struct cobalt_msg *) (mem + i * msgsize);
 		mq_msg_free(mq, msg);
 	}
 
 	mq->attr = *attr;
+	if (mq->shm)
+		mq->attr.mq_maxmsg = mq->shm->nrslots;
 	mq->target = NULL;
 	xnselect_init(&mq->read_select);
 	xnselect_init(&mq->write_select);
@@ -168,8 +216,11 @@ static inline void mq_destroy(struct cobalt_mq *mq)
 	xnselect_destroy(&mq->read_select);
 	xnselect_destroy(&mq->write_select);
 	xnregistry_remove(mq->handle);
-	xnheap_vfree(mq->mem);
-	kfree(mq);
+	if (mq->shm)
+		cobalt_umm_free(&cobalt_kernel_ppd.umm, mq->shm);
+	else
+		xnheap_vfree(mq->mem);
+	xnobjcache_free(&mq_cache, mq);
 
 	if (resched)
 		xnsched_run();
@@ -201,10 +252,332 @@ static void mqd_close(struct rtdm_fd *fd)
 	struct cobalt_mqd *mqd = container_of(fd, struct cobalt_mqd, fd);
 	struct cobalt_mq *mq = mqd->mq;
 
-	kfree(mqd);
+	xnobjcache_free(&mqd_cache, mqd);
 	mq_unref(mq);
 }
 
+/*
+ * MQ_SHMEM mode: the messages are stored into a bounded MPMC ring
+ * living in the shared heap, which senders and receivers update
+ * locklessly from user space (see lib/cobalt/mq.c). The kernel only
+ * handles blocking: waiters account for themselves in the shared
+ * state before sleeping, so that the other side knows it has to wake
+ * them up via mq_shm_wake once it published or released a slot. The
+ * same ring protocol is used for the regular mq_timedsend() and
+ * mq_timedreceive() calls on such queues.
+ *
+ * Everything user space may write to is untrusted: slots are located
+ * from the kernel copy of the geometry, lengths are clamped.
+ */
+static inline struct cobalt_mq_slot *
+mq_shm_slot(struct cobalt_mq *mq, __u32 pos)
+{
+	return (void *)(mq->shm + 1) +
+		(pos & (mq->attr.mq_maxmsg - 1)) * mq->shm_slotsize;
+}
+
+/* Sequence a slot must bear for @dir to own it at position @pos. */
+static inline __u32 mq_shm_seq(int dir, __u32 pos)
+{
+	return dir == COBALT_MQ_SHM_SEND ? pos : pos + 1;
+}
+
+static inline atomic_t *mq_shm_pos(struct cobalt_mq_state *state, int dir)
+{
+	return dir == COBALT_MQ_SHM_SEND ? &state->enqueue : &state->dequeue;
+}
+
+static int mq_shm_access(struct cobalt_mqd *mqd, int dir)
+{
+	unsigned int flags = rtdm_fd_flags(&mqd->fd) & COBALT_PERMS_MASK;
+
+	if (flags == O_RDWR)
+		return 0;
+
+	if (flags == (dir == COBALT_MQ_SHM_SEND ? O_WRONLY : O_RDONLY))
+		return 0;
+
+	return -EBADF;
+}
+
+static bool mq_shm_ready(struct cobalt_mq *mq, int dir)
+{
+	struct cobalt_mq_slot *slot;
+	__u32 pos;
+
+	pos = atomic_read(mq_shm_pos(mq->shm, dir));
+	slot = mq_shm_slot(mq, pos);
+
+	return (int)(atomic_read(&slot->seq) - mq_shm_seq(dir, pos)) >= 0;
+}
+
+static struct cobalt_mq_slot *
+mq_shm_claim(struct cobalt_mq *mq, int dir, __u32 *posp)
+{
+	atomic_t *posv = mq_shm_pos(mq->shm, dir);
+	struct cobalt_mq_slot *slot;
+	__u32 pos;
+	int diff;
+
+	pos = atomic_read(posv);
+	for (;;) {
+		slot = mq_shm_slot(mq, pos);
+		diff = (int)(atomic_read(&slot->seq) - mq_shm_seq(dir, pos));
+		if (diff < 0)
+			return NULL;
+		if (diff == 0 && atomic_cmpxchg(posv, pos, pos + 1) == pos)
+			break;
+		pos = atomic_read(posv);
+	}
+
+	*posp = pos;
+
+	return slot;
+}
+
+static void mq_shm_wake_locked(struct cobalt_mq *mq, int dir)
+{
+	struct cobalt_sigpending *sigp;
+	bool readable;
+
+	readable = mq_shm_ready(mq, COBALT_MQ_SHM_RECV);
+
+	/*
+	 * Wake up all waiters on the given side, they will compete
+	 * for the slots again. This is simpler than tracking which
+	 * one should be next, and cannot lose any wakeup.
+	 */
+	if (dir == COBALT_MQ_SHM_RECV) {
+		if (xnsynch_pended_p(&mq->receivers))
+			xnsynch_flush(&mq->receivers, 0);
+		else if (readable && mq->target) {
+			sigp = cobalt_signal_alloc();
+			if (sigp) {
+				cobalt_copy_siginfo(SI_MESGQ, &sigp->si, &mq->si);
+				if (cobalt_signal_send(mq->target, sigp, 0) <= 0)
+					cobalt_signal_free(sigp);
+			}
+			mq->target = NULL;
+			mq->shm->watch &= ~COBALT_MQ_SHM_NOTIFY;
+		}
+	} else if (xnsynch_pended_p(&mq->senders))
+		xnsynch_flush(&mq->senders, 0);
+
+	xnselect_signal(&mq->read_select, readable);
+	xnselect_signal(&mq->write_select,
+			mq_shm_ready(mq, COBALT_MQ_SHM_SEND));
+}
+
+static void mq_shm_wake(struct cobalt_mq *mq, int dir)
+{
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+	mq_shm_wake_locked(mq, dir);
+	xnsched_run();
+	xnlock_put_irqrestore(&nklock, s);
+}
+
+/*
+ * Hand over a slot to the other side: @seq is pos + 1 for a message
+ * posted by a sender, pos + nrslots for a slot freed by a receiver.
+ */
+static void mq_shm_post(struct cobalt_mq *mq, struct cobalt_mq_slot *slot,
+			__u32 seq, int dir)
+{
+	struct cobalt_mq_state *state = mq->shm;
+	__u32 waiters;
+
+	smp_mb();
+	atomic_set(&slot->seq, seq);
+	smp_mb();
+
+	waiters = dir == COBALT_MQ_SHM_RECV ? state->rwaiters : state->swaiters;
+	if (waiters || state->watch)
+		mq_shm_wake(mq, dir);
+}
+
+static int mq_shm_wait(struct cobalt_mqd *mqd, int dir,
+		       xnticks_t to, xntmode_t tmode)
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_state *state = mq->shm;
+	struct xnsynch *synch;
+	int ret = 0, info;
+	__u32 *waiters;
+	spl_t s;
+
+	if (dir == COBALT_MQ_SHM_SEND) {
+		synch = &mq->senders;
+		waiters = &state->swaiters;
+	} else {
+		synch = &mq->receivers;
+		waiters = &state->rwaiters;
+	}
+
+	xnlock_get_irqsave(&nklock, s);
+
+	/*
+	 * Advertise ourselves before checking the ring, pairs with
+	 * the barrier between posting a slot and reading the waiter
+	 * count in mq_shm_post() and its user space counterpart.
+	 */
+	(*waiters)++;
+	smp_mb();
+
+	if (!mq_shm_ready(mq, dir)) {
+		if (rtdm_fd_flags(&mqd->fd) & O_NONBLOCK)
+			ret = -EAGAIN;
+		else {
+			info = xnsynch_sleep_on(synch, to, tmode);
+			if (info & XNRMID) {
+				xnlock_put_irqrestore(&nklock, s);
+				return -EBADF;
+			}
+			if (info & XNTIMEO)
+				ret = -ETIMEDOUT;
+			else if (info & XNBREAK)
+				ret = -EINTR;
+		}
+	}
+
+	(*waiters)--;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return ret;
+}
+
+static int mq_shm_timeout(const void __user *u_ts,
+			  int (*fetch_timeout)(struct timespec *ts,
+					       const void __user *u_ts),
+			  xnticks_t *to, xntmode_t *tmode)
+{
+	struct timespec ts;
+	int ret;
+
+	ret = fetch_timeout(&ts, u_ts);
+	if (ret)
+		return ret;
+	if ((unsigned long)ts.tv_nsec >= ONE_BILLION)
+		return -EINVAL;
+
+	*to = ts2ns(&ts) + 1;
+	*tmode = XN_REALTIME;
+
+	return 0;
+}
+
+static int mq_shm_send(struct cobalt_mqd *mqd,
+		       const void __user *u_buf, size_t len, unsigned int prio,
+		       const void __user *u_ts,
+		       int (*fetch_timeout)(struct timespec *ts,
+					    const void __user *u_ts))
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_slot *slot;
+	xntmode_t tmode;
+	xnticks_t to;
+	__u32 pos;
+	int ret;
+
+	ret = mq_shm_access(mqd, COBALT_MQ_SHM_SEND);
+	if (ret)
+		return ret;
+
+	if (len > mq->attr.mq_msgsize)
+		return -EMSGSIZE;
+
+	to = XN_INFINITE;
+	tmode = XN_RELATIVE;
+
+	for (;;) {
+		slot = mq_shm_claim(mq, COBALT_MQ_SHM_SEND, &pos);
+		if (slot)
+			break;
+		if (fetch_timeout) {
+			ret = mq_shm_timeout(u_ts, fetch_timeout, &to, &tmode);
+			if (ret)
+				return ret;
+			fetch_timeout = NULL;
+		}
+		ret = mq_shm_wait(mqd, COBALT_MQ_SHM_SEND, to, tmode);
+		if (ret)
+			return ret;
+	}
+
+	/*
+	 * The slot is ours now and must be posted whatever happens,
+	 * receivers will skip it if we could not fill it.
+	 */
+	ret = cobalt_copy_from_user(slot + 1, u_buf, len);
+	slot->len = ret ? 0 : len;
+	slot->prio = prio;
+	slot->flags = ret ? COBALT_MQ_SLOT_VOID : 0;
+	mq_shm_post(mq, slot, pos + 1, COBALT_MQ_SHM_RECV);
+
+	return ret;
+}
+
+static int mq_shm_receive(struct cobalt_mqd *mqd,
+			  void __user *u_buf, ssize_t *lenp,
+			  unsigned int *priop,
+			  const void __user *u_ts,
+			  int (*fetch_timeout)(struct timespec *ts,
+					       const void __user *u_ts))
+{
+	struct cobalt_mq *mq = mqd->mq;
+	struct cobalt_mq_slot *slot;
+	xntmode_t tmode;
+	xnticks_t to;
+	size_t len = 0;
+	int ret = 0;
+	bool skip;
+	__u32 pos;
+
+	ret = mq_shm_access(mqd, COBALT_MQ_SHM_RECV);
+	if (ret)
+		return ret;
+
+	if (*lenp < mq->attr.mq_msgsize)
+		return -EMSGSIZE;
+
+	to = XN_INFINITE;
+	tmode = XN_RELATIVE;
+
+	for (;;) {
+		slot = mq_shm_claim(mq, COBALT_MQ_SHM_RECV, &pos);
+		if (slot == NULL) {
+			if (fetch_timeout) {
+				ret = mq_shm_timeout(u_ts, fetch_timeout,
+						     &to, &tmode);
+				if (ret)
+					return ret;
+				fetch_timeout = NULL;
+			}
+			ret = mq_shm_wait(mqd, COBALT_MQ_SHM_RECV, to, tmode);
+			if (ret)
+				return ret;
+			continue;
+		}
+
+		skip = slot->flags & COBALT_MQ_SLOT_VOID;
+		if (!skip) {
+			len = min_t(size_t, slot->len, mq->attr.mq_msgsize);
+			*priop = slot->prio;
+			ret = cobalt_copy_to_user(u_buf, slot + 1, len);
+		}
+		mq_shm_post(mq, slot, pos + mq->attr.mq_maxmsg,
+			    COBALT_MQ_SHM_SEND);
+		if (!skip)
+			break;
+	}
+
+	*lenp = len;
+
+	return ret;
+}
+
 int
 mqd_select(struct rtdm_fd *fd, struct xnselector *selector,
 	   unsigned type, unsigned index)
@@ -231,8 +604,11 @@ mqd_select(struct rtdm_fd *fd, struct xnselector *selector,
 		if ((rtdm_fd_flags(fd) & COBALT_PERMS_MASK) == O_WRONLY)
 			goto unlock_and_error;
 
+		if (mq->shm)
+			mq->shm->watch |= COBALT_MQ_SHM_SELECT;
 		err = xnselect_bind(&mq->read_select, binding,
 				selector, type, index,
+				mq->shm ? mq_shm_ready(mq, COBALT_MQ_SHM_RECV) :
 				!list_empty(&mq->queued));
 		if (err)
 			goto unlock_and_error;
@@ -243,8 +619,11 @@ mqd_select(struct rtdm_fd *fd, struct xnselector *selector,
 		if ((rtdm_fd_flags(fd) & COBALT_PERMS_MASK) == O_RDONLY)
 			goto unlock_and_error;
 
+		if (mq->shm)
+			mq->shm->watch |= COBALT_MQ_SHM_SELECT;
 		err = xnselect_bind(&mq->write_select, binding,
 				selector, type, index,
+				mq->shm ? mq_shm_ready(mq, COBALT_MQ_SHM_SEND) :
 				!list_empty(&mq->avail));
 		if (err)
 			goto unlock_and_error;
@@ -272,7 +651,7 @@ static inline int mqd_create(struct cobalt_mq *mq, unsigned long flags, int ufd)
 	if (cobalt_ppd_get(0) == &cobalt_kernel_ppd)
 		return -EPERM;
 
-	mqd = kmalloc(sizeof(*mqd), GFP_KERNEL);
+	mqd = xnobjcache_alloc(&mqd_cache);
 	if (mqd == NULL)
 		return -ENOSPC;
 
@@ -333,13 +712,13 @@ static int mq_open(int uqd, const char *name, int oflags,
 		if ((oflags & O_CREAT) == 0)
 			return (mqd_t)-ENOENT;
 
-		mq = kmalloc(sizeof(*mq), GFP_KERNEL);
+		mq = xnobjcache_alloc(&mq_cache);
 		if (mq == NULL)
 			return -ENOSPC;
 
 		err = mq_init(mq, attr);
 		if (err) {
-			kfree(mq);
+			xnobjcache_free(&mq_cache, mq);
 			return err;
 		}
 
@@ -668,13 +1047,19 @@ mq_finish_rcv(struct cobalt_mqd *mqd, struct cobalt_msg *msg)
 static inline int mq_getattr(struct cobalt_mqd *mqd, struct mq_attr *attr)
 {
 	struct cobalt_mq *mq;
+	int curmsgs;
 	spl_t s;
 
 	mq = mqd->mq;
 	*attr = mq->attr;
 	xnlock_get_irqsave(&nklock, s);
 	attr->mq_flags = rtdm_fd_flags(&mqd->fd);
-	attr->mq_curmsgs = mq->nrqueued;
+	if (mq->shm) {
+		curmsgs = (int)(atomic_read(&mq->shm->enqueue) -
+				atomic_read(&mq->shm->dequeue));
+		attr->mq_curmsgs = clamp_t(int, curmsgs, 0, mq->attr.mq_maxmsg);
+	} else
+		attr->mq_curmsgs = mq->nrqueued;
 	xnlock_put_irqrestore(&nklock, s);
 
 	return 0;
@@ -723,6 +1108,14 @@ mq_notify(struct cobalt_mqd *mqd, unsigned index, const struct sigevent *evp)
 		mq->si.si_uid = get_current_uuid();
 	}
 
+	/* Make the senders tell us about new messages. */
+	if (mq->shm) {
+		if (mq->target)
+			mq->shm->watch |= COBALT_MQ_SHM_NOTIFY;
+		else
+			mq->shm->watch &= ~COBALT_MQ_SHM_NOTIFY;
+	}
+
 	xnlock_put_irqrestore(&nklock, s);
 	return 0;
 
@@ -913,6 +1306,12 @@ int __cobalt_mq_timedsend(mqd_t uqd, const void __user *u_buf, size_t len,
 	}
 
 	trace_cobalt_mq_send(uqd, u_buf, len, prio);
+
+	if (mqd->mq->shm) {
+		ret = mq_shm_send(mqd, u_buf, len, prio, u_ts, fetch_timeout);
+		goto out;
+	}
+
 	msg = mq_timedsend_inner(mqd, len, u_ts, fetch_timeout);
 	if (IS_ERR(msg)) {
 		ret = PTR_ERR(msg);
@@ -962,6 +1361,14 @@ int __cobalt_mq_timedreceive(mqd_t uqd, void __user *u_buf,
 		goto fail;
 	}
 
+	if (mqd->mq->shm) {
+		ret = mq_shm_receive(mqd, u_buf, lenp, &prio,
+				     u_ts, fetch_timeout);
+		if (ret)
+			goto fail;
+		goto out;
+	}
+
 	msg = mq_timedrcv_inner(mqd, *lenp, u_ts, fetch_timeout);
 	if (IS_ERR(msg)) {
 		ret = PTR_ERR(msg);
@@ -979,7 +1386,7 @@ int __cobalt_mq_timedreceive(mqd_t uqd, void __user *u_buf,
 	ret = mq_finish_rcv(mqd, msg);
 	if (ret)
 		goto fail;
-
+out:
 	cobalt_mqd_put(mqd);
 
 	if (u_prio && __xn_put_user(prio, u_prio))
@@ -1010,3 +1417,122 @@ COBALT_SYSCALL(mq_timedreceive, primary,
 
 	return ret ?: cobalt_copy_to_user(u_len, &len, sizeof(*u_len));
 }
+
+COBALT_SYSCALL(mq_shm_map, current, (mqd_t uqd, __u32 __user *u_offset))
+{
+	struct cobalt_mqd *mqd;
+	__u32 offset;
+	int ret;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	if (mqd->mq->shm == NULL) {
+		ret = -ENXIO;
+		goto out;
+	}
+
+	offset = cobalt_umm_offset(&cobalt_kernel_ppd.umm, mqd->mq->shm);
+	ret = cobalt_copy_to_user(u_offset, &offset, sizeof(offset));
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+int __cobalt_mq_shm_wait(mqd_t uqd, int dir, const void __user *u_ts,
+			 int (*fetch_timeout)(struct timespec *ts,
+					      const void __user *u_ts))
+{
+	xntmode_t tmode = XN_RELATIVE;
+	xnticks_t to = XN_INFINITE;
+	struct cobalt_mqd *mqd;
+	int ret;
+
+	if (dir != COBALT_MQ_SHM_SEND && dir != COBALT_MQ_SHM_RECV)
+		return -EINVAL;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	if (mqd->mq->shm == NULL) {
+		ret = -ENXIO;
+		goto out;
+	}
+
+	ret = mq_shm_access(mqd, dir);
+	if (ret)
+		goto out;
+
+	if (fetch_timeout) {
+		ret = mq_shm_timeout(u_ts, fetch_timeout, &to, &tmode);
+		if (ret)
+			goto out;
+	}
+
+	ret = mq_shm_wait(mqd, dir, to, tmode);
+out:
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+COBALT_SYSCALL(mq_shm_wait, primary,
+	       (mqd_t uqd, int dir, const struct timespec __user *u_ts))
+{
+	return __cobalt_mq_shm_wait(uqd, dir,
+				    u_ts, u_ts ? mq_fetch_timeout : NULL);
+}
+
+COBALT_SYSCALL(mq_shm_wake, current, (mqd_t uqd, int dir))
+{
+	struct cobalt_mqd *mqd;
+	int ret = 0;
+
+	if (dir != COBALT_MQ_SHM_SEND && dir != COBALT_MQ_SHM_RECV)
+		return -EINVAL;
+
+	mqd = cobalt_mqd_get(uqd);
+	if (IS_ERR(mqd))
+		return PTR_ERR(mqd);
+
+	if (mqd->mq->shm)
+		mq_shm_wake(mqd->mq, dir);
+	else
+		ret = -ENXIO;
+
+	cobalt_mqd_put(mqd);
+
+	return ret;
+}
+
+__init int cobalt_mq_init_cache(void)
+{
+	int ret;
+
+	ret = xnobjcache_init(&mq_cache, &cobalt_heap,
+			      sizeof(struct cobalt_mq), NULL);
+	if (ret)
+		return ret;
+
+	xnobjcache_set_name(&mq_cache, "posix mq");
+
+	ret = xnobjcache_init(&mqd_cache, &cobalt_heap,
+			      sizeof(struct cobalt_mqd), NULL);
+	if (ret) {
+		xnobjcache_destroy(&mq_cache);
+		return ret;
+	}
+
+	xnobjcache_set_name(&mqd_cache, "posix mqd");
+
+	return 0;
+}
+
+__init void cobalt_mq_cleanup_cache(void)
+{
+	xnobjcache_destroy(&mqd_cache);
+	xnobjcache_destroy(&mq_cache);
+}
@@ -49,6 +49,10 @@ int __cobalt_mq_timedreceive(mqd_t uqd, void __user *u_buf,
 
 int __cobalt_mq_notify(mqd_t fd, const struct sigevent *evp);
 
+int __cobalt_mq_shm_wait(mqd_t uqd, int dir, const void __user *u_ts,
+			 int (*fetch_timeout)(struct timespec *ts,
+					      const void __user *u_ts));
+
 COBALT_SYSCALL_DECL(mq_open,
 		    (const char __user *u_name, int oflags,
 		     mode_t mode, struct mq_attr __user *u_attr));
@@ -71,4 +75,11 @@ COBALT_SYSCALL_DECL(mq_timedreceive,
 COBALT_SYSCALL_DECL(mq_notify,
 		    (mqd_t fd, const struct sigevent *__user evp));
 
+COBALT_SYSCALL_DECL(mq_shm_map, (mqd_t uqd, __u32 __user *u_offset));
+
+COBALT_SYSCALL_DECL(mq_shm_wait,
+		    (mqd_t uqd, int dir, const struct timespec __user *u_ts));
+
+COBALT_SYSCALL_DECL(mq_shm_wake, (mqd_t uqd, int dir));
+
 #endif /* !_COBALT_POSIX_MQUEUE_H */
@@ -22,6 +22,8 @@
 #include "cond.h"
 #include "clock.h"
 
+static struct xnobjcache mutex_cache;
+
 static int cobalt_mutex_init_inner(struct cobalt_mutex_shadow *shadow,
 				   struct cobalt_mutex *mutex,
 				   struct cobalt_mutex_state *state,
@@ -251,20 +253,20 @@ COBALT_SYSCALL(mutex_init, current,
 	if (cobalt_copy_from_user(&attr, u_attr, sizeof(attr)))
 		return -EFAULT;
 
-	mutex = xnmalloc(sizeof(*mutex));
+	mutex = xnobjcache_alloc(&mutex_cache);
 	if (mutex == NULL)
 		return -ENOMEM;
 
 	state = cobalt_umm_alloc(&cobalt_ppd_get(attr.pshared)->umm,
 				 sizeof(*state));
 	if (state == NULL) {
-		xnfree(mutex);
+		xnobjcache_free(&mutex_cache, mutex);
 		return -EAGAIN;
 	}
 
 	ret = cobalt_mutex_init_inner(&mx, mutex, state, &attr);
 	if (ret) {
-		xnfree(mutex);
+		xnobjcache_free(&mutex_cache, mutex);
 		cobalt_umm_free(&cobalt_ppd_get(attr.pshared)->umm, state);
 		return ret;
 	}
@@ -404,7 +406,7 @@ void cobalt_mutex_reclaim(struct cobalt_resnode *node, spl_t s)
 	xnlock_put_irqrestore(&nklock, s);
 
 	cobalt_umm_free(&cobalt_ppd_get(pshared)->umm, state);
-	xnfree(mutex);
+	xnobjcache_free(&mutex_cache, mutex);
 }
 
 struct xnsynch *lookup_lazy_pp(xnhandle_t handle)
@@ -421,3 +423,20 @@ struct xnsynch *lookup_lazy_pp(xnhandle_t handle)
 
 	return &mutex->synchbase;
 }
+
+__init int cobalt_mutex_init_cache(void)
+{
+	int ret;
+
+	ret = xnobjcache_init(&mutex_cache, &cobalt_heap,
+			      sizeof(struct cobalt_mutex), NULL);
+	if (ret == 0)
+		xnobjcache_set_name(&mutex_cache, "posix mutex");
+
+	return ret;
+}
+
+__init void cobalt_mutex_cleanup_cache(void)
+{
+	xnobjcache_destroy(&mutex_cache);
+}
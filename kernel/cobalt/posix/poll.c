@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <linux/err.h>
+#include <linux/fcntl.h>
+#include <cobalt/kernel/select.h>
+#include <cobalt/uapi/poll.h>
+#include <rtdm/driver.h>
+#include "internal.h"
+#include "clock.h"
+#include "poll.h"
+
+/*
+ * A poll descriptor holds a persistent interest set of RTDM file
+ * descriptors, bound once to a ready list selector by
+ * COBALT_POLL_CTL_ADD. Waiting on it only visits the descriptors
+ * which have pending events, instead of rebinding then scanning
+ * every descriptor like select() does.
+ */
+struct cobalt_poll {
+	struct rtdm_fd fd;
+	struct xnselector *selector;
+	rtdm_mutex_t ctl_lock;
+};
+
+#define COBALT_POLL_EVENTS (COBALT_POLLIN|COBALT_POLLOUT|COBALT_POLLPRI)
+
+static void poll_close(struct rtdm_fd *fd)
+{
+	struct cobalt_poll *poll = container_of(fd, struct cobalt_poll, fd);
+
+	rtdm_mutex_destroy(&poll->ctl_lock);
+	xnselector_destroy(poll->selector);
+	xnfree(poll);
+}
+
+static struct rtdm_fd_ops poll_ops = {
+	.close = poll_close,
+};
+
+COBALT_SYSCALL(poll_create, lostage, (int flags))
+{
+	struct cobalt_poll *poll;
+	int ret, ufd;
+
+	if (flags & ~O_CLOEXEC)
+		return -EINVAL;
+
+	poll = xnmalloc(sizeof(*poll));
+	if (poll == NULL)
+		return -ENOMEM;
+
+	poll->selector = xnmalloc(sizeof(*poll->selector));
+	if (poll->selector == NULL) {
+		ret = -ENOMEM;
+		goto fail_selector;
+	}
+
+	ufd = __rtdm_anon_getfd("[cobalt-poll]", O_RDWR | flags);
+	if (ufd < 0) {
+		ret = ufd;
+		goto fail_getfd;
+	}
+
+	xnselector_init_readylist(poll->selector);
+	rtdm_mutex_init(&poll->ctl_lock);
+	poll->fd.oflags = 0;
+
+	ret = rtdm_fd_enter(&poll->fd, ufd, COBALT_POLL_MAGIC, &poll_ops);
+	if (ret < 0)
+		goto fail;
+
+	ret = rtdm_fd_register(&poll->fd, ufd);
+	if (ret < 0)
+		goto fail;
+
+	return ufd;
+fail:
+	rtdm_mutex_destroy(&poll->ctl_lock);
+	__rtdm_anon_putfd(ufd);
+fail_getfd:
+	xnfree(poll->selector);
+fail_selector:
+	xnfree(poll);
+
+	return ret;
+}
+
+static inline struct cobalt_poll *poll_get(int ufd)
+{
+	struct rtdm_fd *fd;
+
+	fd = rtdm_fd_get(ufd, COBALT_POLL_MAGIC);
+	if (IS_ERR(fd)) {
+		int err = PTR_ERR(fd);
+		if (err == -EBADF && cobalt_current_process() == NULL)
+			err = -EPERM;
+		return ERR_PTR(err);
+	}
+
+	return container_of(fd, struct cobalt_poll, fd);
+}
+
+static inline void poll_put(struct cobalt_poll *poll)
+{
+	rtdm_fd_put(&poll->fd);
+}
+
+static int poll_bind(struct cobalt_poll *poll, int fd, unsigned int events)
+{
+	unsigned int type;
+	int ret;
+
+	for (type = 0; type < XNSELECT_MAX_TYPES; type++) {
+		if ((events & (1U << type)) == 0)
+			continue;
+		ret = rtdm_fd_select(fd, poll->selector, type);
+		if (ret) {
+			/* Drop the bindings we might have done so far. */
+			xnselect_unbind(poll->selector, fd);
+			return ret == -ENOENT ? -EBADF : ret;
+		}
+	}
+
+	return 0;
+}
+
+COBALT_SYSCALL(poll_ctl, primary,
+	       (int pfd, int op, int fd, unsigned int events))
+{
+	struct cobalt_poll *poll;
+	int ret;
+
+	if (fd < 0 || fd == pfd)
+		return -EINVAL;
+
+	if (op != COBALT_POLL_CTL_DEL &&
+	    (events == 0 || (events & ~COBALT_POLL_EVENTS)))
+		return -EINVAL;
+
+	poll = poll_get(pfd);
+	if (IS_ERR(poll))
+		return PTR_ERR(poll);
+
+	ret = rtdm_mutex_lock(&poll->ctl_lock);
+	if (ret)
+		goto out;
+
+	switch (op) {
+	case COBALT_POLL_CTL_ADD:
+		if (xnselect_get_bound(poll->selector, fd)) {
+			ret = -EEXIST;
+			break;
+		}
+		ret = poll_bind(poll, fd, events);
+		break;
+	case COBALT_POLL_CTL_DEL:
+		ret = xnselect_unbind(poll->selector, fd);
+		break;
+	case COBALT_POLL_CTL_MOD:
+		ret = xnselect_unbind(poll->selector, fd);
+		if (ret == 0)
+			ret = poll_bind(poll, fd, events);
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	rtdm_mutex_unlock(&poll->ctl_lock);
+out:
+	poll_put(poll);
+
+	return ret;
+}
+
+int __cobalt_poll_wait(int pfd, struct cobalt_poll_event __user *u_events,
+		       int maxevents, const struct timespec *ts)
+{
+	struct xnselect_event events[COBALT_POLL_BATCH];
+	struct cobalt_poll_event ev;
+	xnticks_t timeout = XN_INFINITE;
+	xntmode_t tmode = XN_RELATIVE;
+	struct cobalt_poll *poll;
+	int ret, n;
+
+	if (maxevents <= 0)
+		return -EINVAL;
+
+	if (ts) {
+		if ((unsigned long)ts->tv_nsec >= ONE_BILLION)
+			return -EINVAL;
+
+		timeout = ts2ns(ts);
+		if (timeout) {
+			timeout++;
+			tmode = XN_ABSOLUTE;
+		} else
+			timeout = XN_NONBLOCK;
+	}
+
+	poll = poll_get(pfd);
+	if (IS_ERR(poll))
+		return PTR_ERR(poll);
+
+	ret = xnselect_wait_ready(poll->selector, events,
+				  min(maxevents, COBALT_POLL_BATCH),
+				  timeout, tmode);
+	for (n = 0; n < ret; n++) {
+		ev.fd = events[n].index;
+		ev.events = events[n].events;
+		if (cobalt_copy_to_user(u_events + n, &ev, sizeof(ev))) {
+			ret = -EFAULT;
+			break;
+		}
+	}
+
+	poll_put(poll);
+
+	return ret;
+}
+
+COBALT_SYSCALL(poll_wait, nonrestartable,
+	       (int pfd, struct cobalt_poll_event __user *u_events,
+		int maxevents, const struct timespec __user *u_ts))
+{
+	struct timespec ts, *tsp = NULL;
+	int ret;
+
+	if (u_ts) {
+		tsp = &ts;
+		ret = cobalt_copy_from_user(&ts, u_ts, sizeof(ts));
+		if (ret)
+			return ret;
+	}
+
+	return __cobalt_poll_wait(pfd, u_events, maxevents, tsp);
+}
@@ -1506,6 +1506,22 @@ __init int cobalt_init(void)
 
 	xnsynch_init(&yield_sync, XNSYNCH_FIFO, NULL);
 
+	ret = cobalt_sem_init_cache();
+	if (ret)
+		goto fail_sem_cache;
+
+	ret = cobalt_mutex_init_cache();
+	if (ret)
+		goto fail_mutex_cache;
+
+	ret = cobalt_timer_init_cache();
+	if (ret)
+		goto fail_timer_cache;
+
+	ret = cobalt_mq_init_cache();
+	if (ret)
+		goto fail_mq_cache;
+
 	ret = cobalt_memdev_init();
 	if (ret)
 		goto fail_memdev;
@@ -1531,6 +1547,14 @@ fail_siginit:
 fail_register:
 	cobalt_memdev_cleanup();
 fail_memdev:
+	cobalt_mq_cleanup_cache();
+fail_mq_cache:
+	cobalt_timer_cleanup_cache();
+fail_timer_cache:
+	cobalt_mutex_cleanup_cache();
+fail_mutex_cache:
+	cobalt_sem_cleanup_cache();
+fail_sem_cache:
 	xnsynch_destroy(&yield_sync);
 	xnarch_cleanup_mayday();
 fail_mayday:
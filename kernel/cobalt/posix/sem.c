@@ -25,6 +25,8 @@
 #include "sem.h"
 #include <trace/events/cobalt-posix.h>
 
+static struct xnobjcache sem_cache;
+
 static inline struct cobalt_resources *sem_kqueue(struct cobalt_sem *sem)
 {
 	int pshared = !!(sem->flags & SEM_PSHARED);
@@ -78,7 +80,7 @@ int __cobalt_sem_destroy(xnhandle_t handle)
 	cobalt_umm_free(&cobalt_ppd_get(!!(sem->flags & SEM_PSHARED))->umm,
 			sem->state);
 
-	xnfree(sem);
+	xnobjcache_free(&sem_cache, sem);
 
 	return ret;
 fail:
@@ -103,7 +105,7 @@ __cobalt_sem_init(const char *name, struct cobalt_sem_shadow *sm,
 		goto out;
 	}
 
-	sem = xnmalloc(sizeof(*sem));
+	sem = xnobjcache_alloc(&sem_cache);
 	if (sem == NULL) {
 		ret = -ENOMEM;
 		goto out;
@@ -167,7 +169,7 @@ err_lock_put:
 	xnlock_put_irqrestore(&nklock, s);
 	cobalt_umm_free(&sys_ppd->umm, state);
 err_free_sem:
-	xnfree(sem);
+	xnobjcache_free(&sem_cache, sem);
 out:
 	trace_cobalt_psem_init_failed(name ?: "anon", flags, value, ret);
 
@@ -617,3 +619,20 @@ void cobalt_sem_reclaim(struct cobalt_resnode *node, spl_t s)
 	if (named && ret == -EBUSY)
 		xnregistry_unlink(xnregistry_key(handle));
 }
+
+__init int cobalt_sem_init_cache(void)
+{
+	int ret;
+
+	ret = xnobjcache_init(&sem_cache, &cobalt_heap,
+			      sizeof(struct cobalt_sem), NULL);
+	if (ret == 0)
+		xnobjcache_set_name(&sem_cache, "posix sem");
+
+	return ret;
+}
+
+__init void cobalt_sem_cleanup_cache(void)
+{
+	xnobjcache_destroy(&sem_cache);
+}
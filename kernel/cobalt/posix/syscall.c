@@ -42,6 +42,7 @@
 #include "event.h"
 #include "timerfd.h"
 #include "io.h"
+#include "poll.h"
 #include "corectl.h"
 #include "../debug.h"
 #include <trace/events/cobalt-posix.h>
@@ -34,6 +34,7 @@
 #include "event.h"
 #include "mqueue.h"
 #include "io.h"
+#include "poll.h"
 #include "../debug.h"
 
 COBALT_SYSCALL32emu(thread_create, init,
@@ -303,6 +304,14 @@ COBALT_SYSCALL32emu(mq_notify, primary,
 	return __cobalt_mq_notify(fd, u_cev ? &sev : NULL);
 }
 
+COBALT_SYSCALL32emu(mq_shm_wait, primary,
+		    (mqd_t uqd, int dir,
+		     const struct compat_timespec __user *u_ts))
+{
+	return __cobalt_mq_shm_wait(uqd, dir,
+				    u_ts, u_ts ? sys32_fetch_timeout : NULL);
+}
+
 COBALT_SYSCALL32emu(sched_weightprio, current,
 		    (int policy,
 		     const struct compat_sched_param_ex __user *u_param))
@@ -686,6 +695,23 @@ COBALT_SYSCALL32emu(event_wait, primary,
 	return __cobalt_event_wait(u_event, bits, u_bits_r, mode, tsp);
 }
 
+COBALT_SYSCALL32emu(poll_wait, nonrestartable,
+		    (int pfd, struct cobalt_poll_event __user *u_events,
+		     int maxevents, const struct compat_timespec __user *u_ts))
+{
+	struct timespec ts, *tsp = NULL;
+	int ret;
+
+	if (u_ts) {
+		tsp = &ts;
+		ret = sys32_get_timespec(&ts, u_ts);
+		if (ret)
+			return ret;
+	}
+
+	return __cobalt_poll_wait(pfd, u_events, maxevents, tsp);
+}
+
 COBALT_SYSCALL32emu(select, nonrestartable,
 		    (int nfds,
 		     compat_fd_set __user *u_rfds,
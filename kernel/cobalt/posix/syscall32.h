@@ -25,6 +25,7 @@ struct cobalt_event_shadow;
 struct cobalt_cond_shadow;
 struct cobalt_sem_shadow;
 struct cobalt_monitor_shadow;
+struct cobalt_poll_event;
 
 COBALT_SYSCALL32emu_DECL(thread_create,
 			 (compat_ulong_t pth,
@@ -104,6 +105,10 @@ COBALT_SYSCALL32x_DECL(mq_timedreceive,
 COBALT_SYSCALL32emu_DECL(mq_notify,
 			 (mqd_t fd, const struct compat_sigevent *__user u_cev));
 
+COBALT_SYSCALL32emu_DECL(mq_shm_wait,
+			 (mqd_t uqd, int dir,
+			  const struct compat_timespec __user *u_ts));
+
 COBALT_SYSCALL32emu_DECL(sched_weightprio,
 			 (int policy,
 			  const struct compat_sched_param_ex __user *u_param));
@@ -183,6 +188,11 @@ COBALT_SYSCALL32emu_DECL(event_wait,
 			  unsigned int __user *u_bits_r,
 			  int mode, const struct compat_timespec __user *u_ts));
 
+COBALT_SYSCALL32emu_DECL(poll_wait,
+			 (int pfd, struct cobalt_poll_event __user *u_events,
+			  int maxevents,
+			  const struct compat_timespec __user *u_ts));
+
 COBALT_SYSCALL32emu_DECL(select,
 			 (int nfds,
 			  compat_fd_set __user *u_rfds,
@@ -25,6 +25,17 @@
 #include "clock.h"
 #include "signal.h"
 
+static struct xnobjcache timer_cache;
+
+static void timer_ctor(void *obj)
+{
+	struct cobalt_timer *timer = obj;
+
+	timer->sigp.si.si_errno = 0;
+	timer->sigp.si.si_code = SI_TIMER;
+	INIT_LIST_HEAD(&timer->sigp.next);
+}
+
 void cobalt_timer_handler(struct xntimer *xntimer)
 {
 	struct cobalt_timer *timer;
@@ -133,14 +144,11 @@ static inline int timer_create(clockid_t clockid,
 	if (cc == NULL)
 		return -EPERM;
 
-	timer = xnmalloc(sizeof(*timer));
+	timer = xnobjcache_alloc(&timer_cache);
 	if (timer == NULL)
 		return -ENOMEM;
 
-	timer->sigp.si.si_errno = 0;
-	timer->sigp.si.si_code = SI_TIMER;
 	timer->sigp.si.si_overrun = 0;
-	INIT_LIST_HEAD(&timer->sigp.next);
 	timer->clockid = clockid;
 	timer->overruns = 0;
 
@@ -196,7 +204,7 @@ fail:
 out:
 	xnlock_put_irqrestore(&nklock, s);
 
-	xnfree(timer);
+	xnobjcache_free(&timer_cache, timer);
 
 	return ret;
 }
@@ -205,8 +213,9 @@ static void timer_cleanup(struct cobalt_process *p, struct cobalt_timer *timer)
 {
 	xntimer_destroy(&timer->timerbase);
 
+	/* Leave the timer in constructed state for the cache. */
 	if (!list_empty(&timer->sigp.next))
-		list_del(&timer->sigp.next);
+		list_del_init(&timer->sigp.next);
 
 	timer_free_id(p, cobalt_timer_id(timer));
 	p->timers[cobalt_timer_id(timer)] = NULL;
@@ -250,7 +259,7 @@ timer_delete(timer_t timerid)
 
 	timer_cleanup(cc, timer);
 	xnlock_put_irqrestore(&nklock, s);
-	xnfree(timer);
+	xnobjcache_free(&timer_cache, timer);
 
 	return ret;
 
@@ -580,9 +589,26 @@ void cobalt_timer_reclaim(struct cobalt_process *p)
 		cobalt_call_extension(timer_cleanup, &timer->extref, ret);
 		timer_cleanup(p, timer);
 		xnlock_put_irqrestore(&nklock, s);
-		xnfree(timer);
+		xnobjcache_free(&timer_cache, timer);
 		xnlock_get_irqsave(&nklock, s);
 	}
 out:
 	xnlock_put_irqrestore(&nklock, s);
 }
+
+__init int cobalt_timer_init_cache(void)
+{
+	int ret;
+
+	ret = xnobjcache_init(&timer_cache, &cobalt_heap,
+			      sizeof(struct cobalt_timer), timer_ctor);
+	if (ret == 0)
+		xnobjcache_set_name(&timer_cache, "posix timer");
+
+	return ret;
+}
+
+__init void cobalt_timer_cleanup_cache(void)
+{
+	xnobjcache_destroy(&timer_cache);
+}
@@ -17,6 +17,8 @@
  */
 
 #include <linux/slab.h>
+#include <linux/hash.h>
+#include <linux/log2.h>
 #include <cobalt/kernel/sched.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/registry.h>
@@ -50,9 +52,40 @@ static unsigned int nr_active_objects;
 
 static unsigned long next_object_stamp;
 
-static struct hlist_head *object_index;
+/*
+ * Named objects are indexed by a hash table which starts small, then
+ * doubles its bucket array each time the average chain length
+ * exceeds REGISTRY_HASH_LOAD, up to a size matching the slot
+ * count. Objects move from the retired array to the new one a few
+ * buckets at a time, with every update of the index, so that nklock
+ * is never held for rehashing the whole table. Bucket n of the
+ * retired array splits into buckets 2n and 2n+1 of the new one,
+ * the first @migrated buckets of the retired array have moved
+ * already. Updates happen under nklock, bracketed by bumps of
+ * index_seq; lookups walk the chains locklessly instead, validating
+ * their outcome against that sequence count. Since objects always
+ * live in registry_obj_slots[], chain references are checked against
+ * the slot array before they are followed. Retired bucket arrays are
+ * kept until the registry is dismantled, which costs less than the
+ * current array, so that readers may keep walking them safely.
+ */
+struct registry_index {
+	int bits;
+	int migrated;
+	struct registry_index *retired;
+	struct hlist_head buckets[0];
+};
+
+#define REGISTRY_HASH_MINBITS	6
+#define REGISTRY_HASH_LOAD	2
+#define REGISTRY_HASH_MIGRATE	8	/* Buckets moved per update. */
+#define REGISTRY_LOOKUP_RETRIES	3
+
+static struct registry_index *object_index;
+
+static unsigned int nr_hashed_objects;
 
-static int nr_object_entries;
+static unsigned int index_seq;
 
 static struct xnsynch register_synch;
 
@@ -92,16 +125,45 @@ static struct xnvfile_regular usage_vfile = {
 
 unsigned xnregistry_hash_size(void)
 {
-	static const int primes[] = {
-		101, 211, 307, 401, 503, 601,
-		701, 809, 907, 1009, 1103
-	};
+	return 1U << object_index->bits;
+}
 
-#define obj_hash_max(n)			 \
-((n) < sizeof(primes) / sizeof(int) ? \
- (n) : sizeof(primes) / sizeof(int) - 1)
+static inline int registry_hash_maxbits(void)
+{
+	int bits = ilog2(CONFIG_XENO_OPT_REGISTRY_NRSLOTS) -
+		ilog2(REGISTRY_HASH_LOAD);
 
-	return primes[obj_hash_max(CONFIG_XENO_OPT_REGISTRY_NRSLOTS / 100)];
+	return max(bits, REGISTRY_HASH_MINBITS);
+}
+
+/*
+ * The buckets of a grown index are initialized as objects migrate
+ * to them.
+ */
+static struct registry_index *registry_alloc_index(int bits,
+						   struct registry_index *retired)
+{
+	struct registry_index *index;
+	int n;
+
+	index = xnmalloc(sizeof(*index) + (sizeof(struct hlist_head) << bits));
+	if (index == NULL)
+		return NULL;
+
+	index->bits = bits;
+	index->retired = retired;
+	index->migrated = 0;
+	if (retired == NULL)
+		for (n = 0; n < (1 << bits); n++)
+			INIT_HLIST_HEAD(&index->buckets[n]);
+
+	return index;
+}
+
+static inline bool registry_index_migrating(struct registry_index *index)
+{
+	return index->retired &&
+		index->migrated < (1 << index->retired->bits);
 }
 
 int xnregistry_init(void)
@@ -145,10 +207,9 @@ int xnregistry_init(void)
 	list_get_entry(&free_object_list, struct xnobject, link);
 	nr_active_objects = 1;
 
-	nr_object_entries = xnregistry_hash_size();
-	object_index = kmalloc(sizeof(*object_index) *
-				      nr_object_entries, GFP_KERNEL);
-
+	nr_hashed_objects = 0;
+	index_seq = 0;
+	object_index = registry_alloc_index(REGISTRY_HASH_MINBITS, NULL);
 	if (object_index == NULL) {
 #ifdef CONFIG_XENO_OPT_VFILE
 		xnvfile_destroy_regular(&usage_vfile);
@@ -158,9 +219,6 @@ int xnregistry_init(void)
 		return -ENOMEM;
 	}
 
-	for (n = 0; n < nr_object_entries; n++)
-		INIT_HLIST_HEAD(&object_index[n]);
-
 	xnsynch_init(&register_synch, XNSYNCH_FIFO, NULL);
 
 	return 0;
@@ -168,6 +226,7 @@ int xnregistry_init(void)
 
 void xnregistry_cleanup(void)
 {
+	struct registry_index *index, *retired;
 #ifdef CONFIG_XENO_OPT_VFILE
 	struct hlist_node *enext;
 	struct xnobject *ecurr;
@@ -176,9 +235,12 @@ void xnregistry_cleanup(void)
 
 	flush_scheduled_work();
 
-	for (n = 0; n < nr_object_entries; n++)
-		hlist_for_each_entry_safe(ecurr, enext, 
-					&object_index[n], hlink) {
+	/* Gather all objects into the current array first. */
+	registry_hash_migrate(INT_MAX);
+
+	for (n = 0; n < (1 << object_index->bits); n++)
+		hlist_for_each_entry_safe(ecurr, enext,
+					&object_index->buckets[n], hlink) {
 			pnode = ecurr->pnode;
 			if (pnode == NULL)
 				continue;
@@ -195,7 +257,11 @@ void xnregistry_cleanup(void)
 		}
 #endif /* CONFIG_XENO_OPT_VFILE */
 
-	kfree(object_index);
+	for (index = object_index; index; index = retired) {
+		retired = index->retired;
+		xnfree(index);
+	}
+
 	xnsynch_destroy(&register_synch);
 
 #ifdef CONFIG_XENO_OPT_VFILE
@@ -513,52 +579,209 @@ static unsigned registry_hash_crunch(const char *key)
 			h = (h ^ (g >> HQON)) ^ g;
 	}
 
-	return h % nr_object_entries;
+	return h;
 }
 
-static inline int registry_hash_enter(const char *key, struct xnobject *object)
+static inline struct hlist_head *
+registry_hash_bucket(struct registry_index *index, unsigned int hash)
 {
+	struct registry_index *retired = index->retired;
+	unsigned int n;
+
+	/* Objects of buckets not migrated yet are still in the old array. */
+	if (retired) {
+		n = hash_32(hash, retired->bits);
+		if (n >= ACCESS_ONCE(index->migrated))
+			return &retired->buckets[n];
+	}
+
+	return &index->buckets[hash_32(hash, index->bits)];
+}
+
+static inline void registry_index_update_begin(void)
+{
+	index_seq++;
+	smp_wmb();
+}
+
+static inline void registry_index_update_end(void)
+{
+	smp_wmb();
+	index_seq++;
+}
+
+/* Move up to @nr buckets from the retired array, nklock held. */
+static void registry_hash_migrate(int nr)
+{
+	struct registry_index *index = object_index, *old = index->retired;
+	struct hlist_node *enext;
+	struct xnobject *ecurr;
+	int n;
+
+	if (!registry_index_migrating(index))
+		return;
+
+	registry_index_update_begin();
+
+	for (n = index->migrated; nr > 0 && n < (1 << old->bits); n++, nr--) {
+		INIT_HLIST_HEAD(&index->buckets[n * 2]);
+		INIT_HLIST_HEAD(&index->buckets[n * 2 + 1]);
+		hlist_for_each_entry_safe(ecurr, enext, &old->buckets[n], hlink)
+			hlist_add_head(&ecurr->hlink,
+				&index->buckets[hash_32(ecurr->hash, index->bits)]);
+		index->migrated = n + 1;
+	}
+
+	registry_index_update_end();
+}
+
+static void registry_hash_grow(void)
+{
+	struct registry_index *old = object_index, *new;
+
+	if (registry_index_migrating(old) ||
+	    nr_hashed_objects <= (REGISTRY_HASH_LOAD << old->bits) ||
+	    old->bits >= registry_hash_maxbits())
+		return;
+
+	/* Failing to grow is not an error, chains just get longer. */
+	new = registry_alloc_index(old->bits + 1, old);
+	if (new == NULL)
+		return;
+
+	/* All objects are reachable via the retired array until moved. */
+	registry_index_update_begin();
+	object_index = new;
+	registry_index_update_end();
+}
+
+static inline int registry_hash_enter(const char *key, unsigned int hash,
+				      struct xnobject *object)
+{
+	struct hlist_head *bucket;
 	struct xnobject *ecurr;
-	unsigned s;
 
 	object->key = key;
-	s = registry_hash_crunch(key);
+	object->hash = hash;
+	bucket = registry_hash_bucket(object_index, hash);
 
-	hlist_for_each_entry(ecurr, &object_index[s], hlink)
-		if (ecurr == object || strcmp(key, ecurr->key) == 0)
+	hlist_for_each_entry(ecurr, bucket, hlink)
+		if (ecurr == object ||
+		    (ecurr->hash == hash && strcmp(key, ecurr->key) == 0))
 			return -EEXIST;
 
-	hlist_add_head(&object->hlink, &object_index[s]);
+	registry_index_update_begin();
+	hlist_add_head(&object->hlink, bucket);
+	nr_hashed_objects++;
+	registry_index_update_end();
+
+	registry_hash_migrate(REGISTRY_HASH_MIGRATE);
+	registry_hash_grow();
 
 	return 0;
 }
 
 static inline int registry_hash_remove(struct xnobject *object)
 {
-	unsigned int s = registry_hash_crunch(object->key);
 	struct xnobject *ecurr;
 
-	hlist_for_each_entry(ecurr, &object_index[s], hlink)
+	hlist_for_each_entry(ecurr,
+		     registry_hash_bucket(object_index, object->hash), hlink)
 		if (ecurr == object) {
+			registry_index_update_begin();
 			hlist_del(&ecurr->hlink);
+			nr_hashed_objects--;
+			registry_index_update_end();
+			registry_hash_migrate(REGISTRY_HASH_MIGRATE);
 			return 0;
 		}
 
 	return -ESRCH;
 }
 
-static struct xnobject *registry_hash_find(const char *key)
+static struct xnobject *registry_hash_find(const char *key, unsigned int hash)
 {
 	struct xnobject *ecurr;
 
-	hlist_for_each_entry(ecurr, 
-			&object_index[registry_hash_crunch(key)], hlink)
-		if (strcmp(key, ecurr->key) == 0)
+	hlist_for_each_entry(ecurr,
+		     registry_hash_bucket(object_index, hash), hlink)
+		if (ecurr->hash == hash && strcmp(key, ecurr->key) == 0)
 			return ecurr;
 
 	return NULL;
 }
 
+static inline struct xnobject *registry_node_object(struct hlist_node *node)
+{
+	unsigned long off;
+
+	/*
+	 * Chains may change under the feet of a lockless reader:
+	 * make sure a node reference leads to an object slot before
+	 * following it.
+	 */
+	off = (unsigned long)node - (unsigned long)&registry_obj_slots[0].hlink;
+	if (off >= CONFIG_XENO_OPT_REGISTRY_NRSLOTS * sizeof(struct xnobject) ||
+	    off % sizeof(struct xnobject))
+		return NULL;
+
+	return registry_obj_slots + off / sizeof(struct xnobject);
+}
+
+/*
+ * Search the index without holding nklock. Returns zero with
+ * *objectp pointing at the matching object, or NULL if the key was
+ * not indexed at the time of the lookup. Returns -EAGAIN if updates
+ * kept racing with us, in which case the caller should search again
+ * under lock.
+ */
+static int registry_hash_find_lockless(const char *key, unsigned int hash,
+				       struct xnobject **objectp)
+{
+	struct registry_index *index;
+	struct hlist_node *node;
+	struct xnobject *ecurr;
+	unsigned int seq;
+	const char *ekey;
+	int retries, n;
+
+	for (retries = 0; retries < REGISTRY_LOOKUP_RETRIES; retries++) {
+		seq = ACCESS_ONCE(index_seq);
+		smp_rmb();
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+
+		*objectp = NULL;
+		index = ACCESS_ONCE(object_index);
+		node = ACCESS_ONCE(registry_hash_bucket(index, hash)->first);
+		for (n = 0; node && n < CONFIG_XENO_OPT_REGISTRY_NRSLOTS; n++) {
+			ecurr = registry_node_object(node);
+			if (ecurr == NULL)
+				break;
+			/*
+			 * A key which went stale is still readable up
+			 * to the length of ours, and strcmp() won't
+			 * go further.
+			 */
+			ekey = ACCESS_ONCE(ecurr->key);
+			if (ecurr->hash == hash && ekey &&
+			    strcmp(key, ekey) == 0) {
+				*objectp = ecurr;
+				break;
+			}
+			node = ACCESS_ONCE(node->next);
+		}
+
+		smp_rmb();
+		if (ACCESS_ONCE(index_seq) == seq)
+			return 0;
+	}
+
+	return -EAGAIN;
+}
+
 struct registry_wait_context {
 	struct xnthread_wait_context wc;
 	const char *key;
@@ -631,6 +854,7 @@ int xnregistry_enter(const char *key, void *objaddr,
 		     xnhandle_t *phandle, struct xnpnode *pnode)
 {
 	struct xnobject *object;
+	unsigned int hash;
 	spl_t s;
 	int ret;
 
@@ -638,6 +862,8 @@ int xnregistry_enter(const char *key, void *objaddr,
 	    (pnode != NULL && key != NULL && strchr(key, '/')))
 		return -EINVAL;
 
+	hash = key ? registry_hash_crunch(key) : 0;
+
 	xnlock_get_irqsave(&nklock, s);
 
 	if (list_empty(&free_object_list)) {
@@ -659,7 +885,7 @@ int xnregistry_enter(const char *key, void *objaddr,
 		goto unlock_and_exit;
 	}
 
-	ret = registry_hash_enter(key, object);
+	ret = registry_hash_enter(key, hash, object);
 	if (ret) {
 		nr_active_objects--;
 		list_add_tail(&object->link, &free_object_list);
@@ -750,12 +976,28 @@ int xnregistry_bind(const char *key, xnticks_t timeout, int timeout_mode,
 {
 	struct registry_wait_context rwc;
 	struct xnobject *object;
+	unsigned int hash;
 	int ret = 0, info;
 	spl_t s;
 
 	if (key == NULL)
 		return -EINVAL;
 
+	/*
+	 * Most binding requests are about objects which are already
+	 * registered, or probes checking whether a name is in use
+	 * before creating it: serve them without holding nklock.
+	 */
+	hash = registry_hash_crunch(key);
+	if (registry_hash_find_lockless(key, hash, &object) == 0) {
+		if (object) {
+			*phandle = object - registry_obj_slots;
+			return 0;
+		}
+		if (timeout_mode == XN_RELATIVE && timeout == XN_NONBLOCK)
+			return -EWOULDBLOCK;
+	}
+
 	xnlock_get_irqsave(&nklock, s);
 
 	if (timeout_mode == XN_RELATIVE &&
@@ -765,7 +1007,7 @@ int xnregistry_bind(const char *key, xnticks_t timeout, int timeout_mode,
 	}
 
 	for (;;) {
-		object = registry_hash_find(key);
+		object = registry_hash_find(key, hash);
 		if (object) {
 			*phandle = object - registry_obj_slots;
 			goto unlock_and_exit;
@@ -877,7 +1119,7 @@ int xnregistry_unlink(const char *key)
 
 	xnlock_get_irqsave(&nklock, s);
 
-	object = registry_hash_find(key);
+	object = registry_hash_find(key, registry_hash_crunch(key));
 	if (object == NULL) {
 		ret = -ESRCH;
 		goto unlock_and_exit;
@@ -108,6 +108,40 @@ nanosecs_abs_t rtdm_clock_read_monotonic(void);
 int rtdm_task_init(rtdm_task_t *task, const char *name,
 		   rtdm_task_proc_t task_proc, void *arg,
 		   int priority, nanosecs_rel_t period)
+{
+	return rtdm_task_init_on(task, name, task_proc, arg,
+				 priority, period, NULL);
+}
+
+EXPORT_SYMBOL_GPL(rtdm_task_init);
+
+/**
+ * @brief Initialise and start a real-time task on a set of CPUs
+ *
+ * This service is equivalent to rtdm_task_init(), except that the
+ * task is bound to the CPUs in @a affinity.
+ *
+ * @param[in,out] task Task handle
+ * @param[in] name Optional task name
+ * @param[in] task_proc Procedure to be executed by the task
+ * @param[in] arg Custom argument passed to @c task_proc() on entry
+ * @param[in] priority Priority of the task, see also
+ * @ref rtdmtaskprio "Task Priority Range"
+ * @param[in] period Period in nanoseconds of a cyclic task, 0 for non-cyclic
+ * mode.
+ * @param[in] affinity CPUs the task may run on, NULL for any real-time
+ * CPU. The task starts on the first CPU from this set which is
+ * also part of the real-time CPU set.
+ *
+ * @return 0 on success, otherwise negative error code. -EINVAL is
+ * returned if @a affinity contains no real-time CPU.
+ *
+ * @coretags{secondary-only, might-switch}
+ */
+int rtdm_task_init_on(rtdm_task_t *task, const char *name,
+		      rtdm_task_proc_t task_proc, void *arg,
+		      int priority, nanosecs_rel_t period,
+		      const cpumask_t *affinity)
 {
 	union xnsched_policy_param param;
 	struct xnthread_start_attr sattr;
@@ -117,7 +151,7 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 	iattr.name = name;
 	iattr.flags = 0;
 	iattr.personality = &xenomai_personality;
-	iattr.affinity = CPU_MASK_ALL;
+	iattr.affinity = affinity ? *affinity : CPU_MASK_ALL;
 	param.rt.prio = priority;
 
 	err = xnthread_init(task, &iattr, &xnsched_class_rt, &param);
@@ -151,7 +185,7 @@ int rtdm_task_init(rtdm_task_t *task, const char *name,
 	return err;
 }
 
-EXPORT_SYMBOL_GPL(rtdm_task_init);
+EXPORT_SYMBOL_GPL(rtdm_task_init_on);
 
 #ifdef DOXYGEN_CPP /* Only used for doxygen doc generation */
 /**
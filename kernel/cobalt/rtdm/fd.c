@@ -37,10 +37,26 @@
 
 #define RTDM_SETFL_MASK (O_NONBLOCK)
 
+/*
+ * Descriptors below RTDM_FD_TABLE_SIZE are indexed by a per-process
+ * array, which rtdm_fd_get() reads locklessly. Higher (sparse)
+ * descriptors, or those registered while the table could not be
+ * allocated, live in the per-process tree guarded by fdtree_lock.
+ */
+#define RTDM_FD_TABLE_SIZE 1024
+
 DEFINE_PRIVATE_XNLOCK(fdtree_lock);
 static LIST_HEAD(rtdm_fd_cleanup_queue);
 static struct semaphore rtdm_fd_cleanup_sem;
 
+/*
+ * Lockless readers bump their CPU's counter on entry and exit of the
+ * table lookup, so that the counter is odd while a lookup runs.
+ * Writers clearing a table entry wait for the lookups in flight to
+ * complete before dropping the reference the table held.
+ */
+static DEFINE_PER_CPU(unsigned long, rtdm_fd_readers);
+
 struct rtdm_fd_index {
 	struct xnid id;
 	struct rtdm_fd *fd;
@@ -79,6 +95,89 @@ static struct rtdm_fd *fetch_fd(struct cobalt_ppd *p, int ufd)
 	return idx->fd;
 }
 
+static inline bool fd_table_p(int ufd)
+{
+	return (unsigned int)ufd < RTDM_FD_TABLE_SIZE;
+}
+
+/* Must be called with IRQs off. */
+static inline void fd_read_begin(void)
+{
+	raw_cpu_ptr(&rtdm_fd_readers)[0]++;
+	smp_mb();
+}
+
+static inline void fd_read_end(void)
+{
+	smp_mb();
+	raw_cpu_ptr(&rtdm_fd_readers)[0]++;
+}
+
+static void wait_fd_readers(void)
+{
+	unsigned long seq;
+	int cpu;
+
+	smp_mb();
+
+	for_each_online_cpu(cpu) {
+		seq = per_cpu(rtdm_fd_readers, cpu);
+		if ((seq & 1) == 0)
+			continue;
+		/* cpu_relax() is a compiler barrier as well. */
+		while (per_cpu(rtdm_fd_readers, cpu) == seq)
+			cpu_relax();
+	}
+
+	smp_mb();
+}
+
+static struct rtdm_fd *lookup_fd_table(struct cobalt_ppd *p, int ufd)
+{
+	struct rtdm_fd **table, *fd = NULL;
+	spl_t s;
+
+	splhigh(s);
+	fd_read_begin();
+
+	table = p->fd_table;
+	if (table) {
+		fd = table[ufd];
+		if (fd && !atomic_inc_not_zero(&fd->refs))
+			fd = NULL;
+	}
+
+	fd_read_end();
+	splexit(s);
+
+	return fd;
+}
+
+static struct rtdm_fd **get_fd_table(struct cobalt_ppd *p)
+{
+	struct rtdm_fd **table;
+	spl_t s;
+
+	if (p->fd_table)
+		return p->fd_table;
+
+	table = kcalloc(RTDM_FD_TABLE_SIZE, sizeof(*table), GFP_KERNEL);
+	if (table == NULL)
+		return NULL;
+
+	xnlock_get_irqsave(&fdtree_lock, s);
+	if (p->fd_table == NULL) {
+		smp_wmb();
+		p->fd_table = table;
+		table = NULL;
+	}
+	xnlock_put_irqrestore(&fdtree_lock, s);
+
+	kfree(table);
+
+	return p->fd_table;
+}
+
 #define assign_invalid_handler(__handler)				\
 	do								\
 		(__handler) = (typeof(__handler))enodev;		\
@@ -166,7 +265,7 @@ int rtdm_fd_enter(struct rtdm_fd *fd, int ufd, unsigned int magic,
 	fd->magic = magic;
 	fd->ops = ops;
 	fd->owner = ppd;
-	fd->refs = 1;
+	atomic_set(&fd->refs, 1);
 	set_compat_bit(fd);
 
 	return 0;
@@ -175,11 +274,25 @@ int rtdm_fd_enter(struct rtdm_fd *fd, int ufd, unsigned int magic,
 int rtdm_fd_register(struct rtdm_fd *fd, int ufd)
 {
 	struct rtdm_fd_index *idx;
+	struct rtdm_fd **table;
 	struct cobalt_ppd *ppd;
 	spl_t s;
 	int ret = 0;
 
 	ppd = cobalt_ppd_get(0);
+
+	table = fd_table_p(ufd) ? get_fd_table(ppd) : NULL;
+	if (table) {
+		xnlock_get_irqsave(&fdtree_lock, s);
+		if (table[ufd] || fetch_fd_index(ppd, ufd))
+			ret = -EBUSY;
+		else
+			table[ufd] = fd;
+		xnlock_put_irqrestore(&fdtree_lock, s);
+
+		return ret;
+	}
+
 	idx = kmalloc(sizeof(*idx), GFP_KERNEL);
 	if (idx == NULL)
 		return -ENOMEM;
@@ -217,15 +330,22 @@ struct rtdm_fd *rtdm_fd_get(int ufd, unsigned int magic)
 	struct rtdm_fd *fd;
 	spl_t s;
 
+	if (fd_table_p(ufd)) {
+		fd = lookup_fd_table(p, ufd);
+		if (fd) {
+			if (magic != 0 && fd->magic != magic) {
+				rtdm_fd_put(fd);
+				return ERR_PTR(-EBADF);
+			}
+			return fd;
+		}
+	}
+
 	xnlock_get_irqsave(&fdtree_lock, s);
 	fd = fetch_fd(p, ufd);
-	if (fd == NULL || (magic != 0 && fd->magic != magic)) {
+	if (fd == NULL || (magic != 0 && fd->magic != magic) ||
+	    !atomic_inc_not_zero(&fd->refs))
 		fd = ERR_PTR(-EBADF);
-		goto out;
-	}
-
-	++fd->refs;
-out:
 	xnlock_put_irqrestore(&fdtree_lock, s);
 
 	return fd;
@@ -268,14 +388,11 @@ static void lostage_trigger_close(struct ipipe_work_header *work)
 	up(&rtdm_fd_cleanup_sem);
 }
 
-static void __put_fd(struct rtdm_fd *fd, spl_t s)
+static void __put_fd(struct rtdm_fd *fd)
 {
-	int destroy;
-
-	destroy = --fd->refs == 0;
-	xnlock_put_irqrestore(&fdtree_lock, s);
+	spl_t s;
 
-	if (!destroy)
+	if (!atomic_dec_and_test(&fd->refs))
 		return;
 
 	if (ipipe_root_p)
@@ -308,10 +425,7 @@ static void __put_fd(struct rtdm_fd *fd, spl_t s)
  */
 void rtdm_fd_put(struct rtdm_fd *fd)
 {
-	spl_t s;
-
-	xnlock_get_irqsave(&fdtree_lock, s);
-	__put_fd(fd, s);
+	__put_fd(fd);
 }
 EXPORT_SYMBOL_GPL(rtdm_fd_put);
 
@@ -331,15 +445,8 @@ EXPORT_SYMBOL_GPL(rtdm_fd_put);
  */
 int rtdm_fd_lock(struct rtdm_fd *fd)
 {
-	spl_t s;
-
-	xnlock_get_irqsave(&fdtree_lock, s);
-	if (fd->refs == 0) {
-		xnlock_put_irqrestore(&fdtree_lock, s);
+	if (!atomic_inc_not_zero(&fd->refs))
 		return -EIDRM;
-	}
-	++fd->refs;
-	xnlock_put_irqrestore(&fdtree_lock, s);
 
 	return 0;
 }
@@ -357,12 +464,9 @@ EXPORT_SYMBOL_GPL(rtdm_fd_lock);
  */
 void rtdm_fd_unlock(struct rtdm_fd *fd)
 {
-	spl_t s;
-
-	xnlock_get_irqsave(&fdtree_lock, s);
 	/* Warn if fd was unreferenced. */
-	XENO_WARN_ON(COBALT, fd->refs <= 0);
-	__put_fd(fd, s);
+	XENO_WARN_ON(COBALT, atomic_read(&fd->refs) <= 0);
+	__put_fd(fd);
 }
 EXPORT_SYMBOL_GPL(rtdm_fd_unlock);
 
@@ -739,7 +843,7 @@ int __rtdm_fd_sendmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
 		       int (*get_mmsg)(struct mmsghdr *mmsg, void __user *u_mmsg),
 		       int (*put_mmsg)(void __user **u_mmsg_p, const struct mmsghdr *mmsg))
 {
-	int ret, datagrams = 0;
+	int ret, datagrams = 0, batch;
 	struct mmsghdr mmsg;
 	struct rtdm_fd *fd;
 	void __user *u_p;
@@ -761,11 +865,17 @@ int __rtdm_fd_sendmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
 	if (fd->oflags & O_NONBLOCK)
 		flags |= MSG_DONTWAIT;
 
+	batch = fd->magic == RTDM_FD_MAGIC &&
+		(rtdm_fd_device(fd)->driver->device_flags &
+		 RTDM_BATCHED_SENDMSG);
+
 	for (u_p = u_msgvec; vlen > 0; vlen--) {
 		ret = get_mmsg(&mmsg, u_p);
 		if (ret)
 			break;
-		len = fd->ops->sendmsg_rt(fd, &mmsg.msg_hdr, flags);
+		len = fd->ops->sendmsg_rt(fd, &mmsg.msg_hdr,
+					  batch && vlen > 1 ?
+					  flags | MSG_BATCH : flags);
 		if (len < 0) {
 			ret = len;
 			break;
@@ -777,6 +887,10 @@ int __rtdm_fd_sendmmsg(int ufd, void __user *u_msgvec, unsigned int vlen,
 		datagrams++;
 	}
 
+	/* Cut short, make sure nothing is held back. */
+	if (batch && vlen > 0)
+		fd->ops->sendmsg_rt(fd, NULL, flags);
+
 	if (datagrams > 0 && (ret == 0 || ret == -EWOULDBLOCK)) {
 		/* NOTE: SO_ERROR should be honored for other errors. */
 		rtdm_fd_put(fd);
@@ -794,14 +908,15 @@ static void
 __fd_close(struct cobalt_ppd *p, struct rtdm_fd_index *idx, spl_t s)
 {
 	xnid_remove(&p->fds, &idx->id);
-	__put_fd(idx->fd, s);
+	xnlock_put_irqrestore(&fdtree_lock, s);
+	__put_fd(idx->fd);
 
 	kfree(idx);
 }
 
 int rtdm_fd_close(int ufd, unsigned int magic)
 {
-	struct rtdm_fd_index *idx;
+	struct rtdm_fd_index *idx = NULL;
 	struct cobalt_ppd *ppd;
 	struct rtdm_fd *fd;
 	spl_t s;
@@ -811,11 +926,14 @@ int rtdm_fd_close(int ufd, unsigned int magic)
 	ppd = cobalt_ppd_get(0);
 
 	xnlock_get_irqsave(&fdtree_lock, s);
-	idx = fetch_fd_index(ppd, ufd);
-	if (idx == NULL)
-		goto ebadf;
+	fd = fd_table_p(ufd) && ppd->fd_table ? ppd->fd_table[ufd] : NULL;
+	if (fd == NULL) {
+		idx = fetch_fd_index(ppd, ufd);
+		if (idx == NULL)
+			goto ebadf;
+		fd = idx->fd;
+	}
 
-	fd = idx->fd;
 	if (magic != 0 && fd->magic != magic) {
 ebadf:
 		xnlock_put_irqrestore(&fdtree_lock, s);
@@ -824,7 +942,7 @@ ebadf:
 
 	set_compat_bit(fd);
 
-	trace_cobalt_fd_close(current, fd, ufd, fd->refs);
+	trace_cobalt_fd_close(current, fd, ufd, atomic_read(&fd->refs));
 
 	/*
 	 * In dual kernel mode, the linux-side fdtable and the RTDM
@@ -833,7 +951,14 @@ ebadf:
 	 * descriptor was removed from the fdtable if some refs on
 	 * rtdm_fd are still pending.
 	 */
-	__fd_close(ppd, idx, s);
+	if (idx)
+		__fd_close(ppd, idx, s);
+	else {
+		ppd->fd_table[ufd] = NULL;
+		xnlock_put_irqrestore(&fdtree_lock, s);
+		wait_fd_readers();
+		__put_fd(fd);
+	}
 	__close_fd(current->files, ufd);
 
 	return 0;
@@ -876,11 +1001,15 @@ out:
 
 int rtdm_fd_valid_p(int ufd)
 {
+	struct cobalt_ppd *p = cobalt_ppd_get(0);
 	struct rtdm_fd *fd;
 	spl_t s;
 
+	if (fd_table_p(ufd) && p->fd_table && p->fd_table[ufd])
+		return 1;
+
 	xnlock_get_irqsave(&fdtree_lock, s);
-	fd = fetch_fd(cobalt_ppd_get(0), ufd);
+	fd = fetch_fd(p, ufd);
 	xnlock_put_irqrestore(&fdtree_lock, s);
 
 	return fd != NULL;
@@ -935,16 +1064,33 @@ static void destroy_fd(void *cookie, struct xnid *id)
 
 	idx = container_of(id, struct rtdm_fd_index, id);
 	xnlock_get_irqsave(&fdtree_lock, s);
-	__fd_close(p, idx, 0);
+	__fd_close(p, idx, s);
 }
 
 void rtdm_fd_cleanup(struct cobalt_ppd *p)
 {
+	struct rtdm_fd **table;
+	int ufd;
+	spl_t s;
+
 	/*
 	 * This is called on behalf of a (userland) task exit handler,
 	 * so we don't have to deal with the regular file descriptors,
 	 * we only have to empty our own index.
 	 */
+	xnlock_get_irqsave(&fdtree_lock, s);
+	table = p->fd_table;
+	p->fd_table = NULL;
+	xnlock_put_irqrestore(&fdtree_lock, s);
+
+	if (table) {
+		wait_fd_readers();
+		for (ufd = 0; ufd < RTDM_FD_TABLE_SIZE; ufd++)
+			if (table[ufd])
+				__put_fd(table[ufd]);
+		kfree(table);
+	}
+
 	xntree_cleanup(&p->fds, p, destroy_fd);
 }
 
@@ -45,6 +45,13 @@
  * - a @a struct @a xnselector structure, the selection structure,  passed by
  * the thread calling the xnselect service, where this service does all its
  * housekeeping.
+ *
+ * A selector initialized with xnselector_init_readylist() does not
+ * track descriptors in bitmaps, but queues the bindings which
+ * received an event to a ready list instead. Such selector is meant
+ * to hold a persistent set of bindings, managed by the caller with
+ * xnselect_unbind() and waited for with xnselect_wait_ready(), whose
+ * cost only depends on the number of ready descriptors.
  * @{
  */
 
@@ -113,16 +120,29 @@ int xnselect_bind(struct xnselect *select_block,
 {
 	atomic_only();
 
-	if (type >= XNSELECT_MAX_TYPES || index > __FD_SETSIZE)
+	if (type >= XNSELECT_MAX_TYPES ||
+	    ((selector->flags & XNSELECTOR_READYLIST) == 0 &&
+	     index > __FD_SETSIZE))
 		return -EINVAL;
 
 	binding->selector = selector;
 	binding->fd = select_block;
 	binding->type = type;
 	binding->bit_index = index;
+	INIT_LIST_HEAD(&binding->rlink);
 
 	list_add_tail(&binding->slink, &selector->bindings);
 	list_add_tail(&binding->link, &select_block->bindings);
+
+	if (selector->flags & XNSELECTOR_READYLIST) {
+		if (state) {
+			list_add_tail(&binding->rlink, &selector->ready);
+			if (xnselect_wakeup(selector))
+				xnsched_run();
+		}
+		return 0;
+	}
+
 	__FD_SET__(index, &selector->fds[type].expected);
 	if (state) {
 		__FD_SET__(index, &selector->fds[type].pending);
@@ -144,6 +164,16 @@ int __xnselect_signal(struct xnselect *select_block, unsigned state)
 
 	list_for_each_entry(binding, &select_block->bindings, link) {
 		selector = binding->selector;
+		if (selector->flags & XNSELECTOR_READYLIST) {
+			if (!state)
+				list_del_init(&binding->rlink);
+			else if (list_empty(&binding->rlink)) {
+				list_add_tail(&binding->rlink, &selector->ready);
+				if (xnselect_wakeup(selector))
+					resched = 1;
+			}
+			continue;
+		}
 		if (state) {
 			if (!__FD_ISSET__(binding->bit_index,
 					&selector->fds[binding->type].pending)) {
@@ -186,6 +216,11 @@ void xnselect_destroy(struct xnselect *select_block)
 	list_for_each_entry_safe(binding, tmp, &select_block->bindings, link) {
 		list_del(&binding->link);
 		selector = binding->selector;
+		if (selector->flags & XNSELECTOR_READYLIST) {
+			/* Closed descriptors silently leave the set. */
+			list_del(&binding->rlink);
+			goto unlink;
+		}
 		__FD_CLR__(binding->bit_index,
 			 &selector->fds[binding->type].expected);
 		if (!__FD_ISSET__(binding->bit_index,
@@ -195,6 +230,7 @@ void xnselect_destroy(struct xnselect *select_block)
 			if (xnselect_wakeup(selector))
 				resched = 1;
 		}
+	unlink:
 		list_del(&binding->slink);
 		xnlock_put_irqrestore(&nklock, s);
 		xnfree(binding);
@@ -289,11 +325,35 @@ int xnselector_init(struct xnselector *selector)
 		__FD_ZERO__(&selector->fds[i].pending);
 	}
 	INIT_LIST_HEAD(&selector->bindings);
+	INIT_LIST_HEAD(&selector->ready);
+	selector->flags = 0;
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(xnselector_init);
 
+/**
+ * Initialize a selector structure maintaining a ready list.
+ *
+ * Bindings to such selector are not limited to the __FD_SETSIZE
+ * first descriptors. Pending events may only be collected by
+ * xnselect_wait_ready(), xnselect() does not apply.
+ *
+ * @param selector The selector structure to be initialized.
+ *
+ * @retval 0
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselector_init_readylist(struct xnselector *selector)
+{
+	xnselector_init(selector);
+	selector->flags |= XNSELECTOR_READYLIST;
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselector_init_readylist);
+
 /**
  * Check the state of a number of file descriptors, wait for a state change if
  * no descriptor is ready.
@@ -384,6 +444,165 @@ int xnselect(struct xnselector *selector,
 }
 EXPORT_SYMBOL_GPL(xnselect);
 
+/**
+ * Wait for events on the bindings of a ready list selector.
+ *
+ * Unlike xnselect(), only the descriptors which are ready are
+ * visited. Events are level-triggered: a binding stays in the ready
+ * list until its descriptor signals a cleared state, but reported
+ * bindings move to the end of the list, so that descriptors which
+ * could not be returned for lack of room are reported first by the
+ * next call.
+ *
+ * @param selector a selector initialized by xnselector_init_readylist();
+ * @param events array receiving the ready descriptors, events for the
+ * same descriptor are merged into a single element;
+ * @param nr the number of elements in @a events;
+ * @param timeout the timeout, whose meaning depends on @a timeout_mode,
+ * XN_NONBLOCK returns immediately;
+ * @param timeout_mode the mode of @a timeout.
+ *
+ * @retval -EINVAL if @a nr is not strictly positive, or @a selector
+ * does not maintain a ready list;
+ * @retval -EINTR if @a xnselect_wait_ready was interrupted while waiting;
+ * @retval -EIDRM if @a selector was deleted while waiting;
+ * @retval 0 in case of timeout.
+ * @retval the number of elements filled in @a events.
+ *
+ * @coretags{primary-only, might-switch}
+ */
+int xnselect_wait_ready(struct xnselector *selector,
+			struct xnselect_event *events, int nr,
+			xnticks_t timeout, xntmode_t timeout_mode)
+{
+	struct xnselect_binding *binding, *first = NULL;
+	int info = 0, count = 0, n;
+	spl_t s;
+
+	if ((selector->flags & XNSELECTOR_READYLIST) == 0 || nr <= 0)
+		return -EINVAL;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	while (list_empty(&selector->ready)) {
+		if (timeout == XN_NONBLOCK ||
+		    (info & (XNBREAK | XNTIMEO | XNRMID)))
+			goto out;
+		info = xnsynch_sleep_on(&selector->synchbase,
+					timeout, timeout_mode);
+	}
+
+	do {
+		binding = list_first_entry(&selector->ready,
+					   struct xnselect_binding, rlink);
+		if (binding == first)
+			break;
+		if (first == NULL)
+			first = binding;
+		list_move_tail(&binding->rlink, &selector->ready);
+		for (n = 0; n < count; n++)
+			if (events[n].index == binding->bit_index)
+				break;
+		if (n == count) {
+			events[n].index = binding->bit_index;
+			events[n].events = 0;
+			count++;
+		}
+		events[n].events |= 1U << binding->type;
+	} while (count < nr);
+out:
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (count > 0)
+		return count;
+
+	if (info & XNRMID)
+		return -EIDRM;
+
+	if (info & XNBREAK)
+		return -EINTR;
+
+	return 0; /* Timeout */
+}
+EXPORT_SYMBOL_GPL(xnselect_wait_ready);
+
+/**
+ * Tell which event types a descriptor is bound to a selector for.
+ *
+ * @param selector the selector structure to look into;
+ * @param index the index of the descriptor, as passed to xnselect_bind().
+ *
+ * @return a bitmask of (1 << XNSELECT_READ|WRITE|EXCEPT) values,
+ * zero if @a index is not bound to @a selector.
+ *
+ * @coretags{task-unrestricted}
+ */
+unsigned int xnselect_get_bound(struct xnselector *selector,
+				unsigned int index)
+{
+	struct xnselect_binding *binding;
+	unsigned int types = 0;
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	list_for_each_entry(binding, &selector->bindings, slink)
+		if (binding->bit_index == index)
+			types |= 1U << binding->type;
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	return types;
+}
+EXPORT_SYMBOL_GPL(xnselect_get_bound);
+
+/**
+ * Drop the bindings of a descriptor to a selector.
+ *
+ * All bindings established for @a index, regardless of the event
+ * type, are destroyed.
+ *
+ * @param selector the selector structure the descriptor is bound to;
+ * @param index the index of the descriptor, as passed to xnselect_bind().
+ *
+ * @retval -ENOENT if @a index is not bound to @a selector;
+ * @retval 0 otherwise.
+ *
+ * @coretags{task-unrestricted}
+ */
+int xnselect_unbind(struct xnselector *selector, unsigned int index)
+{
+	struct xnselect_binding *binding, *tmp;
+	LIST_HEAD(unbound);
+	spl_t s;
+
+	xnlock_get_irqsave(&nklock, s);
+
+	list_for_each_entry_safe(binding, tmp, &selector->bindings, slink) {
+		if (binding->bit_index != index)
+			continue;
+		list_del(&binding->link);
+		if (selector->flags & XNSELECTOR_READYLIST)
+			list_del(&binding->rlink);
+		else {
+			__FD_CLR__(index, &selector->fds[binding->type].expected);
+			__FD_CLR__(index, &selector->fds[binding->type].pending);
+		}
+		list_move_tail(&binding->slink, &unbound);
+	}
+
+	xnlock_put_irqrestore(&nklock, s);
+
+	if (list_empty(&unbound))
+		return -ENOENT;
+
+	list_for_each_entry_safe(binding, tmp, &unbound, slink)
+		xnfree(binding);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xnselect_unbind);
+
 /**
  * Destroy a selector block.
  *
@@ -425,6 +644,13 @@ static void xnselector_destroy_loop(void *cookie)
 			list_del(&binding->slink);
 			fd = binding->fd;
 			list_del(&binding->link);
+			/*
+			 * Signaling a descriptor still bound to this
+			 * selector may walk the ready list once we
+			 * drop the lock, unlink from it first.
+			 */
+			if (selector->flags & XNSELECTOR_READYLIST)
+				list_del_init(&binding->rlink);
 			xnlock_put_irqrestore(&nklock, s);
 			xnfree(binding);
 			xnlock_get_irqsave(&nklock, s);
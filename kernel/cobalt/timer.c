@@ -20,10 +20,12 @@
 #include <linux/ipipe.h>
 #include <linux/ipipe_tickdev.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include <cobalt/kernel/sched.h>
 #include <cobalt/kernel/thread.h>
 #include <cobalt/kernel/timer.h>
 #include <cobalt/kernel/intr.h>
+#include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/clock.h>
 #include <cobalt/kernel/trace.h>
 #include <cobalt/kernel/arith.h>
@@ -944,28 +946,28 @@ void xntimer_release_hardware(void)
 }
 EXPORT_SYMBOL_GPL(xntimer_release_hardware);
 
-#if defined(CONFIG_XENO_OPT_TIMER_RBTREE)
-static inline bool xntimerh_is_lt(xntimerh_t *left, xntimerh_t *right)
+static inline bool xntrbholder_is_lt(struct xntrbholder *left,
+				     struct xntrbholder *right)
 {
 	return left->date < right->date
 		|| (left->date == right->date && left->prio > right->prio);
 }
 
-void xntimerq_insert(xntimerq_t *q, xntimerh_t *holder)
+void xntrbq_insert(struct xntrbq *q, struct xntrbholder *holder)
 {
 	struct rb_node **new = &q->root.rb_node, *parent = NULL;
 
 	if (!q->head)
 		q->head = holder;
-	else if (xntimerh_is_lt(holder, q->head)) {
+	else if (xntrbholder_is_lt(holder, q->head)) {
 		parent = &q->head->link;
 		new = &parent->rb_left;
 		q->head = holder;
 	} else while (*new) {
-		xntimerh_t *i = container_of(*new, xntimerh_t, link);
+		struct xntrbholder *i = container_of(*new, struct xntrbholder, link);
 
 		parent = *new;
-		if (xntimerh_is_lt(holder, i))
+		if (xntrbholder_is_lt(holder, i))
 			new = &((*new)->rb_left);
 		else
 			new = &((*new)->rb_right);
@@ -974,6 +976,183 @@ void xntimerq_insert(xntimerq_t *q, xntimerh_t *holder)
 	rb_link_node(&holder->link, parent, new);
 	rb_insert_color(&holder->link, &q->root);
 }
-#endif
+EXPORT_SYMBOL_GPL(xntrbq_insert);
+
+int xntbheap_init(struct xntbheap *q, int capacity)
+{
+	q->nodes = kmalloc(capacity * sizeof(*q->nodes), GFP_KERNEL);
+	if (q->nodes == NULL)
+		return -ENOMEM;
+
+	q->base = q->nodes;
+	q->count = 0;
+	q->capacity = capacity;
+	INIT_LIST_HEAD(&q->overflow);
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(xntbheap_init);
+
+void xntbheap_destroy(struct xntbheap *q)
+{
+	if (q->nodes != q->base)
+		xnfree(q->nodes);
+	kfree(q->base);
+	q->nodes = NULL;
+	q->base = NULL;
+	q->capacity = 0;
+}
+EXPORT_SYMBOL_GPL(xntbheap_destroy);
+
+static inline void xntbheap_set(struct xntbheap *q, int pos,
+				struct xntbhholder *holder)
+{
+	q->nodes[pos] = holder;
+	holder->pos = pos;
+}
+
+static void xntbheap_sift_up(struct xntbheap *q, int pos)
+{
+	struct xntbhholder *holder = q->nodes[pos], *parent;
+	int ppos;
+
+	while (pos > 0) {
+		ppos = (pos - 1) / XNTBHEAP_ARITY;
+		parent = q->nodes[ppos];
+		if (!xntbheap_lt(holder, parent))
+			break;
+		xntbheap_set(q, pos, parent);
+		pos = ppos;
+	}
+
+	xntbheap_set(q, pos, holder);
+}
+
+static void xntbheap_sift_down(struct xntbheap *q, int pos)
+{
+	struct xntbhholder *holder = q->nodes[pos], *child;
+	int cpos, first, last, n;
+
+	for (;;) {
+		first = pos * XNTBHEAP_ARITY + 1;
+		if (first >= q->count)
+			break;
+		last = min(first + XNTBHEAP_ARITY, q->count);
+		cpos = first;
+		for (n = first + 1; n < last; n++)
+			if (xntbheap_lt(q->nodes[n], q->nodes[cpos]))
+				cpos = n;
+		child = q->nodes[cpos];
+		if (!xntbheap_lt(child, holder))
+			break;
+		xntbheap_set(q, pos, child);
+		pos = cpos;
+	}
+
+	xntbheap_set(q, pos, holder);
+}
+
+static void xntbheap_overflow_insert(struct xntbheap *q,
+				     struct xntbhholder *holder)
+{
+	struct xntbhholder *p;
+
+	holder->pos = XNTBHEAP_OVERFLOW;
+
+	list_for_each_entry_reverse(p, &q->overflow, link) {
+		if (!xntbheap_lt(holder, p)) {
+			list_add(&holder->link, &p->link);
+			return;
+		}
+	}
+
+	list_add(&holder->link, &q->overflow);
+}
+
+/*
+ * Double the node array when full. This may run in primary mode
+ * with the queue locked, so the larger array comes from the system
+ * heap. The array allocated at init time is kept until the heap is
+ * destroyed, since it cannot be released to the regular kernel
+ * allocator from that context.
+ */
+static bool xntbheap_grow(struct xntbheap *q)
+{
+	struct xntbhholder **nodes;
+
+	nodes = xnmalloc(q->capacity * 2 * sizeof(*nodes));
+	if (nodes == NULL)
+		return false;
+
+	memcpy(nodes, q->nodes, q->count * sizeof(*nodes));
+	if (q->nodes != q->base)
+		xnfree(q->nodes);
+
+	q->nodes = nodes;
+	q->capacity *= 2;
+
+	return true;
+}
+
+void xntbheap_insert(struct xntbheap *q, struct xntbhholder *holder)
+{
+	if (unlikely(q->count >= q->capacity) && !xntbheap_grow(q)) {
+		xntbheap_overflow_insert(q, holder);
+		return;
+	}
+
+	q->nodes[q->count] = holder;
+	xntbheap_sift_up(q, q->count++);
+}
+EXPORT_SYMBOL_GPL(xntbheap_insert);
+
+void xntbheap_remove(struct xntbheap *q, struct xntbhholder *holder)
+{
+	struct xntbhholder *last;
+	int pos = holder->pos;
+
+	if (pos == XNTBHEAP_OVERFLOW) {
+		list_del(&holder->link);
+		return;
+	}
+
+	last = q->nodes[--q->count];
+	if (last != holder) {
+		xntbheap_set(q, pos, last);
+		if (pos > 0 && xntbheap_lt(last, q->nodes[(pos - 1) / XNTBHEAP_ARITY]))
+			xntbheap_sift_up(q, pos);
+		else
+			xntbheap_sift_down(q, pos);
+	}
+
+	/* Refill the heap from the overflow list. */
+	if (unlikely(!list_empty(&q->overflow))) {
+		last = xntbheap_overflow_first(q);
+		list_del(&last->link);
+		q->nodes[q->count] = last;
+		xntbheap_sift_up(q, q->count++);
+	}
+}
+EXPORT_SYMBOL_GPL(xntbheap_remove);
+
+struct xntbhholder *xntbheap_second(struct xntbheap *q,
+				    struct xntbhholder *h)
+{
+	struct xntbhholder *second = NULL;
+	int n;
+
+	if (h->pos == XNTBHEAP_OVERFLOW) {
+		if (!list_is_last(&h->link, &q->overflow))
+			second = list_next_entry(h, link);
+		return xntbheap_minof(q->count ? q->nodes[0] : NULL, second);
+	}
+
+	/* @h is at the root, the runner-up is one of its children. */
+	for (n = 1; n <= XNTBHEAP_ARITY && n < q->count; n++)
+		second = xntbheap_minof(second, q->nodes[n]);
+
+	return xntbheap_minof(second, xntbheap_overflow_first(q));
+}
+EXPORT_SYMBOL_GPL(xntbheap_second);
 
 /** @} */
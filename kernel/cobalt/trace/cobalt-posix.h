@@ -161,7 +161,13 @@
 		__cobalt_symbolic_syscall(ftrace_puts),			\
 		__cobalt_symbolic_syscall(recvmmsg),			\
 		__cobalt_symbolic_syscall(sendmmsg),			\
-		__cobalt_symbolic_syscall(clock_adjtime))
+		__cobalt_symbolic_syscall(clock_adjtime),		\
+		__cobalt_symbolic_syscall(poll_create),			\
+		__cobalt_symbolic_syscall(poll_ctl),			\
+		__cobalt_symbolic_syscall(poll_wait),			\
+		__cobalt_symbolic_syscall(mq_shm_map),			\
+		__cobalt_symbolic_syscall(mq_shm_wait),			\
+		__cobalt_symbolic_syscall(mq_shm_wake))
 
 DECLARE_EVENT_CLASS(syscall_entry,
 	TP_PROTO(unsigned int nr),
@@ -32,6 +32,8 @@
 #include <asm/atomic.h>
 #include <linux/netdevice.h>
 #include <linux/semaphore.h>
+#include <linux/log2.h>
+#include <linux/hash.h>
 
 #include "rtcan_list.h"
 
@@ -43,6 +45,15 @@
  * for reception at the same time using Bind */
 #define RTCAN_MAX_RECEIVERS  CONFIG_XENO_DRIVERS_CAN_MAX_RECEIVERS
 
+/* Size of the receive filter hash table, at least twice the number of
+ * receivers. Filters are hashed by masked CAN ID and mask class. */
+#define RTCAN_RECV_HASH_BITS (ilog2(RTCAN_MAX_RECEIVERS) + 1)
+#define RTCAN_RECV_HASH_SIZE (1 << RTCAN_RECV_HASH_BITS)
+
+/* Number of distinct filter masks which can be indexed per controller.
+ * Filters using other masks, and inverted filters, are scanned linearly. */
+#define RTCAN_RECV_MCLASSES  8
+
 /* Suppress handling of refcount if module support is not enabled
  * or modules cannot be unloaded */
 
@@ -152,6 +163,17 @@ struct rtcan_device {
     /* Indicates the length of the empty list */
     int                             free_entries;
 
+    /* Index of the reception list used for dispatching received frames.
+     * Non-inverted filters sharing one of the RTCAN_RECV_MCLASSES masks
+     * are hashed by CAN ID, the remaining ones are put on the fallback
+     * list. Protected by rtcan_recv_list_lock like the lists above. */
+    struct rtcan_recv               *recv_hash[RTCAN_RECV_HASH_SIZE];
+    struct rtcan_recv               *recv_fallback;
+    struct {
+	can_id_t                    mask;
+	int                         refs;
+    } recv_mclass[RTCAN_RECV_MCLASSES];
+
     /* A few statistics counters */
     unsigned int tx_count;
     unsigned int rx_count;
@@ -43,6 +43,11 @@ struct rtcan_recv {
 					     */
     struct rtcan_recv       *next;          /* pointer to next list element
 					     */
+    struct rtcan_recv       *hnext;         /* next element in the same hash
+					     *   bucket or in the fallback
+					     *   list of the filter index */
+    int                     mclass;         /* mask class of the filter,
+					     *   -1 if in the fallback list */
 };
 
 
@@ -135,6 +135,49 @@ static void rtcan_rcv_deliver(struct rtcan_recv *recv_listener,
 }
 
 
+/*
+ * Deliver a frame to all sockets with a matching filter, except @skip.
+ * Rather than walking the reception list, only the hash bucket of the
+ * frame's ID is probed for each mask class in use, then the fallback
+ * list of inverted or unclassified filters is scanned.
+ */
+static void rtcan_rcv_dispatch(struct rtcan_device *dev,
+			       struct rtcan_skb *skb,
+			       struct rtcan_socket *skip)
+{
+    can_id_t can_id = skb->rb_frame.can_id;
+    struct rtcan_recv *recv_listener;
+    can_id_t key;
+    int i;
+
+    for (i = 0; i < RTCAN_RECV_MCLASSES; i++) {
+	if (dev->recv_mclass[i].refs == 0)
+	    continue;
+	key = can_id & dev->recv_mclass[i].mask;
+	recv_listener = dev->recv_hash[rtcan_recv_hash(key, i)];
+	while (recv_listener != NULL) {
+	    if (recv_listener->mclass == i &&
+		recv_listener->can_filter.can_id == key &&
+		recv_listener->sock != skip) {
+		recv_listener->match_count++;
+		rtcan_rcv_deliver(recv_listener, skb);
+	    }
+	    recv_listener = recv_listener->hnext;
+	}
+    }
+
+    recv_listener = dev->recv_fallback;
+    while (recv_listener != NULL) {
+	if (recv_listener->sock != skip &&
+	    rtcan_accept_msg(can_id, &recv_listener->can_filter)) {
+	    recv_listener->match_count++;
+	    rtcan_rcv_deliver(recv_listener, skb);
+	}
+	recv_listener = recv_listener->hnext;
+    }
+}
+
+
 void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
@@ -157,13 +200,7 @@ void rtcan_rcv(struct rtcan_device *dev, struct rtcan_skb *skb)
 	}
     } else {
 	dev->rx_count++;
-	while (recv_listener != NULL) {
-	    if (rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-		recv_listener->match_count++;
-		rtcan_rcv_deliver(recv_listener, skb);
-	    }
-	    recv_listener = recv_listener->next;
-	}
+	rtcan_rcv_dispatch(dev, skb, NULL);
     }
 }
 
@@ -191,22 +228,12 @@ void rtcan_tx_push(struct rtcan_device *dev, struct rtcan_socket *sock,
 void rtcan_loopback(struct rtcan_device *dev)
 {
     nanosecs_abs_t timestamp = rtdm_clock_read();
-    /* Entry in reception list, begin with head */
-    struct rtcan_recv *recv_listener = dev->recv_list;
-    struct rtcan_rb_frame *frame = &dev->tx_skb.rb_frame;
 
     memcpy((void *)&dev->tx_skb.rb_frame + dev->tx_skb.rb_frame_size,
 	   &timestamp, RTCAN_TIMESTAMP_SIZE);
 
-    while (recv_listener != NULL) {
-	dev->rx_count++;
-	if ((dev->tx_socket != recv_listener->sock) &&
-	    rtcan_accept_msg(frame->can_id, &recv_listener->can_filter)) {
-	    recv_listener->match_count++;
-	    rtcan_rcv_deliver(recv_listener, &dev->tx_skb);
-	}
-	recv_listener = recv_listener->next;
-    }
+    dev->rx_count++;
+    rtcan_rcv_dispatch(dev, &dev->tx_skb, dev->tx_socket);
     dev->tx_socket = NULL;
 }
 
@@ -29,6 +29,12 @@ int rtcan_raw_check_filter(struct rtcan_socket *sock,
 int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex);
 void rtcan_raw_remove_filter(struct rtcan_socket *sock);
 
+static inline unsigned int rtcan_recv_hash(can_id_t can_id, int mclass)
+{
+    return (hash_32(can_id, RTCAN_RECV_HASH_BITS) + mclass) &
+	(RTCAN_RECV_HASH_SIZE - 1);
+}
+
 void rtcan_rcv(struct rtcan_device *rtcandev, struct rtcan_skb *skb);
 
 void rtcan_loopback(struct rtcan_device *rtcandev);
@@ -68,6 +68,71 @@ static inline void rtcan_raw_mount_filter(can_filter_t *recv_filter,
 }
 
 
+/*
+ * Add a reception list entry to the filter index of the device.
+ *
+ * Entries are hashed by CAN ID within a class of filters sharing the
+ * same mask, so that rtcan_rcv() only has to probe one bucket per mask
+ * in use instead of walking the whole reception list. Inverted filters
+ * and masks beyond RTCAN_RECV_MCLASSES go to a fallback list which is
+ * scanned linearly.
+ */
+static void rtcan_raw_index_filter(struct rtcan_device *dev,
+				   struct rtcan_recv *recv)
+{
+    can_filter_t *filter = &recv->can_filter;
+    int i, free_mclass = -1;
+    unsigned int h;
+
+    if (!(filter->can_mask & CAN_INV_FILTER)) {
+	for (i = 0; i < RTCAN_RECV_MCLASSES; i++) {
+	    if (dev->recv_mclass[i].refs == 0) {
+		if (free_mclass < 0)
+		    free_mclass = i;
+	    } else if (dev->recv_mclass[i].mask == filter->can_mask)
+		goto hash;
+	}
+	if (free_mclass >= 0) {
+	    i = free_mclass;
+	    dev->recv_mclass[i].mask = filter->can_mask;
+	    goto hash;
+	}
+    }
+
+    recv->mclass = -1;
+    recv->hnext = dev->recv_fallback;
+    dev->recv_fallback = recv;
+    return;
+
+ hash:
+    dev->recv_mclass[i].refs++;
+    recv->mclass = i;
+    h = rtcan_recv_hash(filter->can_id, i);
+    recv->hnext = dev->recv_hash[h];
+    dev->recv_hash[h] = recv;
+}
+
+
+static void rtcan_raw_unindex_filter(struct rtcan_device *dev,
+				     struct rtcan_recv *recv)
+{
+    struct rtcan_recv **pp;
+
+    if (recv->mclass < 0)
+	pp = &dev->recv_fallback;
+    else {
+	pp = &dev->recv_hash[rtcan_recv_hash(recv->can_filter.can_id,
+					     recv->mclass)];
+	dev->recv_mclass[recv->mclass].refs--;
+    }
+
+    while (*pp != recv)
+	pp = &(*pp)->hnext;
+    *pp = recv->hnext;
+    recv->hnext = NULL;
+}
+
+
 int rtcan_raw_check_filter(struct rtcan_socket *sock, int ifindex,
 			   struct rtcan_filter_list *flist)
 {
@@ -162,6 +227,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 				   &sock->flist->flist[0]);
 	    last->match_count = 0;
 	    last->sock = sock;
+	    rtcan_raw_index_filter(dev, last);
 	    for (j = 1; j < flistlen; j++) {
 		/* Register remaining filters */
 		last = last->next;
@@ -169,6 +235,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 				       &sock->flist->flist[j]);
 		last->sock = sock;
 		last->match_count = 0;
+		rtcan_raw_index_filter(dev, last);
 	    }
 	    /* Decrease free entries counter by length of filter list */
 	    dev->free_entries -= flistlen;
@@ -179,6 +246,7 @@ int rtcan_raw_add_filter(struct rtcan_socket *sock, int ifindex)
 	    last->can_filter.can_id = last->can_filter.can_mask = 0;
 	    last->sock = sock;
 	    last->match_count = 0;
+	    rtcan_raw_index_filter(dev, last);
 	    /* Decrease free entries counter by 1
 	     * (one filter for all CAN frames) */
 	    dev->free_entries--;
@@ -234,8 +302,11 @@ void rtcan_raw_remove_filter(struct rtcan_socket *sock)
 
 	/* Now go to the end of the old filter list */
 	last = next;
-	for (j = 1; j < sock->flistlen; j++)
+	rtcan_raw_unindex_filter(dev, last);
+	for (j = 1; j < sock->flistlen; j++) {
 	    last = last->next;
+	    rtcan_raw_unindex_filter(dev, last);
+	}
 
 	/* Detach found first list entry from reception list */
 	if (first)
@@ -22,6 +22,8 @@
 #include <linux/kernel.h>
 #include <linux/slab.h>
 #include <linux/poll.h>
+#include <linux/log2.h>
+#include <linux/mm.h>
 #include <cobalt/kernel/heap.h>
 #include <cobalt/kernel/map.h>
 #include <cobalt/kernel/bufd.h>
@@ -30,6 +32,18 @@
 
 #define BUFP_SOCKET_MAGIC 0xa61a61a6
 
+/* Free-running u32 indices may not span more than half their range. */
+#define BUFP_RING_MAXSZ  (1UL << 30)
+
+struct bufp_ring_mem {
+	atomic_t refs;
+	struct bufp_ring *ring;
+	void *data;
+	/* Trusted copy of ring->size, which userland may scribble. */
+	u32 size;
+	size_t memsz;
+};
+
 struct bufp_socket {
 	int magic;
 	struct sockaddr_ipc name;
@@ -49,6 +63,10 @@ struct bufp_socket {
 	rtdm_event_t i_event;
 	rtdm_event_t o_event;
 
+	struct bufp_ring_mem *rmem;
+	rtdm_mutex_t rx_lock;
+	rtdm_mutex_t tx_lock;
+
 	nanosecs_rel_t rx_timeout;
 	nanosecs_rel_t tx_timeout;
 
@@ -71,6 +89,7 @@ static struct xnmap *portmap;
 #define _BUFP_BINDING   0
 #define _BUFP_BOUND     1
 #define _BUFP_CONNECTED 2
+#define _BUFP_SHMEM     3
 
 #ifdef CONFIG_XENO_OPT_VFILE
 
@@ -124,11 +143,109 @@ static int bufp_socket(struct rtdm_fd *fd)
 	*sk->label = 0;
 	rtdm_event_init(&sk->i_event, 0);
 	rtdm_event_init(&sk->o_event, 0);
+	sk->rmem = NULL;
+	rtdm_mutex_init(&sk->rx_lock);
+	rtdm_mutex_init(&sk->tx_lock);
 	sk->priv = priv;
 
 	return 0;
 }
 
+static inline u32 bufp_ring_load(const __u32 *p)
+{
+	return *(volatile const __u32 *)p;
+}
+
+static inline void bufp_ring_store(__u32 *p, u32 v)
+{
+	*(volatile __u32 *)p = v;
+}
+
+static inline u32 bufp_ring_used(struct bufp_ring_mem *rmem)
+{
+	return bufp_ring_load(&rmem->ring->head) -
+		bufp_ring_load(&rmem->ring->tail);
+}
+
+/*
+ * A producer may store a record of @recsz bytes if the ring has room
+ * for it, including the padding which may be needed to keep the
+ * record contiguous. Indices coming from shared memory are not
+ * trusted: the producer index is sampled once into @headp, which
+ * the caller must use exclusively for storing the record, and
+ * -EPROTO is returned if it is misaligned or too far ahead of the
+ * consumer index.
+ */
+static inline int bufp_ring_has_room(struct bufp_ring_mem *rmem,
+				     u32 recsz, u32 *headp)
+{
+	u32 head, used, room;
+
+	head = bufp_ring_load(&rmem->ring->head);
+	used = head - bufp_ring_load(&rmem->ring->tail);
+	if ((head & (BUFP_RING_ALIGN - 1)) || used > rmem->size)
+		return -EPROTO;
+
+	*headp = head;
+	room = rmem->size - (head & (rmem->size - 1));
+	if (room < recsz)
+		recsz += room;
+
+	return rmem->size - used >= recsz;
+}
+
+static void bufp_ring_put(struct bufp_ring_mem *rmem)
+{
+	if (atomic_dec_and_test(&rmem->refs)) {
+		xnheap_vfree(rmem->ring);
+		kfree(rmem);
+	}
+}
+
+static int __bufp_alloc_ring(struct bufp_socket *sk)
+{
+	struct bufp_ring_mem *rmem;
+	size_t size;
+
+	if (sk->bufsz > BUFP_RING_MAXSZ)
+		return -EINVAL;
+
+	size = roundup_pow_of_two(max_t(size_t, sk->bufsz, PAGE_SIZE));
+
+	rmem = kmalloc(sizeof(*rmem), GFP_KERNEL);
+	if (rmem == NULL)
+		return -ENOMEM;
+
+	/* The header page comes first, followed by the data area. */
+	rmem->memsz = PAGE_SIZE + size;
+	rmem->ring = xnheap_vmalloc(rmem->memsz);
+	if (rmem->ring == NULL) {
+		kfree(rmem);
+		return -ENOMEM;
+	}
+
+	/* This memory will be visible from userland. */
+	memset(rmem->ring, 0, rmem->memsz);
+	rmem->ring->size = size;
+	rmem->ring->data_offset = PAGE_SIZE;
+	rmem->data = (void *)rmem->ring + PAGE_SIZE;
+	rmem->size = size;
+	atomic_set(&rmem->refs, 1);
+	sk->rmem = rmem;
+
+	return 0;
+}
+
+static void __bufp_free_buffer(struct bufp_socket *sk)
+{
+	if (sk->rmem) {
+		/* Userland mappings may still refer to the ring. */
+		bufp_ring_put(sk->rmem);
+		sk->rmem = NULL;
+	} else if (sk->bufmem)
+		xnheap_vfree(sk->bufmem);
+}
+
 static void bufp_close(struct rtdm_fd *fd)
 {
 	struct rtipc_private *priv = rtdm_fd_to_private(fd);
@@ -137,6 +254,8 @@ static void bufp_close(struct rtdm_fd *fd)
 
 	rtdm_event_destroy(&sk->i_event);
 	rtdm_event_destroy(&sk->o_event);
+	rtdm_mutex_destroy(&sk->rx_lock);
+	rtdm_mutex_destroy(&sk->tx_lock);
 
 	if (test_bit(_BUFP_BOUND, &sk->status)) {
 		if (sk->name.sipc_port > -1) {
@@ -148,8 +267,7 @@ static void bufp_close(struct rtdm_fd *fd)
 		if (sk->handle)
 			xnregistry_remove(sk->handle);
 
-		if (sk->bufmem)
-			xnheap_vfree(sk->bufmem);
+		__bufp_free_buffer(sk);
 	}
 
 	kfree(sk);
@@ -294,6 +412,144 @@ out:
 	return ret;
 }
 
+static int bufp_ring_wait_data(struct bufp_socket *sk, int flags,
+			       rtdm_toseq_t *toseq) /* nklock held */
+{
+	struct bufp_ring *ring = sk->rmem->ring;
+	int ret;
+
+	for (;;) {
+		if (bufp_ring_used(sk->rmem))
+			return 0;
+
+		if (flags & MSG_DONTWAIT)
+			return -EWOULDBLOCK;
+		/*
+		 * Tell the producer that we are about to sleep, then
+		 * check again for data it may have committed without
+		 * noticing our flag.
+		 */
+		ring->flags |= BUFP_RING_RXWAIT;
+		smp_mb();
+		if (bufp_ring_used(sk->rmem))
+			return 0;
+
+		ret = rtdm_event_timedwait(&sk->i_event,
+					   sk->rx_timeout, toseq);
+		if (unlikely(ret)) {
+			ring->flags &= ~BUFP_RING_RXWAIT;
+			return ret;
+		}
+	}
+}
+
+static void bufp_ring_wakeup_writers(struct bufp_socket *sk) /* nklock held */
+{
+	sk->rmem->ring->flags &= ~BUFP_RING_TXWAIT;
+	xnselect_signal(&sk->priv->send_block, POLLOUT);
+	/* This call rescheds internally. */
+	rtdm_event_pulse(&sk->o_event);
+}
+
+static ssize_t __bufp_ring_recvmsg(struct rtdm_fd *fd,
+				   struct bufp_socket *sk,
+				   struct iovec *iov, int iovlen, int flags)
+{
+	struct bufp_ring_mem *rmem = sk->rmem;
+	struct bufp_ring *ring = rmem->ring;
+	u32 head, tail, off, room, len;
+	struct bufp_ring_rec *rec;
+	ssize_t rdlen, vlen, ret;
+	struct xnbufd bufd;
+	rtdm_toseq_t toseq;
+	rtdm_lockctx_t s;
+	void *p;
+	int nvec;
+
+	rtdm_toseq_init(&toseq, sk->rx_timeout);
+
+	/* The ring has a single consumer. */
+	ret = rtdm_mutex_timedlock(&sk->rx_lock, flags & MSG_DONTWAIT ?
+				   RTDM_TIMEOUT_NONE : sk->rx_timeout, &toseq);
+	if (ret)
+		return ret;
+
+	for (;;) {
+		cobalt_atomic_enter(s);
+		ret = bufp_ring_wait_data(sk, flags, &toseq);
+		cobalt_atomic_leave(s);
+		if (ret)
+			goto out;
+
+		/* Read the indices before the record. */
+		smp_rmb();
+		head = bufp_ring_load(&ring->head);
+		tail = bufp_ring_load(&ring->tail);
+		if ((tail & (BUFP_RING_ALIGN - 1)) || head - tail > rmem->size)
+			goto corrupt;
+
+		off = tail & (rmem->size - 1);
+		room = rmem->size - off;
+		rec = rmem->data + off;
+		if (!(rec->flags & BUFP_RING_PAD))
+			break;
+
+		/* Padding always extends to the end of the data area. */
+		bufp_ring_store(&ring->tail, tail + room);
+	}
+
+	/* Sample the length once, the producer may be rogue. */
+	len = bufp_ring_load(&rec->len);
+	if (len > room - sizeof(*rec) ||
+	    BUFP_RING_RECSZ(len) > head - tail)
+		goto corrupt;
+
+	/*
+	 * Copy the record to the vector cells, dropping whatever does
+	 * not fit in there.
+	 */
+	p = rec + 1;
+	for (nvec = 0, rdlen = len; nvec < iovlen && rdlen > 0; nvec++) {
+		if (iov[nvec].iov_len == 0)
+			continue;
+		vlen = rdlen >= iov[nvec].iov_len ? iov[nvec].iov_len : rdlen;
+		if (rtdm_fd_is_user(fd)) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, p, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else {
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_from_kmem(&bufd, p, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0)
+			goto out;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		p += vlen;
+		rdlen -= vlen;
+	}
+
+	/* Complete the reads before releasing the space. */
+	smp_mb();
+	cobalt_atomic_enter(s);
+	bufp_ring_store(&ring->tail, tail + BUFP_RING_RECSZ(len));
+	smp_mb();
+	if (bufp_ring_used(rmem) == 0) /* -> non-readable */
+		xnselect_signal(&sk->priv->recv_block, 0);
+	if (ring->flags & BUFP_RING_TXWAIT)
+		bufp_ring_wakeup_writers(sk);
+	cobalt_atomic_leave(s);
+	ret = len - rdlen;
+out:
+	rtdm_mutex_unlock(&sk->rx_lock);
+
+	return ret;
+corrupt:
+	ret = -EPROTO;
+	goto out;
+}
+
 static ssize_t __bufp_recvmsg(struct rtdm_fd *fd,
 			      struct iovec *iov, int iovlen, int flags,
 			      struct sockaddr_ipc *saddr)
@@ -310,6 +566,14 @@ static ssize_t __bufp_recvmsg(struct rtdm_fd *fd,
 	len = rtdm_get_iov_flatlen(iov, iovlen);
 	if (len == 0)
 		return 0;
+
+	if (sk->rmem) {
+		ret = __bufp_ring_recvmsg(fd, sk, iov, iovlen, flags);
+		if (ret >= 0 && saddr)
+			*saddr = sk->name;
+		return ret;
+	}
+
 	/*
 	 * We may only return complete messages to readers, so there
 	 * is no point in waiting for messages which are larger than
@@ -532,6 +796,146 @@ out:
 	return ret;
 }
 
+static int bufp_ring_wait_room(struct bufp_socket *rsk,
+			       struct bufp_socket *sk, u32 recsz,
+			       int flags, rtdm_toseq_t *toseq,
+			       u32 *headp) /* nklock held */
+{
+	struct bufp_ring *ring = rsk->rmem->ring;
+	int ret;
+
+	for (;;) {
+		ret = bufp_ring_has_room(rsk->rmem, recsz, headp);
+		if (ret)
+			break;
+
+		if (flags & MSG_DONTWAIT)
+			return -EWOULDBLOCK;
+
+		/* Same as bufp_ring_wait_data(), for the consumer. */
+		ring->flags |= BUFP_RING_TXWAIT;
+		smp_mb();
+		ret = bufp_ring_has_room(rsk->rmem, recsz, headp);
+		if (ret)
+			break;
+
+		ret = rtdm_event_timedwait(&rsk->o_event,
+					   sk->tx_timeout, toseq);
+		if (unlikely(ret))
+			break;
+	}
+
+	if (ret > 0)
+		return 0;
+
+	ring->flags &= ~BUFP_RING_TXWAIT;
+
+	return ret;
+}
+
+static void bufp_ring_wakeup_reader(struct bufp_socket *rsk) /* nklock held */
+{
+	rsk->rmem->ring->flags &= ~BUFP_RING_RXWAIT;
+	xnselect_signal(&rsk->priv->recv_block, POLLIN);
+	/* This call rescheds internally. */
+	rtdm_event_pulse(&rsk->i_event);
+}
+
+static ssize_t __bufp_ring_sendmsg(struct rtdm_fd *fd,
+				   struct bufp_socket *rsk,
+				   struct bufp_socket *sk,
+				   struct iovec *iov, int iovlen,
+				   ssize_t len, int flags)
+{
+	struct bufp_ring_mem *rmem = rsk->rmem;
+	struct bufp_ring *ring = rmem->ring;
+	struct bufp_ring_rec *rec;
+	u32 head, recsz, room;
+	rtdm_toseq_t toseq;
+	struct xnbufd bufd;
+	ssize_t vlen, ret;
+	rtdm_lockctx_t s;
+	void *p;
+	int nvec;
+
+	/*
+	 * Half the ring is the largest record we can always store,
+	 * regardless of where the producer index stands.
+	 */
+	if (len > rmem->size / 2 - sizeof(*rec))
+		return -EINVAL;
+
+	recsz = BUFP_RING_RECSZ(len);
+
+	rtdm_toseq_init(&toseq, sk->tx_timeout);
+
+	/* The ring has a single producer. */
+	ret = rtdm_mutex_timedlock(&rsk->tx_lock, flags & MSG_DONTWAIT ?
+				   RTDM_TIMEOUT_NONE : sk->tx_timeout, &toseq);
+	if (ret)
+		return ret;
+
+	cobalt_atomic_enter(s);
+	ret = bufp_ring_wait_room(rsk, sk, recsz, flags, &toseq, &head);
+	cobalt_atomic_leave(s);
+	if (ret)
+		goto out;
+
+	/*
+	 * The record is not visible to the consumer until the
+	 * producer index moves, so we may copy the data without
+	 * holding the nucleus lock. Only the producer index
+	 * validated while waiting for room may be used from now
+	 * on, userland could have changed the shared one since.
+	 */
+	room = rmem->size - (head & (rmem->size - 1));
+	if (room < recsz) {
+		rec = rmem->data + (head & (rmem->size - 1));
+		rec->len = room - sizeof(*rec);
+		rec->flags = BUFP_RING_PAD;
+		head += room;
+	}
+
+	rec = rmem->data + (head & (rmem->size - 1));
+	rec->len = len;
+	rec->flags = 0;
+	p = rec + 1;
+
+	for (nvec = 0; nvec < iovlen; nvec++) {
+		vlen = iov[nvec].iov_len;
+		if (vlen == 0)
+			continue;
+		if (rtdm_fd_is_user(fd)) {
+			xnbufd_map_uread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(p, &bufd, vlen);
+			xnbufd_unmap_uread(&bufd);
+		} else {
+			xnbufd_map_kread(&bufd, iov[nvec].iov_base, vlen);
+			ret = xnbufd_copy_to_kmem(p, &bufd, vlen);
+			xnbufd_unmap_kread(&bufd);
+		}
+		if (ret < 0)
+			goto out;
+		iov[nvec].iov_base += vlen;
+		iov[nvec].iov_len -= vlen;
+		p += vlen;
+	}
+
+	/* Publish the record before the index. */
+	smp_wmb();
+	cobalt_atomic_enter(s);
+	bufp_ring_store(&ring->head, head + recsz);
+	smp_mb();
+	if (ring->flags & BUFP_RING_RXWAIT)
+		bufp_ring_wakeup_reader(rsk);
+	cobalt_atomic_leave(s);
+	ret = len;
+out:
+	rtdm_mutex_unlock(&rsk->tx_lock);
+
+	return ret;
+}
+
 static ssize_t __bufp_sendmsg(struct rtdm_fd *fd,
 			      struct iovec *iov, int iovlen, int flags,
 			      const struct sockaddr_ipc *daddr)
@@ -562,6 +966,12 @@ static ssize_t __bufp_sendmsg(struct rtdm_fd *fd,
 		return -ECONNREFUSED;
 	}
 
+	if (rsk->rmem) {
+		ret = __bufp_ring_sendmsg(fd, rsk, sk, iov, iovlen, len, flags);
+		rtdm_fd_unlock(rfd);
+		return ret;
+	}
+
 	/*
 	 * We may only send complete messages, so there is no point in
 	 * accepting messages which are larger than what the buffer
@@ -709,10 +1119,16 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 	if (sk->bufsz == 0)
 		return -ENOBUFS;
 
-	sk->bufmem = xnheap_vmalloc(sk->bufsz);
-	if (sk->bufmem == NULL) {
-		ret = -ENOMEM;
-		goto fail;
+	if (test_bit(_BUFP_SHMEM, &sk->status)) {
+		ret = __bufp_alloc_ring(sk);
+		if (ret)
+			goto fail;
+	} else {
+		sk->bufmem = xnheap_vmalloc(sk->bufsz);
+		if (sk->bufmem == NULL) {
+			ret = -ENOMEM;
+			goto fail;
+		}
 	}
 
 	sk->name = *sa;
@@ -724,7 +1140,7 @@ static int __bufp_bind_socket(struct rtipc_private *priv,
 		ret = xnregistry_enter(sk->label, sk,
 				       &sk->handle, &__bufp_pnode.node);
 		if (ret) {
-			xnheap_vfree(sk->bufmem);
+			__bufp_free_buffer(sk);
 			goto fail;
 		}
 	}
@@ -829,7 +1245,7 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 	struct timeval tv;
 	rtdm_lockctx_t s;
 	size_t len;
-	int ret;
+	int ret, val;
 
 	ret = rtipc_get_sockoptin(fd, &sopt, arg);
 	if (ret)
@@ -902,6 +1318,23 @@ static int __bufp_setsockopt(struct bufp_socket *sk,
 		cobalt_atomic_leave(s);
 		break;
 
+	case BUFP_SHMEM:
+		if (sopt.optlen < sizeof(val))
+			return -EINVAL;
+		if (rtipc_get_arg(fd, &val, sopt.optval, sizeof(val)))
+			return -EFAULT;
+		cobalt_atomic_enter(s);
+		/* The buffer layout is decided upon binding. */
+		if (test_bit(_BUFP_BOUND, &sk->status) ||
+		    test_bit(_BUFP_BINDING, &sk->status))
+			ret = -EALREADY;
+		else if (val)
+			__set_bit(_BUFP_SHMEM, &sk->status);
+		else
+			__clear_bit(_BUFP_SHMEM, &sk->status);
+		cobalt_atomic_leave(s);
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -915,10 +1348,13 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 {
 	struct _rtdm_getsockopt_args sopt;
 	struct rtipc_port_label plabel;
+	struct bufp_ringsz ringsz;
+	struct bufp_socket *rsk;
+	struct rtdm_fd *rfd;
 	struct timeval tv;
 	rtdm_lockctx_t s;
 	socklen_t len;
-	int ret;
+	int ret, val;
 
 	ret = rtipc_get_sockoptout(fd, &sopt, arg);
 	if (ret)
@@ -966,6 +1402,34 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 			return -EFAULT;
 		break;
 
+	case BUFP_SHMEM:
+		if (len < sizeof(val))
+			return -EINVAL;
+		val = test_bit(_BUFP_SHMEM, &sk->status);
+		if (rtipc_put_arg(fd, sopt.optval, &val, sizeof(val)))
+			return -EFAULT;
+		break;
+
+	case BUFP_RINGSZ:
+		if (len < sizeof(ringsz))
+			return -EINVAL;
+		ringsz.rx = ringsz.tx = 0;
+		cobalt_atomic_enter(s);
+		if (sk->rmem)
+			ringsz.rx = sk->rmem->memsz;
+		if (sk->peer.sipc_port >= 0) {
+			rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+			if (rfd) {
+				rsk = rtipc_fd_to_state(rfd);
+				if (rsk->rmem)
+					ringsz.tx = rsk->rmem->memsz;
+			}
+		}
+		cobalt_atomic_leave(s);
+		if (rtipc_put_arg(fd, sopt.optval, &ringsz, sizeof(ringsz)))
+			return -EFAULT;
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -973,6 +1437,112 @@ static int __bufp_getsockopt(struct bufp_socket *sk,
 	return ret;
 }
 
+static struct rtdm_fd *__bufp_lock_peer(struct bufp_socket *sk)
+{
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+
+	cobalt_atomic_enter(s);
+	rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+	if (rfd && rtdm_fd_lock(rfd) < 0)
+		rfd = NULL;
+	cobalt_atomic_leave(s);
+
+	return rfd;
+}
+
+static int __bufp_ring_waitin(struct bufp_socket *sk)
+{
+	rtdm_toseq_t toseq;
+	rtdm_lockctx_t s;
+	int ret;
+
+	if (sk->rmem == NULL)
+		return -ENODEV;
+
+	rtdm_toseq_init(&toseq, sk->rx_timeout);
+	cobalt_atomic_enter(s);
+	ret = bufp_ring_wait_data(sk, 0, &toseq);
+	cobalt_atomic_leave(s);
+
+	return ret;
+}
+
+static int __bufp_ring_waitout(struct bufp_socket *sk,
+			       struct rtdm_fd *fd, void *arg)
+{
+	struct bufp_socket *rsk;
+	rtdm_toseq_t toseq;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+	__u32 len, head;
+	int ret;
+
+	if (rtipc_get_arg(fd, &len, arg, sizeof(len)))
+		return -EFAULT;
+
+	if (sk->peer.sipc_port < 0)
+		return -EDESTADDRREQ;
+
+	rfd = __bufp_lock_peer(sk);
+	if (rfd == NULL)
+		return -ECONNRESET;
+
+	rsk = rtipc_fd_to_state(rfd);
+	if (!test_bit(_BUFP_BOUND, &rsk->status))
+		ret = -ECONNREFUSED;
+	else if (rsk->rmem == NULL)
+		ret = -ENODEV;
+	else if (len > rsk->rmem->size / 2 - sizeof(struct bufp_ring_rec))
+		ret = -EINVAL;
+	else {
+		rtdm_toseq_init(&toseq, sk->tx_timeout);
+		cobalt_atomic_enter(s);
+		ret = bufp_ring_wait_room(rsk, sk, BUFP_RING_RECSZ(len),
+					  0, &toseq, &head);
+		cobalt_atomic_leave(s);
+	}
+
+	rtdm_fd_unlock(rfd);
+
+	return ret;
+}
+
+static int __bufp_ring_notify(struct bufp_socket *sk)
+{
+	struct bufp_socket *rsk;
+	struct rtdm_fd *rfd;
+	rtdm_lockctx_t s;
+
+	cobalt_atomic_enter(s);
+
+	/* We may have consumed data from our ring. */
+	if (sk->rmem) {
+		if (bufp_ring_used(sk->rmem) == 0)
+			xnselect_signal(&sk->priv->recv_block, 0);
+		if (sk->rmem->ring->flags & BUFP_RING_TXWAIT)
+			bufp_ring_wakeup_writers(sk);
+	}
+
+	/*
+	 * We may have produced data to the peer ring. Holding the
+	 * nucleus lock, the peer may not go away under our feet.
+	 */
+	if (sk->peer.sipc_port >= 0) {
+		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
+		if (rfd) {
+			rsk = rtipc_fd_to_state(rfd);
+			if (rsk->rmem && bufp_ring_used(rsk->rmem) &&
+			    (rsk->rmem->ring->flags & BUFP_RING_RXWAIT))
+				bufp_ring_wakeup_reader(rsk);
+		}
+	}
+
+	cobalt_atomic_leave(s);
+
+	return 0;
+}
+
 static int __bufp_ioctl(struct rtdm_fd *fd,
 			unsigned int request, void *arg)
 {
@@ -1024,6 +1594,18 @@ static int __bufp_ioctl(struct rtdm_fd *fd,
 		ret = -ENOTCONN;
 		break;
 
+	case BUFP_RTIOC_WAITIN:
+		ret = __bufp_ring_waitin(sk);
+		break;
+
+	case BUFP_RTIOC_WAITOUT:
+		ret = __bufp_ring_waitout(sk, fd, arg);
+		break;
+
+	case BUFP_RTIOC_NOTIFY:
+		ret = __bufp_ring_notify(sk);
+		break;
+
 	default:
 		ret = -EINVAL;
 	}
@@ -1040,6 +1622,12 @@ static int bufp_ioctl(struct rtdm_fd *fd,
 	COMPAT_CASE(_RTIOC_BIND):
 		if (rtdm_in_rt_context())
 			return -ENOSYS;	/* Try downgrading to NRT */
+		ret = __bufp_ioctl(fd, request, arg);
+		break;
+	case BUFP_RTIOC_WAITIN:
+	case BUFP_RTIOC_WAITOUT:
+		if (!rtdm_in_rt_context())
+			return -ENOSYS;	/* Try upgrading to RT */
 	default:
 		ret = __bufp_ioctl(fd, request, arg);
 	}
@@ -1054,8 +1642,19 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 	unsigned int mask = 0;
 	struct rtdm_fd *rfd;
 
-	if (test_bit(_BUFP_BOUND, &sk->status) && sk->fillsz > 0)
-		mask |= POLLIN;
+	if (test_bit(_BUFP_BOUND, &sk->status)) {
+		if (sk->rmem) {
+			/*
+			 * Waiters on a shared ring depend on the
+			 * producer noticing them.
+			 */
+			if (bufp_ring_used(sk->rmem))
+				mask |= POLLIN;
+			else
+				sk->rmem->ring->flags |= BUFP_RING_RXWAIT;
+		} else if (sk->fillsz > 0)
+			mask |= POLLIN;
+	}
 
 	/*
 	 * If the socket is connected, POLLOUT means that the peer
@@ -1067,7 +1666,12 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 		rfd = xnmap_fetch_nocheck(portmap, sk->peer.sipc_port);
 		if (rfd) {
 			rsk = rtipc_fd_to_state(rfd);
-			if (rsk->fillsz < rsk->bufsz)
+			if (rsk->rmem) {
+				if (bufp_ring_used(rsk->rmem) < rsk->rmem->size)
+					mask |= POLLOUT;
+				else
+					rsk->rmem->ring->flags |= BUFP_RING_TXWAIT;
+			} else if (rsk->fillsz < rsk->bufsz)
 				mask |= POLLOUT;
 		}
 	} else
@@ -1076,6 +1680,83 @@ static unsigned int bufp_pollstate(struct rtdm_fd *fd) /* atomic */
 	return mask;
 }
 
+static void bufp_ring_vmopen(struct vm_area_struct *vma)
+{
+	struct bufp_ring_mem *rmem = vma->vm_private_data;
+
+	atomic_inc(&rmem->refs);
+}
+
+static void bufp_ring_vmclose(struct vm_area_struct *vma)
+{
+	bufp_ring_put(vma->vm_private_data);
+}
+
+static struct vm_operations_struct bufp_ring_vmops = {
+	.open = bufp_ring_vmopen,
+	.close = bufp_ring_vmclose,
+};
+
+static int bufp_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+	struct rtipc_private *priv = rtdm_fd_to_private(fd);
+	struct bufp_socket *sk = priv->state, *rsk;
+	struct bufp_ring_mem *rmem = NULL;
+	struct rtdm_fd *rfd;
+	int ret;
+
+	/*
+	 * The page offset selects the ring to map: ours for
+	 * consuming, or the one of the peer for producing. Each
+	 * mapping holds a reference on the ring memory, which may
+	 * outlive the socket it belongs to.
+	 */
+	switch (vma->vm_pgoff) {
+	case BUFP_RING_RX_PGOFF:
+		if (test_bit(_BUFP_BOUND, &sk->status) && sk->rmem) {
+			rmem = sk->rmem;
+			atomic_inc(&rmem->refs);
+		}
+		break;
+	case BUFP_RING_TX_PGOFF:
+		if (sk->peer.sipc_port < 0)
+			return -EDESTADDRREQ;
+		rfd = __bufp_lock_peer(sk);
+		if (rfd == NULL)
+			return -ECONNRESET;
+		rsk = rtipc_fd_to_state(rfd);
+		if (test_bit(_BUFP_BOUND, &rsk->status) && rsk->rmem) {
+			rmem = rsk->rmem;
+			atomic_inc(&rmem->refs);
+		}
+		rtdm_fd_unlock(rfd);
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	if (rmem == NULL)
+		return -ENODEV;
+
+	if (vma->vm_end - vma->vm_start > rmem->memsz) {
+		ret = -EINVAL;
+		goto fail;
+	}
+
+	ret = rtdm_mmap_vmem(vma, rmem->ring);
+	if (ret)
+		goto fail;
+
+	vma->vm_ops = &bufp_ring_vmops;
+	vma->vm_private_data = rmem;
+
+	return 0;
+fail:
+	bufp_ring_put(rmem);
+
+	return ret;
+}
+
 static int bufp_init(void)
 {
 	portmap = xnmap_create(CONFIG_XENO_OPT_BUFP_NRPORT, 0, 0);
@@ -1104,5 +1785,6 @@ struct rtipc_protocol bufp_proto_driver = {
 		.write = bufp_write,
 		.ioctl = bufp_ioctl,
 		.pollstate = bufp_pollstate,
+		.mmap = bufp_mmap,
 	}
 };
@@ -3285,8 +3285,25 @@ static int e1000_tx_map(struct e1000_adapter *adapter,
 	return 1;
 }
 
+static void e1000_tx_kick(struct e1000_adapter *adapter)
+{
+	struct e1000_ring *tx_ring = adapter->tx_ring;
+	unsigned int i = tx_ring->next_to_use;
+
+	if (adapter->flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
+		e1000e_update_tdt_wa(adapter, i);
+	else
+		writel(i, adapter->hw.hw_addr + tx_ring->tail);
+
+	/*
+	 * we need this if more than one processor can write to our tail
+	 * at a time, it synchronizes IO on IA64/Altix systems
+	 */
+	mmiowb();
+}
+
 static void e1000_tx_queue(struct e1000_adapter *adapter,
-			   int tx_flags, int count)
+			   int tx_flags, int count, int more)
 {
 	struct e1000_ring *tx_ring = adapter->tx_ring;
 	struct e1000_tx_desc *tx_desc = NULL;
@@ -3331,16 +3348,9 @@ static void e1000_tx_queue(struct e1000_adapter *adapter,
 
 	tx_ring->next_to_use = i;
 
-	if (adapter->flags2 & FLAG2_PCIM2PCI_ARBITER_WA)
-		e1000e_update_tdt_wa(adapter, i);
-	else
-		writel(i, adapter->hw.hw_addr + tx_ring->tail);
-
-	/*
-	 * we need this if more than one processor can write to our tail
-	 * at a time, it synchronizes IO on IA64/Altix systems
-	 */
-	mmiowb();
+	/* the last frame of a burst rings the doorbell for all of them */
+	if (!more)
+		e1000_tx_kick(adapter);
 }
 
 #define MINIMUM_DHCP_PACKET_SIZE 282
@@ -3413,11 +3423,13 @@ static int e1000_xmit_frame(struct rtskb *skb, struct rtnet_device *netdev)
 	/* if count is 0 then mapping error has occurred */
 	count = e1000_tx_map(adapter, skb, first);
 	if (count) {
-		e1000_tx_queue(adapter, tx_flags, count);
+		e1000_tx_queue(adapter, tx_flags, count, skb->xmit_more);
 		rtdm_lock_put_irqrestore(&tx_ring->lock, context);
 	} else {
 		tx_ring->buffer_info[first].time_stamp = 0;
 		tx_ring->next_to_use = first;
+		/* do not strand the frames queued ahead of this one */
+		e1000_tx_kick(adapter);
 		rtdm_lock_put_irqrestore(&tx_ring->lock, context);
 		kfree_rtskb(skb);
 	}
@@ -254,6 +254,7 @@ struct igb_ring {
 		/* TX */
 		struct {
 			struct igb_tx_queue_stats tx_stats;
+			u16 next_to_notify;	/* last index written to tail */
 		};
 		/* RX */
 		struct {
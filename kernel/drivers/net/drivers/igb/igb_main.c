@@ -2830,6 +2830,7 @@ void igb_configure_tx_ring(struct igb_adapter *adapter,
 	ring->tail = hw->hw_addr + E1000_TDT(reg_idx);
 	wr32(E1000_TDH(reg_idx), 0);
 	writel(0, ring->tail);
+	ring->next_to_notify = 0;
 
 	txdctl |= IGB_TX_PTHRESH;
 	txdctl |= IGB_TX_HTHRESH << 8;
@@ -3246,6 +3247,7 @@ static void igb_clean_tx_ring(struct igb_ring *tx_ring)
 
 	tx_ring->next_to_use = 0;
 	tx_ring->next_to_clean = 0;
+	tx_ring->next_to_notify = 0;
 }
 
 /**
@@ -4074,6 +4076,25 @@ static inline int igb_maybe_stop_tx(struct igb_ring *tx_ring, const u16 size)
 	return __igb_maybe_stop_tx(tx_ring, size);
 }
 
+/* Notify the hardware of the descriptors posted since the last call,
+ * e.g. those held back by xmit_more.
+ */
+static void igb_tx_kick(struct igb_ring *tx_ring)
+{
+	u16 i = tx_ring->next_to_use;
+
+	if (i == tx_ring->next_to_notify)
+		return;
+
+	writel(i, tx_ring->tail);
+	tx_ring->next_to_notify = i;
+
+	/* we need this if more than one processor can write to our tail
+	 * at a time, it synchronizes IO on IA64/Altix systems
+	 */
+	mmiowb();
+}
+
 static void igb_tx_map(struct igb_ring *tx_ring,
 		       struct igb_tx_buffer *first,
 		       const u8 hdr_len)
@@ -4131,12 +4152,11 @@ static void igb_tx_map(struct igb_ring *tx_ring,
 	/* Make sure there is space in the ring for the next send. */
 	igb_maybe_stop_tx(tx_ring, DESC_NEEDED);
 
-	writel(i, tx_ring->tail);
-
-	/* we need this if more than one processor can write to our tail
-	 * at a time, it synchronizes IO on IA64/Altix systems
+	/* Defer the doorbell while more frames of a burst follow, unless
+	 * the queue just stopped and nothing else would be coming.
 	 */
-	mmiowb();
+	if (!skb->xmit_more || rtnetif_queue_stopped(tx_ring->netdev))
+		igb_tx_kick(tx_ring);
 
 	return;
 }
@@ -4156,7 +4176,8 @@ netdev_tx_t igb_xmit_frame_ring(struct rtskb *skb,
 	 * otherwise try next time
 	 */
 	if (igb_maybe_stop_tx(tx_ring, count + 3)) {
-		/* this is a hard error */
+		/* this is a hard error, flush what the burst queued so far */
+		igb_tx_kick(tx_ring);
 		return NETDEV_TX_BUSY;
 	}
 
@@ -4188,13 +4209,18 @@ static netdev_tx_t igb_xmit_frame(struct rtskb *skb,
 				  struct rtnet_device *netdev)
 {
 	struct igb_adapter *adapter = rtnetdev_priv(netdev);
+	struct igb_ring *tx_ring;
 
 	if (test_bit(__IGB_DOWN, &adapter->state)) {
 		kfree_rtskb(skb);
 		return NETDEV_TX_OK;
 	}
 
+	/* Frames dropped here must not strand the ones queued ahead of
+	 * them in the same burst.
+	 */
 	if (skb->len <= 0) {
+		igb_tx_kick(igb_tx_queue_mapping(adapter, skb));
 		kfree_rtskb(skb);
 		return NETDEV_TX_OK;
 	}
@@ -4203,9 +4229,12 @@ static netdev_tx_t igb_xmit_frame(struct rtskb *skb,
 	 * in order to meet this minimum size requirement.
 	 */
 	if (skb->len < 17) {
+		tx_ring = igb_tx_queue_mapping(adapter, skb);
 		skb = rtskb_padto(skb, 17);
-		if (!skb)
+		if (!skb) {
+			igb_tx_kick(tx_ring);
 			return NETDEV_TX_OK;
+		}
 	}
 
 	return igb_xmit_frame_ring(skb, igb_tx_queue_mapping(adapter, skb));
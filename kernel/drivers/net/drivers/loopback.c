@@ -67,6 +67,8 @@ static int rt_loopback_close (struct rtnet_device *rtdev)
  */
 static int rt_loopback_xmit(struct rtskb *rtskb, struct rtnet_device *rtdev)
 {
+    rtdm_lockctx_t context;
+
     /* write transmission stamp - in case any protocol ever gets the idea to
        ask the lookback device for this service... */
     if (rtskb->xmit_stamp)
@@ -79,7 +81,18 @@ static int rt_loopback_xmit(struct rtskb *rtskb, struct rtnet_device *rtdev)
     /* parse the Ethernet header as usual */
     rtskb->protocol = rt_eth_type_trans(rtskb, rtdev);
 
-    rt_stack_deliver(rtskb);
+    if (rtdev->rx_mgr == RTNET_STACK_MGR_DIRECT) {
+	rt_stack_deliver(rtskb);
+	return 0;
+    }
+
+    /* steered to the stack managers like a NIC would, waking them up only
+       once per burst */
+    rtdm_lock_irqsave(context);
+    rtnetif_rx(rtskb);
+    if (!rtskb->xmit_more)
+	rt_mark_stack_mgr(rtdev);
+    rtdm_lock_irqrestore(context);
 
     return 0;
 }
@@ -109,6 +122,7 @@ static int __init loopback_init(void)
     rtdev->flags |= IFF_LOOPBACK;
     rtdev->flags &= ~IFF_BROADCAST;
     rtdev->features |= NETIF_F_LLTX;
+    rtdev->rx_mgr = RTNET_STACK_MGR_DIRECT;
 
     if ((err = rt_register_rtnetdev(rtdev)) != 0)
     {
@@ -44,6 +44,8 @@ rtnet_corectl_call(struct notifier_block *self, unsigned long arg, void *cookie)
 		ret |= _CC_COBALT_NET_ROUTER;
 	if (IS_ENABLED(CONFIG_XENO_DRIVERS_NET_RTIPV4_UDP))
 		ret |= _CC_COBALT_NET_UDP;
+	if (IS_ENABLED(CONFIG_XENO_DRIVERS_NET_RTIPV4_TCP))
+		ret |= _CC_COBALT_NET_TCP;
 	if (IS_ENABLED(CONFIG_XENO_DRIVERS_NET_RTPACKET))
 		ret |= _CC_COBALT_NET_AF_PACKET;
 	if (IS_ENABLED(CONFIG_XENO_DRIVERS_NET_TDMA))
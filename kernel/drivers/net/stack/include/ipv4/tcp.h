@@ -31,12 +31,24 @@
 /*Maximum number of active tcp connections, must be power of 2 */
 #define RT_TCP_CONNECTIONS  64
 
-/* Maximum size of TCP input window */
-#define RT_TCP_WINDOW       4096
+/* Default size of TCP input window */
+#define RT_TCP_WINDOW       16384
 
 /* Maximum number of retransmissions of invalid segments */
 #define RT_TCP_RETRANSMIT   3
 
+/* Duplicate ACKs triggering a fast retransmission */
+#define RT_TCP_DUPACK_THRESH 3
+
+/* Upper bound of the retransmission timeout, in ns */
+#define RT_TCP_RTO_LIMIT    1000000000ull
+
+/* SACK blocks per segment, fitting the option space */
+#define RT_TCP_SACK_BLOCKS  4
+
+/* Out-of-order segments buffered per connection */
+#define RT_TCP_OOO_MAX      16
+
 /* Number of milliseconds to wait for ACK */
 #define RT_TCP_WAIT_TIME    10
 
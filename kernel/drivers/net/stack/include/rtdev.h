@@ -114,7 +114,8 @@ struct rtnet_device {
     __u32               local_ip;   /* IP address in network order  */
     __u32               broadcast_ip; /* broadcast IP in network order */
 
-    rtdm_event_t        *stack_event;
+    int                 rx_mgr;     /* RX steering, see stack_mgr.h */
+    unsigned int        rx_spread;  /* managers to spread flows on  */
 
     rtdm_mutex_t        xmit_mutex; /* protects xmit routine        */
     rtdm_lock_t         rtdev_lock; /* management lock              */
@@ -221,6 +222,7 @@ static inline void rtdev_dereference(struct rtnet_device *rtdev)
 }
 
 int rtdev_xmit(struct rtskb *skb);
+int rtdev_xmit_batch(struct rtskb_queue *queue);
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_PROXY)
 int rtdev_xmit_proxy(struct rtskb *skb);
@@ -35,6 +35,10 @@
 #include <rtdm/driver.h>
 #include <stack_mgr.h>
 
+/* maximum number of packets deferred by MSG_BATCH */
+#define RT_SOCKET_XMIT_BATCH    64
+
+struct rtpacket_ring;
 
 struct rtsocket {
     unsigned short          protocol;
@@ -45,6 +49,9 @@ struct rtsocket {
 
     struct rtskb_queue      incoming;
 
+    struct rtskb_queue      xmit_batch; /* deferred by MSG_BATCH */
+    unsigned int            xmit_batch_len;
+
     rtdm_lock_t             param_lock;
 
     unsigned int            priority;
@@ -74,6 +81,7 @@ struct rtsocket {
 	struct {
 	    struct rtpacket_type packet_type;
 	    int                  ifindex;
+	    struct rtpacket_ring *ring;     /* mmap'ed frame rings */
 	} packet;
     } prot;
 
@@ -103,6 +111,8 @@ int __rt_socket_init(struct rtdm_fd *fd, unsigned short protocol,
     __rt_socket_init(fd, proto, THIS_MODULE)
 
 void rt_socket_cleanup(struct rtdm_fd *fd);
+int rt_socket_xmit(struct rtsocket *sock, struct rtskb *skb, int msg_flags);
+int rt_socket_flush(struct rtsocket *sock);
 int rt_socket_common_ioctl(struct rtdm_fd *fd, int request, void __user *arg);
 int rt_socket_if_ioctl(struct rtdm_fd *fd, int request, void __user *arg);
 int rt_socket_select_bind(struct rtdm_fd *fd,
@@ -199,6 +199,8 @@ struct rtskb {
 
     unsigned short      protocol;
     unsigned char       pkt_type;
+    unsigned char       xmit_more;  /* more frames follow, see
+				       rtdev_xmit_batch() */
 
     unsigned char       ip_summed;
     unsigned int        csum;
@@ -239,10 +241,21 @@ struct rtskb_pool_lock_ops {
     void (*unlock)(void *cookie);
 };
 
+#define RTSKB_CACHE_MAX         32  /* upper bound of rtskb_cache_size */
+
+/* per-CPU front-end of a pool, see rtskb.c */
+struct rtskb_pool_cache {
+    rtdm_lock_t         lock;
+    unsigned int        count;
+    struct rtskb        *skbs[RTSKB_CACHE_MAX];
+};
+
 struct rtskb_pool {
     struct rtskb_queue queue;
     const struct rtskb_pool_lock_ops *lock_ops;
     void *lock_cookie;
+    struct rtskb_pool_cache __percpu *cache; /* NULL if not cached */
+    unsigned int cache_moves; /* transfers between queue and caches */
 };
 
 #define QUEUE_MAX_PRIO          0
@@ -278,6 +291,21 @@ extern unsigned int rtskb_pools;        /* current number of rtskb pools      */
 extern unsigned int rtskb_pools_max;    /* maximum number of rtskb pools      */
 extern unsigned int rtskb_amount;       /* current number of allocated rtskbs */
 extern unsigned int rtskb_amount_max;   /* maximum number of allocated rtskbs */
+extern unsigned int rtskb_cache_size;   /* per-CPU cache size of each pool    */
+
+#ifdef CONFIG_XENO_DRIVERS_NET_RTSKB_STATS
+struct rtskb_cache_stats {
+    unsigned long       hits;       /* allocations served by the local cache */
+    unsigned long       refills;    /* batches taken from a shared queue     */
+    unsigned long       drains;     /* batches returned to a shared queue    */
+    unsigned long       steals;     /* rtskbs taken from a remote cache      */
+    unsigned long       locked;     /* shared queue lock acquisitions        */
+    u64                 hold_total; /* accumulated lock hold time (ns)       */
+    u64                 hold_max;   /* longest lock hold time (ns)           */
+};
+
+DECLARE_PER_CPU(struct rtskb_cache_stats, rtskb_cache_stats);
+#endif
 
 #ifdef CONFIG_XENO_DRIVERS_NET_CHECKED
 extern void rtskb_over_panic(struct rtskb *skb, int len, void *here);
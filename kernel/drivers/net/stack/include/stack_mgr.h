@@ -40,6 +40,19 @@
 #define RTPACKET_HASH_TBL_SIZE  64
 #define RTPACKET_HASH_KEY_MASK  (RTPACKET_HASH_TBL_SIZE-1)
 
+
+/***
+ * stack managers (RX dispatching)
+ */
+
+#define RTNET_MAX_STACK_MGRS    8
+#define RTNET_STACK_MGR_RULES   8
+
+/* special rtdev->rx_mgr values, managers are numbered from 0 on */
+#define RTNET_STACK_MGR_AUTO    -1  /* (ifindex - 1) modulo manager count */
+#define RTNET_STACK_MGR_HASH    -2  /* spread flows over rx_spread managers */
+#define RTNET_STACK_MGR_DIRECT  -3  /* loopback only, deliver in sender task */
+
 struct rtpacket_type {
     struct list_head    list_entry;
 
@@ -72,8 +85,16 @@ static inline void rtdev_unlock_pack(struct rtpacket_type *pt)
     module_put(pt->owner);
 }
 
-void rt_stack_connect(struct rtnet_device *rtdev, struct rtnet_mgr *mgr);
-void rt_stack_disconnect(struct rtnet_device *rtdev);
+/* Devices are bound to stack managers by the RX steering rules, see
+   /proc/rtnet/stack_mgr. Both calls are kept for the drivers. */
+static inline void rt_stack_connect(struct rtnet_device *rtdev,
+                                    struct rtnet_mgr *mgr)
+{
+}
+
+static inline void rt_stack_disconnect(struct rtnet_device *rtdev)
+{
+}
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_DRV_LOOPBACK)
 void rt_stack_deliver(struct rtskb *rtskb);
@@ -83,16 +104,12 @@ int rt_stack_mgr_init(struct rtnet_mgr *mgr);
 void rt_stack_mgr_delete(struct rtnet_mgr *mgr);
 
 void rtnetif_rx(struct rtskb *skb);
+void rt_mark_stack_mgr(struct rtnet_device *rtdev);
 
 static inline void rtnetif_tx(struct rtnet_device *rtdev)
 {
 }
 
-static inline void rt_mark_stack_mgr(struct rtnet_device *rtdev)
-{
-    rtdm_event_signal(rtdev->stack_event);
-}
-
 #endif /* __KERNEL__ */
 
 #endif  /* __STACK_MGR_H_ */
@@ -131,7 +131,9 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 		goto error;
 	}
 
-	err = rtdev_xmit(skb);
+	/* hold fragments back until the last one, unless already batching */
+	err = rt_socket_xmit(sk, skb,
+			     next_skb ? msg_flags | MSG_BATCH : msg_flags);
 
 	skb = next_skb;
 
@@ -152,6 +154,9 @@ int rt_ip_build_xmit_slow(struct rtsocket *sk,
 	if (next_skb != NULL)
 	    kfree_rtskb(next_skb);
     }
+    /* do not leave the fragments sent so far behind */
+    if (!(msg_flags & MSG_BATCH))
+	rt_socket_flush(sk);
     return err;
 }
 
@@ -234,7 +239,7 @@ int rt_ip_build_xmit(struct rtsocket *sk,
 	    goto error;
     }
 
-    err = rtdev_xmit(skb);
+    err = rt_socket_xmit(sk, skb, msg_flags);
 
     if (err)
 	return -EAGAIN;
@@ -27,6 +27,7 @@
 #include <linux/delay.h>
 #include <net/tcp_states.h>
 #include <net/tcp.h>
+#include <asm/unaligned.h>
 
 #include <rtdm/driver.h>
 #include <rtnet_rtpc.h>
@@ -63,9 +64,13 @@ struct tcp_sync {
     u32 ack_seq;
 
     /* Local window size sent to peer  */
-    u16 window;
-    /* Last received destination peer window size */
-    u16 dst_window;
+    u32 window;
+    /* Bytes the peer still accepts beyond the last sent sequence */
+    u32 dst_window;
+
+    /* Window scale shifts, zero unless negotiated */
+    u8 snd_wscale;
+    u8 rcv_wscale;
 };
 
 /*
@@ -74,9 +79,6 @@ struct tcp_sync {
 /* 5 second */
 static const nanosecs_rel_t rt_tcp_connection_timeout = 1000000000ull;
 
-/* retransmission timerwheel timeout */
-static const u64 rt_tcp_retransmit_timeout = 100000000ull;
-
 /*
   keepalive constants
 */
@@ -90,12 +92,50 @@ static const u64 rt_tcp_keepalive_timeout = 7200000000000ull;
 /*
   retransmission timeout
 */
-/* 50 millisecond */
+/* 50 millisecond initially, then derived from the RTT within 5 ms..1 s */
 static const nanosecs_rel_t rt_tcp_retransmission_timeout = 50000000ull;
+static const nanosecs_rel_t rt_tcp_rto_min = 5000000ull;
+static const nanosecs_rel_t rt_tcp_rto_max = RT_TCP_RTO_LIMIT;
+
+/* retransmission timer wheel slots of 2^21 ns */
+#define RT_TCP_TIMER_GRANULARITY 21
+#define RT_TCP_TIMER_TICK   (1LL << RT_TCP_TIMER_GRANULARITY)
+
+/* default MSS if the peer does not announce one (RFC 1122) */
+#define RT_TCP_DEFAULT_MSS  536
+
+/* largest window scale shift (RFC 7323) */
+#define RT_TCP_MAX_WSCALE   14
+
 /*
-  maximum allowed number of retransmissions
+  State bits of the segments kept in the retransmission queue, these
+  rtskbs never leave the socket, so pkt_type is free for our use.
 */
-static const unsigned int max_retransmits = 3;
+#define TCP_SKB_SACKED      0x01 /* selectively acknowledged by the peer */
+#define TCP_SKB_RETRANS     0x02 /* sent more than once, no RTT sample */
+#define TCP_SKB_LOST        0x04 /* retransmitted during current recovery */
+#define TCP_SKB_STATE(skb)  ((skb)->pkt_type)
+
+struct tcp_sack_block {
+    u32 start;
+    u32 end;
+};
+
+struct tcp_options {
+    u16 mss;            /* 0 if not announced */
+    s8  wscale;         /* -1 if not announced */
+    u8  sack_ok;
+    unsigned int nr_sacks;
+    struct tcp_sack_block sacks[RT_TCP_SACK_BLOCKS];
+};
+
+struct tcp_stats {
+    u64 retransmits;
+    u64 fast_retransmits;
+    u64 timeouts;
+    u64 dup_acks;
+    u64 ooo_segments;
+};
 
 struct tcp_keepalive {
     u8 enabled;
@@ -142,11 +182,32 @@ struct tcp_socket {
     nanosecs_rel_t sk_sndtimeo;
 
     /* retransmission routine data */
-    u32                nacked_first;
+    u32                snd_una;      /* oldest unacknowledged sequence */
+    u32                snd_wnd;      /* last window announced by the peer */
+    u32                recover;      /* sequence ending loss recovery */
+    u8                 in_recovery;
+    unsigned int       dup_acks;
     unsigned int       timer_state;
     struct rtskb_queue retransmit_queue;
     struct timerwheel_timer timer;
 
+    /* round-trip time estimation (RFC 6298) */
+    nanosecs_rel_t     srtt;
+    nanosecs_rel_t     rttvar;
+    nanosecs_rel_t     rto;
+
+    /* segments received ahead of sync.ack_seq, sorted by sequence */
+    struct rtskb_queue ooo_queue;
+    unsigned int       ooo_count;
+    u32                ooo_last;     /* start of the latest one */
+
+    /* negotiated connection properties */
+    u16                mss;
+    u8                 options;      /* RTNET_TCP_SACK|RTNET_TCP_WSCALE */
+
+    struct rtnet_tcp_params params;
+    struct tcp_stats   stats;
+
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_TCP_ERROR_INJECTION
     unsigned int packet_counter;
     unsigned int error_rate;
@@ -420,6 +481,159 @@ static void rt_tcp_socket_validate(struct tcp_socket *ts)
     rtdm_event_init(&ts->send_evt, 0);
 }
 
+/***
+ *  rt_tcp_window_field - receive window as announced in a segment header
+ *  @ts: rttcp socket
+ *  @syn: the window of SYN segments is never scaled
+ */
+static inline __be16 rt_tcp_window_field(struct tcp_socket *ts, int syn)
+{
+    u32 window = ts->sync.window;
+
+    if (!syn)
+	window >>= ts->sync.rcv_wscale;
+
+    return htons(min_t(u32, window, 0xffff));
+}
+
+/* sequence following a segment of the retransmission queue */
+static inline u32 rt_tcp_skb_end_seq(struct rtskb *skb)
+{
+    struct tcphdr *th = skb->h.th;
+    struct iphdr *iph = skb->nh.iph;
+
+    return ntohl(th->seq) + th->syn + th->fin +
+	ntohs(iph->tot_len) - (iph->ihl << 2) - (th->doff << 2);
+}
+
+static void rt_tcp_clear_marks(struct tcp_socket *ts, unsigned int marks)
+{
+    struct rtskb *skb;
+
+    for (skb = ts->retransmit_queue.first; skb != NULL; skb = skb->next)
+	TCP_SKB_STATE(skb) &= ~marks;
+}
+
+/***
+ *  rt_tcp_sack_mark - flag segments covered by the received SACK blocks
+ *  @ts: rttcp socket
+ *  @opts: options of the received segment
+ */
+static void rt_tcp_sack_mark(struct tcp_socket *ts, struct tcp_options *opts)
+{
+    struct tcp_sack_block *block;
+    struct rtskb *skb;
+    u32 seq, end;
+    int i;
+
+    for (skb = ts->retransmit_queue.first; skb != NULL; skb = skb->next) {
+	seq = ntohl(skb->h.th->seq);
+	end = rt_tcp_skb_end_seq(skb);
+
+	for (i = 0, block = opts->sacks; i < opts->nr_sacks; i++, block++)
+	    if (rt_tcp_before(block->start, seq) &&
+		rt_tcp_before(end, block->end)) {
+		TCP_SKB_STATE(skb) |= TCP_SKB_SACKED;
+		break;
+	    }
+    }
+}
+
+/***
+ *  rt_tcp_next_hole - find the next segment to recover using SACK data
+ *  @ts: rttcp socket
+ *
+ *  Returns the first segment which was neither selectively acknowledged nor
+ *  retransmitted during the current recovery, provided the peer received
+ *  some later data already.
+ */
+static struct rtskb *rt_tcp_next_hole(struct tcp_socket *ts)
+{
+    struct rtskb *skb, *hole = NULL;
+
+    for (skb = ts->retransmit_queue.first; skb != NULL; skb = skb->next) {
+	if (TCP_SKB_STATE(skb) & TCP_SKB_SACKED) {
+	    if (hole)
+		return hole;
+	} else if (!hole && !(TCP_SKB_STATE(skb) & TCP_SKB_LOST))
+	    hole = skb;
+    }
+
+    return NULL;
+}
+
+static void rt_tcp_rto_reset(struct tcp_socket *ts)
+{
+    nanosecs_rel_t rto = ts->params.rto_initial;
+
+    if ((ts->params.flags & RTNET_TCP_RTT_RTO) && ts->srtt)
+	rto = ts->srtt + max_t(nanosecs_rel_t, RT_TCP_TIMER_TICK,
+			       ts->rttvar << 2);
+
+    ts->rto = clamp_t(nanosecs_rel_t, rto,
+		      ts->params.rto_min, ts->params.rto_max);
+}
+
+/***
+ *  rt_tcp_rtt_sample - update the round-trip time estimation (RFC 6298)
+ *  @ts: rttcp socket
+ *  @rtt: measured round-trip time
+ */
+static void rt_tcp_rtt_sample(struct tcp_socket *ts, nanosecs_rel_t rtt)
+{
+    nanosecs_rel_t delta;
+
+    if (rtt <= 0)
+	rtt = 1;
+
+    if (ts->srtt == 0) {
+	ts->srtt = rtt;
+	ts->rttvar = rtt >> 1;
+    } else {
+	delta = ts->srtt > rtt ? ts->srtt - rtt : rtt - ts->srtt;
+	ts->rttvar += (delta >> 2) - (ts->rttvar >> 2);
+	ts->srtt += (rtt >> 3) - (ts->srtt >> 3);
+    }
+}
+
+/***
+ *  rt_tcp_retransmit_prepare - refresh a queued segment and copy it for xmit
+ *  @ts: rttcp socket
+ *  @skb: segment from the retransmission queue
+ *
+ *  Called with the socket lock held.
+ */
+static struct rtskb *rt_tcp_retransmit_prepare(struct tcp_socket *ts,
+					       struct rtskb *skb)
+{
+    struct tcphdr *th = skb->h.th;
+    struct rtskb *clone;
+    unsigned int len;
+
+    /* the peer wants to know what we got meanwhile */
+    if (th->ack) {
+	len = ntohs(skb->nh.iph->tot_len) - (skb->nh.iph->ihl << 2);
+	th->ack_seq = htonl(ts->sync.ack_seq);
+	th->window  = rt_tcp_window_field(ts, th->syn);
+	th->check   = 0;
+	th->check   = tcp_v4_check(len, ts->saddr, ts->daddr,
+				   csum_partial(th, len, 0));
+    }
+
+    /* warning, rtskb_clone is under lock */
+    clone = rtskb_clone(skb, &ts->sock.skb_pool);
+    if (clone == NULL) {
+	rtdm_printk("rttcp: cann't clone skb for retransmission\n");
+	return NULL;
+    }
+
+    TCP_SKB_STATE(clone) = 0;
+    TCP_SKB_STATE(skb) |= TCP_SKB_RETRANS | TCP_SKB_LOST;
+    ts->stats.retransmits++;
+
+    return clone;
+}
+
 /***
  *  rt_tcp_retransmit_handler - timerwheel handler to process a retransmission
  *  @data: pointer to a rttcp socket structure
@@ -433,35 +647,41 @@ static void rt_tcp_retransmit_handler(void *data)
 
     rtdm_lock_get_irqsave(&ts->socket_lock, context);
 
-    if (unlikely(rtskb_queue_empty(&ts->retransmit_queue))) {
-	/* handled, but retransmission queue is empty */
-	rtdm_lock_get_irqsave(&ts->socket_lock, context);
-	rtdm_printk("rttcp: bug in RT TCP retransmission routine\n");
+    if (ts->tcp_state == TCP_CLOSE) {
+	/* socket is already closed */
+	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 	return;
     }
 
-    if (ts->tcp_state == TCP_CLOSE) {
-	/* socket is already closed */
+    if (rtskb_queue_empty(&ts->retransmit_queue) || ts->timer.slot >= 0) {
+	/* raced with an ACK which emptied the queue or re-armed the timer */
 	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 	return;
     }
 
     if (ts->timer_state) {
-	/* more tries */
+	/* more tries, each one waiting twice as long */
 	ts->timer_state--;
-	timerwheel_add_timer(&ts->timer, rt_tcp_retransmission_timeout);
-
-	/* warning, rtskb_clone is under lock */
-	skb = rtskb_clone(ts->retransmit_queue.first, &ts->sock.skb_pool);
+	ts->stats.timeouts++;
+	ts->rto = min_t(nanosecs_rel_t, ts->rto << 1, ts->params.rto_max);
+	timerwheel_add_timer(&ts->timer, ts->rto);
+
+	/* The peer may have discarded what it selectively acknowledged
+	   (RFC 2018), start over from the first unacknowledged segment,
+	   the following holes being recovered on partial ACKs. */
+	rt_tcp_clear_marks(ts, TCP_SKB_SACKED | TCP_SKB_LOST);
+	ts->in_recovery = 1;
+	ts->recover = ts->sync.seq;
+	ts->dup_acks = 0;
+
+	skb = rt_tcp_retransmit_prepare(ts, ts->retransmit_queue.first);
 	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 
-	/* BUG, window changes are not respected */
-	if (unlikely(rtdev_xmit(skb)) != 0) {
-	    kfree_rtskb(skb);
+	/* rtdev_xmit() frees the rtskb on error */
+	if (skb && rtdev_xmit(skb) != 0)
 	    rtdm_printk("rttcp: packet retransmission from timer failed\n");
-	}
     } else {
-	ts->timer_state = max_retransmits;
+	ts->timer_state = ts->params.max_retransmits;
 
 	/* report about connection lost */
 	signal = rt_tcp_socket_invalidate(ts, TCP_CLOSE);
@@ -476,73 +696,125 @@ static void rt_tcp_retransmit_handler(void *data)
 }
 
 /***
- *  rt_tcp_retransmit_ack - remove skbs from retransmission queue on ACK
+ *  rt_tcp_ack_rcv - process the acknowledgment and window of a segment
  *  @ts: rttcp socket
- *  @ack_seq: received ACK sequence value
+ *  @th: received segment header
+ *  @opts: options of the received segment
+ *  @data_len: payload length of the received segment
+ *
+ *  Acknowledged segments are released and sampled for the RTT. Duplicate
+ *  ACKs trigger a fast retransmission once dupack_thresh of them were
+ *  received, each further one retransmitting the next hole when SACK is
+ *  enabled. Partial ACKs during recovery retransmit the next unacknowledged
+ *  segment (NewReno, RFC 6582).
  */
-static void rt_tcp_retransmit_ack(struct tcp_socket *ts, u32 ack_seq)
+static void rt_tcp_ack_rcv(struct tcp_socket *ts, struct tcphdr *th,
+			   struct tcp_options *opts, unsigned int data_len)
 {
-    struct rtskb* skb;
-    rtdm_lockctx_t  context;
+    nanosecs_abs_t now = rtdm_clock_read_monotonic();
+    u32 ack_seq = ntohl(th->ack_seq);
+    u32 window = ntohs(th->window);
+    struct rtskb *skb, *rexmit = NULL;
+    struct rtskb_queue acked;
+    nanosecs_rel_t rtt = -1;
+    u32 old_window, usable;
+    rtdm_lockctx_t context;
+
+    rtskb_queue_init(&acked);
 
     rtdm_lock_get_irqsave(&ts->socket_lock, context);
 
-    /*
-      ACK, but retransmission queue is empty
-      This could happen on repeated ACKs
-    */
-    if (rtskb_queue_empty(&ts->retransmit_queue)) {
+    if (ts->tcp_state == TCP_CLOSE || !rt_tcp_after(ack_seq, ts->snd_una)) {
+	/* warn about queue safety in race with anyone, who closes the
+	   socket, and ignore ACKs overtaken by more recent ones */
 	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 	return;
     }
 
-    /*
-      Check ts->nacked_first value firstly to ensure that
-      skb for retransmission is present in the queue, otherwise
-      retransmission queue will be drained completely
-    */
-    if (!rt_tcp_before(ts->nacked_first, ack_seq)) {
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	return;
-    }
+    if (!th->syn)
+	window <<= ts->sync.snd_wscale;
 
-    if (timerwheel_remove_timer(&ts->timer) != 0) {
-	/* already timed out */
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	return;
-    }
+    if (opts->nr_sacks)
+	rt_tcp_sack_mark(ts, opts);
 
- dequeue_loop:
-    if (ts->tcp_state == TCP_CLOSE) {
-	/* warn about queue safety in race with anyone,
-	   who closes the socket */
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	return;
-    }
+    if (ack_seq != ts->snd_una) {
+	while ((skb = ts->retransmit_queue.first) != NULL &&
+	       rt_tcp_before(rt_tcp_skb_end_seq(skb), ack_seq)) {
+	    __rtskb_dequeue(&ts->retransmit_queue);
+	    /* Karn's algorithm, and SACKed segments were delayed by holes */
+	    if (!(TCP_SKB_STATE(skb) & (TCP_SKB_RETRANS | TCP_SKB_SACKED)))
+		rtt = now - skb->time_stamp;
+	    __rtskb_queue_tail(&acked, skb);
+	}
 
-    if ((skb = __rtskb_dequeue(&ts->retransmit_queue)) == NULL) {
-	ts->timer_state = max_retransmits;
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	return;
+	ts->snd_una = ack_seq;
+	ts->dup_acks = 0;
+	ts->timer_state = ts->params.max_retransmits;
+
+	if (rtt >= 0)
+	    rt_tcp_rtt_sample(ts, rtt);
+	rt_tcp_rto_reset(ts);
+
+	skb = ts->retransmit_queue.first;
+	if (ts->in_recovery) {
+	    if (rt_tcp_before(ts->recover, ack_seq))
+		ts->in_recovery = 0;
+	    else if (skb != NULL)
+		rexmit = (TCP_SKB_STATE(skb) & TCP_SKB_LOST) ?
+		    rt_tcp_next_hole(ts) : skb;
+	}
+
+	if (skb != NULL)
+	    timerwheel_add_timer(&ts->timer, ts->rto);
+	else
+	    timerwheel_remove_timer(&ts->timer);
+    } else if (data_len == 0 && !th->syn && !th->fin &&
+	       (window == ts->snd_wnd || opts->nr_sacks) &&
+	       !rtskb_queue_empty(&ts->retransmit_queue)) {
+	/* duplicate, unless it only updates the window (RFC 5681), SACK
+	   blocks telling about another segment received anyway */
+	ts->dup_acks++;
+	ts->stats.dup_acks++;
+
+	if (ts->in_recovery) {
+	    if (ts->options & RTNET_TCP_SACK)
+		rexmit = rt_tcp_next_hole(ts);
+	} else if (ts->params.dupack_thresh &&
+		   ts->dup_acks >= ts->params.dupack_thresh) {
+	    rt_tcp_clear_marks(ts, TCP_SKB_LOST);
+	    ts->in_recovery = 1;
+	    ts->recover = ts->sync.seq;
+	    rexmit = ts->retransmit_queue.first;
+	}
     }
 
-    if (rt_tcp_before(ts->nacked_first, ack_seq)) {
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	kfree_rtskb(skb);
-	rtdm_lock_get_irqsave(&ts->socket_lock, context);
-	goto dequeue_loop;
+    /* what the peer still accepts beyond the data sent */
+    ts->snd_wnd = window;
+    usable = ts->snd_una + window - ts->sync.seq;
+    old_window = ts->sync.dst_window;
+    ts->sync.dst_window = (s32)usable > 0 ? usable : 0;
+    window = ts->sync.dst_window;
+
+    if (rexmit != NULL) {
+	ts->stats.fast_retransmits++;
+	rexmit = rt_tcp_retransmit_prepare(ts, rexmit);
     }
 
-    /* Put NACKed skb back to queue */
-    /* BUG, need to respect half-acknowledged packets */
-    ts->nacked_first = ntohl(skb->h.th->seq) + 1;
+    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 
-    __rtskb_queue_head(&ts->retransmit_queue, skb);
+    while ((skb = __rtskb_dequeue(&acked)) != NULL)
+	kfree_rtskb(skb);
 
-    /* Have more packages in retransmission queue, restart the timer */
-    timerwheel_add_timer(&ts->timer, rt_tcp_retransmission_timeout);
+    /* rtdev_xmit() frees the rtskb on error */
+    if (rexmit != NULL && rtdev_xmit(rexmit) != 0)
+	rtdm_printk("rttcp: fast retransmission failed\n");
 
-    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+    if (!old_window && window)
+	/* set send event status */
+	rtdm_event_signal(&ts->send_evt);
+    else if (old_window && !window)
+	/* clear send event status */
+	rtdm_event_clear(&ts->send_evt);
 }
 
 /***
@@ -552,13 +824,15 @@ static void rt_tcp_retransmit_ack(struct tcp_socket *ts, u32 ack_seq)
  */
 static void rt_tcp_retransmit_send(struct tcp_socket *ts, struct rtskb *skb)
 {
+    /* transmission time for RTT sampling */
+    skb->time_stamp = rtdm_clock_read_monotonic();
+    TCP_SKB_STATE(skb) = 0;
+
     if (rtskb_queue_empty(&ts->retransmit_queue)) {
 	/* retransmission queue is empty */
-	ts->nacked_first = ntohl(skb->h.th->seq) + 1;
-
 	__rtskb_queue_tail(&ts->retransmit_queue, skb);
 
-	timerwheel_add_timer(&ts->timer, rt_tcp_retransmission_timeout);
+	timerwheel_add_timer(&ts->timer, ts->rto);
     } else {
 	/* retransmission queue is not empty */
 	__rtskb_queue_tail(&ts->retransmit_queue, skb);
@@ -605,11 +879,173 @@ static int rt_ip_build_frame(struct rtskb *skb, struct rtsocket *sk,
     return 0;
 }
 
+/***
+ *  rt_tcp_parse_options - extract the options of a received segment
+ *  @th: segment header
+ *  @opts: parsed options
+ */
+static void rt_tcp_parse_options(struct tcphdr *th, struct tcp_options *opts)
+{
+    int length = (th->doff << 2) - sizeof(struct tcphdr);
+    u8 *ptr = (u8 *)(th + 1);
+    int opcode, opsize, i;
+
+    opts->mss = 0;
+    opts->wscale = -1;
+    opts->sack_ok = 0;
+    opts->nr_sacks = 0;
+
+    while (length > 0) {
+	opcode = *ptr++;
+	if (opcode == TCPOPT_EOL)
+	    return;
+	if (opcode == TCPOPT_NOP) {
+	    length--;
+	    continue;
+	}
+
+	if (length < 2)
+	    return;
+	opsize = *ptr++;
+	if (opsize < 2 || opsize > length)
+	    return; /* malformed, ignore the rest */
+
+	switch (opcode) {
+	    case TCPOPT_MSS:
+		if (opsize == TCPOLEN_MSS && th->syn)
+		    opts->mss = get_unaligned_be16(ptr);
+		break;
+
+	    case TCPOPT_WINDOW:
+		if (opsize == TCPOLEN_WINDOW && th->syn)
+		    opts->wscale = min_t(u8, *ptr, RT_TCP_MAX_WSCALE);
+		break;
+
+	    case TCPOPT_SACK_PERM:
+		if (opsize == TCPOLEN_SACK_PERM && th->syn)
+		    opts->sack_ok = 1;
+		break;
+
+	    case TCPOPT_SACK:
+		if ((opsize - TCPOLEN_SACK_BASE) % TCPOLEN_SACK_PERBLOCK)
+		    break;
+		for (i = TCPOLEN_SACK_BASE - 2; i < opsize - 2 &&
+			 opts->nr_sacks < RT_TCP_SACK_BLOCKS;
+		     i += TCPOLEN_SACK_PERBLOCK, opts->nr_sacks++) {
+		    opts->sacks[opts->nr_sacks].start =
+			get_unaligned_be32(ptr + i);
+		    opts->sacks[opts->nr_sacks].end =
+			get_unaligned_be32(ptr + i + 4);
+		}
+		break;
+	}
+
+	ptr += opsize - 2;
+	length -= opsize;
+    }
+}
+
+/***
+ *  rt_tcp_syn_options - write the options offered or agreed on with a SYN
+ *  @ts: rttcp socket
+ *  @ptr: option space following the segment header
+ *  @mss: largest segment we can receive
+ */
+static unsigned int rt_tcp_syn_options(struct tcp_socket *ts, u8 *ptr, u16 mss)
+{
+    u8 *start = ptr;
+
+    *ptr++ = TCPOPT_MSS;
+    *ptr++ = TCPOLEN_MSS;
+    put_unaligned_be16(mss, ptr);
+    ptr += 2;
+
+    if (ts->options & RTNET_TCP_WSCALE) {
+	*ptr++ = TCPOPT_NOP;
+	*ptr++ = TCPOPT_WINDOW;
+	*ptr++ = TCPOLEN_WINDOW;
+	*ptr++ = ts->sync.rcv_wscale;
+    }
+
+    if (ts->options & RTNET_TCP_SACK) {
+	*ptr++ = TCPOPT_NOP;
+	*ptr++ = TCPOPT_NOP;
+	*ptr++ = TCPOPT_SACK_PERM;
+	*ptr++ = TCPOLEN_SACK_PERM;
+    }
+
+    return ptr - start;
+}
+
+/* sequence following a received segment */
+static inline u32 rt_tcp_rcv_end_seq(struct rtskb *skb)
+{
+    return ntohl(skb->h.th->seq) + skb->len - (skb->h.th->doff << 2);
+}
+
+/***
+ *  rt_tcp_sack_option - describe the out-of-order data received
+ *  @ts: rttcp socket
+ *  @ptr: option space following the segment header
+ *
+ *  The block holding the latest segment comes first as required by
+ *  RFC 2018, followed by the lowest other ones.
+ */
+static unsigned int rt_tcp_sack_option(struct tcp_socket *ts, u8 *ptr)
+{
+    struct tcp_sack_block blocks[RT_TCP_SACK_BLOCKS];
+    unsigned int nr = 1, first = 1, i;
+    struct rtskb *skb;
+    u32 start, end;
+    int latest;
+
+    for (skb = ts->ooo_queue.first; skb != NULL; ) {
+	start = ntohl(skb->h.th->seq);
+	latest = start == ts->ooo_last;
+
+	/* merge contiguous segments into a single block */
+	for (;;) {
+	    end = rt_tcp_rcv_end_seq(skb);
+	    skb = skb->chain_end->next;
+	    if (skb == NULL || ntohl(skb->h.th->seq) != end)
+		break;
+	    latest |= end == ts->ooo_last;
+	}
+
+	if (latest) {
+	    blocks[0].start = start;
+	    blocks[0].end = end;
+	    first = 0;
+	} else if (nr < RT_TCP_SACK_BLOCKS) {
+	    blocks[nr].start = start;
+	    blocks[nr].end = end;
+	    nr++;
+	}
+    }
+
+    nr -= first;
+    if (nr == 0)
+	return 0;
+
+    ptr[0] = TCPOPT_NOP;
+    ptr[1] = TCPOPT_NOP;
+    ptr[2] = TCPOPT_SACK;
+    ptr[3] = TCPOLEN_SACK_BASE + nr * TCPOLEN_SACK_PERBLOCK;
+
+    for (i = 0; i < nr; i++) {
+	put_unaligned_be32(blocks[first + i].start, ptr + 4 + i * 8);
+	put_unaligned_be32(blocks[first + i].end, ptr + 8 + i * 8);
+    }
+
+    return ptr[3] + 2;
+}
+
 static void rt_tcp_build_header(struct tcp_socket *ts, struct rtskb *skb,
-				__be32 flags, u8 is_keepalive)
+				__be32 flags, u8 is_keepalive,
+				unsigned int optlen)
 {
     u32 wcheck;
-    u8 tcphdrlen = 20;
+    u8 tcphdrlen = 20 + optlen;
     u8 iphdrlen  = 20;
     struct tcphdr *th;
 
@@ -623,11 +1059,11 @@ static void rt_tcp_build_header(struct tcp_socket *ts, struct rtskb *skb,
 	th->seq--;
 
     th->ack_seq = htonl(ts->sync.ack_seq);
-    th->window  = htons(ts->sync.window);
+    th->window  = rt_tcp_window_field(ts, flags & TCP_FLAG_SYN);
 
     rt_tcp_set_flags(th, flags);
 
-    th->doff = tcphdrlen >> 2; /* No options for now */
+    th->doff = tcphdrlen >> 2;
     th->res1 = 0;
     th->check   = 0;
     th->urg_ptr = 0;
@@ -654,6 +1090,7 @@ rt_tcp_segment(struct dest_route *rt, struct tcp_socket *ts, __be32 flags,
     struct iphdr        *iph;
     struct rtskb* cloned_skb;
     rtdm_lockctx_t  context;
+    unsigned int optlen = 0;
 
     int ret;
 
@@ -677,6 +1114,10 @@ rt_tcp_segment(struct dest_route *rt, struct tcp_socket *ts, __be32 flags,
     th = (struct tcphdr*)rtskb_put(skb, 20); /* length of TCP header */
     skb->h.th = th;
 
+    /* used local phy MTU value */
+    if (data_len > mtu - 40)
+	data_len = mtu - 40;
+
     if (data_len) { /* check for available place */
 	data = (u8*)rtskb_put(skb, data_len); /* length of TCP payload */
 	if (!memcpy(data, (void*)data_ptr, data_len)) {
@@ -685,10 +1126,6 @@ rt_tcp_segment(struct dest_route *rt, struct tcp_socket *ts, __be32 flags,
 	}
     }
 
-    /* used local phy MTU value */
-    if (data_len > mtu)
-	data_len = mtu;
-
     skb->rtdev    = rtdev;
     skb->priority = prio;
 
@@ -696,7 +1133,16 @@ rt_tcp_segment(struct dest_route *rt, struct tcp_socket *ts, __be32 flags,
        this should be done at upper level */
 
     rtdm_lock_get_irqsave(&ts->socket_lock, context);
-    rt_tcp_build_header(ts, skb, flags, is_keepalive);
+
+    /* options are only carried by segments without payload */
+    if (flags & TCP_FLAG_SYN)
+	optlen = rt_tcp_syn_options(ts, (u8 *)(th + 1), mtu - 40);
+    else if (data_len == 0 && !is_keepalive && ts->ooo_queue.first &&
+	     (ts->options & RTNET_TCP_SACK))
+	optlen = rt_tcp_sack_option(ts, (u8 *)(th + 1));
+    rtskb_put(skb, optlen);
+
+    rt_tcp_build_header(ts, skb, flags, is_keepalive, optlen);
 
     if ((ret = rt_ip_build_frame(skb, sk, rt, iph)) != 0) {
 	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
@@ -725,7 +1171,7 @@ rt_tcp_segment(struct dest_route *rt, struct tcp_socket *ts, __be32 flags,
 	ts->sync.seq++;
 
     ts->sync.seq += data_len;
-    ts->sync.dst_window -= data_len;
+    ts->sync.dst_window -= min(data_len, ts->sync.dst_window);
 
     rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 
@@ -856,31 +1302,130 @@ static struct rtsocket *rt_tcp_dest_socket(struct rtskb *skb)
     return skb->sk;
 }
 
-static void rt_tcp_window_update(struct tcp_socket *ts, u16 window)
+/***
+ *  rt_tcp_init_connection - reset the connection state before a handshake
+ *  @ts: rttcp socket, locked
+ */
+static void rt_tcp_init_connection(struct tcp_socket *ts)
 {
-    rtdm_lockctx_t context;
+    u32 window = ts->params.rcv_window;
 
-    rtdm_lock_get_irqsave(&ts->socket_lock, context);
+    ts->sync.seq = rt_tcp_initial_seq();
+    ts->sync.dst_window = 0;
+    ts->sync.snd_wscale = 0;
+    ts->sync.rcv_wscale = 0;
+
+    /* offer what is enabled, the handshake keeps what both sides support */
+    ts->options = ts->params.flags & (RTNET_TCP_SACK | RTNET_TCP_WSCALE);
+    if (ts->options & RTNET_TCP_WSCALE)
+	while ((window >> ts->sync.rcv_wscale) > 0xffff)
+	    ts->sync.rcv_wscale++;
+    else
+	window = min_t(u32, window, 0xffff);
+    ts->sync.window = window;
+
+    ts->mss = RT_TCP_DEFAULT_MSS;
+    ts->snd_una = ts->sync.seq;
+    ts->snd_wnd = 0;
+    ts->in_recovery = 0;
+    ts->dup_acks = 0;
+    ts->timer_state = ts->params.max_retransmits;
+    ts->srtt = 0;
+    ts->rttvar = 0;
+    ts->rto = ts->params.rto_initial;
+}
 
-    if (ts->sync.dst_window) {
-	ts->sync.dst_window = window;
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	if (!window) {
-	    /* clear send event status */
-	    rtdm_event_clear(&ts->send_evt);
-	}
-    } else {
-	if (window) {
-	    ts->sync.dst_window = window;
-	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	    /* set send event status */
-	    rtdm_event_signal(&ts->send_evt);
-	} else {
-	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	}
+/***
+ *  rt_tcp_negotiate - settle the connection options from the peer's SYN
+ *  @ts: rttcp socket, locked
+ *  @opts: options received with the SYN
+ */
+static void rt_tcp_negotiate(struct tcp_socket *ts, struct tcp_options *opts)
+{
+    if (!opts->sack_ok)
+	ts->options &= ~RTNET_TCP_SACK;
+
+    if (opts->wscale >= 0 && (ts->options & RTNET_TCP_WSCALE))
+	ts->sync.snd_wscale = opts->wscale;
+    else {
+	ts->options &= ~RTNET_TCP_WSCALE;
+	ts->sync.rcv_wscale = 0;
+	ts->sync.window = min_t(u32, ts->sync.window, 0xffff);
     }
+
+    ts->mss = opts->mss ?: RT_TCP_DEFAULT_MSS;
 }
 
+/***
+ *  rt_tcp_ooo_queue - keep a segment received ahead of a hole
+ *  @ts: rttcp socket, locked
+ *  @skb: received segment
+ *  @seq: first sequence number of the segment
+ *
+ *  Segments overlapping one already queued are dropped, the peer sends
+ *  them again if needed.
+ */
+static int rt_tcp_ooo_queue(struct tcp_socket *ts, struct rtskb *skb, u32 seq)
+{
+    struct rtskb *prev = NULL, *next;
+    u32 end = rt_tcp_rcv_end_seq(skb);
+
+    if (ts->ooo_count >= RT_TCP_OOO_MAX)
+	return 0;
+
+    for (next = ts->ooo_queue.first; next != NULL;
+	 prev = next, next = next->chain_end->next) {
+	if (rt_tcp_before(end, ntohl(next->h.th->seq)))
+	    break;
+	if (!rt_tcp_after(seq, rt_tcp_rcv_end_seq(next)))
+	    return 0;
+    }
+
+    skb->chain_end->next = next;
+    if (prev != NULL)
+	prev->chain_end->next = skb;
+    else
+	ts->ooo_queue.first = skb;
+    if (next == NULL)
+	ts->ooo_queue.last = skb->chain_end;
+
+    ts->ooo_count++;
+    ts->ooo_last = seq;
+    ts->stats.ooo_segments++;
+
+    return 1;
+}
+
+/***
+ *  rt_tcp_ooo_drain - move segments no longer preceded by a hole
+ *  @ts: rttcp socket, locked
+ *  @ready: queue to collect them for delivery
+ */
+static void rt_tcp_ooo_drain(struct tcp_socket *ts, struct rtskb_queue *ready)
+{
+    struct rtskb *skb;
+    u32 seq, len;
+
+    while ((skb = ts->ooo_queue.first) != NULL) {
+	seq = ntohl(skb->h.th->seq);
+	if (seq != ts->sync.ack_seq && rt_tcp_after(seq, ts->sync.ack_seq))
+	    break;
+
+	__rtskb_dequeue_chain(&ts->ooo_queue);
+	ts->ooo_count--;
+
+	if (seq != ts->sync.ack_seq) {
+	    /* partly covered by a retransmission, the rest comes again */
+	    kfree_rtskb(skb);
+	    continue;
+	}
+
+	len = skb->len - (skb->h.th->doff << 2);
+	ts->sync.ack_seq += len;
+	ts->sync.window -= min(len, ts->sync.window);
+	__rtskb_queue_tail(ready, skb);
+    }
+}
 
 /***
  *  rt_tcp_rcv
@@ -892,10 +1437,14 @@ static void rt_tcp_rcv(struct rtskb *skb)
     struct tcphdr* th = skb->h.th;
     unsigned int data_len = skb->len - (th->doff << 2);
     u32 seq = ntohl(th->seq);
+    struct tcp_options opts;
+    struct rtskb_queue ready;
     int signal;
 
     ts = container_of(skb->sk, struct tcp_socket, sock);
 
+    rt_tcp_parse_options(th, &opts);
+
     rtdm_lock_get_irqsave(&ts->socket_lock, context);
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_TCP_ERROR_INJECTION
@@ -927,6 +1476,7 @@ static void rt_tcp_rcv(struct rtskb *skb)
 	ts->sync.ack_seq = rt_tcp_compute_ack_seq(th, data_len);
 
 	if (th->syn && th->ack) {
+	    rt_tcp_negotiate(ts, &opts);
 	    rt_tcp_socket_validate(ts);
 	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 	    rtdm_event_signal(&ts->conn_evt);
@@ -949,7 +1499,6 @@ static void rt_tcp_rcv(struct rtskb *skb)
 
     /* OR-list of conditions to be satisfied:
      *
-     * th->ack && rt_tcp_after(ts->nacked_first, ntohl(th->ack_seq))
      * th->ack && th->rst && ...
      * th->syn && (ts->tcp_state == TCP_LISTEN ||
 		   ts->tcp_state == TCP_SYN_SENT)
@@ -1019,7 +1568,64 @@ static void rt_tcp_rcv(struct rtskb *skb)
 	}
     }
 
-    ts->sync.ack_seq = rt_tcp_compute_ack_seq(th, data_len);
+    if (th->syn) {
+	/* Need to differentiate LISTEN socket from ESTABLISHED one */
+	/* Both of them have the same sport/saddr, but different dport/daddr */
+	/* dport is unknown if it is the first connection of n */
+
+	ts->sync.ack_seq = rt_tcp_compute_ack_seq(th, data_len);
+
+	if (ts->tcp_state == TCP_LISTEN) {
+	    /* Need to store ts->seq while sending SYN earlier */
+	    /* The socket shall be in TCP_LISTEN state */
+
+	    /* safe to update ts->saddr here due to a single task for
+	       rt_tcp_rcv() and rt_tcp_dest_socket() callers */
+	    ts->saddr = skb->nh.iph->daddr;
+
+	    ts->daddr = skb->nh.iph->saddr;
+	    ts->dport = th->source;
+	    rt_tcp_init_connection(ts);
+	    rt_tcp_negotiate(ts, &opts);
+	    ts->tcp_state = TCP_SYN_RECV;
+	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+
+	    /* Send SYN|ACK */
+	    rt_tcp_send(ts, TCP_FLAG_SYN|TCP_FLAG_ACK);
+	    goto drop;
+	}
+
+	/* Send RST|ACK */
+	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+	rt_tcp_send(ts, TCP_FLAG_RST|TCP_FLAG_ACK);
+	goto drop;
+    }
+
+    if (seq != ts->sync.ack_seq && (data_len || th->fin)) {
+	/* Ahead of a hole, some segments were lost or reordered on the
+	   way, keep data for later and tell the peer about the hole with
+	   a duplicate ACK. Acknowledgments are valid anyway. */
+	if (ts->tcp_state != TCP_ESTABLISHED || th->fin ||
+	    !rt_tcp_ooo_queue(ts, skb, seq)) {
+	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+	    rt_tcp_send(ts, TCP_FLAG_ACK);
+	    goto feed;
+	}
+
+	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+	rt_tcp_send(ts, TCP_FLAG_ACK);
+
+	/* the skb belongs to the out-of-order queue now */
+	if (th->ack)
+	    rt_tcp_ack_rcv(ts, th, &opts, data_len);
+
+	rt_tcp_keepalive_feed(ts);
+
+	return;
+    }
+
+    if (data_len || th->fin)
+	ts->sync.ack_seq = rt_tcp_compute_ack_seq(th, data_len);
 
     if (th->fin) {
 	if (ts->tcp_state == TCP_ESTABLISHED) {
@@ -1056,44 +1662,13 @@ static void rt_tcp_rcv(struct rtskb *skb)
 	}
     }
 
-    if (th->syn) {
-	/* Need to differentiate LISTEN socket from ESTABLISHED one */
-	/* Both of them have the same sport/saddr, but different dport/daddr */
-	/* dport is unknown if it is the first connection of n */
-
-	if (ts->tcp_state == TCP_LISTEN) {
-	    /* Need to store ts->seq while sending SYN earlier */
-	    /* The socket shall be in TCP_LISTEN state */
-
-	    /* safe to update ts->saddr here due to a single task for
-	       rt_tcp_rcv() and rt_tcp_dest_socket() callers */
-	    ts->saddr = skb->nh.iph->daddr;
-
-	    ts->daddr = skb->nh.iph->saddr;
-	    ts->dport = th->source;
-	    ts->sync.seq = rt_tcp_initial_seq();
-	    ts->sync.window = 4096;
-	    ts->tcp_state = TCP_SYN_RECV;
-	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-
-	    /* Send SYN|ACK */
-	    rt_tcp_send(ts, TCP_FLAG_SYN|TCP_FLAG_ACK);
-	    goto drop;
-	}
-
-	/* Send RST|ACK */
-	rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	rt_tcp_send(ts, TCP_FLAG_RST|TCP_FLAG_ACK);
-	goto drop;
-    }
-
     /* ACK received without SYN, FIN or RST flags */
     if (th->ack) {
 	/* Check ack sequence */
 	if (rt_tcp_before(ts->sync.seq + 1, ntohl(th->ack_seq))) {
 	    rtdm_printk("rttcp: unexpected ACK %u %u %u\n",
 			ts->sync.seq,
-			ts->nacked_first,
+			ts->snd_una,
 			ntohl(th->ack_seq));
 	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
 	    goto drop;
@@ -1132,32 +1707,36 @@ static void rt_tcp_rcv(struct rtskb *skb)
 	goto feed;
     }
 
-    /* Send ACK */
-    ts->sync.window -= data_len;
+    /* Send ACK, covering what the segment made contiguous */
+    ts->sync.window -= min(data_len, ts->sync.window);
+    rtskb_queue_init(&ready);
+    rt_tcp_ooo_drain(ts, &ready);
     rtdm_lock_put_irqrestore(&ts->socket_lock, context);
     rt_tcp_send(ts, TCP_FLAG_ACK);
 
+    /* inform retransmission subsystem about arrived ack, the reader may
+       release the skb as soon as it is queued */
+    if (th->ack)
+	rt_tcp_ack_rcv(ts, th, &opts, data_len);
+
+    rt_tcp_keepalive_feed(ts);
+
     rtskb_queue_tail(&skb->sk->incoming, skb);
     rtdm_sem_up(&ts->sock.pending_sem);
 
-    /* inform retransmission subsystem about arrived ack */
-    if (th->ack) {
-	rt_tcp_retransmit_ack(ts, ntohl(th->ack_seq));
+    while ((skb = __rtskb_dequeue_chain(&ready)) != NULL) {
+	rtskb_queue_tail(&ts->sock.incoming, skb);
+	rtdm_sem_up(&ts->sock.pending_sem);
     }
 
-    rt_tcp_keepalive_feed(ts);
-    rt_tcp_window_update(ts, ntohs(th->window));
-
     return;
 
  feed:
     /* inform retransmission subsystem about arrived ack */
-    if (th->ack) {
-	rt_tcp_retransmit_ack(ts, ntohl(th->ack_seq));
-    }
+    if (th->ack)
+	rt_tcp_ack_rcv(ts, th, &opts, data_len);
 
     rt_tcp_keepalive_feed(ts);
-    rt_tcp_window_update(ts, ntohs(th->window));
 
  drop:
     kfree_rtskb(skb);
@@ -1182,6 +1761,9 @@ static int rt_tcp_window_send(struct tcp_socket *ts, u32 data_len,
     if (data_len > dst_window)
 	data_len = dst_window;
 
+    if (data_len > ts->mss)
+	data_len = ts->mss;
+
     if ((ret = rt_tcp_segment(&ts->rt, ts, TCP_FLAG_ACK,
 			      data_len, data_ptr, 0)) < 0) {
 	rtdm_printk("rttcp: cann't send a packet: err %d\n", -ret);
@@ -1224,9 +1806,31 @@ static int rt_tcp_socket_create(struct tcp_socket* ts)
 
     ts->keepalive.enabled = 0;
 
-    ts->timer_state = max_retransmits;
+    ts->params.flags = RTNET_TCP_SACK | RTNET_TCP_WSCALE | RTNET_TCP_RTT_RTO;
+    ts->params.rcv_window = RT_TCP_WINDOW;
+    ts->params.dupack_thresh = RT_TCP_DUPACK_THRESH;
+    ts->params.max_retransmits = RT_TCP_RETRANSMIT;
+    ts->params.rto_initial = rt_tcp_retransmission_timeout;
+    ts->params.rto_min = rt_tcp_rto_min;
+    ts->params.rto_max = rt_tcp_rto_max;
+    memset(&ts->stats, 0, sizeof(ts->stats));
+
+    ts->snd_una = 0;
+    ts->snd_wnd = 0;
+    ts->in_recovery = 0;
+    ts->dup_acks = 0;
+    ts->srtt = 0;
+    ts->rttvar = 0;
+    ts->rto = ts->params.rto_initial;
+    ts->timer_state = ts->params.max_retransmits;
     timerwheel_init_timer(&ts->timer, rt_tcp_retransmit_handler, ts);
     rtskb_queue_init(&ts->retransmit_queue);
+    rtskb_queue_init(&ts->ooo_queue);
+    ts->ooo_count = 0;
+    ts->options = 0;
+    ts->mss = RT_TCP_DEFAULT_MSS;
+    ts->sync.snd_wscale = 0;
+    ts->sync.rcv_wscale = 0;
 
 #ifdef CONFIG_XENO_DRIVERS_NET_RTIPV4_TCP_ERROR_INJECTION
     ts->packet_counter = counter_start;
@@ -1353,6 +1957,10 @@ static void rt_tcp_socket_destruct(struct tcp_socket* ts)
     /* free packets in retransmission queue */
     while ((skb = __rtskb_dequeue(&ts->retransmit_queue)) != NULL)
 	kfree_rtskb(skb);
+
+    /* free packets received out of order */
+    while ((skb = __rtskb_dequeue_chain(&ts->ooo_queue)) != NULL)
+	kfree_rtskb(skb);
 }
 
 /***
@@ -1523,10 +2131,8 @@ static int rt_tcp_connect(struct tcp_socket *ts, const struct sockaddr *serv_add
     ts->daddr = usin->sin_addr.s_addr;
     ts->dport = usin->sin_port;
 
-    ts->sync.seq = rt_tcp_initial_seq();
+    rt_tcp_init_connection(ts);
     ts->sync.ack_seq = 0;
-    ts->sync.window = 4096;
-    ts->sync.dst_window = 0;
 
     ts->tcp_state = TCP_SYN_SENT;
 
@@ -1775,6 +2381,70 @@ static int rt_tcp_getsockopt(struct rtdm_fd *fd, struct tcp_socket *ts,
     return ret;
 }
 
+/***
+ *  rt_tcp_set_params - change the connection tuning of a socket
+ *  @ts: rttcp socket
+ *  @params: new parameters
+ */
+static int rt_tcp_set_params(struct tcp_socket *ts,
+			     const struct rtnet_tcp_params *params)
+{
+    rtdm_lockctx_t context;
+
+    if ((params->flags & ~(RTNET_TCP_SACK | RTNET_TCP_WSCALE |
+			   RTNET_TCP_RTT_RTO)) ||
+	params->rcv_window == 0 ||
+	params->rcv_window > (0xffffU << RT_TCP_MAX_WSCALE) ||
+	params->rto_min < RT_TCP_TIMER_TICK ||
+	params->rto_min > params->rto_initial ||
+	params->rto_initial > params->rto_max ||
+	params->rto_max > RT_TCP_RTO_LIMIT)
+	return -EINVAL;
+
+    rtdm_lock_get_irqsave(&ts->socket_lock, context);
+
+    ts->params = *params;
+    if (ts->tcp_state == TCP_CLOSE || ts->tcp_state == TCP_LISTEN) {
+	ts->timer_state = params->max_retransmits;
+	ts->rto = params->rto_initial;
+    } else
+	rt_tcp_rto_reset(ts);
+
+    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+
+    return 0;
+}
+
+static void rt_tcp_get_info(struct tcp_socket *ts, struct rtnet_tcp_info *info)
+{
+    rtdm_lockctx_t context;
+    struct rtskb *skb;
+
+    memset(info, 0, sizeof(*info));
+
+    rtdm_lock_get_irqsave(&ts->socket_lock, context);
+
+    info->state = ts->tcp_state;
+    info->options = ts->options;
+    info->mss = ts->mss;
+    info->snd_wscale = ts->sync.snd_wscale;
+    info->rcv_wscale = ts->sync.rcv_wscale;
+    info->snd_window = ts->snd_wnd;
+    info->rcv_window = ts->sync.window;
+    for (skb = ts->retransmit_queue.first; skb != NULL; skb = skb->next)
+	info->unacked++;
+    info->srtt = ts->srtt;
+    info->rttvar = ts->rttvar;
+    info->rto = ts->rto;
+    info->retransmits = ts->stats.retransmits;
+    info->fast_retransmits = ts->stats.fast_retransmits;
+    info->timeouts = ts->stats.timeouts;
+    info->dup_acks = ts->stats.dup_acks;
+    info->ooo_segments = ts->stats.ooo_segments;
+
+    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+}
+
 /***
  *  rt_tcp_ioctl
  */
@@ -1790,13 +2460,35 @@ static int rt_tcp_ioctl(struct rtdm_fd *fd,
     struct _rtdm_getsockopt_args _getopt;
     const struct _rtdm_setsockopt_args *setopt;
     struct _rtdm_setsockopt_args _setopt;
+    const struct rtnet_tcp_params *params;
+    struct rtnet_tcp_params _params;
+    struct rtnet_tcp_info info;
+    rtdm_lockctx_t context;
     const long *val;
     long _val;
     int in_rt;
 
     /* fast path for common socket IOCTLs */
-    if (_IOC_TYPE(request) == RTIOC_TYPE_NETWORK)
+    if (_IOC_TYPE(request) == RTIOC_TYPE_NETWORK) {
+	switch (request) {
+	case RTNET_RTIOC_TCP_SETPARAMS:
+		params = rtnet_get_arg(fd, &_params, arg, sizeof(_params));
+		if (IS_ERR(params))
+			return PTR_ERR(params);
+		return rt_tcp_set_params(ts, params);
+
+	case RTNET_RTIOC_TCP_GETPARAMS:
+		rtdm_lock_get_irqsave(&ts->socket_lock, context);
+		_params = ts->params;
+		rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+		return rtnet_put_arg(fd, arg, &_params, sizeof(_params));
+
+	case RTNET_RTIOC_TCP_INFO:
+		rt_tcp_get_info(ts, &info);
+		return rtnet_put_arg(fd, arg, &info, sizeof(info));
+	}
 	return rt_socket_common_ioctl(fd, request, arg);
+    }
 
     in_rt = rtdm_in_rt_context();
 
@@ -1865,6 +2557,27 @@ static int rt_tcp_ioctl(struct rtdm_fd *fd,
 }
 
 
+/***
+ *  rt_tcp_window_open - give back receive space consumed by the reader
+ *  @ts: rttcp socket
+ *  @len: number of bytes read
+ */
+static void rt_tcp_window_open(struct tcp_socket *ts, size_t len)
+{
+    rtdm_lockctx_t context;
+    int reopened;
+
+    rtdm_lock_get_irqsave(&ts->socket_lock, context);
+    /* the peer only learns about scaled units */
+    reopened = (ts->sync.window >> ts->sync.rcv_wscale) == 0;
+    ts->sync.window += len;
+    reopened &= (ts->sync.window >> ts->sync.rcv_wscale) != 0;
+    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
+
+    if (reopened)
+	rt_tcp_send(ts, TCP_FLAG_ACK); /* window update */
+}
+
 /***
  *  rt_tcp_read
  */
@@ -1954,15 +2667,7 @@ static ssize_t rt_tcp_read(struct rtdm_fd *fd, void *buf, size_t nbyte)
 		kfree_rtskb(first_skb); /* or store the data? */
 		return -EFAULT;
 	    }
-	    rtdm_lock_get_irqsave(&ts->socket_lock, context);
-	    if (ts->sync.window) {
-		ts->sync.window += block_size;
-		rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	    } else {
-		ts->sync.window = block_size;
-		rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-		rt_tcp_send(ts, TCP_FLAG_ACK); /* window update */
-	    }
+	    rt_tcp_window_open(ts, block_size);
 
 	    __rtskb_pull(skb, block_size);
 	    __rtskb_push(first_skb, sizeof(struct tcphdr));
@@ -1977,15 +2682,7 @@ static ssize_t rt_tcp_read(struct rtdm_fd *fd, void *buf, size_t nbyte)
 	    kfree_rtskb(first_skb); /* or store the data? */
 	    return -EFAULT;
 	}
-	rtdm_lock_get_irqsave(&ts->socket_lock, context);
-	if (ts->sync.window) {
-	    ts->sync.window += block_size;
-	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	} else {
-	    ts->sync.window = block_size;
-	    rtdm_lock_put_irqrestore(&ts->socket_lock, context);
-	    rt_tcp_send(ts, TCP_FLAG_ACK); /* window update */
-	}
+	rt_tcp_window_open(ts, block_size);
 
 	if ((skb = skb->next) != NULL) {
 	    user_buf += data_len;
@@ -2340,9 +3037,11 @@ int __init rt_tcp_init(void)
     rtdm_lock_init(&rst_socket.socket_lock);
 
     /*
-     * 100 ms forwarding timer with 8.38 ms slots
+     * Retransmission timer covering the largest RTO with 2.1 ms slots, the
+     * extra slot accounts for the one being processed.
      */
-    ret = timerwheel_init(100000000ull, 23);
+    ret = timerwheel_init(RT_TCP_RTO_LIMIT + RT_TCP_TIMER_TICK,
+			  RT_TCP_TIMER_GRANULARITY);
     if (ret < 0) {
 	rtdm_printk("rttcp: cann't initialize timerwheel task: %d\n", -ret);
 	goto out_1;
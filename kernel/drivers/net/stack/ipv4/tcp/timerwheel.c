@@ -79,7 +79,9 @@ int timerwheel_add_timer(struct timerwheel_timer *timer,
     rtdm_lockctx_t context;
     int slot;
 
-    slot = expires >> wheel.interval_base;
+    /* the current slot has been processed already, the next one is due
+       within one interval */
+    slot = (expires >> wheel.interval_base) + 1;
 
     if (slot >= wheel.slots)
 	return -EINVAL;
@@ -604,10 +604,13 @@ ssize_t rt_udp_sendmsg(struct rtdm_fd *fd, const struct user_msghdr *msg, int ms
     struct user_msghdr _msg;
     struct iovec iov_fast[RTDM_IOV_FASTMAX], *iov;
 
+    if (msg == NULL)    /* sendmmsg() cut short, push what was batched */
+        return rt_socket_flush(sock);
+
     if (msg_flags & MSG_OOB)   /* Mirror BSD error message compatibility */
         return -EOPNOTSUPP;
 
-    if (msg_flags & ~(MSG_DONTROUTE|MSG_DONTWAIT) )
+    if (msg_flags & ~(MSG_DONTROUTE|MSG_DONTWAIT|MSG_BATCH) )
         return -EINVAL;
 
     msg = rtnet_get_arg(fd, &_msg, msg, sizeof(*msg));
@@ -796,7 +799,7 @@ static struct rtdm_driver udp_driver = {
                                         RTDM_CLASS_NETWORK,
                                         RTDM_SUBCLASS_RTNET,
                                         RTNET_RTDM_VER),
-    .device_flags =     RTDM_PROTOCOL_DEVICE,
+    .device_flags =     RTDM_PROTOCOL_DEVICE | RTDM_BATCHED_SENDMSG,
     .device_count =	1,
     .context_size =     sizeof(struct rtsocket),
 
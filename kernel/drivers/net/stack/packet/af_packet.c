@@ -25,6 +25,8 @@
 #include <linux/module.h>
 #include <linux/sched.h>
 #include <linux/err.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 
 #include <rtnet_iovec.h>
 #include <rtnet_socket.h>
@@ -33,6 +35,122 @@
 MODULE_LICENSE("GPL");
 
 
+/* Frame rings shared with userland, see RTNET_RTIOC_PACKET_RING. */
+struct rtpacket_ring {
+    atomic_t            refs;       /* socket + mappings */
+    void                *mem;
+    size_t              memsz;
+
+    /* trusted copy of the geometry, userland may scribble the slots */
+    unsigned int        frame_size;
+    unsigned int        rx_frames;
+    unsigned int        tx_frames;
+
+    rtdm_lock_t         rx_lock;
+    unsigned int        rx_head;
+    int                 rx_losing;
+    int                 rx_waiting;
+    rtdm_event_t        rx_event;
+
+    rtdm_mutex_t        tx_lock;
+    unsigned int        tx_head;
+};
+
+static inline struct rtnet_packet_hdr *
+rt_packet_rx_slot(struct rtpacket_ring *ring, unsigned int n)
+{
+    return ring->mem + n * ring->frame_size;
+}
+
+static inline struct rtnet_packet_hdr *
+rt_packet_tx_slot(struct rtpacket_ring *ring, unsigned int n)
+{
+    return ring->mem + (ring->rx_frames + n) * ring->frame_size;
+}
+
+static void rt_packet_ring_put(struct rtpacket_ring *ring)
+{
+    if (atomic_dec_and_test(&ring->refs)) {
+	vfree(ring->mem);
+	kfree(ring);
+    }
+}
+
+
+
+/***
+ *  rt_packet_ring_rcv - store an incoming frame into the next rx slot
+ */
+static void rt_packet_ring_rcv(struct rtsocket *sock,
+			       struct rtpacket_ring *ring, struct rtskb *skb)
+{
+    struct rtnet_packet_hdr *hdr;
+    unsigned char           *data = skb->data;
+    unsigned int            len = skb->len, copy_len;
+    unsigned int            status = RTPACKET_STATUS_USER;
+    rtdm_lockctx_t          context;
+    int                     wakeup = 0;
+
+
+    /* Include the header in raw delivery */
+    if (rtdm_fd_to_context(rt_socket_fd(sock))->device->driver->socket_type
+	!= SOCK_DGRAM) {
+	len += data - skb->mac.raw;
+	data = skb->mac.raw;
+    }
+
+    copy_len = ring->frame_size - RTPACKET_HDRLEN;
+    if (len > copy_len)
+	status |= RTPACKET_STATUS_TRUNC;
+    else
+	copy_len = len;
+
+    rtdm_lock_get_irqsave(&ring->rx_lock, context);
+
+    hdr = rt_packet_rx_slot(ring, ring->rx_head);
+    if (hdr->status != RTPACKET_STATUS_KERNEL) {
+	/* userland is lagging behind, drop the frame */
+	ring->rx_losing = 1;
+	rtdm_lock_put_irqrestore(&ring->rx_lock, context);
+	return;
+    }
+
+    memcpy((void *)hdr + RTPACKET_HDRLEN, data, copy_len);
+    hdr->len      = len;
+    hdr->snaplen  = copy_len;
+    hdr->protocol = skb->protocol;
+    hdr->tstamp   = skb->time_stamp ? : rtdm_clock_read();
+    hdr->ifindex  = skb->rtdev->ifindex;
+    hdr->pkttype  = skb->pkt_type;
+
+    /* Ethernet specific - we rather need some parse handler here */
+    memcpy(hdr->addr, skb->mac.ethernet->h_source, ETH_ALEN);
+    hdr->halen = ETH_ALEN;
+
+    if (ring->rx_losing) {
+	status |= RTPACKET_STATUS_LOSING;
+	ring->rx_losing = 0;
+    }
+
+    /* publish the contents before handing over the slot */
+    smp_wmb();
+    hdr->status = status;
+
+    if (++ring->rx_head == ring->rx_frames)
+	ring->rx_head = 0;
+
+    if (ring->rx_waiting) {
+	ring->rx_waiting = 0;
+	wakeup = 1;
+    }
+
+    rtdm_lock_put_irqrestore(&ring->rx_lock, context);
+
+    if (wakeup)
+	rtdm_event_signal(&ring->rx_event);
+}
+
+
 /***
  *  rt_packet_rcv
  */
@@ -43,12 +161,23 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
     int             ifindex = sock->prot.packet.ifindex;
     void            (*callback_func)(struct rtdm_fd *, void *);
     void            *callback_arg;
+    struct rtpacket_ring *ring;
     rtdm_lockctx_t  context;
 
 
     if (unlikely((ifindex != 0) && (ifindex != skb->rtdev->ifindex)))
 	return -EUNATCH;
 
+    ring = sock->prot.packet.ring;
+    if ((ring != NULL) && (ring->rx_frames > 0)) {
+	rt_packet_ring_rcv(sock, ring, skb);
+#ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
+	if (pt->type != htons(ETH_P_ALL))
+#endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
+	    kfree_rtskb(skb);
+	goto notify;
+    }
+
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
     if (pt->type == htons(ETH_P_ALL)) {
 	struct rtskb *clone_skb = rtskb_clone(skb, &sock->skb_pool);
@@ -65,6 +194,7 @@ static int rt_packet_rcv(struct rtskb *skb, struct rtpacket_type *pt)
     rtskb_queue_tail(&sock->incoming, skb);
     rtdm_sem_up(&sock->pending_sem);
 
+  notify:
     rtdm_lock_get_irqsave(&sock->param_lock, context);
     callback_func = sock->callback_func;
     callback_arg  = sock->callback_arg;
@@ -202,6 +332,321 @@ static int rt_packet_getsockname(struct rtdm_fd *fd, struct rtsocket *sock,
 
 
 
+/***
+ *  rt_packet_ring_setup
+ */
+static int rt_packet_ring_setup(struct rtsocket *sock,
+				const struct rtnet_packet_ring_req *req)
+{
+    struct rtpacket_ring    *ring;
+    rtdm_lockctx_t          context;
+    int                     ret = 0;
+
+
+    if ((req->frame_size < RTPACKET_HDRLEN + ETH_HLEN) ||
+	(req->frame_size > RTPACKET_FRAME_MAX) ||
+	(req->frame_size & (RTPACKET_ALIGN - 1)) ||
+	(req->rx_frames > RTPACKET_RING_MAX) ||
+	(req->tx_frames > RTPACKET_RING_MAX) ||
+	(req->rx_frames + req->tx_frames == 0))
+	return -EINVAL;
+
+    if (sock->prot.packet.ring != NULL)
+	return -EBUSY;
+
+    ring = kzalloc(sizeof(*ring), GFP_KERNEL);
+    if (ring == NULL)
+	return -ENOMEM;
+
+    ring->memsz = PAGE_ALIGN((size_t)(req->rx_frames + req->tx_frames) *
+			     req->frame_size);
+    /* This memory will be visible from userland. */
+    ring->mem = vzalloc(ring->memsz);
+    if (ring->mem == NULL) {
+	kfree(ring);
+	return -ENOMEM;
+    }
+
+    atomic_set(&ring->refs, 1);
+    ring->frame_size = req->frame_size;
+    ring->rx_frames  = req->rx_frames;
+    ring->tx_frames  = req->tx_frames;
+    rtdm_lock_init(&ring->rx_lock);
+    rtdm_event_init(&ring->rx_event, 0);
+    rtdm_mutex_init(&ring->tx_lock);
+
+    /* The receive handler picks the ring without locking. */
+    smp_wmb();
+
+    rtdm_lock_get_irqsave(&sock->param_lock, context);
+    if (sock->prot.packet.ring == NULL)
+	sock->prot.packet.ring = ring;
+    else
+	ret = -EBUSY;
+    rtdm_lock_put_irqrestore(&sock->param_lock, context);
+
+    if (ret) {
+	rtdm_event_destroy(&ring->rx_event);
+	rtdm_mutex_destroy(&ring->tx_lock);
+	rt_packet_ring_put(ring);
+    }
+
+    return ret;
+}
+
+
+
+/***
+ *  rt_packet_ring_wait - wait for an rx slot to be handed to userland
+ */
+static int rt_packet_ring_wait(struct rtsocket *sock,
+			       struct rtpacket_ring *ring, unsigned int slot)
+{
+    struct rtnet_packet_hdr *hdr;
+    rtdm_lockctx_t          context;
+    rtdm_toseq_t            timeout_seq;
+    int                     ret;
+
+
+    if (slot >= ring->rx_frames)
+	return -EINVAL;
+
+    hdr = rt_packet_rx_slot(ring, slot);
+    rtdm_toseq_init(&timeout_seq, sock->timeout);
+
+    for (;;) {
+	rtdm_lock_get_irqsave(&ring->rx_lock, context);
+	if (hdr->status & RTPACKET_STATUS_USER) {
+	    rtdm_lock_put_irqrestore(&ring->rx_lock, context);
+	    return 0;
+	}
+	ring->rx_waiting = 1;
+	rtdm_lock_put_irqrestore(&ring->rx_lock, context);
+
+	/* A stale event only costs a spurious round. */
+	ret = rtdm_event_timedwait(&ring->rx_event, sock->timeout,
+				   &timeout_seq);
+	if (ret < 0)
+	    return ret == -EIDRM ? -EBADF : ret;
+    }
+}
+
+
+
+/***
+ *  rt_packet_ring_xmit - send the frame of a tx slot
+ */
+static int rt_packet_ring_xmit(struct rtsocket *sock,
+			       struct rtpacket_ring *ring,
+			       struct rtnet_device *rtdev,
+			       struct rtnet_packet_hdr *hdr, int raw)
+{
+    unsigned char   addr[sizeof(hdr->addr)];
+    unsigned short  proto;
+    unsigned int    len;
+    struct rtskb    *rtskb;
+
+
+    /* Take a stable copy of what userland may still change. */
+    len   = hdr->len;
+    proto = hdr->protocol ? : sock->prot.packet.packet_type.type;
+    memcpy(addr, hdr->addr, sizeof(addr));
+
+    if ((len > ring->frame_size - RTPACKET_HDRLEN) ||
+	(len > rtdev->mtu + (raw ? rtdev->hard_header_len : 0)))
+	return -EMSGSIZE;
+
+    if (!raw && (hdr->halen != rtdev->addr_len))
+	return -EINVAL;
+
+    if ((rtdev->flags & IFF_UP) == 0)
+	return -ENETDOWN;
+
+    rtskb = alloc_rtskb(rtdev->hard_header_len + len, &sock->skb_pool);
+    if (rtskb == NULL)
+	return -ENOBUFS;
+
+    rtskb_reserve(rtskb, rtdev->hard_header_len);
+
+    rtskb->rtdev    = rtdev;
+    rtskb->priority = sock->priority;
+
+    if (rtdev->hard_header) {
+	if (rtdev->hard_header(rtskb, rtdev, ntohs(proto),
+			       raw ? NULL : addr, NULL, len) < 0 && !raw) {
+	    kfree_rtskb(rtskb);
+	    return -EINVAL;
+	}
+	if (raw) {
+	    rtskb->tail = rtskb->data;
+	    rtskb->len = 0;
+	}
+    }
+
+    memcpy(rtskb_put(rtskb, len), (void *)hdr + RTPACKET_HDRLEN, len);
+
+    /* the kick flushes the whole burst once the ring is drained */
+    return rt_socket_xmit(sock, rtskb, MSG_BATCH);
+}
+
+
+
+/***
+ *  rt_packet_ring_kick - send all requested tx slots
+ */
+static int rt_packet_ring_kick(struct rtdm_fd *fd, struct rtsocket *sock,
+			       struct rtpacket_ring *ring)
+{
+    struct rtnet_packet_hdr *hdr;
+    struct rtnet_device     *rtdev;
+    int                     raw, sent = 0, ret = 0;
+
+
+    raw = rtdm_fd_to_context(fd)->device->driver->socket_type != SOCK_DGRAM;
+
+    ret = rtdm_mutex_lock(&ring->tx_lock);
+    if (ret)
+	return ret;
+
+    /* Note: We do not care about races with rt_packet_bind here -
+       the user has to do so. */
+    if ((rtdev = rtdev_get_by_index(sock->prot.packet.ifindex)) == NULL) {
+	ret = -ENODEV;
+	goto unlock;
+    }
+
+    while (ring->tx_frames > 0) {
+	hdr = rt_packet_tx_slot(ring, ring->tx_head);
+	if (hdr->status != RTPACKET_TX_SEND_REQUEST)
+	    break;
+
+	/* read the contents only after the status */
+	smp_rmb();
+	hdr->status = RTPACKET_TX_SENDING;
+
+	ret = rt_packet_ring_xmit(sock, ring, rtdev, hdr, raw);
+	if (ret == -EMSGSIZE || ret == -EINVAL)
+	    hdr->status = RTPACKET_TX_WRONG_FORMAT;
+	else if (ret < 0) {
+	    /* leave the frame for the next kick */
+	    hdr->status = RTPACKET_TX_SEND_REQUEST;
+	    break;
+	} else {
+	    hdr->status = RTPACKET_TX_AVAILABLE;
+	    sent++;
+	}
+
+	ret = 0;
+	if (++ring->tx_head == ring->tx_frames)
+	    ring->tx_head = 0;
+    }
+
+    if (sent > 0)
+	rt_socket_flush(sock);
+
+    rtdev_dereference(rtdev);
+  unlock:
+    rtdm_mutex_unlock(&ring->tx_lock);
+
+    return sent ? : ret;
+}
+
+
+
+/***
+ *  rt_packet_ring_ioctl
+ */
+static int rt_packet_ring_ioctl(struct rtdm_fd *fd, struct rtsocket *sock,
+				unsigned int request, void __user *arg)
+{
+    const struct rtnet_packet_ring_req  *req;
+    struct rtnet_packet_ring_req        _req;
+    struct rtpacket_ring                *ring;
+    const unsigned int                  *slot;
+    unsigned int                        _slot;
+
+
+    if (request == RTNET_RTIOC_PACKET_RING) {
+	req = rtnet_get_arg(fd, &_req, arg, sizeof(_req));
+	if (IS_ERR(req))
+	    return PTR_ERR(req);
+
+	if (rtdm_in_rt_context())
+	    return -ENOSYS;
+
+	return rt_packet_ring_setup(sock, req);
+    }
+
+    /* Waiting and sending are real-time services. */
+    if (!rtdm_in_rt_context())
+	return -ENOSYS;
+
+    ring = sock->prot.packet.ring;
+    if (ring == NULL)
+	return -ENXIO;
+
+    if (request == RTNET_RTIOC_PACKET_KICK)
+	return rt_packet_ring_kick(fd, sock, ring);
+
+    slot = rtnet_get_arg(fd, &_slot, arg, sizeof(_slot));
+    if (IS_ERR(slot))
+	return PTR_ERR(slot);
+
+    return rt_packet_ring_wait(sock, ring, *slot);
+}
+
+
+
+static void rt_packet_ring_vmopen(struct vm_area_struct *vma)
+{
+    struct rtpacket_ring *ring = vma->vm_private_data;
+
+    atomic_inc(&ring->refs);
+}
+
+static void rt_packet_ring_vmclose(struct vm_area_struct *vma)
+{
+    rt_packet_ring_put(vma->vm_private_data);
+}
+
+static struct vm_operations_struct rt_packet_ring_vmops = {
+    .open =     rt_packet_ring_vmopen,
+    .close =    rt_packet_ring_vmclose,
+};
+
+/***
+ *  rt_packet_mmap - map the frame rings, which may outlive the socket
+ */
+static int rt_packet_mmap(struct rtdm_fd *fd, struct vm_area_struct *vma)
+{
+    struct rtsocket         *sock = rtdm_fd_to_private(fd);
+    struct rtpacket_ring    *ring;
+    int                     ret;
+
+
+    ring = sock->prot.packet.ring;
+    if (ring == NULL)
+	return -ENXIO;
+
+    if ((vma->vm_pgoff != 0) || (vma->vm_end - vma->vm_start > ring->memsz))
+	return -EINVAL;
+
+    atomic_inc(&ring->refs);
+
+    ret = rtdm_mmap_vmem(vma, ring->mem);
+    if (ret) {
+	rt_packet_ring_put(ring);
+	return ret;
+    }
+
+    vma->vm_ops = &rt_packet_ring_vmops;
+    vma->vm_private_data = ring;
+
+    return 0;
+}
+
+
+
 /***
  * rt_packet_socket - initialize a packet socket
  */
@@ -216,6 +661,7 @@ static int rt_packet_socket(struct rtdm_fd *fd, int protocol)
 
     sock->prot.packet.packet_type.type		= protocol;
     sock->prot.packet.ifindex			= 0;
+    sock->prot.packet.ring			= NULL;
     sock->prot.packet.packet_type.trylock	= rt_packet_trylock;
     sock->prot.packet.packet_type.unlock        = rt_packet_unlock;
 
@@ -243,6 +689,7 @@ static void rt_packet_close(struct rtdm_fd *fd)
     struct rtsocket         *sock = rtdm_fd_to_private(fd);
     struct rtpacket_type    *pt = &sock->prot.packet.packet_type;
     struct rtskb            *del;
+    struct rtpacket_ring    *ring;
     rtdm_lockctx_t          context;
 
 
@@ -260,6 +707,15 @@ static void rt_packet_close(struct rtdm_fd *fd)
 	kfree_rtskb(del);
     }
 
+    ring = sock->prot.packet.ring;
+    if (ring != NULL) {
+	rtdm_event_destroy(&ring->rx_event);
+	rtdm_mutex_destroy(&ring->tx_lock);
+	/* userland mappings may still refer to the ring memory */
+	rt_packet_ring_put(ring);
+	sock->prot.packet.ring = NULL;
+    }
+
     rt_socket_cleanup(fd);
 }
 
@@ -277,8 +733,15 @@ static int rt_packet_ioctl(struct rtdm_fd *fd, unsigned int request, void __user
 	struct _rtdm_getsockaddr_args _getaddr;
 
 	/* fast path for common socket IOCTLs */
-	if (_IOC_TYPE(request) == RTIOC_TYPE_NETWORK)
+	if (_IOC_TYPE(request) == RTIOC_TYPE_NETWORK) {
+		switch (request) {
+		case RTNET_RTIOC_PACKET_RING:
+		case RTNET_RTIOC_PACKET_KICK:
+		case RTNET_RTIOC_PACKET_WAIT:
+			return rt_packet_ring_ioctl(fd, sock, request, arg);
+		}
 		return rt_socket_common_ioctl(fd, request, arg);
+	}
 
 	switch (request) {
 	case _RTIOC_BIND:
@@ -431,9 +894,12 @@ rt_packet_sendmsg(struct rtdm_fd *fd, const struct user_msghdr *msg, int msg_fla
     struct user_msghdr _msg;
     struct iovec iov_fast[RTDM_IOV_FASTMAX], *iov;
 
+    if (msg == NULL)    /* sendmmsg() cut short, push what was batched */
+	return rt_socket_flush(sock);
+
     if (msg_flags & MSG_OOB)    /* Mirror BSD error message compatibility */
 	return -EOPNOTSUPP;
-    if (msg_flags & ~MSG_DONTWAIT)
+    if (msg_flags & ~(MSG_DONTWAIT | MSG_BATCH))
 	return -EINVAL;
 
     msg = rtnet_get_arg(fd, &_msg, msg, sizeof(*msg));
@@ -526,7 +992,7 @@ rt_packet_sendmsg(struct rtdm_fd *fd, const struct user_msghdr *msg, int msg_fla
     ret = rtnet_read_from_iov(fd, iov, msg->msg_iovlen, rtskb_put(rtskb, len), len);
 
     if ((rtdev->flags & IFF_UP) != 0) {
-	if ((ret = rtdev_xmit(rtskb)) == 0)
+	if ((ret = rt_socket_xmit(sock, rtskb, msg_flags)) == 0)
 	    ret = len;
     } else {
 	ret = -ENETDOWN;
@@ -551,7 +1017,7 @@ static struct rtdm_driver packet_proto_drv = {
 					RTDM_CLASS_NETWORK,
 					RTDM_SUBCLASS_RTNET,
 					RTNET_RTDM_VER),
-    .device_flags =     RTDM_PROTOCOL_DEVICE,
+    .device_flags =     RTDM_PROTOCOL_DEVICE | RTDM_BATCHED_SENDMSG,
     .device_count =     1,
     .context_size =     sizeof(struct rtsocket),
 
@@ -567,6 +1033,7 @@ static struct rtdm_driver packet_proto_drv = {
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
 	.select =       rt_socket_select_bind,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -581,7 +1048,7 @@ static struct rtdm_driver raw_packet_proto_drv = {
 					RTDM_CLASS_NETWORK,
 					RTDM_SUBCLASS_RTNET,
 					RTNET_RTDM_VER),
-    .device_flags =     RTDM_PROTOCOL_DEVICE,
+    .device_flags =     RTDM_PROTOCOL_DEVICE | RTDM_BATCHED_SENDMSG,
     .device_count =     1,
     .context_size =     sizeof(struct rtsocket),
 
@@ -596,6 +1063,7 @@ static struct rtdm_driver raw_packet_proto_drv = {
 	.recvmsg_rt =   rt_packet_recvmsg,
 	.sendmsg_rt =   rt_packet_sendmsg,
 	.select =       rt_socket_select_bind,
+	.mmap =         rt_packet_mmap,
     },
 };
 
@@ -289,6 +289,8 @@ struct rtnet_device *rtdev_alloc(unsigned sizeof_priv, unsigned dev_pool_size)
 
     atomic_set(&rtdev->refcount, 0);
 
+    rtdev->rx_mgr = RTNET_STACK_MGR_AUTO;
+
     /* scale global rtskb pool */
     rtdev->add_rtskbs = rtskb_pool_extend(&global_pool, device_rtskbs);
 
@@ -308,7 +310,6 @@ void rtdev_free (struct rtnet_device *rtdev)
     if (rtdev != NULL) {
 	rtskb_pool_release(&rtdev->dev_pool);
 	rtskb_pool_shrink(&global_pool, rtdev->add_rtskbs);
-	rtdev->stack_event = NULL;
 	rtdm_mutex_destroy(&rtdev->xmit_mutex);
 	kfree(rtdev);
     }
@@ -748,6 +749,8 @@ int rtdev_xmit(struct rtskb *rtskb)
 
     RTNET_ASSERT(rtdev != NULL, return -EINVAL;);
 
+    rtskb->xmit_more = 0;
+
     err = rtdev->start_xmit(rtskb, rtdev);
     if (err) {
 	/* on error we must free the rtskb here */
@@ -761,6 +764,87 @@ int rtdev_xmit(struct rtskb *rtskb)
 
 
 
+/***
+ *  rtdev_xmit_batch - send a burst of real-time packets
+ *  @queue: rtskbs to send, all bound to the same device
+ *
+ *  The packets are handed to the driver back to back, taking the xmit
+ *  lock only once. All but the last one carry the xmit_more hint, so that
+ *  the driver may post their descriptors without notifying the hardware
+ *  yet. The queue is consumed in any case.
+ *
+ *  Returns the number of packets sent, or the error code of the first
+ *  packet which could not be sent, if any.
+ */
+int rtdev_xmit_batch(struct rtskb_queue *queue)
+{
+    struct rtnet_device *rtdev;
+    struct rtskb_queue  ready;
+    struct rtskb        *rtskb;
+    int                 locked, direct, sent = 0, err = 0, ret;
+
+
+    if (queue->first == NULL)
+	return 0;
+
+    rtdev = queue->first->rtdev;
+
+    RTNET_ASSERT(rtdev != NULL, return -EINVAL;);
+
+    if (!rtnetif_carrier_ok(rtdev)) {
+	while ((rtskb = __rtskb_dequeue(queue)) != NULL)
+	    kfree_rtskb(rtskb);
+	return -EAGAIN;
+    }
+
+    /* Settle buffer ownership first, so that the last packet handed to
+       the driver is known to be the last one of the burst. */
+    ready.first = NULL;
+    while ((rtskb = __rtskb_dequeue(queue)) != NULL) {
+	if (rtskb_acquire(rtskb, &rtdev->dev_pool) != 0) {
+	    kfree_rtskb(rtskb);
+	    if (!err)
+		err = -ENOBUFS;
+	    continue;
+	}
+	__rtskb_queue_tail(&ready, rtskb);
+    }
+
+    /* Only serialize here if the driver relies on the core for this.
+       RTmac disciplines and RTcap keep their own xmit path and may hold
+       packets back, so they must not see the hint. */
+    locked = (rtdev->start_xmit == rtdev_locked_xmit);
+    direct = locked || (rtdev->start_xmit == rtdev->hard_start_xmit);
+    if (locked)
+	rtdm_mutex_lock(&rtdev->xmit_mutex);
+
+    while ((rtskb = __rtskb_dequeue(&ready)) != NULL) {
+	rtskb->xmit_more = direct && (ready.first != NULL);
+
+	if (locked)
+	    ret = rtdev->hard_start_xmit(rtskb, rtdev);
+	else
+	    ret = rtdev->start_xmit(rtskb, rtdev);
+
+	if (ret) {
+	    /* on error we must free the rtskb here */
+	    kfree_rtskb(rtskb);
+
+	    rtdm_printk("hard_start_xmit returned %d\n", ret);
+	    if (!err)
+		err = ret;
+	} else
+	    sent++;
+    }
+
+    if (locked)
+	rtdm_mutex_unlock(&rtdev->xmit_mutex);
+
+    return err ? : sent;
+}
+
+
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_PROXY)
 /***
  *      rtdev_xmit_proxy - send rtproxy packet
@@ -821,6 +905,7 @@ EXPORT_SYMBOL_GPL(rtdev_get_by_hwaddr);
 EXPORT_SYMBOL_GPL(rtdev_get_loopback);
 
 EXPORT_SYMBOL_GPL(rtdev_xmit);
+EXPORT_SYMBOL_GPL(rtdev_xmit_batch);
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_PROXY)
 EXPORT_SYMBOL_GPL(rtdev_xmit_proxy);
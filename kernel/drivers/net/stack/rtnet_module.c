@@ -26,6 +26,7 @@
 #include <linux/init.h>
 #include <linux/proc_fs.h>
 #include <linux/seq_file.h>
+#include <linux/math64.h>
 
 #include <rtdev_mgr.h>
 #include <rtnet_chrdev.h>
@@ -130,6 +131,10 @@ static struct xnvfile_regular rtnet_devices_vfile = {
 static int rtnet_rtskb_show(struct xnvfile_regular_iterator *it, void *data)
 {
     unsigned int rtskb_len;
+#ifdef CONFIG_XENO_DRIVERS_NET_RTSKB_STATS
+    struct rtskb_cache_stats *stats;
+    int cpu;
+#endif
 
     rtskb_len = ALIGN_RTSKB_STRUCT_LEN + SKB_DATA_ALIGN(RTSKB_SIZE);
 
@@ -140,6 +145,23 @@ static int rtnet_rtskb_show(struct xnvfile_regular_iterator *it, void *data)
 		     rtskb_pools, rtskb_pools_max,
 		     rtskb_amount, rtskb_amount_max,
 		     rtskb_amount * rtskb_len, rtskb_amount_max * rtskb_len);
+
+    xnvfile_printf(it, "rtskb cache size\t%u\n", rtskb_cache_size);
+
+#ifdef CONFIG_XENO_DRIVERS_NET_RTSKB_STATS
+    xnvfile_printf(it, "\nCPU  %10s %10s %10s %10s %10s %8s %8s\n",
+		   "hits", "refills", "drains", "steals", "locked",
+		   "hold-avg", "hold-max");
+    for_each_online_cpu(cpu) {
+	stats = &per_cpu(rtskb_cache_stats, cpu);
+	xnvfile_printf(it, "%3d  %10lu %10lu %10lu %10lu %10lu %8llu %8llu\n",
+		       cpu, stats->hits, stats->refills, stats->drains,
+		       stats->steals, stats->locked,
+		       stats->locked ? (unsigned long long)
+		       div64_u64(stats->hold_total, stats->locked) : 0ULL,
+		       (unsigned long long)stats->hold_max);
+    }
+#endif
 	return 0;
 }
 
@@ -23,6 +23,7 @@
 
 #include <linux/moduleparam.h>
 #include <linux/slab.h>
+#include <linux/percpu.h>
 #include <net/checksum.h>
 
 #include <rtdev.h>
@@ -34,6 +35,10 @@ static unsigned int global_rtskbs    = DEFAULT_GLOBAL_RTSKBS;
 module_param(global_rtskbs, uint, 0444);
 MODULE_PARM_DESC(global_rtskbs, "Number of realtime socket buffers in global pool");
 
+unsigned int rtskb_cache_size = 16;
+module_param(rtskb_cache_size, uint, 0444);
+MODULE_PARM_DESC(rtskb_cache_size, "Per-CPU rtskb cache size of each pool (0 disables caching)");
+
 
 /* Linux slab pool for rtskbs */
 static struct kmem_cache *rtskb_slab_pool;
@@ -151,50 +156,278 @@ void rtskb_under_panic(struct rtskb *skb, int sz, void *here)
 EXPORT_SYMBOL_GPL(rtskb_under_panic);
 #endif /* CONFIG_XENO_DRIVERS_NET_CHECKED */
 
-static struct rtskb *__rtskb_pool_dequeue(struct rtskb_pool *pool)
+#ifdef CONFIG_XENO_DRIVERS_NET_RTSKB_STATS
+DEFINE_PER_CPU(struct rtskb_cache_stats, rtskb_cache_stats);
+
+#define rtskb_stat_inc(field) \
+    (per_cpu(rtskb_cache_stats, ipipe_processor_id()).field++)
+
+static inline nanosecs_abs_t rtskb_hold_start(void)
+{
+    return rtdm_clock_read_monotonic();
+}
+
+static inline void rtskb_hold_end(nanosecs_abs_t start)
+{
+    struct rtskb_cache_stats *stats;
+    u64 hold = rtdm_clock_read_monotonic() - start;
+
+    stats = &per_cpu(rtskb_cache_stats, ipipe_processor_id());
+    stats->locked++;
+    stats->hold_total += hold;
+    if (hold > stats->hold_max)
+	stats->hold_max = hold;
+}
+#else /* !CONFIG_XENO_DRIVERS_NET_RTSKB_STATS */
+#define rtskb_stat_inc(field)   do { } while (0)
+
+static inline nanosecs_abs_t rtskb_hold_start(void)
+{
+    return 0;
+}
+
+static inline void rtskb_hold_end(nanosecs_abs_t start) { }
+#endif /* CONFIG_XENO_DRIVERS_NET_RTSKB_STATS */
+
+/*
+ * Per-CPU pool caches
+ *
+ * Each pool may carry a small per-CPU array of free rtskbs in front of
+ * its shared queue, so that alloc_rtskb() and kfree_rtskb() normally
+ * only touch a CPU-local lock. A cache is refilled from the shared queue
+ * by batches of rtskb_cache_size / 2 buffers when it runs empty, and
+ * drains the same amount back when it overflows. Cached buffers remain
+ * free buffers of their pool: the pool lock_ops are applied per rtskb
+ * exactly like for the shared queue, and an allocation only fails if
+ * neither the shared queue nor any of the caches holds a free buffer.
+ *
+ * Lock nesting is cache->lock, then queue->lock. Two cache locks are
+ * never held at the same time.
+ */
+
+static inline unsigned int rtskb_cache_batch(void)
+{
+    return rtskb_cache_size / 2 ?: 1;
+}
+
+static struct rtskb *rtskb_queue_get(struct rtskb_pool *pool)
 {
     struct rtskb_queue *queue = &pool->queue;
+    rtdm_lockctx_t context;
+    nanosecs_abs_t start;
     struct rtskb *skb;
 
-    if (!pool->lock_ops->trylock(pool->lock_cookie))
-	    return NULL;
+    rtdm_lock_get_irqsave(&queue->lock, context);
+    start = rtskb_hold_start();
     skb = __rtskb_dequeue(queue);
-    if (skb == NULL)
-	    pool->lock_ops->unlock(pool->lock_cookie);
+    rtskb_hold_end(start);
+    rtdm_lock_put_irqrestore(&queue->lock, context);
 
     return skb;
 }
 
-struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool)
+static void rtskb_queue_put(struct rtskb_pool *pool, struct rtskb *skb)
 {
     struct rtskb_queue *queue = &pool->queue;
     rtdm_lockctx_t context;
-    struct rtskb *skb;
+    nanosecs_abs_t start;
 
     rtdm_lock_get_irqsave(&queue->lock, context);
-    skb = __rtskb_pool_dequeue(pool);
+    start = rtskb_hold_start();
+    __rtskb_queue_tail(queue, skb);
+    rtskb_hold_end(start);
     rtdm_lock_put_irqrestore(&queue->lock, context);
+}
 
-    return skb;
+/* called with cache->lock held, cache must be empty */
+static void rtskb_cache_refill(struct rtskb_pool *pool,
+			       struct rtskb_pool_cache *cache)
+{
+    struct rtskb_queue *queue = &pool->queue;
+    unsigned int batch = rtskb_cache_batch();
+    nanosecs_abs_t start;
+    struct rtskb *skb;
+
+    rtdm_lock_get(&queue->lock);
+    start = rtskb_hold_start();
+
+    while (cache->count < batch) {
+	skb = __rtskb_dequeue(queue);
+	if (skb == NULL)
+	    break;
+	cache->skbs[cache->count++] = skb;
+    }
+    if (cache->count > 0)
+	pool->cache_moves++;
+
+    rtskb_hold_end(start);
+    rtdm_lock_put(&queue->lock);
+
+    if (cache->count > 0)
+	rtskb_stat_inc(refills);
 }
-EXPORT_SYMBOL_GPL(rtskb_pool_dequeue);
 
-static void __rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+/* called with cache->lock held, moves the oldest @count rtskbs */
+static void rtskb_cache_drain(struct rtskb_pool *pool,
+			      struct rtskb_pool_cache *cache,
+			      unsigned int count)
 {
     struct rtskb_queue *queue = &pool->queue;
+    nanosecs_abs_t start;
+    unsigned int i;
 
-    __rtskb_queue_tail(queue,skb);
-    pool->lock_ops->unlock(pool->lock_cookie);
+    rtdm_lock_get(&queue->lock);
+    start = rtskb_hold_start();
+
+    for (i = 0; i < count; i++)
+	__rtskb_queue_tail(queue, cache->skbs[i]);
+    pool->cache_moves++;
+
+    rtskb_hold_end(start);
+    rtdm_lock_put(&queue->lock);
+
+    cache->count -= count;
+    memmove(cache->skbs, cache->skbs + count,
+	    cache->count * sizeof(cache->skbs[0]));
 }
 
-void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+/*
+ * Slow path once the local cache and the shared queue are empty: look
+ * for a buffer parked in any other cache. A refill racing with the scan
+ * may move buffers behind our back, so we rescan until the shared queue
+ * is found empty without any transfer having happened in the meantime.
+ * Each retry implies another CPU made progress on this pool.
+ */
+static struct rtskb *rtskb_cache_steal(struct rtskb_pool *pool)
 {
     struct rtskb_queue *queue = &pool->queue;
+    struct rtskb_pool_cache *cache;
     rtdm_lockctx_t context;
+    nanosecs_abs_t start;
+    unsigned int moves;
+    struct rtskb *skb;
+    int cpu, retry;
 
     rtdm_lock_get_irqsave(&queue->lock, context);
-    __rtskb_pool_queue_tail(pool, skb);
+    start = rtskb_hold_start();
+    skb = __rtskb_dequeue(queue);
+    moves = pool->cache_moves;
+    rtskb_hold_end(start);
     rtdm_lock_put_irqrestore(&queue->lock, context);
+
+    while (skb == NULL) {
+	for_each_possible_cpu(cpu) {
+	    cache = per_cpu_ptr(pool->cache, cpu);
+	    rtdm_lock_get_irqsave(&cache->lock, context);
+	    if (cache->count > 0)
+		skb = cache->skbs[--cache->count];
+	    rtdm_lock_put_irqrestore(&cache->lock, context);
+	    if (skb) {
+		rtskb_stat_inc(steals);
+		return skb;
+	    }
+	}
+
+	rtdm_lock_get_irqsave(&queue->lock, context);
+	start = rtskb_hold_start();
+	skb = __rtskb_dequeue(queue);
+	retry = skb == NULL && moves != pool->cache_moves;
+	moves = pool->cache_moves;
+	rtskb_hold_end(start);
+	rtdm_lock_put_irqrestore(&queue->lock, context);
+
+	if (!retry)
+	    break;
+    }
+
+    return skb;
+}
+
+static struct rtskb *rtskb_cache_get(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+    struct rtskb *skb = NULL;
+
+    cache = per_cpu_ptr(pool->cache, ipipe_processor_id());
+
+    rtdm_lock_get_irqsave(&cache->lock, context);
+    if (cache->count == 0)
+	rtskb_cache_refill(pool, cache);
+    else
+	rtskb_stat_inc(hits);
+    if (cache->count > 0)
+	skb = cache->skbs[--cache->count];
+    rtdm_lock_put_irqrestore(&cache->lock, context);
+
+    if (skb == NULL)
+	skb = rtskb_cache_steal(pool);
+
+    return skb;
+}
+
+static void rtskb_cache_put(struct rtskb_pool *pool, struct rtskb *skb)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+
+    cache = per_cpu_ptr(pool->cache, ipipe_processor_id());
+
+    rtdm_lock_get_irqsave(&cache->lock, context);
+    if (cache->count >= rtskb_cache_size) {
+	rtskb_cache_drain(pool, cache, rtskb_cache_batch());
+	rtskb_stat_inc(drains);
+    }
+    cache->skbs[cache->count++] = skb;
+    rtdm_lock_put_irqrestore(&cache->lock, context);
+}
+
+/* return all cached rtskbs to the shared queue (non-RT) */
+static void rtskb_cache_flush(struct rtskb_pool *pool)
+{
+    struct rtskb_pool_cache *cache;
+    rtdm_lockctx_t context;
+    int cpu;
+
+    if (pool->cache == NULL)
+	return;
+
+    for_each_possible_cpu(cpu) {
+	cache = per_cpu_ptr(pool->cache, cpu);
+	rtdm_lock_get_irqsave(&cache->lock, context);
+	if (cache->count > 0)
+	    rtskb_cache_drain(pool, cache, cache->count);
+	rtdm_lock_put_irqrestore(&cache->lock, context);
+    }
+}
+
+struct rtskb *rtskb_pool_dequeue(struct rtskb_pool *pool)
+{
+    struct rtskb *skb;
+
+    if (!pool->lock_ops->trylock(pool->lock_cookie))
+	return NULL;
+
+    if (pool->cache)
+	skb = rtskb_cache_get(pool);
+    else
+	skb = rtskb_queue_get(pool);
+
+    if (skb == NULL)
+	pool->lock_ops->unlock(pool->lock_cookie);
+
+    return skb;
+}
+EXPORT_SYMBOL_GPL(rtskb_pool_dequeue);
+
+void rtskb_pool_queue_tail(struct rtskb_pool *pool, struct rtskb *skb)
+{
+    if (pool->cache)
+	rtskb_cache_put(pool, skb);
+    else
+	rtskb_queue_put(pool, skb);
+
+    pool->lock_ops->unlock(pool->lock_cookie);
 }
 EXPORT_SYMBOL_GPL(rtskb_pool_queue_tail);
 
@@ -222,6 +455,7 @@ struct rtskb *alloc_rtskb(unsigned int size, struct rtskb_pool *pool)
     skb->chain_end = skb;
     skb->len = 0;
     skb->pkt_type = PACKET_HOST;
+    skb->xmit_more = 0;
     skb->xmit_stamp = NULL;
 
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_ADDON_RTCAP)
@@ -318,9 +552,20 @@ unsigned int rtskb_pool_init(struct rtskb_pool *pool,
 			    void *lock_cookie)
 {
     unsigned int i;
+    int cpu;
 
     rtskb_queue_init(&pool->queue);
 
+    pool->cache = NULL;
+    pool->cache_moves = 0;
+    if (rtskb_cache_size > 0 && num_possible_cpus() > 1) {
+	/* zero-initialized, a failure just leaves the pool uncached */
+	pool->cache = alloc_percpu(struct rtskb_pool_cache);
+	if (pool->cache)
+	    for_each_possible_cpu(cpu)
+		rtdm_lock_init(&per_cpu_ptr(pool->cache, cpu)->lock);
+    }
+
     i = rtskb_pool_extend(pool, initial_size);
 
     rtskb_pools++;
@@ -371,12 +616,17 @@ void rtskb_pool_release(struct rtskb_pool *pool)
 {
     struct rtskb *skb;
 
+    rtskb_cache_flush(pool);
+
     while ((skb = rtskb_dequeue(&pool->queue)) != NULL) {
 	rtdev_unmap_rtskb(skb);
 	kmem_cache_free(rtskb_slab_pool, skb);
 	rtskb_amount--;
     }
 
+    free_percpu(pool->cache);
+    pool->cache = NULL;
+
     rtskb_pools--;
 }
 
@@ -430,6 +680,8 @@ unsigned int rtskb_pool_shrink(struct rtskb_pool *pool,
     struct rtskb    *skb;
 
 
+    rtskb_cache_flush(pool);
+
     for (i = 0; i < rem_rtskbs; i++) {
 	if ((skb = rtskb_dequeue(&pool->queue)) == NULL)
 	    break;
@@ -448,27 +700,16 @@ int rtskb_acquire(struct rtskb *rtskb, struct rtskb_pool *comp_pool)
 {
     struct rtskb *comp_rtskb;
     struct rtskb_pool *release_pool;
-    rtdm_lockctx_t context;
-
 
-    rtdm_lock_get_irqsave(&comp_pool->queue.lock, context);
 
-    comp_rtskb = __rtskb_pool_dequeue(comp_pool);
-    if (!comp_rtskb) {
-	rtdm_lock_put_irqrestore(&comp_pool->queue.lock, context);
+    comp_rtskb = rtskb_pool_dequeue(comp_pool);
+    if (!comp_rtskb)
 	return -ENOMEM;
-    }
-
-    rtdm_lock_put(&comp_pool->queue.lock);
 
     comp_rtskb->chain_end = comp_rtskb;
     comp_rtskb->pool = release_pool = rtskb->pool;
 
-    rtdm_lock_get(&release_pool->queue.lock);
-
-    __rtskb_pool_queue_tail(release_pool, comp_rtskb);
-
-    rtdm_lock_put_irqrestore(&release_pool->queue.lock, context);
+    rtskb_pool_queue_tail(release_pool, comp_rtskb);
 
     rtskb->pool = comp_pool;
 
@@ -537,6 +778,9 @@ int rtskb_pools_init(void)
     rtskb_amount     = 0;
     rtskb_amount_max = 0;
 
+    if (rtskb_cache_size > RTSKB_CACHE_MAX)
+	rtskb_cache_size = RTSKB_CACHE_MAX;
+
     /* create the global rtskb pool */
     if (rtskb_module_pool_init(&global_pool, global_rtskbs) < global_rtskbs)
 	goto err_out;
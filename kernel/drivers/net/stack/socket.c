@@ -71,6 +71,9 @@ int __rt_bare_socket_init(struct rtdm_fd *fd, unsigned short protocol,
     sock->priority = priority;
     sock->owner = module;
 
+    rtskb_queue_init(&sock->xmit_batch);
+    sock->xmit_batch_len = 0;
+
     return err;
 }
 EXPORT_SYMBOL_GPL(__rt_bare_socket_init);
@@ -121,10 +124,17 @@ EXPORT_SYMBOL_GPL(__rt_socket_init);
 void rt_socket_cleanup(struct rtdm_fd *fd)
 {
     struct rtsocket *sock  = rtdm_fd_to_private(fd);
+    struct rtskb    *skb;
 
 
     rtdm_sem_destroy(&sock->pending_sem);
 
+    /* drop packets of an unterminated batch */
+    while ((skb = rtskb_dequeue(&sock->xmit_batch)) != NULL) {
+	rtdev_dereference(skb->rtdev);
+	kfree_rtskb(skb);
+    }
+
     mutex_lock(&sock->pool_nrt_lock);
 
     set_bit(SKB_POOL_CLOSED, &sock->flags);
@@ -139,6 +149,92 @@ void rt_socket_cleanup(struct rtdm_fd *fd)
 EXPORT_SYMBOL_GPL(rt_socket_cleanup);
 
 
+
+/***
+ *  rt_socket_xmit - send a packet on behalf of a socket
+ *  @sock: sending socket
+ *  @skb: packet, bound to its output device
+ *  @msg_flags: flags passed to the sending call
+ *
+ *  With MSG_BATCH set, as sendmmsg() does for all but the last message of
+ *  a vector, the packet is only queued on the socket. Queued packets are
+ *  handed to the devices in bursts by the next call without MSG_BATCH, by
+ *  rt_socket_flush(), or once RT_SOCKET_XMIT_BATCH of them are pending.
+ *  The packet is consumed in any case. The call flushing the batch
+ *  reports the first error met by any of its packets.
+ */
+int rt_socket_xmit(struct rtsocket *sock, struct rtskb *skb, int msg_flags)
+{
+    rtdm_lockctx_t  context;
+    int             flush;
+
+
+    /* Racy by design, a concurrent batch is flushed by its owner. */
+    if (!(msg_flags & MSG_BATCH) && (sock->xmit_batch.first == NULL))
+	return rtdev_xmit(skb);
+
+    /* deferred packets pin their device until sent */
+    if (!rtdev_reference(skb->rtdev)) {
+	kfree_rtskb(skb);
+	return -ENODEV;
+    }
+
+    rtdm_lock_get_irqsave(&sock->xmit_batch.lock, context);
+    __rtskb_queue_tail(&sock->xmit_batch, skb);
+    flush = !(msg_flags & MSG_BATCH) ||
+	(++sock->xmit_batch_len >= RT_SOCKET_XMIT_BATCH);
+    rtdm_lock_put_irqrestore(&sock->xmit_batch.lock, context);
+
+    return flush ? rt_socket_flush(sock) : 0;
+}
+EXPORT_SYMBOL_GPL(rt_socket_xmit);
+
+/***
+ *  rt_socket_flush - send all packets deferred by MSG_BATCH
+ *
+ *  Returns 0, or the error code of the first packet which could not be
+ *  sent.
+ */
+int rt_socket_flush(struct rtsocket *sock)
+{
+    struct rtskb_queue      batch, run;
+    struct rtnet_device     *rtdev;
+    struct rtskb            *skb;
+    rtdm_lockctx_t          context;
+    int                     count, ret, err = 0;
+
+
+    rtdm_lock_get_irqsave(&sock->xmit_batch.lock, context);
+    batch.first = sock->xmit_batch.first;
+    sock->xmit_batch.first = NULL;
+    sock->xmit_batch_len = 0;
+    rtdm_lock_put_irqrestore(&sock->xmit_batch.lock, context);
+
+    /* send each run of packets going through the same device at once */
+    while (batch.first != NULL) {
+	rtdev = batch.first->rtdev;
+	run.first = NULL;
+	count = 0;
+
+	while ((batch.first != NULL) && (batch.first->rtdev == rtdev)) {
+	    skb = __rtskb_dequeue(&batch);
+	    __rtskb_queue_tail(&run, skb);
+	    count++;
+	}
+
+	ret = rtdev_xmit_batch(&run);
+	if (ret < 0 && !err)
+	    err = ret;
+
+	while (count-- > 0)
+	    rtdev_dereference(rtdev);
+    }
+
+    return err;
+}
+EXPORT_SYMBOL_GPL(rt_socket_flush);
+
+
 /***
  *  rt_socket_common_ioctl
  */
@@ -23,6 +23,9 @@
  */
 
 #include <linux/moduleparam.h>
+#include <linux/jhash.h>
+#include <linux/ip.h>
+#include <asm/unaligned.h>
 
 #include <rtdev.h>
 #include <rtnet_internal.h>
@@ -34,11 +37,45 @@ static unsigned int stack_mgr_prio = RTNET_DEF_STACK_PRIORITY;
 module_param(stack_mgr_prio, uint, 0444);
 MODULE_PARM_DESC(stack_mgr_prio, "Priority of the stack manager task");
 
+static unsigned int stack_mgr_count = 1;
+module_param(stack_mgr_count, uint, 0444);
+MODULE_PARM_DESC(stack_mgr_count, "Number of stack manager tasks (1-8)");
+
+static int stack_mgr_prios[RTNET_MAX_STACK_MGRS];
+static unsigned int nr_stack_mgr_prios;
+module_param_array(stack_mgr_prios, int, &nr_stack_mgr_prios, 0444);
+MODULE_PARM_DESC(stack_mgr_prios,
+		 "Priorities of the stack managers (default: stack_mgr_prio)");
+
+static int stack_mgr_cpus[RTNET_MAX_STACK_MGRS];
+static unsigned int nr_stack_mgr_cpus;
+module_param_array(stack_mgr_cpus, int, &nr_stack_mgr_cpus, 0444);
+MODULE_PARM_DESC(stack_mgr_cpus,
+		 "CPUs of the stack managers, -1 for any (default: any)");
+
 
 #if (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE & (CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE-1)) != 0
 #error CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE must be power of 2!
 #endif
-static DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+
+struct rt_stack_mgr {
+    struct rtnet_mgr        *mgr;
+    struct rtnet_mgr        local_mgr;
+    int                     cpu;
+    int                     prio;
+    unsigned long           rx_packets;
+    unsigned long           rx_dropped;
+    DECLARE_RTSKB_FIFO(rx, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+};
+
+static struct rt_stack_mgr stack_mgrs[RTNET_MAX_STACK_MGRS];
+
+/* protocol steering rules: (ethertype << 16) | (manager + 1), 0 if unused */
+static u32 stack_mgr_rules[RTNET_STACK_MGR_RULES];
+static DEFINE_MUTEX(stack_mgr_rules_lock);
+
+/* managers fed by rtnetif_rx() on this CPU, kicked by rt_mark_stack_mgr() */
+static DEFINE_PER_CPU(unsigned long, stack_mgr_pending);
 
 struct list_head    rt_packets[RTPACKET_HASH_TBL_SIZE];
 #ifdef CONFIG_XENO_DRIVERS_NET_ETH_P_ALL
@@ -103,26 +140,113 @@ void rtdev_remove_pack(struct rtpacket_type *pt)
 EXPORT_SYMBOL_GPL(rtdev_remove_pack);
 
 
+static u32 rt_stack_flow_hash(struct rtskb *skb)
+{
+    struct iphdr    *iph;
+    u32             ports = 0;
+
+
+    if (skb->protocol != htons(ETH_P_IP) || skb->len < sizeof(struct iphdr))
+	return ntohs(skb->protocol);
+
+    iph = (struct iphdr *)skb->data;
+
+    /* fragments are hashed on addresses only to keep them together */
+    if (!(iph->frag_off & htons(IP_MF | IP_OFFSET)) &&
+	(iph->protocol == IPPROTO_UDP || iph->protocol == IPPROTO_TCP) &&
+	skb->len >= iph->ihl * 4 + sizeof(ports))
+	ports = get_unaligned((u32 *)(skb->data + iph->ihl * 4));
+
+    return jhash_3words(iph->saddr, iph->daddr, ports ^ iph->protocol, 0);
+}
+
+
+static inline struct rt_stack_mgr *rt_stack_steer(struct rtskb *skb)
+{
+    struct rtnet_device     *rtdev = skb->rtdev;
+    unsigned int            i, spread;
+    u32                     rule;
+    int                     id;
+
+
+    if (stack_mgr_count == 1)
+	return &stack_mgrs[0];
+
+    for (i = 0; i < RTNET_STACK_MGR_RULES; i++) {
+	rule = stack_mgr_rules[i];
+	if (rule != 0 && (rule >> 16) == ntohs(skb->protocol))
+	    return &stack_mgrs[(rule & 0xffff) - 1];
+    }
+
+    id = rtdev->rx_mgr;
+    if (id >= 0)
+	return &stack_mgrs[id];
+
+    if (id == RTNET_STACK_MGR_HASH) {
+	spread = rtdev->rx_spread;
+	if (spread == 0 || spread > stack_mgr_count)
+	    spread = stack_mgr_count;
+	return &stack_mgrs[rt_stack_flow_hash(skb) % spread];
+    }
+
+    return &stack_mgrs[(rtdev->ifindex - 1) % stack_mgr_count];
+}
+
+
 /***
  *  rtnetif_rx: will be called from the driver interrupt handler
- *  (IRQs disabled!) and send a message to rtdev-owned stack-manager
+ *  (IRQs disabled!) and queue the packet to the stack manager selected
+ *  by the RX steering rules, see rt_mark_stack_mgr()
  *
  *  @skb - the packet
  */
 void rtnetif_rx(struct rtskb *skb)
 {
+    struct rt_stack_mgr     *smgr;
+
+
     RTNET_ASSERT(skb != NULL, return;);
     RTNET_ASSERT(skb->rtdev != NULL, return;);
 
-    if (unlikely(rtskb_fifo_insert_inirq(&rx.fifo, skb) < 0)) {
+    smgr = rt_stack_steer(skb);
+
+    if (unlikely(rtskb_fifo_insert_inirq(&smgr->rx.fifo, skb) < 0)) {
 	rtdm_printk("RTnet: dropping packet in %s()\n", __FUNCTION__);
+	smgr->rx_dropped++;
 	kfree_rtskb(skb);
+	return;
     }
+
+    __set_bit(smgr - stack_mgrs,
+	      &per_cpu(stack_mgr_pending, ipipe_processor_id()));
 }
 
 EXPORT_SYMBOL_GPL(rtnetif_rx);
 
 
+/***
+ *  rt_mark_stack_mgr: wake up the stack managers fed by rtnetif_rx() on
+ *  the current CPU since the last call (IRQs disabled!)
+ *
+ *  @rtdev - the receiving device
+ */
+void rt_mark_stack_mgr(struct rtnet_device *rtdev)
+{
+    unsigned long   *pending, bits;
+    int             id;
+
+
+    pending = &per_cpu(stack_mgr_pending, ipipe_processor_id());
+    bits = *pending;
+    *pending = 0;
+
+    for_each_set_bit(id, &bits, RTNET_MAX_STACK_MGRS)
+	rtdm_event_signal(&stack_mgrs[id].mgr->event);
+}
+
+EXPORT_SYMBOL_GPL(rt_mark_stack_mgr);
+
+
 #if IS_ENABLED(CONFIG_XENO_DRIVERS_NET_DRV_LOOPBACK)
 #define __DELIVER_PREFIX
 #else /* !CONFIG_XENO_DRIVERS_NET_DRV_LOOPBACK */
@@ -197,7 +321,8 @@ EXPORT_SYMBOL_GPL(rt_stack_deliver);
 
 static void rt_stack_mgr_task(void *arg)
 {
-    rtdm_event_t            *mgr_event = &((struct rtnet_mgr *)arg)->event;
+    struct rt_stack_mgr     *smgr = arg;
+    rtdm_event_t            *mgr_event = &smgr->mgr->event;
     struct rtskb            *rtskb;
 
     while (!rtdm_task_should_stop()) {
@@ -205,32 +330,223 @@ static void rt_stack_mgr_task(void *arg)
 	    break;
 
 	/* we are the only reader => no locking required */
-	while ((rtskb = __rtskb_fifo_remove(&rx.fifo)))
+	while ((rtskb = __rtskb_fifo_remove(&smgr->rx.fifo))) {
+	    smgr->rx_packets++;
 	    rt_stack_deliver(rtskb);
+	}
     }
 }
 
 
-/***
- *  rt_stack_connect
- */
-void rt_stack_connect (struct rtnet_device *rtdev, struct rtnet_mgr *mgr)
+static int rt_stack_steer_dev(struct rtnet_device *rtdev, const char *target,
+			      unsigned int spread)
+{
+    int id;
+
+
+    if (strcmp(target, "auto") == 0)
+	id = RTNET_STACK_MGR_AUTO;
+    else if (strcmp(target, "hash") == 0) {
+	if (spread == 0 || spread > stack_mgr_count)
+	    return -EINVAL;
+	rtdev->rx_spread = spread;
+	smp_wmb();
+	id = RTNET_STACK_MGR_HASH;
+    } else if (strcmp(target, "direct") == 0) {
+	/* only the loopback device can deliver from the sender's context */
+	if (!(rtdev->flags & IFF_LOOPBACK))
+	    return -EINVAL;
+	id = RTNET_STACK_MGR_DIRECT;
+    } else if (kstrtoint(target, 0, &id) ||
+	       id < 0 || id >= (int)stack_mgr_count)
+	return -EINVAL;
+
+    rtdev->rx_mgr = id;
+
+    return 0;
+}
+
+
+static int rt_stack_steer_proto(unsigned int proto, const char *target)
 {
-    rtdev->stack_event = &mgr->event;
+    int i, free = -1, id = -1;
+
+
+    if (strcmp(target, "off") != 0 &&
+	(kstrtoint(target, 0, &id) || id < 0 || id >= (int)stack_mgr_count))
+	return -EINVAL;
+
+    mutex_lock(&stack_mgr_rules_lock);
+
+    for (i = 0; i < RTNET_STACK_MGR_RULES; i++) {
+	if (stack_mgr_rules[i] == 0) {
+	    if (free < 0)
+		free = i;
+	} else if ((stack_mgr_rules[i] >> 16) == proto)
+	    break;
+    }
+
+    if (i == RTNET_STACK_MGR_RULES) {
+	if (id < 0)
+	    goto out;
+	if (free < 0) {
+	    mutex_unlock(&stack_mgr_rules_lock);
+	    return -ENOSPC;
+	}
+	i = free;
+    }
+
+    stack_mgr_rules[i] = id < 0 ? 0 : (proto << 16) | (id + 1);
+out:
+    mutex_unlock(&stack_mgr_rules_lock);
+
+    return 0;
 }
 
-EXPORT_SYMBOL_GPL(rt_stack_connect);
+
+#ifdef CONFIG_XENO_OPT_VFILE
+static int rt_stack_mgr_show(struct xnvfile_regular_iterator *it, void *data)
+{
+    struct rt_stack_mgr     *smgr;
+    struct rtnet_device     *rtdev;
+    unsigned int            i;
+    u32                     rule;
+
+
+    xnvfile_printf(it, "Manager  CPU  Prio     Packets   Dropped\n");
+    for (i = 0; i < stack_mgr_count; i++) {
+	smgr = &stack_mgrs[i];
+	if (smgr->cpu < 0)
+	    xnvfile_printf(it, "%7u  any  %4d  %10lu  %8lu\n", i, smgr->prio,
+			   smgr->rx_packets, smgr->rx_dropped);
+	else
+	    xnvfile_printf(it, "%7u  %3d  %4d  %10lu  %8lu\n", i, smgr->cpu,
+			   smgr->prio, smgr->rx_packets, smgr->rx_dropped);
+    }
+
+    xnvfile_printf(it, "\nDevice           Steering\n");
+    for (i = 1; i <= MAX_RT_DEVICES; i++) {
+	rtdev = rtdev_get_by_index(i);
+	if (rtdev == NULL)
+	    continue;
+
+	switch (rtdev->rx_mgr) {
+	case RTNET_STACK_MGR_AUTO:
+	    xnvfile_printf(it, "%-15s  auto (%u)\n", rtdev->name,
+			   (rtdev->ifindex - 1) % stack_mgr_count);
+	    break;
+	case RTNET_STACK_MGR_HASH:
+	    xnvfile_printf(it, "%-15s  hash %u\n", rtdev->name,
+			   rtdev->rx_spread);
+	    break;
+	case RTNET_STACK_MGR_DIRECT:
+	    xnvfile_printf(it, "%-15s  direct\n", rtdev->name);
+	    break;
+	default:
+	    xnvfile_printf(it, "%-15s  %d\n", rtdev->name, rtdev->rx_mgr);
+	}
+
+	rtdev_dereference(rtdev);
+    }
+
+    xnvfile_printf(it, "\nProtocol         Steering\n");
+    for (i = 0; i < RTNET_STACK_MGR_RULES; i++) {
+	rule = stack_mgr_rules[i];
+	if (rule != 0)
+	    xnvfile_printf(it, "0x%04x           %u\n",
+			   rule >> 16, (rule & 0xffff) - 1);
+    }
+
+    return 0;
+}
 
 
 /***
- *  rt_stack_disconnect
+ *  Steering rules are written as
+ *    "dev <name> <manager|auto|hash [<nr>]|direct>"
+ *    "proto <ethertype> <manager|off>"
+ *  Protocol rules take precedence over device rules.
  */
-void rt_stack_disconnect (struct rtnet_device *rtdev)
+static ssize_t rt_stack_mgr_store(struct xnvfile_input *input)
+{
+    char                    buf[64], kind[8], name[IFNAMSIZ], target[8];
+    unsigned int            spread = stack_mgr_count, proto;
+    struct rtnet_device     *rtdev;
+    ssize_t                 ret;
+    int                     err;
+
+
+    ret = xnvfile_get_string(input, buf, sizeof(buf));
+    if (ret < 0)
+	return ret;
+
+    if (sscanf(buf, "%7s %15s %7s %u", kind, name, target, &spread) < 3)
+	return -EINVAL;
+
+    if (strcmp(kind, "dev") == 0) {
+	rtdev = rtdev_get_by_name(name);
+	if (rtdev == NULL)
+	    return -ENODEV;
+	err = rt_stack_steer_dev(rtdev, target, spread);
+	rtdev_dereference(rtdev);
+    } else if (strcmp(kind, "proto") == 0) {
+	if (kstrtouint(name, 0, &proto) || proto == 0 || proto > 0xffff)
+	    return -EINVAL;
+	err = rt_stack_steer_proto(proto, target);
+    } else
+	err = -EINVAL;
+
+    return err ? err : ret;
+}
+
+static struct xnvfile_regular_ops rt_stack_mgr_vfile_ops = {
+    .show = rt_stack_mgr_show,
+    .store = rt_stack_mgr_store,
+};
+
+static struct xnvfile_regular rt_stack_mgr_vfile = {
+    .ops = &rt_stack_mgr_vfile_ops,
+};
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+
+static int rt_stack_mgr_start(struct rt_stack_mgr *smgr, unsigned int id)
 {
-    rtdev->stack_event = NULL;
+    char    name[32];
+    int     ret;
+
+
+    if (id == 0)
+	strcpy(name, "rtnet-stack");
+    else
+	snprintf(name, sizeof(name), "rtnet-stack-%u", id);
+
+    rtdm_event_init(&smgr->mgr->event, 0);
+
+    if (smgr->cpu < 0)
+	ret = rtdm_task_init(&smgr->mgr->task, name, rt_stack_mgr_task, smgr,
+			     smgr->prio, 0);
+    else if (smgr->cpu >= nr_cpu_ids || !cpu_online(smgr->cpu))
+	ret = -EINVAL;
+    else
+	ret = rtdm_task_init_on(&smgr->mgr->task, name, rt_stack_mgr_task,
+				smgr, smgr->prio, 0, cpumask_of(smgr->cpu));
+
+    if (ret) {
+	printk(KERN_ERR "RTnet: cannot start stack manager %u on CPU %d\n",
+	       id, smgr->cpu);
+	rtdm_event_destroy(&smgr->mgr->event);
+    }
+
+    return ret;
 }
 
-EXPORT_SYMBOL_GPL(rt_stack_disconnect);
+
+static void rt_stack_mgr_stop(struct rt_stack_mgr *smgr)
+{
+    rtdm_event_destroy(&smgr->mgr->event);
+    rtdm_task_destroy(&smgr->mgr->task);
+}
 
 
 /***
@@ -238,10 +554,16 @@ EXPORT_SYMBOL_GPL(rt_stack_disconnect);
  */
 int rt_stack_mgr_init (struct rtnet_mgr *mgr)
 {
-    int i;
+    struct rt_stack_mgr *smgr;
+    unsigned int i;
+    int ret;
 
 
-    rtskb_fifo_init(&rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+    if (stack_mgr_count == 0 || stack_mgr_count > RTNET_MAX_STACK_MGRS) {
+	printk(KERN_ERR "RTnet: stack_mgr_count must be within 1..%d\n",
+	       RTNET_MAX_STACK_MGRS);
+	return -EINVAL;
+    }
 
     for (i = 0; i < RTPACKET_HASH_TBL_SIZE; i++)
 	INIT_LIST_HEAD(&rt_packets[i]);
@@ -249,10 +571,34 @@ int rt_stack_mgr_init (struct rtnet_mgr *mgr)
     INIT_LIST_HEAD(&rt_packets_all);
 #endif /* CONFIG_XENO_DRIVERS_NET_ETH_P_ALL */
 
-    rtdm_event_init(&mgr->event, 0);
+    /* manager 0 is the legacy STACK_manager */
+    for (i = 0; i < stack_mgr_count; i++) {
+	smgr = &stack_mgrs[i];
+	smgr->mgr = i == 0 ? mgr : &smgr->local_mgr;
+	smgr->prio = i < nr_stack_mgr_prios ? stack_mgr_prios[i] :
+	    stack_mgr_prio;
+	smgr->cpu = i < nr_stack_mgr_cpus ? stack_mgr_cpus[i] : -1;
+	rtskb_fifo_init(&smgr->rx.fifo, CONFIG_XENO_DRIVERS_NET_RX_FIFO_SIZE);
+
+	ret = rt_stack_mgr_start(smgr, i);
+	if (ret)
+	    goto err_out;
+    }
+
+#ifdef CONFIG_XENO_OPT_VFILE
+    ret = xnvfile_init_regular("stack_mgr", &rt_stack_mgr_vfile,
+			       &rtnet_proc_root);
+    if (ret)
+	goto err_out;
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+    return 0;
 
-    return rtdm_task_init(&mgr->task, "rtnet-stack", rt_stack_mgr_task, mgr,
-			  stack_mgr_prio, 0);
+err_out:
+    while (i-- > 0)
+	rt_stack_mgr_stop(&stack_mgrs[i]);
+
+    return ret;
 }
 
 
@@ -261,6 +607,13 @@ int rt_stack_mgr_init (struct rtnet_mgr *mgr)
  */
 void rt_stack_mgr_delete (struct rtnet_mgr *mgr)
 {
-    rtdm_event_destroy(&mgr->event);
-    rtdm_task_destroy(&mgr->task);
+    unsigned int i;
+
+
+#ifdef CONFIG_XENO_OPT_VFILE
+    xnvfile_destroy_regular(&rt_stack_mgr_vfile);
+#endif /* CONFIG_XENO_OPT_VFILE */
+
+    for (i = 0; i < stack_mgr_count; i++)
+	rt_stack_mgr_stop(&stack_mgrs[i]);
 }
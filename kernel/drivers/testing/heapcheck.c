@@ -409,6 +409,114 @@ bad:
 	goto done;
 }
 
+static int bench_cache(struct rttst_heap_cache_bench *bench)
+{
+	long alloc_sum_ns = 0, free_sum_ns = 0, alloc_max_ns = 0,
+		free_max_ns = 0, nrops, d;
+	nanosecs_rel_t start, end;
+	struct xnobjcache cache;
+	int ret, n, k, loop;
+	void *mem, **objs;
+
+	if (bench->obj_size == 0 || bench->nrobjs <= 0 || bench->loops <= 0 ||
+	    !PAGE_ALIGNED(bench->heap_size))
+		return -EINVAL;
+
+	mem = vmalloc(bench->heap_size);
+	if (mem == NULL)
+		return -ENOMEM;
+
+	ret = xnheap_init(&test_heap, mem, bench->heap_size);
+	if (ret) {
+		complain("cannot init heap with size %llu",
+			 (unsigned long long)bench->heap_size);
+		goto out;
+	}
+
+	objs = vmalloc(sizeof(*objs) * bench->nrobjs);
+	if (objs == NULL) {
+		ret = -ENOMEM;
+		goto no_objs;
+	}
+
+	if (bench->use_cache) {
+		ret = xnobjcache_init(&cache, &test_heap,
+				      bench->obj_size, NULL);
+		if (ret)
+			goto no_cache;
+		xnobjcache_set_name(&cache, "test_cache");
+	}
+
+	ret = xnthread_harden();
+	if (ret)
+		goto done;
+
+	/*
+	 * Cycle through allocating then releasing the same population
+	 * of objects, the first cycle populates the cache if any.
+	 */
+	for (loop = 0; loop < bench->loops; loop++) {
+		for (n = 0; n < bench->nrobjs; n++) {
+			start = rtdm_clock_read_monotonic();
+			if (bench->use_cache)
+				objs[n] = xnobjcache_alloc(&cache);
+			else
+				objs[n] = xnheap_alloc(&test_heap,
+						       bench->obj_size);
+			end = rtdm_clock_read_monotonic();
+			if (objs[n] == NULL) {
+				complain("heap exhausted after %d objects", n);
+				ret = -ENOMEM;
+				break;
+			}
+			d = end - start;
+			if (d > alloc_max_ns)
+				alloc_max_ns = d;
+			alloc_sum_ns += d;
+		}
+		for (k = 0; k < n; k++) {
+			start = rtdm_clock_read_monotonic();
+			if (bench->use_cache)
+				xnobjcache_free(&cache, objs[k]);
+			else
+				xnheap_free(&test_heap, objs[k]);
+			end = rtdm_clock_read_monotonic();
+			d = end - start;
+			if (d > free_max_ns)
+				free_max_ns = d;
+			free_sum_ns += d;
+		}
+		if (ret)
+			break;
+		breathe(loop);
+	}
+
+	xnthread_relax(0, 0);
+
+	nrops = (long)bench->loops * bench->nrobjs;
+	bench->alloc_avg_ns = alloc_sum_ns / nrops;
+	bench->alloc_max_ns = alloc_max_ns;
+	bench->free_avg_ns = free_sum_ns / nrops;
+	bench->free_max_ns = free_max_ns;
+done:
+	if (bench->use_cache)
+		xnobjcache_destroy(&cache);
+
+	if (ret == 0 && xnheap_get_used(&test_heap) > 0) {
+		complain("memory leakage reported: %zu bytes missing",
+			 xnheap_get_used(&test_heap));
+		ret = -EPROTO;
+	}
+no_cache:
+	vfree(objs);
+no_objs:
+	xnheap_destroy(&test_heap);
+out:
+	vfree(mem);
+
+	return ret;
+}
+
 static int collect_stats(struct rtdm_fd *fd,
 			 struct rttst_heap_stats __user *buf, int nr)
 {
@@ -446,6 +554,7 @@ static void heapcheck_close(struct rtdm_fd *fd)
 static int heapcheck_ioctl(struct rtdm_fd *fd,
 			   unsigned int request, void __user *arg)
 {
+	struct rttst_heap_cache_bench bench;
 	struct rttst_heap_stathdr sthdr;
 	struct rttst_heap_parms parms;
 	int ret;
@@ -473,6 +582,15 @@ static int heapcheck_ioctl(struct rtdm_fd *fd,
 		sthdr.nrstats = ret;
 		ret = rtdm_copy_to_user(fd, arg, &sthdr, sizeof(sthdr));
 		break;
+	case RTTST_RTIOC_HEAP_CACHE_BENCH:
+		ret = rtdm_copy_from_user(fd, &bench, arg, sizeof(bench));
+		if (ret)
+			return ret;
+		ret = bench_cache(&bench);
+		if (ret)
+			return ret;
+		ret = rtdm_copy_to_user(fd, arg, &bench, sizeof(bench));
+		break;
 	default:
 		ret = -EINVAL;
 	}
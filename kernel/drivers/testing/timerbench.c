@@ -21,6 +21,8 @@
 #include <linux/semaphore.h>
 #include <linux/ipipe_trace.h>
 #include <cobalt/kernel/arith.h>
+#include <cobalt/kernel/sched.h>
+#include <cobalt/kernel/timer.h>
 #include <rtdm/testing.h>
 #include <rtdm/driver.h>
 #include <rtdm/compat.h>
@@ -32,6 +34,7 @@ MODULE_LICENSE("GPL");
 
 struct rt_tmbench_context {
 	int mode;
+	int cpu;
 	unsigned int period;
 	int freeze_max;
 	int warmup_loops;
@@ -192,6 +195,7 @@ static int rt_tmbench_open(struct rtdm_fd *fd, int oflags)
 	ctx = rtdm_fd_to_private(fd);
 
 	ctx->mode = RTTST_TMBENCH_INVALID;
+	ctx->cpu = -1;
 	sema_init(&ctx->nrt_mutex, 1);
 
 	return 0;
@@ -287,9 +291,11 @@ static int rt_tmbench_start(struct rtdm_fd *fd,
 	rtdm_event_init(&ctx->result_event, 0);
 
 	if (config->mode == RTTST_TMBENCH_TASK) {
-		err = rtdm_task_init(&ctx->timer_task, "timerbench",
-				timer_task_proc, ctx,
-				config->priority, 0);
+		err = rtdm_task_init_on(&ctx->timer_task, "timerbench",
+					timer_task_proc, ctx,
+					config->priority, 0,
+					ctx->cpu >= 0 ?
+					cpumask_of(ctx->cpu) : NULL);
 		if (!err)
 			ctx->mode = RTTST_TMBENCH_TASK;
 	} else {
@@ -301,6 +307,9 @@ static int rt_tmbench_start(struct rtdm_fd *fd,
 		ctx->mode = RTTST_TMBENCH_HANDLER;
 
 		cobalt_atomic_enter(s);
+		if (ctx->cpu >= 0)
+			xntimer_set_affinity(&ctx->timer,
+					     xnsched_struct(ctx->cpu));
 		ctx->start_time = rtdm_clock_read_monotonic();
 
 		/* first event: one millisecond from now. */
@@ -452,6 +461,15 @@ static int rt_tmbench_ioctl_nrt(struct rtdm_fd *fd,
 	COMPAT_CASE(RTTST_RTIOC_TMBENCH_STOP):
 		err = rt_tmbench_stop(ctx, arg);
 		break;
+
+	case RTTST_RTIOC_TMBENCH_SET_CPU:
+		/* Applies to the next RTTST_RTIOC_TMBENCH_START request. */
+		if ((unsigned long)arg >= nr_cpu_ids ||
+		    !xnsched_supported_cpu((unsigned long)arg))
+			return -EINVAL;
+
+		ctx->cpu = (unsigned long)arg;
+		break;
 	default:
 		err = -EINVAL;
 	}
@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * Xenomai is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published
+ * by the Free Software Foundation; either version 2 of the License,
+ * or (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+ * 02111-1307, USA.
+ */
+#include <linux/module.h>
+#include <linux/vmalloc.h>
+#include <linux/kernel.h>
+#include <linux/random.h>
+#include <cobalt/kernel/timer.h>
+#include <rtdm/uapi/testing.h>
+#include <rtdm/driver.h>
+
+#define complain(__fmt, __args...)	\
+	printk(XENO_WARNING "timerq bench: " __fmt "\n", ##__args)
+
+/*
+ * All timer queue backends are exercised on private queues which
+ * are not connected to any clock, so that we may compare them in a
+ * single run regardless of the one Cobalt has been configured with.
+ */
+struct timerq_ops {
+	int (*init)(void *q, int nrtimers);
+	void (*destroy)(void *q);
+	void (*insert)(void *q, void *h);
+	void (*remove)(void *q, void *h);
+	void *(*head)(void *q);
+	void *(*holder)(void *holders, int n);
+	xnticks_t *(*date)(void *h);
+	size_t qsize;
+	size_t hsize;
+};
+
+static inline void breathe(int loops)
+{
+	if ((loops % 1000) == 0)
+		rtdm_task_sleep(300000ULL);
+}
+
+#define define_timerq_ops(__name, __qtype, __htype, __init, __destroy,	\
+			  __insert, __remove, __head)			\
+	static int __name ## _init(void *q, int nrtimers)		\
+	{								\
+		return __init((__qtype *)q, nrtimers);			\
+	}								\
+	static void __name ## _destroy(void *q)				\
+	{								\
+		__destroy((__qtype *)q);				\
+	}								\
+	static void __name ## _insert(void *q, void *h)			\
+	{								\
+		__insert((__qtype *)q, (__htype *)h);			\
+	}								\
+	static void __name ## _remove(void *q, void *h)			\
+	{								\
+		__remove((__qtype *)q, (__htype *)h);			\
+	}								\
+	static void *__name ## _head(void *q)				\
+	{								\
+		return __head((__qtype *)q);				\
+	}								\
+	static void *__name ## _holder(void *holders, int n)		\
+	{								\
+		return (__htype *)holders + n;				\
+	}								\
+	static xnticks_t *__name ## _date(void *h)			\
+	{								\
+		return (xnticks_t *)&((__htype *)h)->__name ## _datefield; \
+	}								\
+	static const struct timerq_ops __name ## _ops = {		\
+		.init = __name ## _init,				\
+		.destroy = __name ## _destroy,				\
+		.insert = __name ## _insert,				\
+		.remove = __name ## _remove,				\
+		.head = __name ## _head,				\
+		.holder = __name ## _holder,				\
+		.date = __name ## _date,				\
+		.qsize = sizeof(__qtype),				\
+		.hsize = sizeof(__htype),				\
+	}
+
+static inline int list_q_init(struct list_head *q, int nrtimers)
+{
+	xntlist_init(q);
+	return 0;
+}
+
+static inline void list_q_destroy(struct list_head *q) { }
+
+static inline int rbtree_q_init(struct xntrbq *q, int nrtimers)
+{
+	xntrbq_init(q);
+	return 0;
+}
+
+static inline void rbtree_q_destroy(struct xntrbq *q) { }
+
+#define list_datefield	key
+#define rbtree_datefield	date
+#define heap_datefield	date
+
+define_timerq_ops(list, struct list_head, struct xntlholder,
+		  list_q_init, list_q_destroy,
+		  xntlist_insert, xntlist_remove, xntlist_head);
+
+define_timerq_ops(rbtree, struct xntrbq, struct xntrbholder,
+		  rbtree_q_init, rbtree_q_destroy,
+		  xntrbq_insert, xntrbq_remove, xntrbq_head);
+
+define_timerq_ops(heap, struct xntbheap, struct xntbhholder,
+		  xntbheap_init, xntbheap_destroy,
+		  xntbheap_insert, xntbheap_remove, xntbheap_head);
+
+static const struct timerq_ops *backends[] = {
+	[RTTST_TIMERQ_LIST] = &list_ops,
+	[RTTST_TIMERQ_RBTREE] = &rbtree_ops,
+	[RTTST_TIMERQ_HEAP] = &heap_ops,
+};
+
+static inline xnticks_t random_date(xnticks_t base)
+{
+	/* Spread dates over one second past @base. */
+	return base + 1 + prandom_u32() % 1000000000U;
+}
+
+#define account(__d, __sum, __max)		\
+	do {					\
+		if ((__d) > (__max))		\
+			(__max) = (__d);	\
+		(__sum) += (__d);		\
+	} while (0)
+
+static int run_bench(struct rttst_timerq_bench *bench)
+{
+	long ins_sum = 0, ins_max = 0, rem_sum = 0, rem_max = 0,
+		exp_sum = 0, exp_max = 0, d;
+	const struct timerq_ops *ops;
+	nanosecs_abs_t start, end;
+	void *q, *holders, *h;
+	xnticks_t now, last;
+	int ret, n;
+
+	if (bench->backend < 0 ||
+	    bench->backend >= ARRAY_SIZE(backends) ||
+	    bench->nrtimers <= 0 || bench->loops <= 0)
+		return -EINVAL;
+
+	ops = backends[bench->backend];
+
+	q = vmalloc(ops->qsize);
+	if (q == NULL)
+		return -ENOMEM;
+
+	holders = vmalloc(ops->hsize * bench->nrtimers);
+	if (holders == NULL) {
+		ret = -ENOMEM;
+		goto out_queue;
+	}
+
+	memset(holders, 0, ops->hsize * bench->nrtimers);
+
+	ret = ops->init(q, bench->nrtimers);
+	if (ret)
+		goto out_holders;
+
+	ret = xnthread_harden();
+	if (ret)
+		goto out_destroy;
+
+	/* Insertion cost, queue growing from empty to nrtimers. */
+	now = 0;
+	for (n = 0; n < bench->nrtimers; n++) {
+		h = ops->holder(holders, n);
+		*ops->date(h) = random_date(now);
+		start = rtdm_clock_read_monotonic();
+		ops->insert(q, h);
+		end = rtdm_clock_read_monotonic();
+		d = end - start;
+		account(d, ins_sum, ins_max);
+		breathe(n + 1);
+	}
+
+	/* Removal cost of random timers, e.g. timeout cancellation. */
+	for (n = 0; n < bench->loops; n++) {
+		h = ops->holder(holders, prandom_u32() % bench->nrtimers);
+		start = rtdm_clock_read_monotonic();
+		ops->remove(q, h);
+		end = rtdm_clock_read_monotonic();
+		d = end - start;
+		account(d, rem_sum, rem_max);
+		*ops->date(h) = random_date(now);
+		ops->insert(q, h);
+		breathe(n + 1);
+	}
+
+	/*
+	 * Expiry cost: fetch the heading timer then dequeue it, as
+	 * the tick handler does. Elapsed timers are rearmed later
+	 * in time, which also checks the queue ordering.
+	 */
+	last = 0;
+	for (n = 0; n < bench->loops; n++) {
+		start = rtdm_clock_read_monotonic();
+		h = ops->head(q);
+		ops->remove(q, h);
+		end = rtdm_clock_read_monotonic();
+		d = end - start;
+		account(d, exp_sum, exp_max);
+		if (*ops->date(h) < last) {
+			complain("queue out of order (%s backend, %d timers)",
+				 bench->backend == RTTST_TIMERQ_LIST ? "list" :
+				 bench->backend == RTTST_TIMERQ_RBTREE ?
+				 "rbtree" : "heap", bench->nrtimers);
+			ret = -EPROTO;
+			break;
+		}
+		last = now = *ops->date(h);
+		*ops->date(h) = random_date(now);
+		ops->insert(q, h);
+		breathe(n + 1);
+	}
+
+	xnthread_relax(0, 0);
+
+	for (n = 0; n < bench->nrtimers; n++) {
+		/* The misordered holder was dequeued already. */
+		if (ret && ops->holder(holders, n) == h)
+			continue;
+		ops->remove(q, ops->holder(holders, n));
+	}
+
+	bench->insert_avg_ns = ins_sum / bench->nrtimers;
+	bench->insert_max_ns = ins_max;
+	bench->remove_avg_ns = rem_sum / bench->loops;
+	bench->remove_max_ns = rem_max;
+	bench->expire_avg_ns = exp_sum / bench->loops;
+	bench->expire_max_ns = exp_max;
+out_destroy:
+	ops->destroy(q);
+out_holders:
+	vfree(holders);
+out_queue:
+	vfree(q);
+
+	return ret;
+}
+
+static int timerqbench_ioctl(struct rtdm_fd *fd,
+			     unsigned int request, void __user *arg)
+{
+	struct rttst_timerq_bench bench;
+	int ret;
+
+	switch (request) {
+	case RTTST_RTIOC_TIMERQ_BENCH:
+		ret = rtdm_copy_from_user(fd, &bench, arg, sizeof(bench));
+		if (ret)
+			return ret;
+		ret = run_bench(&bench);
+		if (ret)
+			return ret;
+		ret = rtdm_copy_to_user(fd, arg, &bench, sizeof(bench));
+		break;
+	default:
+		ret = -EINVAL;
+	}
+
+	return ret;
+}
+
+static struct rtdm_driver timerqbench_driver = {
+	.profile_info		= RTDM_PROFILE_INFO(timerq_bench,
+						    RTDM_CLASS_TESTING,
+						    RTDM_SUBCLASS_TIMERQBENCH,
+						    RTTST_PROFILE_VER),
+	.device_flags		= RTDM_NAMED_DEVICE | RTDM_EXCLUSIVE,
+	.device_count		= 1,
+	.ops = {
+		.ioctl_nrt	= timerqbench_ioctl,
+	},
+};
+
+static struct rtdm_device timerqbench_device = {
+	.driver = &timerqbench_driver,
+	.label = "timerqbench",
+};
+
+static int __init timerqbench_init(void)
+{
+	if (!realtime_core_enabled())
+		return -ENODEV;
+
+	return rtdm_dev_register(&timerqbench_device);
+}
+
+static void __exit timerqbench_exit(void)
+{
+	rtdm_dev_unregister(&timerqbench_device);
+}
+
+module_init(timerqbench_init);
+module_exit(timerqbench_exit);
+MODULE_LICENSE("GPL");
@@ -26,9 +26,11 @@
 #include <rtdm/analogy.h>
 #include <stdio.h>
 #include <errno.h>
+#include <stdint.h>
 #include "iniparser/iniparser.h"
 #include "boilerplate/list.h"
 #include "calibration.h"
+#include "internal.h"
 
 #define CHK(func, ...)								\
 do {										\
@@ -39,24 +41,9 @@ do {										\
 
 #define ARRAY_LEN(a)  (sizeof(a) / sizeof((a)[0]))
 
-static lsampl_t data32_get(void *src)
-{
-	return (lsampl_t) * ((lsampl_t *) (src));
-}
-
-static lsampl_t data16_get(void *src)
-{
-	return (lsampl_t) * ((sampl_t *) (src));
-}
-
-static lsampl_t data8_get(void *src)
-{
-	return (lsampl_t) * ((unsigned char *)(src));
-}
-
 static void data32_set(void *dst, lsampl_t val)
 {
-	*((lsampl_t *) (dst)) = val;
+	*((uint32_t *) (dst)) = (uint32_t) val;
 }
 
 static void data16_set(void *dst, lsampl_t val)
@@ -348,54 +335,31 @@ int a4l_get_softcal_converter(struct a4l_polynomial *converter,
 int a4l_rawtodcal(a4l_chinfo_t *chan, double *dst, void *src,
 		  int cnt, struct a4l_polynomial *converter)
 {
-	int i = 0, j = 0, k = 0;
-	double term = 1.0;
-	lsampl_t tmp;
-	int size;
-
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
+	int idx;
 
 	/* Basic checking */
 	if (chan == NULL)
 		return -EINVAL;
 
 	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	idx = __a4l_convert_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
-	while (j < cnt) {
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
+	if (cnt <= 0)
+		return 0;
 
-		/* Perform the conversion */
-		dst[j] = 0.0;
-		term = 1.0;
-		for (k = 0; k < converter->nb_coeff; k++) {
-			dst[j] += converter->coeff[k] * term;
-			term *= tmp - converter->expansion;
-		}
+	/*
+	 * Evaluate the polynomial with the best suited kernel; the
+	 * offset from the expansion origin is computed in double
+	 * precision, so that samples below the origin do not wrap.
+	 */
+	__a4l_get_convert_ops()->rawtodpoly[idx](dst, src, cnt,
+						 converter->coeff,
+						 converter->nb_coeff,
+						 converter->expansion);
 
-		/* Update the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt;
 }
 
 /**
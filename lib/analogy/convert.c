@@ -0,0 +1,883 @@
+/**
+ * @file
+ * Analogy for Linux, batch conversion kernels
+ *
+ * @note Copyright (C) 2026 Xenomai contributors
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA.
+ */
+
+/*
+ * The raw <-> physical conversion routines of range.c and
+ * calibration.c funnel through the kernels below, which come in one
+ * flavour per sample width (8, 16 and 32 bits) and per instruction
+ * set. The SIMD kernels must produce exactly the same bits as the
+ * scalar ones, therefore:
+ *
+ * - multiplications and additions are issued separately in the
+ *   original evaluation order (this library is built with
+ *   -ffp-contract=off so that the compiler does not fuse them
+ *   behind our back either);
+ *
+ * - integer to floating-point conversions are exact or correctly
+ *   rounded on both sides;
+ *
+ * - floating-point to raw conversions only take the vector path when
+ *   the truncated value is known to yield the same low-order bits as
+ *   the scalar (lsampl_t) cast, otherwise the block is handed over to
+ *   the scalar kernel.
+ *
+ * The SSE2 and AVX2 kernels are selected at runtime on x86_64, the
+ * NEON ones are always available on aarch64. Setting A4L_CONVERT to
+ * "scalar", "sse2", "avx2" or "neon" in the environment forces a
+ * particular implementation, provided it is supported.
+ */
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "internal.h"
+#include <rtdm/analogy.h>
+
+#if defined(__x86_64__) && (__GNUC__ >= 5 || defined(__clang__))
+#define CONFIG_A4L_CONVERT_X86
+#include <immintrin.h>
+#define __sse2 __attribute__((target("sse2")))
+#define __avx2 __attribute__((target("avx2")))
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+#define CONFIG_A4L_CONVERT_NEON
+#include <arm_neon.h>
+#endif
+
+#define ARRAY_LEN(a)  (sizeof(a) / sizeof((a)[0]))
+
+#define __kernel_inline inline __attribute__((always_inline))
+
+/* --- Scalar kernels (reference implementation) --- */
+
+static __kernel_inline lsampl_t load_raw(const void *src, int n, int width)
+{
+	switch (width) {
+	case 1:
+		return ((const uint8_t *)src)[n];
+	case 2:
+		return ((const uint16_t *)src)[n];
+	default:
+		return ((const uint32_t *)src)[n];
+	}
+}
+
+static __kernel_inline void store_raw(void *dst, int n,
+				      lsampl_t val, int width)
+{
+	switch (width) {
+	case 1:
+		((uint8_t *)dst)[n] = (uint8_t)(val & 0xff);
+		break;
+	case 2:
+		((uint16_t *)dst)[n] = (uint16_t)(val & 0xffff);
+		break;
+	default:
+		((uint32_t *)dst)[n] = (uint32_t)val;
+	}
+}
+
+static __kernel_inline
+void scalar_rawtof(float *dst, const void *src, int cnt,
+		   float a, float b, int width)
+{
+	int n;
+
+	for (n = 0; n < cnt; n++)
+		dst[n] = a * load_raw(src, n, width) + b;
+}
+
+static __kernel_inline
+void scalar_rawtod(double *dst, const void *src, int cnt,
+		   double a, double b, int width)
+{
+	int n;
+
+	for (n = 0; n < cnt; n++)
+		dst[n] = a * load_raw(src, n, width) + b;
+}
+
+static __kernel_inline
+void scalar_ftoraw(void *dst, const float *src, int cnt,
+		   float a, float b, int width)
+{
+	int n;
+
+	for (n = 0; n < cnt; n++)
+		store_raw(dst, n, (lsampl_t)(a * src[n] - b), width);
+}
+
+static __kernel_inline
+void scalar_dtoraw(void *dst, const double *src, int cnt,
+		   double a, double b, int width)
+{
+	int n;
+
+	for (n = 0; n < cnt; n++)
+		store_raw(dst, n, (lsampl_t)(a * src[n] - b), width);
+}
+
+static __kernel_inline
+void scalar_rawtodpoly(double *dst, const void *src, int cnt,
+		       const double *coeff, int nb_coeff,
+		       double expansion, int width)
+{
+	double x, term, value;
+	int n, k;
+
+	for (n = 0; n < cnt; n++) {
+		x = (double)load_raw(src, n, width) - expansion;
+		value = 0.0;
+		term = 1.0;
+		for (k = 0; k < nb_coeff; k++) {
+			value += coeff[k] * term;
+			term *= x;
+		}
+		dst[n] = value;
+	}
+}
+
+/*
+ * Instantiate one out-of-line routine per sample width from the
+ * generic kernels of a given flavour.
+ */
+#define define_convert_kernels(__isa, __attr)				\
+static __attr void __isa ## _rawtof_ ## 1(float *dst, const void *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _rawtof(dst, src, cnt, a, b, 1); }				\
+static __attr void __isa ## _rawtof_ ## 2(float *dst, const void *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _rawtof(dst, src, cnt, a, b, 2); }				\
+static __attr void __isa ## _rawtof_ ## 4(float *dst, const void *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _rawtof(dst, src, cnt, a, b, 4); }				\
+static __attr void __isa ## _rawtod_ ## 1(double *dst, const void *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _rawtod(dst, src, cnt, a, b, 1); }				\
+static __attr void __isa ## _rawtod_ ## 2(double *dst, const void *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _rawtod(dst, src, cnt, a, b, 2); }				\
+static __attr void __isa ## _rawtod_ ## 4(double *dst, const void *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _rawtod(dst, src, cnt, a, b, 4); }				\
+static __attr void __isa ## _ftoraw_ ## 1(void *dst, const float *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _ftoraw(dst, src, cnt, a, b, 1); }				\
+static __attr void __isa ## _ftoraw_ ## 2(void *dst, const float *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _ftoraw(dst, src, cnt, a, b, 2); }				\
+static __attr void __isa ## _ftoraw_ ## 4(void *dst, const float *src,	\
+			int cnt, float a, float b)			\
+{ __isa ## _ftoraw(dst, src, cnt, a, b, 4); }				\
+static __attr void __isa ## _dtoraw_ ## 1(void *dst, const double *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _dtoraw(dst, src, cnt, a, b, 1); }				\
+static __attr void __isa ## _dtoraw_ ## 2(void *dst, const double *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _dtoraw(dst, src, cnt, a, b, 2); }				\
+static __attr void __isa ## _dtoraw_ ## 4(void *dst, const double *src,	\
+			int cnt, double a, double b)			\
+{ __isa ## _dtoraw(dst, src, cnt, a, b, 4); }				\
+static __attr void __isa ## _rawtodpoly_ ## 1(double *dst,		\
+			const void *src, int cnt, const double *coeff,	\
+			int nb_coeff, double expansion)			\
+{ __isa ## _rawtodpoly(dst, src, cnt, coeff, nb_coeff, expansion, 1); }	\
+static __attr void __isa ## _rawtodpoly_ ## 2(double *dst,		\
+			const void *src, int cnt, const double *coeff,	\
+			int nb_coeff, double expansion)			\
+{ __isa ## _rawtodpoly(dst, src, cnt, coeff, nb_coeff, expansion, 2); }	\
+static __attr void __isa ## _rawtodpoly_ ## 4(double *dst,		\
+			const void *src, int cnt, const double *coeff,	\
+			int nb_coeff, double expansion)			\
+{ __isa ## _rawtodpoly(dst, src, cnt, coeff, nb_coeff, expansion, 4); }	\
+static const struct a4l_convert_ops __isa ## _convert_ops = {		\
+	.name = #__isa,							\
+	.rawtof = {							\
+		__isa ## _rawtof_1,					\
+		__isa ## _rawtof_2,					\
+		__isa ## _rawtof_4,					\
+	},								\
+	.rawtod = {							\
+		__isa ## _rawtod_1,					\
+		__isa ## _rawtod_2,					\
+		__isa ## _rawtod_4,					\
+	},								\
+	.ftoraw = {							\
+		__isa ## _ftoraw_1,					\
+		__isa ## _ftoraw_2,					\
+		__isa ## _ftoraw_4,					\
+	},								\
+	.dtoraw = {							\
+		__isa ## _dtoraw_1,					\
+		__isa ## _dtoraw_2,					\
+		__isa ## _dtoraw_4,					\
+	},								\
+	.rawtodpoly = {							\
+		__isa ## _rawtodpoly_1,					\
+		__isa ## _rawtodpoly_2,					\
+		__isa ## _rawtodpoly_4,					\
+	},								\
+}
+
+define_convert_kernels(scalar, );
+
+#ifdef CONFIG_A4L_CONVERT_X86
+
+/* --- SSE2 kernels, 4 samples per round --- */
+
+static __sse2 __kernel_inline __m128i sse2_load(const void *src, int width)
+{
+	__m128i z = _mm_setzero_si128(), v;
+	int32_t w;
+
+	switch (width) {
+	case 1:
+		memcpy(&w, src, sizeof(w));
+		v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(w), z);
+		return _mm_unpacklo_epi16(v, z);
+	case 2:
+		v = _mm_loadl_epi64((const __m128i *)src);
+		return _mm_unpacklo_epi16(v, z);
+	default:
+		return _mm_loadu_si128((const __m128i *)src);
+	}
+}
+
+static __sse2 __kernel_inline void sse2_store(void *dst, __m128i v, int width)
+{
+	int32_t w;
+
+	switch (width) {
+	case 1:
+		v = _mm_and_si128(v, _mm_set1_epi32(0xff));
+		v = _mm_packs_epi32(v, v);
+		v = _mm_packus_epi16(v, v);
+		w = _mm_cvtsi128_si32(v);
+		memcpy(dst, &w, sizeof(w));
+		break;
+	case 2:
+		/* Sign-extend the low halves so that packs won't saturate. */
+		v = _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+		_mm_storel_epi64((__m128i *)dst, _mm_packs_epi32(v, v));
+		break;
+	default:
+		_mm_storeu_si128((__m128i *)dst, v);
+	}
+}
+
+static __sse2 __kernel_inline __m128 sse2_cvt_ps(__m128i v, int width)
+{
+	__m128 hi, lo;
+
+	if (width < 4)
+		return _mm_cvtepi32_ps(v);
+
+	/*
+	 * Unsigned 32bit values: both halves convert exactly, so the
+	 * sum is rounded once, like the scalar conversion.
+	 */
+	hi = _mm_cvtepi32_ps(_mm_srli_epi32(v, 16));
+	lo = _mm_cvtepi32_ps(_mm_and_si128(v, _mm_set1_epi32(0xffff)));
+
+	return _mm_add_ps(_mm_mul_ps(hi, _mm_set1_ps(65536.0f)), lo);
+}
+
+static __sse2 __kernel_inline __m128d sse2_cvt_pd(__m128i v, int width)
+{
+	__m128d d = _mm_cvtepi32_pd(v), m;
+
+	if (width < 4)
+		return d;
+
+	/* Fix up unsigned values above INT32_MAX, exactly. */
+	m = _mm_cmplt_pd(d, _mm_setzero_pd());
+
+	return _mm_add_pd(d, _mm_and_pd(m, _mm_set1_pd(4294967296.0)));
+}
+
+static __sse2 __kernel_inline
+void sse2_rawtof(float *dst, const void *src, int cnt,
+		 float a, float b, int width)
+{
+	__m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), v;
+	int n;
+
+	for (n = 0; n + 4 <= cnt; n += 4) {
+		v = sse2_cvt_ps(sse2_load(src + n * width, width), width);
+		_mm_storeu_ps(dst + n, _mm_add_ps(_mm_mul_ps(va, v), vb));
+	}
+
+	scalar_rawtof(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __sse2 __kernel_inline
+void sse2_rawtod(double *dst, const void *src, int cnt,
+		 double a, double b, int width)
+{
+	__m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), lo, hi;
+	__m128i v;
+	int n;
+
+	for (n = 0; n + 4 <= cnt; n += 4) {
+		v = sse2_load(src + n * width, width);
+		lo = sse2_cvt_pd(v, width);
+		hi = sse2_cvt_pd(_mm_unpackhi_epi64(v, v), width);
+		_mm_storeu_pd(dst + n, _mm_add_pd(_mm_mul_pd(va, lo), vb));
+		_mm_storeu_pd(dst + n + 2, _mm_add_pd(_mm_mul_pd(va, hi), vb));
+	}
+
+	scalar_rawtod(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __sse2 __kernel_inline
+void sse2_ftoraw(void *dst, const float *src, int cnt,
+		 float a, float b, int width)
+{
+	__m128 va = _mm_set1_ps(a), vb = _mm_set1_ps(b), v,
+		abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)),
+		lim = _mm_set1_ps(2147483648.0f);
+	int n;
+
+	for (n = 0; n + 4 <= cnt; n += 4) {
+		v = _mm_sub_ps(_mm_mul_ps(va, _mm_loadu_ps(src + n)), vb);
+		/*
+		 * cvttps2dq and the scalar (lsampl_t) cast agree on the
+		 * low-order bits as long as the result fits in 32 bits.
+		 */
+		if (_mm_movemask_ps(_mm_cmplt_ps(_mm_and_ps(v, abs), lim)) != 0xf)
+			scalar_ftoraw(dst + n * width, src + n, 4, a, b, width);
+		else
+			sse2_store(dst + n * width, _mm_cvttps_epi32(v), width);
+	}
+
+	scalar_ftoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __sse2 __kernel_inline
+void sse2_dtoraw(void *dst, const double *src, int cnt,
+		 double a, double b, int width)
+{
+	__m128d va = _mm_set1_pd(a), vb = _mm_set1_pd(b), lo, hi,
+		abs = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL)),
+		lim = _mm_set1_pd(2147483648.0);
+	int n, m;
+
+	for (n = 0; n + 4 <= cnt; n += 4) {
+		lo = _mm_sub_pd(_mm_mul_pd(va, _mm_loadu_pd(src + n)), vb);
+		hi = _mm_sub_pd(_mm_mul_pd(va, _mm_loadu_pd(src + n + 2)), vb);
+		m = _mm_movemask_pd(_mm_cmplt_pd(_mm_and_pd(lo, abs), lim)) &
+			_mm_movemask_pd(_mm_cmplt_pd(_mm_and_pd(hi, abs), lim));
+		if (m != 0x3)
+			scalar_dtoraw(dst + n * width, src + n, 4, a, b, width);
+		else
+			sse2_store(dst + n * width,
+				   _mm_unpacklo_epi64(_mm_cvttpd_epi32(lo),
+						      _mm_cvttpd_epi32(hi)),
+				   width);
+	}
+
+	scalar_dtoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __sse2 __kernel_inline
+__m128d sse2_poly(__m128d x, const double *coeff, int nb_coeff)
+{
+	__m128d value = _mm_setzero_pd(), term = _mm_set1_pd(1.0);
+	int k;
+
+	for (k = 0; k < nb_coeff; k++) {
+		value = _mm_add_pd(value,
+				   _mm_mul_pd(_mm_set1_pd(coeff[k]), term));
+		term = _mm_mul_pd(term, x);
+	}
+
+	return value;
+}
+
+static __sse2 __kernel_inline
+void sse2_rawtodpoly(double *dst, const void *src, int cnt,
+		     const double *coeff, int nb_coeff,
+		     double expansion, int width)
+{
+	__m128d ve = _mm_set1_pd(expansion), lo, hi;
+	__m128i v;
+	int n;
+
+	for (n = 0; n + 4 <= cnt; n += 4) {
+		v = sse2_load(src + n * width, width);
+		lo = _mm_sub_pd(sse2_cvt_pd(v, width), ve);
+		hi = _mm_sub_pd(sse2_cvt_pd(_mm_unpackhi_epi64(v, v), width), ve);
+		_mm_storeu_pd(dst + n, sse2_poly(lo, coeff, nb_coeff));
+		_mm_storeu_pd(dst + n + 2, sse2_poly(hi, coeff, nb_coeff));
+	}
+
+	scalar_rawtodpoly(dst + n, src + n * width, cnt - n,
+			  coeff, nb_coeff, expansion, width);
+}
+
+define_convert_kernels(sse2, __sse2);
+
+/* --- AVX2 kernels, 8 samples per round --- */
+
+static __avx2 __kernel_inline __m256i avx2_load(const void *src, int width)
+{
+	switch (width) {
+	case 1:
+		return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)src));
+	case 2:
+		return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)src));
+	default:
+		return _mm256_loadu_si256((const __m256i *)src);
+	}
+}
+
+static __avx2 __kernel_inline void avx2_store(void *dst, __m256i v, int width)
+{
+	switch (width) {
+	case 1:
+		/* Packing works per 128bit lane, gather dwords 0 and 4. */
+		v = _mm256_and_si256(v, _mm256_set1_epi32(0xff));
+		v = _mm256_packus_epi32(v, v);
+		v = _mm256_packus_epi16(v, v);
+		v = _mm256_permutevar8x32_epi32(v, _mm256_setr_epi32(0, 4, 0, 4,
+								     0, 4, 0, 4));
+		_mm_storel_epi64((__m128i *)dst, _mm256_castsi256_si128(v));
+		break;
+	case 2:
+		v = _mm256_and_si256(v, _mm256_set1_epi32(0xffff));
+		v = _mm256_packus_epi32(v, v);
+		v = _mm256_permute4x64_epi64(v, 0x08);
+		_mm_storeu_si128((__m128i *)dst, _mm256_castsi256_si128(v));
+		break;
+	default:
+		_mm256_storeu_si256((__m256i *)dst, v);
+	}
+}
+
+static __avx2 __kernel_inline __m256 avx2_cvt_ps(__m256i v, int width)
+{
+	__m256 hi, lo;
+
+	if (width < 4)
+		return _mm256_cvtepi32_ps(v);
+
+	hi = _mm256_cvtepi32_ps(_mm256_srli_epi32(v, 16));
+	lo = _mm256_cvtepi32_ps(_mm256_and_si256(v, _mm256_set1_epi32(0xffff)));
+
+	return _mm256_add_ps(_mm256_mul_ps(hi, _mm256_set1_ps(65536.0f)), lo);
+}
+
+static __avx2 __kernel_inline __m256d avx2_cvt_pd(__m128i v, int width)
+{
+	__m256d d = _mm256_cvtepi32_pd(v), m;
+
+	if (width < 4)
+		return d;
+
+	m = _mm256_cmp_pd(d, _mm256_setzero_pd(), _CMP_LT_OQ);
+
+	return _mm256_add_pd(d, _mm256_and_pd(m, _mm256_set1_pd(4294967296.0)));
+}
+
+static __avx2 __kernel_inline
+void avx2_rawtof(float *dst, const void *src, int cnt,
+		 float a, float b, int width)
+{
+	__m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), v;
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		v = avx2_cvt_ps(avx2_load(src + n * width, width), width);
+		_mm256_storeu_ps(dst + n, _mm256_add_ps(_mm256_mul_ps(va, v), vb));
+	}
+
+	scalar_rawtof(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __avx2 __kernel_inline
+void avx2_rawtod(double *dst, const void *src, int cnt,
+		 double a, double b, int width)
+{
+	__m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), lo, hi;
+	__m256i v;
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		v = avx2_load(src + n * width, width);
+		lo = avx2_cvt_pd(_mm256_castsi256_si128(v), width);
+		hi = avx2_cvt_pd(_mm256_extracti128_si256(v, 1), width);
+		_mm256_storeu_pd(dst + n,
+				 _mm256_add_pd(_mm256_mul_pd(va, lo), vb));
+		_mm256_storeu_pd(dst + n + 4,
+				 _mm256_add_pd(_mm256_mul_pd(va, hi), vb));
+	}
+
+	scalar_rawtod(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __avx2 __kernel_inline
+void avx2_ftoraw(void *dst, const float *src, int cnt,
+		 float a, float b, int width)
+{
+	__m256 va = _mm256_set1_ps(a), vb = _mm256_set1_ps(b), v,
+		abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff)),
+		lim = _mm256_set1_ps(2147483648.0f);
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		v = _mm256_sub_ps(_mm256_mul_ps(va, _mm256_loadu_ps(src + n)), vb);
+		if (_mm256_movemask_ps(_mm256_cmp_ps(_mm256_and_ps(v, abs),
+						     lim, _CMP_LT_OQ)) != 0xff)
+			scalar_ftoraw(dst + n * width, src + n, 8, a, b, width);
+		else
+			avx2_store(dst + n * width, _mm256_cvttps_epi32(v), width);
+	}
+
+	scalar_ftoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __avx2 __kernel_inline
+void avx2_dtoraw(void *dst, const double *src, int cnt,
+		 double a, double b, int width)
+{
+	__m256d va = _mm256_set1_pd(a), vb = _mm256_set1_pd(b), lo, hi,
+		abs = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffLL)),
+		lim = _mm256_set1_pd(2147483648.0);
+	__m256i v;
+	int n, m;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		lo = _mm256_sub_pd(_mm256_mul_pd(va, _mm256_loadu_pd(src + n)), vb);
+		hi = _mm256_sub_pd(_mm256_mul_pd(va, _mm256_loadu_pd(src + n + 4)), vb);
+		m = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(lo, abs),
+						     lim, _CMP_LT_OQ)) &
+			_mm256_movemask_pd(_mm256_cmp_pd(_mm256_and_pd(hi, abs),
+							 lim, _CMP_LT_OQ));
+		if (m != 0xf) {
+			scalar_dtoraw(dst + n * width, src + n, 8, a, b, width);
+			continue;
+		}
+		v = _mm256_castsi128_si256(_mm256_cvttpd_epi32(lo));
+		v = _mm256_inserti128_si256(v, _mm256_cvttpd_epi32(hi), 1);
+		avx2_store(dst + n * width, v, width);
+	}
+
+	scalar_dtoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __avx2 __kernel_inline
+__m256d avx2_poly(__m256d x, const double *coeff, int nb_coeff)
+{
+	__m256d value = _mm256_setzero_pd(), term = _mm256_set1_pd(1.0);
+	int k;
+
+	for (k = 0; k < nb_coeff; k++) {
+		value = _mm256_add_pd(value,
+				      _mm256_mul_pd(_mm256_set1_pd(coeff[k]), term));
+		term = _mm256_mul_pd(term, x);
+	}
+
+	return value;
+}
+
+static __avx2 __kernel_inline
+void avx2_rawtodpoly(double *dst, const void *src, int cnt,
+		     const double *coeff, int nb_coeff,
+		     double expansion, int width)
+{
+	__m256d ve = _mm256_set1_pd(expansion), lo, hi;
+	__m256i v;
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		v = avx2_load(src + n * width, width);
+		lo = _mm256_sub_pd(avx2_cvt_pd(_mm256_castsi256_si128(v), width), ve);
+		hi = _mm256_sub_pd(avx2_cvt_pd(_mm256_extracti128_si256(v, 1),
+					       width), ve);
+		_mm256_storeu_pd(dst + n, avx2_poly(lo, coeff, nb_coeff));
+		_mm256_storeu_pd(dst + n + 4, avx2_poly(hi, coeff, nb_coeff));
+	}
+
+	scalar_rawtodpoly(dst + n, src + n * width, cnt - n,
+			  coeff, nb_coeff, expansion, width);
+}
+
+define_convert_kernels(avx2, __avx2);
+
+#endif /* CONFIG_A4L_CONVERT_X86 */
+
+#ifdef CONFIG_A4L_CONVERT_NEON
+
+/* --- NEON kernels, 8 samples per round --- */
+
+static __kernel_inline void neon_load(const void *src, int width,
+				      uint32x4_t *lo, uint32x4_t *hi)
+{
+	uint16x8_t h;
+
+	switch (width) {
+	case 1:
+		h = vmovl_u8(vld1_u8(src));
+		break;
+	case 2:
+		h = vld1q_u16(src);
+		break;
+	default:
+		*lo = vld1q_u32(src);
+		*hi = vld1q_u32(src + 16);
+		return;
+	}
+
+	*lo = vmovl_u16(vget_low_u16(h));
+	*hi = vmovl_u16(vget_high_u16(h));
+}
+
+/* vmovn keeps the low-order bits, like the scalar masking does. */
+static __kernel_inline void neon_store(void *dst, int width,
+				       uint32x4_t lo, uint32x4_t hi)
+{
+	uint16x8_t h;
+
+	switch (width) {
+	case 1:
+		h = vcombine_u16(vmovn_u32(lo), vmovn_u32(hi));
+		vst1_u8(dst, vmovn_u16(h));
+		break;
+	case 2:
+		vst1q_u16(dst, vcombine_u16(vmovn_u32(lo), vmovn_u32(hi)));
+		break;
+	default:
+		vst1q_u32(dst, lo);
+		vst1q_u32(dst + 16, hi);
+	}
+}
+
+/*
+ * fcvtzu on 64bit lanes followed by a narrowing move is exactly what
+ * the scalar (lsampl_t) cast does, so no range check is needed.
+ */
+static __kernel_inline uint32x4_t neon_trunc_pd(float64x2_t lo, float64x2_t hi)
+{
+	return vcombine_u32(vmovn_u64(vcvtq_u64_f64(lo)),
+			    vmovn_u64(vcvtq_u64_f64(hi)));
+}
+
+static __kernel_inline uint32x4_t neon_trunc_ps(float32x4_t v)
+{
+	return neon_trunc_pd(vcvt_f64_f32(vget_low_f32(v)),
+			     vcvt_high_f64_f32(v));
+}
+
+static __kernel_inline
+void neon_rawtof(float *dst, const void *src, int cnt,
+		 float a, float b, int width)
+{
+	float32x4_t va = vdupq_n_f32(a), vb = vdupq_n_f32(b);
+	uint32x4_t lo, hi;
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		neon_load(src + n * width, width, &lo, &hi);
+		vst1q_f32(dst + n,
+			  vaddq_f32(vmulq_f32(va, vcvtq_f32_u32(lo)), vb));
+		vst1q_f32(dst + n + 4,
+			  vaddq_f32(vmulq_f32(va, vcvtq_f32_u32(hi)), vb));
+	}
+
+	scalar_rawtof(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __kernel_inline
+void neon_rawtod(double *dst, const void *src, int cnt,
+		 double a, double b, int width)
+{
+	float64x2_t va = vdupq_n_f64(a), vb = vdupq_n_f64(b), x[4];
+	uint32x4_t lo, hi;
+	int n, k;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		neon_load(src + n * width, width, &lo, &hi);
+		x[0] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(lo)));
+		x[1] = vcvtq_f64_u64(vmovl_u32(vget_high_u32(lo)));
+		x[2] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(hi)));
+		x[3] = vcvtq_f64_u64(vmovl_u32(vget_high_u32(hi)));
+		for (k = 0; k < 4; k++)
+			vst1q_f64(dst + n + k * 2,
+				  vaddq_f64(vmulq_f64(va, x[k]), vb));
+	}
+
+	scalar_rawtod(dst + n, src + n * width, cnt - n, a, b, width);
+}
+
+static __kernel_inline
+void neon_ftoraw(void *dst, const float *src, int cnt,
+		 float a, float b, int width)
+{
+	float32x4_t va = vdupq_n_f32(a), vb = vdupq_n_f32(b), lo, hi;
+	int n;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		lo = vsubq_f32(vmulq_f32(va, vld1q_f32(src + n)), vb);
+		hi = vsubq_f32(vmulq_f32(va, vld1q_f32(src + n + 4)), vb);
+		neon_store(dst + n * width, width,
+			   neon_trunc_ps(lo), neon_trunc_ps(hi));
+	}
+
+	scalar_ftoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __kernel_inline
+void neon_dtoraw(void *dst, const double *src, int cnt,
+		 double a, double b, int width)
+{
+	float64x2_t va = vdupq_n_f64(a), vb = vdupq_n_f64(b), x[4];
+	int n, k;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		for (k = 0; k < 4; k++)
+			x[k] = vsubq_f64(vmulq_f64(va,
+						   vld1q_f64(src + n + k * 2)), vb);
+		neon_store(dst + n * width, width,
+			   neon_trunc_pd(x[0], x[1]), neon_trunc_pd(x[2], x[3]));
+	}
+
+	scalar_dtoraw(dst + n * width, src + n, cnt - n, a, b, width);
+}
+
+static __kernel_inline
+float64x2_t neon_poly(float64x2_t x, const double *coeff, int nb_coeff)
+{
+	float64x2_t value = vdupq_n_f64(0.0), term = vdupq_n_f64(1.0);
+	int k;
+
+	for (k = 0; k < nb_coeff; k++) {
+		value = vaddq_f64(value, vmulq_f64(vdupq_n_f64(coeff[k]), term));
+		term = vmulq_f64(term, x);
+	}
+
+	return value;
+}
+
+static __kernel_inline
+void neon_rawtodpoly(double *dst, const void *src, int cnt,
+		     const double *coeff, int nb_coeff,
+		     double expansion, int width)
+{
+	float64x2_t ve = vdupq_n_f64(expansion), x[4];
+	uint32x4_t lo, hi;
+	int n, k;
+
+	for (n = 0; n + 8 <= cnt; n += 8) {
+		neon_load(src + n * width, width, &lo, &hi);
+		x[0] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(lo)));
+		x[1] = vcvtq_f64_u64(vmovl_u32(vget_high_u32(lo)));
+		x[2] = vcvtq_f64_u64(vmovl_u32(vget_low_u32(hi)));
+		x[3] = vcvtq_f64_u64(vmovl_u32(vget_high_u32(hi)));
+		for (k = 0; k < 4; k++)
+			vst1q_f64(dst + n + k * 2,
+				  neon_poly(vsubq_f64(x[k], ve),
+					    coeff, nb_coeff));
+	}
+
+	scalar_rawtodpoly(dst + n, src + n * width, cnt - n,
+			  coeff, nb_coeff, expansion, width);
+}
+
+define_convert_kernels(neon, );
+
+#endif /* CONFIG_A4L_CONVERT_NEON */
+
+static const struct a4l_convert_ops *convert_ops_table[] = {
+#ifdef CONFIG_A4L_CONVERT_X86
+	&avx2_convert_ops,
+	&sse2_convert_ops,
+#endif
+#ifdef CONFIG_A4L_CONVERT_NEON
+	&neon_convert_ops,
+#endif
+	&scalar_convert_ops,
+};
+
+static int convert_ops_usable(const struct a4l_convert_ops *ops)
+{
+#ifdef CONFIG_A4L_CONVERT_X86
+	__builtin_cpu_init();
+
+	if (ops == &avx2_convert_ops)
+		return __builtin_cpu_supports("avx2");
+	if (ops == &sse2_convert_ops)
+		return __builtin_cpu_supports("sse2");
+#endif
+	return 1;
+}
+
+static const struct a4l_convert_ops *select_convert_ops(void)
+{
+	const char *name = getenv("A4L_CONVERT");
+	int n;
+
+	if (name) {
+		for (n = 0; n < ARRAY_LEN(convert_ops_table); n++) {
+			if (strcmp(convert_ops_table[n]->name, name) == 0 &&
+			    convert_ops_usable(convert_ops_table[n]))
+				return convert_ops_table[n];
+		}
+	}
+
+	/* The table is ordered by preference. */
+	for (n = 0; n < ARRAY_LEN(convert_ops_table); n++) {
+		if (convert_ops_usable(convert_ops_table[n]))
+			break;
+	}
+
+	return convert_ops_table[n];
+}
+
+static const struct a4l_convert_ops *convert_ops;
+
+const struct a4l_convert_ops *__a4l_get_convert_ops(void)
+{
+	const struct a4l_convert_ops *ops = convert_ops;
+
+	/* Racing on the first call is harmless, we'd pick the same. */
+	if (ops == NULL) {
+		ops = select_convert_ops();
+		convert_ops = ops;
+	}
+
+	return ops;
+}
+
+int __a4l_convert_index(int size)
+{
+	switch (size) {
+	case 1:
+		return 0;
+	case 2:
+		return 1;
+	case 4:
+		return 2;
+	default:
+		return -EINVAL;
+	}
+}
@@ -53,6 +53,29 @@ static inline ssize_t __sys_write(int fd, const void *buf, size_t nbyte)
 	return __RT(write(fd, buf, nbyte));
 }
 
+/*
+ * Batch conversion kernels (convert.c), indexed by
+ * __a4l_convert_index(sample size in bytes).
+ */
+struct a4l_convert_ops {
+	const char *name;
+	void (*rawtof[3])(float *dst, const void *src, int cnt,
+			  float a, float b);
+	void (*rawtod[3])(double *dst, const void *src, int cnt,
+			  double a, double b);
+	void (*ftoraw[3])(void *dst, const float *src, int cnt,
+			  float a, float b);
+	void (*dtoraw[3])(void *dst, const double *src, int cnt,
+			  double a, double b);
+	void (*rawtodpoly[3])(double *dst, const void *src, int cnt,
+			      const double *coeff, int nb_coeff,
+			      double expansion);
+};
+
+const struct a4l_convert_ops *__a4l_get_convert_ops(void);
+
+int __a4l_convert_index(int size);
+
 #endif /* !DOXYGEN_CPP */
 
 #endif /* __ANALOGY_LIB_INTERNAL__ */
@@ -22,6 +22,7 @@
 
 #include <errno.h>
 #include <math.h>
+#include <stdint.h>
 #include "internal.h"
 #include <rtdm/analogy.h>
 
@@ -29,7 +30,7 @@
 
 static lsampl_t data32_get(void *src)
 {
-	return (lsampl_t) * ((lsampl_t *) (src));
+	return (lsampl_t) * ((uint32_t *) (src));
 }
 
 static lsampl_t data16_get(void *src)
@@ -44,7 +45,7 @@ static lsampl_t data8_get(void *src)
 
 static void data32_set(void *dst, lsampl_t val)
 {
-	*((lsampl_t *) (dst)) = val;
+	*((uint32_t *) (dst)) = (uint32_t) val;
 }
 
 static void data16_set(void *dst, lsampl_t val)
@@ -308,56 +309,33 @@ int a4l_rawtoul(a4l_chinfo_t * chan, unsigned long *dst, void *src, int cnt)
 int a4l_rawtof(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, float *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
+	int idx;
 
 	/* Temporary values used for conversion
 	   (phys = a * src + b) */
 	float a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
 	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	idx = __a4l_convert_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
 	/* Compute the translation factor and the constant only once */
 	a = ((float)(rng->max - rng->min)) /
 		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
 	b = ((float)rng->min) / A4L_RNG_FACTOR;
 
-	while (j < cnt) {
-
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
+	if (cnt <= 0)
+		return 0;
 
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
+	/* Perform the conversion with the best suited kernel */
+	__a4l_get_convert_ops()->rawtof[idx](dst, src, cnt, a, b);
 
-		/* Update the counters */
-		i += size;
-		j++;
-	}
-
-	return j;
+	return cnt;
 }
 
 /**
@@ -381,56 +359,33 @@ int a4l_rawtof(a4l_chinfo_t * chan,
 int a4l_rawtod(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, double *dst, void *src, int cnt)
 {
-	int size, i = 0, j = 0;
-	lsampl_t tmp;
+	int idx;
 
 	/* Temporary values used for conversion
 	   (phys = a * src + b) */
 	double a, b;
-	/* Temporary data accessor */
-	lsampl_t(*datax_get) (void *);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
 	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Get the suitable accessor */
-	switch (a4l_sizeof_chan(chan)) {
-	case 4:
-		datax_get = data32_get;
-		break;
-	case 2:
-		datax_get = data16_get;
-		break;
-	case 1:
-		datax_get = data8_get;
-		break;
-	default:
+	idx = __a4l_convert_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = ((double)(rng->max - rng->min)) /
 		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
 	b = ((double)rng->min) / A4L_RNG_FACTOR;
 
-	while (j < cnt) {
-
-		/* Properly retrieve the data */
-		tmp = datax_get(src + i);
-
-		/* Perform the conversion */
-		dst[j] = a * tmp + b;
+	if (cnt <= 0)
+		return 0;
 
-		/* Update the counters */
-		i += size;
-		j++;
-	}
+	/* Perform the conversion with the best suited kernel */
+	__a4l_get_convert_ops()->rawtod[idx](dst, src, cnt, a, b);
 
-	return j;
+	return cnt;
 }
 
 /**
@@ -517,35 +472,20 @@ int a4l_ultoraw(a4l_chinfo_t * chan, void *dst, unsigned long *src, int cnt)
 int a4l_ftoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, float *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int idx;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	float a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
 	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	idx = __a4l_convert_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((float)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -553,17 +493,13 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 	b = ((float)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
-
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
+	if (cnt <= 0)
+		return 0;
 
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
+	/* Performs the conversion with the best suited kernel */
+	__a4l_get_convert_ops()->ftoraw[idx](dst, src, cnt, a, b);
 
-	return j;
+	return cnt;
 }
 
 /**
@@ -587,35 +523,20 @@ int a4l_ftoraw(a4l_chinfo_t * chan,
 int a4l_dtoraw(a4l_chinfo_t * chan,
 	       a4l_rnginfo_t * rng, void *dst, double *src, int cnt)
 {
-	int size, i = 0, j = 0;
+	int idx;
 
 	/* Temporary values used for conversion
 	   (dst = a * phys - b) */
 	double a, b;
-	/* Temporary data accessor */
-	void (*datax_set) (void *, lsampl_t);
 
 	/* Basic checking */
 	if (rng == NULL || chan == NULL)
 		return -EINVAL;
 
 	/* Find out the size in memory */
-	size = a4l_sizeof_chan(chan);
-
-	/* Select the suitable accessor */
-	switch (size) {
-	case 4:
-		datax_set = data32_set;
-		break;
-	case 2:
-		datax_set = data16_set;
-		break;
-	case 1:
-		datax_set = data8_set;
-		break;
-	default:
+	idx = __a4l_convert_index(a4l_sizeof_chan(chan));
+	if (idx < 0)
 		return -EINVAL;
-	};
 
 	/* Computes the translation factor and the constant only once */
 	a = (((double)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
@@ -623,16 +544,12 @@ int a4l_dtoraw(a4l_chinfo_t * chan,
 	b = ((double)(rng->min) / (rng->max - rng->min)) *
 		((1ULL << chan->nb_bits) - 1);
 
-	while (j < cnt) {
-
-		/* Performs the conversion */
-		datax_set(dst + i, (lsampl_t) (a * src[j] - b));
+	if (cnt <= 0)
+		return 0;
 
-		/* Updates the counters */
-		i += size;
-		j++;
-	}
+	/* Performs the conversion with the best suited kernel */
+	__a4l_get_convert_ops()->dtoraw[idx](dst, src, cnt, a, b);
 
-	return j;
+	return cnt;
 }
 /** @} Range / conversion  API */
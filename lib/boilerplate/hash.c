@@ -19,6 +19,7 @@
 #include <string.h>
 #include <errno.h>
 #include "boilerplate/lock.h"
+#include "boilerplate/atomic.h"
 #include "boilerplate/hash.h"
 #include "boilerplate/debug.h"
 
@@ -53,6 +54,70 @@ static inline void drop_key(struct hashobj *obj,
 
 #define GOLDEN_HASH_RATIO  0x9e3779b9  /* Arbitrary value. */
 
+/*
+ * Lookups do not grab the table lock, they run under a sequence
+ * count which writers bump before and after updating the table
+ * (odd while an update is in progress), validating every reference
+ * against it before following it. A lookup which raced with an
+ * update starts over, and falls back to locking the table after a
+ * few attempts.
+ *
+ * Such a reader may briefly read from a node which is being
+ * unlinked, or from an old bucket array, before the sequence check
+ * sends it back to the start. This is harmless as long as the
+ * underlying memory remains mapped, which copperplate heaps
+ * guarantee, but malloc() does not. Private tables may be laid into
+ * malloc'ed memory, in which case readers keep locking the table.
+ */
+#if defined(CONFIG_XENO_HEAPMEM) || defined(CONFIG_XENO_TLSF)
+#define PVHASH_LOCKLESS		1
+#else
+#define PVHASH_LOCKLESS		0
+#endif
+
+#ifdef CONFIG_XENO_PSHARED
+#define HASH_LOCKLESS		1
+#else
+#define HASH_LOCKLESS		PVHASH_LOCKLESS
+#endif
+
+#define HASH_READ_RETRIES	4
+
+/* Average chain length triggering a resize. */
+#define HASH_LOAD_FACTOR	2
+
+static inline unsigned int read_seq_begin(unsigned int *seq)
+{
+	unsigned int ret = ACCESS_ONCE(*seq);
+
+	smp_rmb();
+	compiler_barrier();
+
+	return ret;
+}
+
+static inline int read_seq_retry(unsigned int *seq, unsigned int start)
+{
+	smp_rmb();
+	compiler_barrier();
+
+	return ACCESS_ONCE(*seq) != start;
+}
+
+static inline void write_seq_begin(unsigned int *seq)
+{
+	ACCESS_ONCE(*seq) = *seq + 1;
+	smp_wmb();
+	compiler_barrier();
+}
+
+static inline void write_seq_end(unsigned int *seq)
+{
+	smp_wmb();
+	compiler_barrier();
+	ACCESS_ONCE(*seq) = *seq + 1;
+}
+
 unsigned int __hash_key(const void *key, size_t length, unsigned int c)
 {
 	const unsigned char *k = key;
@@ -99,6 +164,12 @@ void __hash_init(void *heap, struct hash_table *t)
 	for (n = 0; n < HASHSLOTS; n++)
 		__list_init(heap, &t->table[n].obj_list);
 
+	t->buckets = __memoff(heap, t->table);
+	t->mask = HASHSLOTS - 1;
+	t->count = 0;
+	t->seq = 0;
+	t->walkers = 0;
+
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
@@ -109,6 +180,11 @@ void __hash_init(void *heap, struct hash_table *t)
 
 void hash_destroy(struct hash_table *t)
 {
+	/*
+	 * We have no way to release a bucket array which may have
+	 * grown meanwhile; this is only meant for dropping unused
+	 * tables.
+	 */
 	__RT(pthread_mutex_destroy(&t->lock));
 }
 
@@ -116,7 +192,112 @@ static struct hash_bucket *do_hash(struct hash_table *t,
 				   const void *key, size_t len)
 {
 	unsigned int hash = __hash_key(key, len, 0);
-	return &t->table[hash & (HASHSLOTS-1)];
+	struct hash_bucket *buckets = __mptr(t->buckets);
+
+	return &buckets[hash & t->mask];
+}
+
+/* t->lock held. */
+static void grow_table(struct hash_table *t,
+		       const struct hash_operations *hops)
+{
+	struct hash_bucket *old, *new, *bucket;
+	unsigned int nr = t->mask + 1, newnr, n;
+	struct hashobj *obj, *tmp;
+
+	if (t->count <= nr * HASH_LOAD_FACTOR || nr >= HASHSLOTS_MAX ||
+	    t->walkers > 0 || hops->alloc == NULL)
+		return;
+
+	newnr = nr * 2;
+	new = hops->alloc(newnr * sizeof(*new));
+	if (new == NULL)
+		return;	/* Fine, we will live with longer chains. */
+
+	for (n = 0; n < newnr; n++)
+		list_init(&new[n].obj_list);
+
+	old = __mptr(t->buckets);
+
+	write_seq_begin(&t->seq);
+
+	/* Rehash in order, so that duplicates keep their ranking. */
+	for (n = 0; n < nr; n++) {
+		if (list_empty(&old[n].obj_list))
+			continue;
+		list_for_each_entry_safe(obj, tmp, &old[n].obj_list, link) {
+			bucket = &new[__hash_key(__mptr(obj->key), obj->len, 0)
+				      & (newnr - 1)];
+			list_remove(&obj->link);
+			list_append(&obj->link, &bucket->obj_list);
+		}
+	}
+
+	t->buckets = __moff(new);
+	t->mask = newnr - 1;
+
+	write_seq_end(&t->seq);
+
+	if (old != t->table)
+		hops->free(old);
+}
+
+/*
+ * Returns zero with *objp set on success, -EAGAIN if the lookup kept
+ * racing with updates.
+ */
+static int search_nolock(struct hash_table *t,
+			 const void *key, size_t len,
+			 const struct hash_operations *hops,
+			 struct hashobj **objp)
+{
+	unsigned int hash, mask, seq;
+	struct hash_bucket *buckets;
+	struct holder *head, *pos;
+	struct hashobj *obj;
+	const void *k;
+	int tries;
+
+	hash = __hash_key(key, len, 0);
+
+	for (tries = 0; tries < HASH_READ_RETRIES; tries++) {
+		seq = read_seq_begin(&t->seq);
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+
+		buckets = __mptr(ACCESS_ONCE(t->buckets));
+		mask = ACCESS_ONCE(t->mask);
+		head = &buckets[hash & mask].obj_list.head;
+		pos = __hptr(__main_heap, ACCESS_ONCE(head->next));
+		if (read_seq_retry(&t->seq, seq))
+			continue;
+
+		while (pos != head) {
+			obj = container_of(pos, struct hashobj, link);
+			if (ACCESS_ONCE(obj->len) == len) {
+				k = __mptr(ACCESS_ONCE(obj->key));
+				if (read_seq_retry(&t->seq, seq))
+					goto retry;
+				if (hops->compare(k, key, len) == 0)
+					goto found;
+			}
+			pos = __hptr(__main_heap, ACCESS_ONCE(pos->next));
+			if (read_seq_retry(&t->seq, seq))
+				goto retry;
+		}
+		obj = NULL;
+	found:
+		if (!read_seq_retry(&t->seq, seq)) {
+			*objp = obj;
+			return 0;
+		}
+	retry:
+		;
+	}
+
+	return -EAGAIN;
 }
 
 int __hash_enter(struct hash_table *t,
@@ -134,9 +315,10 @@ int __hash_enter(struct hash_table *t,
 	if (ret)
 		return ret;
 
-	bucket = do_hash(t, key, len);
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, key, len);
+
 	if (nodup && !list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj->len != newobj->len)
@@ -150,7 +332,11 @@ int __hash_enter(struct hash_table *t,
 		}
 	}
 
+	write_seq_begin(&t->seq);
 	list_append(&newobj->link, &bucket->obj_list);
+	write_seq_end(&t->seq);
+	t->count++;
+	grow_table(t, hops);
 out:
 	write_unlock(&t->lock);
 
@@ -164,14 +350,17 @@ int hash_remove(struct hash_table *t, struct hashobj *delobj,
 	struct hashobj *obj;
 	int ret = -ESRCH;
 
-	bucket = do_hash(t, __mptr(delobj->key), delobj->len);
-
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, __mptr(delobj->key), delobj->len);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj == delobj) {
+				write_seq_begin(&t->seq);
 				list_remove_init(&obj->link);
+				write_seq_end(&t->seq);
+				t->count--;
 				drop_key(obj, hops);
 				ret = 0;
 				goto out;
@@ -190,10 +379,13 @@ struct hashobj *hash_search(struct hash_table *t, const void *key,
 	struct hash_bucket *bucket;
 	struct hashobj *obj;
 
-	bucket = do_hash(t, key, len);
+	if (HASH_LOCKLESS && search_nolock(t, key, len, hops, &obj) == 0)
+		return obj;
 
 	read_lock_nocancel(&t->lock);
 
+	bucket = do_hash(t, key, len);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj->len != len)
@@ -211,28 +403,33 @@ out:
 
 int hash_walk(struct hash_table *t, hash_walk_op walk, void *arg)
 {
-	struct hash_bucket *bucket;
+	struct hash_bucket *buckets;
 	struct hashobj *obj, *tmp;
-	int ret, n;
+	unsigned int n;
+	int ret = 0;
 
 	read_lock_nocancel(&t->lock);
 
-	for (n = 0; n < HASHSLOTS; n++) {
-		bucket = &t->table[n];
-		if (list_empty(&bucket->obj_list))
+	/* Pin the bucket array while we drop the lock to walk. */
+	t->walkers++;
+	buckets = __mptr(t->buckets);
+
+	for (n = 0; n <= t->mask; n++) {
+		if (list_empty(&buckets[n].obj_list))
 			continue;
-		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
+		list_for_each_entry_safe(obj, tmp, &buckets[n].obj_list, link) {
 			read_unlock(&t->lock);
 			ret = walk(t, obj, arg);
-			if (ret)
-				return __bt(ret);
 			read_lock_nocancel(&t->lock);
+			if (ret)
+				goto out;
 		}
 	}
-
+out:
+	t->walkers--;
 	read_unlock(&t->lock);
 
-	return 0;
+	return __bt(ret);
 }
 
 #ifdef CONFIG_XENO_PSHARED
@@ -285,10 +482,11 @@ int __hash_enter_probe(struct hash_table *t,
 	if (ret)
 		return ret;
 
-	bucket = do_hash(t, key, len);
 	CANCEL_DEFER(svc);
 	write_lock(&t->lock);
 
+	bucket = do_hash(t, key, len);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
 			if (obj->len != newobj->len)
@@ -303,13 +501,20 @@ int __hash_enter_probe(struct hash_table *t,
 					}
 					continue;
 				}
+				write_seq_begin(&t->seq);
 				list_remove_init(&obj->link);
+				write_seq_end(&t->seq);
+				t->count--;
 				drop_key(obj, hops);
 			}
 		}
 	}
 
+	write_seq_begin(&t->seq);
 	list_append(&newobj->link, &bucket->obj_list);
+	write_seq_end(&t->seq);
+	t->count++;
+	grow_table(t, hops);
 out:
 	write_unlock(&t->lock);
 	CANCEL_RESTORE(svc);
@@ -325,18 +530,29 @@ struct hashobj *hash_search_probe(struct hash_table *t,
 	struct hashobj *obj, *tmp;
 	struct service svc;
 
-	bucket = do_hash(t, key, len);
+	/*
+	 * Only the removal of dead entries requires the lock, which
+	 * the fast path leaves to the slow one.
+	 */
+	if (search_nolock(t, key, len, hops, &obj) == 0 &&
+	    (obj == NULL || hops->probe(obj)))
+		return obj;
 
 	CANCEL_DEFER(svc);
 	write_lock(&t->lock);
 
+	bucket = do_hash(t, key, len);
+
 	if (!list_empty(&bucket->obj_list)) {
 		list_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
 			if (obj->len != len)
 				continue;
 			if (hops->compare(__mptr(obj->key), key, len) == 0) {
 				if (!hops->probe(obj)) {
+					write_seq_begin(&t->seq);
 					list_remove_init(&obj->link);
+					write_seq_end(&t->seq);
+					t->count--;
 					drop_key(obj, hops);
 					continue;
 				}
@@ -360,6 +576,12 @@ void pvhash_init(struct pvhash_table *t)
 	for (n = 0; n < HASHSLOTS; n++)
 		pvlist_init(&t->table[n].obj_list);
 
+	t->buckets = t->table;
+	t->mask = HASHSLOTS - 1;
+	t->count = 0;
+	t->seq = 0;
+	t->walkers = 0;
+
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
@@ -372,7 +594,105 @@ static struct pvhash_bucket *do_pvhash(struct pvhash_table *t,
 				       const void *key, size_t len)
 {
 	unsigned int hash = __hash_key(key, len, 0);
-	return &t->table[hash & (HASHSLOTS-1)];
+	return &t->buckets[hash & t->mask];
+}
+
+/* t->lock held. */
+static void grow_pvtable(struct pvhash_table *t,
+			 const struct pvhash_operations *hops)
+{
+	struct pvhash_bucket *old, *new, *bucket;
+	unsigned int nr = t->mask + 1, newnr, n;
+	struct pvhashobj *obj, *tmp;
+
+	if (t->count <= nr * HASH_LOAD_FACTOR || nr >= HASHSLOTS_MAX ||
+	    t->walkers > 0 || hops->alloc == NULL)
+		return;
+
+	newnr = nr * 2;
+	new = hops->alloc(newnr * sizeof(*new));
+	if (new == NULL)
+		return;
+
+	for (n = 0; n < newnr; n++)
+		pvlist_init(&new[n].obj_list);
+
+	old = t->buckets;
+
+	write_seq_begin(&t->seq);
+
+	for (n = 0; n < nr; n++) {
+		if (pvlist_empty(&old[n].obj_list))
+			continue;
+		pvlist_for_each_entry_safe(obj, tmp, &old[n].obj_list, link) {
+			bucket = &new[__hash_key(obj->key, obj->len, 0)
+				      & (newnr - 1)];
+			pvlist_remove(&obj->link);
+			pvlist_append(&obj->link, &bucket->obj_list);
+		}
+	}
+
+	t->buckets = new;
+	t->mask = newnr - 1;
+
+	write_seq_end(&t->seq);
+
+	if (old != t->table)
+		hops->free(old);
+}
+
+static int pvsearch_nolock(struct pvhash_table *t,
+			   const void *key, size_t len,
+			   const struct pvhash_operations *hops,
+			   struct pvhashobj **objp)
+{
+	struct pvholder *head, *pos;
+	struct pvhash_bucket *buckets;
+	unsigned int hash, mask, seq;
+	struct pvhashobj *obj;
+	const void *k;
+	int tries;
+
+	hash = __hash_key(key, len, 0);
+
+	for (tries = 0; tries < HASH_READ_RETRIES; tries++) {
+		seq = read_seq_begin(&t->seq);
+		if (seq & 1) {
+			cpu_relax();
+			continue;
+		}
+
+		buckets = ACCESS_ONCE(t->buckets);
+		mask = ACCESS_ONCE(t->mask);
+		head = &buckets[hash & mask].obj_list.head;
+		pos = ACCESS_ONCE(head->next);
+		if (read_seq_retry(&t->seq, seq))
+			continue;
+
+		while (pos != head) {
+			obj = container_of(pos, struct pvhashobj, link);
+			if (ACCESS_ONCE(obj->len) == len) {
+				k = ACCESS_ONCE(obj->key);
+				if (read_seq_retry(&t->seq, seq))
+					goto retry;
+				if (hops->compare(k, key, len) == 0)
+					goto found;
+			}
+			pos = ACCESS_ONCE(pos->next);
+			if (read_seq_retry(&t->seq, seq))
+				goto retry;
+		}
+		obj = NULL;
+	found:
+		if (!read_seq_retry(&t->seq, seq)) {
+			*objp = obj;
+			return 0;
+		}
+	retry:
+		;
+	}
+
+	return -EAGAIN;
 }
 
 int __pvhash_enter(struct pvhash_table *t,
@@ -388,10 +708,11 @@ int __pvhash_enter(struct pvhash_table *t,
 	pvholder_init(&newobj->link);
 	newobj->key = key;
 	newobj->len = len;
-	bucket = do_pvhash(t, key, len);
 
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, key, len);
+
 	if (nodup && !pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj->len != newobj->len)
@@ -403,7 +724,11 @@ int __pvhash_enter(struct pvhash_table *t,
 		}
 	}
 
+	write_seq_begin(&t->seq);
 	pvlist_append(&newobj->link, &bucket->obj_list);
+	write_seq_end(&t->seq);
+	t->count++;
+	grow_pvtable(t, hops);
 out:
 	write_unlock(&t->lock);
 
@@ -417,14 +742,17 @@ int pvhash_remove(struct pvhash_table *t, struct pvhashobj *delobj,
 	struct pvhashobj *obj;
 	int ret = -ESRCH;
 
-	bucket = do_pvhash(t, delobj->key, delobj->len);
-
 	write_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, delobj->key, delobj->len);
+
 	if (!pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj == delobj) {
+				write_seq_begin(&t->seq);
 				pvlist_remove_init(&obj->link);
+				write_seq_end(&t->seq);
+				t->count--;
 				ret = 0;
 				goto out;
 			}
@@ -443,10 +771,13 @@ struct pvhashobj *pvhash_search(struct pvhash_table *t,
 	struct pvhash_bucket *bucket;
 	struct pvhashobj *obj;
 
-	bucket = do_pvhash(t, key, len);
+	if (PVHASH_LOCKLESS && pvsearch_nolock(t, key, len, hops, &obj) == 0)
+		return obj;
 
 	read_lock_nocancel(&t->lock);
 
+	bucket = do_pvhash(t, key, len);
+
 	if (!pvlist_empty(&bucket->obj_list)) {
 		pvlist_for_each_entry(obj, &bucket->obj_list, link) {
 			if (obj->len != len)
@@ -464,28 +795,32 @@ out:
 
 int pvhash_walk(struct pvhash_table *t,	pvhash_walk_op walk, void *arg)
 {
-	struct pvhash_bucket *bucket;
+	struct pvhash_bucket *buckets;
 	struct pvhashobj *obj, *tmp;
-	int ret, n;
+	unsigned int n;
+	int ret = 0;
 
 	read_lock_nocancel(&t->lock);
 
-	for (n = 0; n < HASHSLOTS; n++) {
-		bucket = &t->table[n];
-		if (pvlist_empty(&bucket->obj_list))
+	t->walkers++;
+	buckets = t->buckets;
+
+	for (n = 0; n <= t->mask; n++) {
+		if (pvlist_empty(&buckets[n].obj_list))
 			continue;
-		pvlist_for_each_entry_safe(obj, tmp, &bucket->obj_list, link) {
+		pvlist_for_each_entry_safe(obj, tmp, &buckets[n].obj_list, link) {
 			read_unlock(&t->lock);
 			ret = walk(t, obj, arg);
-			if (ret)
-				return __bt(ret);
 			read_lock_nocancel(&t->lock);
+			if (ret)
+				goto out;
 		}
 	}
-
+out:
+	t->walkers--;
 	read_unlock(&t->lock);
 
-	return 0;
+	return __bt(ret);
 }
 
 #else /* !CONFIG_XENO_PSHARED */
@@ -32,6 +32,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <boilerplate/atomic.h>
 #include <boilerplate/heapmem.h>
 
 enum heapmem_pgtype {
@@ -420,11 +421,64 @@ found:
 	return pagenr_to_addr(ext, pg);
 }
 
-void *heapmem_alloc(struct heap_memory *heap, size_t size)
+static void *alloc_bucket_block(struct heap_memory *heap,
+				int log2size, size_t bsize)
 {
 	struct heapmem_extent *ext;
-	int log2size, ilog, pg, b;
+	int ilog, pg, b;
 	uint32_t bmask;
+	void *block;
+
+	/*
+	 * NOTE: Fully busy pages from bucketed memory are moved back
+	 * at the end of the per-bucket page list, so that we may
+	 * always assume that either the heading page has some room
+	 * available, or no room is available from any page linked to
+	 * this list, in which case we should immediately add a fresh
+	 * page.
+	 */
+	ilog = log2size - HEAPMEM_MIN_LOG2;
+	assert(ilog >= 0 && ilog < HEAPMEM_MAX);
+
+	pvlist_for_each_entry(ext, &heap->extents, next) {
+		pg = heap->buckets[ilog];
+		if (pg < 0) /* Empty page list? */
+			continue;
+
+		/*
+		 * Find a block in the heading page. If there is none,
+		 * there won't be any down the list: add a new page
+		 * right away.
+		 */
+		bmask = ext->pagemap[pg].map;
+		if (bmask == -1U)
+			break;
+		b = __ctz(~bmask);
+
+		/*
+		 * Got one block from the heading per-bucket page, tag
+		 * it as busy in the per-page allocation map.
+		 */
+		ext->pagemap[pg].map |= (1U << b);
+		heap->used_size += bsize;
+		block = ext->membase +
+			(pg << HEAPMEM_PAGE_SHIFT) +
+			(b << log2size);
+		if (ext->pagemap[pg].map == -1U)
+			move_page_back(heap, ext, pg, log2size);
+
+		return block;
+	}
+
+	/* No free block in bucketed memory, add one page. */
+	return add_free_range(heap, bsize, log2size);
+}
+
+static void *cache_alloc(struct heap_memory *heap, int log2size);
+
+void *heapmem_alloc(struct heap_memory *heap, size_t size)
+{
+	int log2size;
 	size_t bsize;
 	void *block;
 
@@ -444,77 +498,41 @@ void *heapmem_alloc(struct heap_memory *heap, size_t size)
 			bsize = __align_to(size, HEAPMEM_PAGE_SIZE);
 	}
 	
+	/*
+	 * Small blocks may be available from the per-thread
+	 * magazines, which does not require grabbing the heap lock.
+	 */
+	if (heap->cache_depth > 0 && log2size <= HEAPMEM_CACHE_MAX_LOG2)
+		return cache_alloc(heap, log2size);
+
 	/*
 	 * Allocate entire pages directly from the pool whenever the
 	 * block is larger or equal to HEAPMEM_PAGE_SIZE.  Otherwise,
 	 * use bucketed memory.
-	 *
-	 * NOTE: Fully busy pages from bucketed memory are moved back
-	 * at the end of the per-bucket page list, so that we may
-	 * always assume that either the heading page has some room
-	 * available, or no room is available from any page linked to
-	 * this list, in which case we should immediately add a fresh
-	 * page.
 	 */
-	if (bsize < HEAPMEM_PAGE_SIZE) {
-		ilog = log2size - HEAPMEM_MIN_LOG2;
-		assert(ilog >= 0 && ilog < HEAPMEM_MAX);
-
-		write_lock_nocancel(&heap->lock);
+	write_lock_nocancel(&heap->lock);
 
-		pvlist_for_each_entry(ext, &heap->extents, next) {
-			pg = heap->buckets[ilog];
-			if (pg < 0) /* Empty page list? */
-				continue;
-
-			/*
-			 * Find a block in the heading page. If there
-			 * is none, there won't be any down the list:
-			 * add a new page right away.
-			 */
-			bmask = ext->pagemap[pg].map;
-			if (bmask == -1U)
-				break;
-			b = __ctz(~bmask);
-
-			/*
-			 * Got one block from the heading per-bucket
-			 * page, tag it as busy in the per-page
-			 * allocation map.
-			 */
-			ext->pagemap[pg].map |= (1U << b);
-			heap->used_size += bsize;
-			block = ext->membase +
-				(pg << HEAPMEM_PAGE_SHIFT) +
-				(b << log2size);
-			if (ext->pagemap[pg].map == -1U)
-				move_page_back(heap, ext, pg, log2size);
-			goto out;
-		}
+	heap->cache_stats.lock_acquisitions++;
 
-		/* No free block in bucketed memory, add one page. */
-		block = add_free_range(heap, bsize, log2size);
-	} else {
-		write_lock_nocancel(&heap->lock);
+	if (bsize < HEAPMEM_PAGE_SIZE)
+		block = alloc_bucket_block(heap, log2size, bsize);
+	else
 		/* Add a range of contiguous free pages. */
 		block = add_free_range(heap, bsize, 0);
-	}
-out:
+
 	write_unlock(&heap->lock);
 
 	return block;
 }
 
-int heapmem_free(struct heap_memory *heap, void *block)
+static int free_block(struct heap_memory *heap, void *block)
 {
-	int log2size, ret = 0, pg, n;
 	struct heapmem_extent *ext;
 	memoff_t pgoff, boff;
+	int log2size, pg, n;
 	uint32_t oldmap;
 	size_t bsize;
 
-	write_lock_nocancel(&heap->lock);
-
 	/*
 	 * Find the extent from which the returned block is
 	 * originating from.
@@ -524,13 +542,13 @@ int heapmem_free(struct heap_memory *heap, void *block)
 			goto found;
 	}
 
-	goto bad;
+	return -EINVAL;
 found:
 	/* Compute the heading page number in the page map. */
 	pgoff = block - ext->membase;
 	pg = pgoff >> HEAPMEM_PAGE_SHIFT;
 	if (!page_is_valid(ext, pg))
-		goto bad;
+		return -EINVAL;
 	
 	switch (ext->pagemap[pg].type) {
 	case page_list:
@@ -545,7 +563,7 @@ found:
 		assert(bsize < HEAPMEM_PAGE_SIZE);
 		boff = pgoff & ~HEAPMEM_PAGE_MASK;
 		if ((boff & (bsize - 1)) != 0) /* Not at block start? */
-			goto bad;
+			return -EINVAL;
 
 		n = boff >> log2size; /* Block position in page. */
 		oldmap = ext->pagemap[pg].map;
@@ -567,13 +585,295 @@ found:
 	}
 
 	heap->used_size -= bsize;
-out:
+
+	return 0;
+}
+
+static int cache_free(struct heap_memory *heap, void *block);
+
+int heapmem_free(struct heap_memory *heap, void *block)
+{
+	int ret;
+
+	if (heap->cache_depth > 0) {
+		ret = cache_free(heap, block);
+		if (ret <= 0)
+			return __bt(ret);
+	}
+
+	write_lock_nocancel(&heap->lock);
+	heap->cache_stats.lock_acquisitions++;
+	ret = free_block(heap, block);
 	write_unlock(&heap->lock);
 
 	return __bt(ret);
-bad:
-	ret = -EINVAL;
-	goto out;
+}
+
+/*
+ * Per-thread magazine layer.
+ *
+ * Each thread using a heap with caching enabled owns one magazine
+ * per small bucket size, holding up to heap->cache_depth free
+ * blocks. Allocation pops from, and release pushes to the magazine
+ * of the calling thread without grabbing the heap lock. An empty
+ * magazine is refilled with half its depth from the central bucket
+ * lists, a full one is flushed by half its depth back to them, both
+ * under a single lock acquisition. Blocks parked in magazines still
+ * count as used memory from the heap standpoint, until they are
+ * flushed back.
+ */
+struct heapmem_magazine {
+	int rounds;
+	void *blocks[HEAPMEM_CACHE_MAX_DEPTH];
+};
+
+struct heapmem_cache {
+	struct heap_memory *heap;
+	struct heapmem_magazine mags[HEAPMEM_CACHE_BUCKETS];
+	/* Events not yet folded into heap->cache_stats. */
+	unsigned long alloc_hits;
+	unsigned long free_hits;
+};
+
+static void fold_cache_stats(struct heapmem_cache *cache)
+{
+	struct heap_memory *heap = cache->heap;
+
+	/* heap->lock held. */
+	heap->cache_stats.lock_acquisitions++;
+	heap->cache_stats.alloc_hits += cache->alloc_hits;
+	heap->cache_stats.free_hits += cache->free_hits;
+	cache->alloc_hits = 0;
+	cache->free_hits = 0;
+}
+
+static void drain_magazine(struct heapmem_cache *cache,
+			   struct heapmem_magazine *mag, int count)
+{
+	struct heap_memory *heap = cache->heap;
+	int n, ret;
+
+	/* heap->lock held. Release the coldest blocks first. */
+	for (n = 0; n < count; n++) {
+		ret = free_block(heap, mag->blocks[n]);
+		assert(ret == 0);
+		(void)ret;
+	}
+
+	mag->rounds -= count;
+	memmove(mag->blocks, mag->blocks + count,
+		mag->rounds * sizeof(mag->blocks[0]));
+}
+
+static void drain_cache(struct heapmem_cache *cache)
+{
+	struct heap_memory *heap = cache->heap;
+	struct heapmem_magazine *mag;
+	int ilog;
+
+	write_lock_nocancel(&heap->lock);
+
+	fold_cache_stats(cache);
+
+	for (ilog = 0; ilog < HEAPMEM_CACHE_BUCKETS; ilog++) {
+		mag = cache->mags + ilog;
+		if (mag->rounds > 0)
+			drain_magazine(cache, mag, mag->rounds);
+	}
+
+	write_unlock(&heap->lock);
+}
+
+static void release_cache(void *arg)
+{
+	struct heapmem_cache *cache = arg;
+
+	/* Called on thread exit, return all cached blocks. */
+	drain_cache(cache);
+	__STD(free(cache));
+}
+
+static struct heapmem_cache *get_cache(struct heap_memory *heap)
+{
+	struct heapmem_cache *cache;
+
+	cache = pthread_getspecific(heap->cache_key);
+	if (cache)
+		return cache;
+
+	cache = __STD(malloc(sizeof(*cache)));
+	if (cache == NULL)
+		return NULL;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->heap = heap;
+	if (pthread_setspecific(heap->cache_key, cache)) {
+		__STD(free(cache));
+		return NULL;
+	}
+
+	return cache;
+}
+
+static void *cache_alloc(struct heap_memory *heap, int log2size)
+{
+	size_t bsize = 1 << log2size;
+	struct heapmem_magazine *mag;
+	struct heapmem_cache *cache;
+	int count;
+	void *block;
+
+	cache = get_cache(heap);
+	if (cache == NULL)
+		goto uncached;
+
+	mag = cache->mags + log2size - HEAPMEM_MIN_LOG2;
+	if (mag->rounds > 0) {
+		cache->alloc_hits++;
+		return mag->blocks[--mag->rounds];
+	}
+
+	/*
+	 * Empty magazine: pull a batch of blocks from the central
+	 * bucket lists, handing over the last one to the caller.
+	 */
+	write_lock_nocancel(&heap->lock);
+
+	fold_cache_stats(cache);
+	heap->cache_stats.alloc_misses++;
+	heap->cache_stats.refills++;
+
+	for (count = heap->cache_depth / 2; count > 1; count--) {
+		block = alloc_bucket_block(heap, log2size, bsize);
+		if (block == NULL)
+			break;
+		mag->blocks[mag->rounds++] = block;
+	}
+
+	block = alloc_bucket_block(heap, log2size, bsize);
+
+	write_unlock(&heap->lock);
+
+	return block;
+uncached:
+	write_lock_nocancel(&heap->lock);
+	heap->cache_stats.lock_acquisitions++;
+	heap->cache_stats.alloc_misses++;
+	block = alloc_bucket_block(heap, log2size, bsize);
+	write_unlock(&heap->lock);
+
+	return block;
+}
+
+static int cache_free(struct heap_memory *heap, void *block)
+{
+	struct heapmem_magazine *mag;
+	struct heapmem_cache *cache;
+	struct heapmem_extent *ext;
+	memoff_t pgoff;
+	int log2size;
+
+	/*
+	 * Figure out the bucket the block belongs to without
+	 * grabbing the heap lock. Extents are never removed, and the
+	 * page entry type of a busy block cannot change under our
+	 * feet. Anything looking odd is handed over to the regular
+	 * path, which performs the full validation. Return a
+	 * positive value to request this.
+	 */
+	pvlist_for_each_entry(ext, &heap->extents, next) {
+		if (block >= ext->membase && block < ext->memlim)
+			goto found;
+	}
+
+	return 1;
+found:
+	pgoff = block - ext->membase;
+	if (!page_is_valid(ext, pgoff >> HEAPMEM_PAGE_SHIFT))
+		return 1;
+
+	log2size = ext->pagemap[pgoff >> HEAPMEM_PAGE_SHIFT].type;
+	if (log2size < HEAPMEM_MIN_LOG2 || log2size > HEAPMEM_CACHE_MAX_LOG2)
+		return 1;	/* page_list, or larger bucket. */
+
+	if ((pgoff & ~HEAPMEM_PAGE_MASK) & ((1 << log2size) - 1))
+		return 1;	/* Not at block start. */
+
+	cache = get_cache(heap);
+	if (cache == NULL)
+		return 1;
+
+	mag = cache->mags + log2size - HEAPMEM_MIN_LOG2;
+	if (mag->rounds >= heap->cache_depth) {
+		/*
+		 * Full magazine: flush the coldest half back to the
+		 * central bucket lists.
+		 */
+		write_lock_nocancel(&heap->lock);
+		fold_cache_stats(cache);
+		heap->cache_stats.free_misses++;
+		heap->cache_stats.flushes++;
+		drain_magazine(cache, mag, heap->cache_depth / 2);
+		write_unlock(&heap->lock);
+	} else
+		cache->free_hits++;
+
+	mag->blocks[mag->rounds++] = block;
+
+	return 0;
+}
+
+int heapmem_enable_cache(struct heap_memory *heap, int depth)
+{
+	int ret;
+
+	if (depth < 2 || depth > HEAPMEM_CACHE_MAX_DEPTH)
+		return -EINVAL;
+
+	if (heap->cache_depth > 0)
+		return -EBUSY;
+
+	ret = pthread_key_create(&heap->cache_key, release_cache);
+	if (ret)
+		return __bt(-ret);
+
+	heap->cache_depth = depth;
+
+	return 0;
+}
+
+void heapmem_flush_cache(struct heap_memory *heap)
+{
+	struct heapmem_cache *cache;
+
+	if (heap->cache_depth == 0)
+		return;
+
+	cache = pthread_getspecific(heap->cache_key);
+	if (cache)
+		drain_cache(cache);
+}
+
+void heapmem_get_cache_stats(struct heap_memory *heap,
+			     struct heapmem_cache_stats *stats)
+{
+	struct heapmem_cache *cache;
+
+	read_lock_nocancel(&heap->lock);
+	*stats = heap->cache_stats;
+	read_unlock(&heap->lock);
+
+	/*
+	 * Hits from other threads are accounted for next time they
+	 * need to grab the heap lock. Add our own pending ones.
+	 */
+	if (heap->cache_depth > 0) {
+		cache = pthread_getspecific(heap->cache_key);
+		if (cache) {
+			stats->alloc_hits += cache->alloc_hits;
+			stats->free_hits += cache->free_hits;
+		}
+	}
 }
 
 static inline int compare_range_by_size(const struct avlh *l, const struct avlh *r)
@@ -675,6 +975,13 @@ static int add_extent(struct heap_memory *heap, void *mem, size_t size)
 	avl_init(&ext->addr_tree);
 	release_page_range(ext, ext->membase, user_size);
 
+	/*
+	 * The extent list may be walked locklessly by the magazine
+	 * layer, make sure the extent is fully set up before it
+	 * becomes visible.
+	 */
+	smp_wmb();
+
 	write_lock_safe(&heap->lock, state);
 	pvlist_append(&ext->next, &heap->extents);
 	heap->arena_size += size;
@@ -692,6 +999,8 @@ int heapmem_init(struct heap_memory *heap, void *mem, size_t size)
 	heap->used_size = 0;
 	heap->usable_size = 0;
 	heap->arena_size = 0;
+	heap->cache_depth = 0;
+	memset(&heap->cache_stats, 0, sizeof(heap->cache_stats));
 	pvlist_init(&heap->extents);
 
 	pthread_mutexattr_init(&mattr);
@@ -723,5 +1032,16 @@ int heapmem_extend(struct heap_memory *heap, void *mem, size_t size)
 
 void heapmem_destroy(struct heap_memory *heap)
 {
+	/*
+	 * Magazines from threads other than the caller are simply
+	 * dropped along with the heap.
+	 */
+	if (heap->cache_depth > 0) {
+		heapmem_flush_cache(heap);
+		__STD(free(pthread_getspecific(heap->cache_key)));
+		pthread_key_delete(heap->cache_key);
+		heap->cache_depth = 0;
+	}
+
 	__RT(pthread_mutex_destroy(&heap->lock));
 }
@@ -18,6 +18,8 @@
 
 #include <errno.h>
 #include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <pthread.h>
@@ -25,6 +27,219 @@
 #include <asm/xenomai/syscall.h>
 #include "internal.h"
 
+/*
+ * Descriptors of MQ_SHMEM queues are mapped to the shared ring state
+ * by a two-level table indexed by file descriptor, so that the fast
+ * path may look them up without locking. Descriptors beyond the
+ * table range, or for which no chunk could be allocated, go through
+ * the regular syscalls, which also handle shared memory queues.
+ */
+#define MQ_SHM_CHUNK_SHIFT	8
+#define MQ_SHM_CHUNK_SIZE	(1 << MQ_SHM_CHUNK_SHIFT)
+#define MQ_SHM_NR_CHUNKS	256
+
+struct mq_shm_desc {
+	struct cobalt_mq_state *state;
+	int accmode;
+};
+
+static struct mq_shm_desc *mq_shm_table[MQ_SHM_NR_CHUNKS];
+
+static inline void mq_shm_barrier(void)
+{
+	smp_mb();
+	compiler_barrier();
+}
+
+static struct mq_shm_desc *mq_shm_desc(mqd_t q, int alloc)
+{
+	struct mq_shm_desc *chunk, *old;
+	unsigned int n = (unsigned int)q;
+
+	if ((n >> MQ_SHM_CHUNK_SHIFT) >= MQ_SHM_NR_CHUNKS)
+		return NULL;
+
+	chunk = ACCESS_ONCE(mq_shm_table[n >> MQ_SHM_CHUNK_SHIFT]);
+	if (chunk == NULL) {
+		if (!alloc)
+			return NULL;
+		chunk = calloc(MQ_SHM_CHUNK_SIZE, sizeof(*chunk));
+		if (chunk == NULL)
+			return NULL;
+		old = __sync_val_compare_and_swap(&mq_shm_table[n >> MQ_SHM_CHUNK_SHIFT],
+						  NULL, chunk);
+		if (old) {
+			free(chunk);
+			chunk = old;
+		}
+	}
+
+	return chunk + (n & (MQ_SHM_CHUNK_SIZE - 1));
+}
+
+static void mq_shm_attach(mqd_t q, int oflags)
+{
+	struct mq_shm_desc *desc;
+	__u32 offset;
+	int ret;
+
+	ret = XENOMAI_SYSCALL2(sc_cobalt_mq_shm_map, q, &offset);
+	desc = mq_shm_desc(q, ret == 0);
+	if (desc == NULL)
+		return;
+
+	/* Descriptors are recycled, always reset the entry. */
+	if (ret) {
+		desc->state = NULL;
+		return;
+	}
+
+	desc->accmode = oflags & O_ACCMODE;
+	mq_shm_barrier();
+	desc->state = cobalt_umm_shared + offset;
+}
+
+static void mq_shm_detach(mqd_t q)
+{
+	struct mq_shm_desc *desc = mq_shm_desc(q, 0);
+
+	if (desc)
+		desc->state = NULL;
+}
+
+static struct cobalt_mq_state *mq_shm_lookup(mqd_t q, int *accmode)
+{
+	struct mq_shm_desc *desc = mq_shm_desc(q, 0);
+	struct cobalt_mq_state *state;
+
+	if (desc == NULL)
+		return NULL;
+
+	state = ACCESS_ONCE(desc->state);
+	if (state) {
+		smp_rmb();
+		*accmode = desc->accmode;
+	}
+
+	return state;
+}
+
+static int mq_shm_wait(mqd_t q, int dir, const struct timespec *timeout)
+{
+	int ret, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+	ret = XENOMAI_SYSCALL3(sc_cobalt_mq_shm_wait, q, dir, timeout);
+	pthread_setcanceltype(oldtype, NULL);
+
+	return ret;
+}
+
+/*
+ * The fast paths below must not be cancelled asynchronously while a
+ * slot is claimed, so only the wait syscall is a cancellation point.
+ */
+static int mq_shm_send(mqd_t q, struct cobalt_mq_state *state, int accmode,
+		       const char *buffer, size_t len, unsigned int prio,
+		       const struct timespec *timeout)
+{
+	struct cobalt_mq_slot *slot;
+	unsigned int pos;
+	int ret, diff;
+
+	if (accmode == O_RDONLY)
+		return -EBADF;
+
+	if (len > state->msgsize)
+		return -EMSGSIZE;
+
+	if (prio >= COBALT_MSGPRIOMAX)
+		return -EINVAL;
+
+	for (;;) {
+		pos = ACCESS_ONCE(state->enqueue.v);
+		slot = cobalt_mq_get_slot(state, pos);
+		diff = (int)(ACCESS_ONCE(slot->seq.v) - pos);
+		if (diff == 0) {
+			if (atomic_cmpxchg(&state->enqueue, pos, pos + 1) == pos)
+				break;
+		} else if (diff < 0) {
+			/* Ring full. */
+			ret = mq_shm_wait(q, COBALT_MQ_SHM_SEND, timeout);
+			if (ret)
+				return ret;
+		} else
+			cpu_relax();
+	}
+
+	memcpy(slot + 1, buffer, len);
+	slot->len = len;
+	slot->prio = prio;
+	slot->flags = 0;
+	mq_shm_barrier();
+	atomic_set(&slot->seq, pos + 1);
+	/* Pairs with the waiter accounting in the kernel. */
+	mq_shm_barrier();
+
+	if (ACCESS_ONCE(state->rwaiters) || ACCESS_ONCE(state->watch))
+		XENOMAI_SYSCALL2(sc_cobalt_mq_shm_wake, q, COBALT_MQ_SHM_RECV);
+
+	return 0;
+}
+
+static ssize_t mq_shm_receive(mqd_t q, struct cobalt_mq_state *state,
+			      int accmode, char *buffer, size_t len,
+			      unsigned int *prio,
+			      const struct timespec *timeout)
+{
+	struct cobalt_mq_slot *slot;
+	unsigned int pos;
+	int ret, diff;
+	size_t rlen;
+
+	if (accmode == O_WRONLY)
+		return -EBADF;
+
+	if (len < state->msgsize)
+		return -EMSGSIZE;
+
+	for (;;) {
+		pos = ACCESS_ONCE(state->dequeue.v);
+		slot = cobalt_mq_get_slot(state, pos);
+		diff = (int)(ACCESS_ONCE(slot->seq.v) - (pos + 1));
+		if (diff == 0) {
+			if (atomic_cmpxchg(&state->dequeue, pos, pos + 1) != pos)
+				continue;
+			mq_shm_barrier();
+			if ((slot->flags & COBALT_MQ_SLOT_VOID) == 0)
+				break;
+			/* Skip slots a sender failed to fill. */
+			atomic_set(&slot->seq, pos + state->nrslots);
+		} else if (diff < 0) {
+			/* Ring empty. */
+			ret = mq_shm_wait(q, COBALT_MQ_SHM_RECV, timeout);
+			if (ret)
+				return ret;
+		} else
+			cpu_relax();
+	}
+
+	rlen = slot->len;
+	if (rlen > state->msgsize)
+		rlen = state->msgsize;
+	memcpy(buffer, slot + 1, rlen);
+	if (prio)
+		*prio = slot->prio;
+	mq_shm_barrier();
+	atomic_set(&slot->seq, pos + state->nrslots);
+	mq_shm_barrier();
+
+	if (ACCESS_ONCE(state->swaiters) || ACCESS_ONCE(state->watch))
+		XENOMAI_SYSCALL2(sc_cobalt_mq_shm_wake, q, COBALT_MQ_SHM_SEND);
+
+	return rlen;
+}
+
 /**
  * @ingroup cobalt_api
  * @defgroup cobalt_api_mq Message queues
@@ -70,7 +285,14 @@
  * are used when creating a message queue:
  * - @a mq_maxmsg is the maximum number of messages in the queue (128 by
  *   default);
- * - @a mq_msgsize is the maximum size of each message (128 by default).
+ * - @a mq_msgsize is the maximum size of each message (128 by default);
+ * - @a mq_flags may include MQ_SHMEM, which places the message ring
+ *   in the Cobalt shared heap, so that uncontended mq_send() and
+ *   mq_receive() calls complete without entering the kernel. Such
+ *   queues convey messages in FIFO order regardless of their
+ *   priority, which is still passed to the receiver. @a mq_maxmsg is
+ *   rounded up to the next power of two, and the ring must fit in
+ *   the shared heap (CONFIG_XENO_OPT_SHARED_HEAPSZ).
  *
  * @a name may be any arbitrary string, in which slashes have no particular
  * meaning. However, for portability, using a name which starts with a slash and
@@ -121,6 +343,8 @@ COBALT_IMPL(mqd_t, mq_open, (const char *name, int oflags, ...))
 		return (mqd_t)-1;
 	}
 
+	mq_shm_attach(fd, oflags);
+
 	return (mqd_t)fd;
 }
 
@@ -148,6 +372,8 @@ COBALT_IMPL(int, mq_close, (mqd_t mqd))
 {
 	int err;
 
+	mq_shm_detach(mqd);
+
 	err = XENOMAI_SYSCALL1(sc_cobalt_mq_close, mqd);
 	if (err) {
 		errno = -err;
@@ -328,7 +554,14 @@ COBALT_IMPL(int, mq_setattr, (mqd_t mqd,
  */
 COBALT_IMPL(int, mq_send, (mqd_t q, const char *buffer, size_t len, unsigned prio))
 {
-	int err, oldtype;
+	struct cobalt_mq_state *state;
+	int err, oldtype, accmode;
+
+	state = mq_shm_lookup(q, &accmode);
+	if (state) {
+		err = mq_shm_send(q, state, accmode, buffer, len, prio, NULL);
+		goto out;
+	}
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
@@ -336,7 +569,7 @@ COBALT_IMPL(int, mq_send, (mqd_t q, const char *buffer, size_t len, unsigned pri
 			       q, buffer, len, prio, NULL);
 
 	pthread_setcanceltype(oldtype, NULL);
-
+out:
 	if (!err)
 		return 0;
 
@@ -385,18 +618,25 @@ COBALT_IMPL(int, mq_timedsend, (mqd_t q,
 				size_t len,
 				unsigned prio, const struct timespec *timeout))
 {
-	int err, oldtype;
+	struct cobalt_mq_state *state;
+	int err, oldtype, accmode;
 
 	if (timeout == NULL)
 		return -EFAULT;
 
+	state = mq_shm_lookup(q, &accmode);
+	if (state) {
+		err = mq_shm_send(q, state, accmode, buffer, len, prio, timeout);
+		goto out;
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedsend,
 			       q, buffer, len, prio, timeout);
 
 	pthread_setcanceltype(oldtype, NULL);
-
+out:
 	if (!err)
 		return 0;
 
@@ -447,7 +687,18 @@ COBALT_IMPL(int, mq_timedsend, (mqd_t q,
 COBALT_IMPL(ssize_t, mq_receive, (mqd_t q, char *buffer, size_t len, unsigned *prio))
 {
 	ssize_t rlen = (ssize_t) len;
-	int err, oldtype;
+	struct cobalt_mq_state *state;
+	int err, oldtype, accmode;
+
+	state = mq_shm_lookup(q, &accmode);
+	if (state) {
+		rlen = mq_shm_receive(q, state, accmode,
+				      buffer, len, prio, NULL);
+		if (rlen >= 0)
+			return rlen;
+		err = (int)rlen;
+		goto fail;
+	}
 
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
@@ -458,7 +709,7 @@ COBALT_IMPL(ssize_t, mq_receive, (mqd_t q, char *buffer, size_t len, unsigned *p
 
 	if (!err)
 		return rlen;
-
+fail:
 	errno = -err;
 	return -1;
 }
@@ -509,11 +760,22 @@ COBALT_IMPL(ssize_t, mq_timedreceive, (mqd_t q,
 				       const struct timespec * __restrict__ timeout))
 {
 	ssize_t rlen = (ssize_t) len;
-	int err, oldtype;
+	struct cobalt_mq_state *state;
+	int err, oldtype, accmode;
 
 	if (timeout == NULL)
 		return -EFAULT;
 
+	state = mq_shm_lookup(q, &accmode);
+	if (state) {
+		rlen = mq_shm_receive(q, state, accmode,
+				      buffer, len, prio, timeout);
+		if (rlen >= 0)
+			return rlen;
+		err = (int)rlen;
+		goto fail;
+	}
+
 	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
 
 	err = XENOMAI_SYSCALL5(sc_cobalt_mq_timedreceive,
@@ -523,7 +785,7 @@ COBALT_IMPL(ssize_t, mq_timedreceive, (mqd_t q,
 
 	if (!err)
 		return rlen;
-
+fail:
 	errno = -err;
 	return -1;
 }
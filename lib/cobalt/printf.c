@@ -21,6 +21,7 @@
 #include <limits.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -42,15 +43,45 @@
 
 #define RT_PRINT_MODE_FORMAT		0
 #define RT_PRINT_MODE_FWRITE		1
+#define RT_PRINT_MODE_DEFERRED		2
+
+#define RT_PRINT_MAX_CONVSPEC		32
 
 struct entry_head {
 	FILE *dest;
 	uint32_t seq_no;
 	int priority;
+	unsigned int mode;
 	size_t len;
 	char data[0];
 } __attribute__((packed));
 
+/*
+ * Argument classes of a conversion specification, as fetched from
+ * the caller's va_list in deferred mode.
+ */
+enum conv_arg {
+	CONV_ARG_NONE,
+	CONV_ARG_INT,
+	CONV_ARG_LONG,
+	CONV_ARG_LLONG,
+	CONV_ARG_INTMAX,
+	CONV_ARG_SIZE,
+	CONV_ARG_PTRDIFF,
+	CONV_ARG_DOUBLE,
+	CONV_ARG_LDOUBLE,
+	CONV_ARG_PTR,
+	CONV_ARG_STR,
+};
+
+struct conv_spec {
+	int len;		/* Length of the specification text */
+	enum conv_arg arg;
+	int nr_stars;		/* Count of '*' (int) arguments */
+	int prec_star;		/* Precision given by a '*' argument */
+	int prec;		/* Literal precision, -1 if none */
+};
+
 struct print_buffer {
 	off_t write_pos;
 
@@ -74,6 +105,15 @@ int __cobalt_print_bufcount = RT_PRINT_DEFAULT_BUFFERS_COUNT;
 
 int __cobalt_print_syncdelay = RT_PRINT_DEFAULT_SYNCDELAY;
 
+/*
+ * When set, rt_printf() and friends only record the format pointer
+ * and raw arguments, formatting is done by the printer thread. The
+ * format string must therefore remain valid until the output is
+ * flushed (string literals are fine), and the return value is the
+ * size of the queued record instead of the count of characters.
+ */
+int __cobalt_print_deferred;
+
 static struct print_buffer *first_buffer;
 static int buffers;
 static uint32_t seq_no;
@@ -87,10 +127,378 @@ static atomic_long_t *pool_bitmap;
 static unsigned pool_bitmap_len;
 static unsigned pool_buf_size;
 static unsigned long pool_start, pool_len;
+static char *deferred_text;
+static size_t deferred_textsz;
 
 static void release_buffer(struct print_buffer *buffer);
 static void print_buffers(void);
 
+/*
+ * Parse the conversion specification starting at @p (right after the
+ * '%' sign). Returns zero and fills @spec if the specification can be
+ * replayed later by the printer thread, -1 otherwise: positional
+ * arguments, wide characters, %n and %m must be handled in the
+ * caller's context.
+ */
+static int parse_conv_spec(const char *p, struct conv_spec *spec)
+{
+	const char *start = p - 1;
+	int lmod = 0;
+
+	spec->nr_stars = 0;
+	spec->prec_star = 0;
+	spec->prec = -1;
+
+	while (*p && strchr("-+ #0'I", *p))
+		p++;
+
+	if (*p == '*') {
+		spec->nr_stars++;
+		p++;
+	} else
+		while (*p >= '0' && *p <= '9')
+			p++;
+
+	if (*p == '.') {
+		p++;
+		if (*p == '*') {
+			spec->nr_stars++;
+			spec->prec_star = 1;
+			p++;
+		} else {
+			spec->prec = 0;
+			while (*p >= '0' && *p <= '9')
+				spec->prec = spec->prec * 10 + *p++ - '0';
+		}
+	}
+
+	switch (*p) {
+	case 'h':
+		p += p[1] == 'h' ? 2 : 1;
+		break;
+	case 'l':
+		if (p[1] == 'l') {
+			lmod = 'q';
+			p += 2;
+		} else
+			lmod = *p++;
+		break;
+	case 'q':
+	case 'L':
+	case 'j':
+	case 'z':
+	case 'Z':
+	case 't':
+		lmod = *p++;
+		break;
+	}
+
+	switch (*p) {
+	case 'd':
+	case 'i':
+	case 'o':
+	case 'u':
+	case 'x':
+	case 'X':
+		switch (lmod) {
+		case 'l':
+			spec->arg = CONV_ARG_LONG;
+			break;
+		case 'q':
+		case 'L':
+			spec->arg = CONV_ARG_LLONG;
+			break;
+		case 'j':
+			spec->arg = CONV_ARG_INTMAX;
+			break;
+		case 'z':
+		case 'Z':
+			spec->arg = CONV_ARG_SIZE;
+			break;
+		case 't':
+			spec->arg = CONV_ARG_PTRDIFF;
+			break;
+		default:
+			spec->arg = CONV_ARG_INT;
+		}
+		break;
+	case 'c':
+		if (lmod)
+			return -1;
+		spec->arg = CONV_ARG_INT;
+		break;
+	case 'e':
+	case 'E':
+	case 'f':
+	case 'F':
+	case 'g':
+	case 'G':
+	case 'a':
+	case 'A':
+		spec->arg = lmod == 'L' ? CONV_ARG_LDOUBLE : CONV_ARG_DOUBLE;
+		break;
+	case 'p':
+		spec->arg = CONV_ARG_PTR;
+		break;
+	case 's':
+		if (lmod)
+			return -1;
+		spec->arg = CONV_ARG_STR;
+		break;
+	case '%':
+		if (p != start + 1)
+			return -1;
+		spec->arg = CONV_ARG_NONE;
+		break;
+	default:
+		return -1;
+	}
+
+	spec->len = p + 1 - start;
+
+	return spec->len < RT_PRINT_MAX_CONVSPEC ? 0 : -1;
+}
+
+#define put_arg(__p, __end, __type, __val)			\
+	({							\
+		__type __v = (__val);				\
+		int __ret = -1;					\
+		if ((__end) - (__p) >= sizeof(__v)) {		\
+			memcpy(__p, &__v, sizeof(__v));		\
+			(__p) += sizeof(__v);			\
+			__ret = 0;				\
+		}						\
+		__ret;						\
+	})
+
+#define get_arg(__p, __type)					\
+	({							\
+		__type __v;					\
+		memcpy(&__v, __p, sizeof(__v));			\
+		(__p) += sizeof(__v);				\
+		__v;						\
+	})
+
+/*
+ * Deferred mode: record the format pointer and the raw arguments
+ * into @data, leaving the formatting work to the printer thread.
+ * Strings are copied, since the caller may reuse its buffers as soon
+ * as we return. Returns the record length, or -1 if the format cannot
+ * be deferred or the record would not fit in @len bytes.
+ */
+static int encode_deferred(char *data, int len,
+			   const char *format, va_list args)
+{
+	char *p = data, *end = data + len;
+	int n, prec, slen, ret = -1;
+	struct conv_spec spec;
+	const char *f, *str;
+	va_list ap;
+
+	/* The caller falls back to formatting if we bail out. */
+	va_copy(ap, args);
+
+	if (put_arg(p, end, const char *, format))
+		goto out;
+
+	for (f = format; *f; f++) {
+		if (*f != '%')
+			continue;
+
+		if (parse_conv_spec(f + 1, &spec))
+			goto out;
+
+		prec = spec.prec;
+		for (n = 0; n < spec.nr_stars; n++) {
+			prec = va_arg(ap, int);
+			if (put_arg(p, end, int, prec))
+				goto out;
+		}
+		if (!spec.prec_star)
+			prec = spec.prec;
+
+		switch (spec.arg) {
+		case CONV_ARG_NONE:
+			n = 0;
+			break;
+		case CONV_ARG_INT:
+			n = put_arg(p, end, int, va_arg(ap, int));
+			break;
+		case CONV_ARG_LONG:
+			n = put_arg(p, end, long, va_arg(ap, long));
+			break;
+		case CONV_ARG_LLONG:
+			n = put_arg(p, end, long long, va_arg(ap, long long));
+			break;
+		case CONV_ARG_INTMAX:
+			n = put_arg(p, end, intmax_t, va_arg(ap, intmax_t));
+			break;
+		case CONV_ARG_SIZE:
+			n = put_arg(p, end, size_t, va_arg(ap, size_t));
+			break;
+		case CONV_ARG_PTRDIFF:
+			n = put_arg(p, end, ptrdiff_t, va_arg(ap, ptrdiff_t));
+			break;
+		case CONV_ARG_DOUBLE:
+			n = put_arg(p, end, double, va_arg(ap, double));
+			break;
+		case CONV_ARG_LDOUBLE:
+			n = put_arg(p, end, long double,
+				    va_arg(ap, long double));
+			break;
+		case CONV_ARG_PTR:
+			n = put_arg(p, end, void *, va_arg(ap, void *));
+			break;
+		case CONV_ARG_STR:
+			/*
+			 * Copy the string up to the precision if any
+			 * (it may not be null-terminated then), -1
+			 * denotes a NULL pointer.
+			 */
+			str = va_arg(ap, const char *);
+			slen = str == NULL ? -1 :
+				prec >= 0 ? strnlen(str, prec) : strlen(str);
+			n = put_arg(p, end, int, slen);
+			if (n || slen < 0)
+				break;
+			if (end - p < slen + 1)
+				goto out;
+			memcpy(p, str, slen);
+			p[slen] = '\0';
+			p += slen + 1;
+			break;
+		}
+
+		if (n)
+			goto out;
+
+		f += spec.len - 1;
+	}
+
+	ret = p - data;
+out:
+	va_end(ap);
+
+	return ret;
+}
+
+#define print_conv(__out, __size, __spec, __stars, __nr_stars, __val)	\
+	({								\
+		int __ret;						\
+		switch (__nr_stars) {					\
+		case 0:							\
+			__ret = snprintf(__out, __size, __spec, __val);	\
+			break;						\
+		case 1:							\
+			__ret = snprintf(__out, __size, __spec,		\
+					 (__stars)[0], __val);		\
+			break;						\
+		default:						\
+			__ret = snprintf(__out, __size, __spec,		\
+					 (__stars)[0], (__stars)[1],	\
+					 __val);			\
+		}							\
+		__ret;							\
+	})
+
+/*
+ * Replay a deferred record into @out, from the printer thread.
+ * Returns the length of the text, truncated to @size - 1 bytes.
+ */
+static int format_deferred(char *out, size_t size, const char *data)
+{
+	char convspec[RT_PRINT_MAX_CONVSPEC];
+	const char *format, *f, *str;
+	struct conv_spec spec;
+	size_t pos = 0;
+	int stars[2], n, ret, slen;
+
+	format = get_arg(data, const char *);
+
+	for (f = format; *f && pos < size - 1; f++) {
+		if (*f != '%') {
+			out[pos++] = *f;
+			continue;
+		}
+
+		/* Same parsing as encode_deferred(), cannot fail. */
+		parse_conv_spec(f + 1, &spec);
+		memcpy(convspec, f, spec.len);
+		convspec[spec.len] = '\0';
+		f += spec.len - 1;
+
+		for (n = 0; n < spec.nr_stars; n++)
+			stars[n] = get_arg(data, int);
+
+		switch (spec.arg) {
+		case CONV_ARG_NONE:
+			ret = snprintf(out + pos, size - pos, "%%");
+			break;
+		case CONV_ARG_INT:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, int));
+			break;
+		case CONV_ARG_LONG:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, long));
+			break;
+		case CONV_ARG_LLONG:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars,
+					 get_arg(data, long long));
+			break;
+		case CONV_ARG_INTMAX:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, intmax_t));
+			break;
+		case CONV_ARG_SIZE:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, size_t));
+			break;
+		case CONV_ARG_PTRDIFF:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars,
+					 get_arg(data, ptrdiff_t));
+			break;
+		case CONV_ARG_DOUBLE:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, double));
+			break;
+		case CONV_ARG_LDOUBLE:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars,
+					 get_arg(data, long double));
+			break;
+		case CONV_ARG_PTR:
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, get_arg(data, void *));
+			break;
+		case CONV_ARG_STR:
+			slen = get_arg(data, int);
+			str = slen < 0 ? NULL : data;
+			if (slen >= 0)
+				data += slen + 1;
+			ret = print_conv(out + pos, size - pos, convspec, stars,
+					 spec.nr_stars, str);
+			break;
+		default:
+			ret = 0;
+		}
+
+		if (ret < 0)
+			break;
+
+		pos += ret;
+	}
+
+	if (pos >= size)
+		pos = size - 1;
+
+	out[pos] = '\0';
+
+	return pos;
+}
+
 /* *** rt_print API *** */
 
 static int 
@@ -149,7 +557,13 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 
 	head = buffer->ring + write_pos;
 
-	if (mode == RT_PRINT_MODE_FORMAT) {
+	if (mode == RT_PRINT_MODE_FORMAT && fortify_level == 0 &&
+	    __cobalt_print_deferred &&
+	    (res = encode_deferred(head->data, len, format, args)) > 0) {
+		/* Raw arguments recorded, the printer will format them. */
+		mode = RT_PRINT_MODE_DEFERRED;
+		len = res;
+	} else if (mode == RT_PRINT_MODE_FORMAT) {
 		if (stream != RT_PRINT_SYSLOG_STREAM) {
 			/* We do not need the terminating \0 */
 #ifdef CONFIG_XENO_FORTIFY
@@ -204,6 +618,7 @@ vprint_to_buffer(FILE *stream, int fortify_level, int priority,
 	if (len > 0) {
 		head->seq_no = ++seq_no;
 		head->priority = priority;
+		head->mode = mode;
 		head->dest = stream;
 		head->len = len;
 
@@ -575,11 +990,32 @@ static struct print_buffer *get_next_buffer(void)
 	return buffer;
 }
 
+static const char *get_deferred_text(struct print_buffer *buffer,
+				     struct entry_head *head, size_t *lenp)
+{
+	char *text;
+
+	/* A record never expands to more than its buffer could hold. */
+	if (deferred_textsz < buffer->size) {
+		text = realloc(deferred_text, buffer->size);
+		if (text == NULL)
+			return NULL;
+		deferred_text = text;
+		deferred_textsz = buffer->size;
+	}
+
+	*lenp = format_deferred(deferred_text, deferred_textsz, head->data);
+
+	return deferred_text;
+}
+
 static void print_buffers(void)
 {
 	struct print_buffer *buffer;
 	struct entry_head *head;
+	const char *text;
 	off_t read_pos;
+	size_t tlen;
 	int len, ret;
 
 	while (1) {
@@ -592,14 +1028,23 @@ static void print_buffers(void)
 		len = head->len;
 
 		if (len) {
+			/* Format deferred entries on behalf of the writer */
+			if (head->mode == RT_PRINT_MODE_DEFERRED)
+				text = get_deferred_text(buffer, head, &tlen);
+			else {
+				text = head->data;
+				tlen = head->len;
+			}
+
 			/* Print out non-empty entry and proceed */
 			/* Check if output goes to syslog */
-			if (head->dest == RT_PRINT_SYSLOG_STREAM) {
+			if (text == NULL || tlen == 0) {
+				/* Nothing to output. */
+			} else if (head->dest == RT_PRINT_SYSLOG_STREAM) {
 				syslog(head->priority,
-				       "%s", head->data);
+				       "%s", text);
 			} else {
-				ret = fwrite(head->data,
-					     head->len, 1, head->dest);
+				ret = fwrite(text, tlen, 1, head->dest);
 				(void)ret;
 			}
 
@@ -19,6 +19,7 @@
 #include <errno.h>
 #include <pthread.h>
 #include <sys/select.h>
+#include <cobalt/sys/cobalt.h>
 #include <asm/xenomai/syscall.h>
 #include "internal.h"
 
@@ -46,3 +47,37 @@ COBALT_IMPL(int, select, (int __nfds, fd_set *__restrict __readfds,
 	errno = -err;
 	return -1;
 }
+
+/*
+ * Persistent interest sets of RTDM file descriptors. Unlike
+ * select(), descriptors are bound once by cobalt_poll_ctl(), and
+ * cobalt_poll_wait() only visits those with pending events. The wait
+ * timeout is an absolute CLOCK_MONOTONIC date, NULL means infinite,
+ * and a zero date polls without blocking. These services return
+ * negated error codes, not -1 with errno set.
+ */
+
+int cobalt_poll_create(int flags)
+{
+	return XENOMAI_SYSCALL1(sc_cobalt_poll_create, flags);
+}
+
+int cobalt_poll_ctl(int pfd, int op, int fd, unsigned int events)
+{
+	return XENOMAI_SYSCALL4(sc_cobalt_poll_ctl, pfd, op, fd, events);
+}
+
+int cobalt_poll_wait(int pfd, struct cobalt_poll_event *events,
+		     int maxevents, const struct timespec *timeout)
+{
+	int ret, oldtype;
+
+	pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+
+	ret = XENOMAI_SYSCALL4(sc_cobalt_poll_wait,
+			       pfd, events, maxevents, timeout);
+
+	pthread_setcanceltype(oldtype, NULL);
+
+	return ret;
+}
@@ -86,6 +86,10 @@
  * In addition to the basic cluster object, the synchronizing cluster
  * (struct syncluster) provides support for waiting for a given object
  * to appear in the dictionary.
+ *
+ * Cluster tables grow as objects are indexed, and lookups do not
+ * serialize on the table lock, so that clusters indexing thousands
+ * of objects remain cheap to search from concurrent threads.
  */
 
 #include <errno.h>
@@ -400,12 +404,16 @@ const static struct hash_operations hash_operations = {
 
 const static struct pvhash_operations pvhash_operations = {
 	.compare = memcmp,
+	.alloc = pvmalloc,
+	.free = pvfree,
 };
 
 #else /* !CONFIG_XENO_PSHARED */
 
 const static struct hash_operations hash_operations = {
 	.compare = memcmp,
+	.alloc = xnmalloc,
+	.free = xnfree,
 };
 
 #endif /* !CONFIG_XENO_PSHARED */
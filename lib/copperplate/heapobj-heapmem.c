@@ -26,16 +26,33 @@
 
 struct heap_memory heapmem_main;
 
+/*
+ * Private heaps own their descriptor, and the arena unless the
+ * caller provided it. hobj->pool points at the heap descriptor,
+ * which must come first.
+ */
+struct private_heap {
+	struct heap_memory heap;
+	void *arena;
+};
+
 int __heapobj_init_private(struct heapobj *hobj, const char *name,
 			   size_t size, void *mem)
 {
+	struct private_heap *ph;
 	void *_mem = mem;
 	int ret;
 
+	ph = __STD(malloc(sizeof(*ph)));
+	if (ph == NULL)
+		return -ENOMEM;
+
 	if (mem == NULL) {
 		_mem = __STD(malloc(size));
-		if (_mem == NULL)
+		if (_mem == NULL) {
+			__STD(free(ph));
 			return -ENOMEM;
+		}
 	}
 	
 	if (name)
@@ -43,19 +60,30 @@ int __heapobj_init_private(struct heapobj *hobj, const char *name,
 	else
 		snprintf(hobj->name, sizeof(hobj->name), "%p", hobj);
 
-	ret = heapmem_init(hobj->pool, _mem, size);
+	ret = heapmem_init(&ph->heap, _mem, size);
 	if (ret) {
 		if (mem == NULL)
 			__STD(free(_mem));
+		__STD(free(ph));
 		return ret;
 	}
 
-	hobj->pool = _mem;
+	ph->arena = mem == NULL ? _mem : NULL;
+	hobj->pool = &ph->heap;
 	hobj->size = size;
 
 	return 0;
 }
 
+void pvheapobj_destroy(struct heapobj *hobj)
+{
+	struct private_heap *ph = hobj->pool;
+
+	heapmem_destroy(&ph->heap);
+	__STD(free(ph->arena));
+	__STD(free(ph));
+}
+
 int heapobj_init_array_private(struct heapobj *hobj, const char *name,
 			       size_t size, int elems)
 {
@@ -66,8 +94,8 @@ int heapobj_init_array_private(struct heapobj *hobj, const char *name,
 int heapobj_pkg_init_private(void)
 {
 	size_t size;
+	int ret, depth;
 	void *mem;
-	int ret;
 
 #ifdef CONFIG_XENO_PSHARED
 	size = MIN_HEAPMEM_HEAPSZ;
@@ -87,5 +115,19 @@ int heapobj_pkg_init_private(void)
 		return ret;
 	}
 
+	/*
+	 * Threads allocating and releasing small blocks at a high
+	 * rate may want to bypass the heap lock most of the time.
+	 */
+	depth = __copperplate_setup_data.mem_pool_cache;
+	if (depth > 0) {
+		ret = heapmem_enable_cache(&heapmem_main, depth);
+		if (ret) {
+			heapmem_destroy(&heapmem_main);
+			__STD(free(mem));
+			return ret;
+		}
+	}
+
 	return 0;
 }
@@ -25,6 +25,7 @@
 #include <sys/mman.h>
 #include <sys/file.h>
 #include <sys/stat.h>
+#include <sys/vfs.h>
 #include <stdbool.h>
 #include <assert.h>
 #include <errno.h>
@@ -41,6 +42,7 @@
 #include "boilerplate/list.h"
 #include "boilerplate/hash.h"
 #include "boilerplate/lock.h"
+#include "boilerplate/atomic.h"
 #include "copperplate/heapobj.h"
 #include "copperplate/debug.h"
 #include "xenomai/init.h"
@@ -55,14 +57,26 @@ enum sheapmem_pgtype {
 static struct shavl_searchops size_search_ops;
 static struct shavl_searchops addr_search_ops;
 
+static int grow_main_heap(struct shared_heap_memory *heap, size_t bsize);
+
 /*
  * The main heap consists of a shared heap at its core, with
  * additional session-wide information.
+ *
+ * The backing file starts with the initial segment (maplen bytes),
+ * followed by the extents added on demand when the heap runs out of
+ * memory, up to curlen. The file is sized to reservelen bytes from
+ * the start, which costs no memory until pages are touched, and
+ * every process maps it entirely. Extents another process has added
+ * are therefore readily accessible, including to the kernel (e.g.
+ * futex words, syscall buffers).
  */
 struct session_heap {
 	struct shared_heap_memory heap;
 	int cpid;
 	memoff_t maplen;
+	memoff_t curlen;
+	memoff_t reservelen;
 	struct hash_table catalog;
 	struct sysgroup sysgroup;
 };
@@ -91,6 +105,18 @@ struct sysgroup *__main_sysgroup;
 
 static struct heapobj main_pool;
 
+/*
+ * Process-local state of the main heap mapping: its length, the
+ * page size backing it and the kind of file it comes from.
+ */
+static size_t main_maplen;
+
+static size_t main_granularity;
+
+static bool main_hugetlb;
+
+#define DEFAULT_POOL_LIMIT_RATIO	16
+
 #define __shoff(b, p)		((void *)(p) - (void *)(b))
 #define __shoff_check(b, p)	((p) ? __shoff(b, p) : 0)
 #define __shref(b, o)		((void *)((void *)(b) + (o)))
@@ -340,17 +366,17 @@ static void add_page_front(struct shared_heap_memory *heap,
 	
 	ilog = log2size - SHEAPMEM_MIN_LOG2;
 	new = &ext->pagemap[pg];
-	if (heap->buckets[ilog] == -1U) {
-		heap->buckets[ilog] = pg;
+	if (ext->buckets[ilog] == -1U) {
+		ext->buckets[ilog] = pg;
 		new->prev = new->next = pg;
 	} else {
-		head = &ext->pagemap[heap->buckets[ilog]];
-		new->prev = heap->buckets[ilog];
+		head = &ext->pagemap[ext->buckets[ilog]];
+		new->prev = ext->buckets[ilog];
 		new->next = head->next;
 		next = &ext->pagemap[new->next];
 		next->prev = pg;
 		head->next = pg;
-		heap->buckets[ilog] = pg;
+		ext->buckets[ilog] = pg;
 	}
 }
 
@@ -365,10 +391,10 @@ static void remove_page(struct shared_heap_memory *heap,
 
 	old = &ext->pagemap[pg];
 	if (pg == old->next)
-		heap->buckets[ilog] = -1U;
+		ext->buckets[ilog] = -1U;
 	else {
-		if (pg == heap->buckets[ilog])
-			heap->buckets[ilog] = old->next;
+		if (pg == ext->buckets[ilog])
+			ext->buckets[ilog] = old->next;
 		prev = &ext->pagemap[old->prev];
 		prev->next = old->next;
 		next = &ext->pagemap[old->next];
@@ -384,7 +410,7 @@ static void move_page_front(struct shared_heap_memory *heap,
 
 	/* Move page at front of the per-bucket page list. */
 	
-	if (heap->buckets[ilog] == pg)
+	if (ext->buckets[ilog] == pg)
 		return;	 /* Already at front, no move. */
 		
 	remove_page(heap, ext, pg, log2size);
@@ -407,7 +433,7 @@ static void move_page_back(struct shared_heap_memory *heap,
 	remove_page(heap, ext, pg, log2size);
 
 	ilog = log2size - SHEAPMEM_MIN_LOG2;
-	head = &ext->pagemap[heap->buckets[ilog]];
+	head = &ext->pagemap[ext->buckets[ilog]];
 	last = &ext->pagemap[head->prev];
 	old->prev = head->prev;
 	old->next = last->next;
@@ -516,18 +542,18 @@ static void *sheapmem_alloc(struct shared_heap_memory *heap, size_t size)
 		write_lock_nocancel(&heap->lock);
 
 		__list_for_each_entry(main_base, ext, &heap->extents, next) {
-			pg = heap->buckets[ilog];
+			pg = ext->buckets[ilog];
 			if (pg < 0) /* Empty page list? */
 				continue;
 
 			/*
 			 * Find a block in the heading page. If there
-			 * is none, there won't be any down the list:
-			 * add a new page right away.
+			 * is none, there won't be any down the list
+			 * of this extent: try the next one.
 			 */
 			bmask = ext->pagemap[pg].map;
 			if (bmask == -1U)
-				break;
+				continue;
 			b = __ctz(~bmask);
 
 			/*
@@ -552,6 +578,12 @@ static void *sheapmem_alloc(struct shared_heap_memory *heap, size_t size)
 		/* Add a range of contiguous free pages. */
 		block = add_free_range(heap, bsize, 0);
 	}
+
+	/* The main heap may grow a new extent when exhausted. */
+	if (block == NULL && heap == &main_heap.heap &&
+	    grow_main_heap(heap, bsize) == 0)
+		block = add_free_range(heap, bsize,
+				       bsize < SHEAPMEM_PAGE_SIZE ? log2size : 0);
 out:
 	write_unlock(&heap->lock);
 
@@ -657,12 +689,12 @@ static struct shavl_searchops addr_search_ops = {
 	.cmp = compare_range_by_addr,
 };
 
-static int add_extent(struct shared_heap_memory *heap, void *base,
-		      void *mem, size_t size)
+static int __add_extent(struct shared_heap_memory *heap, void *base,
+			void *mem, size_t size)
 {
 	size_t user_size, overhead;
 	struct sheapmem_extent *ext;
-	int nrpages, state;
+	int nrpages, n;
 
 	/*
 	 * @size must include the overhead memory we need for storing
@@ -719,6 +751,10 @@ static int add_extent(struct shared_heap_memory *heap, void *base,
 		      
 	memset(ext->pagemap, 0, nrpages * sizeof(struct sheapmem_pgentry));
 
+	/* Reset bucket page lists, all empty. */
+	for (n = 0; n < SHEAPMEM_MAX; n++)
+		ext->buckets[n] = -1U;
+
 	/*
 	 * The free page pool is maintained as a set of ranges of
 	 * contiguous pages indexed by address and size in AVL
@@ -731,21 +767,31 @@ static int add_extent(struct shared_heap_memory *heap, void *base,
 	shavl_init(&ext->addr_tree);
 	release_page_range(ext, __shref(base, ext->membase), user_size);
 
-	write_lock_safe(&heap->lock, state);
 	__list_append(base, &ext->next, &heap->extents);
 	heap->arena_size += size;
 	heap->usable_size += user_size;
-	write_unlock_safe(&heap->lock, state);
 
 	return 0;
 }
 
+static int add_extent(struct shared_heap_memory *heap, void *base,
+		      void *mem, size_t size)
+{
+	int ret, state;
+
+	write_lock_safe(&heap->lock, state);
+	ret = __add_extent(heap, base, mem, size);
+	write_unlock_safe(&heap->lock, state);
+
+	return ret;
+}
+
 static int sheapmem_init(struct shared_heap_memory *heap, void *base,
 			 const char *name,
 			 void *mem, size_t size)
 {
 	pthread_mutexattr_t mattr;
-	int ret, n;
+	int ret;
 
 	namecpy(heap->name, name);
 	heap->used_size = 0;
@@ -762,10 +808,6 @@ static int sheapmem_init(struct shared_heap_memory *heap, void *base,
 	if (ret)
 		return ret;
 
-	/* Reset bucket page lists, all empty. */
-	for (n = 0; n < SHEAPMEM_MAX; n++)
-		heap->buckets[n] = -1U;
-
 	ret = add_extent(heap, base, mem, size);
 	if (ret) {
 		__RT(pthread_mutex_destroy(&heap->lock));
@@ -805,6 +847,14 @@ static int init_main_heap(struct session_heap *m_heap,
 	return 0;
 }
 
+static void unlink_main_file(const char *fsname)
+{
+	if (main_hugetlb)
+		unlink(fsname);
+	else
+		shm_unlink(fsname);
+}
+
 #ifndef CONFIG_XENO_REGISTRY
 static void unlink_main_heap(void)
 {
@@ -814,23 +864,173 @@ static void unlink_main_heap(void)
 	 * heap for the session). When the registry is enabled,
 	 * sysregd does the housekeeping.
 	 */
-	shm_unlink(main_pool.fsname);
+	unlink_main_file(main_pool.fsname);
 }
 #endif
 
+static int open_main_heap(struct heapobj *hobj, const char *session,
+			  const char *hugedir, int flags)
+{
+	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
+
+	if (hugedir) {
+		snprintf(hobj->fsname, sizeof(hobj->fsname),
+			 "%s/xeno:%s", hugedir, hobj->name);
+		return __STD(open(hobj->fsname, flags|O_CLOEXEC, 0660));
+	}
+
+	snprintf(hobj->fsname, sizeof(hobj->fsname),
+		 "/xeno:%s", hobj->name);
+
+	return shm_open(hobj->fsname, flags, 0660);
+}
+
+static int get_main_granularity(int fd)
+{
+	struct statfs sfs;
+
+	if (!main_hugetlb) {
+		main_granularity = sysconf(_SC_PAGESIZE);
+		return 0;
+	}
+
+	/* hugetlbfs reports the huge page size as its block size. */
+	if (fstatfs(fd, &sfs))
+		return -errno;
+
+	main_granularity = sfs.f_bsize;
+
+	return 0;
+}
+
+/*
+ * Hugepage-backed memory is mapped with MAP_NORESERVE, so that the
+ * unused part of the reservation does not consume huge pages. The
+ * pages of the heap extents are faulted in and locked as soon as
+ * the latter are created or mapped, which both spares the allocation
+ * hit when touching them first, and detects a shortage of huge pages
+ * early, instead of receiving SIGBUS later on.
+ */
+static int lock_main_range(void *base, memoff_t off, size_t len)
+{
+	if (!main_hugetlb)
+		return 0;
+
+	if (mlock(base + off, len))
+		return -errno;
+
+	return 0;
+}
+
+static void *map_main_file(int fd, size_t len)
+{
+	void *mem;
+
+	mem = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE,
+			 MAP_SHARED|MAP_NORESERVE, fd, 0));
+	if (mem == MAP_FAILED)
+		return NULL;
+
+	main_maplen = len;
+
+	return mem;
+}
+
+static void release_main_heap(void)
+{
+	munmap(__main_heap, main_maplen);
+	main_maplen = 0;
+}
+
+/*
+ * Add an extent large enough for @bsize bytes to the main heap,
+ * which must be locked by the caller. The backing file is mapped
+ * entirely by all processes, so the extent is readily available to
+ * every one of them once curlen is updated.
+ */
+static int grow_main_heap(struct shared_heap_memory *heap, size_t bsize)
+{
+	struct session_heap *m_heap = &main_heap;
+	size_t len, user_size;
+	memoff_t curlen;
+	void *mem;
+	int ret;
+
+	/* Grow by the initial heap size at the very least. */
+	len = __align_to(SHEAPMEM_ARENA_SIZE(bsize), main_granularity);
+	if (len < m_heap->maplen)
+		len = m_heap->maplen;
+
+	curlen = m_heap->curlen;
+	if (len > m_heap->reservelen - curlen)
+		return -ENOMEM;
+
+	/*
+	 * Find the largest page pool fitting in the mapping, along
+	 * with its meta-data.
+	 */
+	user_size = len / (SHEAPMEM_PAGE_SIZE + SHEAPMEM_PGMAP_BYTES) *
+		SHEAPMEM_PAGE_SIZE;
+	while (SHEAPMEM_ARENA_SIZE(user_size) > len)
+		user_size -= SHEAPMEM_PAGE_SIZE;
+
+	ret = lock_main_range(main_base, curlen, len);
+	if (ret)
+		return ret;
+
+	mem = main_base + curlen;
+	ret = __add_extent(heap, main_base, mem, SHEAPMEM_ARENA_SIZE(user_size));
+	if (ret)
+		return ret;
+
+	smp_store_release(&m_heap->curlen, curlen + len);
+	main_pool.size += user_size;
+
+	return 0;
+}
+
+static struct session_heap *map_main_heap(int fd)
+{
+	struct session_heap *m_heap;
+	memoff_t curlen, reservelen;
+	int ret;
+
+	/* Fetch the current layout from the header first. */
+	m_heap = __STD(mmap(NULL, sizeof(*m_heap), PROT_READ, MAP_SHARED, fd, 0));
+	if (m_heap == MAP_FAILED)
+		return NULL;
+
+	curlen = m_heap->curlen;
+	reservelen = m_heap->reservelen;
+	munmap(m_heap, sizeof(*m_heap));
+
+	m_heap = map_main_file(fd, reservelen);
+	if (m_heap == NULL)
+		return NULL;
+
+	ret = lock_main_range(m_heap, 0, curlen);
+	if (ret) {
+		munmap(m_heap, reservelen);
+		errno = -ret;
+		return NULL;
+	}
+
+	return m_heap;
+}
+
 static int create_main_heap(pid_t *cnode_r)
 {
+	const char *hugedir = __copperplate_setup_data.mem_pool_hugepages;
 	const char *session = __copperplate_setup_data.session_label;
-	size_t size = __copperplate_setup_data.mem_pool, pagesz;
+	size_t size = __copperplate_setup_data.mem_pool, limit;
 	gid_t gid =__copperplate_setup_data.session_gid;
 	struct heapobj *hobj = &main_pool;
+	memoff_t len, maplen, reservelen;
 	struct session_heap *m_heap;
 	struct stat sbuf;
-	memoff_t len;
-	int ret, fd;
+	int ret, fd, cpid;
 
 	*cnode_r = -1;
-	pagesz = sysconf(_SC_PAGESIZE);
 
 	/*
 	 * A storage page should be obviously larger than an extent
@@ -840,8 +1040,12 @@ static int create_main_heap(pid_t *cnode_r)
 	 * test (e.g. like size >= sizeof(struct sheapmem_extent)).
 	 */
 	assert(SHEAPMEM_PAGE_SIZE > sizeof(struct sheapmem_extent));
-	size = SHEAPMEM_ARENA_SIZE(size);
-	len = __align_to(size + sizeof(*m_heap), pagesz);
+
+	limit = __copperplate_setup_data.mem_pool_limit;
+	if (limit == 0)
+		limit = size * DEFAULT_POOL_LIMIT_RATIO;
+	else if (limit < size)
+		limit = size;
 
 	/*
 	 * Bind to (and optionally create) the main session's heap:
@@ -853,14 +1057,22 @@ static int create_main_heap(pid_t *cnode_r)
 	 * Otherwise, create the heap for the new emerging session and
 	 * bind to it.
 	 */
-	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
-	snprintf(hobj->fsname, sizeof(hobj->fsname),
-		 "/xeno:%s", hobj->name);
-
-	fd = shm_open(hobj->fsname, O_RDWR|O_CREAT, 0660);
+	fd = open_main_heap(hobj, session, hugedir, O_RDWR|O_CREAT);
 	if (fd < 0)
 		return __bt(-errno);
 
+	main_hugetlb = hugedir != NULL;
+	ret = get_main_granularity(fd);
+	if (ret)
+		goto close_fail;
+
+	size = SHEAPMEM_ARENA_SIZE(size);
+	len = __align_to(size + sizeof(*m_heap), main_granularity);
+	reservelen = __align_to(SHEAPMEM_ARENA_SIZE(limit) + sizeof(*m_heap),
+				main_granularity);
+	if (reservelen < len)
+		reservelen = len;
+
 	ret = flock(fd, LOCK_EX);
 	if (__bterrno(ret))
 		goto errno_fail;
@@ -872,30 +1084,37 @@ static int create_main_heap(pid_t *cnode_r)
 	if (sbuf.st_size == 0)
 		goto init;
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
+	m_heap = __STD(mmap(NULL, sizeof(*m_heap), PROT_READ, MAP_SHARED, fd, 0));
 	if (m_heap == MAP_FAILED) {
 		ret = __bt(-errno);
 		goto close_fail;
 	}
 
-	if (m_heap->cpid == 0)
+	cpid = m_heap->cpid;
+	maplen = m_heap->maplen;
+	munmap(m_heap, sizeof(*m_heap));
+
+	if (cpid == 0)
 		goto reset;
 
-	if (copperplate_probe_tid(m_heap->cpid) == 0) {
-		if (m_heap->maplen == len) {
+	if (copperplate_probe_tid(cpid) == 0) {
+		if (maplen == len) {
+			m_heap = map_main_heap(fd);
+			if (m_heap == NULL) {
+				ret = __bt(-errno);
+				goto close_fail;
+			}
 			/* CAUTION: __moff() depends on __main_heap. */
 			__main_heap = m_heap;
 			__main_sysgroup = &m_heap->sysgroup;
 			hobj->pool_ref = __moff(&m_heap->heap);
 			goto done;
 		}
-		*cnode_r = m_heap->cpid;
-		munmap(m_heap, len);
+		*cnode_r = cpid;
 		__STD(close(fd));
 		return __bt(-EEXIST);
 	}
 reset:
-	munmap(m_heap, len);
 	/*
 	 * Reset shared memory ownership to revoke permissions from a
 	 * former session with more permissive access rules, such as
@@ -912,7 +1131,8 @@ init:
 	if (__bterrno(ret))
 		goto unlink_fail;
 
-	ret = ftruncate(fd, len);
+	/* Sparse file, pages are allocated on first touch. */
+	ret = ftruncate(fd, reservelen);
 	if (__bterrno(ret))
 		goto unlink_fail;
 
@@ -930,15 +1150,20 @@ init:
 			goto unlink_fail;
 	}
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
-	if (m_heap == MAP_FAILED) {
-		ret = __bt(-errno);
+	m_heap = map_main_file(fd, reservelen);
+	if (m_heap == NULL)
 		goto unlink_fail;
-	}
 
 	__main_heap = m_heap;
+	ret = lock_main_range(m_heap, 0, len);
+	if (ret) {
+		errno = -ret;
+		goto unmap_fail;
+	}
 
 	m_heap->maplen = len;
+	m_heap->curlen = len;
+	m_heap->reservelen = reservelen;
 	/* CAUTION: init_main_heap() depends on hobj->pool_ref. */
 	hobj->pool_ref = __moff(&m_heap->heap);
 	ret = __bt(init_main_heap(m_heap, size));
@@ -958,10 +1183,10 @@ done:
 
 	return 0;
 unmap_fail:
-	munmap(m_heap, len);
+	release_main_heap();
 unlink_fail:
 	ret = -errno;
-	shm_unlink(hobj->fsname);
+	unlink_main_file(hobj->fsname);
 	goto close_fail;
 errno_fail:
 	ret = __bt(-errno);
@@ -973,22 +1198,29 @@ close_fail:
 
 static int bind_main_heap(const char *session)
 {
+	const char *hugedir = __copperplate_setup_data.mem_pool_hugepages;
 	struct heapobj *hobj = &main_pool;
 	struct session_heap *m_heap;
-	int ret, fd, cpid;
 	struct stat sbuf;
-	memoff_t len;
+	int ret, fd, cpid;
 
 	/* No error tracking, this is for internal users. */
 
-	snprintf(hobj->name, sizeof(hobj->name), "%s.heap", session);
-	snprintf(hobj->fsname, sizeof(hobj->fsname),
-		 "/xeno:%s", hobj->name);
-
-	fd = shm_open(hobj->fsname, O_RDWR, 0400);
+	main_hugetlb = false;
+	fd = open_main_heap(hobj, session, NULL, O_RDWR);
+	if (fd < 0 && errno == ENOENT) {
+		/* Maybe a hugepage-backed session. */
+		main_hugetlb = true;
+		fd = open_main_heap(hobj, session,
+				    hugedir ?: DEFAULT_HUGEPAGES_ROOT, O_RDWR);
+	}
 	if (fd < 0)
 		return -errno;
 
+	ret = get_main_granularity(fd);
+	if (ret)
+		goto fail;
+
 	ret = flock(fd, LOCK_EX);
 	if (ret)
 		goto errno_fail;
@@ -997,27 +1229,28 @@ static int bind_main_heap(const char *session)
 	if (ret)
 		goto errno_fail;
 
-	len = sbuf.st_size;
-	if (len < sizeof(*m_heap)) {
+	if (sbuf.st_size < sizeof(*m_heap)) {
 		ret = -EINVAL;
 		goto fail;
 	}
 
-	m_heap = __STD(mmap(NULL, len, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0));
-	if (m_heap == MAP_FAILED)
+	m_heap = map_main_heap(fd);
+	if (m_heap == NULL)
 		goto errno_fail;
 
-	cpid = m_heap->cpid;
+	flock(fd, LOCK_UN);
 	__STD(close(fd));
 
+	cpid = m_heap->cpid;
 	if (cpid == 0 || copperplate_probe_tid(cpid)) {
-		munmap(m_heap, len);
+		munmap(m_heap, main_maplen);
 		return -ENOENT;
 	}
 
+	/* CAUTION: __moff() depends on __main_heap. */
+	__main_heap = m_heap;
 	hobj->pool_ref = __moff(&m_heap->heap);
 	hobj->size = m_heap->heap.usable_size;
-	__main_heap = m_heap;
 	__main_catalog = &m_heap->catalog;
 	__main_sysgroup = &m_heap->sysgroup;
 
@@ -1038,14 +1271,14 @@ int pshared_check(void *__heap, void *__addr)
 	struct session_heap *m_heap;
 
 	/*
-	 * Fast check for the main heap: we have a single extent for
-	 * this one, so the address shall fall into the file-backed
-	 * memory range.
+	 * Fast check for the main heap: all extents are contiguous
+	 * in the backing file, so the address shall fall into the
+	 * file-backed memory range.
 	 */
 	if (__moff(heap) == main_pool.pool_ref) {
 		m_heap = container_of(heap, struct session_heap, heap);
 		return __addr >= (void *)m_heap &&
-			__addr < (void *)m_heap + m_heap->maplen;
+			__addr < (void *)m_heap + ACCESS_ONCE(m_heap->curlen);
 	}
 
 	/*
@@ -1087,7 +1320,7 @@ int heapobj_init(struct heapobj *hobj, const char *name, size_t size)
 	 */
 	heap = sheapmem_alloc(&main_heap.heap, len);
 	if (heap == NULL) {
-		warning("%s() failed for %Zu bytes, raise --mem-pool-size?",
+		warning("%s() failed for %Zu bytes, raise --mem-pool-limit?",
 			__func__, len);
 		return __bt(-ENOMEM);
 	}
@@ -1129,14 +1362,14 @@ void heapobj_destroy(struct heapobj *hobj)
 	cpid = main_heap.cpid;
 	if (cpid != 0 && cpid != get_thread_pid() &&
 	    copperplate_probe_tid(cpid) == 0) {
-		munmap(&main_heap, main_heap.maplen);
+		release_main_heap();
 		return;
 	}
 	
 	__RT(pthread_mutex_destroy(&heap->lock));
 	__RT(pthread_mutex_destroy(&main_heap.sysgroup.lock));
-	munmap(&main_heap, main_heap.maplen);
-	shm_unlink(hobj->fsname);
+	release_main_heap();
+	unlink_main_file(hobj->fsname);
 }
 
 int heapobj_extend(struct heapobj *hobj, size_t size, void *unused)
@@ -1145,7 +1378,7 @@ int heapobj_extend(struct heapobj *hobj, size_t size, void *unused)
 	void *mem;
 	int ret;
 
-	if (hobj == &main_pool)	/* Can't extend the main pool. */
+	if (hobj == &main_pool)	/* The main pool grows on demand. */
 		return __bt(-EINVAL);
 
 	size = SHEAPMEM_ARENA_SIZE(size);
@@ -1234,13 +1467,12 @@ int heapobj_bind_session(const char *session)
 
 void heapobj_unbind_session(void)
 {
-	size_t len = main_heap.maplen;
-
-	munmap(&main_heap, len);
+	release_main_heap();
 }
 
 int heapobj_unlink_session(const char *session)
 {
+	const char *hugedir;
 	char *path;
 	int ret;
 
@@ -1249,6 +1481,17 @@ int heapobj_unlink_session(const char *session)
 		return -ENOMEM;
 	ret = shm_unlink(path) ? -errno : 0;
 	free(path);
+	if (ret != -ENOENT)
+		return ret;
+
+	/* Maybe a hugepage-backed session. */
+	hugedir = __copperplate_setup_data.mem_pool_hugepages;
+	ret = asprintf(&path, "%s/xeno:%s.heap",
+		       hugedir ?: DEFAULT_HUGEPAGES_ROOT, session);
+	if (ret < 0)
+		return -ENOMEM;
+	ret = unlink(path) ? -errno : 0;
+	free(path);
 
 	return ret;
 }
@@ -41,6 +41,7 @@ struct copperplate_setup_data __copperplate_setup_data = {
 	.session_label = NULL,
 	.session_root = NULL,
 	.session_gid = USHRT_MAX,
+	.timer_servers = 1,
 };
 
 #ifdef CONFIG_XENO_COBALT
@@ -77,6 +78,37 @@ static const struct option copperplate_options[] = {
 		.flag = &__copperplate_setup_data.shared_registry,
 		.val = 1,
 	},
+	{
+#define timer_servers_opt	5
+		.name = "timer-servers",
+		.has_arg = required_argument,
+	},
+	{
+#define mempool_limit_opt	6
+		.name = "mem-pool-limit",
+		.has_arg = required_argument,
+	},
+	{
+#define mempool_hugepages_opt	7
+		.name = "mem-pool-hugepages",
+		.has_arg = optional_argument,
+	},
+#ifdef CONFIG_XENO_MERCURY
+	{
+#define condvar_monitor_opt	8
+		.name = "condvar-monitor",
+		.has_arg = no_argument,
+		.flag = &__copperplate_setup_data.condvar_monitor,
+		.val = 1,
+	},
+#endif
+#ifdef CONFIG_XENO_HEAPMEM
+	{
+#define mempool_cache_opt	9
+		.name = "mem-pool-cache",
+		.has_arg = required_argument,
+	},
+#endif
 	{ /* Sentinel */ }
 };
 
@@ -259,6 +291,24 @@ static int copperplate_parse_option(int optnum, const char *optarg)
 		}
 		__copperplate_setup_data.mem_pool = memsz;
 		break;
+	case mempool_limit_opt:
+		memsz = get_mem_size(optarg);
+		if (memsz == 0)
+			return -EINVAL;
+		__copperplate_setup_data.mem_pool_limit = memsz;
+		break;
+	case mempool_hugepages_opt:
+		__copperplate_setup_data.mem_pool_hugepages =
+			optarg ? strdup(optarg) : DEFAULT_HUGEPAGES_ROOT;
+		break;
+#ifdef CONFIG_XENO_HEAPMEM
+	case mempool_cache_opt:
+		ret = atoi(optarg);
+		if (ret < 0 || ret == 1 || ret > HEAPMEM_CACHE_MAX_DEPTH)
+			return -EINVAL;
+		__copperplate_setup_data.mem_pool_cache = ret;
+		break;
+#endif
 	case session_opt:
 		ret = get_session_label(optarg);
 		if (ret)
@@ -267,8 +317,17 @@ static int copperplate_parse_option(int optnum, const char *optarg)
 	case regroot_opt:
 		__copperplate_setup_data.registry_root = strdup(optarg);
 		break;
+	case timer_servers_opt:
+		ret = atoi(optarg);
+		if (ret < 1)
+			return -EINVAL;
+		__copperplate_setup_data.timer_servers = ret;
+		break;
 	case shared_registry_opt:
 	case no_registry_opt:
+#ifdef CONFIG_XENO_MERCURY
+	case condvar_monitor_opt:
+#endif
 		break;
 	default:
 		/* Paranoid, can't happen. */
@@ -281,10 +340,19 @@ static int copperplate_parse_option(int optnum, const char *optarg)
 static void copperplate_help(void)
 {
 	fprintf(stderr, "--mem-pool-size=<size[K|M|G]> 	size of the main heap\n");
+	fprintf(stderr, "--mem-pool-limit=<size[K|M|G]> 	max. size the main heap may grow to\n");
+	fprintf(stderr, "--mem-pool-hugepages[=<path>]	back the main heap with huge pages\n");
+#ifdef CONFIG_XENO_HEAPMEM
+	fprintf(stderr, "--mem-pool-cache=<depth>	per-thread cache of small blocks for the local heap\n");
+#endif
         fprintf(stderr, "--no-registry			suppress object registration\n");
         fprintf(stderr, "--shared-registry		enable public access to registry\n");
         fprintf(stderr, "--registry-root=<path>		root path of registry\n");
         fprintf(stderr, "--session=<label>[/<group>]	enable shared session\n");
+        fprintf(stderr, "--timer-servers=<n>		number of timer server threads\n");
+#ifdef CONFIG_XENO_MERCURY
+        fprintf(stderr, "--condvar-monitor		use condvars for synchronization objects\n");
+#endif
 }
 
 static struct setup_descriptor copperplate_interface = {
@@ -90,6 +90,8 @@ struct sheapmem_extent {
 	memoff_t memlim;	/* Offset limit of page array */
 	struct shavl addr_tree;
 	struct shavl size_tree;
+	/* Heads of page lists for log2-sized blocks. */
+	uint32_t buckets[SHEAPMEM_MAX];
 	struct sheapmem_pgentry pagemap[0]; /* Start of page entries[] */
 };
 
@@ -121,8 +123,6 @@ struct shared_heap_memory {
 	size_t arena_size;
 	size_t usable_size;
 	size_t used_size;
-	/* Heads of page lists for log2-sized blocks. */
-	uint32_t buckets[SHEAPMEM_MAX];
 	struct sysgroup_memspec memspec;
 };
 
@@ -130,6 +130,8 @@ ssize_t sheapmem_check(struct shared_heap_memory *heap, void *block);
 
 #endif /* CONFIG_XENO_PSHARED */
 
+#define DEFAULT_HUGEPAGES_ROOT		"/dev/hugepages"
+
 #ifdef CONFIG_XENO_REGISTRY
 #define DEFAULT_REGISTRY_ROOT		CONFIG_XENO_REGISTRY_ROOT
 #else
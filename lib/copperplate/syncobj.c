@@ -47,8 +47,9 @@
  *
  * The syncobj abstraction is based on a complex monitor object to
  * wait for resources, either implemented natively by Cobalt or
- * emulated via a mutex and two condition variables over Mercury (one
- * of which being hosted by the thread object implementation).
+ * emulated over Mercury, via futexes by default, or via a mutex and
+ * two condition variables with --condvar-monitor (one of which being
+ * hosted by the thread object implementation).
  *
  * NOTE: we don't do error backtracing in this file, since error
  * returns when locking, pending or deleting sync objects usually
@@ -101,12 +102,24 @@ void monitor_grant(struct syncobj *sobj, struct threadobj *thobj)
 			     threadobj_get_window(&thobj->core));
 }
 
+static inline
+void monitor_drain(struct syncobj *sobj, struct threadobj *thobj)
+{
+	/* Drained in bulk by monitor_drain_all(). */
+}
+
 static inline
 void monitor_drain_all(struct syncobj *sobj)
 {
 	cobalt_monitor_drain_all(&sobj->core.monitor);
 }
 
+static inline
+void monitor_cleanup_wait(struct syncobj *sobj, struct threadobj *thobj)
+{
+	/* Cancelled monitor waits grab the gate back. */
+}
+
 static inline int syncobj_init_corespec(struct syncobj *sobj,
 					clockid_t clk_id)
 {
@@ -126,9 +139,214 @@ static inline void syncobj_cleanup_corespec(struct syncobj *sobj)
 
 #else /* CONFIG_XENO_MERCURY */
 
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "boilerplate/time.h"
+#include "copperplate/tunables.h"
+
+/*
+ * The futex-based monitor is made of a PI futex guarding the
+ * syncobj, which we call the gate, and a wait word per thread. A
+ * thread granted access or drained while sleeping is first claimed
+ * by the releaser, which prevents it from leaving on timeout. The
+ * wake up is deferred until the releaser exits the monitor, at which
+ * point ownership of the gate is handed over directly to the first
+ * claimed thread if nobody else contends for it. This spares the
+ * woken thread the round-trip through the kernel for re-acquiring
+ * the gate, while the PI futex still boosts the owner whenever a
+ * contender shows up.
+ */
+#define MONITOR_WAITING		0
+#define MONITOR_CLAIMED		1
+#define MONITOR_WOKEN		2
+#define MONITOR_HANDOFF		3
+#define MONITOR_ABORTED		4
+
+#ifdef CONFIG_XENO_PSHARED
+#define MONITOR_FUTEX_PRIVATE	0
+#else
+#define MONITOR_FUTEX_PRIVATE	FUTEX_PRIVATE_FLAG
+#endif
+
+static inline int do_futex(atomic_t *word, int op, int val,
+			   const struct timespec *timeout)
+{
+	int ret;
+
+	ret = syscall(__NR_futex, &word->v, op | MONITOR_FUTEX_PRIVATE,
+		      val, timeout, NULL, FUTEX_BITSET_MATCH_ANY);
+
+	return ret < 0 ? -errno : ret;
+}
+
+static inline int monitor_self(void)
+{
+	struct threadobj *current = threadobj_current();
+
+	/* The thread finalizer clears current->pid. */
+	if (current && current->pid)
+		return current->pid;
+
+	return get_thread_pid();
+}
+
+static int monitor_futex_enter(struct syncobj *sobj)
+{
+	int self = monitor_self(), ret;
+
+	if (atomic_cmpxchg(&sobj->core.gate, 0, self) == 0)
+		return 0;
+
+	do
+		ret = do_futex(&sobj->core.gate, FUTEX_LOCK_PI, 0, NULL);
+	while (ret == -EINTR || ret == -EAGAIN);
+
+	return ret;
+}
+
+static inline void monitor_futex_wake(struct threadobj *thobj, int state)
+{
+	atomic_set(&thobj->core.monitor_word, state);
+	do_futex(&thobj->core.monitor_word, FUTEX_WAKE, 1, NULL);
+}
+
+static void monitor_futex_exit(struct syncobj *sobj)
+{
+	struct threadobj *thobj, *target = NULL;
+	int self = monitor_self(), ret;
+
+	while (!list_empty(&sobj->core.wake_list)) {
+		thobj = list_pop_entry(&sobj->core.wake_list,
+				       struct threadobj, wait_link);
+		if (target == NULL)
+			target = thobj;
+		else
+			monitor_futex_wake(thobj, MONITOR_WOKEN);
+	}
+
+	if (target) {
+		/*
+		 * The gate may only change hands in user-space if no
+		 * contender is queued on it in the kernel. The target
+		 * TID was recorded when it started waiting, since the
+		 * finalizer of a cancelled waiter may clear
+		 * target->pid concurrently.
+		 */
+		if (atomic_cmpxchg(&sobj->core.gate, self,
+				   target->core.monitor_tid) == self) {
+			monitor_futex_wake(target, MONITOR_HANDOFF);
+			return;
+		}
+		monitor_futex_wake(target, MONITOR_WOKEN);
+	}
+
+	if (atomic_cmpxchg(&sobj->core.gate, self, 0) != self) {
+		ret = do_futex(&sobj->core.gate, FUTEX_UNLOCK_PI, 0, NULL);
+		assert(ret == 0);
+		(void)ret;
+	}
+}
+
+static void monitor_futex_grant(struct syncobj *sobj, struct threadobj *thobj)
+{
+	/*
+	 * A thread which lost the race with its own timeout has
+	 * aborted the wait already, and will grab the gate by itself.
+	 */
+	if (atomic_cmpxchg(&thobj->core.monitor_word, MONITOR_WAITING,
+			   MONITOR_CLAIMED) == MONITOR_WAITING)
+		list_append(&thobj->wait_link, &sobj->core.wake_list);
+}
+
+static int monitor_futex_sleep(struct syncobj *sobj, atomic_t *word,
+			       const struct timespec *timeout)
+{
+	struct timespec now, delta;
+	int op = FUTEX_WAIT_BITSET;
+
+	if (timeout == NULL)
+		return do_futex(word, FUTEX_WAIT, MONITOR_WAITING, NULL);
+
+	switch (sobj->core.clock_id) {
+	case CLOCK_REALTIME:
+		op |= FUTEX_CLOCK_REALTIME;
+		/* fall through */
+	case CLOCK_MONOTONIC:
+		return do_futex(word, op, MONITOR_WAITING, timeout);
+	}
+
+	/* Futexes only know about the clocks above. */
+	__RT(clock_gettime(sobj->core.clock_id, &now));
+	timespec_sub(&delta, timeout, &now);
+	if (delta.tv_sec < 0)
+		return -ETIMEDOUT;
+
+	return do_futex(word, FUTEX_WAIT, MONITOR_WAITING, &delta);
+}
+
+/*
+ * Settle the outcome of a wait on the futex-based monitor. On return,
+ * the caller owns the gate.
+ */
+static int monitor_futex_settle(struct syncobj *sobj,
+				struct threadobj *thobj, int ret)
+{
+	atomic_t *word = &thobj->core.monitor_word;
+	int state, err;
+
+	for (;;) {
+		state = atomic_cmpxchg(word, MONITOR_WAITING, MONITOR_ABORTED);
+		if (state != MONITOR_CLAIMED)
+			break;
+		/* Our releaser did not exit the monitor yet. */
+		do_futex(word, FUTEX_WAIT, MONITOR_CLAIMED, NULL);
+	}
+
+	if (state != MONITOR_HANDOFF) {
+		err = monitor_futex_enter(sobj);
+		if (err)
+			ret = err;
+	}
+
+	thobj->core.monitor_sobj = NULL;
+
+	return ret;
+}
+
+static int monitor_futex_wait(struct syncobj *sobj,
+			      struct threadobj *current,
+			      const struct timespec *timeout)
+{
+	atomic_t *word = &current->core.monitor_word;
+	int ret, oldtype;
+
+	atomic_set(word, MONITOR_WAITING);
+	current->core.monitor_sobj = sobj;
+	current->core.monitor_tid = monitor_self();
+	monitor_futex_exit(sobj);
+
+	/*
+	 * Make the wait a cancellation point like pthread_cond_wait()
+	 * would be. The thread finalizer settles the wait on behalf
+	 * of a cancelled thread (see threadobj_get_wait_corespec()).
+	 */
+	do {
+		pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, &oldtype);
+		ret = monitor_futex_sleep(sobj, word, timeout);
+		pthread_setcanceltype(oldtype, NULL);
+	} while (ret != -ETIMEDOUT && atomic_read(word) == MONITOR_WAITING);
+
+	return monitor_futex_settle(sobj, current,
+				    ret == -ETIMEDOUT ? ret : 0);
+}
+
 static inline
 int monitor_enter(struct syncobj *sobj)
 {
+	if (sobj->core.futex)
+		return monitor_futex_enter(sobj);
+
 	return -pthread_mutex_lock(&sobj->core.lock);
 }
 
@@ -136,20 +354,50 @@ static inline
 void monitor_exit(struct syncobj *sobj)
 {
 	int ret;
+
+	if (sobj->core.futex) {
+		monitor_futex_exit(sobj);
+		return;
+	}
+
 	ret = pthread_mutex_unlock(&sobj->core.lock);
 	assert(ret == 0); (void)ret;
 }
 
+/*
+ * A thread cancelled while waiting on a condvar gets the lock back
+ * before its finalizer runs, granted or not. Tell the finalizer
+ * which lock to release (see threadobj_get_wait_corespec()).
+ */
+static int monitor_cond_wait(struct syncobj *sobj,
+			     struct threadobj *current,
+			     pthread_cond_t *cond,
+			     const struct timespec *timeout)
+{
+	int ret;
+
+	current->core.monitor_sobj = sobj;
+
+	if (timeout)
+		ret = -threadobj_cond_timedwait(cond, &sobj->core.lock, timeout);
+	else
+		ret = -threadobj_cond_wait(cond, &sobj->core.lock);
+
+	current->core.monitor_sobj = NULL;
+
+	return ret;
+}
+
 static inline
 int monitor_wait_grant(struct syncobj *sobj,
 		       struct threadobj *current,
 		       const struct timespec *timeout)
 {
-	if (timeout)
-		return -threadobj_cond_timedwait(&current->core.grant_sync,
-						 &sobj->core.lock, timeout);
+	if (sobj->core.futex)
+		return monitor_futex_wait(sobj, current, timeout);
 
-	return -threadobj_cond_wait(&current->core.grant_sync, &sobj->core.lock);
+	return monitor_cond_wait(sobj, current,
+				 &current->core.grant_sync, timeout);
 }
 
 static inline
@@ -157,30 +405,51 @@ int monitor_wait_drain(struct syncobj *sobj,
 		       struct threadobj *current,
 		       const struct timespec *timeout)
 {
-	if (timeout)
-		return -threadobj_cond_timedwait(&sobj->core.drain_sync,
-						 &sobj->core.lock,
-						 timeout);
+	if (sobj->core.futex)
+		return monitor_futex_wait(sobj, current, timeout);
 
-	return -threadobj_cond_wait(&sobj->core.drain_sync, &sobj->core.lock);
+	return monitor_cond_wait(sobj, current,
+				 &sobj->core.drain_sync, timeout);
 }
 
 static inline
 void monitor_grant(struct syncobj *sobj, struct threadobj *thobj)
 {
-	threadobj_cond_signal(&thobj->core.grant_sync);
+	if (sobj->core.futex)
+		monitor_futex_grant(sobj, thobj);
+	else
+		threadobj_cond_signal(&thobj->core.grant_sync);
+}
+
+static inline
+void monitor_drain(struct syncobj *sobj, struct threadobj *thobj)
+{
+	if (sobj->core.futex)
+		monitor_futex_grant(sobj, thobj);
 }
 
 static inline
 void monitor_drain_all(struct syncobj *sobj)
 {
-	threadobj_cond_broadcast(&sobj->core.drain_sync);
+	if (!sobj->core.futex)
+		threadobj_cond_broadcast(&sobj->core.drain_sync);
+}
+
+static inline
+void monitor_cleanup_wait(struct syncobj *sobj, struct threadobj *thobj)
+{
+	/*
+	 * Unlike pthread_cond_wait(), a cancelled futex wait does not
+	 * grab the gate back.
+	 */
+	if (sobj->core.futex)
+		monitor_futex_settle(sobj, thobj, 0);
 }
 
 /*
- * Over Mercury, we implement a complex monitor via a mutex and a
- * couple of condvars, one in the syncobj and the other owned by the
- * thread object.
+ * Over Mercury, we implement a complex monitor either via futexes,
+ * or via a mutex and a couple of condvars, one in the syncobj and the
+ * other owned by the thread object.
  */
 static inline int syncobj_init_corespec(struct syncobj *sobj,
 					clockid_t clk_id)
@@ -189,6 +458,14 @@ static inline int syncobj_init_corespec(struct syncobj *sobj,
 	pthread_condattr_t cattr;
 	int ret;
 
+	sobj->core.futex = !get_runtime_tunable(condvar_monitor);
+	if (sobj->core.futex) {
+		atomic_set(&sobj->core.gate, 0);
+		sobj->core.clock_id = clk_id;
+		list_init(&sobj->core.wake_list);
+		return 0;
+	}
+
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, mutex_type_attribute);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
@@ -223,6 +500,8 @@ static inline int syncobj_init_corespec(struct syncobj *sobj,
 static inline void syncobj_cleanup_corespec(struct syncobj *sobj)
 {
 	monitor_exit(sobj);
+	if (sobj->core.futex)
+		return;
 	pthread_cond_destroy(&sobj->core.drain_sync);
 	pthread_mutex_destroy(&sobj->core.lock);
 }
@@ -328,6 +607,7 @@ int __syncobj_broadcast_drain(struct syncobj *sobj, int reason)
 				       struct threadobj, wait_link);
 		thobj->wait_sobj = NULL;
 		thobj->wait_status |= reason;
+		monitor_drain(sobj, thobj);
 	} while (!list_empty(&sobj->drain_list));
 
 	monitor_drain_all(sobj);
@@ -385,7 +665,10 @@ void __syncobj_cleanup_wait(struct syncobj *sobj, struct threadobj *thobj)
 	 * because the caller got cancelled while sleeping on the
 	 * GRANT/DRAIN condition.
 	 */
-	dequeue_waiter(sobj, thobj);
+	monitor_cleanup_wait(sobj, thobj);
+
+	if (thobj->wait_sobj)
+		dequeue_waiter(sobj, thobj);
 
 	if (--sobj->wait_count == 0 && sobj->magic != SYNCOBJ_MAGIC) {
 		__syncobj_finalize(sobj);
@@ -255,6 +255,11 @@ static inline void threadobj_uninit_corespec(struct threadobj *thobj)
 {
 }
 
+static inline struct syncobj *threadobj_get_wait_corespec(struct threadobj *thobj)
+{
+	return thobj->wait_sobj;
+}
+
 #ifdef CONFIG_XENO_PSHARED
 
 static inline int threadobj_setup_corespec(struct threadobj *thobj)
@@ -591,6 +596,7 @@ static inline int threadobj_init_corespec(struct threadobj *thobj)
 	int ret;
 
 	thobj->core.rr_timer = NULL;
+	thobj->core.monitor_sobj = NULL;
 	/*
 	 * Over Mercury, we need an additional per-thread condvar to
 	 * implement the complex monitor for the syncobj abstraction.
@@ -617,6 +623,17 @@ static inline void threadobj_uninit_corespec(struct threadobj *thobj)
 	pthread_cond_destroy(&thobj->core.grant_sync);
 }
 
+static inline struct syncobj *threadobj_get_wait_corespec(struct threadobj *thobj)
+{
+	/*
+	 * A thread cancelled while sleeping on a monitor has to
+	 * settle its wait even if it was granted meanwhile, since it
+	 * owns the condvar lock again, or might have received
+	 * ownership of the futex gate.
+	 */
+	return thobj->wait_sobj ?: thobj->core.monitor_sobj;
+}
+
 static inline int threadobj_setup_corespec(struct threadobj *thobj)
 {
 	struct sigevent sev;
@@ -1508,6 +1525,7 @@ int threadobj_cancel(struct threadobj *thobj)
 static void finalize_thread(void *p) /* thobj->lock free */
 {
 	struct threadobj *thobj = p;
+	struct syncobj *sobj;
 
 	if (thobj == NULL || thobj == THREADOBJ_IRQCONTEXT)
 		return;
@@ -1517,8 +1535,9 @@ static void finalize_thread(void *p) /* thobj->lock free */
 	threadobj_set_current(p);
 	thobj->pid = 0;
 
-	if (thobj->wait_sobj)
-		__syncobj_cleanup_wait(thobj->wait_sobj, thobj);
+	sobj = threadobj_get_wait_corespec(thobj);
+	if (sobj)
+		__syncobj_cleanup_wait(sobj, thobj);
 
 	sysgroup_remove(thread, &thobj->memspec);
 
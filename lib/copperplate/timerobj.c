@@ -26,6 +26,7 @@
 #include <limits.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <stdint.h>
 #include "boilerplate/list.h"
 #include "boilerplate/signal.h"
 #include "boilerplate/lock.h"
@@ -33,15 +34,59 @@
 #include "copperplate/timerobj.h"
 #include "copperplate/clockobj.h"
 #include "copperplate/debug.h"
+#include "copperplate/heapobj.h"
+#include "copperplate/tunables.h"
 #include "internal.h"
 
-static pthread_mutex_t svlock;
+/*
+ * Outstanding timers are indexed by a hierarchical timing wheel, so
+ * that starting and stopping a timer are O(1) operations regardless
+ * of the number of armed timers. The wheel is only an index: every
+ * timerobj still has its own POSIX timer, which notifies the server
+ * thread upon expiry, so firing accuracy does not depend on the
+ * wheel granularity.
+ *
+ * Level L of the wheel has TMWHEEL_SLOTS slots, each covering
+ * 2^(L * TMWHEEL_BITS) ticks of 2^TMWHEEL_TICK_SHIFT nanoseconds. A
+ * timer is indexed at the lowest level which may hold its expiry
+ * date relative to the current wheel position, timers beyond the
+ * reach of the top level wait on the overflow list. Slots of upper
+ * levels are cascaded down each time the lower level wraps.
+ */
+#define TMWHEEL_TICK_SHIFT	16	/* ~65 us */
+#define TMWHEEL_BITS		6
+#define TMWHEEL_SLOTS		(1 << TMWHEEL_BITS)
+#define TMWHEEL_MASK		(TMWHEEL_SLOTS - 1)
+#define TMWHEEL_LEVELS		4
+#define TMWHEEL_OVERFLOW	(TMWHEEL_LEVELS * TMWHEEL_SLOTS)
+#define TMWHEEL_UNLINKED	-1
+
+struct timer_wheel {
+	/* Next tick to process. */
+	uint64_t clk;
+	/* Bitmaps of non-empty slots, per level. */
+	uint64_t pending[TMWHEEL_LEVELS];
+	struct pvlistobj slots[TMWHEEL_LEVELS][TMWHEEL_SLOTS];
+	struct pvlistobj overflow;
+};
+
+/*
+ * A timer server is a thread receiving the expiry notifications for
+ * the timers attached to it, running their handlers. Handlers of
+ * timers attached to the same server are serialized.
+ */
+struct timerobj_server {
+	pthread_mutex_t lock;
+	pthread_t thread;
+	pid_t pid;
+	struct timer_wheel wheel;
+};
 
-static pthread_t svthread;
+static struct timerobj_server *servers;
 
-static pid_t svpid;
+static int nrservers;
 
-static DEFINE_PRIVATE_LIST(svtimers);
+static unsigned int next_server;
 
 #ifdef CONFIG_XENO_COBALT
 
@@ -60,35 +105,193 @@ static inline void timersv_init_corespec(void)
 
 #endif /* CONFIG_XENO_MERCURY */
 
+static inline uint64_t timespec_to_wheel_ticks(const struct timespec *ts)
+{
+	sticks_t ns = timespec_scalar(ts);
+
+	return ns < 0 ? 0 : (uint64_t)ns >> TMWHEEL_TICK_SHIFT;
+}
+
+static void wheel_init(struct timer_wheel *w)
+{
+	struct timespec now;
+	int lvl, n;
+
+	for (lvl = 0; lvl < TMWHEEL_LEVELS; lvl++) {
+		w->pending[lvl] = 0;
+		for (n = 0; n < TMWHEEL_SLOTS; n++)
+			pvlist_init(&w->slots[lvl][n]);
+	}
+
+	pvlist_init(&w->overflow);
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+	w->clk = timespec_to_wheel_ticks(&now);
+}
+
 /*
- * XXX: at some point, we may consider using a timer wheel instead of
- * a simple linked list to index timers. The latter method is
- * efficient for up to ten outstanding timers or so, which should be
- * enough for most applications. However, there exist poorly designed
- * apps involving dozens of active timers, particularly in the legacy
- * embedded world.
+ * Index @tmobj relative to tick @base, which may be ahead of the
+ * wheel position if the latter was not advanced for a while.
  */
-static void timerobj_enqueue(struct timerobj *tmobj)
+static void __wheel_insert(struct timer_wheel *w, struct timerobj *tmobj,
+			   uint64_t base)
 {
-	struct timerobj *__tmobj;
+	uint64_t expires, delta;
+	int lvl, n;
+
+	if (base < w->clk)
+		base = w->clk;
+
+	expires = timespec_to_wheel_ticks(&tmobj->itspec.it_value);
+	if (expires < base)	/* Already elapsed. */
+		expires = w->clk;
+
+	delta = expires < base ? 0 : expires - base;
+	for (lvl = 0; lvl < TMWHEEL_LEVELS; lvl++) {
+		if (delta < (1ULL << ((lvl + 1) * TMWHEEL_BITS))) {
+			n = (expires >> (lvl * TMWHEEL_BITS)) & TMWHEEL_MASK;
+			pvlist_append(&tmobj->next, &w->slots[lvl][n]);
+			w->pending[lvl] |= 1ULL << n;
+			tmobj->wheel_pos = lvl * TMWHEEL_SLOTS + n;
+			return;
+		}
+	}
 
-	if (pvlist_empty(&svtimers)) {
-		pvlist_append(&tmobj->next, &svtimers);
+	pvlist_append(&tmobj->next, &w->overflow);
+	tmobj->wheel_pos = TMWHEEL_OVERFLOW;
+}
+
+static void wheel_insert(struct timer_wheel *w, struct timerobj *tmobj)
+{
+	struct timespec now;
+
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+	__wheel_insert(w, tmobj, timespec_to_wheel_ticks(&now));
+}
+
+static void wheel_remove(struct timer_wheel *w, struct timerobj *tmobj)
+{
+	int lvl, n;
+
+	pvlist_remove_init(&tmobj->next);
+
+	if (tmobj->wheel_pos >= 0 && tmobj->wheel_pos < TMWHEEL_OVERFLOW) {
+		lvl = tmobj->wheel_pos / TMWHEEL_SLOTS;
+		n = tmobj->wheel_pos % TMWHEEL_SLOTS;
+		if (pvlist_empty(&w->slots[lvl][n]))
+			w->pending[lvl] &= ~(1ULL << n);
+	}
+
+	tmobj->wheel_pos = TMWHEEL_UNLINKED;
+}
+
+static void wheel_gather(struct timer_wheel *w, int lvl,
+			 uint64_t from, uint64_t to,
+			 struct pvlistobj *list)
+{
+	uint64_t unit, bits;
+	int n;
+
+	/*
+	 * Pull the timers from the slots of level @lvl covering units
+	 * @from to @to inclusive, i.e. all of them if the range
+	 * spans a full turn.
+	 */
+	if (to - from >= TMWHEEL_SLOTS - 1) {
+		bits = w->pending[lvl];
+		while (bits) {
+			n = __builtin_ctzll(bits);
+			bits &= ~(1ULL << n);
+			pvlist_join(&w->slots[lvl][n], list);
+		}
+		w->pending[lvl] = 0;
 		return;
 	}
 
-	pvlist_for_each_entry_reverse(__tmobj, &svtimers, next) {
-		if (timespec_before_or_same(&__tmobj->itspec.it_value,
-					    &tmobj->itspec.it_value))
+	for (unit = from; unit <= to; unit++) {
+		n = unit & TMWHEEL_MASK;
+		if (w->pending[lvl] & (1ULL << n)) {
+			pvlist_join(&w->slots[lvl][n], list);
+			w->pending[lvl] &= ~(1ULL << n);
+		}
+	}
+}
+
+static void wheel_collect(struct timer_wheel *w, struct pvlistobj *slot,
+			  const struct timespec *now,
+			  struct pvlistobj *expired)
+{
+	struct timerobj *tmobj, *tmp;
+
+	pvlist_for_each_entry_safe(tmobj, tmp, slot, next) {
+		if (timespec_after(&tmobj->itspec.it_value, now))
+			continue;
+		pvlist_remove(&tmobj->next);
+		pvlist_append(&tmobj->next, expired);
+		tmobj->wheel_pos = TMWHEEL_UNLINKED;
+	}
+}
+
+/*
+ * Move all timers which elapsed at @now to the @expired list,
+ * moving the wheel position to @now in a single step. Only the slots
+ * the wheel position crossed at each level are visited, and their
+ * timers reindexed relative to the new position, which sends the
+ * elapsed ones to the base slot of the current tick. The cost
+ * therefore depends on the number of timers crossed, not on the time
+ * elapsed since the previous call.
+ */
+static void wheel_advance(struct timer_wheel *w, const struct timespec *now,
+			  struct pvlistobj *expired)
+{
+	struct pvlistobj list;
+	struct timerobj *tmobj;
+	uint64_t target, shift;
+	int lvl, n;
+
+	target = timespec_to_wheel_ticks(now);
+	if (target < w->clk)
+		return;
+
+	pvlist_init(&list);
+
+	/* Base level slots hold ticks, starting from the current one. */
+	wheel_gather(w, 0, w->clk, target, &list);
+
+	/* Upper level slots are entered when their first unit begins. */
+	for (lvl = 1; lvl < TMWHEEL_LEVELS; lvl++) {
+		shift = lvl * TMWHEEL_BITS;
+		if ((target >> shift) == (w->clk >> shift))
 			break;
+		wheel_gather(w, lvl, (w->clk >> shift) + 1,
+			     target >> shift, &list);
+	}
+
+	/* The top level wrapped, pull timers from overflow. */
+	shift = TMWHEEL_LEVELS * TMWHEEL_BITS;
+	if ((target >> shift) != (w->clk >> shift) &&
+	    !pvlist_empty(&w->overflow))
+		pvlist_join(&w->overflow, &list);
+
+	w->clk = target;
+
+	while (!pvlist_empty(&list)) {
+		tmobj = pvlist_pop_entry(&list, struct timerobj, next);
+		__wheel_insert(w, tmobj, target);
 	}
 
-	atpvh(&__tmobj->next, &tmobj->next);
+	n = target & TMWHEEL_MASK;
+	if (w->pending[0] & (1ULL << n)) {
+		wheel_collect(w, &w->slots[0][n], now, expired);
+		if (pvlist_empty(&w->slots[0][n]))
+			w->pending[0] &= ~(1ULL << n);
+	}
 }
 
 static int server_prologue(void *arg)
 {
-	svpid = get_thread_pid();
+	struct timerobj_server *sv = arg;
+
+	sv->pid = get_thread_pid();
 	copperplate_set_current_name("timer-internal");
 	timersv_init_corespec();
 	threadobj_set_current(THREADOBJ_IRQCONTEXT);
@@ -98,67 +301,99 @@ static int server_prologue(void *arg)
 
 static void *timerobj_server(void *arg)
 {
+	struct timerobj_server *sv = arg;
 	struct timespec now, value, interval;
-	struct timerobj *tmobj, *tmp;
+	struct pvlistobj expired;
+	struct timerobj *tmobj;
 	sigset_t set;
 	int sig, ret;
 
 	sigemptyset(&set);
 	sigaddset(&set, SIGALRM);
+	pvlist_init(&expired);
 
 	for (;;) {
 		ret = __RT(sigwait(&set, &sig));
 		if (ret && ret != -EINTR)
 			break;
 		/*
-		 * We have a single server thread for now, so handlers
-		 * are fully serialized.
+		 * Handlers of all timers attached to this server are
+		 * serialized.
 		 */
-		write_lock_nocancel(&svlock);
+		write_lock_nocancel(&sv->lock);
 
-		__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
-
-		pvlist_for_each_entry_safe(tmobj, tmp, &svtimers, next) {
-			value = tmobj->itspec.it_value;
-			if (timespec_after(&value, &now))
+		/*
+		 * Periodic timers which are still overdue once
+		 * rescheduled are caught up by the next pass.
+		 */
+		for (;;) {
+			__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+			wheel_advance(&sv->wheel, &now, &expired);
+			if (pvlist_empty(&expired))
 				break;
-			pvlist_remove_init(&tmobj->next);
-			interval = tmobj->itspec.it_interval;
-			if (interval.tv_sec > 0 || interval.tv_nsec > 0) {
-				timespec_add(&tmobj->itspec.it_value,
-					     &value, &interval);
-				timerobj_enqueue(tmobj);
-			}
-			write_unlock(&svlock);
-			tmobj->handler(tmobj);
-			write_lock_nocancel(&svlock);
+			/*
+			 * Timers are picked one at a time, since the
+			 * expired list may change while the lock is
+			 * dropped for running the handler (e.g. timer
+			 * stopped).
+			 */
+			do {
+				tmobj = pvlist_pop_entry(&expired,
+						 struct timerobj, next);
+				pvholder_init(&tmobj->next);
+				value = tmobj->itspec.it_value;
+				interval = tmobj->itspec.it_interval;
+				if (interval.tv_sec > 0 || interval.tv_nsec > 0) {
+					timespec_add(&tmobj->itspec.it_value,
+						     &value, &interval);
+					wheel_insert(&sv->wheel, tmobj);
+				}
+				write_unlock(&sv->lock);
+				tmobj->handler(tmobj);
+				write_lock_nocancel(&sv->lock);
+			} while (!pvlist_empty(&expired));
 		}
 
-		write_unlock(&svlock);
+		write_unlock(&sv->lock);
 	}
 
 	return NULL;
 }
 
-static void timerobj_spawn_server(void)
+static void timerobj_spawn_servers(void)
 {
 	struct corethread_attributes cta;
+	int n;
+
+	for (n = 0; n < nrservers; n++) {
+		cta.policy = SCHED_CORE;
+		cta.param_ex.sched_priority = threadobj_irq_prio;
+		cta.prologue = server_prologue;
+		cta.run = timerobj_server;
+		cta.arg = servers + n;
+		cta.stacksize = PTHREAD_STACK_DEFAULT;
+		cta.detachstate = PTHREAD_CREATE_DETACHED;
+
+		if (__bt(copperplate_create_thread(&cta, &servers[n].thread)))
+			break;
+	}
+}
+
+static struct timerobj_server *pick_server(void)
+{
+	struct timerobj_server *sv;
 
-	cta.policy = SCHED_CORE;
-	cta.param_ex.sched_priority = threadobj_irq_prio;
-	cta.prologue = server_prologue;
-	cta.run = timerobj_server;
-	cta.arg = NULL;
-	cta.stacksize = PTHREAD_STACK_DEFAULT;
-	cta.detachstate = PTHREAD_CREATE_DETACHED;
+	/* Spread timers evenly over the available servers. */
+	sv = servers + __sync_fetch_and_add(&next_server, 1) % nrservers;
 
-	__bt(copperplate_create_thread(&cta, &svthread));
+	return sv->thread ? sv : servers;
 }
 
 int timerobj_init(struct timerobj *tmobj)
 {
 	static pthread_once_t spawn_once;
 	pthread_mutexattr_t mattr;
+	struct timerobj_server *sv;
 	struct sigevent sev;
 	int ret;
 
@@ -173,17 +408,20 @@ int timerobj_init(struct timerobj *tmobj)
 	 * very least), and spawning a short-lived thread at each
 	 * timeout expiration to run the handler is just overkill.
 	 */
-	pthread_once(&spawn_once, timerobj_spawn_server);
-	if (!svthread)
+	pthread_once(&spawn_once, timerobj_spawn_servers);
+	if (!servers[0].thread)
 		return __bt(-EAGAIN);
 
+	sv = pick_server();
+	tmobj->server = sv;
 	tmobj->handler = NULL;
+	tmobj->wheel_pos = TMWHEEL_UNLINKED;
 	pvholder_init(&tmobj->next); /* so we may use pvholder_linked() */
 
 	memset(&sev, 0, sizeof(sev));
 	sev.sigev_notify = SIGEV_THREAD_ID;
 	sev.sigev_signo = SIGALRM;
-	sev.sigev_notify_thread_id = svpid;
+	sev.sigev_notify_thread_id = sv->pid;
 
 	ret = __RT(timer_create(CLOCK_COPPERPLATE, &sev, &tmobj->timer));
 	if (ret)
@@ -202,12 +440,14 @@ int timerobj_init(struct timerobj *tmobj)
 
 void timerobj_destroy(struct timerobj *tmobj) /* lock held, dropped */
 {
-	write_lock_nocancel(&svlock);
+	struct timerobj_server *sv = tmobj->server;
+
+	write_lock_nocancel(&sv->lock);
 
 	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
+		wheel_remove(&sv->wheel, tmobj);
 
-	write_unlock(&svlock);
+	write_unlock(&sv->lock);
 
 	__RT(timer_delete(tmobj->timer));
 	__RT(pthread_mutex_unlock(&tmobj->lock));
@@ -218,6 +458,8 @@ int timerobj_start(struct timerobj *tmobj,
 		   void (*handler)(struct timerobj *tmobj),
 		   struct itimerspec *it) /* lock held, dropped */
 {
+	struct timerobj_server *sv = tmobj->server;
+
 	tmobj->handler = handler;
 	tmobj->itspec = *it;
 
@@ -230,13 +472,17 @@ int timerobj_start(struct timerobj *tmobj,
 	 * happens to check the return code then drop the timer
 	 * (again).
 	 */
-	write_lock_nocancel(&svlock);
+	write_lock_nocancel(&sv->lock);
 
 	if (__RT(timer_settime(tmobj->timer, TIMER_ABSTIME, it, NULL)))
 		return __bt(-errno);
 
-	timerobj_enqueue(tmobj);
-	write_unlock(&svlock);
+	/* Restarting an outstanding timer requeues it. */
+	if (pvholder_linked(&tmobj->next))
+		wheel_remove(&sv->wheel, tmobj);
+
+	wheel_insert(&sv->wheel, tmobj);
+	write_unlock(&sv->lock);
 	timerobj_unlock(tmobj);
 
 	return 0;
@@ -245,13 +491,14 @@ int timerobj_start(struct timerobj *tmobj,
 int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 {
 	static const struct itimerspec itimer_stop;
+	struct timerobj_server *sv = tmobj->server;
 
-	write_lock_nocancel(&svlock);
+	write_lock_nocancel(&sv->lock);
 
 	if (pvholder_linked(&tmobj->next))
-		pvlist_remove_init(&tmobj->next);
+		wheel_remove(&sv->wheel, tmobj);
 
-	write_unlock(&svlock);
+	write_unlock(&sv->lock);
 
 	__RT(timer_settime(tmobj->timer, 0, &itimer_stop, NULL));
 	tmobj->handler = NULL;
@@ -263,13 +510,30 @@ int timerobj_stop(struct timerobj *tmobj) /* lock held, dropped */
 int timerobj_pkg_init(void)
 {
 	pthread_mutexattr_t mattr;
-	int ret;
+	int ret = 0, n;
+
+	nrservers = __copperplate_setup_data.timer_servers;
+	if (nrservers < 1)
+		nrservers = 1;
+
+	servers = pvmalloc(nrservers * sizeof(*servers));
+	if (servers == NULL)
+		return -ENOMEM;
+
+	memset(servers, 0, nrservers * sizeof(*servers));
 
 	pthread_mutexattr_init(&mattr);
 	pthread_mutexattr_settype(&mattr, PTHREAD_MUTEX_RECURSIVE);
 	pthread_mutexattr_setprotocol(&mattr, PTHREAD_PRIO_INHERIT);
 	pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_PRIVATE);
-	ret = __bt(-__RT(pthread_mutex_init(&svlock, &mattr)));
+
+	for (n = 0; n < nrservers; n++) {
+		ret = __bt(-__RT(pthread_mutex_init(&servers[n].lock, &mattr)));
+		if (ret)
+			break;
+		wheel_init(&servers[n].wheel);
+	}
+
 	pthread_mutexattr_destroy(&mattr);
 
 	return ret;
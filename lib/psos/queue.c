@@ -22,6 +22,7 @@
 #include <stdlib.h>
 #include <memory.h>
 #include <boilerplate/ancillaries.h>
+#include <boilerplate/compiler.h>
 #include <copperplate/threadobj.h>
 #include <copperplate/heapobj.h>
 #include <copperplate/clockobj.h>
@@ -39,9 +40,11 @@ struct cluster psos_queue_table;
 
 static unsigned long anon_qids;
 
-struct msgholder {
-	int size;
-	struct holder link;
+/* Slot count an unlimited queue starts from when it needs growing. */
+#define QUEUE_MIN_SLOTS	8
+
+struct msgslot {
+	u_long size;
 	/* Payload data follows. */
 };
 
@@ -71,9 +74,86 @@ objid_error:
 	return NULL;
 }
 
+static inline struct msgslot *queue_slot(struct psos_queue *q, u_long n)
+{
+	return __mptr(q->slots) + n * q->slotsz;
+}
+
+/*
+ * Unlimited queues double their ring when it fills up, which is the
+ * only case the allocator is called from the send path. Queued
+ * messages are moved to the front of the new ring.
+ */
+static int queue_grow(struct psos_queue *q)
+{
+	u_long nslots, head;
+	void *slots;
+
+	nslots = q->nslots ? q->nslots * 2 : QUEUE_MIN_SLOTS;
+	if (nslots < q->nslots || nslots > SIZE_MAX / q->slotsz)
+		return -ENOMEM;
+
+	slots = xnmalloc(nslots * q->slotsz);
+	if (slots == NULL)
+		return -ENOMEM;
+
+	if (q->nslots) {
+		head = q->nslots - q->rdslot;
+		if (head > q->msgcount)
+			head = q->msgcount;
+		memcpy(slots, queue_slot(q, q->rdslot), head * q->slotsz);
+		memcpy(slots + head * q->slotsz, queue_slot(q, 0),
+		       (q->msgcount - head) * q->slotsz);
+		xnfree(__mptr(q->slots));
+	}
+
+	q->slots = __moff(slots);
+	q->nslots = nslots;
+	q->rdslot = 0;
+
+	return 0;
+}
+
+/*
+ * Messages are stored past the last queued one, or right before the
+ * first one when jammed. Both ends are reached in constant time.
+ */
+static struct msgslot *queue_put_slot(struct psos_queue *q, u_long flags)
+{
+	u_long n;
+
+	if (flags & Q_JAMMED) {
+		n = q->rdslot ? q->rdslot - 1 : q->nslots - 1;
+		q->rdslot = n;
+	} else {
+		n = q->rdslot + q->msgcount;
+		if (n >= q->nslots)
+			n -= q->nslots;
+	}
+
+	q->msgcount++;
+
+	return queue_slot(q, n);
+}
+
+static struct msgslot *queue_get_slot(struct psos_queue *q)
+{
+	struct msgslot *msg = queue_slot(q, q->rdslot);
+
+	if (++q->rdslot == q->nslots)
+		q->rdslot = 0;
+
+	q->msgcount--;
+
+	return msg;
+}
+
 static void queue_finalize(struct syncobj *sobj)
 {
 	struct psos_queue *q = container_of(sobj, struct psos_queue, sobj);
+
+	if (q->nslots)
+		xnfree(__mptr(q->slots));
 	xnfree(q);
 }
 fnref_register(libpsos, queue_finalize);
@@ -86,6 +166,8 @@ static u_long __q_create(const char *name, u_long count,
 	int sobj_flags = 0;
 	int ret = SUCCESS;
 	char short_name[5];
+	void *slots = NULL;
+	size_t slotsz;
 
 	CANCEL_DEFER(svc);
 
@@ -95,6 +177,24 @@ static u_long __q_create(const char *name, u_long count,
 		goto out;
 	}
 
+	/*
+	 * Preallocate the message slots from the main heap, so that
+	 * the send and receive paths never have to.
+	 */
+	slotsz = sizeof(struct msgslot) +
+		__align_to((size_t)maxlen, sizeof(struct msgslot));
+	if (count > 0) {
+		if (count > SIZE_MAX / slotsz) {
+			ret = ERR_NOMGB;
+			goto fail_slots;
+		}
+		slots = xnmalloc(count * slotsz);
+		if (slots == NULL) {
+			ret = ERR_NOMGB;
+			goto fail_slots;
+		}
+	}
+
 	if (name == NULL || *name == '\0')
 		sprintf(q->name, "q%lu", ++anon_qids);
 	else {
@@ -108,6 +208,10 @@ static u_long __q_create(const char *name, u_long count,
 	q->flags = flags;
 	q->maxmsg = (flags & Q_LIMIT) ? count : 0;
 	q->maxlen = maxlen;
+	q->slots = __moff_nullable(slots);
+	q->slotsz = slotsz;
+	q->nslots = count;
+	q->rdslot = 0;
 	ret = syncobj_init(&q->sobj, CLOCK_COPPERPLATE, sobj_flags,
 			   fnref_put(libpsos, queue_finalize));
 	if (ret) {
@@ -115,7 +219,6 @@ static u_long __q_create(const char *name, u_long count,
 		goto fail_syncinit;
 	}
 
-	list_init(&q->msg_list);
 	q->msgcount = 0;
 	q->magic = queue_magic;
 	*qid_r = mainheap_ref(q, u_long);
@@ -133,6 +236,9 @@ static u_long __q_create(const char *name, u_long count,
 fail_register:
 	syncobj_uninit(&q->sobj);
 fail_syncinit:
+	if (slots)
+		xnfree(slots);
+fail_slots:
 	xnfree(q);
 out:
 	CANCEL_RESTORE(svc);
@@ -155,7 +261,6 @@ u_long q_vcreate(const char *name, u_long flags,
 static u_long __q_delete(u_long qid, u_long flags)
 {
 	struct syncstate syns;
-	struct msgholder *msg;
 	struct psos_queue *q;
 	struct service svc;
 	int ret, emptyq;
@@ -176,14 +281,8 @@ static u_long __q_delete(u_long qid, u_long flags)
 
 	}
 
-	emptyq = list_empty(&q->msg_list);
-	if (!emptyq) {
-		do {
-			msg = list_pop_entry(&q->msg_list,
-					     struct msgholder, link);
-			xnfree(msg);
-		} while (!list_empty(&q->msg_list));
-	}
+	/* Pending messages go away with the slot ring. */
+	emptyq = q->msgcount == 0;
 
 	cluster_delobj(&psos_queue_table, &q->cobj);
 	q->magic = ~queue_magic; /* Prevent further reference. */
@@ -248,7 +347,7 @@ static u_long __q_send_inner(struct psos_queue *q, unsigned long flags,
 {
 	struct psos_queue_wait *wait;
 	struct threadobj *thobj;
-	struct msgholder *msg;
+	struct msgslot *msg;
 	u_long maxbytes;
 
 	thobj = syncobj_peek_grant(&q->sobj);
@@ -267,27 +366,19 @@ static u_long __q_send_inner(struct psos_queue *q, unsigned long flags,
 	if ((q->flags & Q_LIMIT) && q->msgcount >= q->maxmsg)
 		return ERR_QFULL;
 
-	msg = xnmalloc(bytes + sizeof(*msg));
-	if (msg == NULL)
+	if (q->msgcount >= q->nslots && queue_grow(q))
 		return ERR_NOMGB;
 
-	q->msgcount++;
+	msg = queue_put_slot(q, flags);
 	msg->size = bytes;
-	holder_init(&msg->link);
-
 	if (bytes > 0)
 		memcpy(msg + 1, buffer, bytes);
 
-	if (flags & Q_JAMMED)
-		list_prepend(&msg->link, &q->msg_list);
-	else
-		list_append(&msg->link, &q->msg_list);
-
 	if (thobj) {
 		/*
 		 * We could not copy the message directly to the
 		 * remote buffer, tell the thread to pull it from the
-		 * pool.
+		 * ring.
 		 */
 		wait = threadobj_get_wait(thobj);
 		wait->size = -1UL;
@@ -416,7 +507,7 @@ static u_long __q_receive(u_long qid, u_long flags, u_long timeout,
 {
 	struct psos_queue_wait *wait = NULL;
 	struct timespec ts, *timespec;
-	struct msgholder *msg = NULL;
+	struct msgslot *msg;
 	struct syncstate syns;
 	unsigned long nbytes;
 	struct psos_queue *q;
@@ -439,15 +530,13 @@ static u_long __q_receive(u_long qid, u_long flags, u_long timeout,
 		goto fail;
 	}
 retry:
-	if (!list_empty(&q->msg_list)) {
-		q->msgcount--;
-		msg = list_pop_entry(&q->msg_list, struct msgholder, link);
+	if (q->msgcount > 0) {
+		msg = queue_get_slot(q);
 		nbytes = msg->size;
 		if (nbytes > msglen)
 			nbytes = msglen;
 		if (nbytes > 0)
 			memcpy(buffer, msg + 1, nbytes);
-		xnfree(msg);
 		goto done;
 	}
 
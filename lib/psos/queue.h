@@ -36,8 +36,16 @@ struct psos_queue {
 	u_long maxlen;
 	u_long msgcount;
 
+	/*
+	 * Ring of nslots message slots, preallocated from the count
+	 * given at creation. Only unlimited queues may grow it.
+	 */
+	dref_type(void *) slots;
+	size_t slotsz;
+	u_long nslots;
+	u_long rdslot;
+
 	struct syncobj sobj;
-	struct listobj msg_list;
 	struct clusterobj cobj;
 };
 
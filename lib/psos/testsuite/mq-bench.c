@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <boilerplate/tunables.h>
+#include <copperplate/traceobj.h>
+#include <psos/psos.h>
+
+/*
+ * Measure the cost of queuing messages to and dequeuing them from a
+ * bounded variable-size queue nobody waits on, checking the
+ * FIFO/urgent ordering while the ring wraps around. Then check that
+ * an unbounded queue keeps the message order as it grows past its
+ * initial count.
+ */
+
+static struct traceobj trobj;
+
+#define NR_MSGS		64
+#define MSG_LEN		64
+#define NR_ROUNDS	2000
+#define NR_UNLIMITED	1000
+
+struct bench_stats {
+	unsigned long count;
+	unsigned long long total;
+	unsigned long long max;
+};
+
+static struct bench_stats send_stats, recv_stats;
+
+static u_long tid;
+
+static inline unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void account(struct bench_stats *stats, unsigned long long t0)
+{
+	unsigned long long dt = now() - t0;
+
+	stats->total += dt;
+	if (dt > stats->max)
+		stats->max = dt;
+	stats->count++;
+}
+
+static void root_task(u_long a0, u_long a1, u_long a2, u_long a3)
+{
+	u_long msg[MSG_LEN / sizeof(u_long)], msglen, qid;
+	int expected[NR_MSGS * 2], head, tail;
+	int ret, n, batch, round;
+	unsigned long long t0, start;
+
+	traceobj_enter(&trobj);
+
+	ret = q_vcreate("VQ", Q_LIMIT, NR_MSGS, MSG_LEN, &qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	start = now();
+
+	for (round = 0; round < NR_ROUNDS; round++) {
+		/* Vary the batch size so that the ring wraps around. */
+		batch = round % NR_MSGS + 1;
+		head = tail = NR_MSGS;
+		for (n = 0; n < batch; n++) {
+			msg[0] = n;
+			t0 = now();
+			if (n % 4 == 3) {
+				ret = q_vurgent(qid, msg, sizeof(msg));
+				expected[--head] = n;
+			} else {
+				ret = q_vsend(qid, msg, sizeof(msg));
+				expected[tail++] = n;
+			}
+			account(&send_stats, t0);
+			traceobj_assert(&trobj, ret == SUCCESS);
+		}
+
+		if (batch == NR_MSGS) {
+			ret = q_vsend(qid, msg, sizeof(msg));
+			traceobj_assert(&trobj, ret == ERR_QFULL);
+		}
+
+		for (n = 0; n < batch; n++) {
+			t0 = now();
+			ret = q_vreceive(qid, Q_NOWAIT, 0, msg, sizeof(msg), &msglen);
+			account(&recv_stats, t0);
+			traceobj_assert(&trobj, ret == SUCCESS);
+			traceobj_assert(&trobj, msglen == sizeof(msg));
+			traceobj_assert(&trobj, msg[0] == expected[head + n]);
+		}
+
+		ret = q_vreceive(qid, Q_NOWAIT, 0, msg, sizeof(msg), &msglen);
+		traceobj_assert(&trobj, ret == ERR_NOMSG);
+	}
+
+	if (get_runtime_tunable(verbosity_level) > 0)
+		printf("mq-bench: %lu msgs, %llu msgs/s, "
+		       "send avg %llu ns max %llu ns, "
+		       "receive avg %llu ns max %llu ns\n",
+		       send_stats.count,
+		       send_stats.count * 1000000000ULL / (now() - start),
+		       send_stats.total / send_stats.count, send_stats.max,
+		       recv_stats.total / recv_stats.count, recv_stats.max);
+
+	ret = q_vdelete(qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_create("UQ", 4, Q_NOLIMIT, &qid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	/* Receive a few messages early, so that the ring wraps first. */
+	for (n = 0; n < NR_UNLIMITED; n++) {
+		msg[0] = n;
+		ret = q_send(qid, msg);
+		traceobj_assert(&trobj, ret == SUCCESS);
+		if (n == 2) {
+			ret = q_receive(qid, Q_NOWAIT, 0, msg);
+			traceobj_assert(&trobj, ret == SUCCESS && msg[0] == 0);
+			ret = q_receive(qid, Q_NOWAIT, 0, msg);
+			traceobj_assert(&trobj, ret == SUCCESS && msg[0] == 1);
+		}
+	}
+
+	for (n = 2; n < NR_UNLIMITED; n++) {
+		ret = q_receive(qid, Q_NOWAIT, 0, msg);
+		traceobj_assert(&trobj, ret == SUCCESS && msg[0] == n);
+	}
+
+	ret = q_send(qid, msg);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = q_delete(qid);
+	traceobj_assert(&trobj, ret == ERR_MATQDEL);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	u_long args[] = { 1, 2, 3, 4 };
+	int ret;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	ret = t_create("root", 1, 0, 0, 0, &tid);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	ret = t_start(tid, 0, root_task, args);
+	traceobj_assert(&trobj, ret == SUCCESS);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
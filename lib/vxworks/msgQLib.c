@@ -17,10 +17,12 @@
  */
 
 #include <stdio.h>
+#include <stdint.h>
 #include <errno.h>
 #include <stdlib.h>
 #include <assert.h>
 #include <memory.h>
+#include <boilerplate/compiler.h>
 #include <copperplate/heapobj.h>
 #include <copperplate/threadobj.h>
 #include <vxworks/errnoLib.h>
@@ -38,9 +40,8 @@
 
 #define mq_magic	0x4a5b6c7d
 
-struct msgholder {
-	int size;
-	struct holder link;
+struct msgslot {
+	size_t size;
 	/* Payload data follows. */
 };
 
@@ -55,10 +56,51 @@ static struct wind_mq *find_mq_from_id(MSG_Q_ID qid)
 	return mq;
 }
 
+static inline struct msgslot *mq_slot(struct wind_mq *mq, int n)
+{
+	return __mptr(mq->slots) + n * mq->slotsz;
+}
+
+/*
+ * Messages live in a ring of slots indexed from rdslot, which holds
+ * the oldest one. Normal messages are stored past the last queued
+ * one, urgent ones right before the first, so that both insertions
+ * and removals run in constant time without calling the allocator.
+ */
+static struct msgslot *mq_put_slot(struct wind_mq *mq, int prio)
+{
+	int n;
+
+	if (prio == MSG_PRI_NORMAL) {
+		n = mq->rdslot + mq->msgcount;
+		if (n >= mq->maxmsg)
+			n -= mq->maxmsg;
+	} else {
+		n = mq->rdslot ? mq->rdslot - 1 : mq->maxmsg - 1;
+		mq->rdslot = n;
+	}
+
+	mq->msgcount++;
+
+	return mq_slot(mq, n);
+}
+
+static struct msgslot *mq_get_slot(struct wind_mq *mq)
+{
+	struct msgslot *msg = mq_slot(mq, mq->rdslot);
+
+	if (++mq->rdslot == mq->maxmsg)
+		mq->rdslot = 0;
+
+	mq->msgcount--;
+
+	return msg;
+}
+
 static void mq_finalize(struct syncobj *sobj)
 {
 	struct wind_mq *mq = container_of(sobj, struct wind_mq, sobj);
-	heapobj_destroy(&mq->pool);
+	xnfree(__mptr(mq->slots));
 	xnfree(mq);
 }
 fnref_register(libvxworks, mq_finalize);
@@ -68,6 +110,8 @@ MSG_Q_ID msgQCreate(int maxMsgs, int maxMsgLength, int options)
 	int sobj_flags = 0, ret;
 	struct wind_mq *mq;
 	struct service svc;
+	size_t slotsz;
+	void *slots;
 
 	if (threadobj_irq_p()) {
 		errno = S_intLib_NOT_ISR_CALLABLE;
@@ -91,13 +135,16 @@ MSG_Q_ID msgQCreate(int maxMsgs, int maxMsgLength, int options)
 		goto fail_cballoc;
 
 	/*
-	 * The message pool must come from the main heap because of
-	 * mq->msg_list (this queue head and messages from the pool
-	 * must share the same allocation base). Create the heap
-	 * object accordingly.
+	 * The message slots must come from the main heap, since the
+	 * queue descriptor refers to them by offset.
 	 */
-	if (heapobj_init_array(&mq->pool, NULL, maxMsgLength +
-			       sizeof(struct msgholder), maxMsgs))
+	slotsz = sizeof(struct msgslot) +
+		__align_to((size_t)maxMsgLength, sizeof(struct msgslot));
+	if ((size_t)maxMsgs > SIZE_MAX / slotsz)
+		goto fail_bufalloc;
+
+	slots = xnmalloc(maxMsgs * slotsz);
+	if (slots == NULL)
 		goto fail_bufalloc;
 
 	if (options & MSG_Q_PRIORITY)
@@ -112,7 +159,9 @@ MSG_Q_ID msgQCreate(int maxMsgs, int maxMsgLength, int options)
 	mq->maxmsg = maxMsgs;
 	mq->msgsize = maxMsgLength;
 	mq->msgcount = 0;
-	list_init(&mq->msg_list);
+	mq->slots = __moff(slots);
+	mq->slotsz = slotsz;
+	mq->rdslot = 0;
 
 	mq->magic = mq_magic;
 
@@ -121,7 +170,7 @@ MSG_Q_ID msgQCreate(int maxMsgs, int maxMsgLength, int options)
 	return mainheap_ref(mq, MSG_Q_ID);
 
 fail_syncinit:
-	heapobj_destroy(&mq->pool);
+	xnfree(slots);
 fail_bufalloc:
 	xnfree(mq);
 fail_cballoc:
@@ -168,8 +217,8 @@ int msgQReceive(MSG_Q_ID msgQId, char *buffer, UINT maxNBytes, int timeout)
 {
 	struct wind_queue_wait *wait = NULL;
 	struct timespec ts, *timespec;
-	struct msgholder *msg = NULL;
 	UINT nbytes = (UINT)ERROR;
+	struct msgslot *msg;
 	struct syncstate syns;
 	struct wind_mq *mq;
 	struct service svc;
@@ -194,15 +243,13 @@ int msgQReceive(MSG_Q_ID msgQId, char *buffer, UINT maxNBytes, int timeout)
 	}
 
 retry:
-	if (!list_empty(&mq->msg_list)) {
-		mq->msgcount--;
-		msg = list_pop_entry(&mq->msg_list, struct msgholder, link);
+	if (mq->msgcount > 0) {
+		msg = mq_get_slot(mq);
 		nbytes = msg->size;
 		if (nbytes > maxNBytes)
 			nbytes = maxNBytes;
 		if (nbytes > 0)
 			memcpy(buffer, msg + 1, nbytes);
-		heapobj_free(&mq->pool, msg);
 		syncobj_drain(&mq->sobj);
 		goto done;
 	}
@@ -252,7 +299,7 @@ STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
 	struct timespec ts, *timespec;
 	struct wind_queue_wait *wait;
 	struct threadobj *thobj;
-	struct msgholder *msg;
+	struct msgslot *msg;
 	struct syncstate syns;
 	struct wind_mq *mq;
 	struct service svc;
@@ -324,31 +371,17 @@ STATUS msgQSend(MSG_Q_ID msgQId, const char *buffer, UINT bytes,
 	} while (mq->msgcount >= mq->maxmsg);
 
 enqueue:
-	msg = heapobj_alloc(&mq->pool, bytes + sizeof(*msg));
-	if (msg == NULL) {
-		errno = S_memLib_NOT_ENOUGH_MEMORY;
-		ret = ERROR;
-		goto fail;
-	}
-
-	mq->msgcount++;
+	msg = mq_put_slot(mq, prio);
 	assert(mq->msgcount <= mq->maxmsg); /* Paranoid. */
 	msg->size = bytes;
-	holder_init(&msg->link);
-
 	if (bytes > 0)
 		memcpy(msg + 1, buffer, bytes);
 
-	if (prio == MSG_PRI_NORMAL)
-		list_append(&msg->link, &mq->msg_list);
-	else
-		list_prepend(&msg->link, &mq->msg_list);
-
 	if (thobj) {
 		/*
 		 * We could not copy the message directly to the
 		 * remote buffer, tell the thread to pull it from the
-		 * pool.
+		 * ring.
 		 */
 		wait = threadobj_get_wait(thobj);
 		wait->size = -1UL;
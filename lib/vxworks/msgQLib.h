@@ -32,9 +32,12 @@ struct wind_mq {
 	UINT msgsize;
 	int msgcount;
 
-	struct heapobj pool;
+	/* Ring of maxmsg preallocated message slots. */
+	dref_type(void *) slots;
+	size_t slotsz;
+	int rdslot;
+
 	struct syncobj sobj;
-	struct listobj msg_list;
 };
 
 struct wind_queue_wait {
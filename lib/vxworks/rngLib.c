@@ -17,6 +17,8 @@
 */
 
 #include <stdlib.h>
+#include <string.h>
+#include <boilerplate/atomic.h>
 #include <boilerplate/lock.h>
 #include <copperplate/heapobj.h>
 #include <vxworks/errnoLib.h>
@@ -35,6 +37,21 @@ static struct wind_ring *find_ring_from_id(RING_ID rid)
 	return ring;
 }
 
+static inline unsigned int ring_span(struct wind_ring *ring)
+{
+	return ring->bufSize + 1;
+}
+
+static inline unsigned int ring_used(struct wind_ring *ring,
+				     unsigned int readPos,
+				     unsigned int writePos)
+{
+	if (writePos >= readPos)
+		return writePos - readPos;
+
+	return ring_span(ring) - readPos + writePos;
+}
+
 RING_ID rngCreate(int nbytes)
 {
 	struct wind_ring *ring;
@@ -94,45 +111,76 @@ void rngFlush(RING_ID rid)
 int rngBufGet(RING_ID rid, char *buffer, int maxbytes)
 {
 	struct wind_ring *ring = find_ring_from_id(rid);
-	unsigned int savedWritePos;
-	int j, bytesRead = 0;
+	unsigned int readPos, writePos, nbytes, head;
 
 	if (ring == NULL)
 		return ERROR;
 
-	savedWritePos = ring->writePos;
+	if (maxbytes <= 0)
+		return 0;
 
-	for (j = 0; j < maxbytes; j++) {
-		if ((ring->readPos) % (ring->bufSize + 1) == savedWritePos)
-			break;
-		buffer[j] = ring->buffer[ring->readPos];
-		++bytesRead;
-		ring->readPos = (ring->readPos + 1) % (ring->bufSize + 1);
-	}
+	readPos = ring->readPos;
+	/* Read the data only after the index covering it. */
+	writePos = smp_load_acquire(&ring->writePos);
+
+	nbytes = ring_used(ring, readPos, writePos);
+	if (nbytes > (unsigned int)maxbytes)
+		nbytes = maxbytes;
+
+	/* At most two segments, before and after the wrap point. */
+	head = ring_span(ring) - readPos;
+	if (head > nbytes)
+		head = nbytes;
 
-	return bytesRead;
+	memcpy(buffer, ring->buffer + readPos, head);
+	if (nbytes > head)
+		memcpy(buffer + head, ring->buffer, nbytes - head);
+
+	readPos += nbytes;
+	if (readPos >= ring_span(ring))
+		readPos -= ring_span(ring);
+
+	/* Release the space only once we are done reading it. */
+	smp_store_release(&ring->readPos, readPos);
+
+	return nbytes;
 }
 
 int rngBufPut(RING_ID rid, char *buffer, int nbytes)
 {
 	struct wind_ring *ring = find_ring_from_id(rid);
-	unsigned int savedReadPos;
-	int j, bytesWritten = 0;
+	unsigned int readPos, writePos, room, head;
 
 	if (ring == NULL)
 		return ERROR;
 
-	savedReadPos = ring->readPos;
+	if (nbytes <= 0)
+		return 0;
 
-	for (j = 0; j < nbytes; j++) {
-		if ((ring->writePos + 1) % (ring->bufSize + 1) == savedReadPos)
-			break;
-		ring->buffer[ring->writePos] = buffer[j];
-		++bytesWritten;
-		ring->writePos = (ring->writePos + 1) % (ring->bufSize + 1);
-	}
+	writePos = ring->writePos;
+	/* Do not overwrite data before the consumer is done with it. */
+	readPos = smp_load_acquire(&ring->readPos);
+
+	room = ring->bufSize - ring_used(ring, readPos, writePos);
+	if (room > (unsigned int)nbytes)
+		room = nbytes;
+
+	head = ring_span(ring) - writePos;
+	if (head > room)
+		head = room;
+
+	memcpy(ring->buffer + writePos, buffer, head);
+	if (room > head)
+		memcpy(ring->buffer, buffer + head, room - head);
+
+	writePos += room;
+	if (writePos >= ring_span(ring))
+		writePos -= ring_span(ring);
+
+	/* Publish the data before the index covering it. */
+	smp_store_release(&ring->writePos, writePos);
 
-	return bytesWritten;
+	return room;
 }
 
 BOOL rngIsEmpty(RING_ID rid)
@@ -162,8 +210,8 @@ int rngFreeBytes(RING_ID rid)
 	if (ring == NULL)
 		return ERROR;
 
-	return ((ring->bufSize -
-		 (ring->writePos - ring->readPos)) % (ring->bufSize + 1));
+	return ring->bufSize - ring_used(ring, ACCESS_ONCE(ring->readPos),
+					 ACCESS_ONCE(ring->writePos));
 }
 
 int rngNBytes(RING_ID rid)
@@ -182,7 +230,7 @@ void rngPutAhead(RING_ID rid, char byte, int offset)
 	int where;
 
 	if (ring) {
-		where = (ring->writePos + offset) % (ring->bufSize + 1);
+		where = (ring->writePos + offset) % ring_span(ring);
 		ring->buffer[where] = byte;
 	}
 }
@@ -190,9 +238,11 @@ void rngPutAhead(RING_ID rid, char byte, int offset)
 void rngMoveAhead(RING_ID rid, int n)
 {
 	struct wind_ring *ring = find_ring_from_id(rid);
+	unsigned int writePos;
 
 	if (ring) {
-		ring->writePos += n;
-		ring->writePos %= (ring->bufSize + 1);
+		writePos = (ring->writePos + n) % ring_span(ring);
+		/* Publish the bytes stored by rngPutAhead(). */
+		smp_store_release(&ring->writePos, writePos);
 	}
 }
@@ -21,6 +21,15 @@
 
 #include <vxworks/rngLib.h>
 
+/*
+ * The ring buffer spans bufSize + 1 bytes, one of which always
+ * remains unused so that a full ring can be told from an empty
+ * one. The producer only updates writePos, the consumer only
+ * updates readPos: this is enough for a single producer and a single
+ * consumer to share a ring without locking, on any CPU and from any
+ * process when the ring lives in the shared heap, provided each side
+ * publishes its index only after the data it covers has been copied.
+ */
 struct wind_ring {
 	unsigned int magic;
 	unsigned int bufSize;
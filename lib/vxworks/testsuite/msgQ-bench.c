@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <boilerplate/tunables.h>
+#include <copperplate/traceobj.h>
+#include <vxworks/errnoLib.h>
+#include <vxworks/taskLib.h>
+#include <vxworks/msgQLib.h>
+
+/*
+ * Measure the cost of queuing messages to and dequeuing them from a
+ * message queue nobody waits on, checking the FIFO/urgent ordering
+ * while the ring wraps around.
+ */
+
+static struct traceobj trobj;
+
+#define NR_MSGS		64
+#define MSG_LEN		64
+#define NR_ROUNDS	2000
+
+struct bench_stats {
+	unsigned long count;
+	unsigned long long total;
+	unsigned long long max;
+};
+
+static struct bench_stats send_stats, recv_stats;
+
+static inline unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void account(struct bench_stats *stats, unsigned long long t0)
+{
+	unsigned long long dt = now() - t0;
+
+	stats->total += dt;
+	if (dt > stats->max)
+		stats->max = dt;
+	stats->count++;
+}
+
+static void rootTask(long arg, ...)
+{
+	int ret, n, batch, round, msg[MSG_LEN / sizeof(int)];
+	int expected[NR_MSGS * 2], head, tail;
+	unsigned long long t0, start;
+	MSG_Q_ID qid;
+
+	traceobj_enter(&trobj);
+
+	qid = msgQCreate(NR_MSGS, MSG_LEN, MSG_Q_FIFO);
+	traceobj_assert(&trobj, qid != 0);
+
+	start = now();
+
+	for (round = 0; round < NR_ROUNDS; round++) {
+		/* Vary the batch size so that the ring wraps around. */
+		batch = round % NR_MSGS + 1;
+		head = tail = NR_MSGS;
+		for (n = 0; n < batch; n++) {
+			msg[0] = n;
+			t0 = now();
+			if (n % 4 == 3) {
+				ret = msgQSend(qid, (char *)msg, sizeof(msg),
+					       NO_WAIT, MSG_PRI_URGENT);
+				expected[--head] = n;
+			} else {
+				ret = msgQSend(qid, (char *)msg, sizeof(msg),
+					       NO_WAIT, MSG_PRI_NORMAL);
+				expected[tail++] = n;
+			}
+			account(&send_stats, t0);
+			traceobj_assert(&trobj, ret == OK);
+		}
+
+		ret = msgQNumMsgs(qid);
+		traceobj_assert(&trobj, ret == batch);
+
+		if (batch == NR_MSGS) {
+			ret = msgQSend(qid, (char *)msg, sizeof(msg),
+				       NO_WAIT, MSG_PRI_NORMAL);
+			traceobj_assert(&trobj, ret == ERROR &&
+					errno == S_objLib_OBJ_UNAVAILABLE);
+		}
+
+		for (n = 0; n < batch; n++) {
+			t0 = now();
+			ret = msgQReceive(qid, (char *)msg, sizeof(msg), NO_WAIT);
+			account(&recv_stats, t0);
+			traceobj_assert(&trobj, ret == sizeof(msg));
+			traceobj_assert(&trobj, msg[0] == expected[head + n]);
+		}
+
+		ret = msgQReceive(qid, (char *)msg, sizeof(msg), NO_WAIT);
+		traceobj_assert(&trobj, ret == ERROR &&
+				errno == S_objLib_OBJ_UNAVAILABLE);
+	}
+
+	if (get_runtime_tunable(verbosity_level) > 0)
+		printf("msgQ-bench: %lu msgs, %llu msgs/s, "
+		       "send avg %llu ns max %llu ns, "
+		       "receive avg %llu ns max %llu ns\n",
+		       send_stats.count,
+		       send_stats.count * 1000000000ULL / (now() - start),
+		       send_stats.total / send_stats.count, send_stats.max,
+		       recv_stats.total / recv_stats.count, recv_stats.max);
+
+	ret = msgQDelete(qid);
+	traceobj_assert(&trobj, ret == OK);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	TASK_ID tid;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	tid = taskSpawn("rootTask", 50,	0, 0, rootTask,
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	traceobj_assert(&trobj, tid != ERROR);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
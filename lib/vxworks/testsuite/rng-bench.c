@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <boilerplate/tunables.h>
+#include <copperplate/traceobj.h>
+#include <vxworks/errnoLib.h>
+#include <vxworks/taskLib.h>
+#include <vxworks/semLib.h>
+#include <vxworks/rngLib.h>
+
+/*
+ * Stream data through a ring buffer from the root task to a consumer
+ * task for various chunk sizes, checking the byte stream on the
+ * receiving end. Unless both tasks are pinned to the same CPU, the
+ * producer and consumer run concurrently.
+ */
+
+static struct traceobj trobj;
+
+#define RING_SIZE	16384
+#define TRANSFER_SIZE	(4 * 1024 * 1024)
+#define MAX_CHUNK	4096
+#define PATTERN_SIZE	256
+
+static const int chunk_sizes[] = { 1, 16, 64, 256, 1024, 4096 };
+
+static unsigned char pattern[PATTERN_SIZE + MAX_CHUNK];
+
+static RING_ID rng;
+
+static SEM_ID done;
+
+static int chunk_size;
+
+static inline unsigned long long now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void consumerTask(long arg, ...)
+{
+	char buffer[MAX_CHUNK];
+	int received = 0, ret;
+
+	traceobj_enter(&trobj);
+
+	while (received < TRANSFER_SIZE) {
+		ret = rngBufGet(rng, buffer, chunk_size);
+		if (ret == 0) {
+			taskDelay(0);
+			continue;
+		}
+		traceobj_assert(&trobj, ret > 0 && ret <= chunk_size);
+		traceobj_assert(&trobj, memcmp(buffer,
+					       pattern + received % PATTERN_SIZE,
+					       ret) == 0);
+		received += ret;
+	}
+
+	traceobj_assert(&trobj, rngIsEmpty(rng));
+
+	semGive(done);
+
+	traceobj_exit(&trobj);
+}
+
+static void rootTask(long arg, ...)
+{
+	unsigned long long start, elapsed;
+	int n, sent, ret, len;
+	TASK_ID tid;
+
+	traceobj_enter(&trobj);
+
+	for (n = 0; n < (int)sizeof(pattern); n++)
+		pattern[n] = n % PATTERN_SIZE;
+
+	rng = rngCreate(RING_SIZE);
+	traceobj_assert(&trobj, rng != 0);
+
+	done = semBCreate(SEM_Q_FIFO, SEM_EMPTY);
+	traceobj_assert(&trobj, done != 0);
+
+	for (n = 0; n < (int)(sizeof(chunk_sizes) / sizeof(chunk_sizes[0])); n++) {
+		chunk_size = chunk_sizes[n];
+		start = now();
+
+		tid = taskSpawn("consumerTask", 50, 0, 0, consumerTask,
+				0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+		traceobj_assert(&trobj, tid != ERROR);
+
+		for (sent = 0; sent < TRANSFER_SIZE; sent += ret) {
+			len = chunk_size;
+			if (len > TRANSFER_SIZE - sent)
+				len = TRANSFER_SIZE - sent;
+			ret = rngBufPut(rng, (char *)pattern + sent % PATTERN_SIZE,
+					len);
+			traceobj_assert(&trobj, ret >= 0 && ret <= len);
+			if (ret == 0)
+				taskDelay(0);
+		}
+
+		ret = semTake(done, WAIT_FOREVER);
+		traceobj_assert(&trobj, ret == OK);
+		elapsed = now() - start;
+
+		if (get_runtime_tunable(verbosity_level) > 0)
+			printf("rng-bench: chunk %4d bytes, %6llu MB/s\n",
+			       chunk_size,
+			       TRANSFER_SIZE * 1000000000ULL / elapsed /
+			       (1024 * 1024));
+	}
+
+	ret = semDelete(done);
+	traceobj_assert(&trobj, ret == OK);
+
+	rngDelete(rng);
+
+	traceobj_exit(&trobj);
+}
+
+int main(int argc, char *const argv[])
+{
+	TASK_ID tid;
+
+	traceobj_init(&trobj, argv[0], 0);
+
+	tid = taskSpawn("rootTask", 50,	0, 0, rootTask,
+			0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	traceobj_assert(&trobj, tid != ERROR);
+
+	traceobj_join(&trobj);
+
+	exit(0);
+}
@@ -39,8 +39,9 @@
 #include <rtdm/testing.h>
 #include <boilerplate/trace.h>
 #include <xenomai/init.h>
+#include "loghist.h"
 
-pthread_t latency_task, display_task;
+pthread_t display_task;
 
 sem_t *display_sem;
 
@@ -51,7 +52,6 @@ sem_t *display_sem;
 #define LOPRIO 0
 
 unsigned max_relaxed;
-int32_t minjitter, maxjitter, avgjitter;
 int32_t gminjitter = TEN_MILLIONS, gmaxjitter = -TEN_MILLIONS, goverrun = 0;
 int64_t gavgjitter = 0;
 
@@ -59,7 +59,6 @@ long long period_ns = 0;
 int test_duration = 0;		/* sec of testing, via -T <sec>, 0 is inf */
 int data_lines = 21;		/* data lines per header line, -l <lines> to change */
 int quiet = 0;			/* suppress printing of RTH, RTD lines when -T given */
-int benchdev = -1;
 int freeze_max = 0;
 int priority = HIPRIO;
 int stop_upon_switch = 0;
@@ -78,7 +77,6 @@ const char *test_mode_names[] = {
 };
 
 time_t test_start, test_end;	/* report test duration */
-int test_loops = 0;		/* outer loop count */
 
 /* Warmup time : in order to avoid spurious cache effects on low-end machines. */
 #define WARMUP_TIME 1
@@ -86,11 +84,49 @@ int test_loops = 0;		/* outer loop count */
 int histogram_size = HISTOGRAM_CELLS;
 int32_t *histogram_avg = NULL, *histogram_max = NULL, *histogram_min = NULL;
 
-char *do_gnuplot = NULL;
+char *do_gnuplot = NULL, *do_json = NULL, *do_csv = NULL;
 int do_histogram = 0, do_stats = 0, finished = 0;
 int bucketsize = 1000;		/* default = 1000ns, -B <size> to override */
 
+/*
+ * Each sampler measures the latency on a single CPU, with its own
+ * task (user mode) or timerbench context (kernel modes), so that
+ * several CPUs can be measured concurrently with -C.
+ */
+struct sampler {
+	int cpu;
+	pthread_t task;
+	int benchdev;
+	int test_loops;		/* outer loop count */
+	unsigned relaxed;
+	int32_t minjitter, maxjitter, avgjitter;
+	int32_t gminjitter, gmaxjitter, goverrun;
+	int64_t gavgjitter;
+	int32_t *histogram_avg, *histogram_max, *histogram_min;
+	struct loghist loghist;
+};
+
+struct sampler *samplers;
+int nr_samplers = 1;
+
+static const struct {
+	const char *name;
+	double percent;
+} percentiles[] = {
+	{ "p50", 50.0 },
+	{ "p90", 90.0 },
+	{ "p99", 99.0 },
+	{ "p99.9", 99.9 },
+	{ "p99.99", 99.99 },
+	{ "p99.999", 99.999 },
+	{ "p99.9999", 99.9999 },
+};
+
+#define for_each_sampler(__s)	\
+	for ((__s) = samplers; (__s) < samplers + nr_samplers; (__s)++)
+
 #define need_histo() (do_histogram || do_stats || do_gnuplot)
+#define need_loghist() (do_json || do_csv || nr_samplers > 1)
 
 static inline void add_histogram(int32_t *histogram, int32_t addval)
 {
@@ -107,15 +143,19 @@ static inline long long diff_ts(struct timespec *left, struct timespec *right)
 
 static void *latency(void *cookie)
 {
-	int err, count, nsamples, warmup = 1;
+	int err, count, nsamples, warmup = 1, loghist = need_loghist();
 	unsigned long long fault_threshold;
 	struct itimerspec timer_conf;
+	struct sampler *s = cookie;
 	struct timespec expected;
 	unsigned old_relaxed = 0;
 	char task_name[16];
 	int tfd;
 
-	snprintf(task_name, sizeof(task_name), "sampling-%d", getpid());
+	if (nr_samplers > 1)
+		snprintf(task_name, sizeof(task_name), "sampling/%d", s->cpu);
+	else
+		snprintf(task_name, sizeof(task_name), "sampling-%d", getpid());
 	err = pthread_setname_np(pthread_self(), task_name);
 	if (err)
 		error(1, err, "pthread_setname_np(latency)");
@@ -155,7 +195,7 @@ static void *latency(void *cookie)
 		uint32_t overrun = 0;
 		int64_t sumj;
 
-		test_loops++;
+		s->test_loops++;
 
 		for (count = sumj = 0; count < nsamples; count++) {
 			unsigned int new_relaxed;
@@ -170,7 +210,7 @@ static void *latency(void *cookie)
 			if (dt > maxj) {
 				if (new_relaxed != old_relaxed
 				    && dt > fault_threshold)
-					max_relaxed +=
+					s->relaxed +=
 						new_relaxed - old_relaxed;
 				maxj = dt;
 			}
@@ -190,38 +230,42 @@ static void *latency(void *cookie)
 				expected.tv_sec++;
 			}
 
-			if (freeze_max && (dt > gmaxjitter)
+			if (freeze_max && (dt > s->gmaxjitter)
 			    && !(finished || warmup)) {
 				xntrace_user_freeze(dt, 0);
-				gmaxjitter = dt;
+				s->gmaxjitter = dt;
 			}
 
-			if (!(finished || warmup) && need_histo())
-				add_histogram(histogram_avg, dt);
+			if (!(finished || warmup)) {
+				if (need_histo())
+					add_histogram(s->histogram_avg, dt);
+				if (loghist)
+					loghist_add(&s->loghist, dt);
+			}
 		}
 
 		if (!warmup) {
 			if (!finished && need_histo()) {
-				add_histogram(histogram_max, maxj);
-				add_histogram(histogram_min, minj);
+				add_histogram(s->histogram_max, maxj);
+				add_histogram(s->histogram_min, minj);
 			}
 
-			minjitter = minj;
-			if (minj < gminjitter)
-				gminjitter = minj;
+			s->minjitter = minj;
+			if (minj < s->gminjitter)
+				s->gminjitter = minj;
 
-			maxjitter = maxj;
-			if (maxj > gmaxjitter)
-				gmaxjitter = maxj;
+			s->maxjitter = maxj;
+			if (maxj > s->gmaxjitter)
+				s->gmaxjitter = maxj;
 
-			avgjitter = sumj / nsamples;
-			gavgjitter += avgjitter;
-			goverrun += overrun;
+			s->avgjitter = sumj / nsamples;
+			s->gavgjitter += s->avgjitter;
+			s->goverrun += overrun;
 			sem_post(display_sem);
 		}
 
-		if (warmup && test_loops == WARMUP_TIME) {
-			test_loops = 0;
+		if (warmup && s->test_loops == WARMUP_TIME) {
+			s->test_loops = 0;
 			warmup = 0;
 		}
 	}
@@ -231,6 +275,7 @@ static void *latency(void *cookie)
 
 static void *display(void *cookie)
 {
+	struct sampler *s;
 	char task_name[16];
 	int err, n = 0;
 	time_t start;
@@ -257,13 +302,17 @@ static void *display(void *cookie)
 		config.period = period_ns;
 		config.priority = priority;
 		config.warmup_loops = WARMUP_TIME;
-		config.histogram_size = need_histo() ? histogram_size : 0;
+		config.histogram_size = need_histo() || need_loghist() ?
+			histogram_size : 0;
 		config.histogram_bucketsize = bucketsize;
 		config.freeze_max = freeze_max;
 
-		err = ioctl(benchdev, RTTST_RTIOC_TMBENCH_START, &config);
-		if (err)
-			error(1, errno, "ioctl(RTTST_RTIOC_TMBENCH_START)");
+		for_each_sampler(s) {
+			err = ioctl(s->benchdev, RTTST_RTIOC_TMBENCH_START,
+				    &config);
+			if (err)
+				error(1, errno, "ioctl(RTTST_RTIOC_TMBENCH_START)");
+		}
 	}
 
 	time(&start);
@@ -277,57 +326,89 @@ static void *display(void *cookie)
 
 	for (;;) {
 		long minj, gminj, maxj, gmaxj, avgj;
-
-		if (test_mode == USER_TASK) {
-			err = sem_wait(display_sem);
-
-			if (err < 0) {
-				if (errno != EIDRM)
-					error(1, errno, "sem_wait()");
-
-				return NULL;
-			}
-
-			/* convert jitters to nanoseconds. */
-			minj = minjitter;
-			gminj = gminjitter;
-			avgj = avgjitter;
-			maxj = maxjitter;
-			gmaxj = gmaxjitter;
-
-		} else {
-			struct rttst_interm_bench_res result;
-
-			err = ioctl(benchdev, RTTST_RTIOC_INTERM_BENCH_RES,
-				&result);
-
-			if (err < 0) {
-				if (errno != EIDRM)
-					error(1, errno,
-					      "ioctl(RTTST_RTIOC_INTERM_BENCH_RES)");
-
-				return NULL;
+		unsigned relaxed;
+		int overrun;
+
+		/*
+		 * Each sampler reports once per second; the RTD line
+		 * shows the min of mins, the mean of averages and the
+		 * max of maxes over all of them.
+		 */
+		for_each_sampler(s) {
+			if (test_mode == USER_TASK) {
+				err = sem_wait(display_sem);
+
+				if (err < 0) {
+					if (errno != EIDRM)
+						error(1, errno, "sem_wait()");
+
+					return NULL;
+				}
+			} else {
+				struct rttst_interm_bench_res result;
+
+				err = ioctl(s->benchdev,
+					    RTTST_RTIOC_INTERM_BENCH_RES, &result);
+
+				if (err < 0) {
+					if (errno != EIDRM)
+						error(1, errno,
+						      "ioctl(RTTST_RTIOC_INTERM_BENCH_RES)");
+
+					return NULL;
+				}
+
+				s->minjitter = result.last.min;
+				s->gminjitter = result.overall.min;
+				s->avgjitter = result.last.avg;
+				s->maxjitter = result.last.max;
+				s->gmaxjitter = result.overall.max;
+				s->goverrun = result.overall.overruns;
 			}
+		}
 
-			minj = result.last.min;
-			gminj = result.overall.min;
-			avgj = result.last.avg;
-			maxj = result.last.max;
-			gmaxj = result.overall.max;
-			goverrun = result.overall.overruns;
+		minj = gminj = TEN_MILLIONS;
+		maxj = gmaxj = -TEN_MILLIONS;
+		avgj = 0;
+		overrun = 0;
+		relaxed = 0;
+
+		for_each_sampler(s) {
+			if (s->minjitter < minj)
+				minj = s->minjitter;
+			if (s->gminjitter < gminj)
+				gminj = s->gminjitter;
+			if (s->maxjitter > maxj)
+				maxj = s->maxjitter;
+			if (s->gmaxjitter > gmaxj)
+				gmaxj = s->gmaxjitter;
+			avgj += s->avgjitter;
+			overrun += s->goverrun;
+			relaxed += s->relaxed;
 		}
 
+		avgj /= nr_samplers;
+
 		if (!quiet) {
 			if (data_lines && (n++ % data_lines) == 0) {
 				time_t now, dt;
 				time(&now);
 				dt = now - start - WARMUP_TIME;
-				printf
-				    ("RTT|  %.2ld:%.2ld:%.2ld  (%s, %Ld us period, "
-				     "priority %d)\n", dt / 3600,
-				     (dt / 60) % 60, dt % 60,
-				     test_mode_names[test_mode],
-				     period_ns / 1000, priority);
+				if (nr_samplers > 1)
+					printf
+					    ("RTT|  %.2ld:%.2ld:%.2ld  (%s, %Ld us period, "
+					     "priority %d, %d CPUs)\n", dt / 3600,
+					     (dt / 60) % 60, dt % 60,
+					     test_mode_names[test_mode],
+					     period_ns / 1000, priority,
+					     nr_samplers);
+				else
+					printf
+					    ("RTT|  %.2ld:%.2ld:%.2ld  (%s, %Ld us period, "
+					     "priority %d)\n", dt / 3600,
+					     (dt / 60) % 60, dt % 60,
+					     test_mode_names[test_mode],
+					     period_ns / 1000, priority);
 				printf("RTH|%11s|%11s|%11s|%8s|%6s|%11s|%11s\n",
 				       "----lat min", "----lat avg",
 				       "----lat max", "-overrun", "---msw",
@@ -337,8 +418,8 @@ static void *display(void *cookie)
 			       (double)minj / 1000,
 			       (double)avgj / 1000,
 			       (double)maxj / 1000,
-			       goverrun,
-			       max_relaxed,
+			       overrun,
+			       relaxed,
 			       (double)gminj / 1000, (double)gmaxj / 1000);
 		}
 	}
@@ -477,10 +558,183 @@ static void dump_hist_stats(time_t duration)
 		dump_histo_gnuplot(histogram_avg, duration);
 }
 
+static FILE *open_output(const char *path)
+{
+	if (strcmp(path, "-") == 0)
+		return stdout;
+
+	return fopen(path, "w");
+}
+
+static void close_output(FILE *ofp)
+{
+	if (ofp != stdout)
+		fclose(ofp);
+}
+
+/*
+ * The non-empty cells of a log-linear histogram are dumped along
+ * with the percentiles, so that results from several runs or
+ * machines can be merged by summing up the counts per cell index.
+ * Min and max are taken from the histogram as well, since it also
+ * accounts for the samples of the last, incomplete second.
+ */
+static void dump_json_entry(FILE *ofp, const char *cpu, struct loghist *h,
+			    int32_t avg, int overruns)
+{
+	const char *sep = "";
+	int n;
+
+	fprintf(ofp, "\t\t{\n\t\t\t\"cpu\": %s,\n", cpu);
+	fprintf(ofp, "\t\t\t\"samples\": %llu,\n",
+		(unsigned long long)h->count);
+	fprintf(ofp, "\t\t\t\"min\": %.3f,\n", (double)h->min / 1000);
+	fprintf(ofp, "\t\t\t\"avg\": %.3f,\n", (double)avg / 1000);
+	fprintf(ofp, "\t\t\t\"max\": %.3f,\n", (double)h->max / 1000);
+	fprintf(ofp, "\t\t\t\"overruns\": %d,\n", overruns);
+	fprintf(ofp, "\t\t\t\"percentiles\": {");
+
+	for (n = 0; n < (int)(sizeof(percentiles) / sizeof(percentiles[0])); n++) {
+		fprintf(ofp, "%s\n\t\t\t\t\"%s\": %.3f", sep,
+			percentiles[n].name,
+			(double)loghist_percentile(h, percentiles[n].percent) / 1000);
+		sep = ",";
+	}
+
+	fprintf(ofp, "\n\t\t\t},\n\t\t\t\"cells\": [");
+
+	for (n = 0, sep = ""; n < LOGHIST_CELLS; n++) {
+		if (h->cells[n] == 0)
+			continue;
+		fprintf(ofp, "%s[%d, %llu]", sep, n,
+			(unsigned long long)h->cells[n]);
+		sep = ", ";
+	}
+
+	fprintf(ofp, "]\n\t\t}");
+}
+
+static void dump_json(struct loghist *all, time_t duration)
+{
+	struct sampler *s;
+	char cpu[16];
+	FILE *ofp;
+
+	ofp = open_output(do_json);
+	if (ofp == NULL)
+		return;
+
+	fprintf(ofp, "{\n\t\"test_mode\": \"%s\",\n", test_mode_names[test_mode]);
+	fprintf(ofp, "\t\"period_us\": %Ld,\n", period_ns / 1000);
+	fprintf(ofp, "\t\"priority\": %d,\n", priority);
+	fprintf(ofp, "\t\"duration\": %ld,\n", duration);
+	fprintf(ofp, "\t\"loghist_sub_bits\": %d,\n", LOGHIST_SUB_BITS);
+	fprintf(ofp, "\t\"cpus\": [\n");
+
+	for_each_sampler(s) {
+		snprintf(cpu, sizeof(cpu), "%d", s->cpu);
+		dump_json_entry(ofp, cpu, &s->loghist, s->gavgjitter,
+				s->goverrun);
+		fprintf(ofp, s < samplers + nr_samplers - 1 ? ",\n" : "\n");
+	}
+
+	fprintf(ofp, "\t],\n\t\"all\":\n");
+	dump_json_entry(ofp, "\"all\"", all, gavgjitter, goverrun);
+	fprintf(ofp, "\n}\n");
+
+	close_output(ofp);
+}
+
+static void dump_csv_row(FILE *ofp, const char *cpu, struct loghist *h,
+			 int32_t avg, int overruns)
+{
+	int n;
+
+	fprintf(ofp, "%s,%llu,%.3f,%.3f,%.3f,%d", cpu,
+		(unsigned long long)h->count, (double)h->min / 1000,
+		(double)avg / 1000, (double)h->max / 1000, overruns);
+
+	for (n = 0; n < (int)(sizeof(percentiles) / sizeof(percentiles[0])); n++)
+		fprintf(ofp, ",%.3f",
+			(double)loghist_percentile(h, percentiles[n].percent) / 1000);
+
+	fputc('\n', ofp);
+}
+
+static void dump_csv(struct loghist *all)
+{
+	struct sampler *s;
+	char cpu[16];
+	FILE *ofp;
+	int n;
+
+	ofp = open_output(do_csv);
+	if (ofp == NULL)
+		return;
+
+	fprintf(ofp, "cpu,samples,min,avg,max,overruns");
+	for (n = 0; n < (int)(sizeof(percentiles) / sizeof(percentiles[0])); n++)
+		fprintf(ofp, ",%s", percentiles[n].name);
+	fputc('\n', ofp);
+
+	for_each_sampler(s) {
+		snprintf(cpu, sizeof(cpu), "%d", s->cpu);
+		dump_csv_row(ofp, cpu, &s->loghist, s->gavgjitter,
+			     s->goverrun);
+	}
+
+	dump_csv_row(ofp, "all", all, gavgjitter, goverrun);
+
+	close_output(ofp);
+}
+
+static void dump_cpu_stats(void)
+{
+	struct sampler *s;
+
+	printf("CPH|%5s|%11s|%11s|%11s|%8s|%6s|%11s|%11s|%11s\n",
+	       "--cpu", "----lat min", "----lat avg", "----lat max",
+	       "-overrun", "---msw", "--------p99", "-----p99.99",
+	       "---p99.9999");
+
+	for_each_sampler(s)
+		printf("CPD|%5d|%11.3f|%11.3f|%11.3f|%8d|%6u|%11.3f|%11.3f|%11.3f\n",
+		       s->cpu, (double)s->loghist.min / 1000,
+		       (double)s->gavgjitter / 1000,
+		       (double)s->loghist.max / 1000, s->goverrun, s->relaxed,
+		       (double)loghist_percentile(&s->loghist, 99.0) / 1000,
+		       (double)loghist_percentile(&s->loghist, 99.99) / 1000,
+		       (double)loghist_percentile(&s->loghist, 99.9999) / 1000);
+}
+
+/*
+ * The timerbench driver only returns a linear histogram of the
+ * samples. Fold it into the log-linear one, so that the percentiles
+ * are available in kernel modes too, albeit with the precision of
+ * the bucket size (-B). Min and max remain exact.
+ */
+static void fold_histogram(struct sampler *s)
+{
+	int n;
+
+	for (n = 0; n < histogram_size; n++)
+		if (s->histogram_avg[n])
+			loghist_add_n(&s->loghist,
+				      n * bucketsize + bucketsize / 2,
+				      s->histogram_avg[n]);
+
+	s->loghist.min = s->gminjitter;
+	s->loghist.max = s->gmaxjitter;
+}
+
 static void cleanup(void)
 {
 	struct rttst_overall_bench_res overall;
+	static struct loghist all;
 	time_t actual_duration;
+	int64_t sumavg = 0;
+	struct sampler *s;
+	int n;
 
 	time(&test_end);
 	actual_duration = test_end - test_start - WARMUP_TIME;
@@ -490,31 +744,67 @@ static void cleanup(void)
 	pthread_cancel(display_task);
 
 	if (test_mode == USER_TASK) {
-		pthread_cancel(latency_task);
-		pthread_join(latency_task, NULL);
+		for_each_sampler(s)
+			pthread_cancel(s->task);
+		for_each_sampler(s) {
+			pthread_join(s->task, NULL);
+			s->gavgjitter /= (s->test_loops > 1 ?
+					  s->test_loops : 2) - 1;
+		}
 		pthread_join(display_task, NULL);
 
 		sem_close(display_sem);
 		sem_unlink(sem_name);
-		gavgjitter /= (test_loops > 1 ? test_loops : 2) - 1;
 	} else {
-		overall.histogram_min = histogram_min;
-		overall.histogram_max = histogram_max;
-		overall.histogram_avg = histogram_avg;
-		ioctl(benchdev, RTTST_RTIOC_TMBENCH_STOP, &overall);
-		gminjitter = overall.result.min;
-		gmaxjitter = overall.result.max;
-		gavgjitter = overall.result.avg;
-		goverrun = overall.result.overruns;
+		for_each_sampler(s) {
+			overall.histogram_min = s->histogram_min;
+			overall.histogram_max = s->histogram_max;
+			overall.histogram_avg = s->histogram_avg;
+			ioctl(s->benchdev, RTTST_RTIOC_TMBENCH_STOP, &overall);
+			s->gminjitter = overall.result.min;
+			s->gmaxjitter = overall.result.max;
+			s->gavgjitter = overall.result.avg;
+			s->goverrun = overall.result.overruns;
+			if (need_loghist())
+				fold_histogram(s);
+		}
 		pthread_join(display_task, NULL);
 	}
 
-	if (benchdev >= 0)
-		close(benchdev);
+	loghist_init(&all);
+
+	for_each_sampler(s) {
+		if (s->benchdev >= 0)
+			close(s->benchdev);
+		if (s->gminjitter < gminjitter)
+			gminjitter = s->gminjitter;
+		if (s->gmaxjitter > gmaxjitter)
+			gmaxjitter = s->gmaxjitter;
+		sumavg += s->gavgjitter;
+		goverrun += s->goverrun;
+		max_relaxed += s->relaxed;
+		loghist_merge(&all, &s->loghist);
+		for (n = 0; n < histogram_size; n++) {
+			histogram_avg[n] += s->histogram_avg[n];
+			histogram_max[n] += s->histogram_max[n];
+			histogram_min[n] += s->histogram_min[n];
+		}
+	}
+
+	gavgjitter = sumavg / nr_samplers;
 
 	if (need_histo())
 		dump_hist_stats(actual_duration);
 
+	if (nr_samplers > 1)
+		dump_cpu_stats();
+
+	if (do_json)
+		dump_json(&all, actual_duration);
+
+	if (do_csv)
+		dump_csv(&all);
+
 	printf
 	    ("---|-----------|-----------|-----------|--------|------|-------------------------\n"
 	     "RTS|%11.3f|%11.3f|%11.3f|%8d|%6u|    %.2ld:%.2ld:%.2ld/%.2d:%.2d:%.2d\n",
@@ -534,6 +824,14 @@ static void cleanup(void)
 	if (histogram_min)
 		free(histogram_min);
 
+	for_each_sampler(s) {
+		free(s->histogram_avg);
+		free(s->histogram_max);
+		free(s->histogram_min);
+	}
+
+	free(samplers);
+
 	exit(0);
 }
 
@@ -610,6 +908,9 @@ void application_usage(void)
 		"-t <test_mode>                  0=user task (default), 1=kernel task, 2=timer IRQ\n"
 		"-f                              freeze trace for each new max latency\n"
 		"-c <cpu>                        pin measuring task down to given CPU\n"
+		"-C <cpu-list>                   sample on each CPU of list concurrently (e.g. 0-3,6)\n"
+		"-j <file>                       dump per-CPU results and histograms to <file> in JSON format\n"
+		"-x <file>                       dump per-CPU results to <file> in CSV format\n"
 		"-P <priority>                   task priority (test mode 0 and 1 only)\n"
 		"-b                              break upon mode switch\n"
 		);
@@ -638,15 +939,46 @@ static void setup_sched_parameters(pthread_attr_t *attr, int prio)
 		error(1, ret, "pthread_attr_setschedparam()");
 }
 
+static int parse_cpu_list(const char *s, cpu_set_t *set)
+{
+	long first, last;
+	char *end;
+
+	CPU_ZERO(set);
+
+	for (;;) {
+		first = strtol(s, &end, 10);
+		if (end == s || first < 0 || first >= CPU_SETSIZE)
+			return -EINVAL;
+		last = first;
+		if (*end == '-') {
+			s = end + 1;
+			last = strtol(s, &end, 10);
+			if (end == s || last < first || last >= CPU_SETSIZE)
+				return -EINVAL;
+		}
+		for (; first <= last; first++)
+			CPU_SET(first, set);
+		if (*end == '\0')
+			return 0;
+		if (*end != ',')
+			return -EINVAL;
+		s = end + 1;
+	}
+}
+
 int main(int argc, char *const *argv)
 {
 	struct sigaction sa __attribute__((unused));
-	int c, ret, sig, cpu = 0;
+	int c, ret, sig, cpu = 0, cpu_given = 0;
 	pthread_attr_t tattr;
+	struct sampler *s;
 	cpu_set_t cpus;
 	sigset_t mask;
 
-	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:P:b")) != EOF)
+	CPU_ZERO(&cpus);
+
+	while ((c = getopt(argc, argv, "g:hp:l:T:qH:B:sD:t:fc:C:j:x:P:b")) != EOF)
 		switch (c) {
 		case 'g':
 			do_gnuplot = strdup(optarg);
@@ -710,6 +1042,20 @@ int main(int argc, char *const *argv)
 			cpu = atoi(optarg);
 			if (cpu < 0 || cpu >= CPU_SETSIZE)
 				error(1, EINVAL, "invalid CPU #%d", cpu);
+			cpu_given = 1;
+			break;
+
+		case 'C':
+			if (parse_cpu_list(optarg, &cpus) || CPU_COUNT(&cpus) == 0)
+				error(1, EINVAL, "invalid CPU list '%s'", optarg);
+			break;
+
+		case 'j':
+			do_json = strdup(optarg);
+			break;
+
+		case 'x':
+			do_csv = strdup(optarg);
 			break;
 
 		case 'P':
@@ -738,6 +1084,27 @@ int main(int argc, char *const *argv)
 		error(1, EINVAL, "-t1, -t2 not allowed over Mercury");
 #endif
 	
+	if (CPU_COUNT(&cpus) == 0)
+		CPU_SET(cpu, &cpus);
+	else
+		cpu_given = 1;
+
+	nr_samplers = CPU_COUNT(&cpus);
+	samplers = calloc(nr_samplers, sizeof(*samplers));
+	if (samplers == NULL)
+		error(1, ENOMEM, "calloc()");
+
+	for (cpu = 0, s = samplers; s < samplers + nr_samplers; cpu++) {
+		if (!CPU_ISSET(cpu, &cpus))
+			continue;
+		s->cpu = cpu;
+		s->benchdev = -1;
+		s->gminjitter = TEN_MILLIONS;
+		s->gmaxjitter = -TEN_MILLIONS;
+		loghist_init(&s->loghist);
+		s++;
+	}
+
 	time(&test_start);
 
 	histogram_avg = calloc(histogram_size, sizeof(int32_t));
@@ -747,6 +1114,14 @@ int main(int argc, char *const *argv)
 	if (!(histogram_avg && histogram_max && histogram_min))
 		cleanup();
 
+	for_each_sampler(s) {
+		s->histogram_avg = calloc(histogram_size, sizeof(int32_t));
+		s->histogram_max = calloc(histogram_size, sizeof(int32_t));
+		s->histogram_min = calloc(histogram_size, sizeof(int32_t));
+		if (!(s->histogram_avg && s->histogram_max && s->histogram_min))
+			cleanup();
+	}
+
 	if (period_ns == 0)
 		period_ns = CONFIG_XENO_DEFAULT_PERIOD;	/* ns */
 
@@ -784,9 +1159,17 @@ int main(int argc, char *const *argv)
 	       period_ns / 1000, test_mode_names[test_mode]);
 
 	if (test_mode != USER_TASK) {
-		benchdev = open("/dev/rtdm/timerbench", O_RDWR);
-		if (benchdev < 0)
-			error(1, errno, "open sampler device (modprobe xeno_timerbench?)");
+		for_each_sampler(s) {
+			s->benchdev = open("/dev/rtdm/timerbench", O_RDWR);
+			if (s->benchdev < 0)
+				error(1, errno, "open sampler device (modprobe xeno_timerbench?)");
+			if (!cpu_given)
+				continue;
+			ret = ioctl(s->benchdev, RTTST_RTIOC_TMBENCH_SET_CPU,
+				    s->cpu);
+			if (ret)
+				error(1, errno, "ioctl(RTTST_RTIOC_TMBENCH_SET_CPU)");
+		}
 	}
 
 	setup_sched_parameters(&tattr, 0);
@@ -798,19 +1181,21 @@ int main(int argc, char *const *argv)
 	pthread_attr_destroy(&tattr);
 
 	if (test_mode == USER_TASK) {
-		setup_sched_parameters(&tattr, priority);
-		CPU_ZERO(&cpus);
-		CPU_SET(cpu, &cpus);
+		for_each_sampler(s) {
+			setup_sched_parameters(&tattr, priority);
+			CPU_ZERO(&cpus);
+			CPU_SET(s->cpu, &cpus);
 
-		ret = pthread_attr_setaffinity_np(&tattr, sizeof(cpus), &cpus);
-		if (ret)
-			error(1, ret, "pthread_attr_setaffinity_np()");
+			ret = pthread_attr_setaffinity_np(&tattr, sizeof(cpus), &cpus);
+			if (ret)
+				error(1, ret, "pthread_attr_setaffinity_np()");
 
-		ret = pthread_create(&latency_task, &tattr, latency, NULL);
-		if (ret)
-			error(1, ret, "pthread_create(latency)");
+			ret = pthread_create(&s->task, &tattr, latency, s);
+			if (ret)
+				error(1, ret, "pthread_create(latency)");
 
-		pthread_attr_destroy(&tattr);
+			pthread_attr_destroy(&tattr);
+		}
 	}
 
 	__STD(sigwait(&mask, &sig));
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+#include <math.h>
+#include "loghist.h"
+
+void loghist_init(struct loghist *h)
+{
+	memset(h, 0, sizeof(*h));
+	h->min = INT32_MAX;
+	h->max = INT32_MIN;
+}
+
+void loghist_merge(struct loghist *dst, const struct loghist *src)
+{
+	int n;
+
+	for (n = 0; n < LOGHIST_CELLS; n++)
+		dst->cells[n] += src->cells[n];
+
+	dst->count += src->count;
+	dst->sum += src->sum;
+	if (src->min < dst->min)
+		dst->min = src->min;
+	if (src->max > dst->max)
+		dst->max = src->max;
+}
+
+/* Highest value which would have been counted in the given cell. */
+static int64_t cell_limit(int n)
+{
+	int shift;
+
+	if (n < LOGHIST_SUB_COUNT)
+		return n;
+
+	shift = (n >> LOGHIST_SUB_BITS) - 1;
+
+	return ((int64_t)(LOGHIST_SUB_COUNT + (n & (LOGHIST_SUB_COUNT - 1)))
+		<< shift) + (1LL << shift) - 1;
+}
+
+int32_t loghist_percentile(const struct loghist *h, double percent)
+{
+	uint64_t rank, seen = 0;
+	int64_t value;
+	int n;
+
+	if (h->count == 0)
+		return 0;
+
+	/* Smallest value covering at least @percent of the samples. */
+	rank = (uint64_t)ceil(percent / 100.0 * h->count);
+	if (rank < 1)
+		rank = 1;
+
+	for (n = 0; n < LOGHIST_CELLS; n++) {
+		seen += h->cells[n];
+		if (seen >= rank)
+			break;
+	}
+
+	value = cell_limit(n);
+	if (value > h->max)
+		value = h->max;
+	if (value < h->min)
+		value = h->min;
+
+	return value;
+}
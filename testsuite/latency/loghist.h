@@ -0,0 +1,70 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Log-linear latency histogram. Values below 2^LOGHIST_SUB_BITS are
+ * counted exactly, every power-of-two range above is split into
+ * 2^LOGHIST_SUB_BITS cells of equal width, which bounds the relative
+ * error of any value read back from the histogram to
+ * 2^-LOGHIST_SUB_BITS, over the full int32_t range.
+ */
+#ifndef _LATENCY_LOGHIST_H
+#define _LATENCY_LOGHIST_H
+
+#include <stdint.h>
+
+#define LOGHIST_SUB_BITS	7
+#define LOGHIST_SUB_COUNT	(1 << LOGHIST_SUB_BITS)
+#define LOGHIST_CELLS		((32 - LOGHIST_SUB_BITS) * LOGHIST_SUB_COUNT)
+
+struct loghist {
+	uint64_t count;
+	int64_t sum;
+	int32_t min;
+	int32_t max;
+	uint64_t cells[LOGHIST_CELLS];
+};
+
+static inline int loghist_index(int32_t value)
+{
+	uint32_t v = value > 0 ? value : 0;
+	int shift;
+
+	if (v < LOGHIST_SUB_COUNT)
+		return v;
+
+	shift = 31 - __builtin_clz(v) - LOGHIST_SUB_BITS;
+
+	return ((shift + 1) << LOGHIST_SUB_BITS) +
+		((v >> shift) - LOGHIST_SUB_COUNT);
+}
+
+/*
+ * Negative values (i.e. early wakeups) are counted in the first
+ * cell, only the minimum keeps track of them accurately.
+ */
+static inline void loghist_add_n(struct loghist *h, int32_t value,
+				 uint64_t n)
+{
+	h->cells[loghist_index(value)] += n;
+	h->count += n;
+	h->sum += (int64_t)value * n;
+	if (value < h->min)
+		h->min = value;
+	if (value > h->max)
+		h->max = value;
+}
+
+static inline void loghist_add(struct loghist *h, int32_t value)
+{
+	loghist_add_n(h, value, 1);
+}
+
+void loghist_init(struct loghist *h);
+
+void loghist_merge(struct loghist *dst, const struct loghist *src);
+
+int32_t loghist_percentile(const struct loghist *h, double percent);
+
+#endif /* !_LATENCY_LOGHIST_H */
@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <smokey/smokey.h>
+#include <rtdm/ipc.h>
+
+smokey_test_plugin(bufp_ring,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(frames),
+			   SMOKEY_INT(frame_size),
+		   ),
+		   "Check the shared memory ring mode of RTIPC/BUFP.\n"
+		   "\tframes=<n>\tframes per run (default 2000)\n"
+		   "\tframe_size=<bytes>\tlargest frame (default 65536)"
+);
+
+#define BUFP_RING_PORT 13
+
+enum xfer_mode {
+	XFER_MMAP,		/* reserve/commit, peek/release */
+	XFER_SOCKET,		/* send(), recv() */
+};
+
+struct xfer {
+	enum xfer_mode tx_mode;
+	enum xfer_mode rx_mode;
+	int txfd, rxfd;
+	struct bufp_ring *txring, *rxring;
+	int frames, frame_size;
+	long long bytes;
+	char *txbuf, *rxbuf;
+	int status;
+};
+
+static inline long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Vary the length so that padding records show up. */
+static size_t frame_len(struct xfer *x, int seq)
+{
+	return x->frame_size - (seq % 7) * 1000 - (seq % 3);
+}
+
+static void fill_frame(void *buf, size_t len, int seq)
+{
+	unsigned char *p = buf;
+	size_t n;
+
+	for (n = 0; n < len; n++)
+		p[n] = (unsigned char)(seq + n * 7);
+}
+
+static int check_frame(const void *buf, size_t len, int seq)
+{
+	const unsigned char *p = buf;
+	size_t n;
+
+	for (n = 0; n < len; n++) {
+		if (p[n] != (unsigned char)(seq + n * 7)) {
+			smokey_warning("frame %d: byte %zu is %#x, expected %#x",
+				       seq, n, p[n], (unsigned char)(seq + n * 7));
+			return -EPROTO;
+		}
+	}
+
+	return 0;
+}
+
+static int send_frame(struct xfer *x, int seq)
+{
+	size_t len = frame_len(x, seq);
+	__u32 wlen = len;
+	void *buf;
+	int ret;
+
+	if (x->tx_mode == XFER_SOCKET) {
+		fill_frame(x->txbuf, len, seq);
+		ret = send(x->txfd, x->txbuf, len, 0);
+		if (ret < 0)
+			return -errno;
+		return ret == len ? 0 : -EPROTO;
+	}
+
+	for (;;) {
+		buf = bufp_ring_reserve(x->txring, len);
+		if (buf)
+			break;
+		if (errno != EAGAIN)
+			return -errno;
+		if (ioctl(x->txfd, BUFP_RTIOC_WAITOUT, &wlen))
+			return -errno;
+	}
+
+	fill_frame(buf, len, seq);
+
+	return bufp_ring_commit(x->txfd, x->txring, buf, len) ? -errno : 0;
+}
+
+static int receive_frame(struct xfer *x, int seq)
+{
+	size_t len;
+	void *buf;
+	int ret;
+
+	if (x->rx_mode == XFER_SOCKET) {
+		ret = recv(x->rxfd, x->rxbuf, x->frame_size, 0);
+		if (ret < 0)
+			return -errno;
+		if (ret != frame_len(x, seq))
+			return -EPROTO;
+		return check_frame(x->rxbuf, ret, seq);
+	}
+
+	for (;;) {
+		buf = bufp_ring_peek(x->rxring, &len);
+		if (buf)
+			break;
+		if (ioctl(x->rxfd, BUFP_RTIOC_WAITIN))
+			return -errno;
+	}
+
+	if (!__Tassert(len == frame_len(x, seq)))
+		return -EPROTO;
+
+	ret = check_frame(buf, len, seq);
+	if (ret)
+		return ret;
+
+	return bufp_ring_release(x->rxfd, x->rxring, buf) ? -errno : 0;
+}
+
+static void *producer(void *arg)
+{
+	struct xfer *x = arg;
+	int seq, ret = 0;
+
+	for (seq = 0; seq < x->frames && ret == 0; seq++)
+		ret = send_frame(x, seq);
+
+	if (ret)
+		x->status = ret;
+
+	return NULL;
+}
+
+static int run_xfer(struct xfer *x, const char *label)
+{
+	struct sched_param param = { .sched_priority = 10 };
+	long long start, elapsed;
+	pthread_attr_t attr;
+	pthread_t tid;
+	int seq, ret;
+
+	x->status = 0;
+	x->bytes = 0;
+
+	/* The consumer runs at a higher priority than the producer. */
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+	pthread_attr_setschedparam(&attr, &param);
+
+	param.sched_priority = 11;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	start = now_ns();
+
+	if (!__T(ret, pthread_create(&tid, &attr, producer, x))) {
+		pthread_attr_destroy(&attr);
+		goto out;
+	}
+
+	pthread_attr_destroy(&attr);
+
+	/*
+	 * Should we bail out early, the producer is released by the
+	 * send timeout.
+	 */
+	for (seq = 0; seq < x->frames; seq++) {
+		ret = receive_frame(x, seq);
+		if (ret) {
+			smokey_warning("%s frame %d: %s",
+				       label, seq, strerror(-ret));
+			break;
+		}
+		x->bytes += frame_len(x, seq);
+	}
+
+	pthread_join(tid, NULL);
+	elapsed = now_ns() - start;
+	if (ret == 0)
+		ret = x->status;
+	if (ret == 0)
+		smokey_trace("%-18s %d frames in %lld us, %lld MB/s", label,
+			     x->frames, elapsed / 1000,
+			     x->bytes * 1000 / (elapsed ?: 1));
+out:
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+	return ret;
+}
+
+/* Neither side may wait forever if the other one fails. */
+static const struct timeval xfer_timeout = { .tv_sec = 2, .tv_usec = 0 };
+
+static int open_rx(struct xfer *x, int shmem, size_t bufsz)
+{
+	struct sockaddr_ipc saddr;
+	int s, ret;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (s < 0)
+		return -errno;
+
+	if (!__Terrno(ret, setsockopt(s, SOL_BUFP, BUFP_BUFSZ,
+				      &bufsz, sizeof(bufsz))) ||
+	    !__Terrno(ret, setsockopt(s, SOL_BUFP, BUFP_SHMEM,
+				      &shmem, sizeof(shmem))) ||
+	    !__Terrno(ret, setsockopt(s, SOL_SOCKET, SO_RCVTIMEO,
+				      &xfer_timeout, sizeof(xfer_timeout))))
+		goto fail;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_RING_PORT;
+	if (!__Terrno(ret, bind(s, (struct sockaddr *)&saddr, sizeof(saddr))))
+		goto fail;
+
+	x->rxfd = s;
+
+	return 0;
+fail:
+	close(s);
+
+	return ret;
+}
+
+static int open_tx(struct xfer *x)
+{
+	struct sockaddr_ipc saddr;
+	int s, ret;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (s < 0)
+		return -errno;
+
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = BUFP_RING_PORT;
+	if (!__Terrno(ret, setsockopt(s, SOL_SOCKET, SO_SNDTIMEO,
+				      &xfer_timeout, sizeof(xfer_timeout))) ||
+	    !__Terrno(ret, connect(s, (struct sockaddr *)&saddr,
+				   sizeof(saddr)))) {
+		close(s);
+		return ret;
+	}
+
+	x->txfd = s;
+
+	return 0;
+}
+
+static int map_rings(struct xfer *x, struct bufp_ringsz *rsz)
+{
+	struct bufp_ringsz tsz;
+	socklen_t len;
+	int ret;
+	void *p;
+
+	len = sizeof(*rsz);
+	if (!__Terrno(ret, getsockopt(x->rxfd, SOL_BUFP, BUFP_RINGSZ,
+				      rsz, &len)))
+		return ret;
+
+	len = sizeof(tsz);
+	if (!__Terrno(ret, getsockopt(x->txfd, SOL_BUFP, BUFP_RINGSZ,
+				      &tsz, &len)))
+		return ret;
+
+	if (!__Tassert(rsz->rx > 0 && rsz->rx == tsz.tx))
+		return -EPROTO;
+
+	p = mmap(NULL, rsz->rx, PROT_READ|PROT_WRITE, MAP_SHARED,
+		 x->rxfd, BUFP_RING_RX_PGOFF * getpagesize());
+	if (!__Fassert(p == MAP_FAILED))
+		return -errno;
+	x->rxring = p;
+
+	p = mmap(NULL, tsz.tx, PROT_READ|PROT_WRITE, MAP_SHARED,
+		 x->txfd, BUFP_RING_TX_PGOFF * getpagesize());
+	if (!__Fassert(p == MAP_FAILED)) {
+		munmap(x->rxring, rsz->rx);
+		return -errno;
+	}
+	x->txring = p;
+
+	/* Both mappings must refer to the same ring. */
+	if (!__Tassert(x->rxring->size == x->txring->size &&
+		       x->rxring->size + x->rxring->data_offset == rsz->rx)) {
+		munmap(x->rxring, rsz->rx);
+		munmap(x->txring, rsz->rx);
+		return -EPROTO;
+	}
+
+	return 0;
+}
+
+static int check_ring_mode(struct xfer *x)
+{
+	static const enum xfer_mode modes[][2] = {
+		{ XFER_MMAP, XFER_MMAP },
+		{ XFER_SOCKET, XFER_MMAP },
+		{ XFER_MMAP, XFER_SOCKET },
+		{ XFER_SOCKET, XFER_SOCKET },
+	};
+	static const char *labels[] = {
+		"ring zero-copy:",
+		"ring send/peek:",
+		"ring commit/recv:",
+		"ring send/recv:",
+	};
+	struct bufp_ringsz rsz;
+	int ret, n, shmem = 1;
+	size_t bufsz;
+	socklen_t len;
+
+	/* Room for a handful of frames. */
+	bufsz = x->frame_size * 4;
+	ret = open_rx(x, 1, bufsz);
+	if (ret)
+		return ret;
+
+	len = sizeof(shmem);
+	shmem = 0;
+	if (!__Terrno(ret, getsockopt(x->rxfd, SOL_BUFP, BUFP_SHMEM,
+				      &shmem, &len)))
+		goto close_rx;
+
+	if (!__Tassert(shmem == 1)) {
+		ret = -EPROTO;
+		goto close_rx;
+	}
+
+	/* Switching modes after binding is not allowed. */
+	shmem = 0;
+	if (!__Fassert(setsockopt(x->rxfd, SOL_BUFP, BUFP_SHMEM,
+				  &shmem, sizeof(shmem)) == 0) ||
+	    !__Tassert(errno == EALREADY)) {
+		ret = -EPROTO;
+		goto close_rx;
+	}
+
+	ret = open_tx(x);
+	if (ret)
+		goto close_rx;
+
+	ret = map_rings(x, &rsz);
+	if (ret)
+		goto close_tx;
+
+	/* Too large for the ring, either way. */
+	if (!__Tassert(bufp_ring_reserve(x->txring,
+					 x->rxring->size) == NULL &&
+		       errno == EINVAL) ||
+	    !__Tassert(send(x->txfd, x->txbuf, x->rxring->size / 2,
+			    0) < 0 && errno == EINVAL)) {
+		ret = -EPROTO;
+		goto unmap;
+	}
+
+	/* Nothing to receive yet. */
+	if (!__Tassert(recv(x->rxfd, x->rxbuf, x->frame_size,
+			    MSG_DONTWAIT) < 0 && errno == EWOULDBLOCK)) {
+		ret = -EPROTO;
+		goto unmap;
+	}
+
+	for (n = 0; n < 4; n++) {
+		x->tx_mode = modes[n][0];
+		x->rx_mode = modes[n][1];
+		ret = run_xfer(x, labels[n]);
+		if (ret)
+			goto unmap;
+	}
+
+	/* Short reads truncate the record, which is consumed anyway. */
+	fill_frame(x->txbuf, 64, 0);
+	fill_frame(x->txbuf + 64, 64, 1);
+	if (!__Tassert(send(x->txfd, x->txbuf, 64, 0) == 64) ||
+	    !__Tassert(send(x->txfd, x->txbuf + 64, 64, 0) == 64) ||
+	    !__Tassert(recv(x->rxfd, x->rxbuf, 16, 0) == 16) ||
+	    !__Tassert(recv(x->rxfd, x->rxbuf + 16, 64, 0) == 64) ||
+	    !__Tassert(memcmp(x->rxbuf, x->txbuf, 16) == 0) ||
+	    !__Tassert(memcmp(x->rxbuf + 16, x->txbuf + 64, 64) == 0))
+		ret = -EPROTO;
+unmap:
+	munmap(x->txring, rsz.rx);
+	/*
+	 * Close the owner first, its ring must remain valid until
+	 * the last mapping goes away.
+	 */
+	close(x->rxfd);
+	if (ret == 0 && !__Tassert(x->rxring->size * 2 >= bufsz))
+		ret = -EPROTO;
+	munmap(x->rxring, rsz.rx);
+	close(x->txfd);
+
+	return ret;
+close_tx:
+	close(x->txfd);
+close_rx:
+	close(x->rxfd);
+
+	return ret;
+}
+
+static int check_copy_mode(struct xfer *x)
+{
+	int ret;
+
+	/* Regular BUFP sockets may not be mapped. */
+	ret = open_rx(x, 0, x->frame_size * 4);
+	if (ret)
+		return ret;
+
+	ret = open_tx(x);
+	if (ret)
+		goto close_rx;
+
+	if (!__Tassert(mmap(NULL, getpagesize(), PROT_READ|PROT_WRITE,
+			    MAP_SHARED, x->rxfd, 0) == MAP_FAILED)) {
+		ret = -EPROTO;
+		goto close_tx;
+	}
+
+	x->tx_mode = x->rx_mode = XFER_SOCKET;
+	ret = run_xfer(x, "copy send/recv:");
+close_tx:
+	close(x->txfd);
+close_rx:
+	close(x->rxfd);
+
+	return ret;
+}
+
+static int run_bufp_ring(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct xfer x;
+	int ret, s;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_BUFP);
+	if (s < 0) {
+		if (errno == EAFNOSUPPORT)
+			return -ENOSYS;
+	} else
+		close(s);
+
+	memset(&x, 0, sizeof(x));
+	x.frames = 2000;
+	x.frame_size = 65536;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(bufp_ring, frames))
+		x.frames = SMOKEY_ARG_INT(bufp_ring, frames);
+
+	if (SMOKEY_ARG_ISSET(bufp_ring, frame_size))
+		x.frame_size = SMOKEY_ARG_INT(bufp_ring, frame_size);
+
+	/* frame_len() goes down by up to 6002 bytes. */
+	if (x.frames <= 0 || x.frame_size < 8192)
+		return -EINVAL;
+
+	/* Large enough for probing the record size limit. */
+	x.txbuf = malloc(x.frame_size * 4);
+	x.rxbuf = malloc(x.frame_size);
+	if (x.txbuf == NULL || x.rxbuf == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = check_ring_mode(&x);
+	if (ret == 0)
+		ret = check_copy_mode(&x);
+out:
+	free(x.rxbuf);
+	free(x.txbuf);
+
+	return ret;
+}
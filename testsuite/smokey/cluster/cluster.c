@@ -0,0 +1,288 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <copperplate/heapobj.h>
+#include <copperplate/cluster.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(cluster,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_objects),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check copperplate clusters, then measure the lookup\n"
+		   "\tthroughput for an increasing number of indexed objects\n"
+		   "\tand concurrent threads.\n"
+		   "\tmax_objects=<n>\tlargest object count (default 4096)\n"
+		   "\tloops=<n>\tlookups per thread and step (default 100000)"
+);
+
+#define MIN_OBJECTS	256
+
+struct bench_obj {
+	struct clusterobj cobj;
+	char name[16];
+};
+
+struct bench_thread {
+	pthread_t tid;
+	int cpu;
+	int count;
+	int loops;
+	int status;
+	long long ns;
+};
+
+static struct cluster bench_cluster;
+
+static struct bench_obj *objs;
+
+static volatile int bench_done;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int walk_count;
+
+static int count_objects(struct cluster *c, struct clusterobj *cobj)
+{
+	walk_count++;
+
+	return 0;
+}
+
+static int check_cluster(int count, struct bench_obj *spare)
+{
+	struct clusterobj *cobj;
+	char name[16];
+	int n;
+
+	for (n = 0; n < count; n++) {
+		cobj = cluster_findobj(&bench_cluster, objs[n].name);
+		if (!__Tassert(cobj == &objs[n].cobj)) {
+			smokey_warning("lookup of %s failed", objs[n].name);
+			return -EPROTO;
+		}
+	}
+
+	for (n = 0; n < 16; n++) {
+		snprintf(name, sizeof(name), "none%d", n);
+		if (!__Tassert(cluster_findobj(&bench_cluster, name) == NULL))
+			return -EPROTO;
+	}
+
+	snprintf(spare->name, sizeof(spare->name), "%s", objs[0].name);
+	if (!__Tassert(cluster_addobj(&bench_cluster, spare->name,
+				      &spare->cobj) == -EEXIST))
+		return -EPROTO;
+
+	walk_count = 0;
+	cluster_walk(&bench_cluster, count_objects);
+	if (!__Tassert(walk_count == count))
+		return -EPROTO;
+
+	return 0;
+}
+
+static void *lookup_loop(void *arg)
+{
+	struct bench_thread *b = arg;
+	struct clusterobj *cobj;
+	cpu_set_t cpus;
+	long long start;
+	int n, idx;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(b->cpu, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+
+	start = now_ns();
+
+	for (n = 0, idx = b->cpu; n < b->loops; n++) {
+		idx = (idx + 7919) % b->count;
+		cobj = cluster_findobj(&bench_cluster, objs[idx].name);
+		if (cobj != &objs[idx].cobj) {
+			b->status = -ENOENT;
+			break;
+		}
+	}
+
+	b->ns = now_ns() - start;
+
+	return NULL;
+}
+
+static void *update_loop(void *arg)
+{
+	struct bench_obj *spare = arg;
+	int n = 0, ret;
+
+	snprintf(spare->name, sizeof(spare->name), "spare");
+
+	/* Keep the table changing under the readers' feet. */
+	while (!bench_done) {
+		ret = cluster_addobj(&bench_cluster, spare->name, &spare->cobj);
+		if (ret == 0)
+			ret = cluster_delobj(&bench_cluster, &spare->cobj);
+		if (ret) {
+			smokey_warning("update #%d failed: %s", n, symerror(ret));
+			break;
+		}
+		n++;
+	}
+
+	return NULL;
+}
+
+static int run_bench(int count, int nr_threads, const int *cpu_list,
+		     int loops, struct bench_obj *spare)
+{
+	struct bench_thread *threads, *b;
+	unsigned long long rate = 0;
+	pthread_t updater;
+	int n, ret = 0;
+
+	threads = calloc(nr_threads, sizeof(*threads));
+	if (threads == NULL)
+		return -ENOMEM;
+
+	bench_done = 0;
+	if (spare) {
+		ret = smokey_check_status(pthread_create(&updater, NULL,
+							 update_loop, spare));
+		if (ret)
+			goto out;
+	}
+
+	for (n = 0; n < nr_threads; n++) {
+		b = threads + n;
+		b->cpu = cpu_list[n];
+		b->count = count;
+		b->loops = loops;
+		ret = smokey_check_status(pthread_create(&b->tid, NULL,
+							 lookup_loop, b));
+		if (ret) {
+			nr_threads = n;
+			break;
+		}
+	}
+
+	for (n = 0; n < nr_threads; n++) {
+		b = threads + n;
+		pthread_join(b->tid, NULL);
+		if (ret == 0)
+			ret = b->status;
+		rate += loops * 1000000000ULL / (b->ns ?: 1);
+	}
+
+	bench_done = 1;
+	if (spare)
+		pthread_join(updater, NULL);
+
+	if (ret == 0)
+		smokey_trace("%6d objects, %2d thread(s)%s: %10llu lookups/s",
+			     count, nr_threads, spare ? " + updater" : "",
+			     rate);
+out:
+	free(threads);
+
+	return ret;
+}
+
+static int run_cluster(struct smokey_test *t, int argc, char *const argv[])
+{
+	int max_objects = 4096, loops = 100000, nr_cpus = 0, cpu;
+	int count, nr, n = 0, ret;
+	int cpu_list[CPU_SETSIZE];
+	struct bench_obj *spare;
+	cpu_set_t cpus;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(cluster, max_objects))
+		max_objects = SMOKEY_ARG_INT(cluster, max_objects);
+	if (SMOKEY_ARG_ISSET(cluster, loops))
+		loops = SMOKEY_ARG_INT(cluster, loops);
+
+	if (max_objects < MIN_OBJECTS || loops <= 0)
+		return -EINVAL;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &cpus))
+			cpu_list[nr_cpus++] = cpu;
+
+	/* Objects must live in the main heap, with two spare ones. */
+	objs = xnmalloc((max_objects + 2) * sizeof(*objs));
+	if (objs == NULL) {
+		smokey_warning("cannot allocate %d objects, "
+			       "try raising --mem-pool-size", max_objects);
+		return -ENOMEM;
+	}
+
+	memset(objs, 0, (max_objects + 2) * sizeof(*objs));
+	spare = objs + max_objects;
+
+	ret = cluster_init(&bench_cluster, "smokey-cluster");
+	if (ret)
+		goto out;
+
+	for (count = MIN_OBJECTS;; count *= 4) {
+		if (count > max_objects)
+			count = max_objects;
+
+		for (; n < count; n++) {
+			snprintf(objs[n].name, sizeof(objs[n].name),
+				 "obj%d", n);
+			ret = cluster_addobj(&bench_cluster, objs[n].name,
+					     &objs[n].cobj);
+			if (ret) {
+				smokey_warning("cannot index object #%d: %s",
+					       n, symerror(ret));
+				goto drop;
+			}
+		}
+
+		ret = check_cluster(count, spare);
+		if (ret)
+			goto drop;
+
+		for (nr = 1; nr <= nr_cpus; nr *= 2) {
+			ret = run_bench(count, nr, cpu_list, loops, NULL);
+			if (ret)
+				goto drop;
+		}
+
+		if (count == max_objects)
+			break;
+	}
+
+	ret = run_bench(count, nr_cpus, cpu_list, loops, spare + 1);
+drop:
+	while (--n >= 0)
+		if (cluster_delobj(&bench_cluster, &objs[n].cobj) && ret == 0)
+			ret = -EPROTO;
+
+	if (ret == 0 && !__Tassert(cluster_findobj(&bench_cluster, "obj0") == NULL))
+		ret = -EPROTO;
+out:
+	xnfree(objs);
+
+	return ret;
+}
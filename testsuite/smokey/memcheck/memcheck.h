@@ -59,13 +59,16 @@ struct memcheck_descriptor {
 #define HEAP_USED_T(__p)    ((size_t (*)(void *heap))(__p))
 #define HEAP_USABLE_T(__p)  ((size_t (*)(void *heap))(__p))
 
+#define MEMCHECK_ARG_ITEMS			\
+	SMOKEY_SIZE(seq_heap_size),		\
+	SMOKEY_SIZE(pattern_heap_size),		\
+	SMOKEY_INT(random_alloc_rounds),	\
+	SMOKEY_INT(pattern_check_rounds),	\
+	SMOKEY_INT(max_results)
+
 #define MEMCHECK_ARGS					\
 	SMOKEY_ARGLIST(					\
-		SMOKEY_SIZE(seq_heap_size),		\
-		SMOKEY_SIZE(pattern_heap_size),		\
-		SMOKEY_INT(random_alloc_rounds),	\
-		SMOKEY_INT(pattern_check_rounds),	\
-		SMOKEY_INT(max_results),		\
+		MEMCHECK_ARG_ITEMS,			\
 	)
   
 #define MEMCHECK_HELP_STRINGS						\
@@ -12,7 +12,8 @@
 
 smokey_test_plugin(memory_coreheap,
 		   MEMCHECK_ARGS,
-		   "Check for the Cobalt core allocator sanity.\n"
+		   "Check for the Cobalt core allocator sanity, then compare\n"
+		   "\tobject caches with the bare heap.\n"
 		   MEMCHECK_HELP_STRINGS
 	);
 
@@ -90,6 +91,64 @@ out:
 	return ret;
 }
 
+#define CACHE_HEAP_SIZE  (256 * 1024)
+#define CACHE_OBJECTS    256
+#define CACHE_LOOPS      100
+
+/*
+ * Compare the bare heap with an object cache on top of it, for
+ * sizes close to those of the Cobalt objects served by caches.
+ */
+static int kernel_cache_bench(void)
+{
+	static const int sizes[] = { 32, 96, 200, 480 };
+	struct rttst_heap_cache_bench bench;
+	struct sched_param param;
+	int fd, ret = 0, n, cache;
+
+	fd = __RT(open("/dev/rtdm/heapcheck", O_RDWR));
+	if (fd < 0)
+		return -ENOSYS;
+
+	param.sched_priority = 1;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	smokey_trace("== object cache vs. heap, %d objects x %d loops",
+		     CACHE_OBJECTS, CACHE_LOOPS);
+	smokey_trace("%-6s %7s %10s %10s %10s %10s",
+		     "mode", "objsize", "alloc-avg", "alloc-max",
+		     "free-avg", "free-max");
+
+	for (n = 0; n < sizeof(sizes) / sizeof(sizes[0]); n++) {
+		for (cache = 0; cache <= 1; cache++) {
+			bench.heap_size = CACHE_HEAP_SIZE;
+			bench.obj_size = sizes[n];
+			bench.nrobjs = CACHE_OBJECTS;
+			bench.loops = CACHE_LOOPS;
+			bench.use_cache = cache;
+			ret = __RT(ioctl(fd, RTTST_RTIOC_HEAP_CACHE_BENCH,
+					 &bench));
+			if (ret) {
+				ret = -errno;
+				goto out;
+			}
+			smokey_trace("%-6s %7d %10lld %10lld %10lld %10lld",
+				     cache ? "cache" : "heap", sizes[n],
+				     (long long)bench.alloc_avg_ns,
+				     (long long)bench.alloc_max_ns,
+				     (long long)bench.free_avg_ns,
+				     (long long)bench.free_max_ns);
+		}
+	}
+out:
+	__RT(close(fd));
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+
+	return ret;
+}
+
 static struct memcheck_descriptor coreheap_descriptor = {
 	.name = "coreheap",
 	.seq_min_heap_size = MIN_HEAP_SIZE,
@@ -104,5 +163,11 @@ static struct memcheck_descriptor coreheap_descriptor = {
 static int run_memory_coreheap(struct smokey_test *t,
 			       int argc, char *const argv[])
 {
-	return memcheck_run(&coreheap_descriptor, t, argc, argv);
+	int ret;
+
+	ret = memcheck_run(&coreheap_descriptor, t, argc, argv);
+	if (ret)
+		return ret;
+
+	return kernel_cache_bench();
 }
@@ -3,6 +3,9 @@
  *
  * SPDX-License-Identifier: MIT
  */
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <boilerplate/heapmem.h>
 #include "memcheck/memcheck.h"
 
@@ -19,6 +22,12 @@ smokey_test_plugin(memory_heapmem,
 #define PATTERN_HEAP_SIZE  (128*1024)
 #define PATTERN_ROUNDS     128
 
+#define CACHE_HEAP_SIZE    (1024 * 1024)
+#define CACHE_DEPTH        16
+#define CACHE_THREADS      4
+#define CACHE_BLOCKS       64
+#define CACHE_ROUNDS       2000
+
 static struct heap_memory heap;
 
 static size_t get_arena_size(size_t heap_size)
@@ -44,8 +53,124 @@ static struct memcheck_descriptor heapmem_descriptor = {
 	.valid_flags = MEMCHECK_ALL_FLAGS,
 };
 
+static void *cache_worker(void *arg)
+{
+	struct heap_memory *h = arg;
+	void *blocks[CACHE_BLOCKS];
+	size_t size;
+	int n, round;
+
+	for (round = 0; round < CACHE_ROUNDS; round++) {
+		for (n = 0; n < CACHE_BLOCKS; n++) {
+			size = 16 << (n % HEAPMEM_CACHE_BUCKETS);
+			blocks[n] = heapmem_alloc(h, size);
+			if (blocks[n] == NULL)
+				return (void *)(long)-ENOMEM;
+			memset(blocks[n], n, size);
+		}
+		for (n = 0; n < CACHE_BLOCKS; n++) {
+			size = 16 << (n % HEAPMEM_CACHE_BUCKETS);
+			if (((unsigned char *)blocks[n])[size - 1] != n ||
+			    heapmem_free(h, blocks[n]))
+				return (void *)(long)-EPROTO;
+		}
+	}
+
+	return NULL;
+}
+
+static int run_cache_check(struct heap_memory *h, int depth,
+			   struct heapmem_cache_stats *stats)
+{
+	pthread_t tids[CACHE_THREADS];
+	void *mem, *status;
+	int ret, n;
+
+	mem = malloc(HEAPMEM_ARENA_SIZE(CACHE_HEAP_SIZE));
+	if (mem == NULL)
+		return -ENOMEM;
+
+	ret = heapmem_init(h, mem, HEAPMEM_ARENA_SIZE(CACHE_HEAP_SIZE));
+	if (ret)
+		goto out;
+
+	if (depth > 0) {
+		ret = heapmem_enable_cache(h, depth);
+		if (ret)
+			goto destroy;
+	}
+
+	for (n = 0; n < CACHE_THREADS; n++) {
+		ret = -pthread_create(&tids[n], NULL, cache_worker, h);
+		if (ret)
+			break;
+	}
+
+	while (--n >= 0) {
+		pthread_join(tids[n], &status);
+		if (status && ret == 0)
+			ret = (int)(long)status;
+	}
+
+	if (ret)
+		goto destroy;
+
+	/* Exiting workers must have flushed their magazines. */
+	if (heapmem_used_size(h) > 0) {
+		smokey_warning("memory leakage: %zu bytes missing",
+			       heapmem_used_size(h));
+		ret = -EPROTO;
+		goto destroy;
+	}
+
+	heapmem_get_cache_stats(h, stats);
+destroy:
+	heapmem_destroy(h);
+out:
+	free(mem);
+
+	return ret;
+}
+
+static int check_cache(void)
+{
+	struct heapmem_cache_stats cstats, ustats;
+	unsigned long hits, total;
+	struct heap_memory h;
+	int ret;
+
+	ret = run_cache_check(&h, 0, &ustats);
+	if (ret)
+		return ret;
+
+	ret = run_cache_check(&h, CACHE_DEPTH, &cstats);
+	if (ret)
+		return ret;
+
+	hits = cstats.alloc_hits + cstats.free_hits;
+	total = hits + cstats.alloc_misses + cstats.free_misses;
+	smokey_trace("heapmem magazines (%d threads, depth=%d):",
+		     CACHE_THREADS, CACHE_DEPTH);
+	smokey_trace("   hit ratio: %lu.%02lu%% (%lu refills, %lu flushes)",
+		     hits * 100 / total, (hits * 10000 / total) % 100,
+		     cstats.refills, cstats.flushes);
+	smokey_trace("   lock acquisitions: %lu (uncached: %lu)",
+		     cstats.lock_acquisitions, ustats.lock_acquisitions);
+
+	if (!__Fassert(cstats.lock_acquisitions >= ustats.lock_acquisitions))
+		return -EPROTO;
+
+	return 0;
+}
+
 static int run_memory_heapmem(struct smokey_test *t,
 			      int argc, char *const argv[])
 {
-	return memcheck_run(&heapmem_descriptor, t, argc, argv);
+	int ret;
+
+	ret = memcheck_run(&heapmem_descriptor, t, argc, argv);
+	if (ret)
+		return ret;
+
+	return check_cache();
 }
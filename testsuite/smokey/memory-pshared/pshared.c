@@ -3,15 +3,31 @@
  *
  * SPDX-License-Identifier: MIT
  */
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
 #include <xenomai/init.h>
 #include <xenomai/tunables.h>
+#include <boilerplate/time.h>
 #include <copperplate/heapobj.h>
 #include "memcheck/memcheck.h"
 
 smokey_test_plugin(memory_pshared,
-		   MEMCHECK_ARGS,
-		   "Check for the pshared allocator sanity.\n"
+		   SMOKEY_ARGLIST(
+			   MEMCHECK_ARG_ITEMS,
+			   SMOKEY_SIZE(grow_size),
+		   ),
+		   "Check for the pshared allocator sanity, then measure\n"
+		   "\tallocation latency and dTLB misses while growing the main heap,\n"
+		   "\tand share the grown heap with another process.\n"
 		   MEMCHECK_HELP_STRINGS
+		   "\tgrow_size=<size[K|M|G]>\tmain heap memory to allocate when growing\n"
 	);
 
 #define MIN_HEAP_SIZE  8192
@@ -21,6 +37,10 @@ smokey_test_plugin(memory_pshared,
 #define PATTERN_HEAP_SIZE  (128*1024)
 #define PATTERN_ROUNDS     128
 
+#define GROW_BLOCK_SIZE    4096
+#define GROW_WALK_ROUNDS   16
+#define GROW_WALK_STRIDE   7919	/* prime */
+
 static struct heapobj heap;
 
 static int do_pshared_init(void *heap, void *mem, size_t arena_size)
@@ -96,10 +116,274 @@ static struct memcheck_descriptor pshared_descriptor = {
 	.heap = &heap,
 };
 
+static inline long diff_ts(struct timespec *left, struct timespec *right)
+{
+	return (long long)(left->tv_sec - right->tv_sec) * ONE_BILLION
+		+ left->tv_nsec - right->tv_nsec;
+}
+
+static int open_dtlb_counter(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = PERF_TYPE_HW_CACHE;
+	attr.config = PERF_COUNT_HW_CACHE_DTLB |
+		(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+		(PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static int check_blocks(void **blocks, int nrblocks, int seed)
+{
+	unsigned char *p;
+	int n, i;
+
+	for (n = 0; n < nrblocks; n++) {
+		p = blocks[n];
+		for (i = 0; i < GROW_BLOCK_SIZE; i++) {
+			if (p[i] != (unsigned char)(n + seed))
+				return -EINVAL;
+		}
+	}
+
+	return 0;
+}
+
+static int grow_peer(memoff_t *offs, int nrblocks, int wfd)
+{
+	void **blocks;
+	int n, ret;
+
+	/*
+	 * Drop the mapping inherited from the parent and bind to the
+	 * session heap like any other process would, so that we only
+	 * see what the shared header tells us.
+	 */
+	heapobj_unbind_session();
+	ret = heapobj_bind_session(get_config_tunable(session_label));
+	if (ret)
+		return ret;
+
+	blocks = calloc(nrblocks, sizeof(*blocks));
+	if (blocks == NULL)
+		return -ENOMEM;
+
+	/* Check the extents the parent added. */
+	for (n = 0; n < nrblocks; n++)
+		blocks[n] = __mptr(offs[n]);
+
+	ret = check_blocks(blocks, nrblocks, 0);
+	if (ret)
+		goto out;
+
+	/* Grow the heap further from this side. */
+	for (n = 0; n < nrblocks; n++) {
+		blocks[n] = xnmalloc(GROW_BLOCK_SIZE);
+		if (blocks[n] == NULL) {
+			ret = -ENOMEM;
+			goto out;
+		}
+		memset(blocks[n], n + 1, GROW_BLOCK_SIZE);
+		offs[n] = __moff(blocks[n]);
+	}
+
+	if (write(wfd, offs, nrblocks * sizeof(*offs)) !=
+	    (ssize_t)(nrblocks * sizeof(*offs)))
+		ret = -EIO;
+out:
+	free(blocks);
+
+	return ret;
+}
+
+/*
+ * Have a peer process bind to the session, read the blocks we
+ * allocated from the grown heap, then grow it further on its end.
+ * We must see the peer's blocks at the same offsets.
+ */
+static int run_grow_share(void **blocks, int nrblocks)
+{
+	int n, status, pfd[2], ret = 0;
+	void **peer_blocks;
+	memoff_t *offs;
+	ssize_t len;
+	pid_t pid;
+
+	offs = calloc(nrblocks, sizeof(*offs));
+	peer_blocks = calloc(nrblocks, sizeof(*peer_blocks));
+	if (offs == NULL || peer_blocks == NULL) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	for (n = 0; n < nrblocks; n++) {
+		memset(blocks[n], n, GROW_BLOCK_SIZE);
+		offs[n] = __moff(blocks[n]);
+	}
+
+	if (pipe(pfd)) {
+		ret = -errno;
+		goto out;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		ret = -errno;
+		close(pfd[0]);
+		close(pfd[1]);
+		goto out;
+	}
+
+	if (pid == 0) {
+		close(pfd[0]);
+		ret = grow_peer(offs, nrblocks, pfd[1]);
+		_exit(ret ? 1 : 0);
+	}
+
+	close(pfd[1]);
+	len = read(pfd[0], offs, nrblocks * sizeof(*offs));
+	close(pfd[0]);
+
+	if (waitpid(pid, &status, 0) < 0) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) ||
+	    len != (ssize_t)(nrblocks * sizeof(*offs))) {
+		smokey_warning("peer process failed to share the grown heap");
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (n = 0; n < nrblocks; n++)
+		peer_blocks[n] = __mptr(offs[n]);
+
+	ret = check_blocks(peer_blocks, nrblocks, 1);
+	if (ret)
+		smokey_warning("peer blocks do not match");
+	else
+		smokey_trace("     %d blocks shared with a peer process, "
+			     "heap grown from both ends", nrblocks);
+
+	/* The peer is gone, its blocks are ours to release. */
+	for (n = 0; n < nrblocks; n++)
+		xnfree(peer_blocks[n]);
+out:
+	free(peer_blocks);
+	free(offs);
+
+	return ret;
+}
+
+/*
+ * Allocate grow_size bytes from the main heap in page-sized blocks,
+ * which is more than it was initially given, then walk the blocks
+ * in scattered order. Compare runs with and without
+ * --mem-pool-hugepages to figure out the difference in allocation
+ * latency and dTLB misses.
+ */
+static int run_grow_bench(size_t grow_size)
+{
+	int nrblocks, n, round, fd, ret = 0;
+	unsigned long long misses;
+	struct timespec start, end;
+	long long total_ns = 0;
+	volatile char *p;
+	long ns, max_ns = 0;
+	void **blocks;
+	char sum = 0;
+
+	nrblocks = grow_size / GROW_BLOCK_SIZE;
+	if (nrblocks == 0)
+		return -EINVAL;
+
+	blocks = calloc(nrblocks, sizeof(*blocks));
+	if (blocks == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < nrblocks; n++) {
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		blocks[n] = xnmalloc(GROW_BLOCK_SIZE);
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (blocks[n] == NULL) {
+			smokey_warning("main heap did not grow past %zu bytes",
+				       (size_t)n * GROW_BLOCK_SIZE);
+			ret = -ENOMEM;
+			goto out;
+		}
+		ns = diff_ts(&end, &start);
+		total_ns += ns;
+		if (ns > max_ns)
+			max_ns = ns;
+		memset(blocks[n], n, GROW_BLOCK_SIZE);
+	}
+
+	smokey_trace("== main heap growth, %s pages",
+		     get_config_tunable(mem_pool_hugepages) ? "huge" : "normal");
+	smokey_trace("     %d allocations of %d bytes, avg %.3f us, max %.3f us",
+		     nrblocks, GROW_BLOCK_SIZE,
+		     (double)total_ns / nrblocks / 1000.0,
+		     (double)max_ns / 1000.0);
+
+	fd = open_dtlb_counter();
+	if (fd < 0) {
+		smokey_trace("     dTLB miss counter unavailable: %s",
+			     strerror(errno));
+		goto share;
+	}
+
+	ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+	ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+
+	for (round = 0; round < GROW_WALK_ROUNDS; round++) {
+		for (n = 0; n < nrblocks; n++) {
+			p = blocks[(long)n * GROW_WALK_STRIDE % nrblocks];
+			sum += p[(n * 64) % GROW_BLOCK_SIZE];
+		}
+	}
+
+	ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+	if (read(fd, &misses, sizeof(misses)) == sizeof(misses))
+		smokey_trace("     %llu dTLB read misses over %d accesses "
+			     "(%.4f per access, sum=%d)",
+			     misses, nrblocks * GROW_WALK_ROUNDS,
+			     (double)misses / (nrblocks * GROW_WALK_ROUNDS), sum);
+	close(fd);
+share:
+	ret = run_grow_share(blocks, nrblocks);
+out:
+	for (n = 0; n < nrblocks && blocks[n]; n++)
+		xnfree(blocks[n]);
+
+	free(blocks);
+
+	return ret;
+}
+
 static int run_memory_pshared(struct smokey_test *t,
 			      int argc, char *const argv[])
 {
-	return memcheck_run(&pshared_descriptor, t, argc, argv);
+	size_t grow_size;
+	int ret;
+
+	ret = memcheck_run(&pshared_descriptor, t, argc, argv);
+	if (ret)
+		return ret;
+
+	/* The main heap is left mostly idle by memcheck. */
+	grow_size = 4 * get_config_tunable(mem_pool_size);
+	if (smokey_arg_isset(t, "grow_size"))
+		grow_size = smokey_arg_size(t, "grow_size");
+
+	return run_grow_bench(grow_size);
 }
 
 static int memcheck_pshared_tune(void)
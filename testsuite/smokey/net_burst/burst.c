@@ -0,0 +1,239 @@
+/*
+ * RTnet burst transmission test over the loopback driver
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <netinet/in.h>
+
+#include <sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_burst,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(rtnet_burst),
+		SMOKEY_INT(rtnet_bursts),
+	),
+	"Measure the RTnet UDP burst transmission rate over the loopback\n"
+	"\tdriver, sending each burst with one sendto() call per frame,\n"
+	"\tthen as a single batched sendmmsg() call,\n"
+	"\tthe rtnet_burst parameter sets the frames per burst (default 20)\n"
+	"\tthe rtnet_bursts parameter sets the number of bursts (default 10000)"
+);
+
+#define PORT		37000
+#define PAYLOAD_SIZE	64
+#define MAX_BURST	256
+
+struct burst {
+	int sock;
+	struct sockaddr_in peer;
+	unsigned int seq;
+	unsigned int frames[MAX_BURST][PAYLOAD_SIZE / sizeof(unsigned int)];
+	struct iovec iov[MAX_BURST];
+	struct mmsghdr msgs[MAX_BURST];
+};
+
+static int send_single(struct burst *b, int count)
+{
+	int n, ret;
+
+	for (n = 0; n < count; n++) {
+		ret = __RT(sendto(b->sock, b->frames[n], PAYLOAD_SIZE, 0,
+				  (struct sockaddr *)&b->peer,
+				  sizeof(b->peer)));
+		if (ret < 0)
+			return -errno;
+	}
+
+	return 0;
+}
+
+static int send_batched(struct burst *b, int count)
+{
+	int ret;
+
+	ret = __RT(sendmmsg(b->sock, b->msgs, count, 0));
+	if (ret < 0)
+		return -errno;
+
+	return ret == count ? 0 : -EPROTO;
+}
+
+static int receive_burst(struct burst *b, int count)
+{
+	unsigned int buf[PAYLOAD_SIZE / sizeof(unsigned int)];
+	int n, ret;
+
+	for (n = 0; n < count; n++, b->seq++) {
+		ret = __RT(recv(b->sock, buf, sizeof(buf), 0));
+		if (ret < 0)
+			return -errno;
+		if (ret != PAYLOAD_SIZE || buf[0] != b->seq) {
+			smokey_warning("got frame #%u, expected #%u",
+				       buf[0], b->seq);
+			return -EPROTO;
+		}
+	}
+
+	return 0;
+}
+
+static int run_mode(struct burst *b, int count, int bursts, int batched)
+{
+	unsigned long long elapsed = 0, max = 0, dt;
+	struct timespec start, end, delta;
+	int n, k, ret = 0;
+
+	for (n = 0; n < bursts; n++) {
+		for (k = 0; k < count; k++)
+			b->frames[k][0] = b->seq + k;
+
+		__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+		if (batched)
+			ret = send_batched(b, count);
+		else
+			ret = send_single(b, count);
+		__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+		if (ret) {
+			smokey_warning("%s: burst #%d: %s",
+				       batched ? "sendmmsg" : "sendto",
+				       n, symerror(ret));
+			return ret;
+		}
+
+		timespec_sub(&delta, &end, &start);
+		dt = timespec_scalar(&delta);
+		elapsed += dt;
+		if (dt > max)
+			max = dt;
+
+		ret = receive_burst(b, count);
+		if (ret)
+			return ret;
+	}
+
+	smokey_trace("%-8s %3d frames/burst: %9llu frames/s, "
+		     "burst avg %7llu ns, max %8llu ns",
+		     batched ? "sendmmsg" : "sendto", count,
+		     (unsigned long long)count * bursts * 1000000000ULL /
+		     (elapsed ?: 1), elapsed / bursts, max);
+
+	return 0;
+}
+
+static int open_socket(struct sockaddr_in *addr, unsigned int extra_rtskbs)
+{
+	int64_t timeout = 1000000000; /* never wait forever */
+	int sock, ret;
+
+	sock = smokey_check_errno(__RT(socket(PF_INET, SOCK_DGRAM, 0)));
+	if (sock < 0)
+		return sock;
+
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)addr, sizeof(*addr))));
+	if (ret < 0)
+		goto fail;
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0)
+		goto fail;
+
+	/* a whole burst may be queued for reception */
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_EXTPOOL, &extra_rtskbs)));
+	if (ret < 0)
+		goto fail;
+
+	return sock;
+fail:
+	__RT(close(sock));
+
+	return ret;
+}
+
+static int run_net_burst(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct sched_param param = { .sched_priority = 50 };
+	int count = 20, bursts = 10000, err, err_teardown, n;
+	struct sockaddr_in peer;
+	struct burst *b;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_burst, rtnet_burst))
+		count = SMOKEY_ARG_INT(net_burst, rtnet_burst);
+
+	if (SMOKEY_ARG_ISSET(net_burst, rtnet_bursts))
+		bursts = SMOKEY_ARG_INT(net_burst, rtnet_bursts);
+
+	if (count <= 0 || count > MAX_BURST || bursts <= 0)
+		return -EINVAL;
+
+	b = calloc(1, sizeof(*b));
+	if (b == NULL)
+		return -ENOMEM;
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons(PORT);
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	smokey_trace("Configuring interface rtlo (driver rt_loopback)");
+
+	err = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_UDP, &peer);
+	if (err < 0)
+		goto out;
+
+	b->peer = peer;
+	b->sock = open_socket(&peer, count * 2);
+	if (b->sock < 0) {
+		err = b->sock;
+		goto teardown;
+	}
+
+	for (n = 0; n < count; n++) {
+		b->iov[n].iov_base = b->frames[n];
+		b->iov[n].iov_len = PAYLOAD_SIZE;
+		b->msgs[n].msg_hdr.msg_name = &b->peer;
+		b->msgs[n].msg_hdr.msg_namelen = sizeof(b->peer);
+		b->msgs[n].msg_hdr.msg_iov = &b->iov[n];
+		b->msgs[n].msg_hdr.msg_iovlen = 1;
+	}
+
+	err = smokey_check_status(
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+	if (err)
+		goto close;
+
+	err = run_mode(b, count, bursts, 0);
+	if (err == 0)
+		err = run_mode(b, count, bursts, 1);
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+close:
+	__RT(close(b->sock));
+teardown:
+	err_teardown = smokey_net_teardown("rt_loopback", "rtlo",
+					   _CC_COBALT_NET_UDP);
+	if (err == 0)
+		err = err_teardown;
+out:
+	free(b);
+
+	return err;
+}
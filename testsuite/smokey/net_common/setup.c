@@ -45,6 +45,10 @@ static struct module modules[] = {
 		.option = _CC_COBALT_NET_AF_PACKET,
 		.name = "rtpacket",
 	},
+	{
+		.option = _CC_COBALT_NET_TCP,
+		.name = "rttcp",
+	},
 };
 
 static const char *option_to_module(int option)
@@ -0,0 +1,424 @@
+/*
+ * RTnet AF_PACKET frame ring test over the loopback driver
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <net/ethernet.h>
+#include <netinet/in.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netpacket/packet.h>
+
+#include <sys/cobalt.h>
+#include <boilerplate/atomic.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_packet_mmap,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(rtnet_frames),
+		SMOKEY_INT(rtnet_batch),
+	),
+	"Check the memory-mapped frame rings of RTnet raw packet sockets\n"
+	"\tover the loopback driver, then compare the frame rate and\n"
+	"\tper-frame latency with regular send()/recv() calls,\n"
+	"\tthe rtnet_frames parameter sets the frames per run (default 100000)\n"
+	"\tthe rtnet_batch parameter sets the frames per kick (default 16)"
+);
+
+#define MMAP_PROTO	(ETH_P_802_EX1 + 2)
+#define FRAME_SIZE	2048
+#define PAYLOAD_SIZE	64
+
+struct bench_frame {
+	struct ethhdr eth;
+	unsigned int seq;
+	unsigned long long sent;
+	char pad[PAYLOAD_SIZE - sizeof(unsigned int) -
+		 sizeof(unsigned long long)];
+} __attribute__((packed));
+
+struct bench {
+	int sock;
+	struct ethhdr eth;
+	void *map;
+	size_t mapsz;
+	unsigned int rx_frames;
+	unsigned int tx_frames;
+	unsigned int rx_head;
+	unsigned int tx_head;
+	unsigned long long lat_sum;
+	unsigned long long lat_max;
+};
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	__RT(clock_gettime(CLOCK_MONOTONIC, &ts));
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static struct rtnet_packet_hdr *rx_slot(struct bench *b, unsigned int n)
+{
+	return b->map + n * FRAME_SIZE;
+}
+
+static struct rtnet_packet_hdr *tx_slot(struct bench *b, unsigned int n)
+{
+	return b->map + (b->rx_frames + n) * FRAME_SIZE;
+}
+
+static int open_socket(struct bench *b)
+{
+	int64_t timeout = 1000000000; /* never wait forever */
+	struct sockaddr_ll sll;
+	struct ifreq ifr;
+	int sock, ret;
+
+	sock = smokey_check_errno(
+		__RT(socket(PF_PACKET, SOCK_RAW, htons(MMAP_PROTO))));
+	if (sock < 0)
+		return sock;
+
+	snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "rtlo");
+	ret = smokey_check_errno(__RT(ioctl(sock, SIOCGIFINDEX, &ifr)));
+	if (ret < 0)
+		goto fail;
+
+	memset(&sll, 0, sizeof(sll));
+	sll.sll_family = AF_PACKET;
+	sll.sll_protocol = htons(MMAP_PROTO);
+	sll.sll_ifindex = ifr.ifr_ifindex;
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)&sll, sizeof(sll))));
+	if (ret < 0)
+		goto fail;
+
+	ret = smokey_check_errno(__RT(ioctl(sock, SIOCGIFHWADDR, &ifr)));
+	if (ret < 0)
+		goto fail;
+
+	/* Loop frames back to ourselves. */
+	memcpy(b->eth.h_dest, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+	memcpy(b->eth.h_source, ifr.ifr_hwaddr.sa_data, ETH_ALEN);
+	b->eth.h_proto = htons(MMAP_PROTO);
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0)
+		goto fail;
+
+	b->sock = sock;
+
+	return 0;
+fail:
+	__RT(close(sock));
+
+	return ret;
+}
+
+static int setup_rings(struct bench *b, unsigned int batch)
+{
+	struct rtnet_packet_ring_req req;
+	int ret;
+
+	b->rx_frames = batch * 2;
+	b->tx_frames = batch;
+	b->rx_head = b->tx_head = 0;
+
+	/* Slots must be able to carry a full header. */
+	req.frame_size = RTPACKET_HDRLEN;
+	req.rx_frames = b->rx_frames;
+	req.tx_frames = b->tx_frames;
+	if (!__Tassert(__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_RING,
+				  &req)) == -1 && errno == EINVAL))
+		return -EPROTO;
+
+	if (!__Tassert(__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_KICK)) == -1 &&
+		       errno == ENXIO))
+		return -EPROTO;
+
+	req.frame_size = FRAME_SIZE;
+	ret = smokey_check_errno(
+		__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_RING, &req)));
+	if (ret < 0)
+		return ret;
+
+	if (!__Tassert(__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_RING,
+				  &req)) == -1 && errno == EBUSY))
+		return -EPROTO;
+
+	b->mapsz = (size_t)(b->rx_frames + b->tx_frames) * FRAME_SIZE;
+	b->map = mmap(NULL, b->mapsz, PROT_READ|PROT_WRITE, MAP_SHARED,
+		      b->sock, 0);
+	if (!__Fassert(b->map == MAP_FAILED))
+		return -errno;
+
+	return 0;
+}
+
+static void queue_frame(struct bench *b, unsigned int seq, size_t len)
+{
+	struct rtnet_packet_hdr *hdr = tx_slot(b, b->tx_head);
+	struct bench_frame *f = (void *)hdr + RTPACKET_HDRLEN;
+
+	f->eth = b->eth;
+	f->seq = seq;
+	f->sent = now_ns();
+	hdr->len = len;
+	smp_wmb();
+	hdr->status = RTPACKET_TX_SEND_REQUEST;
+
+	if (++b->tx_head == b->tx_frames)
+		b->tx_head = 0;
+}
+
+static int check_frame(struct bench *b, const struct bench_frame *f,
+		       size_t len, unsigned int seq)
+{
+	unsigned long long lat;
+
+	if (!__Tassert(len == sizeof(*f)) ||
+	    !__Tassert(f->eth.h_proto == htons(MMAP_PROTO))) {
+		smokey_warning("bad frame #%u, %zu bytes", seq, len);
+		return -EPROTO;
+	}
+
+	if (f->seq != seq) {
+		smokey_warning("got frame #%u, expected #%u", f->seq, seq);
+		return -EPROTO;
+	}
+
+	lat = now_ns() - f->sent;
+	b->lat_sum += lat;
+	if (lat > b->lat_max)
+		b->lat_max = lat;
+
+	return 0;
+}
+
+static int receive_frame(struct bench *b, unsigned int seq)
+{
+	struct rtnet_packet_hdr *hdr = rx_slot(b, b->rx_head);
+	unsigned int status;
+	int ret;
+
+	/* Spin over the status word, block only if the slot is empty. */
+	status = hdr->status;
+	if ((status & RTPACKET_STATUS_USER) == 0) {
+		ret = smokey_check_errno(
+			__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_WAIT,
+				   &b->rx_head)));
+		if (ret < 0)
+			return ret;
+		status = hdr->status;
+	}
+
+	smp_rmb();
+
+	if (!__Tassert(status == RTPACKET_STATUS_USER)) {
+		smokey_warning("frame #%u: status %#x", seq, status);
+		return -EPROTO;
+	}
+
+	ret = check_frame(b, (void *)hdr + RTPACKET_HDRLEN, hdr->snaplen, seq);
+
+	smp_mb();
+	hdr->status = RTPACKET_STATUS_KERNEL;
+
+	if (++b->rx_head == b->rx_frames)
+		b->rx_head = 0;
+
+	return ret;
+}
+
+static int check_wrong_format(struct bench *b)
+{
+	struct rtnet_packet_hdr *hdr = tx_slot(b, b->tx_head);
+	int ret;
+
+	/* Does not fit into the slot, let alone into the MTU. */
+	queue_frame(b, 0, FRAME_SIZE);
+
+	ret = __RT(ioctl(b->sock, RTNET_RTIOC_PACKET_KICK));
+	if (!__Tassert(ret == 0) ||
+	    !__Tassert(hdr->status == RTPACKET_TX_WRONG_FORMAT))
+		return -EPROTO;
+
+	hdr->status = RTPACKET_TX_AVAILABLE;
+
+	return 0;
+}
+
+static int run_rings(struct bench *b, unsigned int frames,
+		     unsigned int batch)
+{
+	unsigned int seq, n, count;
+	int ret;
+
+	for (seq = 0; seq < frames; seq += count) {
+		count = frames - seq < batch ? frames - seq : batch;
+		for (n = 0; n < count; n++)
+			queue_frame(b, seq + n, sizeof(struct bench_frame));
+
+		ret = smokey_check_errno(
+			__RT(ioctl(b->sock, RTNET_RTIOC_PACKET_KICK)));
+		if (ret < 0)
+			return ret;
+		if (!__Tassert(ret == (int)count))
+			return -EPROTO;
+
+		for (n = 0; n < count; n++) {
+			ret = receive_frame(b, seq + n);
+			if (ret)
+				return ret;
+		}
+	}
+
+	return 0;
+}
+
+static int run_calls(struct bench *b, unsigned int frames)
+{
+	struct bench_frame f;
+	unsigned int seq;
+	int ret;
+
+	memset(&f, 0, sizeof(f));
+	f.eth = b->eth;
+
+	for (seq = 0; seq < frames; seq++) {
+		f.seq = seq;
+		f.sent = now_ns();
+		ret = smokey_check_errno(
+			__RT(send(b->sock, &f, sizeof(f), 0)));
+		if (ret < 0)
+			return ret;
+
+		ret = smokey_check_errno(
+			__RT(recv(b->sock, &f, sizeof(f), 0)));
+		if (ret < 0)
+			return ret;
+
+		ret = check_frame(b, &f, ret, seq);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+static int run_bench(unsigned int frames, unsigned int batch)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	unsigned long long start, elapsed;
+	struct bench b;
+	int ret;
+
+	memset(&b, 0, sizeof(b));
+
+	ret = open_socket(&b);
+	if (ret)
+		return ret;
+
+	ret = smokey_check_status(
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+	if (ret)
+		goto close;
+
+	if (batch) {
+		ret = setup_rings(&b, batch);
+		if (ret)
+			goto sched;
+
+		ret = check_wrong_format(&b);
+		if (ret)
+			goto unmap;
+	}
+
+	start = now_ns();
+	ret = batch ? run_rings(&b, frames, batch) : run_calls(&b, frames);
+	elapsed = now_ns() - start;
+	if (ret)
+		goto unmap;
+
+	if (batch)
+		smokey_trace("rings, batch %4u: %9llu frames/s, "
+			     "avg %6llu ns, max %8llu ns",
+			     batch, frames * 1000000000ULL / (elapsed ?: 1),
+			     b.lat_sum / frames, b.lat_max);
+	else
+		smokey_trace("send()/recv():    %9llu frames/s, "
+			     "avg %6llu ns, max %8llu ns",
+			     frames * 1000000000ULL / (elapsed ?: 1),
+			     b.lat_sum / frames, b.lat_max);
+unmap:
+	if (b.map)
+		munmap(b.map, b.mapsz);
+sched:
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+close:
+	__RT(close(b.sock));
+
+	return ret;
+}
+
+static int
+run_net_packet_mmap(struct smokey_test *t, int argc, char *const argv[])
+{
+	int frames = 100000, batch = 16, err, err_teardown, n;
+	struct sockaddr_in peer;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_packet_mmap, rtnet_frames))
+		frames = SMOKEY_ARG_INT(net_packet_mmap, rtnet_frames);
+
+	if (SMOKEY_ARG_ISSET(net_packet_mmap, rtnet_batch))
+		batch = SMOKEY_ARG_INT(net_packet_mmap, rtnet_batch);
+
+	if (frames <= 0 || batch <= 0 || batch > RTPACKET_RING_MAX / 2)
+		return -EINVAL;
+
+	/* We only need rtlo up and AF_PACKET loaded, not a peer. */
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	smokey_trace("Configuring interface rtlo (driver rt_loopback)");
+
+	err = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_AF_PACKET, &peer);
+	if (err < 0)
+		return err;
+
+	err = run_bench(frames, 0);
+
+	for (n = 1; n <= batch && err == 0; n *= 2)
+		err = run_bench(frames, n);
+
+	if (err == 0 && n / 2 != batch)
+		err = run_bench(frames, batch);
+
+	err_teardown = smokey_net_teardown("rt_loopback", "rtlo",
+					   _CC_COBALT_NET_AF_PACKET);
+	if (err == 0)
+		err = err_teardown;
+
+	return err;
+}
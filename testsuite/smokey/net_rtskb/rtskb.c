@@ -0,0 +1,307 @@
+/*
+ * RTnet packet rate test over the loopback driver
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <netinet/in.h>
+
+#include <sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_rtskb,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(rtnet_duration),
+		SMOKEY_INT(rtnet_cpus),
+	),
+	"Measure the RTnet packet rate over the loopback driver with\n"
+	"\t1 to N CPUs sending UDP packets to themselves, first on private\n"
+	"\tsockets, then on a single shared socket,\n"
+	"\tthe rtnet_duration parameter sets the seconds per step (default 1)\n"
+	"\tthe rtnet_cpus parameter sets the maximum number of CPUs"
+);
+
+#define PORT_BASE	35000
+#define PAYLOAD_SIZE	64
+
+struct worker {
+	pthread_t tid;
+	int cpu;
+	int sock;
+	struct sockaddr_in peer;
+	struct timespec start;
+	struct timespec end;
+	unsigned long long packets;
+	int err;
+};
+
+static void *worker_loop(void *arg)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	struct worker *w = arg;
+	char buf[PAYLOAD_SIZE];
+	struct timespec now;
+	cpu_set_t cpus;
+	int ret;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(w->cpu, &cpus);
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	if (ret == 0)
+		ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret) {
+		w->err = -ret;
+		return NULL;
+	}
+
+	memset(buf, 0, sizeof(buf));
+
+	/*
+	 * Loopback delivery is synchronous, so the workers never sleep
+	 * while running: they stop on their own at the deadline.
+	 */
+	__RT(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &w->start, NULL));
+
+	for (;;) {
+		__RT(clock_gettime(CLOCK_MONOTONIC, &now));
+		if (!timespec_before(&now, &w->end))
+			break;
+		ret = __RT(sendto(w->sock, buf, sizeof(buf), 0,
+				  (struct sockaddr *)&w->peer,
+				  sizeof(w->peer)));
+		if (ret < 0) {
+			w->err = -errno;
+			break;
+		}
+		ret = __RT(recv(w->sock, buf, sizeof(buf), 0));
+		if (ret < 0) {
+			w->err = -errno;
+			break;
+		}
+		w->packets++;
+	}
+
+	return NULL;
+}
+
+static int open_socket(struct sockaddr_in *addr, unsigned int extra_rtskbs)
+{
+	int64_t timeout = 1000000000; /* never wait forever */
+	int sock, ret;
+
+	sock = smokey_check_errno(__RT(socket(PF_INET, SOCK_DGRAM, 0)));
+	if (sock < 0)
+		return sock;
+
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)addr, sizeof(*addr))));
+	if (ret < 0)
+		goto fail;
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0)
+		goto fail;
+
+	if (extra_rtskbs > 0) {
+		ret = smokey_check_errno(
+			__RT(ioctl(sock, RTNET_RTIOC_EXTPOOL, &extra_rtskbs)));
+		if (ret < 0)
+			goto fail;
+	}
+
+	return sock;
+fail:
+	__RT(close(sock));
+
+	return ret;
+}
+
+/*
+ * Sum the shared queue lock acquisitions over all CPUs and get the
+ * longest hold time, if the rtskb statistics are enabled.
+ */
+static int read_lock_stats(unsigned long long *locked,
+			   unsigned long long *hold_max)
+{
+	unsigned long long v[7];
+	char line[256];
+	int cpu, ret = -ENOENT;
+	FILE *fp;
+
+	fp = fopen("/proc/rtnet/rtskb", "r");
+	if (fp == NULL)
+		return -errno;
+
+	*locked = *hold_max = 0;
+	while (fgets(line, sizeof(line), fp)) {
+		if (sscanf(line, "%d %llu %llu %llu %llu %llu %llu %llu",
+			   &cpu, &v[0], &v[1], &v[2], &v[3],
+			   &v[4], &v[5], &v[6]) != 8)
+			continue;
+		*locked += v[4];
+		if (v[6] > *hold_max)
+			*hold_max = v[6];
+		ret = 0;
+	}
+
+	fclose(fp);
+
+	return ret;
+}
+
+static int run_step(const struct sockaddr_in *peer, const int *cpu_list,
+		    int nr_cpus, int shared, int duration)
+{
+	unsigned long long total = 0, locked[2], hold_max;
+	struct worker *workers, *w;
+	int ret = 0, n, stats, shared_sock = -1;
+	struct sockaddr_in addr;
+	struct timespec start, now;
+
+	workers = calloc(nr_cpus, sizeof(*workers));
+	if (workers == NULL)
+		return -ENOMEM;
+
+	addr = *peer;
+	if (shared) {
+		addr.sin_port = htons(PORT_BASE);
+		shared_sock = open_socket(&addr, 4 * nr_cpus);
+		if (shared_sock < 0) {
+			ret = shared_sock;
+			goto out;
+		}
+	}
+
+	for (n = 0; n < nr_cpus; n++) {
+		w = workers + n;
+		w->cpu = cpu_list[n];
+		w->peer = addr;
+		if (shared) {
+			w->sock = shared_sock;
+			continue;
+		}
+		w->peer.sin_port = htons(PORT_BASE + 1 + n);
+		w->sock = open_socket(&w->peer, 0);
+		if (w->sock < 0) {
+			ret = w->sock;
+			goto close;
+		}
+	}
+
+	stats = read_lock_stats(&locked[0], &hold_max) == 0;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timespec_adds(&start, &now, 100000000);
+
+	for (n = 0; n < nr_cpus; n++) {
+		w = workers + n;
+		w->start = start;
+		w->end = start;
+		w->end.tv_sec += duration;
+		ret = smokey_check_status(
+			__RT(pthread_create(&w->tid, NULL, worker_loop, w)));
+		if (ret < 0) {
+			while (--n >= 0)
+				pthread_join(workers[n].tid, NULL);
+			goto close;
+		}
+	}
+
+	for (n = 0; n < nr_cpus; n++) {
+		w = workers + n;
+		pthread_join(w->tid, NULL);
+		if (w->err && ret == 0) {
+			smokey_warning("worker on CPU%d: %s",
+				       w->cpu, strerror(-w->err));
+			ret = w->err;
+		}
+		if (!__Tassert(w->packets > 0) && ret == 0)
+			ret = -EPROTO;
+		total += w->packets;
+	}
+
+	if (ret)
+		goto close;
+
+	if (stats && read_lock_stats(&locked[1], &hold_max) == 0)
+		smokey_trace("%2d CPU(s), %s: %10llu pps, %8llu pps/CPU, "
+			     "%8llu locks/s, max hold %llu ns",
+			     nr_cpus, shared ? "shared socket  " : "private sockets",
+			     total / duration, total / duration / nr_cpus,
+			     (locked[1] - locked[0]) / duration, hold_max);
+	else
+		smokey_trace("%2d CPU(s), %s: %10llu pps, %8llu pps/CPU",
+			     nr_cpus, shared ? "shared socket  " : "private sockets",
+			     total / duration, total / duration / nr_cpus);
+close:
+	for (n = 0; n < nr_cpus && !shared; n++)
+		if (workers[n].sock > 0)
+			__RT(close(workers[n].sock));
+	if (shared_sock >= 0)
+		__RT(close(shared_sock));
+out:
+	free(workers);
+
+	return ret;
+}
+
+static int
+run_net_rtskb(struct smokey_test *t, int argc, char *const argv[])
+{
+	int duration = 1, max_cpus = CPU_SETSIZE, nr_cpus = 0, cpu;
+	int cpu_list[CPU_SETSIZE], err, err_teardown, n, shared;
+	struct sockaddr_in peer;
+	cpu_set_t cpus;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_rtskb, rtnet_duration))
+		duration = SMOKEY_ARG_INT(net_rtskb, rtnet_duration);
+
+	if (SMOKEY_ARG_ISSET(net_rtskb, rtnet_cpus))
+		max_cpus = SMOKEY_ARG_INT(net_rtskb, rtnet_cpus);
+
+	if (duration <= 0 || max_cpus <= 0)
+		return -EINVAL;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	for (cpu = 0; cpu < CPU_SETSIZE && nr_cpus < max_cpus; cpu++)
+		if (CPU_ISSET(cpu, &cpus))
+			cpu_list[nr_cpus++] = cpu;
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons(7);
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	smokey_trace("Configuring interface rtlo (driver rt_loopback)");
+
+	err = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_UDP, &peer);
+	if (err < 0)
+		return err;
+
+	for (shared = 0; shared < 2 && err == 0; shared++)
+		for (n = 1; n <= nr_cpus && err == 0; n++)
+			err = run_step(&peer, cpu_list, n, shared, duration);
+
+	err_teardown = smokey_net_teardown("rt_loopback", "rtlo",
+					   _CC_COBALT_NET_UDP);
+	if (err == 0)
+		err = err_teardown;
+
+	return err;
+}
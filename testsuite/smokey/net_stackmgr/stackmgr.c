@@ -0,0 +1,316 @@
+/*
+ * RTnet stack manager scaling test over the loopback driver
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <netinet/in.h>
+
+#include <sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_stackmgr,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(rtnet_duration),
+		SMOKEY_INT(rtnet_flows),
+	),
+	"Measure the RTnet UDP round-trip rate and latency over the\n"
+	"\tloopback driver, first with direct delivery, then with the\n"
+	"\tflows spread over 1 to N stack managers,\n"
+	"\tthe rtnet_duration parameter sets the seconds per step (default 1)\n"
+	"\tthe rtnet_flows parameter sets the number of flows (default N)"
+);
+
+#define STACK_MGR_PROC	"/proc/rtnet/stack_mgr"
+#define PORT_BASE	36000
+#define PAYLOAD_SIZE	64
+
+struct flow {
+	pthread_t tid;
+	int cpu;
+	int sock;
+	struct sockaddr_in peer;
+	struct timespec start;
+	struct timespec end;
+	unsigned long long packets;
+	unsigned long long rtt_sum;
+	unsigned long long rtt_max;
+	int err;
+};
+
+static void *flow_loop(void *arg)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	struct timespec now, sent, delta;
+	struct flow *f = arg;
+	char buf[PAYLOAD_SIZE];
+	unsigned long long rtt;
+	cpu_set_t cpus;
+	int ret;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(f->cpu, &cpus);
+	ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	if (ret == 0)
+		ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret) {
+		f->err = -ret;
+		return NULL;
+	}
+
+	memset(buf, 0, sizeof(buf));
+
+	__RT(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &f->start, NULL));
+
+	for (;;) {
+		__RT(clock_gettime(CLOCK_MONOTONIC, &sent));
+		if (!timespec_before(&sent, &f->end))
+			break;
+		ret = __RT(sendto(f->sock, buf, sizeof(buf), 0,
+				  (struct sockaddr *)&f->peer,
+				  sizeof(f->peer)));
+		if (ret < 0) {
+			f->err = -errno;
+			break;
+		}
+		ret = __RT(recv(f->sock, buf, sizeof(buf), 0));
+		if (ret < 0) {
+			f->err = -errno;
+			break;
+		}
+		__RT(clock_gettime(CLOCK_MONOTONIC, &now));
+		timespec_sub(&delta, &now, &sent);
+		rtt = timespec_scalar(&delta);
+		f->rtt_sum += rtt;
+		if (rtt > f->rtt_max)
+			f->rtt_max = rtt;
+		f->packets++;
+	}
+
+	return NULL;
+}
+
+static int open_socket(struct sockaddr_in *addr)
+{
+	int64_t timeout = 1000000000; /* never wait forever */
+	int sock, ret;
+
+	sock = smokey_check_errno(__RT(socket(PF_INET, SOCK_DGRAM, 0)));
+	if (sock < 0)
+		return sock;
+
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)addr, sizeof(*addr))));
+	if (ret < 0)
+		goto fail;
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0)
+		goto fail;
+
+	return sock;
+fail:
+	__RT(close(sock));
+
+	return ret;
+}
+
+static int count_managers(void)
+{
+	int id, prio, nr = 0;
+	char line[128], where[8];
+	FILE *fp;
+
+	fp = fopen(STACK_MGR_PROC, "r");
+	if (fp == NULL)
+		return -errno;
+
+	/* Manager lines come first, up to the first empty line. */
+	if (fgets(line, sizeof(line), fp))
+		while (fgets(line, sizeof(line), fp) &&
+		       sscanf(line, "%d %7s %d", &id, where, &prio) == 3)
+			nr++;
+
+	fclose(fp);
+
+	return nr > 0 ? nr : -ENOENT;
+}
+
+static int steer_loopback(int nr_mgrs)
+{
+	FILE *fp;
+	int ret;
+
+	fp = fopen(STACK_MGR_PROC, "w");
+	if (fp == NULL)
+		return -errno;
+
+	if (nr_mgrs == 0)
+		ret = fprintf(fp, "dev rtlo direct\n");
+	else
+		ret = fprintf(fp, "dev rtlo hash %d\n", nr_mgrs);
+
+	if (fclose(fp) || ret < 0)
+		return -errno;
+
+	return 0;
+}
+
+static int run_step(const struct sockaddr_in *peer, const int *cpu_list,
+		    int nr_cpus, int nr_flows, int nr_mgrs, int duration)
+{
+	unsigned long long total = 0, rtt_sum = 0, rtt_max = 0;
+	struct timespec start, now;
+	struct flow *flows, *f;
+	int ret, n;
+
+	ret = steer_loopback(nr_mgrs);
+	if (ret) {
+		smokey_warning("cannot steer rtlo: %s", strerror(-ret));
+		return ret;
+	}
+
+	flows = calloc(nr_flows, sizeof(*flows));
+	if (flows == NULL)
+		return -ENOMEM;
+
+	for (n = 0; n < nr_flows; n++) {
+		f = flows + n;
+		f->cpu = cpu_list[n % nr_cpus];
+		f->peer = *peer;
+		f->peer.sin_port = htons(PORT_BASE + n);
+		f->sock = open_socket(&f->peer);
+		if (f->sock < 0) {
+			ret = f->sock;
+			goto close;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	timespec_adds(&start, &now, 100000000);
+
+	for (n = 0; n < nr_flows; n++) {
+		f = flows + n;
+		f->start = start;
+		f->end = start;
+		f->end.tv_sec += duration;
+		ret = smokey_check_status(
+			__RT(pthread_create(&f->tid, NULL, flow_loop, f)));
+		if (ret < 0) {
+			while (--n >= 0)
+				pthread_join(flows[n].tid, NULL);
+			goto close;
+		}
+	}
+
+	for (n = 0; n < nr_flows; n++) {
+		f = flows + n;
+		pthread_join(f->tid, NULL);
+		if (f->err && ret == 0) {
+			smokey_warning("flow %d on CPU%d: %s",
+				       n, f->cpu, strerror(-f->err));
+			ret = f->err;
+		}
+		if (!__Tassert(f->packets > 0) && ret == 0)
+			ret = -EPROTO;
+		total += f->packets;
+		rtt_sum += f->rtt_sum;
+		if (f->rtt_max > rtt_max)
+			rtt_max = f->rtt_max;
+	}
+
+	if (ret)
+		goto close;
+
+	if (nr_mgrs == 0)
+		smokey_trace("direct delivery, %2d flow(s): %9llu rtt/s, "
+			     "avg %6llu ns, max %8llu ns",
+			     nr_flows, total / duration,
+			     rtt_sum / total, rtt_max);
+	else
+		smokey_trace("%2d manager(s),  %2d flow(s): %9llu rtt/s, "
+			     "avg %6llu ns, max %8llu ns",
+			     nr_mgrs, nr_flows, total / duration,
+			     rtt_sum / total, rtt_max);
+close:
+	for (n = 0; n < nr_flows; n++)
+		if (flows[n].sock > 0)
+			__RT(close(flows[n].sock));
+
+	free(flows);
+
+	return ret;
+}
+
+static int
+run_net_stackmgr(struct smokey_test *t, int argc, char *const argv[])
+{
+	int duration = 1, nr_flows = 0, nr_cpus = 0, nr_mgrs, cpu;
+	int cpu_list[CPU_SETSIZE], err, err_teardown, n;
+	struct sockaddr_in peer;
+	cpu_set_t cpus;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(net_stackmgr, rtnet_duration))
+		duration = SMOKEY_ARG_INT(net_stackmgr, rtnet_duration);
+
+	if (SMOKEY_ARG_ISSET(net_stackmgr, rtnet_flows))
+		nr_flows = SMOKEY_ARG_INT(net_stackmgr, rtnet_flows);
+
+	if (duration <= 0 || nr_flows < 0)
+		return -EINVAL;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &cpus))
+			cpu_list[nr_cpus++] = cpu;
+
+	memset(&peer, 0, sizeof(peer));
+	peer.sin_family = AF_INET;
+	peer.sin_port = htons(7);
+	peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	smokey_trace("Configuring interface rtlo (driver rt_loopback)");
+
+	err = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_UDP, &peer);
+	if (err < 0)
+		return err;
+
+	nr_mgrs = count_managers();
+	if (nr_mgrs < 0) {
+		smokey_note("stack manager steering not available");
+		err = -ENOSYS;
+		goto teardown;
+	}
+
+	if (nr_flows == 0)
+		nr_flows = nr_mgrs;
+
+	for (n = 0; n <= nr_mgrs && err == 0; n++)
+		err = run_step(&peer, cpu_list, nr_cpus, nr_flows,
+			       n, duration);
+
+	steer_loopback(0);
+teardown:
+	err_teardown = smokey_net_teardown("rt_loopback", "rtlo",
+					   _CC_COBALT_NET_UDP);
+	if (err == 0)
+		err = err_teardown;
+
+	return err;
+}
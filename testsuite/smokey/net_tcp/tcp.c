@@ -0,0 +1,416 @@
+/*
+ * RTnet TCP bulk transfer test over the loopback driver
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <netinet/in.h>
+
+#include <sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <rtdm/net.h>
+#include <smokey/smokey.h>
+#include "smokey_net.h"
+
+smokey_test_plugin(net_tcp,
+	SMOKEY_ARGLIST(
+		SMOKEY_INT(rtnet_block),
+		SMOKEY_INT(rtnet_blocks),
+		SMOKEY_INT(rtnet_error_rate),
+	),
+	"Measure the RTnet TCP goodput and block latency over the loopback\n"
+	"\tdriver, with the legacy fixed timeout retransmission first, then\n"
+	"\twith fast retransmit, SACK, window scaling and adaptive RTO,\n"
+	"\tthe rtnet_block parameter sets the bytes per block (default 32768)\n"
+	"\tthe rtnet_blocks parameter sets the number of blocks (default 200)\n"
+	"\tthe rtnet_error_rate parameter drops one of every n segments\n"
+	"\t(default 0, needs rttcp error injection)"
+);
+
+#define PORT		37100
+#define EXTRA_RTSKBS	64
+#define ERROR_RATE_PARAM "/sys/module/rttcp/parameters/error_rate"
+
+struct tcp_test {
+	struct sockaddr_in peer;
+	const struct rtnet_tcp_params *params;
+	int block_size;
+	int blocks;
+	char *buf;
+	sem_t ready;
+	int server_err;
+};
+
+static int read_block(int sock, char *buf, int len)
+{
+	int ret;
+
+	while (len > 0) {
+		ret = __RT(read(sock, buf, len));
+		if (ret < 0)
+			return -errno;
+		if (ret == 0)
+			return -EPIPE;
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int write_block(int sock, const char *buf, int len)
+{
+	int ret;
+
+	while (len > 0) {
+		ret = __RT(write(sock, buf, len));
+		if (ret < 0)
+			return -errno;
+		buf += ret;
+		len -= ret;
+	}
+
+	return 0;
+}
+
+static int open_socket(const struct rtnet_tcp_params *params)
+{
+	int64_t timeout = 5000000000LL; /* never wait forever */
+	unsigned int extra_rtskbs = EXTRA_RTSKBS;
+	int sock, ret;
+
+	sock = smokey_check_errno(__RT(socket(PF_INET, SOCK_STREAM, 0)));
+	if (sock < 0)
+		return sock;
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TIMEOUT, &timeout)));
+	if (ret < 0)
+		goto fail;
+
+	/* the retransmission queue holds a copy of each unacked segment */
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_EXTPOOL, &extra_rtskbs)));
+	if (ret < 0)
+		goto fail;
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TCP_SETPARAMS, params)));
+	if (ret < 0)
+		goto fail;
+
+	return sock;
+fail:
+	__RT(close(sock));
+
+	return ret;
+}
+
+static void *server(void *arg)
+{
+	struct sched_param param = { .sched_priority = 51 };
+	struct tcp_test *t = arg;
+	struct sockaddr_in addr;
+	socklen_t addrlen;
+	int sock, ret, n;
+	char *buf;
+
+	buf = malloc(t->block_size);
+	if (buf == NULL) {
+		t->server_err = -ENOMEM;
+		sem_post(&t->ready);
+		return NULL;
+	}
+
+	ret = smokey_check_status(
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+	if (ret)
+		goto out;
+
+	sock = ret = open_socket(t->params);
+	if (sock < 0)
+		goto out;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(PORT);
+	addr.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	ret = smokey_check_errno(
+		__RT(bind(sock, (struct sockaddr *)&addr, sizeof(addr))));
+	if (ret < 0)
+		goto close;
+
+	ret = smokey_check_errno(__RT(listen(sock, 1)));
+	if (ret < 0)
+		goto close;
+
+	sem_post(&t->ready);
+
+	/* rttcp hands back the listening socket once connected */
+	addrlen = sizeof(addr);
+	ret = smokey_check_errno(
+		__RT(accept(sock, (struct sockaddr *)&addr, &addrlen)));
+	if (ret < 0)
+		goto close_ready;
+
+	for (n = 0; n < t->blocks; n++) {
+		ret = read_block(sock, buf, t->block_size);
+		if (ret)
+			break;
+		ret = write_block(sock, (char *)&n, sizeof(n));
+		if (ret)
+			break;
+	}
+	if (ret)
+		smokey_warning("server: block #%d: %s", n, symerror(ret));
+
+close_ready:
+	__RT(close(sock));
+	t->server_err = ret;
+	free(buf);
+
+	return NULL;
+close:
+	__RT(close(sock));
+out:
+	t->server_err = ret;
+	sem_post(&t->ready);
+	free(buf);
+
+	return NULL;
+}
+
+static int compare_ull(const void *a, const void *b)
+{
+	unsigned long long x = *(const unsigned long long *)a;
+	unsigned long long y = *(const unsigned long long *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int run_mode(struct tcp_test *t, const char *name,
+		    const struct rtnet_tcp_params *params)
+{
+	unsigned long long *lat, elapsed = 0;
+	struct timespec start, end, delta;
+	struct rtnet_tcp_info info;
+	int sock, ret, n, ack;
+	pthread_t tid;
+
+	lat = calloc(t->blocks, sizeof(*lat));
+	if (lat == NULL)
+		return -ENOMEM;
+
+	t->params = params;
+	t->server_err = 0;
+	ret = smokey_check_status(pthread_create(&tid, NULL, server, t));
+	if (ret)
+		goto out;
+
+	sem_wait(&t->ready);
+	if (t->server_err) {
+		ret = t->server_err;
+		goto join;
+	}
+
+	sock = ret = open_socket(params);
+	if (sock < 0)
+		goto join;
+
+	ret = smokey_check_errno(
+		__RT(connect(sock, (struct sockaddr *)&t->peer,
+			     sizeof(t->peer))));
+	if (ret < 0)
+		goto close;
+
+	for (n = 0; n < t->blocks; n++) {
+		__RT(clock_gettime(CLOCK_MONOTONIC, &start));
+		ret = write_block(sock, t->buf, t->block_size);
+		if (ret == 0)
+			ret = read_block(sock, (char *)&ack, sizeof(ack));
+		__RT(clock_gettime(CLOCK_MONOTONIC, &end));
+		if (ret) {
+			smokey_warning("%s: block #%d: %s",
+				       name, n, symerror(ret));
+			goto close;
+		}
+		if (ack != n) {
+			smokey_warning("%s: got ack #%d, expected #%d",
+				       name, ack, n);
+			ret = -EPROTO;
+			goto close;
+		}
+
+		timespec_sub(&delta, &end, &start);
+		lat[n] = timespec_scalar(&delta);
+		elapsed += lat[n];
+	}
+
+	ret = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TCP_INFO, &info)));
+	if (ret < 0)
+		goto close;
+
+	qsort(lat, t->blocks, sizeof(*lat), compare_ull);
+
+	smokey_trace("%-8s %8.2f MB/s, block avg %8llu ns, "
+		     "p99 %9llu ns, max %9llu ns",
+		     name, (double)t->block_size * t->blocks * 1000.0 /
+		     (elapsed ?: 1), elapsed / t->blocks,
+		     lat[(t->blocks - 1) * 99 / 100], lat[t->blocks - 1]);
+	smokey_trace("%-8s mss %u, wscale %u/%u, srtt %llu ns, rto %llu ns, "
+		     "retransmits %llu (fast %llu), timeouts %llu, "
+		     "dup acks %llu",
+		     name, info.mss, info.snd_wscale, info.rcv_wscale,
+		     (unsigned long long)info.srtt,
+		     (unsigned long long)info.rto,
+		     (unsigned long long)info.retransmits,
+		     (unsigned long long)info.fast_retransmits,
+		     (unsigned long long)info.timeouts,
+		     (unsigned long long)info.dup_acks);
+close:
+	__RT(close(sock));
+join:
+	pthread_join(tid, NULL);
+	if (ret == 0)
+		ret = t->server_err;
+out:
+	free(lat);
+
+	return ret;
+}
+
+static int set_error_rate(int rate, int *old_rate)
+{
+	char buf[16];
+	int fd, ret;
+
+	fd = open(ERROR_RATE_PARAM, O_RDWR);
+	if (fd < 0) {
+		ret = -errno;
+		smokey_warning("cannot open " ERROR_RATE_PARAM
+			       ", no rttcp error injection?");
+		return ret;
+	}
+
+	if (old_rate) {
+		ret = read(fd, buf, sizeof(buf) - 1);
+		if (ret < 0) {
+			ret = -errno;
+			goto out;
+		}
+		buf[ret] = '\0';
+		*old_rate = atoi(buf);
+	}
+
+	ret = snprintf(buf, sizeof(buf), "%d\n", rate);
+	ret = pwrite(fd, buf, ret, 0) < 0 ? -errno : 0;
+out:
+	close(fd);
+
+	return ret;
+}
+
+static int run_net_tcp(struct smokey_test *t, int argc, char *const argv[])
+{
+	struct sched_param param = { .sched_priority = 50 };
+	struct rtnet_tcp_params legacy, defaults;
+	int err, err_teardown, sock, old_rate = 0, rate = 0;
+	struct tcp_test test;
+
+	smokey_parse_args(t, argc, argv);
+
+	memset(&test, 0, sizeof(test));
+	test.block_size = 32768;
+	test.blocks = 200;
+
+	if (SMOKEY_ARG_ISSET(net_tcp, rtnet_block))
+		test.block_size = SMOKEY_ARG_INT(net_tcp, rtnet_block);
+
+	if (SMOKEY_ARG_ISSET(net_tcp, rtnet_blocks))
+		test.blocks = SMOKEY_ARG_INT(net_tcp, rtnet_blocks);
+
+	if (SMOKEY_ARG_ISSET(net_tcp, rtnet_error_rate))
+		rate = SMOKEY_ARG_INT(net_tcp, rtnet_error_rate);
+
+	if (test.block_size <= 0 || test.blocks <= 0 || rate < 0)
+		return -EINVAL;
+
+	test.buf = malloc(test.block_size);
+	if (test.buf == NULL)
+		return -ENOMEM;
+	memset(test.buf, 0x5a, test.block_size);
+	sem_init(&test.ready, 0, 0);
+
+	memset(&test.peer, 0, sizeof(test.peer));
+	test.peer.sin_family = AF_INET;
+	test.peer.sin_port = htons(PORT);
+	test.peer.sin_addr.s_addr = htonl(INADDR_ANY);
+
+	smokey_trace("Configuring interface rtlo (driver rt_loopback)");
+
+	err = smokey_net_setup("rt_loopback", "rtlo",
+			       _CC_COBALT_NET_TCP, &test.peer);
+	if (err < 0)
+		goto out;
+
+	if (rate) {
+		err = set_error_rate(rate, &old_rate);
+		if (err)
+			goto teardown;
+	}
+
+	err = smokey_check_status(
+		pthread_setschedparam(pthread_self(), SCHED_FIFO, &param));
+	if (err)
+		goto restore;
+
+	/* fetch the stack defaults from a fresh socket */
+	sock = err = smokey_check_errno(
+		__RT(socket(PF_INET, SOCK_STREAM, 0)));
+	if (sock < 0)
+		goto sched;
+	err = smokey_check_errno(
+		__RT(ioctl(sock, RTNET_RTIOC_TCP_GETPARAMS, &defaults)));
+	__RT(close(sock));
+	if (err < 0)
+		goto sched;
+
+	/* go-back-n on a fixed timeout, no options, as rttcp used to */
+	legacy = defaults;
+	legacy.flags = 0;
+	legacy.rcv_window = 4096;
+	legacy.dupack_thresh = 0;
+	legacy.rto_min = legacy.rto_initial;
+	legacy.rto_max = legacy.rto_initial;
+
+	err = run_mode(&test, "legacy", &legacy);
+	if (err == 0)
+		err = run_mode(&test, "default", &defaults);
+sched:
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+restore:
+	if (rate)
+		set_error_rate(old_rate, NULL);
+teardown:
+	err_teardown = smokey_net_teardown("rt_loopback", "rtlo",
+					   _CC_COBALT_NET_TCP);
+	if (err == 0)
+		err = err_teardown;
+out:
+	sem_destroy(&test.ready);
+	free(test.buf);
+
+	return err;
+}
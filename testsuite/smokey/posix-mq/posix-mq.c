@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <boilerplate/time.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(posix_mq,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(loops),
+			   SMOKEY_INT(msgsize),
+		   ),
+		   "Check message queues in regular and shared memory\n"
+		   "\t(MQ_SHMEM) modes, then compare their throughput and\n"
+		   "\tround-trip latency.\n"
+		   "\tloops=<n>\tmessages per measurement (default 100000)\n"
+		   "\tmsgsize=<n>\tmessage size for measurements (default 64)"
+);
+
+#define CHECK_MAXMSG	5
+#define CHECK_MSGSIZE	32
+#define BENCH_MAXMSG	16
+
+struct bench_ctl {
+	mqd_t in;
+	mqd_t out;
+	size_t msgsize;
+	int loops;
+	int status;
+};
+
+static const char *mode_name(int flags)
+{
+	return flags & MQ_SHMEM ? "shmem" : "regular";
+}
+
+static mqd_t open_queue(const char *name, int oflags, int flags,
+			long maxmsg, long msgsize)
+{
+	struct mq_attr qa;
+
+	qa.mq_flags = flags;
+	qa.mq_maxmsg = maxmsg;
+	qa.mq_msgsize = msgsize;
+	qa.mq_curmsgs = 0;
+
+	mq_unlink(name);
+
+	return mq_open(name, oflags | O_CREAT | O_EXCL, 0, &qa);
+}
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int check_semantics(int flags)
+{
+	char buf[CHECK_MSGSIZE], msg[CHECK_MSGSIZE];
+	struct timespec now, timeout;
+	long maxmsg, n;
+	struct mq_attr qa;
+	mqd_t mq, rdmq;
+	unsigned int prio;
+	int ret;
+
+	mq = open_queue("/smokey-mq-check", O_RDWR | O_NONBLOCK, flags,
+			CHECK_MAXMSG, CHECK_MSGSIZE);
+	if (!__Fassert(mq == (mqd_t)-1))
+		return -errno;
+
+	rdmq = mq_open("/smokey-mq-check", O_RDONLY);
+	mq_unlink("/smokey-mq-check");
+	if (!__Fassert(rdmq == (mqd_t)-1)) {
+		ret = -errno;
+		goto out;
+	}
+
+	if (!__Terrno(ret, mq_getattr(mq, &qa)))
+		goto out;
+
+	/* Shared memory rings are rounded up to a power of two. */
+	maxmsg = flags & MQ_SHMEM ? 8 : CHECK_MAXMSG;
+	if (!__Tassert(qa.mq_maxmsg == maxmsg) ||
+	    !__Tassert(qa.mq_msgsize == CHECK_MSGSIZE) ||
+	    !__Tassert(qa.mq_curmsgs == 0)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	if (!__Tassert(mq_send(mq, buf, CHECK_MSGSIZE + 1, 0) == -1 &&
+		       errno == EMSGSIZE))
+		goto fail;
+
+	if (!__Tassert(mq_send(mq, buf, 1, 32768) == -1 &&
+		       errno == EINVAL))
+		goto fail;
+
+	if (!__Tassert(mq_send(rdmq, buf, 1, 0) == -1 &&
+		       errno == EBADF))
+		goto fail;
+
+	if (!__Tassert(mq_receive(mq, buf, CHECK_MSGSIZE - 1, NULL) == -1 &&
+		       errno == EMSGSIZE))
+		goto fail;
+
+	if (!__Tassert(mq_receive(mq, buf, sizeof(buf), NULL) == -1 &&
+		       errno == EAGAIN))
+		goto fail;
+
+	/* Equal priorities, so both modes must preserve FIFO order. */
+	for (n = 0; n < maxmsg; n++) {
+		snprintf(msg, sizeof(msg), "message #%ld", n);
+		if (!__Terrno(ret, mq_send(mq, msg, strlen(msg) + 1, 3)))
+			goto out;
+	}
+
+	if (!__Tassert(mq_send(mq, msg, 1, 3) == -1 &&
+		       errno == EAGAIN))
+		goto fail;
+
+	if (!__Terrno(ret, mq_getattr(mq, &qa)))
+		goto out;
+	if (!__Tassert(qa.mq_curmsgs == maxmsg)) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	for (n = 0; n < maxmsg; n++) {
+		snprintf(msg, sizeof(msg), "message #%ld", n);
+		prio = 0;
+		ret = mq_receive(rdmq, buf, sizeof(buf), &prio);
+		if (!__Tassert(ret == (int)strlen(msg) + 1) ||
+		    !__Tassert(strcmp(buf, msg) == 0) ||
+		    !__Tassert(prio == 3)) {
+			smokey_warning("%s: message %ld mismatch",
+				       mode_name(flags), n);
+			ret = -EPROTO;
+			goto out;
+		}
+	}
+
+	qa.mq_flags = 0;
+	if (!__Terrno(ret, mq_setattr(mq, &qa, NULL)))
+		goto out;
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	timespec_adds(&timeout, &now, 10000000);
+	if (!__Tassert(mq_timedreceive(mq, buf, sizeof(buf),
+				       NULL, &timeout) == -1 &&
+		       errno == ETIMEDOUT))
+		goto fail;
+
+	ret = 0;
+	goto out;
+fail:
+	ret = -EPROTO;
+out:
+	if (rdmq != (mqd_t)-1)
+		mq_close(rdmq);
+	mq_close(mq);
+
+	return ret;
+}
+
+static void *consumer(void *arg)
+{
+	struct bench_ctl *ctl = arg;
+	struct sched_param param;
+	char *buf;
+	int n, seq;
+
+	param.sched_priority = 10;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	buf = malloc(ctl->msgsize);
+	if (buf == NULL) {
+		ctl->status = -ENOMEM;
+		return NULL;
+	}
+
+	for (n = 0; n < ctl->loops; n++) {
+		if (mq_receive(ctl->in, buf, ctl->msgsize, NULL) < 0) {
+			ctl->status = -errno;
+			break;
+		}
+		memcpy(&seq, buf, sizeof(seq));
+		if (seq != n) {
+			smokey_warning("got message #%d, expected #%d", seq, n);
+			ctl->status = -EPROTO;
+			break;
+		}
+		/* Echo back in ping-pong mode. */
+		if (ctl->out != (mqd_t)-1 &&
+		    mq_send(ctl->out, buf, ctl->msgsize, 0)) {
+			ctl->status = -errno;
+			break;
+		}
+	}
+
+	free(buf);
+
+	return NULL;
+}
+
+static int bench_one(int flags, int loops, size_t msgsize, int pingpong)
+{
+	long long start, t0, dt, max = 0, elapsed;
+	struct bench_ctl ctl;
+	struct sched_param param;
+	mqd_t req, rsp = (mqd_t)-1;
+	pthread_t tid;
+	char *buf;
+	int n, ret;
+
+	buf = malloc(msgsize);
+	if (buf == NULL)
+		return -ENOMEM;
+
+	memset(buf, 0, msgsize);
+
+	req = open_queue("/smokey-mq-req", O_RDWR, flags,
+			 BENCH_MAXMSG, msgsize);
+	mq_unlink("/smokey-mq-req");
+	if (!__Fassert(req == (mqd_t)-1)) {
+		ret = -errno;
+		goto out_buf;
+	}
+
+	if (pingpong) {
+		rsp = open_queue("/smokey-mq-rsp", O_RDWR, flags,
+				 BENCH_MAXMSG, msgsize);
+		mq_unlink("/smokey-mq-rsp");
+		if (!__Fassert(rsp == (mqd_t)-1)) {
+			ret = -errno;
+			goto out_req;
+		}
+	}
+
+	ctl.in = req;
+	ctl.out = rsp;
+	ctl.msgsize = msgsize;
+	ctl.loops = loops;
+	ctl.status = 0;
+
+	param.sched_priority = 10;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	ret = smokey_check_status(pthread_create(&tid, NULL, consumer, &ctl));
+	if (ret)
+		goto out_sched;
+
+	start = now_ns();
+
+	for (n = 0; n < loops; n++) {
+		memcpy(buf, &n, sizeof(n));
+		t0 = now_ns();
+		ret = smokey_check_errno(mq_send(req, buf, msgsize, 0));
+		if (ret)
+			break;
+		if (pingpong) {
+			ret = smokey_check_errno(mq_receive(rsp, buf,
+							    msgsize, NULL));
+			if (ret < 0)
+				break;
+			ret = 0;
+			dt = now_ns() - t0;
+			if (dt > max)
+				max = dt;
+		}
+	}
+
+	if (ret)
+		pthread_cancel(tid);
+
+	pthread_join(tid, NULL);
+	elapsed = now_ns() - start;
+	if (ret == 0)
+		ret = ctl.status;
+
+	if (ret == 0) {
+		if (pingpong)
+			smokey_trace("%-8s round-trip: avg %6lld ns, max %7lld ns",
+				     mode_name(flags), elapsed / loops, max);
+		else
+			smokey_trace("%-8s throughput: %9lld msg/s, %6lld ns/msg",
+				     mode_name(flags),
+				     loops * 1000000000LL / (elapsed ?: 1),
+				     elapsed / loops);
+	}
+out_sched:
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	if (rsp != (mqd_t)-1)
+		mq_close(rsp);
+out_req:
+	mq_close(req);
+out_buf:
+	free(buf);
+
+	return ret;
+}
+
+static int run_posix_mq(struct smokey_test *t, int argc, char *const argv[])
+{
+	static const int modes[] = { 0, MQ_SHMEM };
+	int loops = 100000, msgsize = 64, ret, n;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(posix_mq, loops))
+		loops = SMOKEY_ARG_INT(posix_mq, loops);
+	if (SMOKEY_ARG_ISSET(posix_mq, msgsize))
+		msgsize = SMOKEY_ARG_INT(posix_mq, msgsize);
+
+	if (loops <= 0 || msgsize < (int)sizeof(int))
+		return -EINVAL;
+
+	for (n = 0; n < 2; n++) {
+		ret = check_semantics(modes[n]);
+		if (ret) {
+			smokey_warning("%s mode: %s",
+				       mode_name(modes[n]), symerror(ret));
+			return ret;
+		}
+	}
+
+	for (n = 0; n < 2; n++) {
+		ret = bench_one(modes[n], loops, msgsize, 0);
+		if (ret)
+			return ret;
+	}
+
+	for (n = 0; n < 2; n++) {
+		ret = bench_one(modes[n], loops / 10 ?: 1, msgsize, 1);
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
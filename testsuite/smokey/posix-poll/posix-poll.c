@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <mqueue.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <fcntl.h>
+#include <cobalt/sys/cobalt.h>
+#include <boilerplate/time.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(posix_poll,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(nfds),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check the persistent interest set service (cobalt_poll_*),\n"
+		   "\tthen compare its cost to select() over many descriptors.\n"
+		   "\tnfds=<n>\tlargest number of descriptors (default 128)\n"
+		   "\tloops=<n>\twait rounds per measurement (default 1000)"
+);
+
+#define NR_CHECK_FDS	16
+
+static int open_queues(mqd_t *mqs, int nr)
+{
+	struct mq_attr qa;
+	char name[32];
+	int n;
+
+	qa.mq_maxmsg = 4;
+	qa.mq_msgsize = 16;
+
+	for (n = 0; n < nr; n++) {
+		snprintf(name, sizeof(name), "/poll_test_mq%d", n);
+		mq_unlink(name);
+		mqs[n] = mq_open(name, O_RDWR | O_CREAT | O_NONBLOCK, 0, &qa);
+		if (mqs[n] < 0)
+			return -errno;
+		mq_unlink(name);
+	}
+
+	return 0;
+}
+
+static void close_queues(mqd_t *mqs, int nr)
+{
+	while (nr-- > 0)
+		if (mqs[nr] >= 0)
+			mq_close(mqs[nr]);
+}
+
+static int wait_events(int pfd, struct cobalt_poll_event *ev, int nr)
+{
+	static const struct timespec zero;
+
+	return cobalt_poll_wait(pfd, ev, nr, &zero);
+}
+
+static int check_interest_set(void)
+{
+	struct cobalt_poll_event ev[NR_CHECK_FDS];
+	mqd_t mqs[NR_CHECK_FDS];
+	unsigned int prio;
+	int pfd, ret, n;
+	char buf[16];
+
+	for (n = 0; n < NR_CHECK_FDS; n++)
+		mqs[n] = -1;
+
+	ret = open_queues(mqs, NR_CHECK_FDS);
+	if (!__Fassert(ret < 0))
+		goto out_queues;
+
+	pfd = cobalt_poll_create(0);
+	if (!__Fassert(pfd < 0)) {
+		ret = pfd;
+		goto out_queues;
+	}
+
+	for (n = 0; n < NR_CHECK_FDS; n++)
+		if (!__T(ret, cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD,
+					      mqs[n], COBALT_POLLIN)))
+			goto out;
+
+	ret = -EINVAL;
+	if (!__Tassert(cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD,
+				       mqs[0], COBALT_POLLIN) == -EEXIST))
+		goto out;
+	if (!__Tassert(cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD,
+				       mqs[0], 0x80) == -EINVAL))
+		goto out;
+	if (!__Tassert(cobalt_poll_ctl(pfd, COBALT_POLL_CTL_DEL,
+				       pfd, 0) == -EINVAL))
+		goto out;
+
+	/* Nothing pending yet. */
+	if (!__Tassert(wait_events(pfd, ev, NR_CHECK_FDS) == 0))
+		goto out;
+
+	if (!__Terrno(ret, mq_send(mqs[3], "3", 2, 0)) ||
+	    !__Terrno(ret, mq_send(mqs[11], "11", 3, 0)))
+		goto out;
+
+	ret = -EINVAL;
+	n = wait_events(pfd, ev, NR_CHECK_FDS);
+	if (!__Tassert(n == 2))
+		goto out;
+	if (!__Tassert((ev[0].fd == mqs[3] && ev[1].fd == mqs[11]) ||
+		       (ev[0].fd == mqs[11] && ev[1].fd == mqs[3])))
+		goto out;
+	if (!__Tassert(ev[0].events == COBALT_POLLIN &&
+		       ev[1].events == COBALT_POLLIN))
+		goto out;
+
+	/* Level-triggered: still ready until drained. */
+	if (!__Tassert(wait_events(pfd, ev, 1) == 1))
+		goto out;
+
+	if (!__Tassert(mq_receive(mqs[3], buf, sizeof(buf), &prio) == 2))
+		goto out;
+	n = wait_events(pfd, ev, NR_CHECK_FDS);
+	if (!__Tassert(n == 1 && ev[0].fd == mqs[11]))
+		goto out;
+
+	/* Events for the same descriptor are merged. */
+	if (!__T(ret, cobalt_poll_ctl(pfd, COBALT_POLL_CTL_MOD, mqs[11],
+				      COBALT_POLLIN|COBALT_POLLOUT)))
+		goto out;
+	ret = -EINVAL;
+	n = wait_events(pfd, ev, NR_CHECK_FDS);
+	if (!__Tassert(n == 1 && ev[0].fd == mqs[11] &&
+		       ev[0].events == (COBALT_POLLIN|COBALT_POLLOUT)))
+		goto out;
+
+	if (!__T(ret, cobalt_poll_ctl(pfd, COBALT_POLL_CTL_DEL, mqs[11], 0)))
+		goto out;
+	ret = -EINVAL;
+	if (!__Tassert(cobalt_poll_ctl(pfd, COBALT_POLL_CTL_DEL,
+				       mqs[11], 0) == -ENOENT))
+		goto out;
+	if (!__Tassert(wait_events(pfd, ev, NR_CHECK_FDS) == 0))
+		goto out;
+
+	/* A closed descriptor silently leaves the set. */
+	if (!__Terrno(ret, mq_send(mqs[5], "5", 2, 0)))
+		goto out;
+	mq_close(mqs[5]);
+	mqs[5] = -1;
+	ret = -EINVAL;
+	if (!__Tassert(wait_events(pfd, ev, NR_CHECK_FDS) == 0))
+		goto out;
+
+	ret = 0;
+out:
+	close(pfd);
+out_queues:
+	close_queues(mqs, NR_CHECK_FDS);
+
+	return ret;
+}
+
+static const char *tunes[] = {
+	"Surfing",
+	"Karma",
+	"Mango",
+	"Monkey",
+	"Giants",
+	"Sunset",
+	"Boogie",
+	"Dream",
+};
+
+#define NR_TUNES  (sizeof(tunes) / sizeof(tunes[0]))
+
+struct receiver {
+	int pfd;
+	mqd_t *mqs;
+	int status;
+};
+
+static void *poll_thread(void *arg)
+{
+	struct cobalt_poll_event ev[NR_TUNES];
+	struct receiver *r = arg;
+	unsigned int prio, i = 0;
+	int ret, n, k;
+	char buf[16];
+
+	while (i < NR_TUNES) {
+		ret = cobalt_poll_wait(r->pfd, ev, NR_TUNES, NULL);
+		if (ret < 0) {
+			r->status = ret;
+			break;
+		}
+		for (n = 0; n < ret; n++) {
+			k = mq_receive(ev[n].fd, buf, sizeof(buf), &prio);
+			if (k < 0) {
+				r->status = -errno;
+				return NULL;
+			}
+			if (strcmp(buf, tunes[prio]) || ev[n].fd != r->mqs[prio]) {
+				r->status = -EINVAL;
+				return NULL;
+			}
+			smokey_trace("received %s", buf);
+			i++;
+		}
+	}
+
+	return NULL;
+}
+
+static int check_wakeup(void)
+{
+	struct receiver r;
+	mqd_t mqs[NR_TUNES];
+	pthread_t tid;
+	int ret, n;
+
+	for (n = 0; n < NR_TUNES; n++)
+		mqs[n] = -1;
+
+	ret = open_queues(mqs, NR_TUNES);
+	if (!__Fassert(ret < 0))
+		goto out_queues;
+
+	r.mqs = mqs;
+	r.status = 0;
+	r.pfd = cobalt_poll_create(0);
+	if (!__Fassert(r.pfd < 0)) {
+		ret = r.pfd;
+		goto out_queues;
+	}
+
+	for (n = 0; n < NR_TUNES; n++)
+		if (!__T(ret, cobalt_poll_ctl(r.pfd, COBALT_POLL_CTL_ADD,
+					      mqs[n], COBALT_POLLIN)))
+			goto out;
+
+	ret = smokey_check_status(pthread_create(&tid, NULL, poll_thread, &r));
+	if (ret)
+		goto out;
+
+	/* The message priority tells the receiver which tune to expect. */
+	for (n = 0; n < NR_TUNES; n++) {
+		ret = smokey_check_errno(mq_send(mqs[n], tunes[n],
+						 strlen(tunes[n]) + 1, n));
+		if (ret < 0) {
+			pthread_cancel(tid);
+			break;
+		}
+		usleep(10000);
+	}
+
+	pthread_join(tid, NULL);
+	if (ret == 0)
+		ret = r.status;
+out:
+	close(r.pfd);
+out_queues:
+	close_queues(mqs, NR_TUNES);
+
+	return ret;
+}
+
+#define NR_CLOSE_ROUNDS	1000
+
+struct signaler {
+	mqd_t *mqs;
+	volatile int stop;
+	int status;
+};
+
+static void *signal_thread(void *arg)
+{
+	struct signaler *sg = arg;
+	unsigned int prio;
+	char buf[16];
+	int n;
+
+	/* Flip the readiness of every queue back and forth. */
+	while (!sg->stop) {
+		for (n = 0; n < NR_CHECK_FDS; n++) {
+			if (mq_send(sg->mqs[n], "x", 2, 0) && errno != EAGAIN)
+				goto fail;
+			if (mq_receive(sg->mqs[n], buf, sizeof(buf), &prio) < 0 &&
+			    errno != EAGAIN)
+				goto fail;
+		}
+	}
+
+	return NULL;
+fail:
+	sg->status = -errno;
+
+	return NULL;
+}
+
+/*
+ * Destroy interest sets while their descriptors are being signaled,
+ * so that the selector teardown races with ready list updates.
+ */
+static int check_close_race(void)
+{
+	struct cobalt_poll_event ev[NR_CHECK_FDS];
+	mqd_t mqs[NR_CHECK_FDS];
+	struct signaler sg;
+	int pfd, ret, n, round;
+	pthread_t tid;
+
+	for (n = 0; n < NR_CHECK_FDS; n++)
+		mqs[n] = -1;
+
+	ret = open_queues(mqs, NR_CHECK_FDS);
+	if (!__Fassert(ret < 0))
+		goto out_queues;
+
+	sg.mqs = mqs;
+	sg.stop = 0;
+	sg.status = 0;
+	ret = smokey_check_status(pthread_create(&tid, NULL, signal_thread, &sg));
+	if (ret)
+		goto out_queues;
+
+	for (round = 0; round < NR_CLOSE_ROUNDS && sg.status == 0; round++) {
+		pfd = cobalt_poll_create(0);
+		if (!__Fassert(pfd < 0)) {
+			ret = pfd;
+			break;
+		}
+		for (n = 0; n < NR_CHECK_FDS; n++)
+			if (!__T(ret, cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD,
+						      mqs[n], COBALT_POLLIN)))
+				break;
+		if (ret == 0)
+			ret = wait_events(pfd, ev, NR_CHECK_FDS);
+		close(pfd);
+		if (ret < 0)
+			break;
+		ret = 0;
+	}
+
+	sg.stop = 1;
+	pthread_join(tid, NULL);
+	if (ret == 0)
+		ret = sg.status;
+out_queues:
+	close_queues(mqs, NR_CHECK_FDS);
+
+	return ret;
+}
+
+static int bench_one(mqd_t *mqs, int nfds, int loops)
+{
+	struct cobalt_poll_event ev[4];
+	long long select_ns, poll_ns;
+	struct timespec start, end;
+	fd_set inset, outset;
+	unsigned int prio;
+	int pfd, ret, n, maxfd = 0;
+	char buf[16];
+
+	pfd = cobalt_poll_create(0);
+	if (!__Fassert(pfd < 0))
+		return pfd;
+
+	FD_ZERO(&inset);
+	for (n = 0; n < nfds; n++) {
+		if (!__T(ret, cobalt_poll_ctl(pfd, COBALT_POLL_CTL_ADD,
+					      mqs[n], COBALT_POLLIN)))
+			goto out;
+		FD_SET(mqs[n], &inset);
+		if (mqs[n] > maxfd)
+			maxfd = mqs[n];
+	}
+
+	/* A single descriptor out of nfds becomes ready each round. */
+	if (!__Terrno(ret, mq_send(mqs[nfds - 1], "x", 2, 0)))
+		goto out;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < loops; n++) {
+		outset = inset;
+		ret = select(maxfd + 1, &outset, NULL, NULL, NULL);
+		if (!__Tassert(ret == 1))
+			goto fail;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	select_ns = timespec_scalar(&end) - timespec_scalar(&start);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (n = 0; n < loops; n++) {
+		ret = cobalt_poll_wait(pfd, ev, 4, NULL);
+		if (!__Tassert(ret == 1))
+			goto fail;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	poll_ns = timespec_scalar(&end) - timespec_scalar(&start);
+
+	smokey_trace("%6d fds: select %7lld ns/call, poll_wait %7lld ns/call",
+		     nfds, select_ns / loops, poll_ns / loops);
+
+	ret = 0;
+	mq_receive(mqs[nfds - 1], buf, sizeof(buf), &prio);
+out:
+	close(pfd);
+
+	return ret;
+fail:
+	ret = -EINVAL;
+	goto out;
+}
+
+static int bench_wait(int max_fds, int loops)
+{
+	struct sched_param param;
+	int ret, nfds;
+	mqd_t *mqs;
+
+	mqs = malloc(sizeof(*mqs) * max_fds);
+	if (mqs == NULL)
+		return -ENOMEM;
+
+	for (nfds = 0; nfds < max_fds; nfds++)
+		mqs[nfds] = -1;
+
+	ret = open_queues(mqs, max_fds);
+	if (ret) {
+		/* Short of registry slots most likely, not an error. */
+		smokey_warning("cannot open %d message queues (%s), "
+			       "skipping benchmark", max_fds, symerror(ret));
+		ret = 0;
+		goto out;
+	}
+
+	param.sched_priority = 1;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	for (nfds = 1; nfds <= max_fds; nfds *= 4) {
+		ret = bench_one(mqs, nfds, loops);
+		if (ret)
+			break;
+	}
+
+	if (ret == 0 && nfds / 4 != max_fds)
+		ret = bench_one(mqs, max_fds, loops);
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+out:
+	close_queues(mqs, max_fds);
+	free(mqs);
+
+	return ret;
+}
+
+static int run_posix_poll(struct smokey_test *t, int argc, char *const argv[])
+{
+	int nfds = 128, loops = 1000, ret;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(posix_poll, nfds))
+		nfds = SMOKEY_ARG_INT(posix_poll, nfds);
+	if (SMOKEY_ARG_ISSET(posix_poll, loops))
+		loops = SMOKEY_ARG_INT(posix_poll, loops);
+
+	if (nfds <= 0 || nfds > FD_SETSIZE / 2 || loops <= 0)
+		return -EINVAL;
+
+	ret = check_interest_set();
+	if (ret)
+		return ret;
+
+	ret = check_wakeup();
+	if (ret)
+		return ret;
+
+	ret = check_close_race();
+	if (ret)
+		return ret;
+
+	return bench_wait(nfds, loops);
+}
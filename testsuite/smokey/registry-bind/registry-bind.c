@@ -0,0 +1,189 @@
+/*
+ * Registry startup benchmark, creating then binding to a large
+ * number of named objects.
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(registry_bind,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(objects),
+			   SMOKEY_INT(threads),
+		   ),
+		   "Create named semaphores, then have several threads bind\n"
+		   "\tto all of them concurrently, reporting the cost of\n"
+		   "\tregistry insertion and lookup.\n"
+		   "\tobjects=<n>\tnamed objects to create (default 256)\n"
+		   "\tthreads=<n>\tconcurrent binding threads (default 2)"
+);
+
+#define NAME_FMT	"/smokey-regbind-%d-%d"
+#define NAME_MAX_LEN	48
+
+struct binder {
+	pthread_t tid;
+	int objects;
+	long long elapsed;
+	long long max;
+	int status;
+};
+
+static pid_t pid;
+
+static long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void object_name(char *buf, int n)
+{
+	snprintf(buf, NAME_MAX_LEN, NAME_FMT, pid, n);
+}
+
+static void *binder_thread(void *arg)
+{
+	struct binder *b = arg;
+	char name[NAME_MAX_LEN];
+	long long t0, dt;
+	sem_t *sem;
+	int n;
+
+	for (n = 0; n < b->objects; n++) {
+		object_name(name, n);
+		t0 = now_ns();
+		sem = sem_open(name, 0);
+		dt = now_ns() - t0;
+		if (sem == SEM_FAILED) {
+			b->status = -errno;
+			smokey_warning("sem_open(%s): %s", name,
+				       strerror(errno));
+			break;
+		}
+		b->elapsed += dt;
+		if (dt > b->max)
+			b->max = dt;
+		sem_close(sem);
+	}
+
+	return NULL;
+}
+
+static int bind_objects(int objects, int threads)
+{
+	long long elapsed = 0, max = 0;
+	struct binder *binders;
+	int n, ret = 0, started;
+
+	binders = calloc(threads, sizeof(*binders));
+	if (binders == NULL)
+		return -ENOMEM;
+
+	for (started = 0; started < threads; started++) {
+		binders[started].objects = objects;
+		ret = smokey_check_status(pthread_create(&binders[started].tid,
+							 NULL, binder_thread,
+							 &binders[started]));
+		if (ret)
+			break;
+	}
+
+	for (n = 0; n < started; n++) {
+		pthread_join(binders[n].tid, NULL);
+		if (ret == 0)
+			ret = binders[n].status;
+		elapsed += binders[n].elapsed;
+		if (binders[n].max > max)
+			max = binders[n].max;
+	}
+
+	if (ret == 0)
+		smokey_trace("bind:   %d threads, avg %6lld ns, max %8lld ns",
+			     threads, elapsed / ((long long)objects * threads),
+			     max);
+
+	free(binders);
+
+	return ret;
+}
+
+static int run_registry_bind(struct smokey_test *t,
+			     int argc, char *const argv[])
+{
+	long long t0, dt, elapsed = 0, max = 0;
+	int objects = 256, threads = 2, n, created, ret = 0;
+	char name[NAME_MAX_LEN];
+	sem_t **sems;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(registry_bind, objects))
+		objects = SMOKEY_ARG_INT(registry_bind, objects);
+	if (SMOKEY_ARG_ISSET(registry_bind, threads))
+		threads = SMOKEY_ARG_INT(registry_bind, threads);
+
+	if (objects <= 0 || threads <= 0)
+		return -EINVAL;
+
+	sems = calloc(objects, sizeof(*sems));
+	if (sems == NULL)
+		return -ENOMEM;
+
+	pid = getpid();
+
+	for (created = 0; created < objects; created++) {
+		object_name(name, created);
+		t0 = now_ns();
+		sems[created] = sem_open(name, O_CREAT | O_EXCL, 0600, 0);
+		dt = now_ns() - t0;
+		if (sems[created] == SEM_FAILED) {
+			/*
+			 * Running out of registry slots is a matter of
+			 * configuration, measure what we could get.
+			 */
+			if ((errno == EAGAIN || errno == ENOSPC) && created > 0) {
+				smokey_note("registry full after %d objects, "
+					    "check CONFIG_XENO_OPT_REGISTRY_NRSLOTS",
+					    created);
+				break;
+			}
+			ret = -errno;
+			smokey_warning("sem_open(%s): %s", name,
+				       strerror(errno));
+			goto out;
+		}
+		elapsed += dt;
+		if (dt > max)
+			max = dt;
+	}
+
+	smokey_trace("create: %d objects, avg %6lld ns, max %8lld ns",
+		     created, elapsed / created, max);
+
+	ret = bind_objects(created, threads);
+out:
+	for (n = 0; n < created; n++) {
+		object_name(name, n);
+		sem_close(sems[n]);
+		sem_unlink(name);
+	}
+
+	free(sems);
+
+	return ret;
+}
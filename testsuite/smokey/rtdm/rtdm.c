@@ -10,12 +10,18 @@
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
 #include <rtdm/testing.h>
 #include <smokey/smokey.h>
 
 smokey_test_plugin(rtdm,
-		   SMOKEY_NOARGS,
-		   "Check core interface to RTDM services."
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(fd_loops),
+		   ),
+		   "Check core interface to RTDM services.\n"
+		   "\tfd_loops=<n>\tioctl calls per thread in the fd lookup\n"
+		   "\t\t\tstress test (default 100000)"
 );
 
 #define NS_PER_MS (1000000)
@@ -164,10 +170,142 @@ static int test_handover(int fd)
 	return (int)(long)p;
 }
 
+struct fd_stress {
+	pthread_t tid;
+	int cpu;
+	int fd;
+	int loops;
+	int status;
+	unsigned long long ns;
+};
+
+static volatile int fd_stress_done;
+
+static void *__fd_stress(void *arg)
+{
+	struct sched_param param = { .sched_priority = 1 };
+	unsigned long long start;
+	struct fd_stress *s = arg;
+	cpu_set_t cpus;
+	int n, magic;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(s->cpu, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	start = timer_get_tsc();
+
+	for (n = 0; n < s->loops; n++) {
+		if (ioctl(s->fd, RTTST_RTIOC_RTDM_PING_PRIMARY, &magic)) {
+			s->status = -errno;
+			break;
+		}
+	}
+
+	s->ns = timer_tsc2ns(timer_get_tsc() - start);
+
+	return NULL;
+}
+
+static void *__fd_churn(void *arg)
+{
+	int *status = arg, fd;
+
+	/*
+	 * Keep allocating and releasing a descriptor in the table
+	 * while the stress threads look up their own.
+	 */
+	while (!fd_stress_done) {
+		fd = open(devname2, O_RDWR);
+		if (fd < 0) {
+			*status = -errno;
+			break;
+		}
+		if (close(fd)) {
+			*status = -errno;
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static int test_fd_stress(int fd, int loops)
+{
+	int nr_cpus = 0, cpu_list[CPU_SETSIZE], cpu, nr, n, ret = 0;
+	int churn_status = 0;
+	struct fd_stress *s;
+	pthread_t churn;
+	cpu_set_t cpus;
+
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++)
+		if (CPU_ISSET(cpu, &cpus))
+			cpu_list[nr_cpus++] = cpu;
+
+	s = calloc(nr_cpus, sizeof(*s));
+	if (s == NULL)
+		return -ENOMEM;
+
+	fd_stress_done = 0;
+	if (!__T(ret, __STD(pthread_create(&churn, NULL, __fd_churn,
+					   &churn_status))))
+		goto out;
+
+	for (nr = 1; nr <= nr_cpus && ret == 0; nr *= 2) {
+		for (n = 0; n < nr; n++) {
+			s[n].cpu = cpu_list[n];
+			s[n].fd = fd;
+			s[n].loops = loops;
+			s[n].status = 0;
+			s[n].ns = 0;
+			if (!__T(ret, pthread_create(&s[n].tid, NULL,
+						     __fd_stress, s + n))) {
+				nr = n;
+				break;
+			}
+		}
+
+		for (n = 0; n < nr; n++) {
+			pthread_join(s[n].tid, NULL);
+			if (ret == 0)
+				ret = s[n].status;
+		}
+
+		if (ret)
+			break;
+
+		for (n = 0; n < nr; n++)
+			smokey_trace("  %2d thread(s), CPU%d: %9llu calls/s",
+				     nr, s[n].cpu,
+				     loops * 1000000000ULL / (s[n].ns ?: 1));
+	}
+
+	fd_stress_done = 1;
+	pthread_join(churn, NULL);
+	if (ret == 0)
+		ret = churn_status;
+out:
+	free(s);
+
+	return ret;
+}
+
 static int run_rtdm(struct smokey_test *t, int argc, char *const argv[])
 {
 	unsigned long long start;
-	int dev, dev2, status;
+	int dev, dev2, status, loops = 100000;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(rtdm, fd_loops))
+		loops = SMOKEY_ARG_INT(rtdm, fd_loops);
+
+	if (loops <= 0)
+		return -EINVAL;
 
 	status = system("modprobe -q xeno_rtdmtest");
 	if (status < 0 || WEXITSTATUS(status))
@@ -191,6 +329,11 @@ static int run_rtdm(struct smokey_test *t, int argc, char *const argv[])
 	if (status)
 		return status;
 
+	smokey_trace("Concurrent fd lookups");
+	status = test_fd_stress(dev, loops);
+	if (status)
+		return status;
+
 	smokey_trace("Defer close by pending reference");
 	check("ioctl", ioctl(dev, RTTST_RTIOC_RTDM_DEFER_CLOSE,
 			     RTTST_RTDM_DEFER_CLOSE_CONTEXT), 0);
@@ -0,0 +1,159 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <cobalt/tunables.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(rtprint,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(loops),
+		   ),
+		   "Check the deferred formatting mode of rt_printf() and\n"
+		   "\tcompare the writer-side cost of both modes.\n"
+		   "\tloops=<n>\tcalls per mode (default 1000)"
+);
+
+#define LINE_FMT	"%d: %8.3f %g %.4e |%-6s|%.3s|%*d|%lld|%zu|%c%%\n"
+#define LINE_ARGS(__i)							\
+	(__i), (__i) * 1.25, (__i) / 7.0, (__i) * 1e-3 * M_PI,		\
+	names[(__i) % 4], unterminated, (__i) % 9, (__i),		\
+	(long long)(__i) << 33, (size_t)(__i) * 3, 'a' + (__i) % 26
+
+static const char *names[] = { "alpha", "beta", "gamma", "" };
+
+static const char unterminated[3] = { 'x', 'y', 'z' };
+
+static inline long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int log_lines(FILE *fp, int loops, int deferred,
+		     long long *avg, long long *max)
+{
+	struct sched_param param;
+	long long t0, dt, sum = 0;
+	int n, ret;
+
+	set_runtime_tunable(print_deferred, deferred);
+
+	/* This switches to real-time mode over Cobalt. */
+	param.sched_priority = 1;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	*max = 0;
+	for (n = 0; n < loops; n++) {
+		t0 = now_ns();
+		ret = rt_fprintf(fp, LINE_FMT, LINE_ARGS(n));
+		dt = now_ns() - t0;
+		if (ret <= 0)
+			break;
+		sum += dt;
+		if (dt > *max)
+			*max = dt;
+	}
+
+	/* %m cannot be deferred, it must be formatted right away. */
+	errno = ENOENT;
+	rt_fprintf(fp, "%s: %m\n", deferred ? "deferred" : "immediate");
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+	set_runtime_tunable(print_deferred, 0);
+	rt_print_flush_buffers();
+
+	if (n < loops) {
+		smokey_warning("print buffer overflow after %d lines", n);
+		return -ENOSPC;
+	}
+
+	*avg = sum / loops;
+
+	return 0;
+}
+
+static int check_lines(FILE *fp, int loops, int deferred)
+{
+	char line[256], expected[256];
+	int n;
+
+	for (n = 0; n < loops; n++) {
+		snprintf(expected, sizeof(expected), LINE_FMT, LINE_ARGS(n));
+		if (!__Fassert(fgets(line, sizeof(line), fp) == NULL) ||
+		    !__Tassert(strcmp(line, expected) == 0)) {
+			smokey_warning("line %d: got '%s', expected '%s'",
+				       n, line, expected);
+			return -EPROTO;
+		}
+	}
+
+	snprintf(expected, sizeof(expected), "%s: %s\n",
+		 deferred ? "deferred" : "immediate", strerror(ENOENT));
+	if (!__Fassert(fgets(line, sizeof(line), fp) == NULL) ||
+	    !__Tassert(strcmp(line, expected) == 0))
+		return -EPROTO;
+
+	return 0;
+}
+
+static int run_rtprint(struct smokey_test *t, int argc, char *const argv[])
+{
+	long long avg[2], max[2];
+	int loops = 1000, ret, deferred;
+	FILE *fp;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(rtprint, loops))
+		loops = SMOKEY_ARG_INT(rtprint, loops);
+
+	if (loops <= 0)
+		return -EINVAL;
+
+	/* Make room for all lines of a run in the relay buffer. */
+	ret = rt_print_init(loops * 128 + 4096, "smokey-rtprint");
+	if (!__Tassert(ret == 0))
+		return -ret;
+
+	fp = tmpfile();
+	if (!__Fassert(fp == NULL))
+		return -errno;
+
+	for (deferred = 0; deferred < 2; deferred++) {
+		ret = log_lines(fp, loops, deferred,
+				&avg[deferred], &max[deferred]);
+		if (ret)
+			goto out;
+	}
+
+	fflush(fp);
+	rewind(fp);
+
+	for (deferred = 0; deferred < 2; deferred++) {
+		ret = check_lines(fp, loops, deferred);
+		if (ret)
+			goto out;
+	}
+
+	smokey_trace("immediate: avg %lld ns, max %lld ns per call",
+		     avg[0], max[0]);
+	smokey_trace("deferred:  avg %lld ns, max %lld ns per call",
+		     avg[1], max[1]);
+out:
+	fclose(fp);
+
+	return ret;
+}
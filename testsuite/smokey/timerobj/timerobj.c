@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <semaphore.h>
+#include <copperplate/timerobj.h>
+#include <copperplate/clockobj.h>
+#include <boilerplate/time.h>
+#include <smokey/smokey.h>
+
+smokey_test_plugin(timerobj,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_timers),
+			   SMOKEY_INT(shots),
+		   ),
+		   "Measure copperplate timer start/stop cost and firing jitter\n"
+		   "\tunder increasing load.\n"
+		   "\tmax_timers=<N>\tmax. number of armed timers (default 10000)\n"
+		   "\tshots=<N>\t# of probe timer shots per load (default 1000)"
+);
+
+#define PROBE_PERIOD_NS	1000000
+#define STARTSTOP_LOOPS	1000
+
+static struct timerobj probe;
+
+static sem_t probe_done;
+
+static int probe_shots, probe_count;
+
+static sticks_t probe_date, jitter_max, jitter_sum;
+
+static inline sticks_t get_time(void)
+{
+	struct timespec now;
+
+	__RT(clock_gettime(CLOCK_COPPERPLATE, &now));
+
+	return timespec_scalar(&now);
+}
+
+static void probe_handler(struct timerobj *tmobj)
+{
+	sticks_t lat;
+
+	lat = get_time() - probe_date;
+	probe_date += PROBE_PERIOD_NS;
+	if (lat > jitter_max)
+		jitter_max = lat;
+	jitter_sum += lat;
+
+	if (++probe_count == probe_shots)
+		__RT(sem_post(&probe_done));
+}
+
+static void null_handler(struct timerobj *tmobj)
+{
+}
+
+static int start_timer(struct timerobj *tmobj,
+		       void (*handler)(struct timerobj *tmobj),
+		       sticks_t date, sticks_t period)
+{
+	struct itimerspec it;
+
+	timespec_sets(&it.it_value, date);
+	timespec_sets(&it.it_interval, period);
+	timerobj_lock(tmobj);
+
+	return timerobj_start(tmobj, handler, &it);
+}
+
+static int stop_timer(struct timerobj *tmobj)
+{
+	timerobj_lock(tmobj);
+
+	return timerobj_stop(tmobj);
+}
+
+static void drop_timer(struct timerobj *tmobj)
+{
+	timerobj_lock(tmobj);
+	timerobj_destroy(tmobj);
+}
+
+static int measure_load(int nrtimers)
+{
+	sticks_t t0, t1, now, op_max, op_sum;
+	struct timerobj *timers;
+	int ret = 0, n, armed;
+
+	timers = malloc(nrtimers * sizeof(*timers));
+	if (timers == NULL)
+		return -ENOMEM;
+
+	/*
+	 * Spread the background timers from one minute to ~35 min
+	 * ahead, so that all levels of the wheel are populated
+	 * including the overflow list. None of them should fire
+	 * while we measure.
+	 */
+	now = get_time();
+	for (armed = 0; armed < nrtimers; armed++) {
+		ret = timerobj_init(timers + armed);
+		if (ret)
+			break;
+		ret = start_timer(timers + armed, null_handler,
+				  now + 60000000000LL +
+				  (armed % 2000) * 1000000000LL +
+				  armed * 37000LL, 0);
+		if (ret) {
+			drop_timer(timers + armed);
+			break;
+		}
+	}
+
+	if (ret) {
+		smokey_note("timerobj: could only arm %d timers out of %d (%s)",
+			    armed, nrtimers, symerror(ret));
+		ret = 0;
+		goto out;
+	}
+
+	op_max = op_sum = 0;
+	for (n = 0; n < STARTSTOP_LOOPS; n++) {
+		t0 = get_time();
+		ret = start_timer(&probe, null_handler,
+				  t0 + 10000000000LL, 0);
+		if (!__Tassert(ret == 0))
+			goto out;
+		ret = stop_timer(&probe);
+		if (!__Tassert(ret == 0))
+			goto out;
+		t1 = get_time();
+		if (t1 - t0 > op_max)
+			op_max = t1 - t0;
+		op_sum += t1 - t0;
+	}
+
+	probe_shots = smokey_arg_isset(&timerobj, "shots") ?
+		smokey_arg_int(&timerobj, "shots") : 1000;
+	probe_count = 0;
+	jitter_max = jitter_sum = 0;
+	probe_date = get_time() + PROBE_PERIOD_NS;
+	ret = start_timer(&probe, probe_handler, probe_date, PROBE_PERIOD_NS);
+	if (!__Tassert(ret == 0))
+		goto out;
+
+	__RT(sem_wait(&probe_done));
+	stop_timer(&probe);
+
+	smokey_trace("%6d timers: start+stop avg %lld ns, max %lld ns | "
+		     "jitter avg %lld ns, max %lld ns",
+		     nrtimers, op_sum / STARTSTOP_LOOPS, op_max,
+		     jitter_sum / probe_shots, jitter_max);
+out:
+	while (--armed >= 0)
+		drop_timer(timers + armed);
+
+	free(timers);
+
+	return ret;
+}
+
+static int run_timerobj(struct smokey_test *t, int argc, char *const argv[])
+{
+	int ret, nrtimers, max_timers = 10000;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (smokey_arg_isset(t, "max_timers"))
+		max_timers = smokey_arg_int(t, "max_timers");
+
+	ret = __RT(sem_init(&probe_done, 0, 0));
+	if (ret)
+		return -errno;
+
+	ret = timerobj_init(&probe);
+	if (ret)
+		goto out;
+
+	for (nrtimers = 10; nrtimers <= max_timers; nrtimers *= 10) {
+		ret = measure_load(nrtimers);
+		if (ret)
+			break;
+	}
+
+	drop_timer(&probe);
+out:
+	__RT(sem_destroy(&probe_done));
+
+	return ret;
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <smokey/smokey.h>
+#include <rtdm/testing.h>
+
+smokey_test_plugin(timerq,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(max_timers),
+			   SMOKEY_INT(loops),
+		   ),
+		   "Compare the timer queue implementations available to\n"
+		   "\tthe Cobalt core (list, rbtree, 4-ary heap).\n"
+		   "\tmax_timers=<n>\tlargest queue population (default 10000)\n"
+		   "\tloops=<n>\tremoval/expiry rounds per run (default 10000)"
+);
+
+static const char *backend_names[] = {
+	[RTTST_TIMERQ_LIST] = "list",
+	[RTTST_TIMERQ_RBTREE] = "rbtree",
+	[RTTST_TIMERQ_HEAP] = "heap",
+};
+
+static int run_timerq(struct smokey_test *t, int argc, char *const argv[])
+{
+	int max_timers = 10000, loops = 10000, fd, ret = 0, backend, n;
+	struct rttst_timerq_bench bench;
+	struct sched_param param;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(timerq, max_timers))
+		max_timers = SMOKEY_ARG_INT(timerq, max_timers);
+	if (SMOKEY_ARG_ISSET(timerq, loops))
+		loops = SMOKEY_ARG_INT(timerq, loops);
+
+	if (max_timers <= 0 || loops <= 0)
+		return -EINVAL;
+
+	fd = __RT(open("/dev/rtdm/timerqbench", O_RDWR));
+	if (fd < 0) {
+		smokey_note("timerq: skipped (no kernel support)");
+		return 0;
+	}
+
+	/* This switches to real-time mode over Cobalt. */
+	param.sched_priority = 1;
+	pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+
+	smokey_trace("%-8s %8s %10s %10s %10s %10s %10s %10s",
+		     "backend", "timers", "ins-avg", "ins-max",
+		     "rem-avg", "rem-max", "exp-avg", "exp-max");
+
+	for (backend = RTTST_TIMERQ_LIST;
+	     backend <= RTTST_TIMERQ_HEAP; backend++) {
+		for (n = 10; n <= max_timers; n *= 10) {
+			bench.backend = backend;
+			bench.nrtimers = n;
+			bench.loops = loops;
+			if (!__Tassert(__RT(ioctl(fd, RTTST_RTIOC_TIMERQ_BENCH,
+						   &bench)) == 0)) {
+				ret = -errno;
+				goto out;
+			}
+			smokey_trace("%-8s %8d %10lld %10lld %10lld %10lld %10lld %10lld",
+				     backend_names[backend], n,
+				     (long long)bench.insert_avg_ns,
+				     (long long)bench.insert_max_ns,
+				     (long long)bench.remove_avg_ns,
+				     (long long)bench.remove_max_ns,
+				     (long long)bench.expire_avg_ns,
+				     (long long)bench.expire_max_ns);
+		}
+	}
+out:
+	__RT(close(fd));
+
+	return ret;
+}
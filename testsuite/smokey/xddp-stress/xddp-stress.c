@@ -0,0 +1,440 @@
+/*
+ * RTIPC/XDDP stress test, measuring the cost of logging from RT
+ * threads to Linux through a message pipe.
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <smokey/smokey.h>
+#include <rtdm/ipc.h>
+
+smokey_test_plugin(xddp_stress,
+		   SMOKEY_ARGLIST(
+			   SMOKEY_INT(messages),
+			   SMOKEY_INT(msg_size),
+			   SMOKEY_INT(period),
+		   ),
+		   "Stream messages from a real-time thread to Linux over\n"
+		   "\tRTIPC/XDDP, reporting the RT-side send cost and the\n"
+		   "\tworst-case latency of an unrelated periodic RT thread,\n"
+		   "\tidle then under logging load.\n"
+		   "\tmessages=<n>\tmessages to send (default 100000)\n"
+		   "\tmsg_size=<bytes>\tmessage size (default 128)\n"
+		   "\tperiod=<us>\tlatency sampling period (default 100)"
+);
+
+#define XDDP_STRESS_LABEL	"xddp-stress-smokey"
+#define XDDP_STRESS_POOLSZ	(1024 * 1024)
+#define IDLE_SAMPLING_SECS	1
+#define READ_TIMEOUT_MS		5000
+
+struct sampler {
+	pthread_t tid;
+	int cpu;
+	long long period;
+	volatile int stop;
+	long long sum;
+	long long max;
+	long samples;
+	int status;
+};
+
+struct stress {
+	int messages;
+	int msg_size;
+	int cpu;
+	sem_t bound;
+	sem_t connected;
+	sem_t drained;
+	pthread_t sender;
+	pthread_t reader;
+	long long send_sum;
+	long long send_max;
+	long retries;
+	int sender_status;
+	int reader_status;
+};
+
+static inline long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void set_affinity(int cpu)
+{
+	cpu_set_t cpus;
+
+	if (cpu < 0)
+		return;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+	pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+}
+
+static void *latency_sampler(void *arg)
+{
+	struct sched_param param = { .sched_priority = 99 };
+	struct sampler *sp = arg;
+	long long expected, lat;
+	struct timespec ts;
+	int ret;
+
+	set_affinity(sp->cpu);
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret) {
+		sp->status = -ret;
+		return NULL;
+	}
+
+	expected = now_ns();
+
+	while (!sp->stop) {
+		expected += sp->period;
+		ts.tv_sec = expected / 1000000000LL;
+		ts.tv_nsec = expected % 1000000000LL;
+		ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+		if (ret) {
+			sp->status = -ret;
+			break;
+		}
+		lat = now_ns() - expected;
+		sp->sum += lat;
+		if (lat > sp->max)
+			sp->max = lat;
+		sp->samples++;
+	}
+
+	return NULL;
+}
+
+static int start_sampler(struct sampler *sp, int cpu, long long period)
+{
+	int ret;
+
+	memset(sp, 0, sizeof(*sp));
+	sp->cpu = cpu;
+	sp->period = period;
+
+	ret = pthread_create(&sp->tid, NULL, latency_sampler, sp);
+
+	return -ret;
+}
+
+static int stop_sampler(struct sampler *sp)
+{
+	sp->stop = 1;
+	pthread_join(sp->tid, NULL);
+
+	return sp->status;
+}
+
+static void *rt_sender(void *arg)
+{
+	struct sched_param param = { .sched_priority = 50 };
+	struct rtipc_port_label plabel;
+	struct stress *st = arg;
+	struct sockaddr_ipc saddr;
+	size_t poolsz = XDDP_STRESS_POOLSZ;
+	struct timespec backoff;
+	long long t0, dt;
+	unsigned int *buf;
+	int s, n, ret;
+
+	buf = calloc(1, st->msg_size);
+	if (buf == NULL) {
+		st->sender_status = -ENOMEM;
+		goto fail;
+	}
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
+	if (s < 0) {
+		st->sender_status = -errno;
+		goto fail_free;
+	}
+
+	ret = setsockopt(s, SOL_XDDP, XDDP_POOLSZ, &poolsz, sizeof(poolsz));
+	if (ret)
+		goto fail_close;
+
+	strcpy(plabel.label, XDDP_STRESS_LABEL);
+	ret = setsockopt(s, SOL_XDDP, XDDP_LABEL, &plabel, sizeof(plabel));
+	if (ret)
+		goto fail_close;
+
+	/* Messages sent with no address go to our own pipe. */
+	memset(&saddr, 0, sizeof(saddr));
+	saddr.sipc_family = AF_RTIPC;
+	saddr.sipc_port = -1;
+	ret = bind(s, (struct sockaddr *)&saddr, sizeof(saddr));
+	if (ret)
+		goto fail_close;
+
+	sem_post(&st->bound);
+	sem_wait(&st->connected);
+	if (st->reader_status)
+		goto out;
+
+	set_affinity(st->cpu);
+	ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+	if (ret) {
+		st->sender_status = -ret;
+		goto out;
+	}
+
+	backoff.tv_sec = 0;
+	backoff.tv_nsec = 100000;
+
+	for (n = 0; n < st->messages; ) {
+		buf[0] = n;
+		t0 = now_ns();
+		ret = sendto(s, buf, st->msg_size, MSG_DONTWAIT, NULL, 0);
+		dt = now_ns() - t0;
+		if (ret < 0) {
+			/* The Linux reader lags behind, let it drain. */
+			if (errno == ENOMEM && st->reader_status == 0) {
+				st->retries++;
+				clock_nanosleep(CLOCK_MONOTONIC, 0, &backoff, NULL);
+				continue;
+			}
+			st->sender_status = -errno;
+			break;
+		}
+		st->send_sum += dt;
+		if (dt > st->send_max)
+			st->send_max = dt;
+		n++;
+	}
+
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_OTHER, &param);
+out:
+	/* Closing the socket flushes what the reader did not get. */
+	sem_wait(&st->drained);
+	close(s);
+	free(buf);
+
+	return NULL;
+
+fail_close:
+	st->sender_status = -errno;
+	close(s);
+fail_free:
+	free(buf);
+fail:
+	sem_post(&st->bound);
+
+	return NULL;
+}
+
+static void *nrt_reader(void *arg)
+{
+	struct stress *st = arg;
+	struct pollfd pfd;
+	unsigned int *buf;
+	char *devname;
+	int fd, n, ret;
+
+	sem_wait(&st->bound);
+	if (st->sender_status)
+		goto done;
+
+	buf = __STD(malloc(st->msg_size));
+	if (buf == NULL) {
+		st->reader_status = -ENOMEM;
+		goto done;
+	}
+
+	if (asprintf(&devname, "/proc/xenomai/registry/rtipc/xddp/%s",
+		     XDDP_STRESS_LABEL) < 0) {
+		st->reader_status = -ENOMEM;
+		sem_post(&st->connected);
+		goto out;
+	}
+
+	do
+		fd = __STD(open(devname, O_RDONLY));
+	while (fd < 0 && errno == ENOENT);
+	free(devname);
+	if (fd < 0)
+		st->reader_status = -errno;
+
+	sem_post(&st->connected);
+	if (fd < 0)
+		goto out;
+
+	pfd.fd = fd;
+	pfd.events = POLLIN;
+
+	for (n = 0; n < st->messages; n++) {
+		ret = __STD(poll(&pfd, 1, READ_TIMEOUT_MS));
+		if (ret <= 0) {
+			st->reader_status = ret ? -errno : -ETIMEDOUT;
+			smokey_warning("waiting for message #%d: %s",
+				       n, symerror(st->reader_status));
+			break;
+		}
+		ret = __STD(read(fd, buf, st->msg_size));
+		if (ret != st->msg_size) {
+			st->reader_status = ret < 0 ? -errno : -EPROTO;
+			break;
+		}
+		if (buf[0] != (unsigned int)n) {
+			smokey_warning("got message #%u, expected #%d",
+				       buf[0], n);
+			st->reader_status = -EPROTO;
+			break;
+		}
+	}
+
+	__STD(close(fd));
+out:
+	__STD(free(buf));
+	sem_post(&st->drained);
+
+	return NULL;
+done:
+	sem_post(&st->connected);
+	sem_post(&st->drained);
+
+	return NULL;
+}
+
+static int run_stress(struct stress *st, int sampler_cpu, long long period)
+{
+	struct sched_param param = { .sched_priority = 0 };
+	pthread_attr_t attr;
+	struct sampler sp;
+	int ret;
+
+	ret = start_sampler(&sp, sampler_cpu, period);
+	if (ret)
+		return ret;
+
+	sleep(IDLE_SAMPLING_SECS);
+	ret = stop_sampler(&sp);
+	if (ret)
+		return ret;
+
+	smokey_trace("idle:       %7ld samples, latency avg %6lld ns, "
+		     "max %8lld ns", sp.samples,
+		     sp.sum / (sp.samples ?: 1), sp.max);
+
+	ret = start_sampler(&sp, sampler_cpu, period);
+	if (ret)
+		return ret;
+
+	sem_init(&st->bound, 0, 0);
+	sem_init(&st->connected, 0, 0);
+	sem_init(&st->drained, 0, 0);
+
+	pthread_attr_init(&attr);
+	pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+	pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+	pthread_attr_setschedparam(&attr, &param);
+
+	ret = -pthread_create(&st->reader, &attr, nrt_reader, st);
+	if (ret)
+		goto out;
+
+	ret = -pthread_create(&st->sender, &attr, rt_sender, st);
+	if (ret) {
+		st->sender_status = ret;
+		sem_post(&st->bound);
+	} else
+		pthread_join(st->sender, NULL);
+
+	pthread_join(st->reader, NULL);
+out:
+	pthread_attr_destroy(&attr);
+	stop_sampler(&sp);
+	sem_destroy(&st->drained);
+	sem_destroy(&st->connected);
+	sem_destroy(&st->bound);
+
+	if (ret == 0)
+		ret = st->sender_status ?: st->reader_status;
+	if (ret)
+		return ret;
+
+	smokey_trace("under load: %7ld samples, latency avg %6lld ns, "
+		     "max %8lld ns", sp.samples,
+		     sp.sum / (sp.samples ?: 1), sp.max);
+	smokey_trace("send:       %7d x %d bytes, avg %6lld ns, "
+		     "max %8lld ns, %ld retries", st->messages, st->msg_size,
+		     st->send_sum / st->messages, st->send_max, st->retries);
+
+	return 0;
+}
+
+static int run_xddp_stress(struct smokey_test *t, int argc, char *const argv[])
+{
+	int messages = 100000, msg_size = 128, period = 100;
+	int nr_cpus = 0, cpu_list[2], cpu, s, ret;
+	struct stress st;
+	cpu_set_t cpus;
+
+	smokey_parse_args(t, argc, argv);
+
+	if (SMOKEY_ARG_ISSET(xddp_stress, messages))
+		messages = SMOKEY_ARG_INT(xddp_stress, messages);
+
+	if (SMOKEY_ARG_ISSET(xddp_stress, msg_size))
+		msg_size = SMOKEY_ARG_INT(xddp_stress, msg_size);
+
+	if (SMOKEY_ARG_ISSET(xddp_stress, period))
+		period = SMOKEY_ARG_INT(xddp_stress, period);
+
+	if (messages <= 0 || period <= 0 ||
+	    msg_size < (int)sizeof(unsigned int) ||
+	    msg_size > XDDP_STRESS_POOLSZ / 16)
+		return -EINVAL;
+
+	s = socket(AF_RTIPC, SOCK_DGRAM, IPCPROTO_XDDP);
+	if (s < 0) {
+		if (errno == EAFNOSUPPORT)
+			return -ENOSYS;
+		return -errno;
+	}
+	close(s);
+
+	/*
+	 * The sampler and the sender run on distinct CPUs when
+	 * possible, so that only the serialization both paths
+	 * share shows up in the latency figures.
+	 */
+	if (sched_getaffinity(0, sizeof(cpus), &cpus))
+		return -errno;
+
+	for (cpu = 0; cpu < CPU_SETSIZE && nr_cpus < 2; cpu++)
+		if (CPU_ISSET(cpu, &cpus))
+			cpu_list[nr_cpus++] = cpu;
+
+	memset(&st, 0, sizeof(st));
+	st.messages = messages;
+	st.msg_size = msg_size;
+	st.cpu = nr_cpus > 1 ? cpu_list[1] : -1;
+
+	smokey_trace("sampling every %d us on CPU%d, sender on CPU%d",
+		     period, cpu_list[0], nr_cpus > 1 ? cpu_list[1] : cpu_list[0]);
+
+	ret = run_stress(&st, nr_cpus > 1 ? cpu_list[0] : -1, period * 1000LL);
+
+	return ret;
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <errno.h>
+#include <alchemy/task.h>
+#include <alchemy/sem.h>
+#include "syncbench.h"
+
+static RT_SEM ping, pong;
+
+static RT_TASK master, peer;
+
+static unsigned long nr_loops;
+
+static void master_task(void *arg)
+{
+	struct syncbench_stats *stats = arg;
+	unsigned long long t0;
+	unsigned long n;
+
+	stats->start_ns = syncbench_now();
+
+	for (n = 0; n < nr_loops; n++) {
+		t0 = syncbench_now();
+		if (rt_sem_v(&ping) || rt_sem_p(&pong, TM_INFINITE)) {
+			/* Do not leave the peer pending on ping forever. */
+			rt_task_delete(&peer);
+			break;
+		}
+		syncbench_account(stats, t0);
+	}
+
+	stats->end_ns = syncbench_now();
+}
+
+static void peer_task(void *arg)
+{
+	unsigned long n;
+
+	for (n = 0; n < nr_loops; n++) {
+		if (rt_sem_p(&ping, TM_INFINITE) || rt_sem_v(&pong)) {
+			/* Do not leave the master pending on pong forever. */
+			rt_task_delete(&master);
+			break;
+		}
+	}
+}
+
+int syncbench_alchemy(unsigned long loops, struct syncbench_stats *stats)
+{
+	int ret;
+
+	nr_loops = loops;
+
+	ret = rt_sem_create(&ping, "syncbench-ping", 0, S_FIFO);
+	if (ret)
+		return ret;
+
+	ret = rt_sem_create(&pong, "syncbench-pong", 0, S_FIFO);
+	if (ret)
+		goto fail_pong;
+
+	ret = rt_task_create(&peer, "syncbench-peer", 0,
+			     SYNCBENCH_PRIO, T_JOINABLE);
+	if (ret)
+		goto out;
+
+	ret = rt_task_create(&master, "syncbench-master", 0,
+			     SYNCBENCH_PRIO, T_JOINABLE);
+	if (ret)
+		goto fail_master;
+
+	rt_task_start(&peer, peer_task, NULL);
+	rt_task_start(&master, master_task, stats);
+	rt_task_join(&master);
+	rt_task_join(&peer);
+
+	ret = stats->loops == loops ? 0 : -EPIPE;
+	goto out;
+fail_master:
+	rt_task_delete(&peer);
+out:
+	rt_sem_delete(&pong);
+fail_pong:
+	rt_sem_delete(&ping);
+
+	return ret;
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <errno.h>
+#include <semaphore.h>
+#include <psos/psos.h>
+#include "syncbench.h"
+
+static u_long ping_qid, pong_qid;
+
+static u_long master_tid, peer_tid;
+
+static unsigned long nr_loops;
+
+static sem_t done;
+
+/*
+ * A task leaving the ping-pong loop early would leave the other one
+ * waiting forever for the next message. Delete it, posting its
+ * completion on its behalf.
+ */
+static void abort_peer(u_long tid)
+{
+	if (t_delete(tid) == SUCCESS)
+		sem_post(&done);
+}
+
+static void master_task(u_long a0, u_long a1, u_long a2, u_long a3)
+{
+	struct syncbench_stats *stats = (struct syncbench_stats *)a0;
+	u_long msgbuf[4] = { 0, 0, 0, 0 };
+	unsigned long long t0;
+	unsigned long n;
+
+	stats->start_ns = syncbench_now();
+
+	for (n = 0; n < nr_loops; n++) {
+		t0 = syncbench_now();
+		msgbuf[0] = n;
+		if (q_send(ping_qid, msgbuf) ||
+		    q_receive(pong_qid, Q_WAIT, 0, msgbuf)) {
+			abort_peer(peer_tid);
+			break;
+		}
+		syncbench_account(stats, t0);
+	}
+
+	stats->end_ns = syncbench_now();
+	sem_post(&done);
+}
+
+static void peer_task(u_long a0, u_long a1, u_long a2, u_long a3)
+{
+	u_long msgbuf[4];
+	unsigned long n;
+
+	for (n = 0; n < nr_loops; n++) {
+		if (q_receive(ping_qid, Q_WAIT, 0, msgbuf) ||
+		    q_send(pong_qid, msgbuf)) {
+			abort_peer(master_tid);
+			break;
+		}
+	}
+
+	sem_post(&done);
+}
+
+int syncbench_psos(unsigned long loops, struct syncbench_stats *stats)
+{
+	u_long args[4] = { (u_long)stats, 0, 0, 0 };
+	int ret = -ENOMEM;
+
+	nr_loops = loops;
+	sem_init(&done, 0, 0);
+
+	if (q_create("SBPI", 1, Q_LIMIT|Q_FIFO, &ping_qid))
+		goto fail_ping;
+
+	if (q_create("SBPO", 1, Q_LIMIT|Q_FIFO, &pong_qid))
+		goto fail_pong;
+
+	/* pSOS priorities rise with the level. */
+	if (t_create("SBPE", SYNCBENCH_PRIO, 0, 0, 0, &peer_tid))
+		goto out;
+
+	if (t_create("SBMA", SYNCBENCH_PRIO, 0, 0, 0, &master_tid))
+		goto fail_master;
+
+	t_start(peer_tid, 0, peer_task, args);
+	t_start(master_tid, 0, master_task, args);
+	sem_wait(&done);
+	sem_wait(&done);
+
+	ret = stats->loops == loops ? 0 : -EPIPE;
+	goto out;
+fail_master:
+	t_delete(peer_tid);
+out:
+	q_delete(pong_qid);
+fail_pong:
+	q_delete(ping_qid);
+fail_ping:
+	sem_destroy(&done);
+
+	return ret;
+}
@@ -0,0 +1,121 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ *
+ * Context switch benchmark over the blocking primitives of the
+ * Alchemy, pSOS and VxWorks APIs. Over Mercury, every test runs once
+ * with the futex-based copperplate monitor, then once with the
+ * condvar-based one, so that both implementations can be compared
+ * within a single run.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <xeno_config.h>
+#include <xenomai/init.h>
+#include <copperplate/tunables.h>
+#include "syncbench.h"
+
+static const struct syncbench_test {
+	const char *name;
+	int (*run)(unsigned long loops, struct syncbench_stats *stats);
+} tests[] = {
+	{ "alchemy", syncbench_alchemy },
+	{ "psos", syncbench_psos },
+	{ "vxworks", syncbench_vxworks },
+};
+
+static const struct syncbench_monitor {
+	const char *name;
+	int condvar;
+} monitors[] = {
+#ifdef CONFIG_XENO_MERCURY
+	{ "futex", 0 },
+	{ "condvar", 1 },
+#else
+	{ "cobalt", 0 },
+#endif
+};
+
+static unsigned long loops = 100000;
+
+static const char *test_name;
+
+void application_usage(void)
+{
+        fprintf(stderr, "usage: %s [options]:\n", get_program_name());
+	fprintf(stderr,
+		"-l <loops>                      round-trips per test, default=100000\n"
+		"-t <alchemy|psos|vxworks>       only run the given test\n"
+		);
+}
+
+static int run_test(const struct syncbench_test *t,
+		    const struct syncbench_monitor *m)
+{
+	struct syncbench_stats stats;
+	unsigned long long elapsed;
+	int ret;
+
+	memset(&stats, 0, sizeof(stats));
+#ifdef CONFIG_XENO_MERCURY
+	/* Only applies to the objects created by the test. */
+	set_runtime_tunable(condvar_monitor, m->condvar);
+#endif
+	ret = t->run(loops, &stats);
+	if (ret) {
+		fprintf(stderr, "syncbench: %s/%s failed: %s\n",
+			t->name, m->name, strerror(-ret));
+		return ret;
+	}
+
+	elapsed = stats.end_ns - stats.start_ns ?: 1;
+	printf("%-8s %-8s %10lu %10llu %10llu %12llu\n",
+	       t->name, m->name, stats.loops,
+	       stats.total_ns / stats.loops, stats.max_ns,
+	       stats.loops * 2 * 1000000000ULL / elapsed);
+
+	return 0;
+}
+
+int main(int argc, char *const *argv)
+{
+	int c, condvar, status = 0;
+	unsigned int n, m;
+
+	while ((c = getopt(argc, argv, "l:t:")) != EOF)
+		switch (c) {
+		case 'l':
+			loops = strtoul(optarg, NULL, 0);
+			if (loops == 0) {
+				fprintf(stderr, "syncbench: invalid loop count.\n");
+				exit(2);
+			}
+			break;
+		case 't':
+			test_name = optarg;
+			break;
+		default:
+			xenomai_usage();
+			exit(2);
+		}
+
+	printf("%-8s %-8s %10s %10s %10s %12s\n",
+	       "TEST", "MONITOR", "LOOPS", "AVG(ns)", "MAX(ns)", "SWITCHES/s");
+
+	condvar = get_runtime_tunable(condvar_monitor);
+
+	for (n = 0; n < sizeof(tests) / sizeof(tests[0]); n++) {
+		if (test_name && strcmp(test_name, tests[n].name))
+			continue;
+		for (m = 0; m < sizeof(monitors) / sizeof(monitors[0]); m++)
+			if (run_test(tests + n, monitors + m))
+				status = 1;
+	}
+
+	set_runtime_tunable(condvar_monitor, condvar);
+
+	return status;
+}
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#ifndef _TESTSUITE_SYNCBENCH_H
+#define _TESTSUITE_SYNCBENCH_H
+
+#include <time.h>
+
+#define SYNCBENCH_PRIO	50
+
+struct syncbench_stats {
+	unsigned long loops;
+	unsigned long long total_ns;
+	unsigned long long max_ns;
+	unsigned long long start_ns;
+	unsigned long long end_ns;
+};
+
+static inline unsigned long long syncbench_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void syncbench_account(struct syncbench_stats *stats,
+				     unsigned long long t0)
+{
+	unsigned long long dt = syncbench_now() - t0;
+
+	stats->total_ns += dt;
+	if (dt > stats->max_ns)
+		stats->max_ns = dt;
+	stats->loops++;
+}
+
+/*
+ * Each test runs a ping-pong between two tasks of the same priority
+ * over a pair of blocking objects of the tested API, for the given
+ * number of round-trips.
+ */
+int syncbench_alchemy(unsigned long loops, struct syncbench_stats *stats);
+
+int syncbench_psos(unsigned long loops, struct syncbench_stats *stats);
+
+int syncbench_vxworks(unsigned long loops, struct syncbench_stats *stats);
+
+#endif /* !_TESTSUITE_SYNCBENCH_H */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <errno.h>
+#include <semaphore.h>
+#include <copperplate/threadobj.h>
+#include <vxworks/errnoLib.h>
+#include <vxworks/taskLib.h>
+#include <vxworks/msgQLib.h>
+#include "syncbench.h"
+
+static MSG_Q_ID ping_qid, pong_qid;
+
+static TASK_ID master_tid, peer_tid;
+
+static unsigned long nr_loops;
+
+static sem_t done;
+
+/*
+ * A task leaving the ping-pong loop early would leave the other one
+ * waiting forever for the next message. Delete it, posting its
+ * completion on its behalf.
+ */
+static void abort_peer(TASK_ID tid)
+{
+	if (tid && taskDelete(tid) == OK)
+		sem_post(&done);
+}
+
+static void masterTask(long arg, ...)
+{
+	struct syncbench_stats *stats = (struct syncbench_stats *)arg;
+	unsigned long long t0;
+	unsigned long n;
+	long msg;
+
+	/* Published before the peer may hear from us. */
+	master_tid = taskIdSelf();
+	stats->start_ns = syncbench_now();
+
+	for (n = 0; n < nr_loops; n++) {
+		t0 = syncbench_now();
+		msg = n;
+		if (msgQSend(ping_qid, (char *)&msg, sizeof(msg),
+			     WAIT_FOREVER, MSG_PRI_NORMAL) == ERROR ||
+		    msgQReceive(pong_qid, (char *)&msg, sizeof(msg),
+				WAIT_FOREVER) == ERROR) {
+			abort_peer(peer_tid);
+			break;
+		}
+		syncbench_account(stats, t0);
+	}
+
+	stats->end_ns = syncbench_now();
+	sem_post(&done);
+}
+
+static void peerTask(long arg, ...)
+{
+	unsigned long n;
+	long msg;
+
+	for (n = 0; n < nr_loops; n++) {
+		if (msgQReceive(ping_qid, (char *)&msg, sizeof(msg),
+				WAIT_FOREVER) == ERROR ||
+		    msgQSend(pong_qid, (char *)&msg, sizeof(msg),
+			     WAIT_FOREVER, MSG_PRI_NORMAL) == ERROR) {
+			abort_peer(master_tid);
+			break;
+		}
+	}
+
+	sem_post(&done);
+}
+
+int syncbench_vxworks(unsigned long loops, struct syncbench_stats *stats)
+{
+	/* VxWorks priorities decrease as the level rises. */
+	int prio = threadobj_high_prio - SYNCBENCH_PRIO - 1, ret = -ENOMEM;
+
+	nr_loops = loops;
+	master_tid = 0;
+	sem_init(&done, 0, 0);
+
+	ping_qid = msgQCreate(1, sizeof(long), MSG_Q_FIFO);
+	if (ping_qid == 0)
+		goto fail_ping;
+
+	pong_qid = msgQCreate(1, sizeof(long), MSG_Q_FIFO);
+	if (pong_qid == 0)
+		goto fail_pong;
+
+	peer_tid = taskSpawn("syncbench-peer", prio, 0, 0, peerTask,
+			     0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+	if (peer_tid == ERROR)
+		goto out;
+
+	if (taskSpawn("syncbench-master", prio, 0, 0, masterTask,
+		      (long)stats, 0, 0, 0, 0, 0, 0, 0, 0, 0) == ERROR) {
+		taskDelete(peer_tid);
+		goto out;
+	}
+
+	sem_wait(&done);
+	sem_wait(&done);
+
+	ret = stats->loops == loops ? 0 : -EPIPE;
+out:
+	msgQDelete(pong_qid);
+fail_pong:
+	msgQDelete(ping_qid);
+fail_ping:
+	sem_destroy(&done);
+
+	return ret;
+}
@@ -0,0 +1,491 @@
+/**
+ * Analogy for Linux, conversion throughput test program
+ *
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * Xenomai is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * Xenomai is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Xenomai; if not, write to the Free Software Foundation,
+ * Inc., 59 Temple Place - Suite 330, Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <getopt.h>
+#include <rtdm/analogy.h>
+
+#define FILENAME "analogy0"
+#define ACQ_SIZE 4096
+#define SAMPLE_CNT 65536
+#define LOOP_CNT 200
+
+static char *filename = FILENAME;
+static int verbose;
+static int idx_subd = -1;
+static int idx_chan;
+static int idx_rng;
+static int nb_bits;
+static int sample_cnt = SAMPLE_CNT;
+static int loop_cnt = LOOP_CNT;
+
+struct option conv_bench_opts[] = {
+	{"verbose", no_argument, NULL, 'v'},
+	{"device", required_argument, NULL, 'd'},
+	{"subdevice", required_argument, NULL, 's'},
+	{"channel", required_argument, NULL, 'c'},
+	{"range", required_argument, NULL, 'R'},
+	{"bits", required_argument, NULL, 'b'},
+	{"samples", required_argument, NULL, 'S'},
+	{"loops", required_argument, NULL, 'l'},
+	{"help", no_argument, NULL, 'h'},
+	{0},
+};
+
+static void do_print_usage(void)
+{
+	fprintf(stdout, "usage:\tconv_bench [OPTS]\n");
+	fprintf(stdout, "\tOPTS:\t -v, --verbose: verbose output\n");
+	fprintf(stdout,
+		"\t\t -d, --device: device filename (analogy0, analogy1, ...)\n");
+	fprintf(stdout, "\t\t -s, --subdevice: subdevice index\n");
+	fprintf(stdout, "\t\t -c, --channel: channel to use\n");
+	fprintf(stdout, "\t\t -R, --range: range to use\n");
+	fprintf(stdout,
+		"\t\t -b, --bits: override the channel resolution "
+		"(0 = all of 8, 16 and 32)\n");
+	fprintf(stdout, "\t\t -S, --samples: samples per conversion call\n");
+	fprintf(stdout, "\t\t -l, --loops: conversion calls per test\n");
+	fprintf(stdout, "\t\t -h, --help: print this help\n");
+	fprintf(stdout,
+		"\n\tSet A4L_CONVERT=scalar|sse2|avx2|neon to force the "
+		"conversion kernels\n");
+}
+
+static inline double now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static lsampl_t raw_get(const void *buf, int n, int width)
+{
+	switch (width) {
+	case 1:
+		return ((const uint8_t *)buf)[n];
+	case 2:
+		return ((const uint16_t *)buf)[n];
+	default:
+		return ((const uint32_t *)buf)[n];
+	}
+}
+
+static void raw_set(void *buf, int n, lsampl_t val, int width)
+{
+	switch (width) {
+	case 1:
+		((uint8_t *)buf)[n] = (uint8_t)val;
+		break;
+	case 2:
+		((uint16_t *)buf)[n] = (uint16_t)val;
+		break;
+	default:
+		((uint32_t *)buf)[n] = (uint32_t)val;
+	}
+}
+
+/*
+ * The reference results follow the plain C arithmetic of the
+ * original conversion routines, the library output must match them
+ * bit for bit whatever kernels it picked.
+ */
+static int check_bits(const char *what, const void *ref,
+		      const void *out, int size, int cnt)
+{
+	int n;
+
+	for (n = 0; n < cnt; n++) {
+		if (memcmp(ref + n * size, out + n * size, size)) {
+			fprintf(stderr,
+				"conv_bench: %s mismatch at sample %d\n",
+				what, n);
+			return -EPROTO;
+		}
+	}
+
+	return 0;
+}
+
+static void report(const char *what, int width, double elapsed)
+{
+	double msps = (double)sample_cnt * loop_cnt * 1e3 / elapsed;
+
+	fprintf(stdout, "%-10s %2d bits  %10.1f Msamples/s  %8.1f us/call\n",
+		what, width * 8, msps, elapsed / loop_cnt / 1e3);
+}
+
+static int run_width(a4l_chinfo_t *chan, a4l_rnginfo_t *rng,
+		     void *raw, int width)
+{
+	double coeff[4] = { -1.5e-3, 3.05e-4, 1.2e-12, -4.0e-19 };
+	struct a4l_polynomial converter = {
+		.expansion = (int)(((1ULL << chan->nb_bits) - 1) / 2),
+		.order = 3,
+		.nb_coeff = 4,
+		.coeff = coeff,
+	};
+	double *dref, *dout, da, db, t, term;
+	void *rref = NULL, *rout = NULL;
+	float *fref, *fout, fa, fb;
+	int n, k, loop, err;
+	lsampl_t tmp;
+
+	fref = malloc(sample_cnt * sizeof(*fref));
+	fout = malloc(sample_cnt * sizeof(*fout));
+	dref = malloc(sample_cnt * sizeof(*dref));
+	dout = malloc(sample_cnt * sizeof(*dout));
+	rref = malloc(sample_cnt * width);
+	rout = malloc(sample_cnt * width);
+	if (fref == NULL || fout == NULL || dref == NULL ||
+	    dout == NULL || rref == NULL || rout == NULL) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	fa = ((float)(rng->max - rng->min)) /
+		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
+	fb = ((float)rng->min) / A4L_RNG_FACTOR;
+	da = ((double)(rng->max - rng->min)) /
+		(((1ULL << chan->nb_bits) - 1) * A4L_RNG_FACTOR);
+	db = ((double)rng->min) / A4L_RNG_FACTOR;
+
+	/* raw -> float */
+	for (n = 0; n < sample_cnt; n++)
+		fref[n] = fa * raw_get(raw, n, width) + fb;
+	t = now_ns();
+	for (loop = 0; loop < loop_cnt; loop++) {
+		err = a4l_rawtof(chan, rng, fout, raw, sample_cnt);
+		if (err < 0)
+			goto out;
+	}
+	report("rawtof", width, now_ns() - t);
+	err = check_bits("rawtof", fref, fout, sizeof(*fref), sample_cnt);
+	if (err)
+		goto out;
+
+	/* raw -> double */
+	for (n = 0; n < sample_cnt; n++)
+		dref[n] = da * raw_get(raw, n, width) + db;
+	t = now_ns();
+	for (loop = 0; loop < loop_cnt; loop++) {
+		err = a4l_rawtod(chan, rng, dout, raw, sample_cnt);
+		if (err < 0)
+			goto out;
+	}
+	report("rawtod", width, now_ns() - t);
+	err = check_bits("rawtod", dref, dout, sizeof(*dref), sample_cnt);
+	if (err)
+		goto out;
+
+	/* float -> raw, fed back with the physical values above */
+	fa = (((float)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
+		((1ULL << chan->nb_bits) - 1);
+	fb = ((float)(rng->min) / (rng->max - rng->min)) *
+		((1ULL << chan->nb_bits) - 1);
+	for (n = 0; n < sample_cnt; n++)
+		raw_set(rref, n, (lsampl_t)(fa * fref[n] - fb), width);
+	t = now_ns();
+	for (loop = 0; loop < loop_cnt; loop++) {
+		err = a4l_ftoraw(chan, rng, rout, fref, sample_cnt);
+		if (err < 0)
+			goto out;
+	}
+	report("ftoraw", width, now_ns() - t);
+	err = check_bits("ftoraw", rref, rout, width, sample_cnt);
+	if (err)
+		goto out;
+
+	/* double -> raw */
+	da = (((double)A4L_RNG_FACTOR) / (rng->max - rng->min)) *
+		((1ULL << chan->nb_bits) - 1);
+	db = ((double)(rng->min) / (rng->max - rng->min)) *
+		((1ULL << chan->nb_bits) - 1);
+	for (n = 0; n < sample_cnt; n++)
+		raw_set(rref, n, (lsampl_t)(da * dref[n] - db), width);
+	t = now_ns();
+	for (loop = 0; loop < loop_cnt; loop++) {
+		err = a4l_dtoraw(chan, rng, rout, dref, sample_cnt);
+		if (err < 0)
+			goto out;
+	}
+	report("dtoraw", width, now_ns() - t);
+	err = check_bits("dtoraw", rref, rout, width, sample_cnt);
+	if (err)
+		goto out;
+
+	/* raw -> calibrated double */
+	for (n = 0; n < sample_cnt; n++) {
+		tmp = raw_get(raw, n, width);
+		dref[n] = 0.0;
+		term = 1.0;
+		for (k = 0; k < converter.nb_coeff; k++) {
+			dref[n] += converter.coeff[k] * term;
+			term *= (double)tmp - converter.expansion;
+		}
+	}
+	t = now_ns();
+	for (loop = 0; loop < loop_cnt; loop++) {
+		err = a4l_rawtodcal(chan, dout, raw, sample_cnt, &converter);
+		if (err < 0)
+			goto out;
+	}
+	report("rawtodcal", width, now_ns() - t);
+	err = check_bits("rawtodcal", dref, dout, sizeof(*dref), sample_cnt);
+out:
+	free(rout);
+	free(rref);
+	free(dout);
+	free(dref);
+	free(fout);
+	free(fref);
+
+	return err < 0 ? err : 0;
+}
+
+/*
+ * Tile the acquired samples over the whole buffer; when the
+ * resolution is overridden, stretch them to the requested width and
+ * mix in some noise so that every bit gets exercised.
+ */
+static void *build_samples(a4l_chinfo_t *dev_chan, unsigned char *acq,
+			   int acq_cnt, int width)
+{
+	int dev_width = a4l_sizeof_chan(dev_chan), n, shift;
+	lsampl_t val, mask;
+	void *raw;
+
+	raw = malloc(sample_cnt * width);
+	if (raw == NULL)
+		return NULL;
+
+	mask = width == 4 ? 0xffffffffUL : (1UL << (width * 8)) - 1;
+	shift = (width - dev_width) * 8;
+
+	for (n = 0; n < sample_cnt; n++) {
+		val = raw_get(acq, n % acq_cnt, dev_width);
+		if (shift > 0)
+			val = (val << shift) | (lrand48() & ((1UL << shift) - 1));
+		else if (shift < 0)
+			val >>= -shift;
+		raw_set(raw, n, val & mask, width);
+	}
+
+	return raw;
+}
+
+int main(int argc, char *argv[])
+{
+	static unsigned char acq[ACQ_SIZE];
+	a4l_desc_t dsc = { .sbdata = NULL };
+	int err = 0, width, acq_cnt, bits;
+	a4l_chinfo_t *chinfo, chan;
+	a4l_sbinfo_t *sbinfo;
+	a4l_rnginfo_t *rnginfo;
+	const char *impl;
+	void *raw;
+
+	/* Compute arguments */
+	while ((err = getopt_long(argc,
+				  argv,
+				  "vd:s:c:R:b:S:l:h", conv_bench_opts,
+				  NULL)) >= 0) {
+		switch (err) {
+		case 'v':
+			verbose = 1;
+			break;
+		case 'd':
+			filename = optarg;
+			break;
+		case 's':
+			idx_subd = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			idx_chan = strtoul(optarg, NULL, 0);
+			break;
+		case 'R':
+			idx_rng = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			nb_bits = strtoul(optarg, NULL, 0);
+			break;
+		case 'S':
+			sample_cnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			loop_cnt = strtoul(optarg, NULL, 0);
+			break;
+		case 'h':
+		default:
+			do_print_usage();
+			return 0;
+		}
+	}
+
+	if (sample_cnt <= 0 || loop_cnt <= 0 ||
+	    (optind < argc) || nb_bits < 0 || nb_bits > 32) {
+		do_print_usage();
+		return -EINVAL;
+	}
+
+	/* Open the device */
+	err = a4l_open(&dsc, filename);
+	if (err < 0) {
+		fprintf(stderr,
+			"conv_bench: a4l_open %s failed (err=%d)\n",
+			filename, err);
+		return err;
+	}
+
+	/* Allocate a buffer so as to get more info (subd, chan, rng) */
+	dsc.sbdata = malloc(dsc.sbsize);
+	if (dsc.sbdata == NULL) {
+		err = -ENOMEM;
+		fprintf(stderr, "conv_bench: info buffer allocation failed\n");
+		goto out_conv_bench;
+	}
+
+	err = a4l_fill_desc(&dsc);
+	if (err < 0) {
+		fprintf(stderr, "conv_bench: a4l_fill_desc failed (err=%d)\n",
+			err);
+		goto out_conv_bench;
+	}
+
+	if (idx_subd == -1)
+		idx_subd = dsc.idx_read_subd;
+
+	if (idx_subd == -1) {
+		fprintf(stderr,
+			"conv_bench: no analog input subdevice available\n");
+		err = -EINVAL;
+		goto out_conv_bench;
+	}
+
+	err = a4l_get_subdinfo(&dsc, idx_subd, &sbinfo);
+	if (err < 0) {
+		fprintf(stderr,
+			"conv_bench: get_sbinfo(%d) failed (err = %d)\n",
+			idx_subd, err);
+		goto out_conv_bench;
+	}
+
+	if ((sbinfo->flags & A4L_SUBD_TYPES) != A4L_SUBD_AI) {
+		fprintf(stderr,
+			"conv_bench: wrong subdevice selected "
+			"(not an analog input)\n");
+		err = -EINVAL;
+		goto out_conv_bench;
+	}
+
+	err = a4l_get_chinfo(&dsc, idx_subd, idx_chan, &chinfo);
+	if (err < 0) {
+		fprintf(stderr,
+			"conv_bench: info for channel %d on subdevice %d "
+			"not available (err=%d)\n",
+			idx_chan, idx_subd, err);
+		goto out_conv_bench;
+	}
+
+	err = a4l_get_rnginfo(&dsc, idx_subd, idx_chan, idx_rng, &rnginfo);
+	if (err < 0) {
+		fprintf(stderr,
+			"conv_bench: failed to recover range descriptor\n");
+		goto out_conv_bench;
+	}
+
+	width = a4l_sizeof_chan(chinfo);
+	if (width < 0) {
+		fprintf(stderr,
+			"conv_bench: incoherent info for channel %d\n",
+			idx_chan);
+		err = width;
+		goto out_conv_bench;
+	}
+
+	/* Grab some real samples from the device */
+	acq_cnt = ACQ_SIZE / width;
+	err = a4l_sync_read(&dsc, idx_subd, CHAN(idx_chan), 0,
+			    acq, acq_cnt * width);
+	if (err < 0) {
+		fprintf(stderr,
+			"conv_bench: a4l_sync_read failed (err=%d)\n", err);
+		goto out_conv_bench;
+	}
+
+	acq_cnt = err / width;
+	if (acq_cnt == 0) {
+		fprintf(stderr, "conv_bench: no sample acquired\n");
+		err = -ENODATA;
+		goto out_conv_bench;
+	}
+
+	impl = getenv("A4L_CONVERT");
+	fprintf(stdout, "conv_bench: %d samples x %d loops, kernels: %s\n",
+		sample_cnt, loop_cnt, impl ? impl : "auto");
+
+	if (verbose != 0) {
+		printf("conv_bench: %d samples acquired from %s, "
+		       "subdevice %d, channel %d\n",
+		       acq_cnt, filename, idx_subd, idx_chan);
+		printf("\t channel width = %u bits\n", chinfo->nb_bits);
+		printf("\t range = [%ld, %ld]\n", rnginfo->min, rnginfo->max);
+	}
+
+	for (bits = 8; bits <= 32; bits *= 2) {
+		chan = *chinfo;
+		chan.nb_bits = nb_bits ? nb_bits : bits;
+
+		raw = build_samples(chinfo, acq, acq_cnt,
+				    a4l_sizeof_chan(&chan));
+		if (raw == NULL) {
+			err = -ENOMEM;
+			goto out_conv_bench;
+		}
+
+		err = run_width(&chan, rnginfo, raw, a4l_sizeof_chan(&chan));
+		free(raw);
+		if (err < 0)
+			goto out_conv_bench;
+
+		/* Only one round with an explicit resolution */
+		if (nb_bits)
+			break;
+	}
+
+	fprintf(stdout, "conv_bench: all conversions matched\n");
+
+out_conv_bench:
+	/* Free the buffer used as device descriptor */
+	if (dsc.sbdata != NULL)
+		free(dsc.sbdata);
+
+	/* Release the file descriptor */
+	a4l_close(&dsc);
+
+	return err;
+}
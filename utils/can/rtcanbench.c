@@ -0,0 +1,258 @@
+/*
+ * Measure the receive filter dispatch cost of RT-Socket-CAN.
+ *
+ * Frames are sent on a virtual CAN interface (rtcan_virt), which
+ * delivers them synchronously to the receive filters of the other
+ * virtual interfaces from the sender's context. The time spent in
+ * send() therefore includes the dispatch cost, which is compared to a
+ * run with no filter installed.
+ *
+ * Copyright (C) 2026 Xenomai contributors.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+#include <getopt.h>
+#include <pthread.h>
+
+#include <rtdm/can.h>
+
+#define FILTERS_PER_SOCKET 16
+#define MAX_SOCKETS	   64
+
+static void print_usage(char *prg)
+{
+    fprintf(stderr,
+	    "Usage: %s [Options]\n"
+	    "Options:\n"
+	    " -t, --tx=IFNAME       transmit interface (default rtcan0)\n"
+	    " -r, --rx=IFNAME       receive interface (default rtcan1)\n"
+	    " -f, --filters=N[,N]   filter counts to test (default 1,16,64,256)\n"
+	    " -n, --frames=N        frames sent per run (default 10000)\n"
+	    " -h, --help            this help\n",
+	    prg);
+}
+
+static int rx_socks[MAX_SOCKETS];
+static int nr_rx_socks;
+
+static int get_ifindex(int s, const char *name)
+{
+    struct ifreq ifr;
+
+    strncpy(ifr.ifr_name, name, IFNAMSIZ);
+    if (ioctl(s, SIOCGIFINDEX, &ifr) < 0)
+	return -errno;
+
+    return ifr.ifr_ifindex;
+}
+
+static void close_filters(void)
+{
+    while (nr_rx_socks > 0)
+	close(rx_socks[--nr_rx_socks]);
+}
+
+/*
+ * Install @count exact-ID filters on @ifname, 0x100 + n matching the
+ * n-th one, spread over sockets like independent listeners would do.
+ */
+static int open_filters(const char *ifname, int count)
+{
+    struct can_filter filters[FILTERS_PER_SOCKET];
+    struct sockaddr_can addr;
+    int s, n, id = 0x100, ifindex;
+
+    while (count > 0) {
+	if (nr_rx_socks >= MAX_SOCKETS)
+	    return -ENOSPC;
+
+	s = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+	if (s < 0)
+	    return -errno;
+	rx_socks[nr_rx_socks++] = s;
+
+	for (n = 0; n < FILTERS_PER_SOCKET && count > 0; n++, count--) {
+	    filters[n].can_id = id++;
+	    filters[n].can_mask = CAN_SFF_MASK;
+	}
+
+	if (setsockopt(s, SOL_CAN_RAW, CAN_RAW_FILTER,
+		       filters, n * sizeof(filters[0])) < 0)
+	    return -errno;
+
+	ifindex = get_ifindex(s, ifname);
+	if (ifindex < 0)
+	    return ifindex;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.can_family = AF_CAN;
+	addr.can_ifindex = ifindex;
+	if (bind(s, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+	    return -errno;
+    }
+
+    return 0;
+}
+
+static int run_bench(int tx, int count, int frames, long long *ns_r)
+{
+    struct timespec start, end;
+    struct can_frame frame;
+    long long sum = 0;
+    int n, id;
+
+    memset(&frame, 0, sizeof(frame));
+    frame.can_dlc = sizeof(int);
+
+    for (n = 0; n < frames; n++) {
+	id = count ? n % count : 0;
+	frame.can_id = 0x100 + id;
+	memcpy(frame.data, &n, sizeof(n));
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	if (send(tx, &frame, sizeof(frame), 0) < 0)
+	    return -errno;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	sum += (end.tv_sec - start.tv_sec) * 1000000000LL +
+	    end.tv_nsec - start.tv_nsec;
+	/* Drain the listener which got the frame. */
+	if (count)
+	    recv(rx_socks[id / FILTERS_PER_SOCKET], &frame,
+		 sizeof(frame), MSG_DONTWAIT);
+    }
+
+    *ns_r = sum / frames;
+
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *txname = "rtcan0", *rxname = "rtcan1";
+    char *counts = "1,16,64,256", *p;
+    struct sockaddr_can addr;
+    struct sched_param param;
+    long long base_ns, ns;
+    int tx, ret, opt, frames = 10000, count;
+
+    struct option long_options[] = {
+	{ "help", no_argument, 0, 'h' },
+	{ "tx", required_argument, 0, 't'},
+	{ "rx", required_argument, 0, 'r'},
+	{ "filters", required_argument, 0, 'f'},
+	{ "frames", required_argument, 0, 'n'},
+	{ 0, 0, 0, 0},
+    };
+
+    while ((opt = getopt_long(argc, argv, "ht:r:f:n:",
+			      long_options, NULL)) != -1) {
+	switch (opt) {
+	case 't':
+	    txname = optarg;
+	    break;
+	case 'r':
+	    rxname = optarg;
+	    break;
+	case 'f':
+	    counts = optarg;
+	    break;
+	case 'n':
+	    frames = strtoul(optarg, NULL, 0);
+	    break;
+	case 'h':
+	default:
+	    print_usage(argv[0]);
+	    exit(opt == 'h' ? 0 : 1);
+	}
+    }
+
+    if (frames <= 0) {
+	print_usage(argv[0]);
+	exit(1);
+    }
+
+    param.sched_priority = 80;
+    ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+    if (ret) {
+	fprintf(stderr, "pthread_setschedparam: %s\n", strerror(ret));
+	exit(1);
+    }
+
+    tx = socket(PF_CAN, SOCK_RAW, CAN_RAW);
+    if (tx < 0) {
+	fprintf(stderr, "socket: %s\n", strerror(errno));
+	exit(1);
+    }
+
+    /* The sender does not receive anything. */
+    ret = setsockopt(tx, SOL_CAN_RAW, CAN_RAW_FILTER, NULL, 0);
+    if (ret < 0) {
+	fprintf(stderr, "setsockopt: %s\n", strerror(errno));
+	goto fail;
+    }
+
+    ret = get_ifindex(tx, txname);
+    if (ret < 0) {
+	fprintf(stderr, "%s: %s\n", txname, strerror(-ret));
+	goto fail;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.can_family = AF_CAN;
+    addr.can_ifindex = ret;
+    ret = bind(tx, (struct sockaddr *)&addr, sizeof(addr));
+    if (ret < 0) {
+	fprintf(stderr, "bind: %s\n", strerror(errno));
+	goto fail;
+    }
+
+    ret = run_bench(tx, 0, frames, &base_ns);
+    if (ret) {
+	fprintf(stderr, "send: %s\n", strerror(-ret));
+	goto fail;
+    }
+
+    printf("%8s %12s %12s\n", "filters", "send (ns)", "dispatch (ns)");
+    printf("%8d %12lld %12s\n", 0, base_ns, "-");
+
+    for (p = strtok(counts, ","); p; p = strtok(NULL, ",")) {
+	count = atoi(p);
+	if (count <= 0)
+	    continue;
+	ret = open_filters(rxname, count);
+	if (ret) {
+	    fprintf(stderr, "%d filters on %s: %s\n",
+		    count, rxname, strerror(-ret));
+	    close_filters();
+	    break;
+	}
+	ret = run_bench(tx, count, frames, &ns);
+	close_filters();
+	if (ret) {
+	    fprintf(stderr, "send: %s\n", strerror(-ret));
+	    goto fail;
+	}
+	printf("%8d %12lld %12lld\n", count, ns, ns - base_ns);
+    }
+
+    close(tx);
+
+    return 0;
+fail:
+    close(tx);
+
+    return 1;
+}
@@ -0,0 +1,359 @@
+/*
+ * Copyright (C) 2026 Xenomai contributors
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+ *
+ * This utility summarizes the output of the /proc/xenomai/debug/lockstat
+ * vfile, ranking the lock acquisition sites by cost.
+ */
+
+#include <stdio.h>
+#include <error.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+
+#define LOCKSTAT_VFILE	"/proc/xenomai/debug/lockstat"
+
+static const struct option base_options[] = {
+	{
+#define help_opt	0
+		.name = "help",
+		.has_arg = no_argument,
+	},
+#define file_opt	1
+	{
+		.name = "file",
+		.has_arg = required_argument,
+	},
+#define sort_opt	2
+	{
+		.name = "sort",
+		.has_arg = required_argument,
+	},
+#define top_opt		3
+	{
+		.name = "top",
+		.has_arg = required_argument,
+	},
+#define per_cpu_opt	4
+	{
+		.name = "per-cpu",
+		.has_arg = no_argument,
+	},
+#define reset_opt	5
+	{
+		.name = "reset",
+		.has_arg = no_argument,
+	},
+	{ /* Sentinel */ }
+};
+
+struct site {
+	int cpu;
+	char lock[32];
+	char *where;
+	char *function;
+	unsigned long count;
+	unsigned long long hold_max;
+	unsigned long long hold_total;
+	unsigned long long spin_max;
+	unsigned long long spin_total;
+};
+
+struct cpu_summary {
+	int cpu;
+	unsigned long count;
+	unsigned long long hold_total;
+	unsigned long long spin_total;
+	unsigned long long nklock_spin;
+};
+
+static struct site *site_table;
+
+static int site_count, site_alloc;
+
+static struct cpu_summary *cpu_table;
+
+static int cpu_count;
+
+static int per_cpu;
+
+static const char *sort_name = "hold";
+
+static struct site *find_site(int cpu, const char *lock, const char *where)
+{
+	struct site *s;
+	int n;
+
+	for (n = 0, s = site_table; n < site_count; n++, s++) {
+		if (per_cpu && s->cpu != cpu)
+			continue;
+		if (strcmp(s->lock, lock) == 0 && strcmp(s->where, where) == 0)
+			return s;
+	}
+
+	if (site_count == site_alloc) {
+		site_alloc = site_alloc ? site_alloc * 2 : 64;
+		site_table = realloc(site_table, site_alloc * sizeof(*s));
+		if (site_table == NULL)
+			error(1, ENOMEM, "realloc");
+	}
+
+	s = site_table + site_count++;
+	memset(s, 0, sizeof(*s));
+	s->cpu = per_cpu ? cpu : -1;
+	snprintf(s->lock, sizeof(s->lock), "%s", lock);
+	s->where = strdup(where);
+
+	return s;
+}
+
+static struct cpu_summary *find_cpu(int cpu)
+{
+	struct cpu_summary *c;
+	int n;
+
+	for (n = 0, c = cpu_table; n < cpu_count; n++, c++)
+		if (c->cpu == cpu)
+			return c;
+
+	cpu_table = realloc(cpu_table, (cpu_count + 1) * sizeof(*c));
+	if (cpu_table == NULL)
+		error(1, ENOMEM, "realloc");
+
+	c = cpu_table + cpu_count++;
+	memset(c, 0, sizeof(*c));
+	c->cpu = cpu;
+
+	return c;
+}
+
+static void read_sites(FILE *fp)
+{
+	unsigned long long hold_max, hold_total, spin_max, spin_total;
+	char lock[32], *where, *function, *line = NULL;
+	struct cpu_summary *c;
+	unsigned long count;
+	struct site *s;
+	size_t len = 0;
+	int cpu, ret;
+
+	/* Skip the header. */
+	if (getline(&line, &len, fp) < 0)
+		goto out;
+
+	while (getline(&line, &len, fp) > 0) {
+		ret = sscanf(line, "%d %31s %lu %llu %llu %llu %llu %ms %m[^\n]",
+			     &cpu, lock, &count, &hold_max, &hold_total,
+			     &spin_max, &spin_total, &where, &function);
+		if (ret != 9)
+			error(1, 0, "malformed record: %s", line);
+
+		s = find_site(cpu, lock, where);
+		if (s->function == NULL)
+			s->function = function;
+		else
+			free(function);
+		free(where);
+
+		s->count += count;
+		s->hold_total += hold_total;
+		s->spin_total += spin_total;
+		if (hold_max > s->hold_max)
+			s->hold_max = hold_max;
+		if (spin_max > s->spin_max)
+			s->spin_max = spin_max;
+
+		c = find_cpu(cpu);
+		c->count += count;
+		c->hold_total += hold_total;
+		c->spin_total += spin_total;
+		if (strcmp(lock, "nklock") == 0)
+			c->nklock_spin += spin_total;
+	}
+out:
+	free(line);
+}
+
+static unsigned long long sort_key(const struct site *s)
+{
+	if (strcmp(sort_name, "hold") == 0)
+		return s->hold_total;
+	if (strcmp(sort_name, "hold-max") == 0)
+		return s->hold_max;
+	if (strcmp(sort_name, "spin") == 0)
+		return s->spin_total;
+	if (strcmp(sort_name, "spin-max") == 0)
+		return s->spin_max;
+
+	return s->count;
+}
+
+static int compare_sites(const void *a, const void *b)
+{
+	unsigned long long ka = sort_key(a), kb = sort_key(b);
+
+	return ka < kb ? 1 : ka > kb ? -1 : 0;
+}
+
+static int compare_cpus(const void *a, const void *b)
+{
+	const struct cpu_summary *ca = a, *cb = b;
+
+	return ca->cpu - cb->cpu;
+}
+
+static void display_sites(int top)
+{
+	struct cpu_summary *c;
+	struct site *s;
+	int n;
+
+	qsort(site_table, site_count, sizeof(*s), compare_sites);
+	if (top > 0 && top < site_count)
+		site_count = top;
+
+	printf("%10s %9s %10s %14s %9s %10s %14s %s%-18s %s\n",
+	       "COUNT", "HOLD-AVG", "HOLD-MAX", "HOLD-TOTAL",
+	       "SPIN-AVG", "SPIN-MAX", "SPIN-TOTAL",
+	       per_cpu ? "CPU  " : "", "LOCK", "SITE");
+
+	for (n = 0, s = site_table; n < site_count; n++, s++) {
+		printf("%10lu %9llu %10llu %14llu %9llu %10llu %14llu ",
+		       s->count, s->hold_total / (s->count ?: 1),
+		       s->hold_max, s->hold_total,
+		       s->spin_total / (s->count ?: 1),
+		       s->spin_max, s->spin_total);
+		if (per_cpu)
+			printf("%3d  ", s->cpu);
+		printf("%-18s %s %s\n", s->lock, s->where, s->function);
+	}
+
+	qsort(cpu_table, cpu_count, sizeof(*c), compare_cpus);
+
+	printf("\n%3s %12s %14s %14s %14s\n",
+	       "CPU", "COUNT", "HOLD-TOTAL", "SPIN-TOTAL", "NKLOCK-SPIN");
+
+	for (n = 0, c = cpu_table; n < cpu_count; n++, c++)
+		printf("%3d %12lu %14llu %14llu %14llu\n",
+		       c->cpu, c->count, c->hold_total,
+		       c->spin_total, c->nklock_spin);
+}
+
+static void reset_stats(const char *stat_file)
+{
+	FILE *fp;
+
+	fp = fopen(stat_file, "w");
+	if (fp == NULL)
+		error(1, errno, "cannot open %s", stat_file);
+
+	if (fputs("0\n", fp) == EOF || fclose(fp))
+		error(1, errno, "cannot reset %s", stat_file);
+}
+
+static void usage(void)
+{
+	fprintf(stderr, "usage: lockstat [options]\n");
+	fprintf(stderr, "   --file <file>				read statistics from file\n");
+	fprintf(stderr, "   --sort <hold|hold-max|spin|spin-max|count>	sort key (default: hold)\n");
+	fprintf(stderr, "   --top <n>					only show the n first sites\n");
+	fprintf(stderr, "   --per-cpu					do not merge CPU figures\n");
+	fprintf(stderr, "   --reset					clear the kernel statistics\n");
+	fprintf(stderr, "   --help					print this help\n");
+}
+
+int main(int argc, char *const argv[])
+{
+	int c, lindex, top = 0, reset = 0;
+	const char *stat_file = NULL;
+	FILE *fp;
+
+	for (;;) {
+		c = getopt_long_only(argc, argv, "", base_options, &lindex);
+		if (c == EOF)
+			break;
+		if (c == '?') {
+			usage();
+			return EINVAL;
+		}
+		if (c > 0)
+			continue;
+
+		switch (lindex) {
+		case help_opt:
+			usage();
+			exit(0);
+		case file_opt:
+			stat_file = optarg;
+			break;
+		case sort_opt:
+			if (strcmp(optarg, "hold") &&
+			    strcmp(optarg, "hold-max") &&
+			    strcmp(optarg, "spin") &&
+			    strcmp(optarg, "spin-max") &&
+			    strcmp(optarg, "count")) {
+				usage();
+				return EINVAL;
+			}
+			sort_name = optarg;
+			break;
+		case top_opt:
+			top = atoi(optarg);
+			break;
+		case per_cpu_opt:
+			per_cpu = 1;
+			break;
+		case reset_opt:
+			reset = 1;
+			break;
+		default:
+			return EINVAL;
+		}
+	}
+
+	if (reset) {
+		reset_stats(stat_file ?: LOCKSTAT_VFILE);
+		return 0;
+	}
+
+	fp = stdin;
+	if (stat_file == NULL) {
+		if (isatty(fileno(stdin))) {
+			stat_file = LOCKSTAT_VFILE;
+			goto open;
+		}
+	} else if (strcmp(stat_file, "-")) {
+	open:
+		fp = fopen(stat_file, "r");
+		if (fp == NULL)
+			error(1, errno, "cannot open statistics file %s",
+			      stat_file);
+	}
+
+	read_sites(fp);
+
+	if (site_count == 0) {
+		fputs("no lock statistics\n", stderr);
+		return 0;	/* This is not an error. */
+	}
+
+	display_sites(top);
+
+	return 0;
+}